@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Heap Allocation Profiler
+ */
+
+#include "alloc_profiler.h"
+#include "constants.h"
+#include "fail.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+    alloc_profiler::site sites[alloc_profiler::MAX_SITES];
+    size_t site_count = 0;
+    alloc_profiler::totals counts = {};
+    uint32_t utterances = 0;
+    uint32_t steady_after = constants::STEADY_STATE_UTTERANCES;
+
+    void count(uintptr_t address, size_t size) {
+        counts.allocations += 1;
+        counts.bytes += size;
+        for (size_t i = 0; i < site_count; ++i) {
+            if (sites[i].address == address) {
+                sites[i].allocations += 1;
+                sites[i].bytes += size;
+                return;
+            }
+        }
+        if (site_count < alloc_profiler::MAX_SITES) {
+            sites[site_count++] = { address, 1, size };
+        } else {
+            counts.untracked += 1;
+        }
+    }
+
+    void *allocate(size_t size, void *caller) {
+        count(reinterpret_cast<uintptr_t>(caller), size);
+        if (alloc_profiler::steady()) {
+            fail(FAIL_STEADY_STATE_ALLOCATION);
+        }
+        return malloc(size ? size : 1);
+    }
+
+    void *allocate_or_die(size_t size, void *caller) {
+        void *memory = allocate(size, caller);
+        if (!memory) {
+#if __cpp_exceptions
+            throw std::bad_alloc();
+#else
+            abort();
+#endif
+        }
+        return memory;
+    }
+
+    void release(void *memory) {
+        if (memory) {
+            counts.frees += 1;
+            free(memory);
+        }
+    }
+}
+
+namespace alloc_profiler {
+    void utterance_said() {
+        utterances += 1;
+    }
+
+    void set_steady_after(uint32_t after) {
+        steady_after = after;
+    }
+
+    bool steady() {
+        return steady_after && utterances >= steady_after;
+    }
+
+    const totals &get_totals() {
+        return counts;
+    }
+
+    const site *get_sites(size_t &count) {
+        count = site_count;
+        return sites;
+    }
+}
+
+// Replacements for the global allocation functions.  Inlined into them, the
+// return address is that of the code doing the new.
+void *operator new(size_t size) {
+    return allocate_or_die(size, __builtin_return_address(0));
+}
+
+void *operator new[](size_t size) {
+    return allocate_or_die(size, __builtin_return_address(0));
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size, __builtin_return_address(0));
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size, __builtin_return_address(0));
+}
+
+void operator delete(void *memory) noexcept {
+    release(memory);
+}
+
+void operator delete[](void *memory) noexcept {
+    release(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+    release(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept {
+    release(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept {
+    release(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept {
+    release(memory);
+}
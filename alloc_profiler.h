@@ -0,0 +1,73 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Heap Allocation Profiler
+ */
+
+#ifndef ALLOC_PROFILER_H
+#define ALLOC_PROFILER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Counts heap allocations by call site, and guards the steady state.
+ *
+ * Linking alloc_profiler.cpp replaces the global operator new and delete,
+ * which is where std::vector and the other containers allocate, with ones
+ * that count.  Each allocation is put down to the address it was called
+ * from, which addr2line turns into a source line.  Allocations from inside
+ * library templates show the template.
+ *
+ * The steady state starts once constants::STEADY_STATE_UTTERANCES have been
+ * said, and from then on any allocation fails with
+ * FAIL_STEADY_STATE_ALLOCATION, so that the heap cannot fragment over months
+ * of counting.
+ *
+ * Not safe to allocate from interrupt handlers or the other core while
+ * counting.
+ */
+namespace alloc_profiler {
+    constexpr size_t MAX_SITES = 32;
+
+    struct site {
+        uintptr_t address;          // Return address in the caller
+        uint32_t allocations;
+        uint64_t bytes;
+    };
+
+    struct totals {
+        uint32_t allocations;
+        uint32_t frees;
+        uint64_t bytes;
+        uint32_t untracked;         // Allocations from sites after the first MAX_SITES
+    };
+
+    /**
+     * Note that an utterance has been said, which may start the steady state.
+     */
+    void utterance_said();
+
+    /**
+     * Change how many utterances are said before the steady state starts.
+     *
+     * @param utterances Utterances, or zero for no steady state
+     */
+    void set_steady_after(uint32_t utterances);
+
+    /**
+     * Check whether allocating now would fail.
+     */
+    bool steady();
+
+    const totals &get_totals();
+
+    /**
+     * Call sites seen, in the order they first allocated.
+     *
+     * @param count Set to the number of sites
+     */
+    const site *get_sites(size_t &count);
+}
+
+#endif // ALLOC_PROFILER_H
@@ -1,6 +1,7 @@
 #ifndef AUDIO_H
 #define AUDIO_H
 
+#include "constants.h"
 #include "number_to_speech.h"
 #include <cstddef>
 #include <cstdint>
@@ -10,9 +11,45 @@ namespace audio {
         const uint8_t *data;
         size_t size;
         size_t samples_per_block;
+        uint32_t sample_rate;
+        uint8_t codec;
+        size_t sample_count;
+        uint8_t token;              // The number_token this is for
     };
 
+    /**
+     * Load the index from the voice blob, and copy the most frequently spoken
+     * tokens into SRAM.
+     *
+     * The blob has the hottest tokens first, so as many whole tokens from the
+     * start of the data as fit in the budget are copied.  May be called again
+     * to change the budget, but not while samples are playing.
+     *
+     * Fails with FAIL_BAD_VOICE_DATA if the blob linked into the firmware is
+     * not one we understand.
+     *
+     * @param sram_budget Bytes of SRAM to use, at most constants::VOICE_SRAM_BYTES
+     */
+    void init(size_t sram_budget = constants::VOICE_SRAM_BYTES);
+
+    /**
+     * Number of tokens and bytes held in SRAM by the last init().
+     */
+    size_t pinned_tokens();
+    size_t pinned_bytes();
+
     const sample_data &get_sample_data(number_token index);
+
+    /**
+     * Check whether a sample is played from flash, through the XIP cache,
+     * rather than from SRAM.
+     */
+    bool in_flash(const sample_data &sample);
+
+    /**
+     * A sample with no data, for when there is nothing to play.
+     */
+    const sample_data &empty_sample();
 }
 
 #endif // AUDIO_H
@@ -1,2744 +0,0 @@
-constexpr uint32_t EIGHT_SAMPLE_RATE = 22058;
-constexpr uint32_t EIGHT_SAMPLE_SIZE = 21902;
-constexpr uint32_t EIGHT_SAMPLES_PER_BLOCK = 10951;
-
-const uint8_t INFLASH EIGHT_AUDIO_DATA[] = {
-    0x92, 0xff, 0x41, 0xff, 0x28, 0xff, 0x75, 0xff,
-    0x0a, 0x00, 0x54, 0x00, 0xf0, 0xff, 0x81, 0xff,
-    0x92, 0xff, 0xe4, 0xff, 0x0f, 0x00, 0xdd, 0xff,
-    0xf7, 0xff, 0x5a, 0x00, 0x84, 0x00, 0x34, 0x00,
-    0xd3, 0xff, 0xaf, 0xff, 0x98, 0xff, 0x82, 0xff,
-    0x75, 0xff, 0x6d, 0xff, 0x47, 0xff, 0x1c, 0xff,
-    0x5d, 0xff, 0xb5, 0xff, 0xed, 0xff, 0xd7, 0xff,
-    0xb2, 0xff, 0xcb, 0xff, 0xb0, 0xff, 0x83, 0xff,
-    0x61, 0xff, 0x9b, 0xff, 0xe4, 0xff, 0xdf, 0xff,
-    0xbb, 0xff, 0x9e, 0xff, 0xc4, 0xff, 0xbd, 0xff,
-    0xaf, 0xff, 0xe0, 0xff, 0x0b, 0x00, 0x18, 0x00,
-    0xd3, 0xff, 0x98, 0xff, 0xa9, 0xff, 0xad, 0xff,
-    0xb7, 0xff, 0xd3, 0xff, 0xfc, 0xff, 0x0a, 0x00,
-    0xf7, 0xff, 0xf2, 0xff, 0x05, 0x00, 0x2e, 0x00,
-    0x44, 0x00, 0x57, 0x00, 0x6f, 0x00, 0x85, 0x00,
-    0x9a, 0x00, 0x8e, 0x00, 0x96, 0x00, 0xb0, 0x00,
-    0xa1, 0x00, 0x7b, 0x00, 0x69, 0x00, 0x79, 0x00,
-    0x75, 0x00, 0x6d, 0x00, 0x8c, 0x00, 0xc8, 0x00,
-    0xea, 0x00, 0x05, 0x01, 0x35, 0x01, 0x4f, 0x01,
-    0x55, 0x01, 0x55, 0x01, 0x6a, 0x01, 0xa3, 0x01,
-    0x83, 0x01, 0x66, 0x01, 0x3c, 0x01, 0x0f, 0x01,
-    0x0a, 0x01, 0x33, 0x01, 0x0a, 0x02, 0x2c, 0x03,
-    0xd5, 0x03, 0x63, 0x03, 0x30, 0x02, 0xc7, 0x00,
-    0xbc, 0xff, 0xb8, 0xfe, 0xf5, 0xfd, 0xa5, 0xfd,
-    0xc5, 0xfd, 0x2a, 0xfe, 0x67, 0xfe, 0x8a, 0xfe,
-    0xc0, 0xfe, 0xcf, 0xfe, 0x02, 0xff, 0x35, 0xff,
-    0xf6, 0xfe, 0xad, 0xfe, 0xf6, 0xfd, 0x6b, 0xfd,
-    0x3e, 0xfd, 0x54, 0xfd, 0x63, 0xfd, 0x2e, 0xfd,
-    0x6e, 0xfc, 0xc5, 0xfb, 0x1a, 0xfb, 0x50, 0xfa,
-    0xc4, 0xf9, 0x28, 0xf9, 0xf0, 0xf8, 0xd6, 0xf8,
-    0x4d, 0xf8, 0x8e, 0xf7, 0x52, 0xf6, 0xe2, 0xf4,
-    0x2a, 0xf4, 0x15, 0xf4, 0x64, 0xf4, 0x86, 0xf4,
-    0xdd, 0xf4, 0x2d, 0xf7, 0x6d, 0xfc, 0xa3, 0x02,
-    0xe9, 0x08, 0x7e, 0x0e, 0xc0, 0x12, 0xe1, 0x15,
-    0xec, 0x15, 0x7c, 0x13, 0x10, 0x11, 0x1d, 0x0f,
-    0xe8, 0x0d, 0x46, 0x0c, 0x51, 0x0a, 0x67, 0x09,
-    0xce, 0x08, 0x78, 0x07, 0x63, 0x05, 0x07, 0x03,
-    0x75, 0x00, 0x04, 0xfe, 0x2f, 0xfb, 0x2c, 0xf9,
-    0xb5, 0xf8, 0x78, 0xf9, 0xd3, 0xfb, 0x5b, 0xfe,
-    0x52, 0x01, 0x80, 0x04, 0x9e, 0x06, 0x3d, 0x08,
-    0x3f, 0x09, 0x76, 0x0a, 0xc5, 0x0b, 0xf3, 0x0b,
-    0x86, 0x0b, 0x67, 0x0b, 0xd8, 0x0a, 0xc4, 0x09,
-    0x8b, 0x07, 0xe2, 0x04, 0xe4, 0x02, 0x8f, 0x00,
-    0x96, 0xfe, 0xb6, 0xfc, 0x25, 0xfb, 0x2f, 0xfa,
-    0x21, 0xf9, 0x7e, 0xf8, 0x8d, 0xf8, 0x42, 0xf9,
-    0x50, 0xfa, 0x59, 0xfb, 0x3b, 0xfc, 0xe0, 0xfc,
-    0x29, 0xfd, 0x74, 0xfc, 0x92, 0xfb, 0xea, 0xfa,
-    0x13, 0xfa, 0xcd, 0xf8, 0xb6, 0xf6, 0x54, 0xf4,
-    0x03, 0xf2, 0xe2, 0xee, 0xa2, 0xeb, 0xbb, 0xe9,
-    0xa6, 0xe8, 0x01, 0xe8, 0xff, 0xe6, 0x59, 0xe5,
-    0xb7, 0xe4, 0x7e, 0xe6, 0xbf, 0xee, 0x70, 0xff,
-    0x83, 0x12, 0x62, 0x21, 0x68, 0x28, 0xdb, 0x28,
-    0x8a, 0x25, 0xbc, 0x1d, 0x0e, 0x14, 0x6c, 0x0e,
-    0x12, 0x0d, 0x03, 0x0d, 0x3e, 0x0b, 0x54, 0x07,
-    0xfb, 0x03, 0x64, 0xff, 0x60, 0xf9, 0xd0, 0xf5,
-    0xb6, 0xf3, 0x7d, 0xf1, 0xbb, 0xed, 0x27, 0xea,
-    0x2e, 0xeb, 0x46, 0xef, 0xf4, 0xf4, 0x8f, 0xfd,
-    0xef, 0x07, 0xff, 0x10, 0xf7, 0x14, 0xf5, 0x12,
-    0xa5, 0x10, 0x63, 0x10, 0x70, 0x11, 0x50, 0x13,
-    0x42, 0x14, 0x0c, 0x15, 0xd7, 0x14, 0x3a, 0x11,
-    0x50, 0x0b, 0xb5, 0x04, 0x28, 0xff, 0x52, 0xfb,
-    0x26, 0xf7, 0x39, 0xf3, 0x88, 0xf1, 0xc9, 0xf1,
-    0x36, 0xf4, 0x70, 0xf8, 0x11, 0xfe, 0x63, 0x04,
-    0x70, 0x07, 0xcc, 0x06, 0xe7, 0x04, 0xbf, 0x02,
-    0xa5, 0x01, 0x82, 0x01, 0x8f, 0x02, 0x04, 0x05,
-    0xc8, 0x05, 0x68, 0x04, 0x15, 0x03, 0x49, 0x02,
-    0x1d, 0x02, 0xf3, 0x00, 0x39, 0xfe, 0x9a, 0xfb,
-    0xb3, 0xf8, 0xf2, 0xf5, 0x1d, 0xf5, 0x2e, 0xf6,
-    0x1f, 0xf9, 0x2e, 0xfc, 0x67, 0xfd, 0x40, 0xfd,
-    0xeb, 0xfa, 0x66, 0xf6, 0x77, 0xf1, 0xe7, 0xec,
-    0xe7, 0xe9, 0x75, 0xe7, 0x08, 0xe4, 0x1d, 0xe1,
-    0xf4, 0xde, 0xc4, 0xdc, 0x06, 0xdb, 0x48, 0xdc,
-    0xa6, 0xe5, 0x63, 0xf7, 0x38, 0x0b, 0xf8, 0x1b,
-    0x2a, 0x27, 0xfc, 0x2c, 0xa3, 0x2d, 0xa5, 0x28,
-    0x8f, 0x21, 0x39, 0x1c, 0x18, 0x19, 0x4b, 0x17,
-    0xc3, 0x14, 0xef, 0x10, 0xfe, 0x0b, 0x52, 0x05,
-    0x8a, 0xfe, 0xdc, 0xf8, 0xa4, 0xf3, 0xcd, 0xee,
-    0x00, 0xea, 0x3a, 0xe6, 0xdf, 0xe4, 0xa2, 0xe5,
-    0x95, 0xe9, 0x34, 0xf1, 0xf9, 0xfa, 0x37, 0x05,
-    0xef, 0x0c, 0x05, 0x11, 0xf5, 0x12, 0xab, 0x13,
-    0x75, 0x14, 0x47, 0x15, 0x16, 0x15, 0xcc, 0x14,
-    0x2d, 0x14, 0x1d, 0x12, 0x4a, 0x0e, 0x99, 0x08,
-    0x1d, 0x03, 0x44, 0xff, 0xaa, 0xfb, 0x1b, 0xf8,
-    0x38, 0xf5, 0xb7, 0xf3, 0x48, 0xf4, 0xcc, 0xf5,
-    0x63, 0xf8, 0xe3, 0xfc, 0x43, 0x01, 0x99, 0x03,
-    0xa8, 0x03, 0x8a, 0x02, 0x14, 0x02, 0xb3, 0x01,
-    0xc3, 0x00, 0x75, 0x00, 0x59, 0x00, 0x4e, 0xff,
-    0x42, 0xfd, 0xcf, 0xfa, 0x7c, 0xf9, 0x27, 0xf9,
-    0xb8, 0xf8, 0x02, 0xf9, 0xdf, 0xf9, 0x36, 0xfa,
-    0x03, 0xfa, 0x62, 0xf9, 0x44, 0xf9, 0xf8, 0xf9,
-    0xe9, 0xf9, 0x7e, 0xf8, 0x45, 0xf5, 0x0c, 0xf0,
-    0x7c, 0xea, 0x1c, 0xe5, 0x0e, 0xe0, 0x6e, 0xdc,
-    0x77, 0xd9, 0xd6, 0xd5, 0xf1, 0xd1, 0x93, 0xd2,
-    0x37, 0xe0, 0x4e, 0xfb, 0xe7, 0x18, 0x26, 0x2e,
-    0xc0, 0x37, 0xcd, 0x38, 0x6f, 0x33, 0xa4, 0x27,
-    0x3f, 0x1b, 0x0c, 0x16, 0xe7, 0x17, 0x7c, 0x1a,
-    0x3b, 0x18, 0x8a, 0x11, 0x7d, 0x09, 0xe7, 0xff,
-    0xb0, 0xf5, 0x63, 0xee, 0xa9, 0xea, 0xdb, 0xe7,
-    0x31, 0xe3, 0x21, 0xde, 0xe0, 0xdd, 0x46, 0xe4,
-    0x99, 0xef, 0xdb, 0xfd, 0x7c, 0x0c, 0x7a, 0x18,
-    0x62, 0x1e, 0xf6, 0x1c, 0x10, 0x18, 0xab, 0x14,
-    0x6c, 0x14, 0xbc, 0x15, 0x3e, 0x16, 0x4c, 0x15,
-    0xe9, 0x12, 0xff, 0x0d, 0x72, 0x06, 0xaa, 0xfe,
-    0xf7, 0xf8, 0x3e, 0xf5, 0x40, 0xf2, 0xcd, 0xef,
-    0x7f, 0xef, 0x73, 0xf2, 0xa5, 0xf7, 0x94, 0xfe,
-    0xe1, 0x06, 0xe0, 0x0d, 0xdc, 0x10, 0x9a, 0x0e,
-    0xbb, 0x08, 0xf1, 0x02, 0x4c, 0xfe, 0xfe, 0xfa,
-    0x0b, 0xfa, 0x5c, 0xfa, 0xad, 0xfa, 0xbc, 0xf9,
-    0xf1, 0xf6, 0xea, 0xf4, 0x97, 0xf4, 0x0b, 0xf5,
-    0x50, 0xf6, 0x60, 0xf7, 0x92, 0xf8, 0x8a, 0xfa,
-    0x18, 0xfc, 0xdd, 0xfd, 0xe9, 0xff, 0xe5, 0x00,
-    0x65, 0x00, 0x97, 0xfc, 0xaa, 0xf5, 0x00, 0xee,
-    0xd8, 0xe5, 0xa2, 0xde, 0x78, 0xd9, 0x87, 0xd5,
-    0x73, 0xd2, 0x66, 0xce, 0xaf, 0xcc, 0xe3, 0xd6,
-    0xaa, 0xef, 0x38, 0x10, 0x20, 0x2c, 0x34, 0x3a,
-    0xc2, 0x3c, 0x06, 0x37, 0x4e, 0x2a, 0x74, 0x1c,
-    0xb0, 0x13, 0x72, 0x13, 0x35, 0x18, 0x87, 0x19,
-    0x6a, 0x15, 0xc5, 0x0d, 0xa3, 0x03, 0x0b, 0xf9,
-    0xca, 0xef, 0x58, 0xe9, 0xde, 0xe4, 0x20, 0xe0,
-    0x89, 0xdc, 0x16, 0xdd, 0xd4, 0xe2, 0xcd, 0xec,
-    0xbb, 0xf9, 0xdc, 0x08, 0xae, 0x16, 0x15, 0x1e,
-    0x1a, 0x1e, 0x78, 0x1a, 0xd9, 0x17, 0x2b, 0x18,
-    0x69, 0x19, 0x65, 0x19, 0x01, 0x18, 0xae, 0x14,
-    0x32, 0x0f, 0x64, 0x08, 0xc8, 0x00, 0x7f, 0xfa,
-    0xdc, 0xf6, 0x42, 0xf4, 0xf2, 0xf1, 0x76, 0xf0,
-    0xfd, 0xf0, 0xdc, 0xf4, 0x49, 0xfb, 0x79, 0x02,
-    0x5b, 0x09, 0x10, 0x0e, 0x20, 0x0e, 0x5f, 0x0a,
-    0xc6, 0x05, 0xd2, 0x01, 0x25, 0xff, 0xb9, 0xfc,
-    0x67, 0xfa, 0xce, 0xf9, 0x69, 0xf9, 0xd5, 0xf7,
-    0x01, 0xf6, 0x7f, 0xf4, 0x51, 0xf4, 0x1a, 0xf5,
-    0xa3, 0xf5, 0xa7, 0xf6, 0x4e, 0xf8, 0x00, 0xfa,
-    0x09, 0xfc, 0xb6, 0xfd, 0x56, 0xfe, 0x4e, 0xfd,
-    0x24, 0xf9, 0x76, 0xf3, 0x41, 0xed, 0x80, 0xe5,
-    0xab, 0xde, 0x5c, 0xd9, 0x43, 0xd5, 0xfd, 0xd0,
-    0x83, 0xc9, 0x2b, 0xc9, 0xe3, 0xdb, 0x0e, 0xfe,
-    0xbe, 0x22, 0x45, 0x39, 0x8d, 0x3f, 0xe6, 0x3e,
-    0x34, 0x37, 0x4a, 0x29, 0x57, 0x1b, 0xe3, 0x13,
-    0x7e, 0x15, 0x16, 0x18, 0x3d, 0x15, 0x45, 0x0e,
-    0x62, 0x05, 0x5d, 0xfb, 0x2e, 0xf1, 0x1e, 0xea,
-    0x00, 0xe6, 0x02, 0xe2, 0xc1, 0xdd, 0x20, 0xdb,
-    0xa7, 0xde, 0xc9, 0xe8, 0xb3, 0xf6, 0x1c, 0x07,
-    0x8e, 0x16, 0x08, 0x21, 0xd4, 0x23, 0x2f, 0x20,
-    0xcd, 0x1b, 0x16, 0x1b, 0x20, 0x1e, 0xba, 0x1f,
-    0x8d, 0x1c, 0x47, 0x16, 0x7e, 0x0e, 0x6f, 0x06,
-    0x94, 0xfd, 0xbc, 0xf5, 0xd7, 0xf2, 0x4f, 0xf3,
-    0x7f, 0xf3, 0xd6, 0xf1, 0x07, 0xf1, 0xcc, 0xf4,
-    0x62, 0xfc, 0x0f, 0x06, 0x24, 0x0f, 0xed, 0x14,
-    0xde, 0x15, 0xe8, 0x10, 0x66, 0x09, 0x39, 0x03,
-    0x32, 0xff, 0xc4, 0xfc, 0x6a, 0xfa, 0xc4, 0xf7,
-    0x52, 0xf5, 0x07, 0xf3, 0x2a, 0xf0, 0xeb, 0xed,
-    0xa1, 0xee, 0x88, 0xf1, 0xb8, 0xf4, 0xae, 0xf6,
-    0x5a, 0xf8, 0x53, 0xfc, 0x67, 0x01, 0xf8, 0x04,
-    0x04, 0x06, 0x1c, 0x05, 0x11, 0x01, 0xb6, 0xf8,
-    0x01, 0xef, 0x11, 0xe5, 0xc8, 0xdd, 0x33, 0xda,
-    0x39, 0xd5, 0x9f, 0xcf, 0xa3, 0xc7, 0xb5, 0xc0,
-    0x0e, 0xca, 0xee, 0xe4, 0x44, 0x0a, 0x48, 0x2d,
-    0xce, 0x3f, 0xb6, 0x45, 0x6d, 0x42, 0x00, 0x37,
-    0x00, 0x2a, 0xb4, 0x1e, 0x0b, 0x1a, 0x2f, 0x1a,
-    0x8a, 0x17, 0x2c, 0x10, 0x92, 0x04, 0x92, 0xf9,
-    0xa8, 0xf1, 0xb6, 0xea, 0x86, 0xe5, 0xb1, 0xe0,
-    0xc5, 0xdb, 0x73, 0xd9, 0xb4, 0xd9, 0xc6, 0xdf,
-    0x08, 0xee, 0xae, 0xff, 0xcb, 0x11, 0x0e, 0x20,
-    0xc8, 0x25, 0xe8, 0x25, 0x75, 0x23, 0x28, 0x22,
-    0xe6, 0x23, 0xb3, 0x22, 0x69, 0x1c, 0x8a, 0x13,
-    0x26, 0x0a, 0xc5, 0x02, 0x9a, 0xfb, 0xd5, 0xf4,
-    0x4c, 0xf2, 0x5f, 0xf2, 0xea, 0xf2, 0x05, 0xf2,
-    0xde, 0xef, 0x46, 0xf2, 0xb4, 0xf9, 0x61, 0x04,
-    0x3a, 0x10, 0xc9, 0x17, 0xc1, 0x1a, 0xd7, 0x18,
-    0x23, 0x12, 0x5f, 0x0b, 0x67, 0x05, 0x91, 0xff,
-    0x86, 0xfa, 0xb8, 0xf4, 0x89, 0xee, 0xe3, 0xea,
-    0x03, 0xe9, 0x05, 0xe9, 0xc1, 0xec, 0x57, 0xf1,
-    0x42, 0xf5, 0x33, 0xf8, 0x89, 0xf9, 0x65, 0xfc,
-    0x2b, 0x01, 0x52, 0x05, 0x75, 0x08, 0xec, 0x09,
-    0x5e, 0x08, 0xcc, 0x01, 0x5d, 0xf6, 0x4a, 0xea,
-    0xcb, 0xdf, 0x64, 0xd8, 0x2d, 0xd3, 0x71, 0xcd,
-    0x2e, 0xc8, 0x47, 0xc1, 0xfa, 0xbf, 0x83, 0xd0,
-    0xac, 0xf0, 0x3e, 0x18, 0x4d, 0x36, 0x1b, 0x43,
-    0x68, 0x46, 0xd9, 0x3f, 0x3b, 0x33, 0xf2, 0x26,
-    0xab, 0x1e, 0x50, 0x1e, 0x42, 0x1e, 0xb7, 0x18,
-    0x83, 0x0f, 0xd8, 0x03, 0xc6, 0xf7, 0x12, 0xec,
-    0x20, 0xe3, 0x7a, 0xde, 0x0e, 0xdb, 0xf1, 0xd7,
-    0xcd, 0xd6, 0x70, 0xda, 0x7a, 0xe5, 0x0b, 0xf6,
-    0xf7, 0x08, 0x17, 0x1b, 0x2c, 0x27, 0xe5, 0x2a,
-    0x2d, 0x29, 0xa5, 0x25, 0xb9, 0x23, 0xed, 0x23,
-    0xf4, 0x20, 0xd3, 0x19, 0x5c, 0x11, 0x64, 0x08,
-    0x85, 0x00, 0xb8, 0xf7, 0xc0, 0xef, 0xf1, 0xec,
-    0xb4, 0xed, 0x10, 0xef, 0x66, 0xed, 0x3d, 0xee,
-    0x5f, 0xf5, 0x69, 0xff, 0xc7, 0x0c, 0x3c, 0x17,
-    0x64, 0x1d, 0x8a, 0x1f, 0x2d, 0x19, 0xad, 0x10,
-    0x47, 0x09, 0x4e, 0x02, 0x9f, 0xfc, 0x9e, 0xf6,
-    0xa4, 0xf1, 0x22, 0xee, 0x2c, 0xeb, 0x6e, 0xe8,
-    0xa2, 0xe6, 0xcb, 0xe7, 0x38, 0xeb, 0xad, 0xef,
-    0xaa, 0xf4, 0xa6, 0xf9, 0x00, 0x00, 0x55, 0x06,
-    0xdf, 0x09, 0xdd, 0x0b, 0x8b, 0x0b, 0xce, 0x07,
-    0x54, 0x00, 0xcf, 0xf4, 0x9b, 0xe7, 0xbf, 0xdb,
-    0x12, 0xd3, 0x01, 0xcc, 0x98, 0xc7, 0x20, 0xc2,
-    0xe1, 0xbb, 0xd0, 0xc3, 0x56, 0xdb, 0xbb, 0xfd,
-    0xf7, 0x1f, 0x18, 0x34, 0x78, 0x40, 0xac, 0x44,
-    0x52, 0x3e, 0x2d, 0x32, 0xc4, 0x24, 0x4c, 0x20,
-    0xf1, 0x20, 0xd6, 0x1e, 0xc8, 0x19, 0xfe, 0x0f,
-    0x57, 0x03, 0xc4, 0xf4, 0x88, 0xe5, 0xd8, 0xda,
-    0x3d, 0xd6, 0x86, 0xd3, 0x67, 0xd2, 0xf5, 0xd6,
-    0xe0, 0xe0, 0x59, 0xef, 0x93, 0xff, 0xdf, 0x0e,
-    0x7d, 0x1c, 0xa7, 0x24, 0xb1, 0x27, 0x26, 0x27,
-    0x42, 0x26, 0x50, 0x27, 0xc1, 0x25, 0x94, 0x21,
-    0xca, 0x1a, 0x72, 0x11, 0x50, 0x08, 0xa3, 0xfe,
-    0x3b, 0xf4, 0x33, 0xeb, 0x5d, 0xe7, 0x4c, 0xe7,
-    0xf8, 0xe8, 0xa2, 0xec, 0xb5, 0xf2, 0x32, 0xfe,
-    0xb5, 0x0a, 0xd8, 0x14, 0xb3, 0x1b, 0xdd, 0x1d,
-    0x91, 0x1c, 0xb1, 0x16, 0x38, 0x10, 0xe9, 0x0a,
-    0xa0, 0x04, 0xd1, 0xfd, 0x1c, 0xf7, 0x10, 0xf2,
-    0xcd, 0xed, 0x1e, 0xe9, 0xbb, 0xe4, 0xab, 0xe3,
-    0x87, 0xe5, 0x8c, 0xe9, 0x2c, 0xef, 0x3f, 0xf4,
-    0x8c, 0xfb, 0x91, 0x02, 0x65, 0x08, 0x61, 0x0c,
-    0x71, 0x0b, 0xbb, 0x08, 0xab, 0x02, 0xd2, 0xf9,
-    0x01, 0xf0, 0x97, 0xe5, 0x75, 0xdd, 0x20, 0xd7,
-    0xd5, 0xd0, 0x99, 0xca, 0x5e, 0xc3, 0xd8, 0xbc,
-    0x1c, 0xc5, 0xa8, 0xde, 0x15, 0x01, 0xf6, 0x22,
-    0x9a, 0x35, 0x50, 0x3e, 0x33, 0x40, 0x7c, 0x37,
-    0x7c, 0x2b, 0xd9, 0x21, 0xf3, 0x1f, 0x06, 0x21,
-    0xad, 0x1d, 0x69, 0x14, 0xcd, 0x07, 0x12, 0xfc,
-    0xbc, 0xef, 0x05, 0xe5, 0xd5, 0xdd, 0xab, 0xda,
-    0x9f, 0xd9, 0x46, 0xd9, 0x45, 0xdd, 0x3e, 0xe5,
-    0x4f, 0xf2, 0x66, 0x02, 0x56, 0x11, 0x04, 0x1f,
-    0x0d, 0x27, 0x06, 0x28, 0x6d, 0x26, 0xf8, 0x24,
-    0x26, 0x25, 0x47, 0x24, 0xf5, 0x1d, 0xa5, 0x14,
-    0x74, 0x0a, 0xc1, 0x00, 0x75, 0xf8, 0x1d, 0xf0,
-    0x2a, 0xeb, 0xdc, 0xe9, 0xcb, 0xea, 0x75, 0xed,
-    0x42, 0xf0, 0xc9, 0xf6, 0x13, 0x01, 0x86, 0x0c,
-    0x7c, 0x17, 0x35, 0x1e, 0x61, 0x20, 0x6b, 0x1d,
-    0xaf, 0x15, 0x1d, 0x0e, 0x5d, 0x07, 0x28, 0x01,
-    0xf2, 0xfb, 0x69, 0xf6, 0x25, 0xf2, 0xa7, 0xed,
-    0xcd, 0xe7, 0xfc, 0xe3, 0x4f, 0xe3, 0x47, 0xe5,
-    0x51, 0xe9, 0x2a, 0xee, 0x66, 0xf3, 0x39, 0xfa,
-    0x94, 0x01, 0xec, 0x08, 0x87, 0x0d, 0x49, 0x0d,
-    0x0a, 0x0b, 0x77, 0x04, 0x84, 0xfa, 0x07, 0xee,
-    0xea, 0xe1, 0x55, 0xdb, 0x20, 0xd6, 0x7e, 0xd1,
-    0x9d, 0xcc, 0xce, 0xc8, 0x09, 0xc4, 0x43, 0xc3,
-    0x41, 0xd6, 0xcf, 0xf6, 0x05, 0x1b, 0xea, 0x32,
-    0x73, 0x38, 0x65, 0x3c, 0x1f, 0x3b, 0xf4, 0x31,
-    0xe8, 0x26, 0x7e, 0x20, 0x85, 0x23, 0x0b, 0x24,
-    0x6c, 0x1a, 0xb7, 0x09, 0xa1, 0xf9, 0x63, 0xef,
-    0x90, 0xe7, 0x3b, 0xe0, 0xff, 0xdc, 0x7f, 0xdd,
-    0x17, 0xde, 0x4a, 0xe1, 0x2a, 0xe6, 0x0e, 0xee,
-    0xa9, 0xfb, 0xc0, 0x09, 0xc6, 0x17, 0xff, 0x22,
-    0xa1, 0x27, 0x3a, 0x28, 0x77, 0x27, 0xf6, 0x27,
-    0xea, 0x25, 0xf1, 0x1d, 0x38, 0x14, 0x78, 0x0a,
-    0x04, 0x02, 0x92, 0xfa, 0x4c, 0xf2, 0x48, 0xed,
-    0xbf, 0xec, 0xdc, 0xed, 0x8d, 0xef, 0x7d, 0xf2,
-    0xfa, 0xf7, 0xb3, 0xff, 0xa8, 0x09, 0x8b, 0x13,
-    0xe0, 0x1a, 0x58, 0x1f, 0x12, 0x1f, 0xde, 0x19,
-    0xce, 0x12, 0xf4, 0x0b, 0x54, 0x05, 0x94, 0xff,
-    0x1c, 0xf9, 0x45, 0xf2, 0x76, 0xed, 0x83, 0xe8,
-    0x67, 0xe4, 0x9a, 0xe2, 0x26, 0xe3, 0x67, 0xe7,
-    0xe7, 0xec, 0x78, 0xf2, 0x99, 0xf8, 0x10, 0xff,
-    0xa5, 0x05, 0x60, 0x0a, 0x90, 0x0c, 0xe4, 0x0b,
-    0x72, 0x08, 0xd8, 0x01, 0xff, 0xf6, 0x93, 0xeb,
-    0x8f, 0xe1, 0x26, 0xda, 0xa8, 0xd4, 0xeb, 0xcd,
-    0x00, 0xc7, 0x87, 0xbe, 0x13, 0xbe, 0x6e, 0xd0,
-    0x30, 0xf1, 0x46, 0x17, 0xd3, 0x30, 0x35, 0x3a,
-    0xb3, 0x3b, 0x67, 0x35, 0xbf, 0x2a, 0x86, 0x20,
-    0x9e, 0x1d, 0x44, 0x22, 0x96, 0x25, 0xfe, 0x21,
-    0x9c, 0x16, 0xa6, 0x07, 0xbb, 0xf9, 0x92, 0xec,
-    0x6b, 0xe1, 0xd1, 0xdb, 0x63, 0xd8, 0xab, 0xd8,
-    0xe3, 0xdc, 0x90, 0xe1, 0x35, 0xec, 0xf5, 0xfa,
-    0xe0, 0x0a, 0xe9, 0x18, 0x0b, 0x20, 0x67, 0x22,
-    0x46, 0x22, 0x64, 0x22, 0x10, 0x24, 0xef, 0x25,
-    0x1d, 0x24, 0x52, 0x1e, 0xf6, 0x14, 0x91, 0x09,
-    0xaa, 0xff, 0xbc, 0xf5, 0x06, 0xf0, 0x68, 0xee,
-    0x40, 0xee, 0x41, 0xef, 0xed, 0xef, 0xe5, 0xf3,
-    0xb3, 0xfa, 0x0a, 0x04, 0x46, 0x0e, 0xcc, 0x16,
-    0xaf, 0x1b, 0x7e, 0x1b, 0x1f, 0x17, 0x2c, 0x10,
-    0xd7, 0x0b, 0x77, 0x07, 0xdd, 0x03, 0xac, 0x00,
-    0x70, 0xfa, 0x4b, 0xf5, 0x7e, 0xee, 0x32, 0xe8,
-    0x9f, 0xe4, 0xf7, 0xe3, 0xdf, 0xe6, 0x62, 0xeb,
-    0x57, 0xf2, 0x03, 0xf8, 0x7b, 0xfd, 0x9a, 0x02,
-    0x29, 0x06, 0x2e, 0x09, 0xe1, 0x08, 0x69, 0x05,
-    0xe1, 0xfe, 0x8a, 0xf6, 0xb9, 0xec, 0x23, 0xe4,
-    0x30, 0xdd, 0xe8, 0xd6, 0x87, 0xd2, 0xaf, 0xce,
-    0xb9, 0xca, 0x30, 0xc4, 0xdf, 0xc6, 0xab, 0xdb,
-    0x49, 0xfd, 0x5b, 0x21, 0x84, 0x35, 0x82, 0x3d,
-    0xf7, 0x3f, 0x97, 0x38, 0x8e, 0x2b, 0xe1, 0x1e,
-    0x17, 0x1b, 0xbb, 0x1d, 0x13, 0x1d, 0xfa, 0x16,
-    0x12, 0x0d, 0x27, 0x02, 0xe5, 0xf5, 0x73, 0xe8,
-    0x55, 0xe0, 0xe8, 0xde, 0x89, 0xdd, 0x03, 0xdd,
-    0xc4, 0xdf, 0x8e, 0xe6, 0x5f, 0xf2, 0xac, 0xff,
-    0xdb, 0x0b, 0x5b, 0x17, 0x9f, 0x20, 0x2f, 0x23,
-    0x70, 0x22, 0x30, 0x21, 0xac, 0x20, 0xcc, 0x21,
-    0x5a, 0x1e, 0x4d, 0x18, 0x1a, 0x10, 0xbb, 0x07,
-    0xd0, 0x00, 0x07, 0xf7, 0xf5, 0xf0, 0x21, 0xef,
-    0xf8, 0xef, 0x3a, 0xf2, 0xea, 0xf3, 0xfb, 0xf8,
-    0x70, 0x00, 0xf6, 0x09, 0x0b, 0x11, 0x81, 0x15,
-    0x96, 0x19, 0x2c, 0x18, 0x3a, 0x13, 0x0c, 0x0d,
-    0x2d, 0x08, 0xb5, 0x05, 0x62, 0x03, 0x3e, 0x00,
-    0xc0, 0xfb, 0x00, 0xf7, 0x89, 0xf0, 0xd9, 0xe9,
-    0x7f, 0xe5, 0xbc, 0xe4, 0x44, 0xe7, 0xe9, 0xeb,
-    0xad, 0xf2, 0x12, 0xf8, 0xb8, 0xfd, 0x10, 0x03,
-    0x13, 0x06, 0x9f, 0x07, 0xc7, 0x04, 0xbd, 0x00,
-    0x6b, 0xfb, 0x73, 0xf3, 0x79, 0xeb, 0xc0, 0xe3,
-    0xb9, 0xdd, 0xd2, 0xd8, 0xbc, 0xd4, 0x1b, 0xd1,
-    0xe5, 0xcd, 0xd1, 0xc7, 0x08, 0xc6, 0x34, 0xd8,
-    0x52, 0xf9, 0xc2, 0x1e, 0x77, 0x36, 0x8f, 0x3a,
-    0x84, 0x3a, 0x0f, 0x34, 0xf9, 0x29, 0xd2, 0x1f,
-    0x21, 0x19, 0x55, 0x1e, 0xc0, 0x21, 0x8c, 0x1d,
-    0xd5, 0x12, 0xc2, 0x02, 0x03, 0xf5, 0xbc, 0xe8,
-    0x4f, 0xe0, 0x0d, 0xde, 0xcc, 0xde, 0x4b, 0xdf,
-    0xee, 0xe0, 0x21, 0xe6, 0x9b, 0xee, 0x4a, 0xfb,
-    0xb7, 0x07, 0xc0, 0x13, 0xf9, 0x1c, 0xaa, 0x1f,
-    0x2a, 0x20, 0x4d, 0x1f, 0x62, 0x21, 0xb6, 0x23,
-    0xd6, 0x21, 0xe7, 0x1e, 0x95, 0x18, 0x77, 0x10,
-    0xe8, 0x06, 0xce, 0xfa, 0xc0, 0xf2, 0x9a, 0xf0,
-    0x0a, 0xf0, 0x4b, 0xf1, 0x37, 0xf3, 0x9f, 0xf5,
-    0x6b, 0xfc, 0x19, 0x03, 0xd1, 0x09, 0x33, 0x11,
-    0xb5, 0x14, 0xb5, 0x14, 0x99, 0x10, 0x37, 0x0c,
-    0x68, 0x09, 0xab, 0x07, 0xa9, 0x06, 0xd3, 0x04,
-    0x3b, 0x02, 0x85, 0xfc, 0xff, 0xf4, 0x7a, 0xec,
-    0x86, 0xe6, 0xb2, 0xe4, 0x99, 0xe5, 0x0a, 0xeb,
-    0x73, 0xf0, 0x15, 0xf6, 0xe1, 0xfa, 0x25, 0xfe,
-    0x44, 0x01, 0x6f, 0x01, 0x59, 0x01, 0x0f, 0xff,
-    0x5c, 0xfb, 0x8a, 0xf6, 0x08, 0xef, 0xdc, 0xe8,
-    0xff, 0xe1, 0x7b, 0xdc, 0xe4, 0xd8, 0x17, 0xd4,
-    0x9f, 0xce, 0xe0, 0xc5, 0x7f, 0xc1, 0x42, 0xcf,
-    0xc0, 0xed, 0x3b, 0x14, 0xa6, 0x32, 0x69, 0x3c,
-    0x19, 0x3b, 0x85, 0x31, 0x0e, 0x23, 0x03, 0x19,
-    0x51, 0x13, 0xe3, 0x19, 0x30, 0x24, 0x21, 0x26,
-    0x14, 0x22, 0x93, 0x13, 0x72, 0x02, 0x9d, 0xf2,
-    0x5d, 0xe3, 0x17, 0xde, 0x54, 0xdd, 0x25, 0xdd,
-    0x05, 0xe0, 0xb3, 0xe3, 0x79, 0xeb, 0x06, 0xf6,
-    0x4d, 0x00, 0xbd, 0x0a, 0x57, 0x13, 0xe5, 0x17,
-    0xb0, 0x18, 0x00, 0x1a, 0xd4, 0x1c, 0x62, 0x21,
-    0xb9, 0x24, 0x5d, 0x24, 0xa3, 0x21, 0xc8, 0x19,
-    0x56, 0x0f, 0xc7, 0x03, 0xc3, 0xfa, 0x8a, 0xf6,
-    0x5d, 0xf4, 0x72, 0xf4, 0x74, 0xf3, 0xa5, 0xf4,
-    0xab, 0xf6, 0x0b, 0xfb, 0x31, 0x03, 0xcc, 0x08,
-    0x36, 0x0e, 0x93, 0x0e, 0xed, 0x0c, 0xd0, 0x0b,
-    0xdf, 0x08, 0xf8, 0x07, 0xa5, 0x07, 0x52, 0x08,
-    0xe2, 0x06, 0x80, 0x03, 0x18, 0xfc, 0x8a, 0xf3,
-    0x3a, 0xed, 0x5c, 0xe7, 0x5e, 0xe8, 0x48, 0xea,
-    0xcc, 0xed, 0xb0, 0xf2, 0xbf, 0xf5, 0xaa, 0xf9,
-    0xa4, 0xfa, 0x9d, 0xfb, 0x45, 0xfb, 0xf0, 0xfa,
-    0x2f, 0xfa, 0x99, 0xf8, 0xfb, 0xf5, 0x9d, 0xee,
-    0x70, 0xe7, 0x8d, 0xe0, 0xb5, 0xdb, 0x95, 0xd7,
-    0x10, 0xd4, 0x6e, 0xd0, 0xf7, 0xcc, 0x41, 0xca,
-    0x9a, 0xcf, 0xa5, 0xed, 0xe3, 0x11, 0xa2, 0x2f,
-    0xad, 0x38, 0x8c, 0x2e, 0x67, 0x2a, 0xb6, 0x1f,
-    0x3c, 0x18, 0x46, 0x15, 0xc2, 0x18, 0xc8, 0x26,
-    0xa2, 0x26, 0x3d, 0x21, 0x1a, 0x16, 0x4f, 0x08,
-    0xbf, 0xfa, 0x66, 0xe9, 0xe9, 0xe1, 0x15, 0xe1,
-    0x85, 0xe3, 0x2d, 0xe3, 0x0f, 0xe5, 0x95, 0xec,
-    0x26, 0xf6, 0x99, 0xff, 0x7b, 0x03, 0xfd, 0x09,
-    0x8c, 0x0d, 0x3c, 0x10, 0xe5, 0x13, 0xa2, 0x16,
-    0x02, 0x1f, 0x92, 0x23, 0xd9, 0x24, 0x6c, 0x23,
-    0x16, 0x1e, 0xe2, 0x15, 0x1e, 0x0a, 0x1d, 0x00,
-    0x73, 0xfc, 0xee, 0xfd, 0x3a, 0xfc, 0x5b, 0xf8,
-    0xcf, 0xf4, 0xc5, 0xf6, 0x24, 0xfc, 0xe7, 0xfd,
-    0x8d, 0x01, 0x0a, 0x05, 0x95, 0x08, 0x5c, 0x09,
-    0xb5, 0x07, 0x34, 0x09, 0xcb, 0x0a, 0x41, 0x0b,
-    0xde, 0x08, 0xab, 0x07, 0x61, 0x06, 0x0b, 0x01,
-    0xd7, 0xf8, 0x44, 0xf1, 0xca, 0xee, 0x20, 0xee,
-    0x0f, 0xef, 0x19, 0xf0, 0x31, 0xf2, 0x61, 0xf5,
-    0x68, 0xf5, 0xa6, 0xf5, 0xb9, 0xf6, 0x32, 0xf8,
-    0x4d, 0xf8, 0x7b, 0xf6, 0x16, 0xf4, 0x07, 0xf2,
-    0x8e, 0xf0, 0xa0, 0xeb, 0x0e, 0xe6, 0xd2, 0xe0,
-    0xef, 0xdb, 0xdd, 0xd9, 0xb1, 0xd5, 0x52, 0xd0,
-    0xed, 0xca, 0x96, 0xcc, 0x52, 0xe2, 0xfb, 0x04,
-    0x05, 0x27, 0xc0, 0x37, 0xc3, 0x33, 0x5b, 0x2a,
-    0x3d, 0x1d, 0x4f, 0x12, 0x6b, 0x0d, 0x56, 0x12,
-    0x1a, 0x23, 0xd4, 0x2c, 0x1a, 0x2c, 0x4b, 0x21,
-    0xe7, 0x10, 0x8b, 0x02, 0x8a, 0xf0, 0xe0, 0xe3,
-    0xaf, 0xe0, 0x73, 0xe2, 0x9c, 0xe6, 0x63, 0xe8,
-    0x70, 0xea, 0x80, 0xf0, 0x96, 0xf8, 0x75, 0xff,
-    0xbd, 0x05, 0xa7, 0x09, 0x3f, 0x0d, 0x9e, 0x10,
-    0x9b, 0x13, 0xd5, 0x1a, 0x37, 0x22, 0x9b, 0x27,
-    0xc7, 0x27, 0x65, 0x22, 0x15, 0x1b, 0x76, 0x12,
-    0x77, 0x09, 0xc6, 0x01, 0x77, 0xff, 0xf2, 0xfe,
-    0x11, 0xfe, 0x51, 0xfb, 0xd7, 0xf6, 0xbb, 0xf5,
-    0x69, 0xf7, 0xbc, 0xfc, 0xfe, 0x01, 0xa9, 0x05,
-    0xc4, 0x06, 0x53, 0x05, 0xea, 0x05, 0x41, 0x06,
-    0xed, 0x07, 0x73, 0x0a, 0x22, 0x0c, 0x91, 0x0b,
-    0x75, 0x07, 0x4f, 0x01, 0xfc, 0xf9, 0x2c, 0xf5,
-    0x43, 0xf2, 0xa5, 0xf2, 0x4b, 0xf4, 0x88, 0xf3,
-    0x94, 0xf2, 0x07, 0xf0, 0xcf, 0xef, 0x16, 0xf1,
-    0x64, 0xf2, 0xc1, 0xf5, 0xda, 0xf6, 0x42, 0xf6,
-    0xa6, 0xf5, 0x9d, 0xf4, 0x7b, 0xf3, 0xb2, 0xf0,
-    0xed, 0xeb, 0x59, 0xe6, 0xb0, 0xdf, 0xa3, 0xda,
-    0x13, 0xd7, 0x22, 0xd5, 0xfb, 0xd1, 0x84, 0xcd,
-    0xc9, 0xd8, 0x04, 0xf5, 0xff, 0x16, 0xda, 0x2e,
-    0x8b, 0x2d, 0x9a, 0x24, 0x12, 0x1b, 0x82, 0x12,
-    0x2d, 0x11, 0x80, 0x12, 0xe6, 0x1e, 0xb1, 0x2b,
-    0x0d, 0x2e, 0x3f, 0x29, 0x15, 0x1c, 0xff, 0x0b,
-    0x48, 0xfa, 0x47, 0xeb, 0x82, 0xe5, 0x30, 0xe8,
-    0x55, 0xec, 0x0a, 0xed, 0x2f, 0xef, 0x8c, 0xf0,
-    0xe7, 0xf2, 0xdb, 0xf5, 0xcf, 0xf8, 0xc4, 0xff,
-    0x93, 0x03, 0x3f, 0x07, 0x7d, 0x0c, 0xcc, 0x15,
-    0xc4, 0x21, 0x5c, 0x27, 0xfa, 0x27, 0xf5, 0x23,
-    0xf3, 0x1d, 0x39, 0x17, 0xcd, 0x0f, 0x7e, 0x0b,
-    0x9f, 0x09, 0xdb, 0x09, 0x25, 0x07, 0x39, 0x01,
-    0x05, 0xfb, 0xf0, 0xf5, 0x0a, 0xf5, 0xa3, 0xf6,
-    0xe5, 0xfb, 0xca, 0x00, 0x71, 0x04, 0x11, 0x04,
-    0x42, 0x01, 0x6a, 0x02, 0x3f, 0x04, 0x41, 0x07,
-    0x76, 0x08, 0x57, 0x08, 0x97, 0x08, 0x02, 0x05,
-    0xf4, 0xff, 0xf9, 0xfa, 0x08, 0xf8, 0xfc, 0xf7,
-    0x6f, 0xf7, 0xca, 0xf6, 0x7e, 0xf6, 0x89, 0xf4,
-    0x96, 0xf0, 0xfa, 0xee, 0x1b, 0xee, 0x5a, 0xef,
-    0x02, 0xf2, 0x7f, 0xf1, 0xc0, 0xf2, 0x4d, 0xf3,
-    0xfe, 0xf2, 0x8c, 0xf3, 0xa5, 0xf0, 0xa3, 0xec,
-    0x28, 0xe8, 0xa5, 0xe1, 0xf2, 0xdc, 0x4a, 0xd9,
-    0xc8, 0xd7, 0xd3, 0xd8, 0xdf, 0xd7, 0x9f, 0xdb,
-    0x11, 0xed, 0xa2, 0x07, 0x75, 0x1f, 0xfe, 0x28,
-    0x6c, 0x21, 0xa6, 0x19, 0xcb, 0x15, 0x9a, 0x12,
-    0xce, 0x15, 0xdc, 0x1a, 0x6e, 0x24, 0x12, 0x2c,
-    0x57, 0x28, 0x08, 0x21, 0xf2, 0x13, 0x71, 0x06,
-    0x30, 0xf9, 0x81, 0xec, 0xcc, 0xe9, 0x2b, 0xea,
-    0x4c, 0xee, 0x36, 0xf1, 0x0b, 0xf2, 0x47, 0xf4,
-    0xff, 0xf4, 0xca, 0xf6, 0x8c, 0xf8, 0xcc, 0xfc,
-    0x74, 0x02, 0xe6, 0x08, 0xf7, 0x10, 0x3d, 0x19,
-    0xcc, 0x22, 0xb6, 0x27, 0x26, 0x27, 0x2e, 0x23,
-    0x06, 0x1b, 0x3c, 0x14, 0xbf, 0x0d, 0xed, 0x08,
-    0xce, 0x09, 0x86, 0x0b, 0x74, 0x0a, 0xda, 0x06,
-    0x2f, 0xfe, 0xcf, 0xf6, 0xfa, 0xf3, 0xaf, 0xf3,
-    0x42, 0xf8, 0xfe, 0xfb, 0xbd, 0xfe, 0x0e, 0x01,
-    0x3f, 0x03, 0x69, 0x06, 0xb6, 0x07, 0xa6, 0x06,
-    0x3e, 0x04, 0xe7, 0x01, 0x6c, 0x00, 0xe4, 0x00,
-    0xd5, 0x00, 0x81, 0x00, 0xe2, 0xff, 0x5e, 0xfc,
-    0xa4, 0xf9, 0x81, 0xf5, 0xd3, 0xf0, 0xb1, 0xed,
-    0xc8, 0xea, 0x27, 0xec, 0xc4, 0xed, 0xa8, 0xef,
-    0x1a, 0xf2, 0xc6, 0xf1, 0x1f, 0xf2, 0x51, 0xf1,
-    0x75, 0xef, 0xa4, 0xef, 0x44, 0xee, 0xb9, 0xea,
-    0x4a, 0xe9, 0x3e, 0xe6, 0xe8, 0xe3, 0xd3, 0xe2,
-    0x26, 0xde, 0x33, 0xdc, 0xb2, 0xd8, 0xeb, 0xd7,
-    0xc5, 0xe5, 0x0d, 0xfb, 0xd7, 0x14, 0x23, 0x24,
-    0xa8, 0x1f, 0x28, 0x19, 0x92, 0x0f, 0x87, 0x0c,
-    0x12, 0x14, 0x3f, 0x1b, 0x84, 0x28, 0x69, 0x2f,
-    0xef, 0x2b, 0xe2, 0x23, 0x8f, 0x14, 0xd2, 0x06,
-    0xed, 0xfa, 0xa2, 0xf3, 0x8c, 0xf2, 0x05, 0xf4,
-    0x61, 0xf7, 0x4c, 0xf6, 0x99, 0xf4, 0xef, 0xf0,
-    0x8a, 0xef, 0xf1, 0xf0, 0xb4, 0xf2, 0x4a, 0xf9,
-    0xae, 0xff, 0xa5, 0x08, 0x50, 0x11, 0xc0, 0x17,
-    0x2f, 0x1f, 0x4b, 0x22, 0xc3, 0x21, 0xb5, 0x1d,
-    0x2d, 0x18, 0xb4, 0x15, 0x40, 0x15, 0x99, 0x16,
-    0xd2, 0x16, 0x5e, 0x14, 0x62, 0x0d, 0xa1, 0x04,
-    0x03, 0xfb, 0xcd, 0xf3, 0xc1, 0xf2, 0x57, 0xf5,
-    0x5b, 0xfb, 0xbf, 0xfe, 0x2c, 0xfd, 0xaf, 0xfb,
-    0x12, 0xfb, 0x8a, 0xfc, 0x40, 0xff, 0xe9, 0x00,
-    0x39, 0x03, 0xc1, 0x04, 0x02, 0x05, 0x61, 0x04,
-    0x1e, 0x03, 0xcc, 0x01, 0x03, 0x00, 0x11, 0xfd,
-    0xe2, 0xf9, 0x7e, 0xf6, 0x34, 0xf3, 0xf7, 0xf0,
-    0xaa, 0xef, 0x28, 0xef, 0x08, 0xf0, 0x42, 0xf0,
-    0xa6, 0xef, 0xd9, 0xee, 0x51, 0xee, 0x1c, 0xee,
-    0x0c, 0xef, 0x90, 0xf1, 0xad, 0xf3, 0xbd, 0xf4,
-    0x77, 0xf0, 0x4e, 0xeb, 0x99, 0xe6, 0xb0, 0xe1,
-    0x33, 0xdf, 0x29, 0xdb, 0xfa, 0xd9, 0x03, 0xd8,
-    0x52, 0xd5, 0xf9, 0xe0, 0x74, 0xf6, 0xe5, 0x10,
-    0x9b, 0x20, 0xc8, 0x1d, 0xde, 0x17, 0x83, 0x12,
-    0x73, 0x0f, 0xdf, 0x10, 0x18, 0x19, 0x8a, 0x26,
-    0xc7, 0x31, 0x7e, 0x30, 0x6c, 0x26, 0xef, 0x1a,
-    0x02, 0x0d, 0x51, 0x01, 0x63, 0xf8, 0x5e, 0xf5,
-    0x46, 0xf9, 0x40, 0xf8, 0x5e, 0xf6, 0x3c, 0xf4,
-    0x34, 0xf2, 0x69, 0xf3, 0xe9, 0xf1, 0xa2, 0xf1,
-    0xd0, 0xf4, 0x9b, 0xfa, 0x49, 0x02, 0xcb, 0x0b,
-    0x84, 0x14, 0xa6, 0x1b, 0x0b, 0x20, 0xf5, 0x1e,
-    0x5f, 0x1c, 0xa4, 0x1a, 0xa2, 0x18, 0xa4, 0x18,
-    0xa5, 0x17, 0x2e, 0x16, 0xfd, 0x14, 0x56, 0x0f,
-    0x8c, 0x07, 0xcd, 0xfe, 0x2d, 0xf8, 0x31, 0xf7,
-    0x66, 0xf9, 0xcf, 0xfc, 0x1a, 0xfe, 0x2b, 0xfc,
-    0x4b, 0xfa, 0x99, 0xf9, 0x4b, 0xfb, 0x60, 0xfd,
-    0x5d, 0xfe, 0x0e, 0x00, 0x48, 0x01, 0xb6, 0x01,
-    0xee, 0x01, 0x76, 0x01, 0x6b, 0x00, 0x6e, 0xff,
-    0xd7, 0xfc, 0x69, 0xfa, 0x75, 0xf9, 0x66, 0xf7,
-    0x18, 0xf6, 0xbd, 0xf4, 0x99, 0xf3, 0x71, 0xf3,
-    0x38, 0xf2, 0x38, 0xf0, 0x1f, 0xf0, 0x3d, 0xf1,
-    0x8f, 0xf2, 0xb1, 0xf1, 0x66, 0xef, 0xbf, 0xee,
-    0x0e, 0xf0, 0x60, 0xf0, 0x8b, 0xec, 0xf1, 0xe8,
-    0xb4, 0xe4, 0x37, 0xe1, 0xd1, 0xde, 0x3e, 0xdb,
-    0xe3, 0xd9, 0x08, 0xd9, 0xd1, 0xd7, 0x73, 0xe2,
-    0x8a, 0xf8, 0xb5, 0x10, 0x5f, 0x20, 0x91, 0x1f,
-    0x13, 0x17, 0x92, 0x12, 0xff, 0x0f, 0xa2, 0x11,
-    0xa3, 0x1b, 0x92, 0x26, 0x41, 0x31, 0x6e, 0x30,
-    0x24, 0x26, 0x94, 0x1a, 0x6b, 0x0d, 0x73, 0x02,
-    0x69, 0xfa, 0x69, 0xf8, 0x06, 0xfc, 0x69, 0xfc,
-    0x5d, 0xf9, 0xf7, 0xf4, 0x71, 0xf2, 0x26, 0xf3,
-    0x50, 0xf2, 0xf3, 0xf1, 0x4e, 0xf4, 0xd3, 0xfa,
-    0xe6, 0x01, 0x29, 0x0a, 0xa3, 0x11, 0x64, 0x18,
-    0x93, 0x1c, 0xfe, 0x1a, 0x0a, 0x18, 0x5e, 0x17,
-    0x1d, 0x17, 0x46, 0x16, 0x2d, 0x15, 0x99, 0x14,
-    0x01, 0x17, 0xf0, 0x13, 0xb2, 0x0b, 0xdf, 0x02,
-    0x35, 0xfd, 0x99, 0xfc, 0xeb, 0xfc, 0x9a, 0xfd,
-    0x42, 0xff, 0xca, 0xfe, 0x72, 0xfc, 0x8e, 0xf9,
-    0xaf, 0xf9, 0x31, 0xfc, 0x77, 0xfc, 0x16, 0xfc,
-    0x8e, 0xfb, 0xa9, 0xfd, 0x58, 0xfe, 0x2a, 0xfe,
-    0x05, 0xfd, 0xc7, 0xfc, 0xdd, 0xfd, 0xe2, 0xfc,
-    0x12, 0xfc, 0x17, 0xfa, 0xb7, 0xf7, 0x81, 0xf6,
-    0x59, 0xf5, 0x24, 0xf5, 0x18, 0xf6, 0x35, 0xf5,
-    0x5a, 0xf5, 0xd0, 0xf3, 0xf6, 0xf3, 0x93, 0xf4,
-    0x27, 0xf4, 0x9e, 0xf3, 0xc1, 0xf2, 0x69, 0xf2,
-    0x86, 0xf0, 0xd6, 0xeb, 0x5f, 0xe6, 0x29, 0xe3,
-    0x61, 0xe0, 0x52, 0xde, 0xbf, 0xdb, 0xa4, 0xd9,
-    0x05, 0xd6, 0x5a, 0xd3, 0x21, 0xd6, 0xa3, 0xe8,
-    0x7d, 0x01, 0x5d, 0x17, 0x2b, 0x22, 0xec, 0x1d,
-    0x4b, 0x18, 0x81, 0x11, 0x57, 0x0f, 0xcb, 0x18,
-    0xd3, 0x24, 0x71, 0x2f, 0x81, 0x34, 0x69, 0x2e,
-    0x8f, 0x26, 0x8f, 0x1a, 0xdb, 0x0c, 0x7e, 0x01,
-    0x2c, 0xfd, 0xd2, 0xfb, 0x6e, 0xfd, 0x7d, 0xfd,
-    0xf8, 0xf8, 0xac, 0xf6, 0xb5, 0xf2, 0x37, 0xf0,
-    0xd9, 0xef, 0xa2, 0xef, 0x37, 0xf2, 0x84, 0xf7,
-    0xd3, 0xfe, 0x39, 0x09, 0x55, 0x11, 0x50, 0x18,
-    0x40, 0x18, 0xd6, 0x15, 0x6a, 0x13, 0x43, 0x12,
-    0x90, 0x14, 0x49, 0x17, 0x00, 0x19, 0x40, 0x1a,
-    0x00, 0x19, 0xf8, 0x12, 0x4e, 0x0c, 0xb6, 0x03,
-    0xc8, 0xfe, 0x9f, 0xfe, 0x78, 0x00, 0xda, 0x02,
-    0x6d, 0x03, 0x30, 0x00, 0x41, 0xfd, 0xec, 0xf9,
-    0x9e, 0xf8, 0x01, 0xf8, 0xf0, 0xf7, 0x3f, 0xf8,
-    0xd7, 0xf8, 0x99, 0xfa, 0x0b, 0xfb, 0x6f, 0xfb,
-    0x8d, 0xfa, 0x40, 0xfa, 0xca, 0xf9, 0x95, 0xf9,
-    0xe5, 0xf9, 0x61, 0xfa, 0x00, 0xfb, 0x2a, 0xfb,
-    0x5b, 0xfa, 0x00, 0xfb, 0x57, 0xfa, 0x8b, 0xf9,
-    0xdc, 0xf8, 0x8f, 0xf7, 0xfe, 0xf7, 0x17, 0xf8,
-    0x67, 0xf7, 0x3f, 0xf7, 0x32, 0xf5, 0x9e, 0xf2,
-    0x4c, 0xf1, 0xf7, 0xed, 0xee, 0xea, 0x9a, 0xe6,
-    0xf7, 0xe1, 0x3d, 0xe0, 0xeb, 0xdd, 0x21, 0xdb,
-    0x0b, 0xd9, 0xc2, 0xd5, 0x14, 0xd4, 0x80, 0xd7,
-    0x56, 0xe4, 0x73, 0xfa, 0xed, 0x10, 0x8e, 0x1c,
-    0xa4, 0x1d, 0xf3, 0x18, 0xd6, 0x13, 0xa8, 0x13,
-    0x6a, 0x17, 0xa1, 0x21, 0x9d, 0x2e, 0x2e, 0x35,
-    0x65, 0x34, 0xcf, 0x2a, 0xdd, 0x1c, 0xe0, 0x10,
-    0x1b, 0x05, 0xda, 0xff, 0x9a, 0x00, 0xa3, 0x01,
-    0x49, 0x02, 0xbf, 0xfe, 0xdb, 0xf7, 0x1d, 0xf3,
-    0xb4, 0xed, 0xe1, 0xe9, 0x47, 0xeb, 0x20, 0xef,
-    0xbf, 0xf5, 0xfa, 0xfc, 0x9f, 0x02, 0x95, 0x08,
-    0xe0, 0x0d, 0x85, 0x0e, 0x65, 0x0e, 0xf6, 0x0e,
-    0xc2, 0x10, 0x1e, 0x14, 0x1a, 0x16, 0x43, 0x18,
-    0x4b, 0x1b, 0x15, 0x1b, 0x13, 0x17, 0x7b, 0x0f,
-    0xe8, 0x07, 0x80, 0x04, 0xa3, 0x03, 0x2b, 0x06,
-    0xed, 0x07, 0x9c, 0x06, 0xc4, 0x02, 0x02, 0xfe,
-    0xb0, 0xf9, 0xb0, 0xf7, 0x30, 0xf6, 0x67, 0xf5,
-    0xec, 0xf6, 0x3e, 0xf7, 0x32, 0xf7, 0x78, 0xf7,
-    0xac, 0xf6, 0x64, 0xf6, 0xe6, 0xf6, 0x70, 0xf6,
-    0xb8, 0xf8, 0xdc, 0xf9, 0x81, 0xfa, 0xd3, 0xfb,
-    0x66, 0xfc, 0x42, 0xfd, 0x49, 0xfd, 0x08, 0xfc,
-    0x57, 0xfc, 0xfc, 0xfb, 0xde, 0xfb, 0x26, 0xfc,
-    0x1e, 0xfb, 0xa1, 0xfc, 0xf2, 0xfb, 0x72, 0xfa,
-    0x23, 0xf7, 0xe1, 0xf2, 0x53, 0xef, 0xc4, 0xec,
-    0x8c, 0xe9, 0x11, 0xe6, 0x67, 0xe3, 0xcd, 0xdf,
-    0xfa, 0xdc, 0xe0, 0xda, 0x24, 0xd7, 0xa5, 0xd5,
-    0xf1, 0xd2, 0xa1, 0xd4, 0xd1, 0xe2, 0xae, 0xf5,
-    0x4d, 0x0d, 0xcb, 0x19, 0x3d, 0x1a, 0xac, 0x16,
-    0xb3, 0x10, 0x83, 0x11, 0x0e, 0x19, 0xa1, 0x23,
-    0x71, 0x30, 0xf4, 0x37, 0xc3, 0x36, 0x3a, 0x2f,
-    0x49, 0x23, 0xcb, 0x15, 0x80, 0x0c, 0xee, 0x06,
-    0xc8, 0x04, 0xc0, 0x07, 0x49, 0x05, 0xce, 0x01,
-    0xf5, 0xfa, 0x83, 0xf2, 0xa3, 0xee, 0x17, 0xea,
-    0xd5, 0xe8, 0xa1, 0xeb, 0x35, 0xf0, 0xe7, 0xf7,
-    0x82, 0xfd, 0xfa, 0x00, 0xf8, 0x04, 0x72, 0x07,
-    0x5a, 0x08, 0xe6, 0x08, 0x22, 0x0a, 0xd0, 0x0d,
-    0x6c, 0x14, 0x65, 0x17, 0x2a, 0x1a, 0x29, 0x1b,
-    0xb3, 0x17, 0x99, 0x13, 0x97, 0x0b, 0xc6, 0x06,
-    0xe4, 0x07, 0xab, 0x09, 0x7a, 0x0c, 0x3e, 0x0b,
-    0x02, 0x07, 0xe4, 0x02, 0xe2, 0xfc, 0x07, 0xf9,
-    0xd0, 0xf6, 0xc8, 0xf5, 0x8d, 0xf6, 0x48, 0xf6,
-    0x35, 0xf6, 0x32, 0xf6, 0xbe, 0xf5, 0x9d, 0xf4,
-    0xdf, 0xf3, 0xca, 0xf3, 0x33, 0xf5, 0xf1, 0xf7,
-    0x96, 0xf9, 0xf2, 0xfa, 0x78, 0xfc, 0x78, 0xfd,
-    0x53, 0xfe, 0x51, 0xfe, 0x10, 0xfe, 0xda, 0xfe,
-    0xb9, 0xff, 0x3b, 0x00, 0xe6, 0xff, 0x81, 0x00,
-    0xbb, 0xff, 0xd3, 0xfd, 0xa5, 0xfb, 0x18, 0xf8,
-    0x57, 0xf5, 0x86, 0xf2, 0x02, 0xef, 0xb3, 0xec,
-    0x66, 0xe9, 0xdd, 0xe2, 0x17, 0xde, 0x73, 0xda,
-    0x43, 0xd9, 0xd8, 0xd9, 0xf8, 0xd7, 0x3d, 0xd7,
-    0x1b, 0xd7, 0x57, 0xd8, 0x30, 0xe2, 0x0f, 0xf4,
-    0x1b, 0x0b, 0x54, 0x1c, 0xc6, 0x1e, 0x56, 0x19,
-    0x5f, 0x11, 0x24, 0x10, 0x20, 0x17, 0x22, 0x24,
-    0xdd, 0x32, 0x0b, 0x3c, 0xaa, 0x39, 0x81, 0x2e,
-    0x14, 0x21, 0x16, 0x14, 0x62, 0x0c, 0x2b, 0x08,
-    0x08, 0x07, 0x12, 0x0a, 0x5f, 0x09, 0xcb, 0x03,
-    0x88, 0xfb, 0x27, 0xf0, 0x43, 0xeb, 0xd4, 0xe8,
-    0x9d, 0xe8, 0x81, 0xeb, 0xf1, 0xee, 0x75, 0xf4,
-    0xaf, 0xfa, 0x59, 0xfe, 0x6b, 0x01, 0xb4, 0x04,
-    0xd4, 0x04, 0x6e, 0x06, 0x54, 0x08, 0x45, 0x0c,
-    0x4f, 0x13, 0xec, 0x17, 0x77, 0x1a, 0xe7, 0x1c,
-    0x3d, 0x19, 0x64, 0x13, 0x72, 0x0b, 0x0e, 0x07,
-    0xe3, 0x0a, 0xe6, 0x0f, 0xbd, 0x11, 0x24, 0x0e,
-    0x44, 0x07, 0xed, 0xff, 0x5e, 0xfb, 0x0c, 0xf8,
-    0xaf, 0xf8, 0x67, 0xf9, 0xcf, 0xf8, 0x9b, 0xf6,
-    0x75, 0xf4, 0x37, 0xf3, 0xd0, 0xf2, 0x53, 0xf1,
-    0xdc, 0xf1, 0xe6, 0xf4, 0xcd, 0xf8, 0x1a, 0xfc,
-    0xe7, 0xfb, 0x93, 0xfc, 0xcb, 0xfc, 0xca, 0xfe,
-    0xb9, 0xff, 0xc6, 0x00, 0x16, 0x01, 0xc7, 0x00,
-    0xff, 0xff, 0xea, 0x00, 0x85, 0x01, 0xa8, 0x02,
-    0x59, 0x01, 0x14, 0xff, 0x66, 0xfd, 0xed, 0xfa,
-    0x39, 0xf9, 0x50, 0xf5, 0x0a, 0xf3, 0x70, 0xef,
-    0x24, 0xed, 0x85, 0xe9, 0xef, 0xe4, 0x06, 0xe0,
-    0xc0, 0xdc, 0x71, 0xda, 0x84, 0xda, 0xb5, 0xd9,
-    0xea, 0xd8, 0x17, 0xd7, 0xa8, 0xd7, 0x43, 0xdb,
-    0x69, 0xe7, 0x53, 0xfc, 0xcb, 0x0e, 0xbd, 0x1d,
-    0xb4, 0x1c, 0xa3, 0x15, 0x95, 0x11, 0xa1, 0x12,
-    0x15, 0x1e, 0x2e, 0x2d, 0xf0, 0x36, 0x1b, 0x3d,
-    0x0c, 0x37, 0x06, 0x2b, 0x0b, 0x1d, 0xd4, 0x10,
-    0x37, 0x0b, 0xb1, 0x0b, 0xc6, 0x0d, 0x8d, 0x0d,
-    0x7a, 0x0a, 0x3b, 0xff, 0xb2, 0xf4, 0x96, 0xea,
-    0x5a, 0xe5, 0x7e, 0xe7, 0x19, 0xea, 0x5b, 0xed,
-    0x67, 0xf2, 0xbf, 0xf4, 0xd9, 0xf9, 0xde, 0xfb,
-    0xf1, 0xfc, 0x53, 0x00, 0x69, 0x03, 0x90, 0x07,
-    0xaa, 0x0b, 0x12, 0x10, 0xe2, 0x13, 0xc0, 0x17,
-    0xad, 0x17, 0x03, 0x17, 0x7c, 0x15, 0xfc, 0x11,
-    0x69, 0x0e, 0xb7, 0x0b, 0x50, 0x0b, 0x4d, 0x0f,
-    0x84, 0x10, 0x58, 0x0e, 0x4f, 0x08, 0xa5, 0x00,
-    0x52, 0xfc, 0x6e, 0xf9, 0x39, 0xf9, 0xdd, 0xf9,
-    0x78, 0xfa, 0x73, 0xf9, 0x12, 0xf7, 0x19, 0xf4,
-    0xc3, 0xf2, 0x2e, 0xf3, 0xda, 0xf4, 0x02, 0xf8,
-    0x62, 0xfc, 0xf9, 0xfe, 0xa0, 0xff, 0xb2, 0xfd,
-    0x75, 0xfc, 0x42, 0xfe, 0xa3, 0xff, 0x46, 0x01,
-    0x41, 0x01, 0x4e, 0x01, 0xa0, 0x01, 0xd4, 0x00,
-    0x69, 0x00, 0xd2, 0x00, 0x19, 0x01, 0xad, 0x00,
-    0x07, 0xff, 0x9d, 0xfd, 0xb4, 0xfc, 0x12, 0xfa,
-    0x80, 0xf5, 0xaf, 0xf0, 0x8a, 0xed, 0x2a, 0xeb,
-    0x8f, 0xe8, 0x79, 0xe4, 0xfe, 0xe0, 0xff, 0xde,
-    0x15, 0xdd, 0x2b, 0xdb, 0x05, 0xda, 0x03, 0xd9,
-    0x38, 0xd8, 0xb0, 0xd6, 0x0e, 0xd6, 0xbc, 0xde,
-    0x94, 0xf0, 0xe7, 0x07, 0x65, 0x1a, 0x7f, 0x1f,
-    0x0c, 0x1b, 0xfd, 0x13, 0x21, 0x11, 0x85, 0x17,
-    0x3b, 0x24, 0xb9, 0x32, 0xb8, 0x3c, 0xdf, 0x3b,
-    0x9e, 0x32, 0xc5, 0x25, 0x69, 0x18, 0xa8, 0x0e,
-    0x7c, 0x0a, 0x74, 0x0a, 0xc2, 0x0e, 0x31, 0x0d,
-    0x25, 0x05, 0x92, 0xfa, 0x91, 0xef, 0x2d, 0xea,
-    0xce, 0xe7, 0x19, 0xe8, 0x3e, 0xec, 0x4e, 0xf0,
-    0x71, 0xf3, 0x0f, 0xf6, 0xe7, 0xf7, 0xea, 0xfa,
-    0x86, 0xfd, 0x0c, 0x00, 0x41, 0x03, 0x06, 0x08,
-    0x5d, 0x0c, 0x0e, 0x11, 0x21, 0x14, 0x3a, 0x16,
-    0x3b, 0x17, 0x51, 0x15, 0x52, 0x13, 0x88, 0x0f,
-    0x3b, 0x0d, 0x05, 0x0d, 0x0f, 0x0e, 0x4e, 0x10,
-    0x0b, 0x10, 0x2b, 0x0c, 0x58, 0x06, 0xe7, 0xfe,
-    0xca, 0xfa, 0x02, 0xfa, 0x13, 0xfc, 0x41, 0xfe,
-    0x00, 0xfe, 0x1e, 0xfb, 0xd6, 0xf6, 0x57, 0xf3,
-    0x93, 0xf1, 0x71, 0xf4, 0x30, 0xf9, 0x77, 0xfe,
-    0xe2, 0x00, 0x8f, 0xff, 0xeb, 0xfd, 0xa2, 0xfc,
-    0x37, 0xfd, 0x65, 0xff, 0x36, 0x01, 0x13, 0x03,
-    0xe6, 0x02, 0x7a, 0x01, 0x0a, 0x00, 0x66, 0xff,
-    0x63, 0x00, 0x1c, 0x01, 0x78, 0x01, 0x38, 0x00,
-    0x1d, 0xff, 0xfb, 0xfd, 0x88, 0xfc, 0x0c, 0xfb,
-    0x41, 0xf7, 0x97, 0xf3, 0xbb, 0xee, 0x94, 0xea,
-    0xf7, 0xe7, 0xd6, 0xe5, 0x92, 0xe4, 0xa0, 0xe2,
-    0x0f, 0xe0, 0x28, 0xde, 0x0a, 0xdb, 0x66, 0xd8,
-    0x68, 0xd6, 0x51, 0xd6, 0x25, 0xd7, 0x15, 0xd8,
-    0x8b, 0xdd, 0x78, 0xeb, 0x9c, 0x01, 0x97, 0x13,
-    0x22, 0x1b, 0xa0, 0x16, 0xcd, 0x10, 0xab, 0x10,
-    0x95, 0x16, 0xac, 0x22, 0xad, 0x30, 0x61, 0x3a,
-    0xcc, 0x3b, 0x4e, 0x31, 0x13, 0x24, 0x5f, 0x19,
-    0x56, 0x12, 0xd9, 0x0f, 0xfd, 0x0e, 0x11, 0x11,
-    0x0d, 0x10, 0x30, 0x09, 0x5c, 0xfc, 0xe6, 0xf0,
-    0xd6, 0xe9, 0x50, 0xe8, 0x7d, 0xea, 0x86, 0xee,
-    0xf4, 0xf2, 0x65, 0xf5, 0x65, 0xf4, 0x78, 0xf4,
-    0x8f, 0xf5, 0x54, 0xf9, 0x97, 0xfd, 0xf3, 0x00,
-    0x8b, 0x06, 0x7f, 0x0a, 0x08, 0x0f, 0xfb, 0x10,
-    0x97, 0x12, 0xbb, 0x13, 0x30, 0x13, 0xc1, 0x10,
-    0x2f, 0x0d, 0xfd, 0x0a, 0x0e, 0x0d, 0x48, 0x11,
-    0xd5, 0x14, 0xf5, 0x12, 0x9e, 0x0b, 0xf2, 0x02,
-    0x17, 0xfc, 0x32, 0xfb, 0x42, 0xfd, 0xe9, 0x01,
-    0x06, 0x04, 0x87, 0x02, 0xa9, 0xfc, 0x89, 0xf5,
-    0x3b, 0xf1, 0x87, 0xf1, 0xdb, 0xf5, 0xff, 0xfb,
-    0xe6, 0x00, 0x88, 0x03, 0x46, 0x02, 0xae, 0xfe,
-    0xb3, 0xfb, 0xd5, 0xfa, 0x02, 0xfe, 0x3f, 0x01,
-    0x6c, 0x04, 0xba, 0x04, 0x77, 0x03, 0xf2, 0x00,
-    0xf6, 0xfd, 0x6f, 0xfc, 0x41, 0xfc, 0xd0, 0xfc,
-    0x02, 0xfe, 0xe5, 0xfd, 0x9e, 0xfe, 0x63, 0xfe,
-    0xb0, 0xfc, 0x48, 0xfa, 0x67, 0xf6, 0x98, 0xf3,
-    0xa0, 0xf0, 0x56, 0xed, 0x37, 0xeb, 0x00, 0xea,
-    0xc2, 0xe9, 0x65, 0xe8, 0x49, 0xe4, 0x7a, 0xdf,
-    0x02, 0xdb, 0x7c, 0xd9, 0x4a, 0xd9, 0xcd, 0xda,
-    0xcc, 0xda, 0xf2, 0xd9, 0x51, 0xd8, 0xa3, 0xd9,
-    0xfd, 0xe2, 0x60, 0xf3, 0xb0, 0x06, 0xe7, 0x14,
-    0xf6, 0x18, 0x7c, 0x17, 0x40, 0x14, 0xa5, 0x15,
-    0x45, 0x1d, 0x1a, 0x27, 0x9d, 0x32, 0x0e, 0x37,
-    0xeb, 0x34, 0x54, 0x2c, 0xe2, 0x21, 0xef, 0x19,
-    0x89, 0x14, 0x43, 0x12, 0x30, 0x12, 0x05, 0x12,
-    0x68, 0x0e, 0xf6, 0x05, 0xe1, 0xfb, 0xc9, 0xf2,
-    0xd8, 0xed, 0x88, 0xeb, 0x54, 0xeb, 0xa9, 0xee,
-    0xdf, 0xf0, 0x6b, 0xf3, 0x68, 0xf4, 0x32, 0xf5,
-    0x29, 0xf8, 0x41, 0xfa, 0xba, 0xfc, 0xf9, 0xff,
-    0x4c, 0x03, 0x64, 0x07, 0xa8, 0x0a, 0x85, 0x0e,
-    0x31, 0x11, 0x49, 0x13, 0xaa, 0x11, 0x84, 0x0e,
-    0x2d, 0x0c, 0xdd, 0x09, 0x2a, 0x0c, 0xaf, 0x0f,
-    0xfb, 0x12, 0xbd, 0x13, 0xe0, 0x0d, 0x13, 0x07,
-    0x70, 0x01, 0xfe, 0xfe, 0x17, 0x00, 0xf0, 0x00,
-    0x49, 0x02, 0xaa, 0x00, 0x8c, 0xfd, 0x13, 0xf9,
-    0xe4, 0xf6, 0x0d, 0xf7, 0x40, 0xf9, 0xa8, 0xfb,
-    0x4c, 0xfe, 0x88, 0x00, 0x90, 0x00, 0xa8, 0xfe,
-    0x4c, 0xfc, 0xd1, 0xfb, 0x3e, 0xfe, 0x27, 0x01,
-    0x89, 0x01, 0x87, 0x01, 0x70, 0xfe, 0x13, 0xfd,
-    0xb9, 0xfc, 0x07, 0xfd, 0x32, 0xff, 0x2f, 0xff,
-    0x44, 0xfe, 0x7d, 0xfd, 0x8c, 0xfc, 0x2e, 0xfc,
-    0xfb, 0xfa, 0xe9, 0xf9, 0xe9, 0xf8, 0xa2, 0xf8,
-    0x6f, 0xf6, 0x25, 0xf3, 0x2d, 0xef, 0x53, 0xea,
-    0xe7, 0xe6, 0xb4, 0xe4, 0xe8, 0xe4, 0x15, 0xe5,
-    0x15, 0xe3, 0xbc, 0xde, 0xca, 0xda, 0x33, 0xd8,
-    0x17, 0xd6, 0xf7, 0xd3, 0x42, 0xd3, 0x46, 0xd5,
-    0x85, 0xda, 0x9f, 0xe3, 0x54, 0xf2, 0xac, 0x04,
-    0xd0, 0x13, 0xea, 0x17, 0x66, 0x13, 0x5a, 0x0e,
-    0xd8, 0x10, 0x89, 0x1a, 0x78, 0x27, 0x79, 0x33,
-    0xf9, 0x3a, 0x0b, 0x3b, 0xb6, 0x30, 0x55, 0x23,
-    0xfc, 0x17, 0x3f, 0x14, 0xc6, 0x15, 0xcc, 0x18,
-    0xac, 0x1a, 0x7d, 0x18, 0x18, 0x10, 0x8d, 0x02,
-    0x47, 0xf6, 0x52, 0xef, 0x38, 0xef, 0x49, 0xf1,
-    0x62, 0xf3, 0x09, 0xf5, 0x50, 0xf6, 0x7d, 0xf6,
-    0x0a, 0xf5, 0xd1, 0xf4, 0x3f, 0xf6, 0x62, 0xf8,
-    0xf6, 0xfa, 0x29, 0xfe, 0x4c, 0x04, 0xb5, 0x0b,
-    0x52, 0x0f, 0x7b, 0x0f, 0x69, 0x0e, 0x33, 0x0d,
-    0xd7, 0x0c, 0x91, 0x0b, 0x25, 0x0b, 0x62, 0x0f,
-    0x3a, 0x14, 0x86, 0x16, 0x40, 0x14, 0x4c, 0x0d,
-    0xac, 0x06, 0x41, 0x02, 0xfe, 0x00, 0xd3, 0x02,
-    0x44, 0x05, 0x52, 0x05, 0xae, 0x03, 0x1d, 0x00,
-    0xab, 0xfb, 0xff, 0xf7, 0x39, 0xf5, 0xcf, 0xf6,
-    0xae, 0xfa, 0x7c, 0xff, 0x29, 0x02, 0x5d, 0x01,
-    0xca, 0xfe, 0xc8, 0xfa, 0x93, 0xf8, 0x88, 0xf9,
-    0xb2, 0xfc, 0x5d, 0x00, 0x0b, 0x02, 0xd7, 0x00,
-    0x11, 0xfe, 0x65, 0xfb, 0xb9, 0xf9, 0x65, 0xfa,
-    0xdd, 0xfb, 0x51, 0xfc, 0x00, 0xfd, 0xa4, 0xfc,
-    0x84, 0xfc, 0x0e, 0xfc, 0xa6, 0xfa, 0x95, 0xf9,
-    0xcc, 0xf8, 0x0b, 0xf7, 0x1d, 0xf6, 0xc2, 0xf4,
-    0x99, 0xf3, 0xb9, 0xf1, 0x15, 0xee, 0xf5, 0xea,
-    0x83, 0xe8, 0xf4, 0xe5, 0x5f, 0xe4, 0xb1, 0xe2,
-    0x00, 0xe2, 0xfa, 0xe1, 0xf7, 0xdf, 0xb1, 0xdc,
-    0xfa, 0xd9, 0x98, 0xd7, 0x5f, 0xd7, 0x1e, 0xdb,
-    0xe9, 0xdf, 0xbe, 0xee, 0x94, 0xff, 0x2d, 0x10,
-    0xfa, 0x18, 0x3d, 0x16, 0x9a, 0x0f, 0x55, 0x0e,
-    0x3e, 0x14, 0x62, 0x21, 0x9f, 0x31, 0xad, 0x3a,
-    0x60, 0x3d, 0xcc, 0x34, 0xb9, 0x26, 0x74, 0x1c,
-    0xb9, 0x17, 0xe2, 0x16, 0x59, 0x1a, 0x4a, 0x1b,
-    0x40, 0x1a, 0xd4, 0x13, 0x67, 0x07, 0x0c, 0xfb,
-    0xcf, 0xf4, 0x2e, 0xf2, 0x2e, 0xf4, 0x4a, 0xf6,
-    0x69, 0xf7, 0x0d, 0xf8, 0x66, 0xf6, 0x99, 0xf4,
-    0xc8, 0xf4, 0x9c, 0xf7, 0x27, 0xf9, 0xd7, 0xfc,
-    0xcd, 0xfe, 0xda, 0x02, 0x38, 0x06, 0x35, 0x08,
-    0x32, 0x0a, 0xf8, 0x0b, 0x1a, 0x0d, 0xc2, 0x0c,
-    0x5d, 0x0b, 0xf2, 0x09, 0x12, 0x0b, 0xeb, 0x0d,
-    0x11, 0x11, 0xcd, 0x12, 0x9d, 0x0f, 0x31, 0x0b,
-    0x81, 0x05, 0x0e, 0x02, 0x0a, 0x02, 0x72, 0x02,
-    0x29, 0x04, 0x5a, 0x03, 0x34, 0x01, 0x47, 0xfe,
-    0x26, 0xfd, 0xcd, 0xfa, 0x1f, 0xfa, 0xb3, 0xf8,
-    0x8c, 0xf9, 0x9b, 0xfd, 0xdc, 0xff, 0xf8, 0x00,
-    0x8f, 0xff, 0x23, 0xfd, 0x3a, 0xfb, 0x82, 0xfa,
-    0x10, 0xfa, 0x66, 0xfc, 0x47, 0xfe, 0x98, 0xfe,
-    0x1b, 0xfe, 0x23, 0xfc, 0x36, 0xfb, 0x65, 0xfa,
-    0x40, 0xf9, 0x87, 0xf9, 0xca, 0xfa, 0x85, 0xfc,
-    0xf9, 0xfc, 0xf1, 0xfb, 0x88, 0xfa, 0x30, 0xfa,
-    0xea, 0xf9, 0x18, 0xfa, 0x8f, 0xf9, 0xcd, 0xf7,
-    0x99, 0xf6, 0xf6, 0xf3, 0x3c, 0xf2, 0x62, 0xf0,
-    0x2d, 0xec, 0x6b, 0xe9, 0x3c, 0xe6, 0x76, 0xe4,
-    0x95, 0xe4, 0x0f, 0xe4, 0x98, 0xe3, 0x7d, 0xe2,
-    0xe2, 0xdd, 0x70, 0xd9, 0xa7, 0xd8, 0x8f, 0xd8,
-    0x2e, 0xdd, 0x76, 0xe2, 0xe0, 0xed, 0xc8, 0x00,
-    0xe8, 0x11, 0xb9, 0x18, 0xa7, 0x16, 0x20, 0x0f,
-    0xc0, 0x0d, 0xee, 0x14, 0xef, 0x1e, 0x18, 0x2f,
-    0x6a, 0x3a, 0x12, 0x3d, 0x71, 0x35, 0xff, 0x27,
-    0x7a, 0x1c, 0x3e, 0x19, 0x85, 0x17, 0xa9, 0x19,
-    0x28, 0x1d, 0xaf, 0x1d, 0xa1, 0x19, 0x9b, 0x0e,
-    0xf1, 0x00, 0xb0, 0xf7, 0xd8, 0xf3, 0x2a, 0xf2,
-    0x12, 0xf6, 0x59, 0xf8, 0x51, 0xfb, 0xc8, 0xfa,
-    0xa1, 0xf7, 0x48, 0xf5, 0x4d, 0xf5, 0xef, 0xf5,
-    0x0a, 0xf8, 0x6c, 0xfb, 0x6c, 0xff, 0x28, 0x04,
-    0xd0, 0x06, 0x43, 0x08, 0xf8, 0x08, 0x9a, 0x09,
-    0xb6, 0x07, 0x2c, 0x06, 0x17, 0x04, 0x30, 0x05,
-    0xc0, 0x08, 0x3b, 0x0d, 0xba, 0x0f, 0x38, 0x0e,
-    0xd5, 0x08, 0xf5, 0x01, 0x08, 0xfe, 0x1a, 0xfe,
-    0x54, 0x01, 0x1c, 0x05, 0x2d, 0x06, 0x15, 0x03,
-    0xa6, 0xfe, 0x12, 0xf9, 0x38, 0xf7, 0xf7, 0xf7,
-    0x6b, 0xfa, 0x1e, 0xfe, 0xc5, 0x00, 0x4c, 0x02,
-    0xbe, 0x00, 0xb5, 0xfd, 0x26, 0xfa, 0x60, 0xf9,
-    0xf3, 0xfa, 0x44, 0xfd, 0xeb, 0xff, 0xdd, 0xff,
-    0xb7, 0xfe, 0xd6, 0xfb, 0xde, 0xf9, 0x09, 0xfa,
-    0x43, 0xfb, 0xd7, 0xfc, 0x4a, 0xfd, 0x52, 0xfd,
-    0x5f, 0xfd, 0xf4, 0xfc, 0x8c, 0xfb, 0x06, 0xfb,
-    0x6d, 0xfa, 0xb7, 0xfb, 0xb2, 0xfc, 0xea, 0xfc,
-    0x48, 0xfc, 0x7f, 0xfa, 0x10, 0xf8, 0x23, 0xf5,
-    0x22, 0xf3, 0xe0, 0xef, 0xce, 0xed, 0xc6, 0xea,
-    0xf7, 0xe8, 0xbb, 0xe8, 0x26, 0xe8, 0xa0, 0xe6,
-    0x86, 0xe4, 0xeb, 0xe1, 0xfa, 0xdf, 0x48, 0xde,
-    0x21, 0xdd, 0x5a, 0xdd, 0xdd, 0xde, 0x44, 0xe0,
-    0x52, 0xe4, 0x3c, 0xf0, 0xf1, 0x00, 0xe9, 0x11,
-    0xff, 0x17, 0xf3, 0x14, 0x38, 0x0f, 0x96, 0x0e,
-    0x1e, 0x13, 0x14, 0x1e, 0x51, 0x2b, 0xd5, 0x36,
-    0x24, 0x3a, 0x61, 0x32, 0xa8, 0x25, 0x44, 0x1b,
-    0x8a, 0x16, 0xc2, 0x15, 0xf3, 0x19, 0x62, 0x1d,
-    0xee, 0x1e, 0xa3, 0x17, 0x3e, 0x0b, 0x18, 0xff,
-    0x1a, 0xf8, 0x80, 0xf5, 0x10, 0xf6, 0x52, 0xf8,
-    0xc4, 0xfa, 0x19, 0xfb, 0x55, 0xf8, 0xbf, 0xf4,
-    0x72, 0xf3, 0x3b, 0xf4, 0x3d, 0xf6, 0xc1, 0xf8,
-    0x2c, 0xfb, 0x81, 0xfe, 0x42, 0x00, 0x26, 0x02,
-    0x9a, 0x03, 0xc0, 0x05, 0x50, 0x07, 0x94, 0x07,
-    0xcd, 0x04, 0xf3, 0x02, 0x0c, 0x03, 0x0f, 0x07,
-    0xf1, 0x0b, 0x92, 0x0d, 0xad, 0x0a, 0xa7, 0x05,
-    0xe3, 0x00, 0xd3, 0xfd, 0x31, 0xff, 0x63, 0x00,
-    0x11, 0x03, 0x11, 0x03, 0x7d, 0x00, 0xc4, 0xfd,
-    0x49, 0xfa, 0xac, 0xf7, 0x93, 0xf7, 0x3e, 0xfa,
-    0xb2, 0xfd, 0xd5, 0x00, 0xab, 0x00, 0x33, 0xff,
-    0x86, 0xfd, 0x89, 0xfa, 0x29, 0xf9, 0x38, 0xfa,
-    0xb5, 0xfd, 0x2e, 0x01, 0xe8, 0x01, 0xc4, 0xff,
-    0xb7, 0xfd, 0xe5, 0xfb, 0xc3, 0xfb, 0x8d, 0xfc,
-    0x62, 0xfe, 0xb5, 0x00, 0x02, 0x01, 0xf0, 0x00,
-    0x72, 0xff, 0x7f, 0xfd, 0x28, 0xfc, 0x52, 0xfb,
-    0xd1, 0xfb, 0x02, 0xfe, 0x83, 0xfe, 0x5e, 0xfe,
-    0xee, 0xfc, 0xba, 0xfa, 0xa1, 0xf7, 0x39, 0xf6,
-    0x4e, 0xf3, 0x4c, 0xf3, 0x87, 0xf2, 0x9f, 0xef,
-    0x27, 0xed, 0x80, 0xe8, 0xe1, 0xe6, 0xf8, 0xe5,
-    0x59, 0xe7, 0x1b, 0xe6, 0x93, 0xe6, 0xfd, 0xe3,
-    0x7d, 0xe2, 0xd7, 0xe0, 0xe3, 0xdf, 0xa8, 0xdf,
-    0x7d, 0xe1, 0x15, 0xe7, 0x8e, 0xf2, 0xc1, 0x04,
-    0x93, 0x12, 0xd7, 0x18, 0xc9, 0x14, 0x14, 0x0e,
-    0x0d, 0x0b, 0xb4, 0x10, 0x0d, 0x1a, 0x63, 0x28,
-    0xfd, 0x33, 0xbf, 0x36, 0x40, 0x30, 0x67, 0x23,
-    0x0e, 0x16, 0xc1, 0x11, 0x3c, 0x12, 0x18, 0x17,
-    0x4d, 0x1e, 0x6f, 0x1e, 0x45, 0x19, 0xda, 0x0c,
-    0x8a, 0xfe, 0xc6, 0xf4, 0xcc, 0xf3, 0xe6, 0xf5,
-    0xf6, 0xfb, 0xa0, 0xfe, 0x63, 0xfc, 0x59, 0xfa,
-    0x40, 0xf5, 0xdc, 0xf2, 0xbd, 0xf2, 0x58, 0xf3,
-    0x35, 0xf6, 0xb7, 0xf9, 0x7e, 0xfc, 0x9b, 0xff,
-    0x41, 0x01, 0x6d, 0x00, 0x78, 0x01, 0xa9, 0x01,
-    0x23, 0x04, 0x64, 0x05, 0x2b, 0x04, 0xad, 0x03,
-    0x98, 0x04, 0xa8, 0x07, 0x63, 0x0b, 0x43, 0x0c,
-    0xe7, 0x08, 0x4f, 0x05, 0x03, 0x00, 0x1e, 0xff,
-    0x1d, 0x00, 0x41, 0x00, 0x1f, 0x01, 0xd5, 0xff,
-    0x1a, 0xfe, 0x71, 0xfd, 0x5c, 0xfb, 0x03, 0xfa,
-    0xc8, 0xfa, 0x65, 0xfb, 0x16, 0xfe, 0xe9, 0x00,
-    0x8c, 0x01, 0xc8, 0x00, 0x30, 0xff, 0x16, 0xfd,
-    0x3d, 0xff, 0x2d, 0x01, 0xfd, 0x01, 0xd6, 0x02,
-    0x7e, 0x01, 0x8d, 0x01, 0xf7, 0x00, 0x9c, 0x00,
-    0x78, 0x00, 0xac, 0x01, 0xca, 0x01, 0xea, 0x01,
-    0x6c, 0x01, 0xbc, 0xff, 0x03, 0xfe, 0x52, 0xfc,
-    0x65, 0xfc, 0xee, 0xfd, 0x89, 0xff, 0xf6, 0xfe,
-    0xaa, 0xfd, 0xdc, 0xfb, 0x67, 0xfa, 0x48, 0xf9,
-    0x18, 0xf9, 0xf8, 0xf8, 0x83, 0xf9, 0x02, 0xf8,
-    0x3e, 0xf5, 0xa3, 0xf1, 0x20, 0xee, 0x56, 0xeb,
-    0xde, 0xea, 0x4b, 0xeb, 0x66, 0xec, 0x3e, 0xed,
-    0x18, 0xeb, 0x6d, 0xea, 0x9a, 0xe6, 0x44, 0xe4,
-    0x90, 0xe1, 0x56, 0xe0, 0x6b, 0xe0, 0x3a, 0xe2,
-    0x97, 0xe8, 0x6f, 0xf5, 0x80, 0x07, 0xb3, 0x12,
-    0x34, 0x16, 0x15, 0x0e, 0x3b, 0x06, 0x53, 0x05,
-    0xf7, 0x0b, 0x0f, 0x1b, 0x66, 0x2b, 0xdb, 0x35,
-    0x77, 0x35, 0x65, 0x2a, 0xde, 0x19, 0xd8, 0x0f,
-    0x5c, 0x0d, 0xe1, 0x12, 0xff, 0x1c, 0x9a, 0x22,
-    0xdc, 0x21, 0x32, 0x18, 0xe6, 0x08, 0xba, 0xfb,
-    0x95, 0xf4, 0xa5, 0xf4, 0x02, 0xfa, 0x21, 0x00,
-    0x52, 0x01, 0x06, 0xff, 0xa1, 0xf7, 0xef, 0xf1,
-    0xc1, 0xee, 0xb9, 0xee, 0xfb, 0xf1, 0x9b, 0xf4,
-    0xcd, 0xf8, 0x1c, 0xfb, 0xab, 0xfd, 0x3b, 0xfe,
-    0xd7, 0xfd, 0xb2, 0xfc, 0xbb, 0xfd, 0x32, 0xff,
-    0x54, 0x01, 0x35, 0x04, 0x8b, 0x06, 0xcc, 0x0a,
-    0x32, 0x0d, 0x94, 0x0c, 0x7a, 0x0a, 0x32, 0x07,
-    0x69, 0x03, 0x07, 0x03, 0xc9, 0x03, 0xe4, 0x07,
-    0x21, 0x0b, 0x04, 0x09, 0x9d, 0x03, 0xab, 0xfd,
-    0xa7, 0xf9, 0x35, 0xf9, 0x73, 0xfb, 0x4b, 0xfe,
-    0xe2, 0x02, 0xb4, 0x04, 0x79, 0x03, 0xe5, 0xff,
-    0xab, 0xfb, 0x38, 0xf9, 0x95, 0xfa, 0x79, 0xfe,
-    0x47, 0x03, 0x5f, 0x07, 0x30, 0x07, 0x22, 0x05,
-    0xbf, 0x01, 0x33, 0x00, 0xf8, 0x00, 0x09, 0x04,
-    0xde, 0x06, 0x6a, 0x08, 0x7c, 0x08, 0xd2, 0x05,
-    0x26, 0x03, 0x23, 0x00, 0x41, 0xff, 0x4f, 0x00,
-    0xf9, 0x01, 0xb5, 0x02, 0x83, 0x02, 0x8a, 0x00,
-    0x67, 0xfe, 0xea, 0xfb, 0xa0, 0xfa, 0xf8, 0xf9,
-    0xac, 0xf9, 0x0d, 0xf9, 0xd3, 0xf8, 0xa6, 0xf8,
-    0xcb, 0xf6, 0x0f, 0xf4, 0xb2, 0xef, 0x4e, 0xed,
-    0xb6, 0xea, 0x30, 0xea, 0x41, 0xea, 0x9d, 0xec,
-    0x08, 0xee, 0x43, 0xee, 0xdf, 0xeb, 0x4c, 0xe8,
-    0x96, 0xe3, 0x4d, 0xdf, 0x0b, 0xde, 0xbf, 0xde,
-    0xbd, 0xe2, 0xf3, 0xe6, 0x72, 0xf2, 0x1e, 0x02,
-    0x94, 0x10, 0x6c, 0x13, 0xcf, 0x0b, 0xe3, 0x01,
-    0xd8, 0x00, 0x46, 0x08, 0x8f, 0x14, 0xc9, 0x23,
-    0xfd, 0x2d, 0xa3, 0x30, 0xdd, 0x27, 0xad, 0x19,
-    0x98, 0x0f, 0x03, 0x0e, 0xe4, 0x10, 0x4b, 0x18,
-    0x8c, 0x1e, 0x6a, 0x20, 0xb7, 0x1b, 0x8c, 0x0d,
-    0xac, 0xff, 0x8d, 0xf7, 0xf1, 0xf5, 0xb9, 0xf9,
-    0xf0, 0xfd, 0xbe, 0xff, 0xcc, 0xfe, 0x0b, 0xfa,
-    0x0f, 0xf3, 0xf3, 0xef, 0x7c, 0xee, 0xb7, 0xf0,
-    0xe7, 0xf3, 0x07, 0xf6, 0xef, 0xf9, 0xc3, 0xfc,
-    0xd3, 0xfd, 0x6c, 0xfd, 0xd6, 0xfb, 0xa0, 0xfb,
-    0xbd, 0xfe, 0xc2, 0x00, 0xf4, 0x02, 0x68, 0x05,
-    0xd2, 0x08, 0x23, 0x0e, 0xac, 0x10, 0x43, 0x0e,
-    0xfd, 0x09, 0xda, 0x05, 0xa7, 0x04, 0xb5, 0x06,
-    0x0a, 0x09, 0xd3, 0x0a, 0x3f, 0x0b, 0xc6, 0x07,
-    0xa9, 0x02, 0x6c, 0xfd, 0x6c, 0xfa, 0x40, 0xfb,
-    0x07, 0xfe, 0x6a, 0x01, 0xf5, 0x03, 0x69, 0x05,
-    0x7c, 0x03, 0x65, 0xff, 0x91, 0xfa, 0xe8, 0xf8,
-    0xd3, 0xfb, 0x03, 0x02, 0xb1, 0x06, 0x8d, 0x08,
-    0x7e, 0x07, 0x8f, 0x04, 0x98, 0x02, 0xa0, 0x01,
-    0xde, 0x02, 0x77, 0x05, 0x03, 0x09, 0xe9, 0x09,
-    0x2d, 0x0a, 0xc0, 0x07, 0xdb, 0x04, 0x72, 0x02,
-    0xa3, 0x00, 0xe1, 0x00, 0x4f, 0x02, 0x10, 0x04,
-    0x84, 0x03, 0xf4, 0x01, 0x3f, 0xfe, 0x42, 0xfb,
-    0x1b, 0xf9, 0x79, 0xf8, 0xaa, 0xf8, 0x20, 0xfa,
-    0xff, 0xfa, 0x9f, 0xfa, 0x3e, 0xf8, 0x62, 0xf4,
-    0xe5, 0xef, 0x58, 0xee, 0xc6, 0xed, 0xec, 0xed,
-    0xb8, 0xee, 0xa1, 0xee, 0xaa, 0xee, 0xfe, 0xed,
-    0x37, 0xeb, 0xaf, 0xe7, 0xba, 0xe7, 0x7e, 0xe4,
-    0x37, 0xe3, 0xc8, 0xe0, 0xbe, 0xdf, 0x10, 0xe1,
-    0x54, 0xe2, 0x65, 0xe4, 0xeb, 0xf0, 0x5e, 0x03,
-    0xcc, 0x0f, 0x9d, 0x11, 0x33, 0x04, 0xda, 0xfa,
-    0x46, 0xfe, 0x2a, 0x09, 0x39, 0x17, 0xc2, 0x23,
-    0xda, 0x27, 0xd9, 0x27, 0x6d, 0x1f, 0x56, 0x12,
-    0x8b, 0x0c, 0xd9, 0x0c, 0xdd, 0x12, 0x13, 0x1d,
-    0x7a, 0x21, 0xae, 0x1f, 0xb3, 0x17, 0x78, 0x08,
-    0x96, 0xfd, 0xe3, 0xf8, 0xde, 0xf9, 0xff, 0xff,
-    0xbd, 0x03, 0x53, 0x02, 0x01, 0xfe, 0x53, 0xf6,
-    0xa3, 0xf0, 0xfb, 0xee, 0x5e, 0xee, 0xa8, 0xf1,
-    0x0e, 0xf5, 0xd4, 0xf7, 0xeb, 0xfa, 0x31, 0xfb,
-    0xef, 0xfa, 0x2f, 0xfa, 0x43, 0xf9, 0x6c, 0xfb,
-    0x22, 0x00, 0x22, 0x03, 0x02, 0x06, 0x13, 0x07,
-    0xb6, 0x08, 0x6e, 0x0c, 0xf3, 0x0c, 0x7b, 0x0c,
-    0x08, 0x0c, 0xed, 0x0a, 0xd1, 0x0a, 0xbb, 0x0a,
-    0xd0, 0x09, 0xc5, 0x09, 0xf5, 0x08, 0x90, 0x06,
-    0xad, 0x05, 0x12, 0x04, 0xa1, 0x01, 0x2d, 0x00,
-    0x41, 0xff, 0x4b, 0x00, 0x2c, 0x02, 0x76, 0x02,
-    0x2e, 0x02, 0xf9, 0x01, 0x0b, 0x00, 0x04, 0xfe,
-    0x1f, 0xfe, 0x9c, 0xff, 0xe4, 0x02, 0xd2, 0x04,
-    0x4f, 0x04, 0x7e, 0x04, 0x06, 0x04, 0xab, 0x03,
-    0x4c, 0x04, 0xdf, 0x05, 0x65, 0x07, 0xd8, 0x08,
-    0xbb, 0x07, 0x34, 0x06, 0x2a, 0x05, 0x3a, 0x03,
-    0xf3, 0x02, 0xa6, 0x02, 0xcc, 0x02, 0xfd, 0x02,
-    0xca, 0x01, 0x0a, 0x00, 0xe8, 0xfd, 0xcc, 0xfb,
-    0x54, 0xfa, 0x74, 0xfa, 0x10, 0xfa, 0x8a, 0xfa,
-    0x49, 0xfa, 0x56, 0xf9, 0x04, 0xf8, 0xe5, 0xf4,
-    0xf2, 0xf2, 0x7b, 0xf1, 0x46, 0xf1, 0x10, 0xf0,
-    0x16, 0xef, 0x1a, 0xee, 0x7a, 0xed, 0x03, 0xec,
-    0x54, 0xea, 0x93, 0xe8, 0xc5, 0xe7, 0x43, 0xe7,
-    0x89, 0xe5, 0x0e, 0xe4, 0x28, 0xe2, 0x4c, 0xe0,
-    0x00, 0xe0, 0x2f, 0xe0, 0x30, 0xe1, 0x26, 0xe7,
-    0x91, 0xf0, 0x91, 0xff, 0x44, 0x0a, 0x77, 0x0a,
-    0x7a, 0x02, 0xb9, 0xfb, 0xa8, 0xfc, 0xb1, 0x07,
-    0xe1, 0x14, 0x90, 0x1f, 0xbd, 0x27, 0xfa, 0x25,
-    0x5a, 0x1e, 0x2c, 0x13, 0x57, 0x0c, 0xc9, 0x0e,
-    0x8f, 0x17, 0xa0, 0x1e, 0x02, 0x23, 0xa0, 0x20,
-    0x68, 0x18, 0x3e, 0x0d, 0xaa, 0x01, 0x43, 0xfc,
-    0xb7, 0xfe, 0x5b, 0x03, 0x43, 0x06, 0x03, 0x04,
-    0x74, 0xfd, 0xd1, 0xf7, 0x21, 0xf2, 0x96, 0xef,
-    0x5e, 0xef, 0x2f, 0xf2, 0x6b, 0xf5, 0x1e, 0xf8,
-    0x91, 0xf7, 0xeb, 0xf6, 0x34, 0xf6, 0x68, 0xf5,
-    0x3d, 0xf7, 0xa7, 0xf9, 0xa1, 0xfe, 0xba, 0x02,
-    0x02, 0x04, 0x0b, 0x04, 0x1d, 0x05, 0xaa, 0x07,
-    0xc1, 0x0a, 0xd9, 0x0c, 0x05, 0x0c, 0x7c, 0x0c,
-    0x08, 0x0d, 0x69, 0x0d, 0x80, 0x0e, 0xf0, 0x0c,
-    0x4f, 0x0b, 0x39, 0x09, 0x9b, 0x07, 0xd0, 0x05,
-    0x2b, 0x06, 0xe7, 0x05, 0xfb, 0x05, 0x3f, 0x06,
-    0x44, 0x04, 0x1a, 0x03, 0x59, 0x00, 0x37, 0xfe,
-    0x1e, 0xfd, 0xb8, 0xfe, 0x53, 0x01, 0x97, 0x03,
-    0xc1, 0x03, 0x05, 0x02, 0x43, 0x00, 0x2c, 0xfe,
-    0x50, 0xfe, 0x15, 0x00, 0x02, 0x04, 0xe1, 0x07,
-    0x87, 0x08, 0x98, 0x06, 0x13, 0x03, 0xf0, 0xff,
-    0x21, 0xff, 0x93, 0x00, 0x48, 0x03, 0xfc, 0x05,
-    0x33, 0x06, 0xe2, 0x03, 0xc5, 0x00, 0x46, 0xfd,
-    0x58, 0xfb, 0xc7, 0xfb, 0x6a, 0xfd, 0x1f, 0x00,
-    0x13, 0x01, 0x3d, 0xff, 0xa1, 0xfc, 0x5d, 0xf9,
-    0x68, 0xf6, 0x0b, 0xf5, 0x75, 0xf5, 0x11, 0xf7,
-    0x4d, 0xf9, 0x9e, 0xf8, 0x82, 0xf4, 0x01, 0xf0,
-    0x25, 0xeb, 0xdf, 0xe8, 0x38, 0xe9, 0xef, 0xea,
-    0x9d, 0xec, 0xc5, 0xec, 0x24, 0xea, 0xfa, 0xe5,
-    0x7b, 0xe3, 0x4c, 0xe1, 0x81, 0xe0, 0xbe, 0xdf,
-    0x33, 0xe0, 0xd9, 0xe1, 0x6b, 0xe3, 0x54, 0xe6,
-    0xa8, 0xec, 0x07, 0xfa, 0x51, 0x08, 0xc6, 0x0d,
-    0xe2, 0x07, 0x43, 0xfd, 0x85, 0xfa, 0x5b, 0x03,
-    0x31, 0x13, 0x0d, 0x1f, 0xa9, 0x26, 0x94, 0x25,
-    0x6b, 0x1e, 0x7d, 0x15, 0x75, 0x0d, 0x58, 0x0f,
-    0x2d, 0x17, 0x21, 0x21, 0x39, 0x25, 0xbe, 0x23,
-    0xe2, 0x18, 0xcf, 0x0d, 0xaf, 0x03, 0x5d, 0xff,
-    0x15, 0x03, 0x13, 0x07, 0x37, 0x0a, 0x9e, 0x07,
-    0x34, 0x01, 0x08, 0xf8, 0x82, 0xf2, 0x84, 0xef,
-    0x46, 0xf2, 0x3c, 0xf6, 0x45, 0xf8, 0xa9, 0xf8,
-    0x36, 0xf6, 0x9f, 0xf4, 0x4d, 0xf3, 0x49, 0xf4,
-    0xcc, 0xf5, 0x90, 0xf9, 0xeb, 0xfc, 0x45, 0x00,
-    0x41, 0x02, 0x57, 0x03, 0xc5, 0x04, 0x72, 0x06,
-    0x51, 0x09, 0x92, 0x0a, 0xe7, 0x0c, 0x20, 0x0d,
-    0xe6, 0x0d, 0x6f, 0x0e, 0xd1, 0x0e, 0x7f, 0x0e,
-    0xf8, 0x0d, 0x42, 0x0c, 0x88, 0x0a, 0x71, 0x0a,
-    0xc3, 0x08, 0x81, 0x08, 0x32, 0x08, 0x59, 0x08,
-    0x05, 0x09, 0xbb, 0x07, 0xfa, 0x04, 0xdc, 0x01,
-    0x02, 0x00, 0x71, 0xff, 0x73, 0x00, 0xd0, 0x01,
-    0xeb, 0x02, 0x42, 0x03, 0x08, 0x01, 0xa9, 0xff,
-    0xa0, 0xfd, 0x7c, 0xfe, 0x22, 0x00, 0x1c, 0x02,
-    0xf6, 0x03, 0x37, 0x04, 0x97, 0x03, 0xc1, 0x00,
-    0x05, 0x00, 0xcf, 0xff, 0xa2, 0x02, 0x91, 0x04,
-    0x06, 0x05, 0x40, 0x03, 0x5a, 0x01, 0x9a, 0x00,
-    0x38, 0xff, 0x3d, 0x00, 0x12, 0x00, 0x21, 0x01,
-    0xa9, 0x01, 0xad, 0x00, 0x8c, 0xfe, 0xfe, 0xfc,
-    0x94, 0xfb, 0xae, 0xfa, 0xb6, 0xfa, 0x75, 0xf9,
-    0x1e, 0xf9, 0x87, 0xf8, 0x95, 0xf6, 0x9b, 0xf4,
-    0xab, 0xf1, 0x9d, 0xef, 0xfe, 0xee, 0x41, 0xee,
-    0x81, 0xec, 0x86, 0xea, 0xf1, 0xe8, 0xaf, 0xe7,
-    0x82, 0xe8, 0x94, 0xe6, 0x23, 0xe5, 0xea, 0xe2,
-    0x0c, 0xe1, 0xd7, 0xdf, 0xbe, 0xe0, 0x1a, 0xe0,
-    0x00, 0xe1, 0x44, 0xe6, 0xcd, 0xee, 0xc0, 0xfd,
-    0xf6, 0x07, 0x53, 0x08, 0x79, 0x00, 0x10, 0xfa,
-    0x9d, 0xf9, 0xde, 0x06, 0xd1, 0x15, 0x98, 0x21,
-    0x27, 0x27, 0xe9, 0x22, 0x68, 0x1a, 0xe1, 0x12,
-    0x71, 0x0f, 0xa1, 0x12, 0x06, 0x1d, 0xa7, 0x23,
-    0x76, 0x27, 0x51, 0x22, 0x22, 0x17, 0x00, 0x0c,
-    0x56, 0x05, 0xdc, 0x03, 0x14, 0x08, 0xd3, 0x0b,
-    0x41, 0x0b, 0x40, 0x07, 0x4c, 0xff, 0x8b, 0xf7,
-    0xfc, 0xf2, 0x56, 0xf2, 0xb4, 0xf4, 0x30, 0xf8,
-    0xfd, 0xf8, 0x45, 0xf7, 0x22, 0xf4, 0x0d, 0xf2,
-    0xd8, 0xf0, 0x38, 0xf2, 0xbc, 0xf4, 0xdb, 0xf8,
-    0x58, 0xfc, 0x6d, 0xfe, 0x10, 0xff, 0xf8, 0xff,
-    0xea, 0x01, 0x7d, 0x04, 0x46, 0x07, 0x78, 0x09,
-    0xbd, 0x0b, 0x2e, 0x0c, 0x7d, 0x0c, 0x10, 0x0d,
-    0x16, 0x0e, 0xe8, 0x0e, 0x5e, 0x0f, 0xf4, 0x0d,
-    0x4e, 0x0d, 0xa0, 0x0c, 0x26, 0x0b, 0x75, 0x0a,
-    0x59, 0x0a, 0x91, 0x0a, 0xaf, 0x0a, 0x0b, 0x0a,
-    0x63, 0x07, 0xbd, 0x05, 0x60, 0x03, 0xcf, 0x01,
-    0x3e, 0x01, 0x4f, 0x01, 0x31, 0x02, 0x94, 0x02,
-    0xa7, 0x01, 0x1a, 0xff, 0xd8, 0xfc, 0xf8, 0xfa,
-    0x46, 0xfc, 0xce, 0xfe, 0x4c, 0x01, 0x6d, 0x03,
-    0x9d, 0x02, 0x35, 0x00, 0xf0, 0xfd, 0xa8, 0xfc,
-    0xe0, 0xfd, 0x6c, 0x01, 0xe5, 0x03, 0x42, 0x04,
-    0xd5, 0x03, 0x25, 0x01, 0xdf, 0xff, 0x21, 0x00,
-    0xa0, 0x00, 0x29, 0x02, 0xe2, 0x02, 0x8c, 0x02,
-    0x38, 0x01, 0x4c, 0x00, 0xdd, 0xfd, 0xf7, 0xfc,
-    0x59, 0xfc, 0x7d, 0xfc, 0xd3, 0xfc, 0x6f, 0xfb,
-    0x0a, 0xf9, 0xb7, 0xf6, 0xef, 0xf4, 0xed, 0xf3,
-    0x1c, 0xf3, 0xe7, 0xf0, 0xcd, 0xee, 0x58, 0xec,
-    0xdb, 0xe9, 0xae, 0xe8, 0xfb, 0xe8, 0xcc, 0xe7,
-    0x7a, 0xe8, 0x13, 0xe6, 0x3a, 0xe4, 0x90, 0xe2,
-    0xf5, 0xe0, 0x47, 0xdf, 0xda, 0xdf, 0xf8, 0xe0,
-    0xec, 0xe1, 0xec, 0xe6, 0xe6, 0xea, 0x8b, 0xf5,
-    0x76, 0xff, 0xea, 0x04, 0xe7, 0x02, 0xdb, 0xfd,
-    0xa8, 0xfa, 0x94, 0x00, 0xfe, 0x0d, 0x89, 0x19,
-    0x56, 0x23, 0xdc, 0x22, 0x47, 0x1c, 0x6a, 0x14,
-    0xdf, 0x0e, 0xda, 0x0f, 0xe9, 0x17, 0x2f, 0x21,
-    0x87, 0x25, 0x38, 0x25, 0xb4, 0x1b, 0xc5, 0x10,
-    0x98, 0x08, 0x4c, 0x04, 0xab, 0x06, 0xbc, 0x0b,
-    0xbe, 0x0e, 0xc6, 0x0c, 0x79, 0x06, 0xe0, 0xfb,
-    0x87, 0xf4, 0x66, 0xf1, 0xb8, 0xf2, 0x81, 0xf7,
-    0xb9, 0xfa, 0x89, 0xfa, 0x86, 0xf7, 0x79, 0xf2,
-    0x08, 0xef, 0x67, 0xee, 0x2b, 0xf0, 0x66, 0xf4,
-    0x1f, 0xfa, 0x82, 0xfd, 0x17, 0xff, 0xcf, 0xfd,
-    0xd9, 0xfb, 0x5b, 0xfd, 0xcc, 0x00, 0x11, 0x05,
-    0x0d, 0x09, 0x50, 0x0b, 0x24, 0x0b, 0xa2, 0x0b,
-    0xed, 0x0a, 0x59, 0x0b, 0x6c, 0x0c, 0x7d, 0x0d,
-    0xb2, 0x0d, 0xd5, 0x0e, 0xbf, 0x0e, 0x69, 0x0e,
-    0xd6, 0x0d, 0x50, 0x0c, 0x32, 0x0c, 0xa9, 0x0b,
-    0xb3, 0x0b, 0x4e, 0x0a, 0x30, 0x09, 0xa1, 0x06,
-    0x58, 0x05, 0xc8, 0x03, 0xe7, 0x02, 0xf2, 0x02,
-    0xaf, 0x00, 0xc1, 0xff, 0x51, 0xfe, 0xb2, 0xfe,
-    0xb2, 0xfe, 0x60, 0xff, 0xe2, 0xfd, 0x9b, 0xfd,
-    0x48, 0xfe, 0x88, 0xfd, 0x5d, 0xfe, 0xc5, 0xfd,
-    0x58, 0xfe, 0xa5, 0xfe, 0xed, 0xff, 0x44, 0xff,
-    0xba, 0xff, 0xd8, 0xff, 0x7d, 0xff, 0x2d, 0x00,
-    0xab, 0x00, 0x38, 0x01, 0x8c, 0x01, 0xd5, 0x01,
-    0x58, 0x01, 0x60, 0x01, 0x16, 0x01, 0xf8, 0xff,
-    0x81, 0xff, 0x23, 0xff, 0xa1, 0xfe, 0x5e, 0xfe,
-    0xd8, 0xfc, 0xfc, 0xfa, 0x67, 0xf9, 0x06, 0xf8,
-    0x58, 0xf6, 0x65, 0xf5, 0xa0, 0xf2, 0xa3, 0xf0,
-    0x93, 0xee, 0x51, 0xec, 0x7a, 0xea, 0x97, 0xe9,
-    0xa0, 0xe7, 0xc9, 0xe7, 0xfa, 0xe6, 0xd7, 0xe4,
-    0x01, 0xe4, 0x24, 0xe2, 0x2f, 0xe1, 0x00, 0xe1,
-    0x7f, 0xe1, 0x9e, 0xe0, 0x01, 0xe3, 0x4c, 0xe2,
-    0x96, 0xe6, 0xf1, 0xee, 0x19, 0xf9, 0x89, 0x01,
-    0xdd, 0x02, 0x6c, 0xfd, 0x41, 0xf9, 0x4f, 0xfd,
-    0xb5, 0x05, 0xb6, 0x14, 0x7f, 0x1d, 0x66, 0x1f,
-    0x3f, 0x1b, 0x57, 0x13, 0x92, 0x0d, 0x14, 0x10,
-    0xec, 0x16, 0xfc, 0x1e, 0xd2, 0x25, 0x2c, 0x24,
-    0x97, 0x1d, 0x4f, 0x14, 0xf6, 0x0a, 0xb6, 0x07,
-    0x33, 0x0b, 0x86, 0x0f, 0xd2, 0x12, 0xd9, 0x10,
-    0x8c, 0x09, 0x64, 0x00, 0xd1, 0xf8, 0xbb, 0xf4,
-    0xea, 0xf6, 0x59, 0xfb, 0xdf, 0xfd, 0xa8, 0xfc,
-    0x3c, 0xf7, 0x51, 0xf2, 0x3a, 0xef, 0x15, 0xef,
-    0x08, 0xf1, 0x60, 0xf4, 0x65, 0xf7, 0x9b, 0xf9,
-    0xe1, 0xf9, 0xdf, 0xf8, 0x51, 0xf9, 0x96, 0xfa,
-    0x68, 0xfd, 0xb2, 0x01, 0xb2, 0x04, 0x2e, 0x07,
-    0x3a, 0x08, 0xec, 0x08, 0x76, 0x09, 0x2d, 0x0b,
-    0xd6, 0x0b, 0x9a, 0x0c, 0x7f, 0x0d, 0x87, 0x0d,
-    0x14, 0x0f, 0x65, 0x0f, 0x15, 0x10, 0xd6, 0x0f,
-    0xe9, 0x0f, 0xe0, 0x0e, 0x95, 0x0e, 0x09, 0x0d,
-    0xb8, 0x0b, 0x1e, 0x0b, 0x75, 0x09, 0xc8, 0x08,
-    0xa6, 0x07, 0xa2, 0x05, 0xa2, 0x03, 0x22, 0x02,
-    0x02, 0x00, 0xa1, 0xff, 0x5c, 0xff, 0xa2, 0xfe,
-    0xdd, 0xfe, 0x98, 0xfe, 0x02, 0xfd, 0x36, 0xfc,
-    0xb9, 0xfa, 0x31, 0xfa, 0xd4, 0xfb, 0xab, 0xfd,
-    0x7b, 0xfe, 0x90, 0xfe, 0xaa, 0xfd, 0xed, 0xfc,
-    0x1a, 0xfe, 0xea, 0xfe, 0x98, 0x00, 0x8c, 0x01,
-    0xd1, 0x01, 0x6a, 0x01, 0x81, 0x01, 0x9a, 0x01,
-    0x14, 0x02, 0xa1, 0x02, 0x5e, 0x02, 0x63, 0x02,
-    0x0f, 0x01, 0xb3, 0xff, 0xfd, 0xfd, 0x28, 0xfd,
-    0xa3, 0xfc, 0x01, 0xfd, 0xc4, 0xfb, 0xb1, 0xf9,
-    0xa6, 0xf6, 0x2e, 0xf3, 0xaa, 0xf0, 0xee, 0xef,
-    0xa0, 0xef, 0x65, 0xef, 0x62, 0xed, 0x76, 0xe9,
-    0x36, 0xe7, 0x07, 0xe6, 0x06, 0xe6, 0xff, 0xe5,
-    0x94, 0xe5, 0x60, 0xe3, 0x36, 0xe3, 0x5f, 0xe1,
-    0x64, 0xe1, 0xf2, 0xe1, 0x14, 0xe2, 0x75, 0xe3,
-    0x88, 0xe8, 0x3a, 0xf0, 0xbe, 0xf9, 0x11, 0x01,
-    0xec, 0xfe, 0xf0, 0xfa, 0xca, 0xf7, 0x7e, 0xfb,
-    0x9c, 0x06, 0x51, 0x13, 0x31, 0x1a, 0x2c, 0x1c,
-    0xd6, 0x17, 0x0b, 0x11, 0x2f, 0x0f, 0xb0, 0x10,
-    0xde, 0x16, 0x5e, 0x1f, 0x43, 0x24, 0xa4, 0x23,
-    0x3d, 0x1e, 0xcd, 0x14, 0xd9, 0x0d, 0x66, 0x0c,
-    0xa3, 0x0e, 0x61, 0x13, 0xda, 0x15, 0xf9, 0x12,
-    0x37, 0x0d, 0x2f, 0x05, 0x4b, 0xfe, 0xab, 0xfb,
-    0x48, 0xfc, 0xda, 0xfe, 0x0f, 0x01, 0x68, 0xff,
-    0xfe, 0xfa, 0xda, 0xf6, 0xee, 0xf2, 0x13, 0xf2,
-    0x66, 0xf3, 0x35, 0xf5, 0x36, 0xf7, 0xb4, 0xf8,
-    0xf4, 0xf7, 0x41, 0xf7, 0x8f, 0xf7, 0xc9, 0xf8,
-    0x12, 0xfc, 0x6e, 0xff, 0xb5, 0x01, 0x59, 0x03,
-    0xe8, 0x04, 0x32, 0x05, 0xc3, 0x06, 0x2b, 0x08,
-    0xc7, 0x09, 0x6b, 0x0b, 0xc0, 0x0c, 0xc0, 0x0d,
-    0x1a, 0x0f, 0xdc, 0x0f, 0xb4, 0x0f, 0x6a, 0x10,
-    0x85, 0x10, 0x49, 0x11, 0x78, 0x11, 0x58, 0x10,
-    0x38, 0x0f, 0x30, 0x0e, 0xb7, 0x0c, 0x86, 0x0b,
-    0x73, 0x0a, 0x9e, 0x08, 0x60, 0x07, 0x58, 0x05,
-    0x81, 0x02, 0x70, 0x01, 0x74, 0x00, 0xe0, 0xff,
-    0x40, 0xff, 0xfb, 0xfd, 0x55, 0xfc, 0xa9, 0xfb,
-    0xe1, 0xfa, 0x3d, 0xfa, 0xc6, 0xfa, 0xc7, 0xfa,
-    0x65, 0xfb, 0xca, 0xfb, 0xc2, 0xfb, 0x85, 0xfb,
-    0xb6, 0xfb, 0x44, 0xfc, 0x89, 0xfd, 0x04, 0xff,
-    0xb9, 0xff, 0xda, 0xff, 0x9f, 0xff, 0x68, 0xff,
-    0xe8, 0xff, 0x76, 0x00, 0x37, 0x01, 0xc3, 0x01,
-    0xda, 0x01, 0x98, 0x01, 0xc2, 0x00, 0xc0, 0xff,
-    0x98, 0xfe, 0x52, 0xfe, 0xce, 0xfd, 0x23, 0xfd,
-    0x40, 0xfb, 0xf1, 0xf8, 0x0e, 0xf7, 0xd2, 0xf5,
-    0x85, 0xf4, 0x24, 0xf3, 0xe3, 0xf0, 0x1f, 0xef,
-    0x58, 0xed, 0xc7, 0xeb, 0xfe, 0xe9, 0x4f, 0xe9,
-    0x6b, 0xe8, 0x49, 0xe8, 0x27, 0xe8, 0x04, 0xe6,
-    0x0d, 0xe5, 0x32, 0xe3, 0x3e, 0xe3, 0xcc, 0xe3,
-    0x75, 0xe6, 0xe5, 0xe6, 0xf9, 0xea, 0x80, 0xf0,
-    0x9a, 0xf7, 0x84, 0xfd, 0xc9, 0xfd, 0xb8, 0xfa,
-    0x83, 0xf9, 0x76, 0xfe, 0x0a, 0x06, 0x34, 0x10,
-    0xe0, 0x14, 0x7c, 0x15, 0x4f, 0x12, 0xc3, 0x0e,
-    0x59, 0x0c, 0x84, 0x0f, 0xc3, 0x15, 0x74, 0x1c,
-    0x24, 0x20, 0x43, 0x1e, 0x32, 0x18, 0x76, 0x11,
-    0xcd, 0x0d, 0x03, 0x0e, 0x5d, 0x12, 0x62, 0x15,
-    0x37, 0x15, 0xc7, 0x10, 0xd8, 0x0a, 0xbd, 0x04,
-    0x0d, 0x01, 0x4c, 0x00, 0xf9, 0x01, 0x77, 0x04,
-    0xf1, 0x03, 0xa6, 0x00, 0x1c, 0xfb, 0xe3, 0xf6,
-    0x6a, 0xf5, 0x15, 0xf6, 0x78, 0xf7, 0x43, 0xf8,
-    0x8a, 0xf8, 0xd9, 0xf6, 0x18, 0xf6, 0x09, 0xf5,
-    0x3c, 0xf6, 0x85, 0xf8, 0x10, 0xfb, 0x1e, 0xfd,
-    0xf0, 0xfe, 0x47, 0x00, 0x42, 0x00, 0xb5, 0x01,
-    0xed, 0x02, 0x44, 0x05, 0xc3, 0x06, 0x53, 0x08,
-    0x55, 0x09, 0x06, 0x0b, 0x95, 0x0c, 0xf8, 0x0c,
-    0xab, 0x0d, 0x20, 0x0e, 0x32, 0x0f, 0x08, 0x10,
-    0x7d, 0x10, 0x61, 0x0f, 0x84, 0x0e, 0xae, 0x0d,
-    0x43, 0x0c, 0x46, 0x0b, 0x3f, 0x0a, 0x41, 0x09,
-    0x4e, 0x08, 0xfd, 0x06, 0x57, 0x05, 0x70, 0x03,
-    0x50, 0x01, 0xa7, 0xff, 0x3c, 0xff, 0x3d, 0xff,
-    0x12, 0xff, 0x81, 0xfe, 0x0b, 0xfd, 0xe3, 0xfb,
-    0xf7, 0xf9, 0x51, 0xf9, 0x7f, 0xf9, 0x90, 0xfa,
-    0xe2, 0xfb, 0x8c, 0xfc, 0xef, 0xfb, 0xbe, 0xfa,
-    0x72, 0xfa, 0x2b, 0xfa, 0xd5, 0xfb, 0x09, 0xfd,
-    0xcd, 0xfe, 0x4c, 0x00, 0x3a, 0x00, 0x2b, 0xff,
-    0x78, 0xfe, 0x05, 0xfe, 0x4f, 0xfe, 0x0b, 0x00,
-    0xe4, 0x00, 0x58, 0x01, 0xa3, 0x00, 0x86, 0xfe,
-    0xf3, 0xfc, 0xca, 0xfb, 0x63, 0xfa, 0xbc, 0xf9,
-    0xd4, 0xf9, 0x85, 0xf9, 0x9b, 0xf8, 0xb3, 0xf6,
-    0x3d, 0xf3, 0x43, 0xf0, 0x2f, 0xef, 0x29, 0xef,
-    0x0a, 0xef, 0x52, 0xee, 0xb5, 0xec, 0xd8, 0xea,
-    0xb3, 0xe9, 0x3f, 0xe8, 0x3e, 0xe6, 0x2f, 0xe6,
-    0x00, 0xe6, 0x67, 0xe7, 0xd9, 0xe8, 0xec, 0xe8,
-    0x8f, 0xe7, 0xce, 0xe9, 0x89, 0xef, 0xae, 0xf6,
-    0x7d, 0xfc, 0x4f, 0xfb, 0x84, 0xf8, 0x1e, 0xf7,
-    0xb4, 0xfb, 0x39, 0x03, 0x18, 0x0c, 0xa7, 0x0f,
-    0xb4, 0x0f, 0x17, 0x0d, 0xf1, 0x09, 0xab, 0x09,
-    0xc2, 0x0c, 0xb6, 0x12, 0x0b, 0x18, 0xcc, 0x1a,
-    0x77, 0x18, 0x35, 0x14, 0xfa, 0x0e, 0x55, 0x0d,
-    0x5a, 0x0f, 0x9e, 0x13, 0x48, 0x15, 0xad, 0x14,
-    0x8a, 0x10, 0xcf, 0x0b, 0x9d, 0x07, 0xf6, 0x04,
-    0xa0, 0x04, 0x33, 0x06, 0xb9, 0x07, 0xfe, 0x05,
-    0x9e, 0x02, 0xfc, 0xfc, 0xdb, 0xf9, 0x5d, 0xf9,
-    0x39, 0xfa, 0x13, 0xfa, 0xae, 0xf9, 0xa0, 0xf8,
-    0x6e, 0xf7, 0x2a, 0xf7, 0xb6, 0xf6, 0x11, 0xf7,
-    0xd6, 0xf7, 0xe7, 0xf8, 0x8f, 0xfa, 0x54, 0xfc,
-    0x8f, 0xfd, 0x72, 0xfe, 0x96, 0xff, 0xda, 0x00,
-    0x1a, 0x02, 0x21, 0x03, 0xbc, 0x04, 0xf9, 0x06,
-    0xee, 0x08, 0xb4, 0x0a, 0x50, 0x0b, 0x00, 0x0b,
-    0xff, 0x0b, 0x75, 0x0d, 0xa0, 0x0e, 0x5b, 0x0f,
-    0x01, 0x0f, 0x70, 0x0e, 0x53, 0x0e, 0xcd, 0x0d,
-    0x6f, 0x0c, 0x03, 0x0c, 0x62, 0x0a, 0x49, 0x09,
-    0x7c, 0x08, 0x49, 0x07, 0xce, 0x05, 0x4a, 0x04,
-    0xcb, 0x02, 0x5c, 0x01, 0xd3, 0x00, 0x60, 0xff,
-    0xbf, 0xfe, 0x90, 0xfd, 0x9b, 0xfc, 0xd2, 0xfb,
-    0x40, 0xfb, 0x83, 0xfa, 0x2b, 0xfa, 0x7d, 0xfa,
-    0x60, 0xfa, 0x21, 0xfa, 0x7a, 0xf9, 0xab, 0xf9,
-    0x8f, 0xfa, 0xe2, 0xfb, 0x78, 0xfc, 0x96, 0xfc,
-    0x71, 0xfc, 0x6e, 0xfc, 0x2c, 0xfd, 0x26, 0xfe,
-    0xa2, 0xfe, 0x16, 0xff, 0x9e, 0xff, 0xaa, 0xff,
-    0x93, 0xff, 0x14, 0xff, 0x8b, 0xfe, 0x9a, 0xfe,
-    0x7d, 0xfe, 0x2b, 0xfe, 0x60, 0xfd, 0xab, 0xfb,
-    0x38, 0xfa, 0x93, 0xf9, 0xf9, 0xf8, 0x40, 0xf8,
-    0x0a, 0xf7, 0xf9, 0xf4, 0xde, 0xf3, 0x37, 0xf2,
-    0x5c, 0xf0, 0x4d, 0xef, 0x62, 0xee, 0x9e, 0xed,
-    0xb5, 0xed, 0x6d, 0xec, 0xfd, 0xe9, 0xb3, 0xe8,
-    0xb4, 0xe7, 0xaa, 0xe8, 0x38, 0xea, 0x6c, 0xea,
-    0xa2, 0xe9, 0xff, 0xea, 0xc9, 0xed, 0x88, 0xf3,
-    0xbd, 0xf8, 0x1b, 0xfa, 0x99, 0xf8, 0x50, 0xf7,
-    0x56, 0xf9, 0x78, 0xfe, 0x53, 0x05, 0xc0, 0x09,
-    0x1e, 0x0c, 0x60, 0x0b, 0x2f, 0x0a, 0x0a, 0x09,
-    0x5e, 0x0a, 0x19, 0x0e, 0xb2, 0x12, 0xe1, 0x16,
-    0xd5, 0x17, 0x70, 0x15, 0x90, 0x11, 0xa6, 0x0f,
-    0xa0, 0x0f, 0x6e, 0x12, 0xf9, 0x14, 0x9a, 0x15,
-    0x17, 0x14, 0x41, 0x10, 0xef, 0x0b, 0xda, 0x08,
-    0xd1, 0x07, 0xda, 0x08, 0x98, 0x0a, 0x2e, 0x0a,
-    0xd8, 0x06, 0xb6, 0x01, 0x56, 0xfd, 0xc6, 0xfb,
-    0x02, 0xfc, 0x7e, 0xfc, 0xa1, 0xfc, 0x09, 0xfb,
-    0x3a, 0xf9, 0x00, 0xf7, 0xa3, 0xf5, 0xdc, 0xf5,
-    0x18, 0xf7, 0xbd, 0xf8, 0x62, 0xfa, 0xfe, 0xfa,
-    0x9f, 0xfa, 0xcc, 0xfa, 0x0b, 0xfb, 0xed, 0xfc,
-    0x75, 0xff, 0x25, 0x01, 0xcd, 0x02, 0x3e, 0x04,
-    0xfa, 0x04, 0xca, 0x06, 0xb0, 0x07, 0x5a, 0x08,
-    0xd4, 0x09, 0xcb, 0x0b, 0x2f, 0x0d, 0x72, 0x0e,
-    0x37, 0x0e, 0xbc, 0x0d, 0x74, 0x0e, 0xb4, 0x0d,
-    0x8b, 0x0d, 0x11, 0x0d, 0x7f, 0x0c, 0xf7, 0x0b,
-    0xe9, 0x0b, 0xb4, 0x0a, 0x46, 0x09, 0x76, 0x07,
-    0x46, 0x05, 0x58, 0x04, 0x8b, 0x03, 0x36, 0x03,
-    0xb5, 0x02, 0xe4, 0x01, 0x00, 0x00, 0x0d, 0xfe,
-    0x67, 0xfc, 0x98, 0xfb, 0xa9, 0xfb, 0xce, 0xfc,
-    0x7b, 0xfd, 0x7c, 0xfc, 0xde, 0xfa, 0x52, 0xf9,
-    0xfe, 0xf8, 0x2c, 0xfa, 0x99, 0xfb, 0xec, 0xfc,
-    0x09, 0xfe, 0x21, 0xfd, 0xce, 0xfb, 0xea, 0xfa,
-    0xe9, 0xfa, 0x38, 0xfc, 0x6c, 0xfe, 0xea, 0xff,
-    0xaa, 0x00, 0x93, 0xff, 0x86, 0xfd, 0x65, 0xfc,
-    0xe3, 0xfb, 0xcd, 0xfc, 0x75, 0xfe, 0xef, 0xfe,
-    0x0a, 0xfe, 0x2e, 0xfc, 0x50, 0xf9, 0xe4, 0xf7,
-    0x43, 0xf7, 0x2d, 0xf7, 0xb8, 0xf7, 0x58, 0xf7,
-    0xe8, 0xf4, 0xf1, 0xf2, 0xfe, 0xf0, 0xf8, 0xef,
-    0x1a, 0xf0, 0xa5, 0xef, 0xb4, 0xee, 0xf8, 0xed,
-    0x95, 0xec, 0x76, 0xeb, 0x98, 0xeb, 0x0e, 0xeb,
-    0xb3, 0xeb, 0x9e, 0xec, 0xa9, 0xed, 0xe4, 0xee,
-    0x8d, 0xf1, 0x3f, 0xf4, 0x93, 0xf7, 0x89, 0xf9,
-    0x9a, 0xf9, 0x6f, 0xf9, 0xad, 0xfa, 0x6f, 0xfe,
-    0xc0, 0x03, 0x85, 0x08, 0x2e, 0x0a, 0x58, 0x09,
-    0xe9, 0x07, 0xf3, 0x07, 0x98, 0x09, 0xc8, 0x0d,
-    0xa6, 0x11, 0x50, 0x14, 0xe6, 0x14, 0x86, 0x13,
-    0xa3, 0x10, 0x0d, 0x0f, 0x4e, 0x0f, 0x6a, 0x11,
-    0xc6, 0x14, 0xc8, 0x15, 0x24, 0x14, 0x4e, 0x10,
-    0x07, 0x0c, 0x56, 0x09, 0xa6, 0x09, 0x1f, 0x0b,
-    0x04, 0x0c, 0xf3, 0x0a, 0xa6, 0x07, 0x05, 0x03,
-    0x56, 0xff, 0x80, 0xfd, 0x96, 0xfd, 0x4a, 0xfe,
-    0x4a, 0xfe, 0xf8, 0xfc, 0x4b, 0xfa, 0xae, 0xf7,
-    0x13, 0xf6, 0xd1, 0xf6, 0x75, 0xf8, 0xf4, 0xf9,
-    0x7f, 0xfa, 0x33, 0xfa, 0x79, 0xf9, 0x4c, 0xf9,
-    0x3f, 0xfa, 0xfa, 0xfb, 0x77, 0xfe, 0x17, 0x01,
-    0x8e, 0x02, 0xc3, 0x02, 0x2f, 0x02, 0x1b, 0x02,
-    0x31, 0x04, 0x80, 0x07, 0x8e, 0x0a, 0x54, 0x0c,
-    0x3e, 0x0c, 0x8f, 0x0a, 0x0f, 0x0a, 0xa9, 0x0a,
-    0x0f, 0x0c, 0xdb, 0x0d, 0x8a, 0x0e, 0xe0, 0x0d,
-    0x4a, 0x0c, 0x2e, 0x0a, 0xda, 0x08, 0xb6, 0x08,
-    0x05, 0x09, 0x3c, 0x09, 0xb8, 0x08, 0x9b, 0x06,
-    0xa2, 0x04, 0x3d, 0x03, 0xb6, 0x02, 0xa6, 0x02,
-    0xbf, 0x01, 0xaf, 0x00, 0x85, 0xff, 0x84, 0xfe,
-    0xd3, 0xfd, 0x41, 0xfe, 0x9a, 0xfd, 0xfd, 0xfc,
-    0x49, 0xfc, 0x86, 0xfb, 0x5e, 0xfb, 0xc0, 0xfb,
-    0x09, 0xfc, 0xa5, 0xfc, 0xd4, 0xfc, 0xe1, 0xfb,
-    0x8a, 0xfb, 0x5a, 0xfb, 0xec, 0xfb, 0x58, 0xfd,
-    0x99, 0xfe, 0xd5, 0xfe, 0x5c, 0xfe, 0x2d, 0xfd,
-    0x8b, 0xfc, 0xa1, 0xfc, 0xfb, 0xfc, 0x00, 0xfe,
-    0x89, 0xfe, 0x03, 0xfe, 0x6f, 0xfc, 0x28, 0xfa,
-    0x03, 0xf9, 0x2c, 0xf9, 0x1e, 0xfa, 0x8b, 0xfa,
-    0xae, 0xf9, 0xe3, 0xf6, 0xef, 0xf4, 0x22, 0xf3,
-    0xe3, 0xf2, 0xae, 0xf2, 0x09, 0xf2, 0xbb, 0xf1,
-    0x9e, 0xf0, 0xc0, 0xee, 0xa5, 0xec, 0xc5, 0xeb,
-    0xca, 0xea, 0xee, 0xec, 0x26, 0xed, 0xe9, 0xec,
-    0x60, 0xec, 0x9c, 0xec, 0x8b, 0xef, 0x30, 0xf4,
-    0x38, 0xf6, 0x7b, 0xf5, 0x57, 0xf5, 0xaa, 0xf4,
-    0xf7, 0xf7, 0x22, 0xfd, 0x5f, 0x01, 0x92, 0x03,
-    0x9f, 0x04, 0x2f, 0x03, 0x0c, 0x03, 0x0b, 0x04,
-    0x63, 0x06, 0x56, 0x0b, 0xfb, 0x0f, 0xe7, 0x11,
-    0x88, 0x10, 0x7f, 0x0e, 0xeb, 0x0b, 0x34, 0x0d,
-    0x7c, 0x10, 0x88, 0x14, 0xf5, 0x15, 0x83, 0x14,
-    0x0c, 0x12, 0x76, 0x0e, 0xba, 0x0c, 0x4e, 0x0c,
-    0xea, 0x0d, 0x38, 0x0f, 0xfc, 0x0e, 0x8d, 0x0b,
-    0x5a, 0x07, 0xd9, 0x03, 0xae, 0x01, 0xb6, 0x02,
-    0x70, 0x03, 0x5b, 0x02, 0xdb, 0xff, 0xbb, 0xfc,
-    0x6e, 0xfa, 0x90, 0xf9, 0x34, 0xf9, 0x1f, 0xfa,
-    0xbb, 0xfa, 0xa6, 0xf9, 0xab, 0xf8, 0xcc, 0xf7,
-    0xf0, 0xf6, 0x0f, 0xf8, 0x43, 0xfa, 0x0f, 0xfc,
-    0x7a, 0xfd, 0xc8, 0xfc, 0x4b, 0xfc, 0xdb, 0xfd,
-    0xf7, 0xff, 0xac, 0x01, 0x88, 0x03, 0xe3, 0x04,
-    0x37, 0x05, 0x4d, 0x06, 0xeb, 0x06, 0xe2, 0x07,
-    0xdb, 0x08, 0x13, 0x0a, 0x17, 0x0b, 0x2f, 0x0b,
-    0xba, 0x0a, 0xf4, 0x09, 0x9b, 0x0a, 0x25, 0x0b,
-    0x7c, 0x0b, 0x91, 0x0a, 0x56, 0x09, 0x5d, 0x08,
-    0x14, 0x07, 0x49, 0x07, 0xb8, 0x07, 0xea, 0x06,
-    0x8d, 0x05, 0x00, 0x04, 0x5f, 0x02, 0x22, 0x01,
-    0x4c, 0x01, 0x4e, 0x01, 0xb0, 0x01, 0xb0, 0x00,
-    0xfd, 0xfd, 0x49, 0xfc, 0x54, 0xfb, 0x54, 0xfc,
-    0x86, 0xfd, 0x18, 0xfe, 0x0b, 0xfd, 0x5f, 0xfb,
-    0x08, 0xfa, 0x06, 0xfa, 0xb7, 0xfa, 0xbf, 0xfb,
-    0x62, 0xfd, 0xc4, 0xfd, 0x8e, 0xfc, 0x6d, 0xfb,
-    0x74, 0xfa, 0x5e, 0xfa, 0x37, 0xfc, 0x9a, 0xfd,
-    0x8a, 0xfe, 0xd3, 0xfd, 0xd6, 0xfb, 0x13, 0xfa,
-    0x60, 0xfa, 0x1e, 0xfb, 0xd2, 0xfb, 0x66, 0xfc,
-    0xe6, 0xfb, 0xd1, 0xfa, 0xed, 0xf8, 0x9d, 0xf7,
-    0x12, 0xf7, 0xd4, 0xf6, 0x2a, 0xf7, 0x28, 0xf7,
-    0x87, 0xf5, 0x6a, 0xf3, 0xa8, 0xf1, 0xa3, 0xf0,
-    0x8f, 0xf1, 0xde, 0xf0, 0xaf, 0xef, 0x64, 0xef,
-    0xf2, 0xee, 0x1a, 0xee, 0x25, 0xee, 0xdd, 0xed,
-    0xfd, 0xec, 0x80, 0xee, 0x87, 0xf0, 0xe4, 0xf4,
-    0x11, 0xf7, 0x4a, 0xf6, 0x83, 0xf4, 0x78, 0xf4,
-    0x0c, 0xf6, 0x61, 0xfa, 0xd7, 0xff, 0x68, 0x03,
-    0xd2, 0x03, 0xe5, 0x01, 0x33, 0x00, 0x8a, 0x00,
-    0x85, 0x03, 0x00, 0x08, 0xe7, 0x0d, 0x02, 0x10,
-    0x40, 0x0f, 0xfd, 0x0b, 0x61, 0x0a, 0x5c, 0x0a,
-    0xd7, 0x0d, 0x89, 0x12, 0x99, 0x15, 0x8a, 0x15,
-    0xae, 0x11, 0xf8, 0x0d, 0xc0, 0x0b, 0xf3, 0x0b,
-    0x4f, 0x0e, 0x1e, 0x11, 0x1b, 0x11, 0x11, 0x0e,
-    0xe3, 0x08, 0xba, 0x04, 0xe1, 0x02, 0xe1, 0x03,
-    0x8c, 0x05, 0x62, 0x06, 0xc0, 0x03, 0x8c, 0xff,
-    0xa7, 0xfb, 0x8a, 0xf9, 0x18, 0xfa, 0xdf, 0xfb,
-    0x6e, 0xfd, 0x29, 0xfd, 0xb8, 0xfa, 0xfc, 0xf7,
-    0xd7, 0xf6, 0x74, 0xf7, 0x9c, 0xf9, 0xd8, 0xfb,
-    0x84, 0xfd, 0x65, 0xfd, 0x7d, 0xfc, 0xbc, 0xfb,
-    0xc5, 0xfc, 0x99, 0xfe, 0x73, 0x01, 0xa9, 0x03,
-    0x15, 0x05, 0x0f, 0x05, 0x3f, 0x04, 0x51, 0x04,
-    0x09, 0x06, 0x1a, 0x08, 0x70, 0x09, 0x8a, 0x0a,
-    0xb9, 0x09, 0x09, 0x09, 0x2a, 0x08, 0xf5, 0x08,
-    0xff, 0x09, 0xb8, 0x0a, 0x51, 0x0a, 0x61, 0x09,
-    0xf1, 0x07, 0x60, 0x06, 0x97, 0x06, 0x8a, 0x07,
-    0x23, 0x08, 0xd8, 0x06, 0x9a, 0x04, 0xef, 0x02,
-    0x60, 0x02, 0x3e, 0x02, 0x5f, 0x03, 0x80, 0x03,
-    0xf9, 0x01, 0xf7, 0xff, 0x8d, 0xfe, 0xa9, 0xfd,
-    0xba, 0xfd, 0xa7, 0xfe, 0x47, 0xff, 0xb9, 0xff,
-    0x0e, 0xfe, 0xb4, 0xfb, 0x76, 0xfa, 0x8c, 0xfa,
-    0x33, 0xfc, 0x70, 0xfe, 0x61, 0xff, 0xb0, 0xfd,
-    0x76, 0xfb, 0x3f, 0xfa, 0x65, 0xfa, 0xa5, 0xfb,
-    0x5e, 0xfd, 0xbd, 0xfe, 0xa4, 0xfe, 0x92, 0xfc,
-    0x3d, 0xfa, 0xf7, 0xf8, 0xe5, 0xf8, 0xa4, 0xfa,
-    0xcb, 0xfc, 0x38, 0xfd, 0x6c, 0xfb, 0x96, 0xf8,
-    0x7e, 0xf6, 0x70, 0xf6, 0xe4, 0xf6, 0xf2, 0xf6,
-    0xe0, 0xf7, 0x30, 0xf7, 0xfd, 0xf4, 0xd8, 0xf3,
-    0x12, 0xf2, 0x38, 0xf1, 0xf3, 0xf0, 0xdd, 0xf1,
-    0x54, 0xf2, 0xf3, 0xf1, 0x20, 0xf0, 0xc5, 0xee,
-    0xdb, 0xee, 0xb3, 0xee, 0x64, 0xf0, 0x2c, 0xf3,
-    0xa0, 0xf6, 0x19, 0xf8, 0xa1, 0xf7, 0xe3, 0xf5,
-    0x98, 0xf4, 0x96, 0xf5, 0xb1, 0xfa, 0x28, 0x00,
-    0xad, 0x03, 0xee, 0x02, 0x96, 0x00, 0x2b, 0xff,
-    0x94, 0xff, 0x58, 0x03, 0x22, 0x08, 0xbf, 0x0c,
-    0xf4, 0x0d, 0xff, 0x0d, 0xa0, 0x0b, 0xd3, 0x09,
-    0x20, 0x0a, 0xf8, 0x0c, 0x3d, 0x12, 0x03, 0x15,
-    0xb9, 0x14, 0xaf, 0x11, 0x67, 0x0e, 0x11, 0x0c,
-    0xcc, 0x0c, 0x83, 0x0f, 0x43, 0x11, 0xf0, 0x10,
-    0x94, 0x0e, 0xda, 0x0a, 0xec, 0x06, 0xe4, 0x04,
-    0x61, 0x05, 0x25, 0x07, 0x6f, 0x07, 0x64, 0x05,
-    0x65, 0x01, 0xea, 0xfd, 0x91, 0xfb, 0x1b, 0xfc,
-    0x1f, 0xfe, 0x33, 0xff, 0x1a, 0xfe, 0x93, 0xfb,
-    0xa1, 0xf9, 0x20, 0xf8, 0x89, 0xf8, 0x12, 0xfa,
-    0x3c, 0xfc, 0x43, 0xfd, 0x71, 0xfd, 0x7b, 0xfc,
-    0xa1, 0xfb, 0xf5, 0xfb, 0x4a, 0xfd, 0x55, 0x00,
-    0xd8, 0x02, 0x22, 0x04, 0xe7, 0x03, 0x15, 0x03,
-    0x7c, 0x02, 0x7c, 0x03, 0x76, 0x05, 0xcb, 0x07,
-    0x58, 0x09, 0x54, 0x09, 0x64, 0x08, 0x91, 0x07,
-    0x08, 0x07, 0xb8, 0x07, 0xf8, 0x08, 0xcf, 0x09,
-    0x8c, 0x0a, 0x43, 0x09, 0xd3, 0x07, 0x58, 0x06,
-    0x44, 0x06, 0x8e, 0x06, 0x5f, 0x07, 0x26, 0x07,
-    0x0f, 0x06, 0xec, 0x04, 0x31, 0x03, 0x03, 0x03,
-    0xe2, 0x02, 0xe5, 0x02, 0x70, 0x02, 0xe7, 0x01,
-    0xc5, 0x00, 0x0b, 0x00, 0x65, 0xff, 0x19, 0xff,
-    0x45, 0xff, 0x26, 0xff, 0x5e, 0xfe, 0x69, 0xfd,
-    0xd8, 0xfc, 0x73, 0xfc, 0x1f, 0xfd, 0x48, 0xfd,
-    0x3d, 0xfd, 0x51, 0xfc, 0x83, 0xfb, 0x1c, 0xfb,
-    0x5e, 0xfb, 0xb5, 0xfb, 0xd7, 0xfb, 0x51, 0xfc,
-    0x7c, 0xfb, 0x6a, 0xfa, 0x3a, 0xf9, 0xc5, 0xf8,
-    0x75, 0xf9, 0x81, 0xfa, 0xcc, 0xfa, 0xaa, 0xfa,
-    0xdd, 0xf8, 0x45, 0xf6, 0xc7, 0xf5, 0x5c, 0xf6,
-    0xff, 0xf6, 0x54, 0xf7, 0x54, 0xf6, 0xa5, 0xf4,
-    0x76, 0xf3, 0x49, 0xf2, 0x26, 0xf2, 0x70, 0xf2,
-    0xf0, 0xf1, 0xf0, 0xf1, 0xf0, 0xf1, 0xf5, 0xf0,
-    0xb0, 0xef, 0x64, 0xee, 0x4f, 0xef, 0xe3, 0xf1,
-    0xe7, 0xf4, 0x98, 0xf7, 0x0d, 0xf8, 0x80, 0xf5,
-    0x96, 0xf3, 0x59, 0xf4, 0x3c, 0xf7, 0xf8, 0xfb,
-    0x24, 0xff, 0x88, 0x00, 0x47, 0x00, 0x77, 0xfe,
-    0x3a, 0xfd, 0x23, 0xff, 0x89, 0x02, 0x1b, 0x07,
-    0x1f, 0x0b, 0xaf, 0x0c, 0x31, 0x0b, 0x37, 0x08,
-    0x61, 0x07, 0xc1, 0x09, 0x96, 0x0e, 0x50, 0x12,
-    0x4b, 0x14, 0x90, 0x12, 0x7f, 0x0f, 0xb9, 0x0c,
-    0xc7, 0x0c, 0x28, 0x0f, 0x6e, 0x11, 0xb3, 0x12,
-    0xc2, 0x11, 0xa6, 0x0e, 0x0a, 0x0a, 0x60, 0x07,
-    0x4c, 0x07, 0x2d, 0x09, 0xd3, 0x09, 0xaa, 0x08,
-    0x70, 0x05, 0x84, 0x01, 0x55, 0xfe, 0x13, 0xfe,
-    0x31, 0xff, 0x29, 0x00, 0xb8, 0xff, 0xe7, 0xfd,
-    0xd8, 0xfb, 0xb2, 0xf9, 0x08, 0xf9, 0xbb, 0xf9,
-    0xa4, 0xfb, 0x68, 0xfc, 0xa3, 0xfc, 0xd1, 0xfb,
-    0xcf, 0xfa, 0x9c, 0xfa, 0x03, 0xfc, 0x6b, 0xfe,
-    0x5f, 0x00, 0x33, 0x01, 0x4a, 0x01, 0xc4, 0x00,
-    0xda, 0x00, 0x97, 0x01, 0xa8, 0x03, 0xb3, 0x05,
-    0x5b, 0x06, 0x7c, 0x06, 0xdd, 0x05, 0x8b, 0x05,
-    0x87, 0x05, 0x19, 0x07, 0x0e, 0x08, 0x26, 0x09,
-    0xe9, 0x08, 0xda, 0x07, 0x69, 0x07, 0x6f, 0x06,
-    0x49, 0x06, 0x38, 0x07, 0xb0, 0x07, 0x46, 0x07,
-    0x75, 0x06, 0x01, 0x05, 0x1b, 0x04, 0xd9, 0x03,
-    0xca, 0x03, 0xff, 0x03, 0xad, 0x03, 0xfe, 0x01,
-    0x50, 0x01, 0xae, 0x00, 0x72, 0x00, 0x5c, 0x00,
-    0xd8, 0xff, 0x91, 0xff, 0xa3, 0xfe, 0xb5, 0xfd,
-    0x10, 0xfd, 0x43, 0xfd, 0x73, 0xfd, 0xa7, 0xfd,
-    0x61, 0xfd, 0x59, 0xfc, 0x13, 0xfb, 0x4f, 0xfa,
-    0x12, 0xfb, 0x1a, 0xfc, 0x3b, 0xfc, 0x9e, 0xfb,
-    0x54, 0xfa, 0x1d, 0xf9, 0xab, 0xf8, 0x2d, 0xf9,
-    0x03, 0xfa, 0x18, 0xfa, 0xfa, 0xf9, 0xe7, 0xf8,
-    0x28, 0xf8, 0x37, 0xf7, 0xd3, 0xf6, 0xb4, 0xf7,
-    0xe1, 0xf8, 0xb5, 0xf8, 0x78, 0xf7, 0x75, 0xf6,
-    0x46, 0xf4, 0x88, 0xf4, 0x38, 0xf5, 0x4d, 0xf6,
-    0x1c, 0xf6, 0xa3, 0xf4, 0x1c, 0xf3, 0x42, 0xf2,
-    0x5a, 0xf2, 0xa9, 0xf2, 0xe0, 0xf3, 0xa5, 0xf3,
-    0x9d, 0xf3, 0xd2, 0xf2, 0x93, 0xf3, 0x80, 0xf5,
-    0x95, 0xf7, 0x3f, 0xf9, 0xd2, 0xf9, 0xfb, 0xf7,
-    0x20, 0xf7, 0x4c, 0xf8, 0xf5, 0xfa, 0x3e, 0xff,
-    0x75, 0x01, 0xd0, 0x01, 0xe4, 0xff, 0xc2, 0xfe,
-    0xa7, 0xfe, 0xcd, 0x01, 0x3a, 0x05, 0xc3, 0x08,
-    0xfb, 0x0a, 0x1a, 0x0a, 0x7c, 0x08, 0x92, 0x06,
-    0xc6, 0x07, 0xcb, 0x0a, 0xea, 0x0e, 0x6a, 0x11,
-    0x47, 0x11, 0x57, 0x0e, 0x2c, 0x0b, 0x55, 0x0a,
-    0xc3, 0x0b, 0x2a, 0x0e, 0xed, 0x0f, 0xcc, 0x0f,
-    0x39, 0x0d, 0x94, 0x09, 0x9f, 0x06, 0xf9, 0x05,
-    0xd4, 0x06, 0x5e, 0x08, 0x29, 0x08, 0xa3, 0x06,
-    0xdf, 0x02, 0x73, 0xff, 0x5b, 0xfe, 0xd8, 0xfe,
-    0x59, 0x00, 0xdb, 0x00, 0xf1, 0xff, 0x77, 0xfd,
-    0x73, 0xfb, 0xe2, 0xf9, 0xa2, 0xfa, 0x5c, 0xfc,
-    0xd0, 0xfd, 0x5d, 0xfe, 0x51, 0xfd, 0xa1, 0xfb,
-    0xfa, 0xfa, 0x4e, 0xfc, 0x7e, 0xfe, 0xba, 0x00,
-    0xab, 0x01, 0x5e, 0x01, 0xcd, 0xff, 0x7d, 0xff,
-    0xa8, 0x00, 0xe0, 0x02, 0xc1, 0x04, 0xbf, 0x05,
-    0x5a, 0x05, 0x5c, 0x04, 0x88, 0x03, 0x73, 0x03,
-    0x82, 0x05, 0x44, 0x07, 0x23, 0x08, 0xc5, 0x07,
-    0xc5, 0x06, 0x28, 0x05, 0xb3, 0x04, 0xb4, 0x05,
-    0x16, 0x07, 0xbf, 0x07, 0x32, 0x07, 0x0b, 0x06,
-    0xbd, 0x04, 0xe2, 0x03, 0xed, 0x03, 0xd5, 0x04,
-    0x51, 0x05, 0xc5, 0x04, 0x6c, 0x03, 0x42, 0x02,
-    0x2a, 0x01, 0xee, 0x00, 0x58, 0x01, 0xed, 0x01,
-    0x60, 0x01, 0xde, 0xff, 0x5a, 0xfe, 0xb1, 0xfd,
-    0x8e, 0xfd, 0x04, 0xfe, 0x84, 0xfe, 0xe4, 0xfd,
-    0xa7, 0xfc, 0x30, 0xfb, 0x36, 0xfa, 0xed, 0xf9,
-    0xaa, 0xfa, 0x04, 0xfb, 0x3f, 0xfb, 0x41, 0xfa,
-    0x89, 0xf8, 0x65, 0xf7, 0x16, 0xf7, 0x93, 0xf7,
-    0x9b, 0xf8, 0xde, 0xf8, 0x1f, 0xf8, 0x09, 0xf7,
-    0x0c, 0xf6, 0xd1, 0xf5, 0x1b, 0xf6, 0x52, 0xf6,
-    0x92, 0xf6, 0x74, 0xf6, 0x97, 0xf5, 0x31, 0xf5,
-    0x6d, 0xf4, 0x36, 0xf4, 0xa6, 0xf4, 0xf0, 0xf4,
-    0x88, 0xf4, 0xdb, 0xf3, 0x19, 0xf3, 0xc0, 0xf3,
-    0x28, 0xf4, 0xe1, 0xf3, 0xa2, 0xf3, 0x94, 0xf3,
-    0x77, 0xf4, 0x23, 0xf7, 0xc4, 0xf9, 0x5f, 0xfa,
-    0x24, 0xf9, 0x81, 0xf6, 0xc3, 0xf6, 0x7e, 0xf9,
-    0xd4, 0xfc, 0xc5, 0xff, 0x42, 0x01, 0x54, 0x00,
-    0xb0, 0xfe, 0xf0, 0xfd, 0x47, 0xff, 0x3c, 0x02,
-    0xa2, 0x05, 0xe6, 0x08, 0x53, 0x0a, 0xcf, 0x08,
-    0x5c, 0x06, 0xb9, 0x05, 0x1f, 0x08, 0x5d, 0x0c,
-    0x6f, 0x0f, 0xbd, 0x10, 0xca, 0x0f, 0xba, 0x0c,
-    0xd4, 0x0a, 0xbe, 0x0b, 0xbf, 0x0d, 0xce, 0x0f,
-    0xa6, 0x10, 0x31, 0x10, 0xcd, 0x0d, 0x57, 0x0a,
-    0xcb, 0x07, 0x1e, 0x08, 0xdd, 0x09, 0xce, 0x0a,
-    0xf9, 0x09, 0x29, 0x07, 0x73, 0x03, 0x71, 0x00,
-    0x41, 0x00, 0xfe, 0x01, 0xe8, 0x02, 0xdc, 0x01,
-    0xc2, 0xff, 0x45, 0xfd, 0xb0, 0xfb, 0x15, 0xfb,
-    0x01, 0xfc, 0x73, 0xfd, 0x3a, 0xfe, 0x8e, 0xfd,
-    0x3f, 0xfc, 0x0d, 0xfb, 0x5e, 0xfa, 0xbb, 0xfb,
-    0x39, 0xfe, 0x3d, 0x00, 0x60, 0x00, 0x24, 0xff,
-    0xd3, 0xfd, 0x14, 0xfe, 0x98, 0xff, 0x7d, 0x01,
-    0x31, 0x03, 0xba, 0x03, 0x0a, 0x03, 0x56, 0x02,
-    0x32, 0x02, 0xc6, 0x02, 0x16, 0x04, 0x89, 0x05,
-    0x9c, 0x06, 0x96, 0x06, 0x7c, 0x05, 0x22, 0x04,
-    0xf9, 0x03, 0x66, 0x05, 0xff, 0x06, 0x6e, 0x07,
-    0xf1, 0x06, 0xba, 0x05, 0x69, 0x04, 0x55, 0x04,
-    0x1d, 0x05, 0xf6, 0x05, 0x47, 0x06, 0x78, 0x05,
-    0x62, 0x04, 0x6d, 0x03, 0xa2, 0x02, 0x5a, 0x02,
-    0x0f, 0x03, 0xac, 0x03, 0x36, 0x03, 0xd8, 0x01,
-    0x4d, 0x00, 0x59, 0xff, 0x05, 0xff, 0xe0, 0xff,
-    0x89, 0x00, 0xce, 0xff, 0x80, 0xfe, 0xe2, 0xfc,
-    0x19, 0xfc, 0x10, 0xfc, 0x4a, 0xfc, 0x8a, 0xfc,
-    0x94, 0xfc, 0xae, 0xfb, 0x2b, 0xfa, 0x79, 0xf9,
-    0xcb, 0xf8, 0xed, 0xf8, 0xb0, 0xf9, 0x55, 0xfa,
-    0xff, 0xf9, 0xa0, 0xf8, 0x2f, 0xf7, 0xc7, 0xf6,
-    0x5d, 0xf7, 0x1d, 0xf8, 0xb8, 0xf8, 0x39, 0xf8,
-    0x33, 0xf7, 0x17, 0xf6, 0xf5, 0xf5, 0x01, 0xf6,
-    0x5d, 0xf6, 0x5a, 0xf6, 0x60, 0xf6, 0x26, 0xf6,
-    0xfb, 0xf4, 0x98, 0xf4, 0x32, 0xf4, 0xc7, 0xf4,
-    0x63, 0xf5, 0xaa, 0xf5, 0xe3, 0xf4, 0xb6, 0xf4,
-    0x4c, 0xf5, 0x00, 0xf7, 0x79, 0xf9, 0xc1, 0xf9,
-    0xa2, 0xf8, 0x5f, 0xf7, 0x1f, 0xf7, 0xdb, 0xf8,
-    0x4b, 0xfc, 0xf0, 0xfd, 0xe3, 0xfe, 0xce, 0xfe,
-    0x14, 0xfe, 0xcc, 0xfd, 0x91, 0xfe, 0x66, 0x00,
-    0x31, 0x03, 0x04, 0x06, 0x0f, 0x07, 0x46, 0x07,
-    0xc0, 0x05, 0xca, 0x04, 0x46, 0x06, 0x7b, 0x09,
-    0xc0, 0x0c, 0xc0, 0x0d, 0x15, 0x0d, 0x01, 0x0c,
-    0x0f, 0x0b, 0xea, 0x0a, 0x16, 0x0c, 0xec, 0x0d,
-    0xaa, 0x0e, 0x99, 0x0e, 0x33, 0x0d, 0x5c, 0x0b,
-    0x72, 0x09, 0x83, 0x08, 0x85, 0x09, 0xaf, 0x0a,
-    0x45, 0x0a, 0x1b, 0x08, 0x53, 0x05, 0x4d, 0x03,
-    0x6f, 0x02, 0x48, 0x02, 0x08, 0x03, 0xe7, 0x02,
-    0x81, 0x01, 0x9f, 0xff, 0x48, 0xfe, 0x0e, 0xfd,
-    0x0a, 0xfd, 0xd2, 0xfd, 0xf0, 0xfe, 0x9e, 0xff,
-    0x53, 0xfe, 0xad, 0xfc, 0xf2, 0xfb, 0xbe, 0xfc,
-    0x41, 0xfe, 0x0b, 0x00, 0xaf, 0x00, 0x19, 0x00,
-    0xf4, 0xfe, 0x6c, 0xfe, 0x66, 0xff, 0x08, 0x01,
-    0x41, 0x02, 0xff, 0x02, 0x13, 0x03, 0x97, 0x02,
-    0x08, 0x02, 0x10, 0x02, 0xf9, 0x02, 0x5d, 0x04,
-    0x85, 0x05, 0xa7, 0x05, 0x4e, 0x05, 0x4a, 0x04,
-    0xe8, 0x03, 0x59, 0x04, 0x6e, 0x05, 0x33, 0x06,
-    0x3e, 0x06, 0xb5, 0x05, 0x1b, 0x05, 0xdc, 0x04,
-    0xd3, 0x04, 0x27, 0x05, 0x16, 0x05, 0xd2, 0x04,
-    0x9d, 0x04, 0x32, 0x04, 0xa6, 0x03, 0x6b, 0x03,
-    0xff, 0x02, 0xdd, 0x02, 0x99, 0x02, 0xe1, 0x01,
-    0x0f, 0x01, 0x87, 0x00, 0x19, 0x00, 0x2d, 0x00,
-    0x43, 0x00, 0x99, 0xff, 0xae, 0xfe, 0xc2, 0xfd,
-    0x14, 0xfd, 0xe8, 0xfc, 0xf2, 0xfc, 0xcb, 0xfc,
-    0x69, 0xfc, 0x83, 0xfb, 0xaf, 0xfa, 0x0b, 0xfa,
-    0xae, 0xf9, 0x84, 0xf9, 0xc8, 0xf9, 0xdf, 0xf9,
-    0x70, 0xf9, 0x8d, 0xf8, 0xab, 0xf7, 0x34, 0xf7,
-    0x4f, 0xf7, 0xb4, 0xf7, 0x18, 0xf8, 0x13, 0xf8,
-    0x75, 0xf7, 0xc1, 0xf6, 0x6a, 0xf6, 0x6e, 0xf6,
-    0x8c, 0xf6, 0xdf, 0xf6, 0x00, 0xf7, 0xd2, 0xf6,
-    0x9e, 0xf6, 0x5d, 0xf6, 0x20, 0xf6, 0xfb, 0xf5,
-    0xe2, 0xf5, 0x47, 0xf6, 0x99, 0xf6, 0xe1, 0xf6,
-    0xcc, 0xf6, 0x15, 0xf7, 0x0d, 0xf7, 0x7d, 0xf7,
-    0xaa, 0xf8, 0xe9, 0xf9, 0xd5, 0xfa, 0xde, 0xfa,
-    0x97, 0xfa, 0x7c, 0xfa, 0x43, 0xfb, 0x45, 0xfc,
-    0x22, 0xfe, 0xc4, 0xff, 0x69, 0x00, 0x36, 0x00,
-    0x59, 0x00, 0x56, 0x00, 0x2a, 0x01, 0xc6, 0x02,
-    0xb4, 0x04, 0x73, 0x06, 0x0b, 0x07, 0xc0, 0x06,
-    0x23, 0x06, 0x84, 0x06, 0x7a, 0x07, 0x48, 0x09,
-    0x0e, 0x0b, 0xb8, 0x0b, 0x1a, 0x0b, 0x53, 0x0a,
-    0xe2, 0x09, 0xdf, 0x09, 0x67, 0x0a, 0x62, 0x0b,
-    0x86, 0x0b, 0x3b, 0x0b, 0x07, 0x0a, 0x80, 0x08,
-    0xa4, 0x07, 0x2b, 0x07, 0x4a, 0x07, 0x70, 0x07,
-    0xfb, 0x06, 0x73, 0x05, 0xdb, 0x03, 0xa5, 0x02,
-    0x12, 0x02, 0xfd, 0x01, 0xf6, 0x01, 0xbf, 0x01,
-    0xfa, 0x00, 0xa6, 0xff, 0xe3, 0xfe, 0x30, 0xfe,
-    0x62, 0xfe, 0x0c, 0xff, 0xa2, 0xff, 0xd2, 0xff,
-    0x45, 0xff, 0x81, 0xfe, 0x3e, 0xfe, 0xfa, 0xfe,
-    0xcf, 0xff, 0xcf, 0x00, 0x50, 0x01, 0x1f, 0x01,
-    0xa5, 0x00, 0x7e, 0x00, 0xbd, 0x00, 0xab, 0x01,
-    0x86, 0x02, 0x3f, 0x03, 0x63, 0x03, 0x23, 0x03,
-    0x96, 0x02, 0x72, 0x02, 0xfd, 0x02, 0xa2, 0x03,
-    0x62, 0x04, 0x60, 0x04, 0x37, 0x04, 0xcd, 0x03,
-    0x76, 0x03, 0x5a, 0x03, 0xa8, 0x03, 0x15, 0x04,
-    0x66, 0x04, 0x84, 0x04, 0x0b, 0x04, 0xa6, 0x03,
-    0x11, 0x03, 0xd5, 0x02, 0x05, 0x03, 0x26, 0x03,
-    0x1f, 0x03, 0xc9, 0x02, 0x5f, 0x02, 0xc8, 0x01,
-    0x5d, 0x01, 0xd4, 0x00, 0x9c, 0x00, 0x70, 0x00,
-    0x36, 0x00, 0xf2, 0xff, 0x5a, 0xff, 0xce, 0xfe,
-    0x39, 0xfe, 0xe8, 0xfd, 0xc0, 0xfd, 0x5b, 0xfd,
-    0xe3, 0xfc, 0x74, 0xfc, 0x0b, 0xfc, 0xcc, 0xfb,
-    0x7b, 0xfb, 0x25, 0xfb, 0xc7, 0xfa, 0x77, 0xfa,
-    0x22, 0xfa, 0xf0, 0xf9, 0xb0, 0xf9, 0x61, 0xf9,
-    0x46, 0xf9, 0x16, 0xf9, 0x13, 0xf9, 0xda, 0xf8,
-    0x92, 0xf8, 0x73, 0xf8, 0x5b, 0xf8, 0x69, 0xf8,
-    0x5e, 0xf8, 0x48, 0xf8, 0x3f, 0xf8, 0x38, 0xf8,
-    0x7e, 0xf8, 0xa9, 0xf8, 0xc3, 0xf8, 0xa8, 0xf8,
-    0x6f, 0xf8, 0x7c, 0xf8, 0xaf, 0xf8, 0xed, 0xf8,
-    0xf5, 0xf8, 0x62, 0xf9, 0x6a, 0xf9, 0xcf, 0xf9,
-    0x5c, 0xfa, 0xe0, 0xfa, 0x54, 0xfb, 0x5e, 0xfb,
-    0x7a, 0xfb, 0xb1, 0xfb, 0x0f, 0xfc, 0x4e, 0xfc,
-    0xec, 0xfc, 0x8f, 0xfd, 0x2f, 0xfe, 0x81, 0xfe,
-    0xcd, 0xfe, 0x3f, 0xff, 0x94, 0xff, 0x0e, 0x00,
-    0xcf, 0x00, 0x82, 0x01, 0xf9, 0x01, 0x48, 0x02,
-    0xa8, 0x02, 0x3d, 0x03, 0xe1, 0x03, 0x5d, 0x04,
-    0xd4, 0x04, 0x38, 0x05, 0x97, 0x05, 0xd3, 0x05,
-    0x1b, 0x06, 0x69, 0x06, 0x89, 0x06, 0xc7, 0x06,
-    0xe4, 0x06, 0xea, 0x06, 0xde, 0x06, 0xa8, 0x06,
-    0x50, 0x06, 0x47, 0x06, 0x22, 0x06, 0xe8, 0x05,
-    0xa3, 0x05, 0x2e, 0x05, 0xf3, 0x04, 0xab, 0x04,
-    0x4f, 0x04, 0x17, 0x04, 0xce, 0x03, 0x51, 0x03,
-    0x07, 0x03, 0xcd, 0x02, 0x8e, 0x02, 0x6c, 0x02,
-    0x2b, 0x02, 0x2e, 0x02, 0x1f, 0x02, 0xf0, 0x01,
-    0xd2, 0x01, 0xc6, 0x01, 0xb5, 0x01, 0xb8, 0x01,
-    0xe7, 0x01, 0xfe, 0x01, 0x04, 0x02, 0xda, 0x01,
-    0xe7, 0x01, 0xfe, 0x01, 0x08, 0x02, 0x0d, 0x02,
-    0x1d, 0x02, 0x30, 0x02, 0x21, 0x02, 0x25, 0x02,
-    0x2f, 0x02, 0x30, 0x02, 0x13, 0x02, 0x14, 0x02,
-    0x2b, 0x02, 0x22, 0x02, 0x11, 0x02, 0xfd, 0x01,
-    0xf4, 0x01, 0xe4, 0x01, 0xde, 0x01, 0xd0, 0x01,
-    0xd8, 0x01, 0xd7, 0x01, 0xb8, 0x01, 0xb9, 0x01,
-    0xaa, 0x01, 0x80, 0x01, 0x6f, 0x01, 0x66, 0x01,
-    0x44, 0x01, 0x2c, 0x01, 0x0c, 0x01, 0xe4, 0x00,
-    0xd7, 0x00, 0xaa, 0x00, 0x7f, 0x00, 0x52, 0x00,
-    0x1b, 0x00, 0xf6, 0xff, 0xd2, 0xff, 0xb4, 0xff,
-    0x77, 0xff, 0x37, 0xff, 0xf1, 0xfe, 0xb1, 0xfe,
-    0x80, 0xfe, 0x5a, 0xfe, 0x2b, 0xfe, 0xe5, 0xfd,
-    0xb3, 0xfd, 0x6a, 0xfd, 0x37, 0xfd, 0x09, 0xfd,
-    0xc9, 0xfc, 0xa7, 0xfc, 0x7f, 0xfc, 0x51, 0xfc,
-    0x21, 0xfc, 0xed, 0xfb, 0xa7, 0xfb, 0x73, 0xfb,
-    0x63, 0xfb, 0x4d, 0xfb, 0x29, 0xfb, 0xf6, 0xfa,
-    0xc0, 0xfa, 0x99, 0xfa, 0x7f, 0xfa, 0x5d, 0xfa,
-    0x36, 0xfa, 0x23, 0xfa, 0x15, 0xfa, 0x08, 0xfa,
-    0x07, 0xfa, 0xe2, 0xf9, 0xb5, 0xf9, 0x9a, 0xf9,
-    0xa8, 0xf9, 0xba, 0xf9, 0xae, 0xf9, 0x9c, 0xf9,
-    0x82, 0xf9, 0x98, 0xf9, 0xdc, 0xf9, 0x15, 0xfa,
-    0x36, 0xfa, 0x48, 0xfa, 0x57, 0xfa, 0x5a, 0xfa,
-    0x7c, 0xfa, 0x96, 0xfa, 0xc8, 0xfa, 0x0b, 0xfb,
-    0x57, 0xfb, 0xb4, 0xfb, 0xf6, 0xfb, 0x45, 0xfc,
-    0x8d, 0xfc, 0x0e, 0xfd, 0xb1, 0xfd, 0x34, 0xfe,
-    0x9b, 0xfe, 0x0d, 0xff, 0x95, 0xff, 0x18, 0x00,
-    0xb7, 0x00, 0x42, 0x01, 0xcc, 0x01, 0x51, 0x02,
-    0xc7, 0x02, 0x56, 0x03, 0xbb, 0x03, 0x13, 0x04,
-    0x56, 0x04, 0xa7, 0x04, 0x08, 0x05, 0x3e, 0x05,
-    0x61, 0x05, 0x79, 0x05, 0x95, 0x05, 0x9f, 0x05,
-    0xc1, 0x05, 0xcb, 0x05, 0xc3, 0x05, 0xb7, 0x05,
-    0x99, 0x05, 0x86, 0x05, 0x64, 0x05, 0x4a, 0x05,
-    0x41, 0x05, 0x3b, 0x05, 0x2f, 0x05, 0x0c, 0x05,
-    0xdb, 0x04, 0xb7, 0x04, 0x9c, 0x04, 0x93, 0x04,
-    0x95, 0x04, 0x82, 0x04, 0x61, 0x04, 0x47, 0x04,
-    0x41, 0x04, 0x3b, 0x04, 0x3e, 0x04, 0x2b, 0x04,
-    0x28, 0x04, 0x1d, 0x04, 0xfd, 0x03, 0xea, 0x03,
-    0xc5, 0x03, 0xc1, 0x03, 0xb4, 0x03, 0xb0, 0x03,
-    0x8b, 0x03, 0x62, 0x03, 0x24, 0x03, 0xed, 0x02,
-    0xe0, 0x02, 0xd8, 0x02, 0xc5, 0x02, 0x90, 0x02,
-    0x60, 0x02, 0x29, 0x02, 0x03, 0x02, 0xce, 0x01,
-    0xaa, 0x01, 0x85, 0x01, 0x60, 0x01, 0x2b, 0x01,
-    0xfa, 0x00, 0xc9, 0x00, 0x9a, 0x00, 0x76, 0x00,
-    0x5e, 0x00, 0x50, 0x00, 0x2c, 0x00, 0xf1, 0xff,
-    0xc0, 0xff, 0xa2, 0xff, 0x8a, 0xff, 0x7c, 0xff,
-    0x67, 0xff, 0x55, 0xff, 0x2d, 0xff, 0x0a, 0xff,
-    0xd6, 0xfe, 0xba, 0xfe, 0xaa, 0xfe, 0x98, 0xfe,
-    0x8a, 0xfe, 0x6f, 0xfe, 0x42, 0xfe, 0x04, 0xfe,
-    0xeb, 0xfd, 0xce, 0xfd, 0xbc, 0xfd, 0xb7, 0xfd,
-    0x9e, 0xfd, 0x80, 0xfd, 0x67, 0xfd, 0x40, 0xfd,
-    0x19, 0xfd, 0xfa, 0xfc, 0xef, 0xfc, 0xe2, 0xfc,
-    0xe7, 0xfc, 0xcf, 0xfc, 0xaa, 0xfc, 0x8e, 0xfc,
-    0x77, 0xfc, 0x7b, 0xfc, 0x78, 0xfc, 0x78, 0xfc,
-    0x6b, 0xfc, 0x6a, 0xfc, 0x5e, 0xfc, 0x57, 0xfc,
-    0x49, 0xfc, 0x46, 0xfc, 0x45, 0xfc, 0x4e, 0xfc,
-    0x49, 0xfc, 0x44, 0xfc, 0x36, 0xfc, 0x30, 0xfc,
-    0x43, 0xfc, 0x60, 0xfc, 0x7f, 0xfc, 0x7e, 0xfc,
-    0x96, 0xfc, 0x91, 0xfc, 0x9f, 0xfc, 0xab, 0xfc,
-    0xc9, 0xfc, 0xf0, 0xfc, 0x20, 0xfd, 0x47, 0xfd,
-    0x57, 0xfd, 0x67, 0xfd, 0x69, 0xfd, 0x86, 0xfd,
-    0xbe, 0xfd, 0xff, 0xfd, 0x38, 0xfe, 0x6b, 0xfe,
-    0x97, 0xfe, 0xba, 0xfe, 0xe0, 0xfe, 0x1c, 0xff,
-    0x60, 0xff, 0x9f, 0xff, 0xe0, 0xff, 0x16, 0x00,
-    0x40, 0x00, 0x5d, 0x00, 0x7c, 0x00, 0xad, 0x00,
-    0xdd, 0x00, 0x12, 0x01, 0x3c, 0x01, 0x64, 0x01,
-    0x84, 0x01, 0x9a, 0x01, 0xaa, 0x01, 0xd3, 0x01,
-    0xf4, 0x01, 0x04, 0x02, 0x1e, 0x02, 0x37, 0x02,
-    0x4a, 0x02, 0x64, 0x02, 0x7e, 0x02, 0x9c, 0x02,
-    0xc2, 0x02, 0xd8, 0x02, 0xe5, 0x02, 0xf5, 0x02,
-    0x08, 0x03, 0x18, 0x03, 0x36, 0x03, 0x5c, 0x03,
-    0x7d, 0x03, 0x8d, 0x03, 0x9c, 0x03, 0xa6, 0x03,
-    0xb8, 0x03, 0xcc, 0x03, 0xd3, 0x03, 0xd6, 0x03,
-    0xdd, 0x03, 0xdb, 0x03, 0xd8, 0x03, 0xd8, 0x03,
-    0xde, 0x03, 0xe9, 0x03, 0xe9, 0x03, 0xdb, 0x03,
-    0xc7, 0x03, 0xac, 0x03, 0x93, 0x03, 0x8b, 0x03,
-    0x89, 0x03, 0x7e, 0x03, 0x62, 0x03, 0x38, 0x03,
-    0x13, 0x03, 0x02, 0x03, 0xed, 0x02, 0xd3, 0x02,
-    0xb8, 0x02, 0x99, 0x02, 0x7e, 0x02, 0x5d, 0x02,
-    0x38, 0x02, 0x12, 0x02, 0xf2, 0x01, 0xd9, 0x01,
-    0xbf, 0x01, 0x9f, 0x01, 0x79, 0x01, 0x4d, 0x01,
-    0x1c, 0x01, 0xf1, 0x00, 0xd3, 0x00, 0xb8, 0x00,
-    0x97, 0x00, 0x75, 0x00, 0x4e, 0x00, 0x2a, 0x00,
-    0x03, 0x00, 0xe0, 0xff, 0xb3, 0xff, 0x8a, 0xff,
-    0x69, 0xff, 0x43, 0xff, 0x21, 0xff, 0xfa, 0xfe,
-    0xcc, 0xfe, 0xa1, 0xfe, 0x7f, 0xfe, 0x53, 0xfe,
-    0x29, 0xfe, 0x02, 0xfe, 0xd8, 0xfd, 0xb7, 0xfd,
-    0x9d, 0xfd, 0x7a, 0xfd, 0x52, 0xfd, 0x28, 0xfd,
-    0x09, 0xfd, 0xf5, 0xfc, 0xe9, 0xfc, 0xd5, 0xfc,
-    0xbc, 0xfc, 0x9f, 0xfc, 0x87, 0xfc, 0x80, 0xfc,
-    0x7a, 0xfc, 0x74, 0xfc, 0x6f, 0xfc, 0x68, 0xfc,
-    0x67, 0xfc, 0x6b, 0xfc, 0x67, 0xfc, 0x66, 0xfc,
-    0x73, 0xfc, 0x7a, 0xfc, 0x82, 0xfc, 0x8e, 0xfc,
-    0x93, 0xfc, 0x9e, 0xfc, 0xb4, 0xfc, 0xc8, 0xfc,
-    0xd4, 0xfc, 0xea, 0xfc, 0xfa, 0xfc, 0x0e, 0xfd,
-    0x25, 0xfd, 0x43, 0xfd, 0x5d, 0xfd, 0x79, 0xfd,
-    0x95, 0xfd, 0xa8, 0xfd, 0xca, 0xfd, 0xf0, 0xfd,
-    0x08, 0xfe, 0x2e, 0xfe, 0x58, 0xfe, 0x78, 0xfe,
-    0x9b, 0xfe, 0xc6, 0xfe, 0xf1, 0xfe, 0x0f, 0xff,
-    0x30, 0xff, 0x4f, 0xff, 0x77, 0xff, 0x9a, 0xff,
-    0xb8, 0xff, 0xd8, 0xff, 0xf7, 0xff, 0x16, 0x00,
-    0x30, 0x00, 0x49, 0x00, 0x65, 0x00, 0x80, 0x00,
-    0x99, 0x00, 0xb0, 0x00, 0xc4, 0x00, 0xd6, 0x00,
-    0xec, 0x00, 0x08, 0x01, 0x22, 0x01, 0x35, 0x01,
-    0x51, 0x01, 0x65, 0x01, 0x79, 0x01, 0x91, 0x01,
-    0xac, 0x01, 0xbf, 0x01, 0xdd, 0x01, 0xf7, 0x01,
-    0x11, 0x02, 0x31, 0x02, 0x3e, 0x02, 0x57, 0x02,
-    0x70, 0x02, 0x90, 0x02, 0xa0, 0x02, 0xb8, 0x02,
-    0xd0, 0x02, 0xe2, 0x02, 0xf5, 0x02, 0x02, 0x03,
-    0x10, 0x03, 0x19, 0x03, 0x1c, 0x03, 0x21, 0x03,
-    0x29, 0x03, 0x2d, 0x03, 0x31, 0x03, 0x2d, 0x03,
-    0x2a, 0x03, 0x22, 0x03, 0x1e, 0x03, 0x13, 0x03,
-    0x0c, 0x03, 0x04, 0x03, 0xf2, 0x02, 0xe5, 0x02,
-    0xd0, 0x02, 0xb5, 0x02, 0x9d, 0x02, 0x8a, 0x02,
-    0x79, 0x02, 0x62, 0x02, 0x4f, 0x02, 0x2f, 0x02,
-    0x1d, 0x02, 0x00, 0x02, 0xde, 0x01, 0xc1, 0x01,
-    0xa3, 0x01, 0x89, 0x01, 0x69, 0x01, 0x52, 0x01,
-    0x2e, 0x01, 0x14, 0x01, 0xfc, 0x00, 0xe0, 0x00,
-    0xc8, 0x00, 0xa6, 0x00, 0x82, 0x00, 0x64, 0x00,
-    0x4c, 0x00, 0x2d, 0x00, 0x11, 0x00, 0xf3, 0xff,
-    0xd7, 0xff, 0xb6, 0xff, 0x97, 0xff, 0x7a, 0xff,
-    0x5b, 0xff, 0x3e, 0xff, 0x21, 0xff, 0x0c, 0xff,
-    0xf6, 0xfe, 0xd6, 0xfe, 0xb4, 0xfe, 0x9a, 0xfe,
-    0x82, 0xfe, 0x6c, 0xfe, 0x55, 0xfe, 0x41, 0xfe,
-    0x25, 0xfe, 0x11, 0xfe, 0xfd, 0xfd, 0xe6, 0xfd,
-    0xd0, 0xfd, 0xbf, 0xfd, 0xab, 0xfd, 0x9c, 0xfd,
-    0x90, 0xfd, 0x7d, 0xfd, 0x6d, 0xfd, 0x5a, 0xfd,
-    0x52, 0xfd, 0x46, 0xfd, 0x3a, 0xfd, 0x29, 0xfd,
-    0x20, 0xfd, 0x18, 0xfd, 0x11, 0xfd, 0x09, 0xfd,
-    0x01, 0xfd, 0xfc, 0xfc, 0xf8, 0xfc, 0xf7, 0xfc,
-    0xf2, 0xfc, 0xf0, 0xfc, 0xf0, 0xfc, 0xed, 0xfc,
-    0xf0, 0xfc, 0xf7, 0xfc, 0xf3, 0xfc, 0xf7, 0xfc,
-    0xfc, 0xfc, 0x08, 0xfd, 0x1e, 0xfd, 0x29, 0xfd,
-    0x3c, 0xfd, 0x58, 0xfd, 0x6d, 0xfd, 0x84, 0xfd,
-    0x9e, 0xfd, 0xbe, 0xfd, 0xdd, 0xfd, 0xfc, 0xfd,
-    0x1b, 0xfe, 0x3d, 0xfe, 0x5d, 0xfe, 0x80, 0xfe,
-    0xa0, 0xfe, 0xba, 0xfe, 0xd6, 0xfe, 0xfc, 0xfe,
-    0x29, 0xff, 0x4f, 0xff, 0x71, 0xff, 0x8f, 0xff,
-    0xac, 0xff, 0xc9, 0xff, 0xe9, 0xff, 0x06, 0x00,
-    0x20, 0x00, 0x3d, 0x00, 0x51, 0x00, 0x6d, 0x00,
-    0x8b, 0x00, 0xa8, 0x00, 0xc7, 0x00, 0xe5, 0x00,
-    0x01, 0x01, 0x1d, 0x01, 0x31, 0x01, 0x4c, 0x01,
-    0x65, 0x01, 0x77, 0x01, 0x93, 0x01, 0xae, 0x01,
-    0xc7, 0x01, 0xdf, 0x01, 0xf3, 0x01, 0x05, 0x02,
-    0x18, 0x02, 0x29, 0x02, 0x3f, 0x02, 0x4d, 0x02,
-    0x59, 0x02, 0x60, 0x02, 0x68, 0x02, 0x71, 0x02,
-    0x72, 0x02, 0x77, 0x02, 0x7c, 0x02, 0x7b, 0x02,
-    0x74, 0x02, 0x73, 0x02, 0x70, 0x02, 0x6b, 0x02,
-    0x63, 0x02, 0x59, 0x02, 0x4b, 0x02, 0x3f, 0x02,
-    0x38, 0x02, 0x2e, 0x02, 0x20, 0x02, 0x11, 0x02,
-    0xfe, 0x01, 0xf0, 0x01, 0xe1, 0x01, 0xcd, 0x01,
-    0xb9, 0x01, 0xa3, 0x01, 0x8d, 0x01, 0x77, 0x01,
-    0x64, 0x01, 0x4f, 0x01, 0x35, 0x01, 0x1d, 0x01,
-    0x05, 0x01, 0xee, 0x00, 0xd8, 0x00, 0xbf, 0x00,
-    0xa6, 0x00, 0x8e, 0x00, 0x76, 0x00, 0x5d, 0x00,
-    0x42, 0x00, 0x2c, 0x00, 0x15, 0x00, 0xfb, 0xff,
-    0xe6, 0xff, 0xcc, 0xff, 0xb4, 0xff, 0x9d, 0xff,
-    0x85, 0xff, 0x70, 0xff, 0x5a, 0xff, 0x3e, 0xff,
-    0x27, 0xff, 0x0d, 0xff, 0xfa, 0xfe, 0xec, 0xfe,
-    0xd9, 0xfe, 0xc4, 0xfe, 0xae, 0xfe, 0x9f, 0xfe,
-    0x8b, 0xfe, 0x7c, 0xfe, 0x68, 0xfe, 0x55, 0xfe,
-    0x48, 0xfe, 0x39, 0xfe, 0x2b, 0xfe, 0x1f, 0xfe,
-    0x13, 0xfe, 0x08, 0xfe, 0xfd, 0xfd, 0xf8, 0xfd,
-    0xf0, 0xfd, 0xe6, 0xfd, 0xdf, 0xfd, 0xd7, 0xfd,
-    0xce, 0xfd, 0xc9, 0xfd, 0xc4, 0xfd, 0xc4, 0xfd,
-    0xc4, 0xfd, 0xbe, 0xfd, 0xc3, 0xfd, 0xc4, 0xfd,
-    0xc9, 0xfd, 0xcd, 0xfd, 0xd0, 0xfd, 0xd9, 0xfd,
-    0xe2, 0xfd, 0xed, 0xfd, 0xf8, 0xfd, 0x06, 0xfe,
-    0x19, 0xfe, 0x21, 0xfe, 0x2b, 0xfe, 0x40, 0xfe,
-    0x4f, 0xfe, 0x64, 0xfe, 0x78, 0xfe, 0x8f, 0xfe,
-    0xa5, 0xfe, 0xbc, 0xfe, 0xd5, 0xfe, 0xf0, 0xfe,
-    0x09, 0xff, 0x1d, 0xff, 0x31, 0xff, 0x47, 0xff,
-    0x63, 0xff, 0x80, 0xff, 0x9d, 0xff, 0xae, 0xff,
-    0xbe, 0xff, 0xd2, 0xff, 0xe6, 0xff, 0xff, 0xff,
-    0x12, 0x00, 0x22, 0x00, 0x31, 0x00, 0x42, 0x00,
-    0x52, 0x00, 0x65, 0x00, 0x80, 0x00, 0x98, 0x00,
-    0xac, 0x00, 0xbf, 0x00, 0xd4, 0x00, 0xeb, 0x00,
-    0x00, 0x01, 0x16, 0x01, 0x2d, 0x01, 0x45, 0x01,
-    0x5a, 0x01, 0x6c, 0x01, 0x7a, 0x01, 0x90, 0x01,
-    0xa2, 0x01, 0xb5, 0x01, 0xc9, 0x01, 0xda, 0x01,
-    0xeb, 0x01, 0xff, 0x01, 0x0e, 0x02, 0x1a, 0x02,
-    0x26, 0x02, 0x2b, 0x02, 0x39, 0x02, 0x46, 0x02,
-    0x4d, 0x02, 0x51, 0x02, 0x56, 0x02, 0x5e, 0x02,
-    0x5e, 0x02, 0x63, 0x02, 0x61, 0x02, 0x61, 0x02,
-    0x59, 0x02, 0x54, 0x02, 0x50, 0x02, 0x4c, 0x02,
-    0x45, 0x02, 0x3d, 0x02, 0x36, 0x02, 0x2a, 0x02,
-    0x21, 0x02, 0x14, 0x02, 0x03, 0x02, 0xf0, 0x01,
-    0xe4, 0x01, 0xd5, 0x01, 0xc3, 0x01, 0xb3, 0x01,
-    0xa5, 0x01, 0x8f, 0x01, 0x79, 0x01, 0x6a, 0x01,
-    0x55, 0x01, 0x42, 0x01, 0x2f, 0x01, 0x1d, 0x01,
-    0x0b, 0x01, 0xfc, 0x00, 0xe5, 0x00, 0xd0, 0x00,
-    0xbc, 0x00, 0xa6, 0x00, 0x96, 0x00, 0x84, 0x00,
-    0x71, 0x00, 0x5f, 0x00, 0x52, 0x00, 0x3b, 0x00,
-    0x26, 0x00, 0x12, 0x00, 0x02, 0x00, 0xf1, 0xff,
-    0xdd, 0xff, 0xca, 0xff, 0xb9, 0xff, 0xac, 0xff,
-    0x9a, 0xff, 0x8a, 0xff, 0x7b, 0xff, 0x68, 0xff,
-    0x53, 0xff, 0x44, 0xff, 0x34, 0xff, 0x21, 0xff,
-    0x15, 0xff, 0x07, 0xff, 0xf9, 0xfe, 0xec, 0xfe,
-    0xe0, 0xfe, 0xd0, 0xfe, 0xc2, 0xfe, 0xba, 0xfe,
-    0xab, 0xfe, 0xa4, 0xfe, 0x9e, 0xfe, 0x93, 0xfe,
-    0x8c, 0xfe, 0x89, 0xfe, 0x7d, 0xfe, 0x77, 0xfe,
-    0x75, 0xfe, 0x6e, 0xfe, 0x6d, 0xfe, 0x69, 0xfe,
-    0x67, 0xfe, 0x64, 0xfe, 0x6a, 0xfe, 0x6b, 0xfe,
-    0x6b, 0xfe, 0x6f, 0xfe, 0x76, 0xfe, 0x7a, 0xfe,
-    0x82, 0xfe, 0x8e, 0xfe, 0x92, 0xfe, 0x96, 0xfe,
-    0x9e, 0xfe, 0xac, 0xfe, 0xb1, 0xfe, 0xbd, 0xfe,
-    0xc7, 0xfe, 0xd2, 0xfe, 0xe2, 0xfe, 0xed, 0xfe,
-    0xf8, 0xfe, 0x07, 0xff, 0x19, 0xff, 0x28, 0xff,
-    0x37, 0xff, 0x44, 0xff, 0x54, 0xff, 0x67, 0xff,
-    0x79, 0xff, 0x84, 0xff, 0x96, 0xff, 0xaa, 0xff,
-    0xb9, 0xff, 0xc8, 0xff, 0xda, 0xff, 0xe9, 0xff,
-    0xf3, 0xff, 0x06, 0x00, 0x1a, 0x00, 0x23, 0x00,
-    0x30, 0x00, 0x45, 0x00, 0x53, 0x00, 0x61, 0x00,
-    0x6f, 0x00, 0x82, 0x00, 0x91, 0x00, 0x9e, 0x00,
-    0xae, 0x00, 0xbb, 0x00, 0xcd, 0x00, 0xd8, 0x00,
-    0xe9, 0x00, 0xf5, 0x00, 0xff, 0x00, 0x0c, 0x01,
-    0x18, 0x01, 0x23, 0x01, 0x28, 0x01, 0x33, 0x01,
-    0x39, 0x01, 0x41, 0x01, 0x48, 0x01, 0x4b, 0x01,
-    0x49, 0x01, 0x51, 0x01, 0x5f, 0x01, 0x64, 0x01,
-    0x65, 0x01, 0x69, 0x01, 0x67, 0x01, 0x68, 0x01,
-    0x6b, 0x01, 0x69, 0x01, 0x70, 0x01, 0x70, 0x01,
-    0x6a, 0x01, 0x6a, 0x01, 0x64, 0x01, 0x5c, 0x01,
-    0x5d, 0x01, 0x58, 0x01, 0x50, 0x01, 0x49, 0x01,
-    0x45, 0x01, 0x41, 0x01, 0x2f, 0x01, 0x28, 0x01,
-    0x1f, 0x01, 0x17, 0x01, 0x08, 0x01, 0xf5, 0x00,
-    0xf3, 0x00, 0xe6, 0x00, 0xd8, 0x00, 0xce, 0x00,
-    0xbc, 0x00, 0xb0, 0x00, 0xa6, 0x00, 0x96, 0x00,
-    0x89, 0x00, 0x77, 0x00, 0x66, 0x00, 0x59, 0x00,
-    0x4d, 0x00, 0x3f, 0x00, 0x33, 0x00, 0x27, 0x00,
-    0x19, 0x00, 0x0f, 0x00, 0xfa, 0xff, 0xee, 0xff,
-    0xe4, 0xff, 0xd3, 0xff, 0xc6, 0xff, 0xb4, 0xff,
-    0xa5, 0xff, 0x93, 0xff, 0x84, 0xff, 0x75, 0xff,
-    0x6c, 0xff, 0x5f, 0xff, 0x53, 0xff, 0x44, 0xff,
-    0x37, 0xff, 0x2f, 0xff, 0x1d, 0xff, 0x14, 0xff,
-    0x0a, 0xff, 0xfe, 0xfe, 0xf9, 0xfe, 0xeb, 0xfe,
-    0xe0, 0xfe, 0xd9, 0xfe, 0xcd, 0xfe, 0xc8, 0xfe,
-    0xbd, 0xfe, 0xb2, 0xfe, 0xaa, 0xfe, 0xa4, 0xfe,
-    0xa3, 0xfe, 0xa4, 0xfe, 0x9f, 0xfe, 0x9a, 0xfe,
-    0x97, 0xfe, 0x93, 0xfe, 0x95, 0xfe, 0x94, 0xfe,
-    0x94, 0xfe, 0x94, 0xfe, 0x92, 0xfe, 0x97, 0xfe,
-    0x99, 0xfe, 0x9a, 0xfe, 0x9f, 0xfe, 0xa8, 0xfe,
-    0xb0, 0xfe, 0xb2, 0xfe, 0xb6, 0xfe, 0xbb, 0xfe,
-    0xc4, 0xfe, 0xcb, 0xfe, 0xd0, 0xfe, 0xdd, 0xfe,
-    0xe0, 0xfe, 0xee, 0xfe, 0xfb, 0xfe, 0x05, 0xff,
-    0x0f, 0xff, 0x16, 0xff, 0x22, 0xff, 0x30, 0xff,
-    0x3e, 0xff, 0x4a, 0xff, 0x5b, 0xff, 0x5f, 0xff,
-    0x6d, 0xff, 0x7c, 0xff, 0x89, 0xff, 0x98, 0xff,
-    0x9e, 0xff, 0xb1, 0xff, 0xc0, 0xff, 0xcc, 0xff,
-    0xd0, 0xff, 0xe2, 0xff, 0xef, 0xff, 0xfa, 0xff,
-    0x07, 0x00, 0x16, 0x00, 0x2b, 0x00, 0x31, 0x00,
-    0x3e, 0x00, 0x4f, 0x00, 0x58, 0x00, 0x61, 0x00,
-    0x73, 0x00, 0x7d, 0x00, 0x89, 0x00, 0x92, 0x00,
-    0x97, 0x00, 0xa6, 0x00, 0xb0, 0x00, 0xc0, 0x00,
-    0xc4, 0x00, 0xcc, 0x00, 0xd7, 0x00, 0xd8, 0x00,
-    0xde, 0x00, 0xe2, 0x00, 0xea, 0x00, 0xf4, 0x00,
-    0xf5, 0x00, 0xf3, 0x00, 0xf5, 0x00, 0xfa, 0x00,
-    0xfd, 0x00, 0x02, 0x01, 0x02, 0x01, 0x01, 0x01,
-    0xfc, 0x00, 0xfa, 0x00, 0xf7, 0x00, 0xf6, 0x00,
-    0xf6, 0x00, 0xf6, 0x00, 0xf5, 0x00, 0xf0, 0x00,
-    0xea, 0x00, 0xe5, 0x00, 0xe1, 0x00, 0xdb, 0x00,
-    0xd6, 0x00, 0xce, 0x00, 0xc7, 0x00, 0xc1, 0x00,
-    0xb9, 0x00, 0xb1, 0x00, 0xaa, 0x00, 0xa3, 0x00,
-    0x99, 0x00, 0x91, 0x00, 0x8a, 0x00, 0x7f, 0x00,
-    0x73, 0x00, 0x6a, 0x00, 0x60, 0x00, 0x56, 0x00,
-    0x4e, 0x00, 0x43, 0x00, 0x39, 0x00, 0x32, 0x00,
-    0x26, 0x00, 0x1a, 0x00, 0x10, 0x00, 0x03, 0x00,
-    0xf8, 0xff, 0xeb, 0xff, 0xde, 0xff, 0xd7, 0xff,
-    0xc9, 0xff, 0xbf, 0xff, 0xb2, 0xff, 0xa7, 0xff,
-    0x9e, 0xff, 0x91, 0xff, 0x84, 0xff, 0x77, 0xff,
-    0x6c, 0xff, 0x60, 0xff, 0x55, 0xff, 0x4c, 0xff,
-    0x44, 0xff, 0x3a, 0xff, 0x33, 0xff, 0x2b, 0xff,
-    0x1e, 0xff, 0x18, 0xff, 0x10, 0xff, 0x07, 0xff,
-    0x01, 0xff, 0xf8, 0xfe, 0xf8, 0xfe, 0xf2, 0xfe,
-    0xf0, 0xfe, 0xed, 0xfe, 0xe4, 0xfe, 0xe2, 0xfe,
-    0xde, 0xfe, 0xd9, 0xfe, 0xd5, 0xfe, 0xd1, 0xfe,
-    0xcc, 0xfe, 0xd3, 0xfe, 0xce, 0xfe, 0xc9, 0xfe,
-    0xca, 0xfe, 0xce, 0xfe, 0xd4, 0xfe, 0xd1, 0xfe,
-    0xd3, 0xfe, 0xdb, 0xfe, 0xdf, 0xfe, 0xe4, 0xfe,
-    0xe6, 0xfe, 0xef, 0xfe, 0xee, 0xfe, 0xf2, 0xfe,
-    0xff, 0xfe, 0x05, 0xff, 0x0e, 0xff, 0x14, 0xff,
-    0x1f, 0xff, 0x21, 0xff, 0x27, 0xff, 0x34, 0xff,
-    0x39, 0xff, 0x43, 0xff, 0x4c, 0xff, 0x5a, 0xff,
-    0x5b, 0xff, 0x67, 0xff, 0x73, 0xff, 0x80, 0xff,
-    0x89, 0xff, 0x8e, 0xff, 0x9d, 0xff, 0xa5, 0xff,
-    0xb5, 0xff, 0xc1, 0xff, 0xcd, 0xff, 0xdd, 0xff,
-    0xec, 0xff, 0xf3, 0xff, 0xfb, 0xff, 0x06, 0x00,
-    0x10, 0x00, 0x17, 0x00, 0x25, 0x00, 0x34, 0x00,
-    0x40, 0x00, 0x4f, 0x00, 0x51, 0x00, 0x58, 0x00,
-    0x63, 0x00, 0x71, 0x00, 0x7b, 0x00, 0x81, 0x00,
-    0x8b, 0x00, 0x94, 0x00, 0x9a, 0x00, 0xa5, 0x00,
-    0xac, 0x00, 0xac, 0x00, 0xb2, 0x00, 0xba, 0x00,
-    0xbd, 0x00, 0xc2, 0x00, 0xc4, 0x00, 0xc8, 0x00,
-    0xc9, 0x00, 0xcf, 0x00, 0xd0, 0x00, 0xcf, 0x00,
-    0xd6, 0x00, 0xd9, 0x00, 0xd4, 0x00, 0xd1, 0x00,
-    0xd2, 0x00, 0xd7, 0x00, 0xd8, 0x00, 0xd9, 0x00,
-    0xd6, 0x00, 0xd4, 0x00, 0xd3, 0x00, 0xce, 0x00,
-    0xcc, 0x00, 0xca, 0x00, 0xc8, 0x00, 0xc0, 0x00,
-    0xba, 0x00, 0xb6, 0x00, 0xb6, 0x00, 0xb4, 0x00,
-    0xad, 0x00, 0xa6, 0x00, 0xa2, 0x00, 0x99, 0x00,
-    0x93, 0x00, 0x91, 0x00, 0x86, 0x00, 0x80, 0x00,
-    0x7b, 0x00, 0x75, 0x00, 0x6d, 0x00, 0x5f, 0x00,
-    0x58, 0x00, 0x54, 0x00, 0x52, 0x00, 0x4c, 0x00,
-    0x40, 0x00, 0x38, 0x00, 0x2f, 0x00, 0x2b, 0x00,
-    0x21, 0x00, 0x1a, 0x00, 0x11, 0x00, 0x0c, 0x00,
-    0x02, 0x00, 0xfd, 0xff, 0xf6, 0xff, 0xee, 0xff,
-    0xed, 0xff, 0xe3, 0xff, 0xd9, 0xff, 0xd4, 0xff,
-    0xcf, 0xff, 0xc7, 0xff, 0xbf, 0xff, 0xb9, 0xff,
-    0xb1, 0xff, 0xa9, 0xff, 0xab, 0xff, 0xa8, 0xff,
-    0x9f, 0xff, 0x98, 0xff, 0x97, 0xff, 0x8b, 0xff,
-    0x8b, 0xff, 0x8d, 0xff, 0x85, 0xff, 0x7a, 0xff,
-    0x7e, 0xff, 0x7d, 0xff, 0x78, 0xff, 0x75, 0xff,
-    0x72, 0xff, 0x7a, 0xff, 0x76, 0xff, 0x79, 0xff,
-    0x77, 0xff, 0x7a, 0xff, 0x7e, 0xff, 0x7f, 0xff,
-    0x83, 0xff, 0x87, 0xff, 0x8c, 0xff, 0x92, 0xff,
-    0x98, 0xff, 0x96, 0xff, 0x9b, 0xff, 0xa0, 0xff,
-    0xa6, 0xff, 0xab, 0xff, 0xb5, 0xff, 0xb8, 0xff,
-    0xbd, 0xff, 0xc8, 0xff, 0xcc, 0xff, 0xd2, 0xff,
-    0xd6, 0xff, 0xd8, 0xff, 0xe3, 0xff, 0xef, 0xff,
-    0xf3, 0xff, 0xf7, 0xff, 0xfb, 0xff, 0x02, 0x00,
-    0x0b, 0x00, 0x14, 0x00, 0x1a, 0x00, 0x21, 0x00,
-    0x28, 0x00, 0x30, 0x00, 0x38, 0x00, 0x41, 0x00,
-    0x48, 0x00, 0x4d, 0x00, 0x57, 0x00, 0x61, 0x00,
-    0x67, 0x00, 0x6b, 0x00, 0x71, 0x00, 0x7b, 0x00,
-    0x85, 0x00, 0x8d, 0x00, 0x94, 0x00, 0x99, 0x00,
-    0x9d, 0x00, 0xa5, 0x00, 0xa7, 0x00, 0xb1, 0x00,
-    0xb2, 0x00, 0xbb, 0x00, 0xc3, 0x00, 0xc2, 0x00,
-    0xca, 0x00, 0xcd, 0x00, 0xd3, 0x00, 0xd4, 0x00,
-    0xd6, 0x00, 0xd7, 0x00, 0xdc, 0x00, 0xe2, 0x00,
-    0xe7, 0x00, 0xe3, 0x00, 0xe7, 0x00, 0xf2, 0x00,
-    0xef, 0x00, 0xeb, 0x00, 0xf0, 0x00, 0xec, 0x00,
-    0xf0, 0x00, 0xf1, 0x00, 0xe4, 0x00, 0xeb, 0x00,
-    0xe9, 0x00, 0xe5, 0x00, 0xe4, 0x00, 0xe4, 0x00,
-    0xde, 0x00, 0xdc, 0x00, 0xda, 0x00, 0xd5, 0x00,
-    0xd2, 0x00, 0xcd, 0x00, 0xca, 0x00, 0xc1, 0x00,
-    0xbb, 0x00, 0xb5, 0x00, 0xb5, 0x00, 0xa9, 0x00,
-    0x9f, 0x00, 0x9d, 0x00, 0x95, 0x00, 0x8a, 0x00,
-    0x87, 0x00, 0x85, 0x00, 0x78, 0x00, 0x72, 0x00,
-    0x66, 0x00, 0x63, 0x00, 0x5b, 0x00, 0x50, 0x00,
-    0x48, 0x00, 0x3b, 0x00, 0x36, 0x00, 0x2d, 0x00,
-    0x28, 0x00, 0x1e, 0x00, 0x1b, 0x00, 0x0f, 0x00,
-    0xff, 0xff, 0xf7, 0xff, 0xf2, 0xff, 0xee, 0xff,
-    0xe4, 0xff, 0xe0, 0xff, 0xd7, 0xff, 0xd1, 0xff,
-    0xc8, 0xff, 0xbe, 0xff, 0xb6, 0xff, 0xb0, 0xff,
-    0xa6, 0xff, 0x9b, 0xff, 0x97, 0xff, 0x90, 0xff,
-    0x88, 0xff, 0x85, 0xff, 0x80, 0xff, 0x7a, 0xff,
-    0x73, 0xff, 0x6d, 0xff, 0x68, 0xff, 0x67, 0xff,
-    0x67, 0xff, 0x64, 0xff, 0x60, 0xff, 0x56, 0xff,
-    0x54, 0xff, 0x51, 0xff, 0x53, 0xff, 0x50, 0xff,
-    0x4d, 0xff, 0x4a, 0xff, 0x48, 0xff, 0x4b, 0xff,
-    0x47, 0xff, 0x46, 0xff, 0x48, 0xff, 0x4b, 0xff,
-    0x4b, 0xff, 0x4c, 0xff, 0x4b, 0xff, 0x4e, 0xff,
-    0x4e, 0xff, 0x50, 0xff, 0x52, 0xff, 0x56, 0xff,
-    0x5c, 0xff, 0x5d, 0xff, 0x61, 0xff, 0x63, 0xff,
-    0x68, 0xff, 0x6e, 0xff, 0x73, 0xff, 0x75, 0xff,
-    0x7d, 0xff, 0x81, 0xff, 0x85, 0xff, 0x8b, 0xff,
-    0x8d, 0xff, 0x95, 0xff, 0x99, 0xff, 0xa5, 0xff,
-    0xaa, 0xff, 0xab, 0xff, 0xb0, 0xff, 0xb5, 0xff,
-    0xc1, 0xff, 0xc8, 0xff, 0xce, 0xff, 0xd1, 0xff,
-    0xda, 0xff, 0xdf, 0xff, 0xe4, 0xff, 0xe9, 0xff,
-    0xf0, 0xff, 0xf4, 0xff, 0xf9, 0xff, 0x00, 0x00,
-    0x04, 0x00, 0x09, 0x00, 0x10, 0x00, 0x13, 0x00,
-    0x19, 0x00, 0x1e, 0x00, 0x20, 0x00, 0x2c, 0x00,
-    0x32, 0x00, 0x31, 0x00, 0x37, 0x00, 0x3f, 0x00,
-    0x42, 0x00, 0x47, 0x00, 0x50, 0x00, 0x50, 0x00,
-    0x55, 0x00, 0x57, 0x00, 0x54, 0x00, 0x5b, 0x00,
-    0x5c, 0x00, 0x60, 0x00, 0x5f, 0x00, 0x61, 0x00,
-    0x60, 0x00, 0x59, 0x00, 0x5a, 0x00, 0x57, 0x00,
-    0x5d, 0x00, 0x5d, 0x00, 0x5c, 0x00, 0x56, 0x00,
-    0x58, 0x00, 0x54, 0x00, 0x54, 0x00, 0x57, 0x00,
-    0x52, 0x00, 0x4f, 0x00, 0x4c, 0x00, 0x4e, 0x00,
-    0x49, 0x00, 0x43, 0x00, 0x3b, 0x00, 0x36, 0x00,
-    0x36, 0x00, 0x34, 0x00, 0x2f, 0x00, 0x29, 0x00,
-    0x25, 0x00, 0x1d, 0x00, 0x12, 0x00, 0x10, 0x00,
-    0x0c, 0x00, 0x07, 0x00, 0x02, 0x00, 0xfd, 0xff,
-    0xf8, 0xff, 0xf0, 0xff, 0xea, 0xff, 0xe5, 0xff,
-    0xe3, 0xff, 0xdb, 0xff, 0xd5, 0xff, 0xd2, 0xff,
-    0xce, 0xff, 0xc8, 0xff, 0xc1, 0xff, 0xbf, 0xff,
-    0xbc, 0xff, 0xb2, 0xff, 0xb3, 0xff, 0xad, 0xff,
-    0xa6, 0xff, 0x9f, 0xff, 0x9d, 0xff, 0x9a, 0xff,
-    0x96, 0xff, 0x94, 0xff, 0x89, 0xff, 0x84, 0xff,
-    0x81, 0xff, 0x83, 0xff, 0x7d, 0xff, 0x77, 0xff,
-    0x74, 0xff, 0x71, 0xff, 0x70, 0xff, 0x70, 0xff,
-    0x6b, 0xff, 0x6b, 0xff, 0x6e, 0xff, 0x6b, 0xff,
-    0x6a, 0xff, 0x69, 0xff, 0x6d, 0xff, 0x70, 0xff,
-    0x71, 0xff, 0x6e, 0xff, 0x6b, 0xff, 0x6b, 0xff,
-    0x66, 0xff, 0x69, 0xff, 0x69, 0xff, 0x66, 0xff,
-    0x6a, 0xff, 0x6e, 0xff, 0x6c, 0xff, 0x70, 0xff,
-    0x6e, 0xff, 0x73, 0xff, 0x75, 0xff, 0x75, 0xff,
-    0x79, 0xff, 0x7b, 0xff, 0x80, 0xff, 0x84, 0xff,
-    0x8b, 0xff, 0x8c, 0xff, 0x8c, 0xff, 0x91, 0xff,
-    0x9a, 0xff, 0x9f, 0xff, 0x9f, 0xff, 0xa5, 0xff,
-    0xa9, 0xff, 0xaf, 0xff, 0xb0, 0xff, 0xb8, 0xff,
-    0xc0, 0xff, 0xc6, 0xff, 0xcb, 0xff, 0xcd, 0xff,
-    0xd7, 0xff, 0xda, 0xff, 0xe3, 0xff, 0xe6, 0xff,
-    0xe9, 0xff, 0xed, 0xff, 0xf6, 0xff, 0xfd, 0xff,
-    0x02, 0x00, 0x08, 0x00, 0x0b, 0x00, 0x11, 0x00,
-    0x17, 0x00, 0x20, 0x00, 0x20, 0x00, 0x26, 0x00,
-    0x28, 0x00, 0x2d, 0x00, 0x30, 0x00, 0x36, 0x00,
-    0x37, 0x00, 0x3a, 0x00, 0x41, 0x00, 0x43, 0x00,
-    0x48, 0x00, 0x49, 0x00, 0x4b, 0x00, 0x4f, 0x00,
-    0x52, 0x00, 0x51, 0x00, 0x54, 0x00, 0x56, 0x00,
-    0x57, 0x00, 0x58, 0x00, 0x58, 0x00, 0x55, 0x00,
-    0x58, 0x00, 0x57, 0x00, 0x56, 0x00, 0x54, 0x00,
-    0x52, 0x00, 0x56, 0x00, 0x51, 0x00, 0x51, 0x00,
-    0x50, 0x00, 0x4f, 0x00, 0x4c, 0x00, 0x47, 0x00,
-    0x46, 0x00, 0x45, 0x00, 0x43, 0x00, 0x46, 0x00,
-    0x41, 0x00, 0x3b, 0x00, 0x38, 0x00, 0x38, 0x00,
-    0x38, 0x00, 0x34, 0x00, 0x32, 0x00, 0x2d, 0x00,
-    0x2b, 0x00, 0x28, 0x00, 0x28, 0x00, 0x26, 0x00,
-    0x23, 0x00, 0x22, 0x00, 0x1e, 0x00, 0x1a, 0x00,
-    0x17, 0x00, 0x12, 0x00, 0x0f, 0x00, 0x0c, 0x00,
-    0x06, 0x00, 0x03, 0x00, 0xfe, 0xff, 0x00, 0x00,
-    0xfe, 0xff, 0xfa, 0xff, 0xf8, 0xff, 0xf3, 0xff,
-    0xf2, 0xff, 0xee, 0xff, 0xec, 0xff, 0xed, 0xff,
-    0xea, 0xff, 0xe8, 0xff, 0xe8, 0xff, 0xe8, 0xff,
-    0xe9, 0xff, 0xe9, 0xff, 0xeb, 0xff, 0xea, 0xff,
-    0xe8, 0xff, 0xe9, 0xff, 0xe9, 0xff, 0xe9, 0xff,
-    0xe8, 0xff, 0xe9, 0xff, 0xe9, 0xff, 0xe9, 0xff,
-    0xee, 0xff, 0xef, 0xff, 0xf0, 0xff, 0xf0, 0xff,
-    0xf2, 0xff, 0xf4, 0xff, 0xf6, 0xff, 0xf9, 0xff,
-    0xf9, 0xff, 0xfc, 0xff, 0xfe, 0xff, 0xfe, 0xff,
-    0x04, 0x00, 0x07, 0x00, 0x06, 0x00, 0x0f, 0x00,
-    0x13, 0x00, 0x13, 0x00, 0x1a, 0x00, 0x1f, 0x00,
-    0x22, 0x00, 0x23, 0x00, 0x29, 0x00, 0x2c, 0x00,
-    0x30, 0x00, 0x31, 0x00, 0x38, 0x00, 0x3c, 0x00,
-    0x3f, 0x00, 0x43, 0x00, 0x47, 0x00, 0x4c, 0x00,
-    0x51, 0x00, 0x53, 0x00, 0x56, 0x00, 0x59, 0x00,
-    0x5c, 0x00, 0x5f, 0x00, 0x63, 0x00, 0x68, 0x00,
-    0x6b, 0x00, 0x6f, 0x00, 0x71, 0x00, 0x75, 0x00,
-    0x78, 0x00, 0x7d, 0x00, 0x7f, 0x00, 0x81, 0x00,
-    0x82, 0x00, 0x83, 0x00, 0x84, 0x00, 0x89, 0x00,
-    0x89, 0x00, 0x89, 0x00, 0x8c, 0x00, 0x8b, 0x00,
-    0x8d, 0x00, 0x8c, 0x00, 0x8f, 0x00, 0x92, 0x00,
-    0x91, 0x00, 0x92, 0x00, 0x94, 0x00, 0x93, 0x00,
-    0x92, 0x00, 0x90, 0x00, 0x93, 0x00, 0x90, 0x00,
-    0x90, 0x00, 0x8d, 0x00, 0x8a, 0x00, 0x86, 0x00,
-    0x7d, 0x00, 0x76, 0x00, 0x6f, 0x00, 0x6d, 0x00,
-    0x6e, 0x00, 0x69, 0x00, 0x61, 0x00, 0x5f, 0x00,
-    0x5d, 0x00, 0x56, 0x00, 0x51, 0x00, 0x4e, 0x00,
-    0x48, 0x00, 0x40, 0x00, 0x3b, 0x00, 0x35, 0x00,
-    0x32, 0x00, 0x29, 0x00, 0x22, 0x00, 0x1e, 0x00,
-    0x17, 0x00, 0x0e, 0x00, 0x04, 0x00, 0xfe, 0xff,
-    0xf6, 0xff, 0xf2, 0xff, 0xeb, 0xff, 0xe0, 0xff,
-    0xdc, 0xff, 0xd5, 0xff, 0xcc, 0xff, 0xc0, 0xff,
-    0xba, 0xff, 0xb2, 0xff, 0xaa, 0xff, 0xa3, 0xff,
-    0x97, 0xff, 0x91, 0xff, 0x90, 0xff, 0x86, 0xff,
-    0x7f, 0xff, 0x79, 0xff, 0x6f, 0xff, 0x6e, 0xff,
-    0x69, 0xff, 0x64, 0xff, 0x5c, 0xff, 0x57, 0xff,
-    0x54, 0xff, 0x50, 0xff, 0x4a, 0xff, 0x49, 0xff,
-    0x44, 0xff, 0x3c, 0xff, 0x35, 0xff, 0x30, 0xff,
-    0x30, 0xff, 0x2a, 0xff, 0x27, 0xff, 0x26, 0xff,
-    0x27, 0xff, 0x26, 0xff, 0x23, 0xff, 0x22, 0xff,
-    0x22, 0xff, 0x22, 0xff, 0x22, 0xff, 0x22, 0xff,
-    0x20, 0xff, 0x23, 0xff, 0x23, 0xff, 0x25, 0xff,
-    0x28, 0xff, 0x28, 0xff, 0x2a, 0xff, 0x2d, 0xff,
-    0x2e, 0xff, 0x2f, 0xff, 0x35, 0xff, 0x34, 0xff,
-    0x38, 0xff, 0x40, 0xff, 0x45, 0xff, 0x47, 0xff,
-    0x46, 0xff, 0x48, 0xff, 0x4d, 0xff, 0x52, 0xff,
-    0x55, 0xff, 0x59, 0xff, 0x5d, 0xff, 0x66, 0xff,
-    0x69, 0xff, 0x6e, 0xff, 0x75, 0xff, 0x79, 0xff,
-    0x7c, 0xff, 0x83, 0xff, 0x83, 0xff, 0x8a, 0xff,
-    0x91, 0xff, 0x97, 0xff, 0x9c, 0xff, 0xa1, 0xff,
-    0xa3, 0xff, 0xa9, 0xff, 0xac, 0xff, 0xb3, 0xff,
-    0xba, 0xff, 0xb9, 0xff, 0xba, 0xff, 0xbb, 0xff,
-    0xc3, 0xff, 0xc6, 0xff, 0xcb, 0xff, 0xd0, 0xff,
-    0xd2, 0xff, 0xd6, 0xff, 0xdc, 0xff, 0xdc, 0xff,
-    0xdc, 0xff, 0xe0, 0xff, 0xe2, 0xff, 0xe5, 0xff,
-    0xe6, 0xff, 0xec, 0xff, 0xec, 0xff, 0xf0, 0xff,
-    0xf2, 0xff, 0xf4, 0xff, 0xf6, 0xff, 0xf4, 0xff,
-    0xfb, 0xff, 0xfe, 0xff, 0xfe, 0xff, 0x01, 0x00,
-    0xfd, 0xff, 0x01, 0x00, 0x04, 0x00, 0x06, 0x00,
-    0x0c, 0x00, 0x0c, 0x00, 0x08, 0x00, 0x0c, 0x00,
-    0x0a, 0x00, 0x0a, 0x00, 0x0d, 0x00, 0x0b, 0x00,
-    0x0d, 0x00, 0x0e, 0x00, 0x0a, 0x00, 0x0c, 0x00,
-    0x0e, 0x00, 0x0a, 0x00, 0x08, 0x00, 0x0c, 0x00,
-    0x0f, 0x00, 0x0c, 0x00, 0x09, 0x00, 0x0a, 0x00,
-    0x0b, 0x00, 0x05, 0x00, 0x03, 0x00, 0x05, 0x00,
-    0xfd, 0xff, 0xfd, 0xff, 0xf7, 0xff, 0xf7, 0xff,
-    0xf4, 0xff, 0xf4, 0xff, 0xf2, 0xff, 0xe8, 0xff,
-    0xe7, 0xff, 0xe4, 0xff, 0xe3, 0xff, 0xde, 0xff,
-    0xd9, 0xff, 0xd8, 0xff, 0xd5, 0xff, 0xd2, 0xff,
-    0xcc, 0xff, 0xc9, 0xff, 0xc7, 0xff, 0xc8, 0xff,
-    0xc9, 0xff, 0xc2, 0xff, 0xc1, 0xff, 0xbe, 0xff,
-    0xbb, 0xff, 0xb9, 0xff, 0xb7, 0xff, 0xb4, 0xff,
-    0xb1, 0xff, 0xad, 0xff, 0xad, 0xff, 0xad, 0xff,
-    0xa9, 0xff, 0xa9, 0xff, 0xa5, 0xff, 0xa5, 0xff,
-    0xa2, 0xff, 0xa3, 0xff, 0xa8, 0xff, 0xa6, 0xff,
-    0xa7, 0xff, 0xa6, 0xff, 0xa9, 0xff, 0xa8, 0xff,
-    0xa6, 0xff, 0xad, 0xff, 0xaf, 0xff, 0xb1, 0xff,
-    0xb7, 0xff, 0xbb, 0xff, 0xc1, 0xff, 0xbf, 0xff,
-    0xbf, 0xff, 0xc8, 0xff, 0xcd, 0xff, 0xcd, 0xff,
-    0xcf, 0xff, 0xd0, 0xff, 0xd1, 0xff, 0xdc, 0xff,
-    0xe2, 0xff, 0xe7, 0xff, 0xea, 0xff, 0xec, 0xff,
-    0xf0, 0xff, 0xf7, 0xff, 0xfb, 0xff, 0x02, 0x00,
-    0x06, 0x00, 0x09, 0x00, 0x0e, 0x00, 0x16, 0x00,
-    0x20, 0x00, 0x24, 0x00, 0x28, 0x00, 0x2b, 0x00,
-    0x32, 0x00, 0x36, 0x00, 0x3e, 0x00, 0x45, 0x00,
-    0x49, 0x00, 0x4b, 0x00, 0x53, 0x00, 0x54, 0x00,
-    0x5d, 0x00, 0x64, 0x00, 0x6a, 0x00, 0x72, 0x00,
-    0x74, 0x00, 0x75, 0x00, 0x77, 0x00, 0x7d, 0x00,
-    0x82, 0x00, 0x8a, 0x00, 0x87, 0x00, 0x8e, 0x00,
-    0x92, 0x00, 0x91, 0x00, 0x98, 0x00, 0x98, 0x00,
-    0x9e, 0x00, 0x9e, 0x00, 0x9f, 0x00, 0xa0, 0x00,
-    0xa9, 0x00, 0xaa, 0x00, 0xa7, 0x00, 0xaa, 0x00,
-    0xa9, 0x00, 0xa4, 0x00, 0xa9, 0x00, 0xad, 0x00,
-    0xaa, 0x00, 0xad, 0x00, 0xab, 0x00, 0xac, 0x00,
-    0xa6, 0x00, 0xa7, 0x00, 0xa4, 0x00, 0xa2, 0x00,
-    0xa4, 0x00, 0xa3, 0x00, 0xa3, 0x00, 0x9b, 0x00,
-    0x99, 0x00, 0x94, 0x00, 0x94, 0x00, 0x8f, 0x00,
-    0x89, 0x00, 0x8a, 0x00, 0x86, 0x00, 0x85, 0x00,
-    0x82, 0x00, 0x79, 0x00, 0x7c, 0x00, 0x7a, 0x00,
-    0x75, 0x00, 0x70, 0x00, 0x6e, 0x00, 0x68, 0x00,
-    0x61, 0x00, 0x5f, 0x00, 0x58, 0x00, 0x58, 0x00,
-    0x50, 0x00, 0x47, 0x00, 0x40, 0x00, 0x3d, 0x00,
-    0x3b, 0x00, 0x38, 0x00, 0x32, 0x00, 0x2d, 0x00,
-    0x27, 0x00, 0x1e, 0x00, 0x19, 0x00, 0x12, 0x00,
-    0x0a, 0x00, 0x08, 0x00, 0x02, 0x00, 0xfe, 0xff,
-    0xf9, 0xff, 0xf5, 0xff, 0xee, 0xff, 0xea, 0xff,
-    0xe9, 0xff, 0xe1, 0xff, 0xde, 0xff, 0xda, 0xff,
-    0xd2, 0xff, 0xcd, 0xff, 0xca, 0xff, 0xc5, 0xff,
-    0xc3, 0xff, 0xbf, 0xff, 0xbb, 0xff, 0xb6, 0xff,
-    0xb3, 0xff, 0xaf, 0xff, 0xa8, 0xff, 0xa8, 0xff,
-    0xa2, 0xff, 0x9a, 0xff, 0x98, 0xff, 0x95, 0xff,
-    0x8d, 0xff, 0x8b, 0xff, 0x8c, 0xff, 0x8a, 0xff,
-    0x86, 0xff, 0x85, 0xff, 0x84, 0xff, 0x88, 0xff,
-    0x84, 0xff, 0x85, 0xff, 0x86, 0xff, 0x84, 0xff,
-    0x81, 0xff, 0x7f, 0xff, 0x7d, 0xff, 0x7f, 0xff,
-    0x80, 0xff, 0x82, 0xff, 0x85, 0xff, 0x84, 0xff,
-    0x88, 0xff, 0x8b, 0xff, 0x8c, 0xff, 0x8c, 0xff,
-    0x8e, 0xff, 0x92, 0xff, 0x96, 0xff, 0x95, 0xff,
-    0x97, 0xff, 0x96, 0xff, 0x9e, 0xff, 0xa2, 0xff,
-    0xa1, 0xff, 0xa5, 0xff, 0xae, 0xff, 0xaf, 0xff,
-    0xb3, 0xff, 0xb7, 0xff, 0xbc, 0xff, 0xc0, 0xff,
-    0xc4, 0xff, 0xd0, 0xff, 0xd7, 0xff, 0xd8, 0xff,
-    0xde, 0xff, 0xdf, 0xff, 0xe2, 0xff, 0xea, 0xff,
-    0xef, 0xff, 0xf3, 0xff, 0xf7, 0xff, 0x02, 0x00,
-    0x03, 0x00, 0x08, 0x00, 0x09, 0x00, 0x0e, 0x00,
-    0x16, 0x00, 0x15, 0x00, 0x1b, 0x00, 0x20, 0x00,
-    0x2b, 0x00, 0x2f, 0x00, 0x31, 0x00, 0x37, 0x00,
-    0x40, 0x00, 0x46, 0x00, 0x4e, 0x00, 0x50, 0x00,
-    0x55, 0x00, 0x59, 0x00, 0x58, 0x00, 0x5a, 0x00,
-    0x5d, 0x00, 0x5f, 0x00, 0x65, 0x00, 0x6d, 0x00,
-    0x6c, 0x00, 0x6d, 0x00, 0x70, 0x00, 0x74, 0x00,
-    0x78, 0x00, 0x77, 0x00, 0x79, 0x00, 0x77, 0x00,
-    0x73, 0x00, 0x77, 0x00, 0x76, 0x00, 0x79, 0x00,
-    0x7c, 0x00, 0x7f, 0x00, 0x7e, 0x00, 0x7b, 0x00,
-    0x78, 0x00, 0x74, 0x00, 0x74, 0x00, 0x65, 0x00,
-    0x68, 0x00, 0x70, 0x00, 0x6a, 0x00, 0x68, 0x00,
-    0x66, 0x00, 0x61, 0x00, 0x63, 0x00, 0x66, 0x00,
-    0x5f, 0x00, 0x5e, 0x00, 0x57, 0x00, 0x56, 0x00,
-    0x54, 0x00, 0x50, 0x00, 0x4c, 0x00, 0x42, 0x00,
-    0x43, 0x00, 0x38, 0x00, 0x37, 0x00, 0x35, 0x00,
-    0x32, 0x00, 0x33, 0x00, 0x30, 0x00, 0x2d, 0x00,
-    0x24, 0x00, 0x1c, 0x00, 0x1d, 0x00, 0x14, 0x00,
-    0x0d, 0x00, 0x18, 0x00, 0x1b, 0x00, 0x13, 0x00,
-    0x09, 0x00, 0x0b, 0x00, 0x0d, 0x00, 0x0b, 0x00,
-    0xfe, 0xff, 0xf7, 0xff, 0xf8, 0xff, 0xf8, 0xff,
-    0xfc, 0xff, 0xf7, 0xff, 0xf5, 0xff, 0xf2, 0xff,
-    0xf4, 0xff, 0xf6, 0xff, 0xf9, 0xff, 0xf9, 0xff,
-    0xf6, 0xff, 0xf1, 0xff, 0xee, 0xff, 0xea, 0xff,
-    0xea, 0xff, 0xeb, 0xff, 0xdc, 0xff, 0xe1, 0xff,
-    0xe8, 0xff, 0xe5, 0xff, 0xe7, 0xff, 0xec, 0xff,
-    0xe4, 0xff, 0xe1, 0xff, 0xe0, 0xff, 0xe5, 0xff,
-    0xf1, 0xff, 0xf0, 0xff, 0xf5, 0xff, 0xed, 0xff,
-    0xf5, 0xff, 0xfa, 0xff, 0xf7, 0xff, 0xf8, 0xff,
-    0xfa, 0xff, 0x02, 0x00, 0x01, 0x00, 0xfc, 0xff,
-    0x00, 0x00, 0x04, 0x00, 0x07, 0x00, 0x0b, 0x00,
-    0x11, 0x00, 0x17, 0x00, 0x13, 0x00, 0x20, 0x00,
-    0x21, 0x00, 0x1f, 0x00, 0x23, 0x00, 0x23, 0x00,
-    0x2c, 0x00, 0x2d, 0x00, 0x32, 0x00, 0x35, 0x00,
-    0x3a, 0x00, 0x3f, 0x00, 0x3d, 0x00, 0x3d, 0x00,
-    0x42, 0x00, 0x3d, 0x00, 0x43, 0x00, 0x45, 0x00,
-    0x47, 0x00, 0x4a, 0x00, 0x45, 0x00, 0x41, 0x00,
-    0x4a, 0x00, 0x4e, 0x00, 0x4d, 0x00, 0x53, 0x00,
-    0x53, 0x00, 0x5b, 0x00, 0x57, 0x00, 0x5d, 0x00,
-    0x64, 0x00, 0x69, 0x00, 0x62, 0x00, 0x61, 0x00,
-    0x62, 0x00, 0x61, 0x00, 0x6f, 0x00, 0x62, 0x00,
-    0x5b, 0x00, 0x69, 0x00, 0x6c, 0x00, 0x61, 0x00,
-    0x65, 0x00, 0x61, 0x00, 0x64, 0x00, 0x5f, 0x00,
-    0x63, 0x00, 0x72, 0x00, 0x67, 0x00, 0x65, 0x00,
-    0x6a, 0x00, 0x6c, 0x00, 0x64, 0x00, 0x6a, 0x00,
-    0x66, 0x00, 0x61, 0x00, 0x60, 0x00, 0x5b, 0x00,
-    0x5e, 0x00, 0x5b, 0x00, 0x59, 0x00, 0x58, 0x00,
-    0x50, 0x00, 0x46, 0x00, 0x37, 0x00, 0x44, 0x00,
-    0x34, 0x00, 0x22, 0x00, 0x26, 0x00, 0x2b, 0x00,
-    0x37, 0x00, 0x32, 0x00, 0x2b, 0x00, 0x1b, 0x00,
-    0x1e, 0x00, 0xf6, 0xff, 0x01, 0x00, 0x14, 0x00,
-    0x10, 0x00, 0x23, 0x00, 0x0e, 0x00, 0x07, 0x00,
-    0x12, 0x00, 0x0a, 0x00, 0xf4, 0xff, 0xec, 0xff,
-    0xe7, 0xff, 0xd0, 0xff, 0xd3, 0xff, 0xc5, 0xff,
-    0xc3, 0xff, 0xd8, 0xff, 0xc7, 0xff, 0xc7, 0xff,
-    0xc0, 0xff, 0xba, 0xff, 0xa8, 0xff, 0xa9, 0xff,
-    0xad, 0xff, 0xa8, 0xff, 0x98, 0xff, 0x9d, 0xff,
-    0x99, 0xff, 0x9c, 0xff, 0x9d, 0xff, 0x94, 0xff,
-    0x84, 0xff, 0x7c, 0xff, 0x75, 0xff, 0x7e, 0xff,
-    0x83, 0xff, 0x65, 0xff, 0x90, 0xff, 0x87, 0xff,
-    0x77, 0xff, 0x75, 0xff, 0x79, 0xff, 0x75, 0xff,
-    0x71, 0xff, 0x64, 0xff, 0x7f, 0xff, 0x78, 0xff,
-    0x5d, 0xff, 0x82, 0xff, 0xa0, 0xff, 0x5d, 0xff,
-    0x4d, 0xff, 0x76, 0xff, 0x63, 0xff, 0x7c, 0xff,
-    0x70, 0xff, 0x86, 0xff, 0x4f, 0xff, 0x68, 0xff,
-    0x8c, 0xff, 0x6b, 0xff, 0x6f, 0xff, 0x8d, 0xff,
-    0x96, 0xff, 0xad, 0xff, 0xa3, 0xff, 0x9a, 0xff,
-    0xbc, 0xff, 0xa4, 0xff, 0xc6, 0xff, 0xb6, 0xff,
-    0xbc, 0xff, 0xf3, 0xff, 0xa1, 0xff, 0xc1, 0xff,
-    0xdc, 0xff, 0xcf, 0xff, 0xe9, 0xff, 0xc5, 0xff,
-    0xb6, 0xff, 0xac, 0xff, 0xb0, 0xff, 0x81, 0xff,
-    0xc0, 0xff, 0xad, 0xff, 0xc6, 0xff, 0xec, 0xff,
-    0x15, 0x00, 0xf0, 0xff, 0x12, 0x00, 0x03, 0x00,
-    0xeb, 0xff, 0x5b, 0x00, 0xc9, 0xff, 0xfd, 0xff,
-    0x58, 0x00, 0x45, 0x00, 0xe5, 0xff, 0x07, 0x00,
-    0x3c, 0x00, 0x2e, 0x00, 0x3a, 0x00, 0x57, 0x00,
-    0x08, 0x00, 0xf5, 0xff, 0x32, 0x00, 0x8e, 0x00,
-    0x14, 0x00, 0xf7, 0xff, 0x7f, 0x00, 0x0a, 0x00,
-    0x5a, 0x00, 0x35, 0x00, 0x40, 0x00, 0x66, 0x00,
-    0x5f, 0x00, 0x22, 0x00, 0x48, 0x00, 0x35, 0x00,
-    0xe7, 0xff, 0xff, 0xff, 0xf5, 0xff, 0xe8, 0xff,
-    0xe8, 0xff, 0x14, 0x00, 0xe9, 0xff, 0x30, 0x00,
-    0xf5, 0xff, 0xda, 0xff, 0x4a, 0x00, 0x0d, 0x00,
-    0x10, 0x00, 0x16, 0x00, 0xf8, 0xff, 0x1a, 0x00,
-    0xe3, 0xff, 0xfb, 0xff, 0x2b, 0x00, 0x34, 0x00,
-    0x3b, 0x00, 0xf8, 0xff, 0xe9, 0xff, 0x51, 0x00,
-    0xd3, 0xff, 0xc7, 0xff, 0x1a, 0x00, 0xf0, 0xff,
-    0xfb, 0xff, 0xe5, 0xff, 0x01, 0x00, 0x98, 0xff,
-    0x74, 0xff, 0xf8, 0xff, 0xf9, 0xff, 0xb1, 0xff,
-    0xd4, 0xff, 0xcc, 0xff, 0xe0, 0xff, 0xdf, 0xff,
-    0xbb, 0xff, 0xb1, 0xff, 0x9a, 0xff, 0x60, 0xff,
-    0xbe, 0xff, 0x22, 0x00, 0xd9, 0xfe, 0x13, 0xff,
-    0xb4, 0x00, 0x51, 0x00, 0x70, 0xff, 0x0c, 0xff,
-    0xc7, 0xff, 0x79, 0x00, 0xeb, 0xff, 0xa6, 0xff,
-    0xac, 0xff, 0x60, 0xff, 0x47, 0xff, 0x55, 0xff,
-    0xbe, 0xfe, 0x0e, 0xff, 0x8e, 0xff, 0x22, 0xff,
-    0xd7, 0xfe, 0x1a, 0xff, 0x92, 0xff, 0x4c, 0xff,
-    0x0c, 0xff, 0x5d, 0xff, 0x3d, 0xff, 0x41, 0xff,
-    0x4e, 0xff, 0x5a, 0xff, 0x49, 0xff, 0x7e, 0xff,
-    0xa1, 0xff, 0xc7, 0xff, 0x6c, 0xff, 0x06, 0xff,
-    0xb0, 0xff, 0x4e, 0xff, 0x39, 0xff, 0x4a, 0xff,
-    0xd1, 0xfe, 0xd6, 0xfe, 0x04, 0xff, 0x08, 0xff,
-    0x05, 0xff, 0xfa, 0xfe, 0x51, 0xff, 0x05, 0xff,
-    0x53, 0xff, 0x7d, 0xff, 0x06, 0xff, 0xe0, 0xff,
-    0xb0, 0xff, 0x6c, 0xff, 0xf8, 0xff, 0x1f, 0x00,
-    0x17, 0x00, 0x22, 0x00, 0xf8, 0xff, 0xb6, 0xff,
-    0x33, 0x00, 0x20, 0x00, 0x02, 0x00, 0x1a, 0x00,
-    0xc7, 0xff, 0x17, 0x00, 0xcd, 0xff, 0xc1, 0xff,
-    0x97, 0xff, 0x66, 0xff, 0x41, 0xff, 0x34, 0xff,
-    0x5c, 0xff, 0x91, 0xff, 0x66, 0xff, 0x38, 0xff,
-    0x62, 0xff, 0x5a, 0xff, 0x9e, 0xff, 0xb0, 0xfe,
-    0x67, 0xff, 0xe5, 0xfe, 0x12, 0x00, 0x83, 0x00,
-    0xec, 0xfd, 0xfd, 0x01, 0xe1, 0x06, 0xdb, 0x03,
-    0xee, 0x00, 0x72, 0x02, 0xd4, 0x02, 0x84, 0x01,
-    0x35, 0x00, 0x92, 0x01, 0x02, 0x01, 0xa3, 0xff,
-    0x09, 0x00, 0x49, 0x00, 0x64, 0xff, 0x22, 0xff,
-    0x37, 0xff, 0x31, 0xff, 0x76, 0xff, 0x84, 0x00,
-    0xf9, 0xff, 0x65, 0xff, 0x19, 0xff, 0xc7, 0xfe,
-    0xe1, 0xff, 0xa6, 0xfd, 0x8d, 0xfe, 0x60, 0xff,
-    0x6d, 0xfe, 0x43, 0xfe, 0xc3, 0xfe, 0xc1, 0xfd,
-    0x47, 0xfe, 0xc3, 0xff, 0x66, 0xff, 0xff, 0xff,
-    0x23, 0xff, 0xf3, 0x00, 0xfc, 0x00, 0x87, 0xff,
-    0xa0, 0x01, 0x7c, 0xff, 0x95, 0x00, 0x2d, 0x02,
-    0xa9, 0xff, 0xd3, 0x00, 0x2b, 0x01, 0x2b, 0x00,
-    0xc0, 0xff, 0x68, 0x02, 0x6e, 0x00, 0xc6, 0xff,
-    0xfa, 0x00, 0xe2, 0x01, 0x54, 0xff, 0xc3, 0x00,
-    0x0f, 0x03, 0x64, 0x00, 0x4b, 0x01, 0xa3, 0xff,
-    0xde, 0x00, 0x3c, 0xff, 0x2d, 0x01, 0x9a, 0x00,
-    0xe9, 0xfd, 0x95, 0xfe, 0x86, 0x00, 0xd7, 0xff,
-    0xd6, 0x01, 0xa1, 0x02, 0x74, 0xfb, 0x01, 0x03,
-    0xe3, 0x07, 0x0c, 0xfe, 0x16, 0xfe, 0xa6, 0x00,
-    0x22, 0x02, 0x2c, 0x00, 0xf3, 0xfe, 0xcb, 0x01,
-    0xe1, 0xff, 0xf8, 0xff, 0x23, 0xfd, 0xe3, 0xff,
-    0xb1, 0xff, 0xf7, 0xfd, 0x65, 0xff, 0x33, 0x01,
-    0x4c, 0xff, 0x20, 0x00, 0x87, 0xfd, 0xb5, 0x01,
-    0x7f, 0x01, 0x25, 0xfd, 0x88, 0x02, 0x83, 0xff,
-    0xb2, 0xfd, 0x59, 0x02, 0x7d, 0x02, 0xdb, 0xf9,
-    0xef, 0x03, 0x09, 0x01, 0x42, 0xfd, 0xae, 0x00,
-    0x5c, 0xff, 0xdb, 0x00, 0xae, 0x02, 0x9b, 0x00,
-    0x8f, 0xfc, 0x02, 0x05, 0xbe, 0x07, 0x6f, 0xfe,
-    0x08, 0x01, 0xa1, 0x06, 0x19, 0x00, 0xbd, 0x04,
-    0x0d, 0xfe, 0x22, 0xfc, 0xf6, 0x04, 0x28, 0xfd,
-    0xc2, 0xff, 0x6c, 0xff, 0x2b, 0xfd, 0xfd, 0x04,
-    0x68, 0xfc, 0x20, 0xf8, 0x7d, 0x01, 0x45, 0x00,
-    0xb2, 0xf7, 0x21, 0xff, 0xad, 0xff, 0xbe, 0xfe,
-    0xea, 0x00, 0x88, 0xf9, 0x4f, 0x01, 0x3e, 0x01,
-    0xe1, 0xf8, 0x58, 0x03, 0x47, 0x02, 0xd7, 0xf8,
-    0xfc, 0x00, 0x87, 0x02, 0x11, 0xfe, 0x3a, 0xfd,
-    0x5f, 0x03, 0xe7, 0x01, 0xa3, 0xfd, 0x06, 0xfd,
-    0x6e, 0x03, 0xf1, 0x03, 0x11, 0xfc, 0x58, 0x03,
-    0x42, 0x00, 0x77, 0x02, 0x73, 0x03, 0x79, 0xfd,
-    0x55, 0x07, 0x29, 0xff, 0x12, 0x00, 0x02, 0x08,
-    0xfe, 0xfb, 0x59, 0xff, 0xcd, 0x05, 0x68, 0x00,
-    0x60, 0xf9, 0xe2, 0x06, 0x42, 0x04, 0x8d, 0xf8,
-    0xa7, 0x01, 0x86, 0x04, 0x3d, 0xff, 0xcd, 0xfb,
-    0xfa, 0x00, 0x4b, 0x02, 0x41, 0xff, 0xe9, 0xfe,
-    0xf5, 0x02, 0x60, 0x00, 0x9d, 0xff, 0xba, 0x00,
-    0xeb, 0x01, 0x32, 0xfe, 0xc0, 0x01, 0xc4, 0x03,
-    0x05, 0xf9, 0xae, 0x02, 0xae, 0x06, 0xe4, 0xfd,
-    0x36, 0xfd, 0x9e, 0x03, 0x3b, 0x01, 0x67, 0x01,
-    0xd9, 0xfe, 0x97, 0xfb, 0x86, 0x07, 0xab, 0xfc,
-    0x45, 0xff, 0x74, 0x03, 0xf5, 0x00, 0x2e, 0x00,
-    0x6d, 0xfb, 0xe3, 0x07, 0xdc, 0xfe, 0x2a, 0xfc,
-    0xbe, 0x00, 0x1a, 0x00, 0x99, 0x03, 0xa7, 0xfd,
-    0x01, 0xfc, 0x52, 0x07, 0x1e, 0x02, 0x08, 0xfd,
-    0x69, 0xfe, 0xf4, 0x03, 0x9b, 0x06, 0x65, 0xf6,
-    0x3b, 0x02, 0xab, 0x06, 0x09, 0x01, 0xcc, 0xfb,
-    0x01, 0x02, 0x09, 0x08, 0x4d, 0xff, 0x42, 0xfd,
-    0x83, 0x01, 0xfa, 0x06, 0xfc, 0xf6, 0xac, 0x02,
-    0x56, 0x06, 0x1d, 0xf9, 0x63, 0x01, 0xd6, 0x03,
-    0x22, 0xfe, 0x53, 0x01, 0xac, 0x00, 0x3d, 0x00,
-    0x81, 0x04, 0x5d, 0xf8, 0x37, 0xfd, 0x66, 0x09,
-    0x12, 0xfc, 0xf1, 0xf7, 0x81, 0x07, 0x84, 0xff,
-    0x4d, 0xff, 0x34, 0xff, 0x3f, 0xfc, 0xc2, 0xfe,
-    0x3b, 0x02, 0x17, 0xfe, 0x55, 0xfb, 0x7c, 0x07,
-    0x79, 0xfe, 0x11, 0xfe, 0x31, 0xfe, 0x9c, 0x05,
-    0x2e, 0xff, 0xd8, 0xfb, 0xd1, 0x08, 0x73, 0xf6,
-    0x62, 0x00, 0x21, 0x0b, 0x6d, 0xf9, 0xfa, 0x03,
-    0x8f, 0x03, 0xe1, 0xfb, 0xe2, 0x04, 0x51, 0xfd,
-    0x5e, 0xfc, 0x88, 0x04, 0x0a, 0xff, 0x07, 0xfa,
-    0x53, 0x04, 0x0e, 0x00, 0xf1, 0xff, 0x7c, 0x01,
-    0x5e, 0xfd, 0x8f, 0x03, 0xd1, 0xff, 0x6b, 0xff,
-    0x4b, 0x01, 0xaa, 0x00, 0x69, 0xf7, 0xbb, 0x07,
-    0x72, 0x03, 0x23, 0xf8, 0xea, 0x08, 0x34, 0xff,
-    0x49, 0xfc, 0xc2, 0x00, 0x6d, 0xff, 0xc2, 0xfc,
-    0x1a, 0xff, 0xb4, 0x03, 0xba, 0x01, 0xf2, 0xf6,
-    0x14, 0x05, 0x94, 0x05, 0x0b, 0xf8, 0x90, 0x00,
-    0xd0, 0x00, 0xa9, 0xfd, 0xd0, 0xfe, 0xa8, 0x03,
-    0xa1, 0xfb, 0x8f, 0x02, 0x25, 0x05, 0x2f, 0xf8,
-    0x45, 0x03, 0x4b, 0x09, 0xaf, 0xf3, 0x60, 0xfc,
-    0x54, 0x10, 0x08, 0xfb, 0x46, 0x01, 0x93, 0x01,
-    0x8b, 0xf9, 0x1a, 0x09, 0x3e, 0xfd, 0x7e, 0xfa,
-    0xd7, 0x07, 0x76, 0x04, 0xcc, 0xf4, 0xe0, 0x02,
-    0x37, 0x04, 0xac, 0xfa, 0x76, 0x00, 0x29, 0x02,
-    0x66, 0xfd, 0x84, 0xfd, 0x52, 0x07, 0x44, 0xfb,
-    0xf8, 0xfe, 0x37, 0x02, 0xbc, 0xff, 0x0b, 0xfd,
-    0x43, 0x03, 0x7c, 0xfe, 0x5e, 0xfd, 0xf0, 0xff,
-    0x4a, 0xfb, 0xbf, 0x02, 0x1d, 0xfe, 0xf5, 0x02,
-    0x5d, 0xfe, 0x6d, 0xfe, 0x04, 0x01, 0x64, 0xfd,
-    0x30, 0xfd, 0x9c, 0x06, 0xfc, 0xfc, 0x4d, 0xf7,
-    0x6a, 0x0a, 0x2d, 0x00, 0xdd, 0xf9, 0x52, 0x02,
-    0x04, 0x01, 0xa0, 0x00, 0x2c, 0xfd, 0xd4, 0xfc,
-    0xd7, 0x05, 0xcb, 0xff, 0x97, 0x01, 0x98, 0xfa,
-    0x2a, 0x01, 0x51, 0x08, 0x73, 0xf8, 0x97, 0xfe,
-    0xea, 0x00, 0xd0, 0x01, 0xbb, 0xfd, 0x58, 0x00,
-    0x67, 0x02, 0x79, 0x00, 0x88, 0xff, 0x56, 0xfe,
-    0x57, 0x01, 0xcd, 0xff, 0x60, 0xfe, 0x46, 0xfe,
-    0x7d, 0x01, 0x43, 0xfc, 0x85, 0xfe, 0xe0, 0x01,
-    0xb4, 0x00, 0xbe, 0xff, 0xbc, 0xfc, 0x79, 0xfe,
-    0x5c, 0x03, 0xeb, 0xff, 0xa1, 0xf9, 0xe0, 0xfe,
-    0x8d, 0x00, 0x21, 0x01, 0x5c, 0x02, 0x1c, 0xfa,
-    0x14, 0x03, 0xe2, 0x03, 0x5e, 0xf7, 0x98, 0x05,
-    0x6e, 0xfc, 0x0c, 0xfe, 0x5f, 0x02, 0x31, 0xfd,
-    0xc2, 0x00, 0xa6, 0xfc, 0xb8, 0x04, 0x33, 0xfe,
-    0xf8, 0xfe, 0x8c, 0x01, 0x44, 0xfd, 0x90, 0xfd,
-    0x69, 0xff, 0x3b, 0xfe, 0xf5, 0x02, 0xbb, 0x00,
-    0x53, 0xf8, 0xd0, 0x03, 0x53, 0x08, 0x52, 0xfa,
-    0x43, 0xfa, 0x94, 0x02, 0x11, 0x00, 0xf5, 0xfc,
-    0x0c, 0xfe, 0x20, 0x00, 0xc2, 0xfd, 0xd6, 0x00,
-    0x97, 0xfd, 0xee, 0x00, 0x7e, 0xff, 0x0c, 0xfe,
-    0xbe, 0xff, 0x59, 0xfb, 0x04, 0x05, 0x4b, 0x03,
-    0x9c, 0xf7, 0x42, 0x03, 0xed, 0x02, 0x76, 0xfb,
-    0x7b, 0x03, 0xc8, 0x02, 0x65, 0xf9, 0xc4, 0xfd,
-    0x2c, 0x04, 0xc7, 0xfd, 0xb2, 0x00, 0x1b, 0xfe,
-    0x3b, 0x02, 0x18, 0xfe, 0x0e, 0xfc, 0x3e, 0x02,
-    0xba, 0xfc, 0xda, 0xff, 0x51, 0x04, 0x3a, 0xfa,
-    0x39, 0x02, 0x76, 0x06, 0xa0, 0xf6, 0xe6, 0xfd,
-    0x5e, 0x08, 0x77, 0xfb, 0x4f, 0xfb, 0x6d, 0x05,
-    0xaf, 0xfd, 0x81, 0xff, 0x94, 0xfd, 0x2c, 0xfd,
-    0x4e, 0xfe, 0x5b, 0x00, 0x09, 0x02, 0x02, 0x00,
-    0x21, 0xff, 0x4d, 0x00, 0x7f, 0xfe, 0x72, 0xff,
-    0x21, 0x00, 0x66, 0xfe, 0x97, 0x03, 0x2d, 0xfe,
-    0xfc, 0xfb, 0x5f, 0x05, 0x1d, 0x04, 0x00, 0xfc,
-    0x1d, 0xff, 0x0b, 0x01, 0x64, 0xfe, 0x7e, 0xfc,
-    0x02, 0x05, 0xe3, 0xff, 0x2e, 0xfe, 0x46, 0x04,
-    0xa0, 0xfb, 0x48, 0x00, 0xc8, 0x04, 0xbd, 0xfb,
-    0x53, 0xf8, 0x71, 0x08, 0x9a, 0x03, 0x83, 0xf7,
-    0x06, 0x02, 0x8b, 0x02, 0x73, 0xfe, 0xce, 0xfe,
-    0x25, 0xff, 0x55, 0xfd, 0x06, 0x03, 0x00, 0x03,
-    0x11, 0xf9, 0xa4, 0xfd, 0x9c, 0x06, 0xe8, 0x01,
-    0xb7, 0xf9, 0x92, 0xff, 0x44, 0x07, 0x1c, 0xff,
-    0x21, 0xfa, 0x2f, 0x00, 0xca, 0x05, 0x68, 0xff,
-    0x85, 0xfb, 0x8f, 0x00, 0xf6, 0x01, 0x4f, 0x02,
-    0xfd, 0xf9, 0x38, 0xff, 0x86, 0x05, 0x2a, 0x02,
-    0x65, 0xfb, 0x7e, 0xfa, 0x0c, 0x08, 0x0b, 0x03,
-    0xdc, 0xf8, 0xad, 0x01, 0xf0, 0x02, 0x77, 0xfb,
-    0x42, 0x00, 0x63, 0xff, 0x64, 0xfd, 0x0a, 0x03,
-    0x15, 0x01, 0x02, 0xff, 0x18, 0x04, 0xd5, 0xfd,
-    0xaa, 0xfb, 0xad, 0x03, 0x2d, 0xff, 0x32, 0xfd,
-    0xd7, 0x01, 0x3e, 0x02, 0xd3, 0xfb, 0xb4, 0x00,
-    0xc9, 0x00, 0xc0, 0x00, 0xd0, 0x00, 0x7e, 0xfc,
-    0xb9, 0x04, 0x98, 0x01, 0x2c, 0xfd, 0x63, 0xf9,
-    0x7a, 0x01, 0x1e, 0x07, 0xd9, 0x00, 0x29, 0xf9,
-    0x90, 0xfa, 0xc4, 0x06, 0xcd, 0x04, 0x79, 0xfa,
-    0x13, 0xf9, 0x23, 0x07, 0xb8, 0x02, 0x67, 0xfb,
-    0x85, 0x01, 0xc6, 0x01, 0xd3, 0x00, 0x9b, 0xfe,
-    0x10, 0xff, 0xf0, 0x01, 0x61, 0x00, 0xce, 0xfc,
-    0xf3, 0xfe, 0xdb, 0xfe, 0x24, 0x03, 0x90, 0x01,
-    0x4d, 0xfe, 0xef, 0xff, 0x49, 0xff, 0xf8, 0x02,
-    0xd3, 0xfb, 0xb0, 0xfc, 0x12, 0x05, 0x80, 0x00,
-    0xa2, 0xfb, 0x90, 0x03, 0x87, 0xff, 0xdd, 0xfe,
-    0x0b, 0x05, 0x2e, 0xfc, 0x6a, 0xf8, 0x58, 0x07,
-    0x60, 0x02, 0xbb, 0xf7, 0x80, 0x05, 0x06, 0x00,
-    0xaa, 0xfc, 0xd5, 0x00, 0x79, 0x03, 0x0e, 0x00,
-    0xf5, 0x00, 0xb4, 0xfd, 0x3e, 0xfd, 0x54, 0x03,
-    0x0e, 0x02, 0xce, 0x00, 0x8a, 0xfe, 0xe0, 0xff,
-    0x03, 0x05, 0xaa, 0x00, 0xc6, 0xfb, 0x36, 0x06,
-    0x7a, 0xfd, 0xa4, 0xfe, 0xf8, 0x00, 0xf1, 0xff,
-    0x04, 0x03, 0xe6, 0x01, 0xe5, 0xfe, 0xf8, 0x01,
-    0x26, 0xff, 0x5a, 0xfa, 0xa7, 0x06, 0xdf, 0xfd,
-    0xee, 0xfa, 0xaa, 0xff, 0x1b, 0x02, 0xc8, 0x02,
-    0x1e, 0xff, 0x9b, 0xff, 0x37, 0x03, 0x82, 0xfd,
-    0x06, 0xfe, 0x38, 0x03, 0xc5, 0xff, 0xa6, 0x00,
-    0x67, 0xff, 0x91, 0xfe, 0x2a, 0x01, 0x43, 0x05,
-    0x84, 0xf9, 0x94, 0xfe, 0x23, 0x08, 0xf5, 0xfe,
-    0xdf, 0xff, 0xc7, 0xff, 0xee, 0xfd, 0x93, 0x02,
-    0xb8, 0xff, 0xe8, 0xfd, 0x68, 0x03, 0xd4, 0x01,
-    0x4d, 0xff, 0x08, 0x01, 0xa0, 0x03, 0xf1, 0xfd,
-    0x69, 0xfe, 0xa0, 0x00, 0x9f, 0x02, 0x8e, 0x02,
-    0xfd, 0xfe, 0x10, 0xfd, 0xdf, 0xfe, 0x20, 0x05,
-    0xdd, 0x00, 0x65, 0xfc, 0x3f, 0x00, 0x3e, 0x04,
-    0x1e, 0xfd, 0xf4, 0xfb, 0xdf, 0x03, 0x53, 0x02,
-    0xd2, 0xf9, 0xf5, 0x01, 0x9f, 0x05, 0x17, 0xfe,
-    0x2a, 0x00, 0x0b, 0xff, 0xd6, 0xfc, 0x82, 0x02,
-    0xab, 0x03, 0x8a, 0xfd, 0xd8, 0xfe, 0x44, 0x00,
-    0xcf, 0x03, 0x8e, 0x00, 0x71, 0xfe, 0x31, 0x02,
-    0x50, 0xfe, 0x31, 0xff, 0xc2, 0xfe, 0xcd, 0xfc,
-    0x52, 0x01, 0x0c, 0x03, 0x6c, 0x01, 0x48, 0x00,
-    0xa4, 0xff, 0x5b, 0xfe, 0x43, 0xfd, 0xe5, 0xfd,
-    0x1a, 0x02, 0xd8, 0x00, 0x27, 0xfd, 0x09, 0x04,
-    0xea, 0x01, 0x7a, 0xfe, 0x97, 0xfe, 0xa0, 0xff,
-    0x33, 0x02, 0xeb, 0xfe, 0x60, 0x01, 0x8d, 0x01,
-    0x78, 0xfe, 0x3f, 0x00, 0x0b, 0x03, 0xed, 0xff,
-    0xa7, 0xff, 0xc4, 0x00, 0xa1, 0x01, 0xef, 0xff,
-    0x66, 0xfd, 0xfd, 0xff, 0x93, 0x01, 0x1c, 0x01,
-    0x33, 0x00, 0xf7, 0xfd, 0x15, 0x01, 0x42, 0x03,
-    0x30, 0xfc, 0x15, 0x02, 0x79, 0x01, 0x04, 0xfd,
-    0x40, 0xfe, 0xe4, 0xff, 0xfa, 0xff, 0x8e, 0xfe,
-    0x4a, 0x02, 0x35, 0x01, 0x2c, 0x00, 0xbe, 0xff,
-    0xc9, 0xff, 0x2a, 0xfd, 0x46, 0xff, 0x54, 0x01,
-    0x14, 0xff, 0x0d, 0x01, 0xdd, 0x00, 0x3a, 0x00,
-    0xb8, 0x01, 0x4a, 0x02, 0xb8, 0xfe, 0x06, 0x01,
-    0xbe, 0xff, 0x77, 0xff, 0xf4, 0x01, 0x71, 0x00,
-    0x31, 0xff, 0x64, 0xff, 0xa9, 0x02, 0x02, 0x04,
-    0xee, 0xff, 0x17, 0xfb, 0xa9, 0x01, 0xb1, 0xff,
-    0xfe, 0xff, 0xc7, 0x00, 0x63, 0xfd, 0x11, 0x00,
-    0xf9, 0x01, 0xbc, 0xff, 0xff, 0xfd, 0x90, 0x02,
-    0x29, 0x00, 0xb6, 0xfe, 0x4f, 0x03, 0x73, 0xff,
-    0x78, 0xfd, 0x9c, 0x00, 0x32, 0x00, 0x9a, 0x03,
-    0xe5, 0x01, 0xf8, 0xfc, 0x42, 0xff, 0x00, 0x00,
-    0x5c, 0xfd, 0xba, 0x00, 0xea, 0x00, 0xe9, 0xff,
-    0xf3, 0x04, 0x31, 0x01, 0x82, 0xfd, 0x7c, 0x01,
-    0xe3, 0xff, 0xf2, 0x00, 0x0c, 0x00, 0x0d, 0x01,
-    0xa0, 0xfe, 0xa1, 0xfe, 0xd9, 0x00, 0xa2, 0xff,
-    0xd4, 0x01, 0x02, 0xfe, 0xb5, 0xff, 0x36, 0x00,
-    0xf4, 0x01, 0x29, 0xfd, 0xdb, 0xfc, 0x3f, 0x04,
-    0x85, 0x01, 0x37, 0xfd, 0x0d, 0x00, 0x6e, 0x00,
-    0x4a, 0x00, 0x38, 0x00, 0x2f, 0xff, 0xb0, 0xfe,
-    0x53, 0xff, 0xaf, 0x00, 0xba, 0x00, 0xef, 0x00,
-    0x44, 0xfc, 0xf0, 0xff, 0x6d, 0x00, 0x99, 0x02,
-    0x28, 0xfe, 0x70, 0xfc, 0x50, 0x00, 0x44, 0x02,
-    0xe1, 0x00, 0x7d, 0xfd, 0x42, 0xfe, 0xe9, 0xff,
-    0x00, 0x06, 0x57, 0xfe, 0x99, 0xfd, 0x42, 0x01,
-    0xf3, 0xff, 0x11, 0x00, 0xdd, 0xff, 0xf6, 0xff,
-    0x6b, 0x00, 0x7e, 0xff, 0xa3, 0xff, 0xdb, 0x00,
-    0xf6, 0x01, 0x29, 0xff, 0xfa, 0xfc, 0xf6, 0x00,
-    0x2e, 0x03, 0x4f, 0xfc, 0x7f, 0xfb, 0x64, 0x01,
-    0x81, 0xff, 0x2c, 0x02, 0x22, 0xff, 0xba, 0xfd,
-    0x3f, 0xff, 0x9f, 0xff, 0x6f, 0xff, 0x3a, 0x00,
-    0x9d, 0x00, 0x58, 0xfe, 0xef, 0xff, 0x03, 0x03,
-    0xf5, 0xff, 0x1a, 0xfd, 0x2d, 0x01, 0x31, 0x00,
-    0x38, 0x02, 0x2a, 0x01, 0xa3, 0xfc, 0xcc, 0x00,
-    0x23, 0x03, 0x5e, 0xfc, 0xb7, 0xfd, 0x3d, 0xff,
-    0xb8, 0xff, 0x3d, 0x03, 0xc4, 0xfe, 0xa3, 0xfe,
-    0xc1, 0x00, 0x5b, 0xfe, 0x94, 0xfe, 0x62, 0x01,
-    0x75, 0xff, 0xea, 0xfd, 0x92, 0xff, 0x74, 0x01,
-    0x56, 0x01, 0xe4, 0xff, 0xca, 0xfe, 0x83, 0xff,
-    0x28, 0x02, 0x93, 0x00, 0x8d, 0xfb, 0xb6, 0xfe,
-    0x2a, 0x03, 0x64, 0x03, 0x77, 0x00, 0x4a, 0x00,
-    0xbc, 0x01, 0x6f, 0x00, 0xa9, 0xff, 0x21, 0xfe,
-    0x49, 0x01, 0xac, 0x01, 0xd9, 0xff, 0x75, 0xfe,
-    0x35, 0x00, 0x0e, 0x01, 0xaf, 0xfd, 0xd4, 0xfd,
-    0x5b, 0x02, 0x32, 0x02, 0xdd, 0xfb, 0x6c, 0xfd,
-    0x7d, 0xff, 0xb5, 0xff, 0x38, 0x01, 0x83, 0xfd,
-    0xb5, 0xff, 0x80, 0x02, 0x1f, 0x01, 0xb3, 0xfe,
-    0x3e, 0xfd, 0xad, 0x00, 0xd9, 0x00, 0xde, 0xfd,
-    0x34, 0xfe, 0x56, 0x00, 0x1c, 0x00, 0x27, 0x00,
-    0xea, 0xff, 0x34, 0x02, 0xcc, 0x00, 0x7a, 0xff,
-    0x78, 0xff, 0x5d, 0xff, 0x88, 0x00, 0x01, 0xff,
-    0x04, 0xfe, 0x8b, 0x01, 0xfe, 0x02, 0xb3, 0x02,
-    0x78, 0xff, 0xbf, 0xfd, 0x4a, 0x03, 0xc8, 0xff,
-    0x62, 0xfd, 0x4a, 0xfe, 0x83, 0x00, 0xb0, 0xff,
-    0x86, 0xff, 0x8f, 0xfe, 0x3e, 0x00, 0xd5, 0x03,
-    0x7f, 0xff, 0xff, 0xfc, 0x96, 0xff, 0xad, 0xff,
-    0x06, 0xfd, 0x7b, 0xfd, 0x05, 0x00, 0x93, 0x04,
-    0xe4, 0x00, 0x68, 0xff, 0x83, 0x00, 0x4c, 0x00,
-    0xcf, 0xfe, 0xc5, 0xfd, 0x37, 0xfe, 0xd5, 0xff,
-    0x4a, 0x01, 0x59, 0xfe, 0xb3, 0xfc, 0x53, 0x02,
-    0xa9, 0x03, 0x02, 0x01, 0xa0, 0xfd, 0xb7, 0xfb,
-    0x20, 0x02, 0x79, 0xfe, 0x25, 0xfd, 0xf1, 0x00,
-    0xe0, 0x02, 0x96, 0x00, 0x0e, 0xff, 0xe2, 0xff,
-    0xa4, 0x03, 0x03, 0xff, 0x62, 0xf9, 0xb7, 0xfe,
-    0x6c, 0x01, 0xa2, 0x01, 0x2d, 0xfc, 0x9e, 0x00,
-    0xdc, 0x03, 0x08, 0x00, 0x4f, 0xff, 0x3c, 0x01,
-    0x50, 0xff, 0x4a, 0x00, 0x56, 0xff, 0xa9, 0xff,
-    0x94, 0x00, 0x09, 0xfe, 0x51, 0x00, 0x03, 0x01,
-    0xaf, 0x00, 0x96, 0xfe, 0xa5, 0xff, 0x36, 0x00,
-    0xdc, 0xff, 0x0e, 0x00, 0xac, 0xff, 0xc7, 0xfe,
-    0xd0, 0xfe, 0xc2, 0xff, 0xe3, 0x02, 0x19, 0x02,
-    0xa1, 0x00, 0x71, 0xfe, 0x7a, 0xff, 0xe3, 0xfd,
-    0xd1, 0xfe, 0x66, 0xfe, 0x56, 0x00, 0x1d, 0x03,
-    0xe0, 0x00, 0xde, 0x03, 0xda, 0xfe, 0x74, 0xfe,
-    0xb8, 0x00, 0x8e, 0x03, 0x40, 0xfd, 0x22, 0xfd,
-    0x75, 0x01, 0x24, 0x02, 0x5f, 0x01, 0x3e, 0xff,
-    0xa2, 0x01, 0x68, 0xff, 0xd5, 0x00, 0x6f, 0x00,
-    0x7e, 0xfd, 0x31, 0xff, 0x35, 0x00, 0xbe, 0xff,
-    0xba, 0x02, 0x05, 0x01, 0xaf, 0xfd, 0x81, 0x00,
-    0x62, 0x00, 0xc6, 0xfc, 0x64, 0x00, 0x8a, 0x02,
-    0x46, 0xff, 0x04, 0xff, 0xff, 0x02, 0xb0, 0x01,
-    0x1e, 0xfd, 0x1a, 0xfe, 0x9d, 0x01, 0x3b, 0x05,
-    0xd3, 0x02, 0xdd, 0xfd, 0xed, 0xfd, 0x2f, 0x02,
-    0x1c, 0x02, 0xa8, 0xfe, 0xcb, 0xfd, 0x0d, 0xff,
-    0x62, 0x03, 0xf0, 0x02, 0x3e, 0xfe, 0x3e, 0x01,
-    0xad, 0x01, 0x15, 0x00, 0x59, 0xfe, 0x57, 0xfe,
-    0x22, 0x02, 0x23, 0x00, 0x10, 0xff, 0xd0, 0xff,
-    0x53, 0x03, 0x57, 0x02, 0xac, 0xfe, 0x1f, 0xfe,
-    0x2d, 0xff, 0x43, 0xff, 0xc1, 0xff, 0x72, 0x00,
-    0xfe, 0xff, 0xab, 0xff, 0x34, 0xff, 0xca, 0x02,
-    0xc2, 0x00, 0x25, 0xfe, 0x9f, 0x00, 0x58, 0xff,
-    0xb9, 0xfe, 0x71, 0xff, 0xf3, 0x00, 0xf6, 0x02,
-    0x2b, 0xfe, 0x94, 0xfe, 0xe0, 0x01, 0x38, 0x01,
-    0xa4, 0xfe, 0xa4, 0xff, 0x88, 0x00, 0x8e, 0x00,
-    0x22, 0x01, 0x2f, 0x00, 0x19, 0x02, 0x80, 0xff,
-    0xab, 0xff, 0xaf, 0x02, 0x1d, 0x01, 0x68, 0xff,
-    0x2f, 0x02, 0x17, 0x02, 0xbb, 0xff, 0x2d, 0xfe,
-    0x4d, 0x00, 0x4d, 0x00, 0xd3, 0xfd, 0x83, 0xff,
-    0xfe, 0x01, 0xc1, 0x00, 0x74, 0xfe, 0x61, 0x00,
-    0xa5, 0x01, 0x0b, 0x02, 0x6e, 0xfe, 0xb9, 0xfd,
-    0x30, 0x00, 0x56, 0xff, 0xa6, 0xfe, 0xf1, 0xff,
-    0x2e, 0x00, 0xa5, 0x01, 0x2a, 0x02, 0xdb, 0xfd,
-    0x23, 0xfd, 0xca, 0xfe, 0x23, 0x00, 0xbd, 0x02,
-    0xcc, 0xfe, 0x2d, 0xff, 0x3f, 0x04, 0xa2, 0x01,
-    0x8d, 0xff, 0x48, 0xff, 0x14, 0x01, 0xde, 0x00,
-    0x1f, 0xff, 0x9b, 0xfe, 0xbf, 0xff, 0xa5, 0xfe,
-    0x20, 0x00, 0xda, 0x02, 0x26, 0x02, 0x5e, 0x01,
-    0x7c, 0xff, 0x8e, 0xff, 0x00, 0x00, 0xde, 0x00,
-    0x8c, 0xfe, 0x7c, 0xff, 0x33, 0x00, 0xa9, 0x00,
-    0x59, 0x01, 0xba, 0xff, 0xf6, 0xfe, 0x62, 0x01,
-    0xfe, 0x01, 0xf3, 0xfe, 0x80, 0xfd, 0x1c, 0xfc,
-    0xbe, 0x01, 0xd3, 0x00, 0x48, 0xff, 0x97, 0x02,
-    0x16, 0x02, 0x82, 0x00, 0x45, 0xff, 0x63, 0xff,
-    0x57, 0xff, 0xd6, 0xfe, 0x06, 0xfe, 0x4f, 0x00,
-    0x9b, 0x03, 0xd5, 0x02, 0xb1, 0xfe, 0xc2, 0xff,
-    0xe0, 0x01, 0x18, 0x02, 0x09, 0x00, 0xec, 0xfd,
-    0xe9, 0xff, 0x32, 0x01, 0x32, 0x00, 0xb8, 0x00,
-    0xc8, 0x02, 0x1d, 0x02, 0x1f, 0x01, 0x14, 0xfe,
-    0x4b, 0xfe, 0xe8, 0xff, 0xa6, 0xfe, 0x8a, 0xfe,
-    0x50, 0xff, 0x22, 0x00, 0x51, 0x00, 0x3b, 0x00,
-    0x01, 0x00, 0x6d, 0x01, 0xc6, 0x00, 0xb6, 0xff,
-    0xf2, 0xfd, 0x3a, 0xfe, 0x6b, 0xff, 0xd8, 0xfe,
-    0x06, 0x00, 0x56, 0x01, 0xec, 0x00, 0xef, 0xfe,
-    0xf8, 0xfe, 0x55, 0xff, 0x61, 0xff, 0x8f, 0xfd,
-    0xf2, 0xff, 0x6c, 0x01, 0x3d, 0xff, 0x53, 0xff,
-    0x01, 0x00, 0x75, 0xff, 0x48, 0xff, 0x3a, 0x00,
-    0xab, 0x00, 0x10, 0x02, 0x0e, 0x00, 0xaa, 0xff,
-    0x17, 0x00, 0x16, 0xff, 0x46, 0xff, 0xb1, 0x01,
-    0x41, 0x01, 0x91, 0x00, 0xf4, 0x00, 0x2e, 0x00,
-    0x1a, 0xff, 0x57, 0xfd, 0xd1, 0xff, 0x41, 0x00,
-    0xa3, 0xfd, 0x8c, 0xfe, 0xe8, 0x01, 0x14, 0x01,
-    0xef, 0xfe, 0x2c, 0xfe, 0x51, 0xff, 0x2f, 0x01,
-    0xb9, 0xfd, 0xec, 0xfc, 0x82, 0xfe, 0x08, 0xfe,
-    0xb1, 0x00, 0xb9, 0x00, 0x57, 0x00, 0xca, 0x01,
-    0x7e, 0xff, 0xff, 0xfc, 0x04, 0xfe, 0xb9, 0xff,
-    0x3d, 0x00, 0x44, 0xff, 0x4f, 0x00, 0xfb, 0x00,
-    0x75, 0x00, 0x33, 0x00, 0xf3, 0xfd, 0x00, 0xfe,
-    0xd7, 0x00, 0x46, 0x02, 0x54, 0xff, 0x57, 0xff,
-    0x8d, 0x00, 0x27, 0xff, 0xb6, 0x00, 0xed, 0x00,
-    0x97, 0xff, 0x99, 0x01, 0xc5, 0xfe, 0x4a, 0xfd,
-    0x66, 0x00, 0xd3, 0xff, 0xc3, 0xff, 0x02, 0xff,
-    0xd3, 0xfe, 0x13, 0xff, 0x65, 0xff, 0xc8, 0xff,
-    0x67, 0xff, 0x3e, 0xff, 0xc6, 0xff, 0x65, 0x00,
-    0xd9, 0xfe, 0xde, 0xfe, 0x86, 0xff, 0x51, 0x00,
-    0x2f, 0xff, 0xe0, 0xfd, 0xae, 0xff, 0xa8, 0xff,
-    0x5c, 0xff, 0x66, 0xfe, 0x85, 0xff, 0xad, 0x00,
-    0xb4, 0xff, 0x73, 0xff, 0x1f, 0xff, 0x10, 0x00,
-    0xe4, 0xff, 0xd8, 0xfd, 0x1a, 0x00, 0x52, 0x02,
-    0xb0, 0x00, 0x72, 0xff, 0xdd, 0xff, 0xe1, 0x00,
-    0x0f, 0xff, 0x9b, 0xff, 0x6d, 0x00, 0xf0, 0xff,
-    0xe6, 0xff, 0x03, 0x01, 0x62, 0x01, 0xeb, 0x00,
-    0xb7, 0x01, 0xad, 0x00, 0x35, 0xfe, 0xfa, 0xfc,
-    0xa1, 0xfe, 0x3d, 0x00, 0x3c, 0x00, 0x14, 0x00,
-    0x2c, 0x01, 0x1c, 0x01, 0x81, 0xff, 0x6d, 0xff,
-    0xd8, 0xff, 0x49, 0xff, 0xac, 0xfe, 0xde, 0xfd,
-    0x1a, 0xff, 0x08, 0x01, 0x73, 0x01, 0xcb, 0xff,
-    0xb0, 0x00, 0x6b, 0x01, 0xcf, 0x00, 0x1c, 0xff,
-    0x64, 0xfc, 0x1f, 0xfd, 0x0e, 0xff, 0x0e, 0x00,
-    0xc4, 0x00, 0xf3, 0x00, 0x20, 0x01, 0x63, 0x00,
-    0x6a, 0xff, 0x7a, 0x00, 0x3a, 0xff, 0xce, 0xff,
-    0x45, 0xff, 0x7c, 0xfe, 0x8f, 0x00, 0x85, 0x01,
-    0xba, 0xff, 0x5a, 0x00, 0x57, 0x00, 0x64, 0x00,
-    0x9b, 0x00, 0xb8, 0xff, 0x51, 0x00, 0x3e, 0xff,
-    0x12, 0xff, 0x6b, 0x00, 0xa7, 0x02, 0x03, 0x02,
-    0xc8, 0x00, 0x88, 0xff, 0xbf, 0x00, 0x8b, 0x00,
-    0x4c, 0xff, 0x7f, 0xfe, 0x05, 0x00, 0xb9, 0xff,
-    0x9e, 0xfd, 0xce, 0x00, 0xd4, 0x01, 0x3d, 0x00,
-    0x65, 0xfe, 0x29, 0xff, 0x8e, 0x00, 0x29, 0x00,
-    0x10, 0xfe, 0x64, 0x00, 0x1c, 0x01, 0x79, 0xfe,
-    0xec, 0xff, 0x39, 0x01, 0x98, 0x01, 0x82, 0x00,
-    0x19, 0x00, 0xda, 0xff, 0xf6, 0x00, 0x17, 0x00,
-    0x84, 0xfe, 0x42, 0xff, 0x0a, 0x00, 0x1f, 0x01,
-    0x12, 0x01, 0x42, 0x01, 0x42, 0x00, 0xa4, 0x00,
-    0xfa, 0x00, 0x7b, 0xff, 0x95, 0xfe, 0xe7, 0xff,
-    0x3c, 0x01, 0xcb, 0xff, 0xf6, 0xfe, 0x0f, 0x00,
-    0xa9, 0x00, 0xcc, 0x00, 0xb5, 0x00, 0xab, 0xff,
-    0x75, 0x00, 0x5c, 0x01, 0xbe, 0xff, 0x3a, 0xfe,
-    0x30, 0xff, 0xfb, 0x01, 0x8c, 0x01, 0x7d, 0x00,
-    0x82, 0x00, 0xf8, 0xff, 0xc0, 0x01, 0x66, 0xff,
-    0x3a, 0xfc, 0xd4, 0xfe, 0xb2, 0x01, 0x97, 0x00,
-    0xe9, 0x00, 0xcd, 0x01, 0xa3, 0x00, 0x29, 0x01,
-    0x52, 0x00, 0xb3, 0xff, 0x7c, 0x00, 0x02, 0x00,
-    0x54, 0xfe, 0x06, 0xff, 0x27, 0x02, 0xa6, 0x01,
-    0xe4, 0xff, 0xf9, 0xff, 0x72, 0x01, 0x3e, 0x01,
-    0x98, 0xfe, 0xe5, 0xfd, 0xef, 0xff, 0xa6, 0x01,
-    0x03, 0x01, 0x53, 0xff, 0x40, 0xff, 0x95, 0x01,
-    0xb6, 0x01, 0x03, 0x01, 0x82, 0x00, 0x99, 0xff,
-    0xfd, 0xfe, 0x0a, 0xff, 0x31, 0x00, 0x73, 0x01,
-    0x76, 0x00, 0xc7, 0x00, 0xd7, 0x00, 0xf3, 0x00,
-    0xe9, 0x01, 0x57, 0x00, 0x35, 0xff, 0x05, 0xff,
-    0x86, 0x00, 0x7c, 0x01, 0xfc, 0x01, 0x46, 0x00,
-    0xf4, 0x00, 0xa5, 0x01, 0xa6, 0x00, 0xa5, 0xff,
-    0xa8, 0xff, 0x80, 0x00, 0x08, 0xff, 0x4a, 0xff,
-    0xee, 0xff, 0x54, 0x00, 0xba, 0x00, 0xd0, 0x01,
-    0x2a, 0x01, 0x99, 0x00, 0x50, 0xff, 0x08, 0xff,
-    0x45, 0x00, 0x68, 0xff, 0xa5, 0xfe, 0x7d, 0xff,
-    0x30, 0x00, 0x96, 0x00, 0x71, 0x01, 0xa2, 0x00,
-    0x48, 0x00, 0xca, 0xff, 0xe6, 0xff, 0x84, 0x00,
-    0xd7, 0xff, 0x46, 0xff, 0x47, 0x00, 0x03, 0x01,
-    0x06, 0x01, 0x65, 0x01, 0x57, 0x01, 0xa5, 0x01,
-    0xae, 0x00, 0xa7, 0xff, 0x4b, 0x00, 0xe6, 0xff,
-    0x38, 0x00, 0x9b, 0x00, 0x39, 0x00, 0xeb, 0x00,
-    0x97, 0x00, 0x87, 0x00, 0xf2, 0x01, 0x06, 0x00,
-    0xc7, 0xfe, 0x8e, 0x00, 0x4a, 0x00, 0x20, 0xff,
-    0x24, 0xff, 0x1b, 0x00, 0x2c, 0x01, 0xf7, 0x00,
-    0xfe, 0xfe, 0x72, 0xff, 0xf2, 0xff, 0xf2, 0xfe,
-    0x6d, 0xfe, 0x0d, 0xff, 0xf0, 0xff, 0xfb, 0xfe,
-    0xcc, 0xfe, 0xdc, 0x00, 0x2e, 0x01, 0xf0, 0xff,
-    0x77, 0xff, 0xea, 0xfe, 0x78, 0xff, 0x38, 0x00,
-    0x88, 0x00, 0x3c, 0x00, 0x83, 0xff, 0xc4, 0x00,
-    0x5e, 0x02, 0x4f, 0x01, 0x63, 0xff, 0xf2, 0xfe,
-    0x31, 0x00, 0x22, 0x00, 0x9a, 0xff, 0x95, 0x00,
-    0x3f, 0x01, 0x80, 0x00, 0xe0, 0xff, 0xf6, 0x00,
-    0x25, 0x01, 0x8e, 0x00, 0xda, 0xff, 0xde, 0xff,
-    0x3b, 0x01, 0xe9, 0xff, 0x95, 0xfe, 0xb1, 0xff,
-    0x57, 0x00, 0x36, 0xff, 0x77, 0xfe, 0x3f, 0xff,
-    0xe1, 0xff, 0x4c, 0x00, 0xe4, 0xff, 0xd0, 0xfe,
-    0x54, 0xff, 0x43, 0x00, 0x1a, 0xff, 0x61, 0xff,
-    0x86, 0x00, 0x2f, 0x00, 0x28, 0x00, 0x6f, 0xff,
-    0x3c, 0xff, 0x9e, 0x00, 0x09, 0x00, 0xd2, 0xfe,
-    0x9d, 0xff, 0x72, 0x00, 0xfc, 0xff, 0x71, 0xff,
-    0xd2, 0xff, 0x15, 0x01, 0x8a, 0x00, 0x55, 0xff,
-    0xe2, 0xff, 0x80, 0x00, 0xc6, 0x00, 0x1b, 0x00,
-    0xdd, 0xff, 0x07, 0x00, 0x91, 0x00, 0xba, 0x00,
-    0xc0, 0xff, 0x79, 0xff, 0x5b, 0x00, 0x6a, 0x00,
-    0x27, 0x00, 0x0e, 0x00, 0x41, 0xfe, 0xb6, 0xfe,
-    0xdc, 0xff, 0x41, 0xfe, 0x5c, 0xfe, 0xac, 0xff,
-    0xce, 0xff, 0x5c, 0x00, 0x7a, 0x00, 0x86, 0x00,
-    0x9c, 0x00, 0xef, 0xff, 0x36, 0xff, 0x4c, 0xff,
-    0x83, 0xff, 0x6d, 0xfe, 0x3e, 0xfe, 0x76, 0x00,
-    0x46, 0x01, 0x27, 0x00, 0xa7, 0xff, 0xf4, 0xfe,
-    0x10, 0x00, 0xb2, 0x00, 0xa5, 0xfe, 0x88, 0xfe,
-    0x9f, 0xff, 0xd6, 0xff, 0x81, 0x00, 0x34, 0x00,
-    0x2a, 0x00, 0x26, 0x01, 0x4f, 0x01, 0xa8, 0xff,
-    0x35, 0xff, 0xa5, 0xff, 0xd3, 0xfe, 0xc4, 0xfe,
-    0xe2, 0xfe, 0x65, 0x00, 0x38, 0x01, 0xd7, 0xff,
-    0x8b, 0xff, 0x65, 0xff, 0xd6, 0xfe, 0xa9, 0xfe,
-    0x8b, 0xfd, 0x88, 0xfe, 0x85, 0xff, 0x5d, 0xff,
-    0xe3, 0xff, 0x60, 0x00, 0x4c, 0x00, 0xa1, 0x00,
-    0x1a, 0x00, 0xe9, 0xfe, 0xa0, 0xff, 0x75, 0xfe,
-    0xd3, 0xfe, 0xdf, 0xff, 0x7a, 0xff, 0x50, 0x00,
-    0xd2, 0x00, 0x79, 0x00, 0x76, 0xff, 0x26, 0xff,
-    0x2c, 0xff, 0xa3, 0xff, 0xd0, 0xff, 0xa8, 0xfe,
-    0xa7, 0xff, 0x86, 0x00, 0xde, 0x00, 0xca, 0x00,
-    0x8a, 0x00, 0xa3, 0x00, 0x15, 0x00, 0x46, 0xfe,
-    0xdc, 0xfd, 0x28, 0x00, 0x28, 0xff, 0x9e, 0xff,
-    0x3b, 0x00, 0x70, 0x00, 0xf0, 0x00, 0x84, 0xff,
-    0xab, 0xfe, 0xff, 0xfe, 0x09, 0xff, 0xf8, 0xfd,
-    0xe1, 0xfe, 0x30, 0xff, 0x50, 0xff, 0x3a, 0x00,
-    0x55, 0xff, 0xff, 0xff, 0x76, 0x00, 0x5e, 0xff,
-    0xeb, 0xfe, 0x28, 0xfe, 0x3e, 0xfe, 0xd0, 0xfe,
-    0x35, 0xff, 0x89, 0xff, 0xc0, 0x00, 0xae, 0x00,
-    0xc2, 0xff, 0x1c, 0x00, 0x11, 0x00, 0x29, 0xff,
-    0xb0, 0xfe, 0xc6, 0xfe, 0xb1, 0xff, 0xa7, 0x00,
-    0xb7, 0x00, 0xa0, 0x00, 0xfa, 0x00, 0xde, 0x00,
-    0xc5, 0xff, 0x1f, 0xff, 0xdd, 0xfe, 0x1d, 0xff,
-    0x5e, 0xff, 0x17, 0x00, 0xee, 0xff, 0xeb, 0xff,
-    0x60, 0x00, 0xda, 0xff, 0xe0, 0xff, 0x0e, 0x00,
-    0x40, 0xff, 0x21, 0xff, 0x5b, 0xff, 0xf5, 0xfe,
-    0x3b, 0x00, 0xcb, 0x00, 0xa5, 0xff, 0xa2, 0xff,
-    0x12, 0x00, 0x66, 0xff, 0x27, 0xff, 0xe3, 0xfe,
-    0x0d, 0xff, 0x15, 0x00, 0x52, 0x00, 0x31, 0x00,
-    0x98, 0x00, 0x86, 0x00, 0x7f, 0xff, 0x1f, 0x00,
-    0xfa, 0xff, 0xdc, 0xff, 0xcd, 0xff, 0x92, 0xff,
-    0x9f, 0x00, 0x8c, 0x00, 0xdd, 0xff, 0x0f, 0x00,
-    0xd0, 0x00, 0x3e, 0x00, 0x74, 0xff, 0x4b, 0xff,
-    0xaf, 0xff, 0x06, 0xff, 0x38, 0xff, 0x50, 0x00,
-    0x69, 0x00, 0x5b, 0x00, 0x80, 0x00, 0x2a, 0x00,
-    0x94, 0xff, 0x21, 0x00, 0xc9, 0xff, 0x9f, 0xff,
-    0xa5, 0xff, 0x25, 0x00, 0xae, 0x00, 0xc2, 0xff,
-    0x9a, 0xff, 0x03, 0x00, 0x5f, 0x00, 0x4d, 0x00,
-    0x11, 0x00, 0x07, 0x00, 0xa4, 0xff, 0x67, 0xff,
-    0x16, 0x00, 0x8a, 0x00, 0xff, 0xff, 0xf7, 0xff,
-    0xd2, 0xff, 0x03, 0x00, 0x23, 0x00, 0xd6, 0xff,
-    0x4a, 0x00, 0xe4, 0xff, 0xa2, 0xff, 0xe5, 0xff,
-    0x9f, 0xff, 0xa1, 0xff, 0x2c, 0x00, 0xc3, 0x00,
-    0xb2, 0x00, 0x18, 0x00, 0x93, 0xff, 0xab, 0xff,
-    0x34, 0xff, 0x46, 0xff, 0xba, 0xff, 0xfc, 0xff,
-    0x08, 0x00, 0x24, 0x00, 0x9d, 0x00, 0x9e, 0x00,
-    0x5a, 0x00, 0xbc, 0xff, 0x03, 0x00, 0x5d, 0x00,
-    0x7f, 0x00, 0x2c, 0x00, 0xe4, 0xff, 0x16, 0x00,
-    0xca, 0x00, 0xa7, 0x00, 0x45, 0x00, 0x68, 0xff,
-    0x69, 0xff, 0x21, 0x00, 0x46, 0xff, 0x96, 0xff,
-    0x1c, 0x00, 0x9e, 0x00, 0xea, 0xff, 0x27, 0xff,
-    0x1e, 0x00, 0x6d, 0x00, 0x4b, 0xff, 0x86, 0xff,
-    0x37, 0x00, 0x7b, 0x00, 0x64, 0x00, 0x56, 0xff,
-    0xf4, 0xff, 0xeb, 0x00, 0x0b, 0x01, 0x5f, 0x00,
-    0xed, 0xff, 0x7e, 0x00, 0x46, 0x00, 0x30, 0x00,
-    0x4b, 0x00, 0x63, 0x00, 0x58, 0x01, 0xd7, 0x00,
-    0x71, 0x00, 0x93, 0x00, 0x73, 0x00, 0xc6, 0x00,
-    0x24, 0x00, 0x28, 0x00, 0x4f, 0x00, 0x2b, 0x00,
-    0x01, 0x00, 0x9b, 0xff, 0x1f, 0x00, 0x39, 0x00,
-    0xcb, 0xff, 0xd7, 0xff, 0xc1, 0xff, 0xb4, 0xff,
-    0x50, 0xff, 0x81, 0xff, 0x11, 0x00, 0x36, 0x00,
-    0x80, 0x00, 0x71, 0x00, 0x67, 0x00, 0x5a, 0x00,
-    0x2a, 0x00, 0x73, 0x00, 0xfb, 0xff, 0xc7, 0xff,
-    0x8d, 0x00, 0x65, 0x00, 0x66, 0x00, 0x2d, 0x00,
-    0xe8, 0x00, 0x7d, 0x01, 0xf9, 0x00, 0x44, 0x00,
-    0x2b, 0x00, 0x4e, 0x00, 0x5e, 0x00, 0x72, 0x00,
-    0xc3, 0xff, 0x5c, 0x00, 0x18, 0x01, 0x10, 0x01,
-    0x8a, 0x00, 0x6d, 0x00, 0x83, 0x00, 0xa3, 0x00,
-    0x5f, 0x00, 0x1c, 0x00, 0x2f, 0x00, 0x51, 0x00,
-    0x15, 0x00, 0x3c, 0x00, 0x33, 0x01, 0x9d, 0x00,
-    0x4b, 0x00, 0xd6, 0xff, 0xc1, 0xff, 0xfc, 0xff,
-    0x0e, 0xff, 0x6d, 0xff, 0x8b, 0x00, 0xa0, 0x00,
-    0xb5, 0x00, 0xa1, 0x00, 0x0e, 0x00, 0xc2, 0xff,
-    0xdf, 0xff, 0x7d, 0x00, 0x92, 0x00, 0x50, 0x00,
-    0x4f, 0x00, 0xda, 0x00, 0x34, 0x01, 0xec, 0x00,
-    0x57, 0x00, 0x59, 0x00, 0x80, 0x00, 0x8a, 0x00,
-    0x86, 0x00, 0xf3, 0xff, 0x90, 0x00, 0x8c, 0x00,
-    0x20, 0x00, 0x30, 0x00, 0x75, 0x00, 0x84, 0x00,
-    0xe4, 0xff, 0x87, 0x00, 0xab, 0x00, 0x59, 0x00,
-    0x25, 0x00, 0x33, 0x00, 0x90, 0x00, 0x86, 0x00,
-    0xca, 0xff, 0x9e, 0xff, 0xb3, 0x00, 0xc6, 0x00,
-    0x7b, 0x00, 0x77, 0x00, 0x84, 0x00, 0x67, 0x00,
-    0xeb, 0xff, 0x98, 0xff, 0x0b, 0x00, 0x31, 0x00,
-    0x61, 0x00, 0x3d, 0x00, 0xb6, 0x00, 0x03, 0x01,
-    0x6d, 0x00, 0x5e, 0x00, 0x81, 0x00, 0x54, 0x00,
-    0x8e, 0xff, 0x8b, 0xff, 0x2f, 0x00, 0xba, 0x00,
-    0x54, 0x00, 0x35, 0x00, 0x5b, 0x00, 0xca, 0x00,
-    0xff, 0xff, 0x1d, 0xff, 0xc9, 0xff, 0x66, 0xff,
-    0x11, 0xff, 0x8b, 0xff, 0xfa, 0xff, 0x21, 0x00,
-    0xc5, 0xff, 0x35, 0x00, 0x93, 0x00, 0xf7, 0xff,
-    0xe9, 0xff, 0x49, 0x00, 0x09, 0x00, 0xa8, 0xff,
-    0x2f, 0x00, 0xe1, 0x00, 0xa8, 0x00, 0x94, 0x00,
-    0x25, 0x01, 0x5a, 0x01, 0xaf, 0x00, 0xd7, 0xff,
-    0xd8, 0xff, 0xa9, 0xff, 0xb6, 0xff, 0xf5, 0xff,
-    0x50, 0x00, 0x56, 0x00, 0x24, 0x00, 0x6e, 0x00,
-    0x68, 0x00, 0x4a, 0x00, 0x94, 0xff, 0x6a, 0xff,
-    0x8f, 0xff, 0x45, 0xff, 0xdd, 0xff, 0x5b, 0x00,
-    0x56, 0x00, 0x77, 0x00, 0x9f, 0x00, 0x51, 0x00,
-    0xf4, 0xff, 0xe5, 0xff, 0xa5, 0xff, 0xd2, 0xff,
-    0x0b, 0x00, 0xce, 0xff, 0x18, 0x00, 0x68, 0x00,
-    0x24, 0x00, 0x51, 0x00, 0x93, 0x00, 0xe3, 0xff,
-    0x1b, 0x00, 0x39, 0x00, 0xe4, 0xff, 0x0b, 0x00,
-    0xa9, 0xff, 0x3d, 0x00, 0xa0, 0x00, 0x8b, 0x00,
-    0x63, 0x00, 0x4f, 0x00, 0x00, 0x00, 0xaf, 0xff,
-    0x71, 0xff, 0xa2, 0xff, 0x4d, 0x00, 0x91, 0xff,
-    0x72, 0xff, 0xe5, 0xff, 0x21, 0x00, 0x16, 0x00,
-    0x96, 0xff, 0xe4, 0xff, 0x07, 0x00, 0x97, 0xff,
-    0x71, 0xff, 0x53, 0xff, 0xe1, 0xff, 0x5d, 0x00,
-    0xb5, 0xff, 0xf7, 0xff, 0xeb, 0x00, 0x7b, 0x00,
-    0x33, 0x00, 0xf9, 0xff, 0xee, 0xff, 0x28, 0x00,
-    0x63, 0xff, 0x60, 0xff, 0xfd, 0xff, 0xfc, 0xff,
-    0xab, 0xff, 0xde, 0xff, 0x67, 0x00, 0xff, 0xff,
-    0xa1, 0xff, 0xbc, 0xff, 0x64, 0xff, 0x6d, 0xff,
-    0x69, 0xff, 0x91, 0xff, 0xd9, 0xff, 0xef, 0xff,
-    0x21, 0x00, 0x2d, 0x00, 0xf0, 0xff, 0xbc, 0xff,
-    0xd7, 0xff, 0x83, 0xff, 0x9a, 0xff
-};
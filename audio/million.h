@@ -1,4054 +0,0 @@
-constexpr uint32_t MILLION_SAMPLE_RATE = 22058;
-constexpr uint32_t MILLION_SAMPLE_SIZE = 32382;
-constexpr uint32_t MILLION_SAMPLES_PER_BLOCK = 16191;
-
-const uint8_t INFLASH MILLION_AUDIO_DATA[] = {
-    0x64, 0x00, 0x76, 0x00, 0x7c, 0x00, 0x8f, 0x00,
-    0x90, 0x00, 0xa9, 0x00, 0xad, 0x00, 0xbc, 0x00,
-    0xb9, 0x00, 0xc6, 0x00, 0xd4, 0x00, 0xdd, 0x00,
-    0xe8, 0x00, 0xfc, 0x00, 0xff, 0x00, 0x02, 0x01,
-    0x05, 0x01, 0x01, 0x01, 0xff, 0x00, 0xfa, 0x00,
-    0xf7, 0x00, 0xff, 0x00, 0x03, 0x01, 0xfe, 0x00,
-    0xf3, 0x00, 0xe6, 0x00, 0xdd, 0x00, 0xd8, 0x00,
-    0xd1, 0x00, 0xc5, 0x00, 0xbb, 0x00, 0xa2, 0x00,
-    0x92, 0x00, 0x7a, 0x00, 0x63, 0x00, 0x56, 0x00,
-    0x3c, 0x00, 0x2b, 0x00, 0x1a, 0x00, 0x0b, 0x00,
-    0xf5, 0xff, 0xdf, 0xff, 0xca, 0xff, 0xb3, 0xff,
-    0xa3, 0xff, 0x8e, 0xff, 0x7e, 0xff, 0x69, 0xff,
-    0x51, 0xff, 0x41, 0xff, 0x30, 0xff, 0x1a, 0xff,
-    0x09, 0xff, 0xf4, 0xfe, 0xe1, 0xfe, 0xe0, 0xfe,
-    0xcb, 0xfe, 0xc3, 0xfe, 0xb5, 0xfe, 0xab, 0xfe,
-    0xa2, 0xfe, 0x93, 0xfe, 0x91, 0xfe, 0x84, 0xfe,
-    0x84, 0xfe, 0x7b, 0xfe, 0x80, 0xfe, 0x7a, 0xfe,
-    0x72, 0xfe, 0x7b, 0xfe, 0x80, 0xfe, 0x81, 0xfe,
-    0x8a, 0xfe, 0x90, 0xfe, 0x9d, 0xfe, 0xaa, 0xfe,
-    0xb5, 0xfe, 0xc3, 0xfe, 0xcd, 0xfe, 0xd4, 0xfe,
-    0xda, 0xfe, 0xf0, 0xfe, 0x03, 0xff, 0x16, 0xff,
-    0x28, 0xff, 0x38, 0xff, 0x52, 0xff, 0x69, 0xff,
-    0x89, 0xff, 0xa0, 0xff, 0xbb, 0xff, 0xd6, 0xff,
-    0xe5, 0xff, 0x02, 0x00, 0x26, 0x00, 0x4d, 0x00,
-    0x62, 0x00, 0x7c, 0x00, 0x97, 0x00, 0xb5, 0x00,
-    0xd8, 0x00, 0xf8, 0x00, 0x18, 0x01, 0x2e, 0x01,
-    0x51, 0x01, 0x72, 0x01, 0x9a, 0x01, 0xba, 0x01,
-    0xd1, 0x01, 0xed, 0x01, 0x06, 0x02, 0x1b, 0x02,
-    0x38, 0x02, 0x52, 0x02, 0x64, 0x02, 0x78, 0x02,
-    0x90, 0x02, 0x97, 0x02, 0x9b, 0x02, 0xa5, 0x02,
-    0xac, 0x02, 0xb2, 0x02, 0xb1, 0x02, 0xac, 0x02,
-    0xab, 0x02, 0xa5, 0x02, 0x8f, 0x02, 0x71, 0x02,
-    0x56, 0x02, 0x40, 0x02, 0x25, 0x02, 0x13, 0x02,
-    0xf2, 0x01, 0xcc, 0x01, 0xa6, 0x01, 0x7c, 0x01,
-    0x55, 0x01, 0x28, 0x01, 0xfb, 0x00, 0xc7, 0x00,
-    0x9d, 0x00, 0x6d, 0x00, 0x45, 0x00, 0x1a, 0x00,
-    0xec, 0xff, 0xc0, 0xff, 0x8a, 0xff, 0x61, 0xff,
-    0x37, 0xff, 0x0a, 0xff, 0xda, 0xfe, 0xa7, 0xfe,
-    0x79, 0xfe, 0x4a, 0xfe, 0x21, 0xfe, 0xf0, 0xfd,
-    0xc4, 0xfd, 0x9c, 0xfd, 0x77, 0xfd, 0x56, 0xfd,
-    0x2c, 0xfd, 0x05, 0xfd, 0xe4, 0xfc, 0xc2, 0xfc,
-    0xa3, 0xfc, 0x87, 0xfc, 0x68, 0xfc, 0x52, 0xfc,
-    0x38, 0xfc, 0x1f, 0xfc, 0x0c, 0xfc, 0x04, 0xfc,
-    0xf8, 0xfb, 0xf3, 0xfb, 0xf6, 0xfb, 0xeb, 0xfb,
-    0xea, 0xfb, 0xf2, 0xfb, 0xf8, 0xfb, 0x00, 0xfc,
-    0x0f, 0xfc, 0x21, 0xfc, 0x2e, 0xfc, 0x45, 0xfc,
-    0x5e, 0xfc, 0x7a, 0xfc, 0x9c, 0xfc, 0xc0, 0xfc,
-    0xf5, 0xfc, 0x36, 0xfd, 0x71, 0xfd, 0xab, 0xfd,
-    0xee, 0xfd, 0x38, 0xfe, 0x8a, 0xfe, 0xe0, 0xfe,
-    0x3d, 0xff, 0xa8, 0xff, 0x1f, 0x00, 0x96, 0x00,
-    0x11, 0x01, 0x89, 0x01, 0xfd, 0x01, 0x7a, 0x02,
-    0xf3, 0x02, 0x6e, 0x03, 0xed, 0x03, 0x6a, 0x04,
-    0xe5, 0x04, 0x53, 0x05, 0xb8, 0x05, 0x1b, 0x06,
-    0x7c, 0x06, 0xca, 0x06, 0x0f, 0x07, 0x57, 0x07,
-    0x9b, 0x07, 0xd8, 0x07, 0x0a, 0x08, 0x34, 0x08,
-    0x57, 0x08, 0x7c, 0x08, 0x92, 0x08, 0x9d, 0x08,
-    0x97, 0x08, 0x89, 0x08, 0x7e, 0x08, 0x6e, 0x08,
-    0x45, 0x08, 0x0f, 0x08, 0xe1, 0x07, 0xa4, 0x07,
-    0x64, 0x07, 0x15, 0x07, 0xbb, 0x06, 0x5a, 0x06,
-    0xe7, 0x05, 0x72, 0x05, 0xf7, 0x04, 0x6e, 0x04,
-    0xdc, 0x03, 0x49, 0x03, 0xb7, 0x02, 0x27, 0x02,
-    0xa3, 0x01, 0x17, 0x01, 0x94, 0x00, 0x0a, 0x00,
-    0x69, 0xff, 0xde, 0xfe, 0x4a, 0xfe, 0xa9, 0xfd,
-    0x09, 0xfd, 0x72, 0xfc, 0xd7, 0xfb, 0x3f, 0xfb,
-    0xab, 0xfa, 0x0e, 0xfa, 0x74, 0xf9, 0xe2, 0xf8,
-    0x4a, 0xf8, 0xba, 0xf7, 0x28, 0xf7, 0x95, 0xf6,
-    0x0a, 0xf6, 0x79, 0xf5, 0xf1, 0xf4, 0x6b, 0xf4,
-    0xf6, 0xf3, 0x82, 0xf3, 0x05, 0xf3, 0x9c, 0xf2,
-    0x4b, 0xf2, 0x30, 0xf2, 0x3a, 0xf2, 0x46, 0xf2,
-    0x59, 0xf2, 0x62, 0xf2, 0x8a, 0xf2, 0x9b, 0xf2,
-    0x9b, 0xf2, 0xae, 0xf2, 0xf0, 0xf2, 0x81, 0xf3,
-    0x34, 0xf4, 0x0a, 0xf5, 0xeb, 0xf5, 0xde, 0xf6,
-    0xe8, 0xf7, 0xf2, 0xf8, 0x05, 0xfa, 0x21, 0xfb,
-    0x60, 0xfc, 0xb8, 0xfd, 0x02, 0xff, 0x54, 0x00,
-    0x92, 0x01, 0xd4, 0x02, 0x0f, 0x04, 0x57, 0x05,
-    0xb3, 0x06, 0x1f, 0x08, 0x91, 0x09, 0xc6, 0x0a,
-    0xd8, 0x0b, 0xba, 0x0c, 0x83, 0x0d, 0x32, 0x0e,
-    0xcc, 0x0e, 0x57, 0x0f, 0xd5, 0x0f, 0x4d, 0x10,
-    0xaa, 0x10, 0xeb, 0x10, 0x16, 0x11, 0x31, 0x11,
-    0x38, 0x11, 0x31, 0x11, 0x28, 0x11, 0x20, 0x11,
-    0x06, 0x11, 0xc5, 0x10, 0x52, 0x10, 0xbf, 0x0f,
-    0x24, 0x0f, 0x82, 0x0e, 0xe3, 0x0d, 0x42, 0x0d,
-    0xab, 0x0c, 0x24, 0x0c, 0x98, 0x0b, 0x07, 0x0b,
-    0x65, 0x0a, 0xba, 0x09, 0xfe, 0x08, 0x34, 0x08,
-    0x5d, 0x07, 0x85, 0x06, 0x9f, 0x05, 0xa9, 0x04,
-    0xb4, 0x03, 0xb3, 0x02, 0xb5, 0x01, 0xca, 0x00,
-    0xeb, 0xff, 0x0b, 0xff, 0x22, 0xfe, 0x2b, 0xfd,
-    0x3b, 0xfc, 0x2c, 0xfb, 0x01, 0xfa, 0xdc, 0xf8,
-    0xbd, 0xf7, 0xb3, 0xf6, 0xb4, 0xf5, 0xaa, 0xf4,
-    0x8c, 0xf3, 0x7a, 0xf2, 0x79, 0xf1, 0x83, 0xf0,
-    0xa9, 0xef, 0xdc, 0xee, 0x19, 0xee, 0x73, 0xed,
-    0xd5, 0xec, 0x47, 0xec, 0xae, 0xeb, 0x06, 0xeb,
-    0x38, 0xea, 0x67, 0xe9, 0xe1, 0xe8, 0xca, 0xe8,
-    0x63, 0xe9, 0x3c, 0xea, 0x14, 0xeb, 0xce, 0xeb,
-    0x68, 0xec, 0xc8, 0xec, 0xcb, 0xec, 0xa6, 0xec,
-    0xbf, 0xec, 0x76, 0xed, 0xc3, 0xee, 0x66, 0xf0,
-    0x0d, 0xf2, 0x85, 0xf3, 0xe6, 0xf4, 0x2a, 0xf6,
-    0x6d, 0xf7, 0xf4, 0xf8, 0xd1, 0xfa, 0xec, 0xfc,
-    0xf9, 0xfe, 0xd2, 0x00, 0x80, 0x02, 0x17, 0x04,
-    0x97, 0x05, 0x1e, 0x07, 0xe5, 0x08, 0x07, 0x0b,
-    0x5e, 0x0d, 0xa7, 0x0f, 0x8e, 0x11, 0xd2, 0x12,
-    0x8f, 0x13, 0x0f, 0x14, 0x81, 0x14, 0x0b, 0x15,
-    0xb5, 0x15, 0x3e, 0x16, 0x85, 0x16, 0x80, 0x16,
-    0x52, 0x16, 0x14, 0x16, 0xc7, 0x15, 0x6e, 0x15,
-    0x1d, 0x15, 0xe1, 0x14, 0xb3, 0x14, 0x48, 0x14,
-    0x8a, 0x13, 0x7c, 0x12, 0x77, 0x11, 0x94, 0x10,
-    0xdc, 0x0f, 0x3d, 0x0f, 0x94, 0x0e, 0x1c, 0x0e,
-    0x95, 0x0d, 0x02, 0x0d, 0x4b, 0x0c, 0xa1, 0x0b,
-    0xf2, 0x0a, 0x4b, 0x0a, 0xa0, 0x09, 0xa5, 0x08,
-    0x98, 0x07, 0x78, 0x06, 0x43, 0x05, 0x1b, 0x04,
-    0xf5, 0x02, 0xd9, 0x01, 0xd4, 0x00, 0xd8, 0xff,
-    0xc8, 0xfe, 0x97, 0xfd, 0x56, 0xfc, 0x1e, 0xfb,
-    0x05, 0xfa, 0xd9, 0xf8, 0xab, 0xf7, 0x72, 0xf6,
-    0x23, 0xf5, 0xe1, 0xf3, 0xb8, 0xf2, 0xa1, 0xf1,
-    0xad, 0xf0, 0xc7, 0xef, 0xe4, 0xee, 0x10, 0xee,
-    0x26, 0xed, 0x3f, 0xec, 0x53, 0xeb, 0x7e, 0xea,
-    0xbb, 0xe9, 0x09, 0xe9, 0x72, 0xe8, 0xe8, 0xe7,
-    0x61, 0xe7, 0xca, 0xe6, 0x1c, 0xe6, 0x8e, 0xe5,
-    0x7c, 0xe5, 0x4b, 0xe6, 0x84, 0xe7, 0xc7, 0xe8,
-    0xd7, 0xe9, 0x96, 0xea, 0x30, 0xeb, 0x89, 0xeb,
-    0x98, 0xeb, 0x9c, 0xeb, 0x74, 0xec, 0x2a, 0xee,
-    0x57, 0xf0, 0x90, 0xf2, 0x5c, 0xf4, 0xe9, 0xf5,
-    0x7c, 0xf7, 0x02, 0xf9, 0xbe, 0xfa, 0xdd, 0xfc,
-    0x5a, 0xff, 0xf3, 0x01, 0x49, 0x04, 0x32, 0x06,
-    0xfa, 0x07, 0xd9, 0x09, 0xb7, 0x0b, 0xd6, 0x0d,
-    0x15, 0x10, 0x93, 0x12, 0x12, 0x15, 0x0a, 0x17,
-    0x54, 0x18, 0x12, 0x19, 0x5d, 0x19, 0xa4, 0x19,
-    0x14, 0x1a, 0x97, 0x1a, 0x12, 0x1b, 0x49, 0x1b,
-    0x10, 0x1b, 0x8e, 0x1a, 0x05, 0x1a, 0x75, 0x19,
-    0xeb, 0x18, 0x3d, 0x18, 0xa8, 0x17, 0x43, 0x17,
-    0xb8, 0x16, 0xd2, 0x15, 0x87, 0x14, 0x22, 0x13,
-    0xfb, 0x11, 0x1d, 0x11, 0x61, 0x10, 0x97, 0x0f,
-    0xee, 0x0e, 0x1f, 0x0e, 0x49, 0x0d, 0x55, 0x0c,
-    0x4a, 0x0b, 0x7b, 0x0a, 0xcb, 0x09, 0x16, 0x09,
-    0x17, 0x08, 0xfb, 0x06, 0xb8, 0x05, 0x7f, 0x04,
-    0x35, 0x03, 0xe4, 0x01, 0xa8, 0x00, 0x8c, 0xff,
-    0x80, 0xfe, 0x51, 0xfd, 0xfe, 0xfb, 0x9a, 0xfa,
-    0x38, 0xf9, 0xe3, 0xf7, 0xa1, 0xf6, 0x52, 0xf5,
-    0xf7, 0xf3, 0xa6, 0xf2, 0x5d, 0xf1, 0x28, 0xf0,
-    0x0c, 0xef, 0xf9, 0xed, 0x07, 0xed, 0x0c, 0xec,
-    0x0c, 0xeb, 0x0f, 0xea, 0x16, 0xe9, 0x21, 0xe8,
-    0x46, 0xe7, 0x85, 0xe6, 0xec, 0xe5, 0x54, 0xe5,
-    0xc8, 0xe4, 0x2a, 0xe4, 0x60, 0xe3, 0x82, 0xe2,
-    0xdb, 0xe1, 0x3d, 0xe2, 0x7d, 0xe3, 0x38, 0xe5,
-    0xb2, 0xe6, 0xc4, 0xe7, 0x9f, 0xe8, 0x36, 0xe9,
-    0x97, 0xe9, 0x95, 0xe9, 0x20, 0xea, 0xa1, 0xeb,
-    0xf3, 0xed, 0xc3, 0xf0, 0x18, 0xf3, 0x1e, 0xf5,
-    0xd7, 0xf6, 0x85, 0xf8, 0x39, 0xfa, 0x2b, 0xfc,
-    0xd2, 0xfe, 0xc5, 0x01, 0xbf, 0x04, 0x22, 0x07,
-    0x1c, 0x09, 0xff, 0x0a, 0xef, 0x0c, 0x08, 0x0f,
-    0x5e, 0x11, 0x1f, 0x14, 0x13, 0x17, 0xb4, 0x19,
-    0xa6, 0x1b, 0xa2, 0x1c, 0x03, 0x1d, 0x38, 0x1d,
-    0x5a, 0x1d, 0xbd, 0x1d, 0x31, 0x1e, 0x9d, 0x1e,
-    0xa4, 0x1e, 0x14, 0x1e, 0x41, 0x1d, 0x77, 0x1c,
-    0xe2, 0x1b, 0x35, 0x1b, 0x7e, 0x1a, 0xd5, 0x19,
-    0x30, 0x19, 0x73, 0x18, 0x19, 0x17, 0x76, 0x15,
-    0xc9, 0x13, 0x8c, 0x12, 0xa4, 0x11, 0xb9, 0x10,
-    0xd3, 0x0f, 0xdf, 0x0e, 0x17, 0x0e, 0x15, 0x0d,
-    0xfa, 0x0b, 0xf2, 0x0a, 0x1f, 0x0a, 0x6f, 0x09,
-    0x78, 0x08, 0x4b, 0x07, 0xff, 0x05, 0xb8, 0x04,
-    0x6d, 0x03, 0x01, 0x02, 0x9e, 0x00, 0x5b, 0xff,
-    0x5b, 0xfe, 0x53, 0xfd, 0x0c, 0xfc, 0xa3, 0xfa,
-    0x1d, 0xf9, 0xa5, 0xf7, 0x36, 0xf6, 0xbf, 0xf4,
-    0x53, 0xf3, 0xe2, 0xf1, 0x7f, 0xf0, 0x37, 0xef,
-    0xfb, 0xed, 0xd6, 0xec, 0xa1, 0xeb, 0x86, 0xea,
-    0x58, 0xe9, 0x34, 0xe8, 0x2e, 0xe7, 0x29, 0xe6,
-    0x3a, 0xe5, 0x64, 0xe4, 0xae, 0xe3, 0xf6, 0xe2,
-    0x56, 0xe2, 0x95, 0xe1, 0xbb, 0xe0, 0xdd, 0xdf,
-    0x26, 0xdf, 0x66, 0xdf, 0xb1, 0xe0, 0x6c, 0xe2,
-    0x1b, 0xe4, 0x83, 0xe5, 0xa3, 0xe6, 0x79, 0xe7,
-    0xeb, 0xe7, 0xfd, 0xe7, 0x88, 0xe8, 0xf9, 0xe9,
-    0x81, 0xec, 0x84, 0xef, 0x21, 0xf2, 0x60, 0xf4,
-    0x60, 0xf6, 0x69, 0xf8, 0x72, 0xfa, 0x92, 0xfc,
-    0x2d, 0xff, 0x4e, 0x02, 0x64, 0x05, 0xfc, 0x07,
-    0x34, 0x0a, 0x55, 0x0c, 0x7f, 0x0e, 0xb1, 0x10,
-    0xfe, 0x12, 0xc8, 0x15, 0xef, 0x18, 0xd3, 0x1b,
-    0x05, 0x1e, 0x40, 0x1f, 0xc3, 0x1f, 0x0f, 0x20,
-    0x36, 0x20, 0x98, 0x20, 0x25, 0x21, 0x76, 0x21,
-    0x76, 0x21, 0xdf, 0x20, 0xfc, 0x1f, 0xff, 0x1e,
-    0x51, 0x1e, 0x95, 0x1d, 0xa1, 0x1c, 0xf1, 0x1b,
-    0x45, 0x1b, 0x8b, 0x1a, 0x23, 0x19, 0x2b, 0x17,
-    0x70, 0x15, 0x14, 0x14, 0x20, 0x13, 0x1c, 0x12,
-    0x2f, 0x11, 0x34, 0x10, 0x20, 0x0f, 0x36, 0x0e,
-    0x2f, 0x0d, 0x37, 0x0c, 0x19, 0x0b, 0x0b, 0x0a,
-    0xd4, 0x08, 0x49, 0x07, 0xc5, 0x05, 0x4c, 0x04,
-    0xdc, 0x02, 0x5c, 0x01, 0xf3, 0xff, 0xc3, 0xfe,
-    0x93, 0xfd, 0x2f, 0xfc, 0x9b, 0xfa, 0xef, 0xf8,
-    0x48, 0xf7, 0xaa, 0xf5, 0x2d, 0xf4, 0xbe, 0xf2,
-    0x28, 0xf1, 0x7f, 0xef, 0xdf, 0xed, 0x55, 0xec,
-    0xdb, 0xea, 0x82, 0xe9, 0x40, 0xe8, 0xe8, 0xe6,
-    0xd8, 0xe5, 0xda, 0xe4, 0xe5, 0xe3, 0xbe, 0xe2,
-    0xa7, 0xe1, 0xf2, 0xe0, 0x3c, 0xe0, 0x9b, 0xdf,
-    0xda, 0xde, 0x19, 0xde, 0x14, 0xdd, 0x25, 0xdc,
-    0x21, 0xdc, 0x23, 0xdd, 0x1f, 0xdf, 0x12, 0xe1,
-    0xb2, 0xe2, 0x0f, 0xe4, 0x0b, 0xe5, 0xd9, 0xe5,
-    0x0b, 0xe6, 0x69, 0xe6, 0x5e, 0xe7, 0xb8, 0xe9,
-    0x11, 0xed, 0x06, 0xf0, 0xd4, 0xf2, 0x2a, 0xf5,
-    0x56, 0xf7, 0x44, 0xf9, 0x41, 0xfb, 0x0f, 0xfe,
-    0x76, 0x01, 0x0f, 0x05, 0x07, 0x08, 0x94, 0x0a,
-    0xfa, 0x0c, 0x4d, 0x0f, 0xc6, 0x11, 0x27, 0x14,
-    0x15, 0x17, 0x7c, 0x1a, 0xd4, 0x1d, 0xb8, 0x20,
-    0x54, 0x22, 0x0a, 0x23, 0x6b, 0x23, 0x7f, 0x23,
-    0xcb, 0x23, 0x3f, 0x24, 0xb9, 0x24, 0xc2, 0x24,
-    0x3c, 0x24, 0x79, 0x23, 0x7f, 0x22, 0xbd, 0x21,
-    0xad, 0x20, 0xa7, 0x1f, 0xa9, 0x1e, 0xca, 0x1d,
-    0xf6, 0x1c, 0x66, 0x1b, 0x8c, 0x19, 0x7a, 0x17,
-    0xb6, 0x15, 0x64, 0x14, 0x33, 0x13, 0x0d, 0x12,
-    0xe8, 0x10, 0xd2, 0x0f, 0x6a, 0x0e, 0x0c, 0x0d,
-    0xcf, 0x0b, 0x83, 0x0a, 0x57, 0x09, 0xf7, 0x07,
-    0x78, 0x06, 0x12, 0x05, 0xb4, 0x03, 0x2e, 0x02,
-    0x6f, 0x00, 0xb0, 0xfe, 0x1c, 0xfd, 0xe2, 0xfb,
-    0xc4, 0xfa, 0x5b, 0xf9, 0xc7, 0xf7, 0xee, 0xf5,
-    0x2f, 0xf4, 0x97, 0xf2, 0xe4, 0xf0, 0x4d, 0xef,
-    0x98, 0xed, 0x03, 0xec, 0x5b, 0xea, 0x9e, 0xe8,
-    0xe6, 0xe6, 0x56, 0xe5, 0x14, 0xe4, 0xcf, 0xe2,
-    0xb2, 0xe1, 0xb8, 0xe0, 0xa5, 0xdf, 0xb9, 0xde,
-    0xcd, 0xdd, 0xee, 0xdc, 0x0e, 0xdc, 0x0d, 0xdb,
-    0x1b, 0xda, 0x41, 0xd9, 0x3d, 0xd9, 0x2c, 0xda,
-    0xf9, 0xdb, 0x0b, 0xde, 0xad, 0xdf, 0x4b, 0xe1,
-    0x95, 0xe2, 0x81, 0xe3, 0x09, 0xe4, 0x7f, 0xe4,
-    0xd3, 0xe5, 0xf5, 0xe7, 0xdf, 0xea, 0x15, 0xee,
-    0x2d, 0xf1, 0xd8, 0xf3, 0x0d, 0xf6, 0x3f, 0xf8,
-    0xa6, 0xfa, 0xab, 0xfd, 0x1b, 0x01, 0xa3, 0x04,
-    0xdc, 0x07, 0xa0, 0x0a, 0x28, 0x0d, 0x87, 0x0f,
-    0xd0, 0x11, 0x6e, 0x14, 0x68, 0x17, 0xc9, 0x1a,
-    0x4d, 0x1e, 0x32, 0x21, 0x4d, 0x23, 0x7f, 0x24,
-    0xe9, 0x24, 0x19, 0x25, 0x5c, 0x25, 0xc7, 0x25,
-    0x26, 0x26, 0x41, 0x26, 0xcc, 0x25, 0xfc, 0x24,
-    0x2b, 0x24, 0x49, 0x23, 0x66, 0x22, 0x5e, 0x21,
-    0x8d, 0x20, 0xbb, 0x1f, 0xb9, 0x1e, 0x57, 0x1d,
-    0x6a, 0x1b, 0x69, 0x19, 0x6c, 0x17, 0xcf, 0x15,
-    0x65, 0x14, 0x33, 0x13, 0x25, 0x12, 0x14, 0x11,
-    0xf8, 0x0f, 0x76, 0x0e, 0x0c, 0x0d, 0xa3, 0x0b,
-    0x63, 0x0a, 0xf9, 0x08, 0x31, 0x07, 0xa2, 0x05,
-    0xee, 0x03, 0x46, 0x02, 0x71, 0x00, 0xa2, 0xfe,
-    0xfb, 0xfc, 0x79, 0xfb, 0x19, 0xfa, 0x87, 0xf8,
-    0x02, 0xf7, 0x45, 0xf5, 0x81, 0xf3, 0xd7, 0xf1,
-    0x0e, 0xf0, 0x28, 0xee, 0x40, 0xec, 0x67, 0xea,
-    0xa7, 0xe8, 0xd8, 0xe6, 0x17, 0xe5, 0xb4, 0xe3,
-    0x66, 0xe2, 0x1b, 0xe1, 0xdd, 0xdf, 0xb2, 0xde,
-    0xaf, 0xdd, 0xac, 0xdc, 0xbd, 0xdb, 0xdd, 0xda,
-    0x14, 0xda, 0x0d, 0xd9, 0x03, 0xd8, 0x97, 0xd7,
-    0xe6, 0xd7, 0x54, 0xd9, 0x38, 0xdb, 0xff, 0xdc,
-    0x9f, 0xde, 0x25, 0xe0, 0xbf, 0xe1, 0xb4, 0xe2,
-    0x09, 0xe3, 0xc0, 0xe3, 0x76, 0xe5, 0x4c, 0xe8,
-    0x6b, 0xeb, 0x4f, 0xee, 0xf1, 0xf0, 0xa2, 0xf3,
-    0x42, 0xf6, 0xc3, 0xf8, 0xb3, 0xfb, 0xd9, 0xfe,
-    0x5b, 0x02, 0xf5, 0x05, 0x0f, 0x09, 0xf1, 0x0b,
-    0x7b, 0x0e, 0xd6, 0x10, 0x5a, 0x13, 0x40, 0x16,
-    0xb6, 0x19, 0x4a, 0x1d, 0x92, 0x20, 0x29, 0x23,
-    0x0b, 0x25, 0x32, 0x26, 0xd0, 0x26, 0x22, 0x27,
-    0x58, 0x27, 0xd4, 0x27, 0x25, 0x28, 0xd9, 0x27,
-    0x10, 0x27, 0x1d, 0x26, 0x54, 0x25, 0xaa, 0x24,
-    0xba, 0x23, 0xbf, 0x22, 0x07, 0x22, 0x65, 0x21,
-    0x67, 0x20, 0xc4, 0x1e, 0x9e, 0x1c, 0x4a, 0x1a,
-    0x50, 0x18, 0x9a, 0x16, 0x00, 0x15, 0x93, 0x13,
-    0x46, 0x12, 0x11, 0x11, 0xa8, 0x0f, 0x29, 0x0e,
-    0x9c, 0x0c, 0x25, 0x0b, 0x9d, 0x09, 0xd8, 0x07,
-    0x28, 0x06, 0x53, 0x04, 0x8d, 0x02, 0xae, 0x00,
-    0xb0, 0xfe, 0xc7, 0xfc, 0x1a, 0xfb, 0xab, 0xf9,
-    0x22, 0xf8, 0x83, 0xf6, 0xd0, 0xf4, 0x2e, 0xf3,
-    0x87, 0xf1, 0xa7, 0xef, 0xc7, 0xed, 0xd6, 0xeb,
-    0xdc, 0xe9, 0xd0, 0xe7, 0xdc, 0xe5, 0x33, 0xe4,
-    0x89, 0xe2, 0x15, 0xe1, 0xa5, 0xdf, 0x55, 0xde,
-    0x33, 0xdd, 0x46, 0xdc, 0x51, 0xdb, 0x43, 0xda,
-    0x7f, 0xd9, 0x49, 0xd8, 0x26, 0xd7, 0x36, 0xd6,
-    0xf4, 0xd5, 0xfe, 0xd6, 0x85, 0xd8, 0x1f, 0xda,
-    0x90, 0xdb, 0x83, 0xdd, 0x4d, 0xdf, 0xbd, 0xe0,
-    0x70, 0xe1, 0x75, 0xe1, 0xbc, 0xe2, 0x08, 0xe5,
-    0x20, 0xe8, 0x28, 0xeb, 0x1d, 0xee, 0x4d, 0xf1,
-    0x51, 0xf4, 0x29, 0xf7, 0xb1, 0xf9, 0xaf, 0xfc,
-    0xfd, 0xff, 0x8d, 0x03, 0x17, 0x07, 0x67, 0x0a,
-    0x94, 0x0d, 0x4e, 0x10, 0xf1, 0x12, 0xa5, 0x15,
-    0xac, 0x18, 0x41, 0x1c, 0xe2, 0x1f, 0xf3, 0x22,
-    0x69, 0x25, 0x3a, 0x27, 0x44, 0x28, 0xd2, 0x28,
-    0xe7, 0x28, 0x2e, 0x29, 0x91, 0x29, 0x73, 0x29,
-    0x06, 0x29, 0x57, 0x28, 0xd9, 0x27, 0x46, 0x27,
-    0x5b, 0x26, 0x0d, 0x25, 0x00, 0x24, 0x82, 0x23,
-    0xc0, 0x22, 0x9b, 0x21, 0x81, 0x1f, 0x3e, 0x1d,
-    0x37, 0x1b, 0x39, 0x19, 0x8c, 0x17, 0xc8, 0x15,
-    0x3c, 0x14, 0xde, 0x12, 0xaa, 0x11, 0x1f, 0x10,
-    0x56, 0x0e, 0x8e, 0x0c, 0xde, 0x0a, 0x2a, 0x09,
-    0x28, 0x07, 0x7f, 0x05, 0xf7, 0x03, 0x7e, 0x02,
-    0x78, 0x00, 0x46, 0xfe, 0x2b, 0xfc, 0x66, 0xfa,
-    0xf1, 0xf8, 0x51, 0xf7, 0xfb, 0xf5, 0x36, 0xf4,
-    0xbf, 0xf2, 0x11, 0xf1, 0xd2, 0xee, 0x95, 0xec,
-    0x30, 0xea, 0x1d, 0xe8, 0xfa, 0xe5, 0x2a, 0xe4,
-    0x7e, 0xe2, 0xde, 0xe0, 0x6d, 0xdf, 0xd5, 0xdd,
-    0x87, 0xdc, 0x49, 0xdb, 0x32, 0xda, 0x6e, 0xd9,
-    0x67, 0xd8, 0x55, 0xd7, 0xe9, 0xd5, 0xdb, 0xd4,
-    0xe3, 0xd4, 0x7a, 0xd5, 0x31, 0xd7, 0xc8, 0xd8,
-    0x47, 0xda, 0x03, 0xdc, 0xe7, 0xdd, 0x3f, 0xdf,
-    0x5f, 0xdf, 0x03, 0xe0, 0x25, 0xe1, 0xd0, 0xe3,
-    0xe7, 0xe6, 0xee, 0xe9, 0x50, 0xed, 0x59, 0xf0,
-    0x80, 0xf3, 0x12, 0xf6, 0xec, 0xf8, 0xdf, 0xfb,
-    0x6c, 0xff, 0x64, 0x03, 0x19, 0x07, 0x85, 0x0a,
-    0x92, 0x0d, 0xc7, 0x10, 0x48, 0x13, 0x09, 0x16,
-    0x2f, 0x19, 0xae, 0x1c, 0x3b, 0x20, 0x55, 0x23,
-    0xe7, 0x25, 0xae, 0x27, 0xfa, 0x28, 0x44, 0x29,
-    0x7d, 0x29, 0x9a, 0x29, 0xa2, 0x29, 0xbf, 0x29,
-    0x4f, 0x29, 0xd0, 0x28, 0x39, 0x28, 0xc1, 0x27,
-    0x05, 0x27, 0xe9, 0x25, 0xdd, 0x24, 0xf6, 0x23,
-    0x1d, 0x23, 0xcf, 0x21, 0x23, 0x20, 0x33, 0x1e,
-    0xf8, 0x1b, 0x16, 0x1a, 0x21, 0x18, 0x45, 0x16,
-    0xb1, 0x14, 0x27, 0x13, 0xdb, 0x11, 0x2e, 0x10,
-    0x7a, 0x0e, 0xcc, 0x0c, 0x41, 0x0b, 0x67, 0x09,
-    0x20, 0x07, 0x33, 0x05, 0x66, 0x03, 0xe1, 0x01,
-    0xee, 0xff, 0xc4, 0xfd, 0xc1, 0xfb, 0x02, 0xfa,
-    0x78, 0xf8, 0xbd, 0xf6, 0x09, 0xf5, 0x27, 0xf3,
-    0x59, 0xf1, 0x73, 0xef, 0x74, 0xed, 0x3c, 0xeb,
-    0xe6, 0xe8, 0x7d, 0xe6, 0x2d, 0xe4, 0x5f, 0xe2,
-    0x91, 0xe0, 0xf1, 0xde, 0x54, 0xdd, 0xe9, 0xdb,
-    0x96, 0xda, 0x85, 0xd9, 0x85, 0xd8, 0x43, 0xd7,
-    0x20, 0xd6, 0x9f, 0xd4, 0x75, 0xd3, 0x26, 0xd3,
-    0x0d, 0xd4, 0xaf, 0xd5, 0x53, 0xd7, 0xe8, 0xd8,
-    0x5a, 0xda, 0x48, 0xdc, 0xa1, 0xdd, 0x20, 0xde,
-    0x82, 0xde, 0xe0, 0xdf, 0x86, 0xe2, 0xa4, 0xe5,
-    0xd9, 0xe8, 0xc0, 0xeb, 0x05, 0xef, 0x32, 0xf2,
-    0xfc, 0xf4, 0xd7, 0xf7, 0x2c, 0xfb, 0x0e, 0xff,
-    0xf2, 0x02, 0xb6, 0x06, 0x24, 0x0a, 0x80, 0x0d,
-    0x7c, 0x10, 0x09, 0x13, 0x9d, 0x15, 0xb4, 0x18,
-    0x66, 0x1c, 0x2b, 0x20, 0x5d, 0x23, 0xbe, 0x25,
-    0x94, 0x27, 0xb3, 0x28, 0x5f, 0x29, 0xa0, 0x29,
-    0xfb, 0x29, 0x4f, 0x2a, 0x42, 0x2a, 0xbd, 0x29,
-    0xee, 0x28, 0x88, 0x28, 0xf4, 0x27, 0x50, 0x27,
-    0x3f, 0x26, 0x32, 0x25, 0x85, 0x24, 0xcd, 0x23,
-    0xad, 0x22, 0x9b, 0x20, 0x79, 0x1e, 0x46, 0x1c,
-    0x6a, 0x1a, 0x82, 0x18, 0x8a, 0x16, 0xc3, 0x14,
-    0x01, 0x13, 0x51, 0x11, 0x63, 0x0f, 0xa4, 0x0d,
-    0xdb, 0x0b, 0x52, 0x0a, 0x86, 0x08, 0x82, 0x06,
-    0x72, 0x04, 0x7a, 0x02, 0xad, 0x00, 0x5f, 0xfe,
-    0x38, 0xfc, 0x20, 0xfa, 0x83, 0xf8, 0xdc, 0xf6,
-    0x0d, 0xf5, 0x4b, 0xf3, 0x6d, 0xf1, 0xd7, 0xef,
-    0xc9, 0xed, 0xa7, 0xeb, 0x38, 0xe9, 0xb4, 0xe6,
-    0x83, 0xe4, 0x59, 0xe2, 0x4d, 0xe0, 0x56, 0xde,
-    0xa2, 0xdc, 0xfe, 0xda, 0x8b, 0xd9, 0x6c, 0xd8,
-    0x5b, 0xd7, 0x3c, 0xd6, 0xde, 0xd4, 0x49, 0xd3,
-    0x4f, 0xd2, 0x3d, 0xd2, 0x5e, 0xd3, 0xfe, 0xd4,
-    0x84, 0xd6, 0x1f, 0xd8, 0xba, 0xd9, 0x9d, 0xdb,
-    0xb3, 0xdc, 0x14, 0xdd, 0xa3, 0xdd, 0x5c, 0xdf,
-    0x1b, 0xe2, 0x60, 0xe5, 0xe7, 0xe8, 0xca, 0xeb,
-    0xcf, 0xee, 0xa1, 0xf1, 0x85, 0xf4, 0xd3, 0xf7,
-    0x76, 0xfb, 0x44, 0xff, 0x11, 0x03, 0xf2, 0x06,
-    0x37, 0x0a, 0xac, 0x0d, 0xbb, 0x10, 0x6d, 0x13,
-    0x22, 0x16, 0x39, 0x19, 0x27, 0x1d, 0xdf, 0x20,
-    0x1c, 0x24, 0x28, 0x26, 0x9c, 0x27, 0x9d, 0x28,
-    0x1c, 0x29, 0x83, 0x29, 0xc9, 0x29, 0x3d, 0x2a,
-    0x39, 0x2a, 0xf6, 0x29, 0x7d, 0x29, 0xde, 0x28,
-    0x63, 0x28, 0xc9, 0x27, 0x08, 0x27, 0x15, 0x26,
-    0x36, 0x25, 0x54, 0x24, 0xe8, 0x22, 0xd9, 0x20,
-    0x91, 0x1e, 0x88, 0x1c, 0xe7, 0x1a, 0x35, 0x19,
-    0x73, 0x17, 0xba, 0x15, 0xf6, 0x13, 0xfb, 0x11,
-    0xc0, 0x0f, 0xdb, 0x0d, 0x03, 0x0c, 0x41, 0x0a,
-    0x75, 0x08, 0x8e, 0x06, 0xb7, 0x04, 0xc7, 0x02,
-    0xb2, 0x00, 0x49, 0xfe, 0x23, 0xfc, 0x25, 0xfa,
-    0x48, 0xf8, 0x91, 0xf6, 0xa0, 0xf4, 0xa4, 0xf2,
-    0x91, 0xf0, 0x70, 0xee, 0x41, 0xec, 0x0a, 0xea,
-    0x9f, 0xe7, 0x4e, 0xe5, 0x1d, 0xe3, 0xe4, 0xe0,
-    0xaf, 0xde, 0x97, 0xdc, 0xca, 0xda, 0x26, 0xd9,
-    0xab, 0xd7, 0x4d, 0xd6, 0x17, 0xd5, 0x69, 0xd3,
-    0xb1, 0xd1, 0xb5, 0xd0, 0x04, 0xd1, 0x6c, 0xd2,
-    0x00, 0xd4, 0xc2, 0xd5, 0x43, 0xd7, 0xfd, 0xd8,
-    0x6f, 0xda, 0x3d, 0xdb, 0x63, 0xdb, 0xd4, 0xdb,
-    0xcd, 0xdd, 0x0a, 0xe1, 0xf4, 0xe4, 0xf9, 0xe7,
-    0x3e, 0xeb, 0xb4, 0xee, 0xc2, 0xf1, 0x84, 0xf4,
-    0x67, 0xf7, 0x63, 0xfb, 0xa9, 0xff, 0xde, 0x03,
-    0x6e, 0x07, 0x5c, 0x0b, 0x02, 0x0f, 0xe6, 0x11,
-    0x8f, 0x14, 0x39, 0x17, 0xe8, 0x1a, 0xb0, 0x1e,
-    0x38, 0x22, 0xea, 0x24, 0xf0, 0x26, 0x74, 0x28,
-    0x8b, 0x29, 0x35, 0x2a, 0x7a, 0x2a, 0x04, 0x2b,
-    0x54, 0x2b, 0x54, 0x2b, 0xb4, 0x2a, 0xfd, 0x29,
-    0x9a, 0x29, 0x4b, 0x29, 0x80, 0x28, 0x78, 0x27,
-    0x92, 0x26, 0xbd, 0x25, 0xc5, 0x24, 0xef, 0x22,
-    0xe6, 0x20, 0xe3, 0x1e, 0x22, 0x1d, 0x52, 0x1b,
-    0x4d, 0x19, 0x1b, 0x17, 0xcd, 0x14, 0xb8, 0x12,
-    0x6e, 0x10, 0x5a, 0x0e, 0x4a, 0x0c, 0x94, 0x0a,
-    0x20, 0x09, 0x6b, 0x07, 0x94, 0x05, 0xa7, 0x03,
-    0xda, 0x01, 0xc6, 0xff, 0x62, 0xfd, 0xfe, 0xfa,
-    0xfc, 0xf8, 0x13, 0xf7, 0xdc, 0xf4, 0x9c, 0xf2,
-    0x76, 0xf0, 0x7d, 0xee, 0xa9, 0xec, 0x80, 0xea,
-    0x22, 0xe8, 0xbf, 0xe5, 0x61, 0xe3, 0x36, 0xe1,
-    0xed, 0xde, 0xb9, 0xdc, 0xb4, 0xda, 0x25, 0xd9,
-    0xa0, 0xd7, 0x28, 0xd6, 0xa7, 0xd4, 0xb5, 0xd2,
-    0xe8, 0xd0, 0xce, 0xcf, 0x65, 0xd0, 0x00, 0xd2,
-    0xfc, 0xd3, 0xae, 0xd5, 0x2f, 0xd7, 0xc7, 0xd8,
-    0xd5, 0xd9, 0x5d, 0xda, 0x56, 0xda, 0x19, 0xdb,
-    0x2a, 0xdd, 0x9d, 0xe0, 0x31, 0xe4, 0x8b, 0xe7,
-    0x28, 0xeb, 0x4f, 0xee, 0x5e, 0xf1, 0x39, 0xf4,
-    0xf1, 0xf7, 0x52, 0xfc, 0xbb, 0x00, 0xb3, 0x04,
-    0x69, 0x08, 0x59, 0x0c, 0xab, 0x0f, 0xf5, 0x12,
-    0xc5, 0x15, 0xc3, 0x18, 0x44, 0x1c, 0x15, 0x20,
-    0xc5, 0x23, 0x33, 0x26, 0xe1, 0x27, 0x0f, 0x29,
-    0x19, 0x2a, 0xac, 0x2a, 0x21, 0x2b, 0xa3, 0x2b,
-    0xff, 0x2b, 0xea, 0x2b, 0x1f, 0x2b, 0x75, 0x2a,
-    0xc7, 0x29, 0x42, 0x29, 0xac, 0x28, 0xee, 0x27,
-    0x05, 0x27, 0x15, 0x26, 0xf7, 0x24, 0x36, 0x23,
-    0x2f, 0x21, 0xf5, 0x1e, 0x3c, 0x1d, 0x74, 0x1b,
-    0x6d, 0x19, 0x74, 0x17, 0x47, 0x15, 0x15, 0x13,
-    0x96, 0x10, 0x4e, 0x0e, 0x55, 0x0c, 0x9f, 0x0a,
-    0xcd, 0x08, 0xba, 0x06, 0xa6, 0x04, 0x7e, 0x02,
-    0x78, 0x00, 0x43, 0xfe, 0x03, 0xfc, 0xc0, 0xf9,
-    0x9d, 0xf7, 0xac, 0xf5, 0x77, 0xf3, 0x29, 0xf1,
-    0xdf, 0xee, 0xac, 0xec, 0x8b, 0xea, 0x5a, 0xe8,
-    0x15, 0xe6, 0xdd, 0xe3, 0xa8, 0xe1, 0x41, 0xdf,
-    0x07, 0xdd, 0xde, 0xda, 0xf0, 0xd8, 0x3f, 0xd7,
-    0x86, 0xd5, 0x05, 0xd4, 0x3d, 0xd2, 0x56, 0xd0,
-    0x1b, 0xcf, 0x2c, 0xcf, 0x93, 0xd0, 0x94, 0xd2,
-    0x56, 0xd4, 0xb0, 0xd5, 0x4e, 0xd7, 0x9a, 0xd8,
-    0x46, 0xd9, 0x65, 0xd9, 0xc4, 0xd9, 0xa1, 0xdb,
-    0xc4, 0xde, 0x7c, 0xe2, 0x09, 0xe6, 0x75, 0xe9,
-    0xb8, 0xec, 0xe6, 0xef, 0xf2, 0xf2, 0x63, 0xf6,
-    0xa7, 0xfa, 0x5a, 0xff, 0x1c, 0x04, 0x00, 0x08,
-    0x8f, 0x0b, 0x39, 0x0f, 0xbf, 0x12, 0xde, 0x15,
-    0xab, 0x18, 0xea, 0x1b, 0xa8, 0x1f, 0x55, 0x23,
-    0xf4, 0x25, 0xba, 0x27, 0x10, 0x29, 0x17, 0x2a,
-    0xd7, 0x2a, 0x40, 0x2b, 0xc7, 0x2b, 0x5e, 0x2c,
-    0x87, 0x2c, 0xfe, 0x2b, 0x0d, 0x2b, 0x55, 0x2a,
-    0x29, 0x2a, 0xde, 0x29, 0x2d, 0x29, 0x4c, 0x28,
-    0x49, 0x27, 0x2c, 0x26, 0x9c, 0x24, 0xad, 0x22,
-    0x9e, 0x20, 0xd5, 0x1e, 0x0e, 0x1d, 0xed, 0x1a,
-    0x6f, 0x18, 0xcc, 0x15, 0x71, 0x13, 0xfc, 0x10,
-    0x6e, 0x0e, 0x06, 0x0c, 0x2d, 0x0a, 0x9b, 0x08,
-    0xb9, 0x06, 0x92, 0x04, 0x66, 0x02, 0x76, 0x00,
-    0x6d, 0xfe, 0x5a, 0xfc, 0xfa, 0xf9, 0x89, 0xf7,
-    0x2f, 0xf5, 0xab, 0xf2, 0x4e, 0xf0, 0xd8, 0xed,
-    0x8d, 0xeb, 0x3c, 0xe9, 0xf0, 0xe6, 0x93, 0xe4,
-    0x49, 0xe2, 0x1d, 0xe0, 0x87, 0xdd, 0x2c, 0xdb,
-    0xf2, 0xd8, 0x09, 0xd7, 0x92, 0xd5, 0xf7, 0xd3,
-    0x3e, 0xd2, 0x51, 0xd0, 0x9a, 0xce, 0x05, 0xce,
-    0xfb, 0xce, 0xdf, 0xd0, 0xbe, 0xd2, 0x37, 0xd4,
-    0x5e, 0xd5, 0xae, 0xd6, 0xdc, 0xd7, 0x3e, 0xd8,
-    0xb3, 0xd8, 0xf9, 0xd9, 0xa6, 0xdc, 0x2b, 0xe0,
-    0x8b, 0xe3, 0xf4, 0xe6, 0x5d, 0xea, 0xbf, 0xed,
-    0xe9, 0xf0, 0x5d, 0xf4, 0x4d, 0xf8, 0x0a, 0xfd,
-    0xda, 0x01, 0x2e, 0x06, 0x1e, 0x0a, 0x94, 0x0d,
-    0x4a, 0x11, 0xab, 0x14, 0xf7, 0x17, 0x3e, 0x1b,
-    0xe7, 0x1e, 0x84, 0x22, 0x5d, 0x25, 0x76, 0x27,
-    0xb1, 0x28, 0x0d, 0x2a, 0xe4, 0x2a, 0xa5, 0x2b,
-    0x2c, 0x2c, 0x7d, 0x2c, 0xcb, 0x2c, 0x6a, 0x2c,
-    0xac, 0x2b, 0xbf, 0x2a, 0x64, 0x2a, 0x3d, 0x2a,
-    0xef, 0x29, 0x3a, 0x29, 0x26, 0x28, 0x0c, 0x27,
-    0x78, 0x25, 0xa9, 0x23, 0xba, 0x21, 0xe5, 0x1f,
-    0x10, 0x1e, 0xdf, 0x1b, 0x67, 0x19, 0xbb, 0x16,
-    0x55, 0x14, 0xc8, 0x11, 0x2e, 0x0f, 0xe2, 0x0c,
-    0xe7, 0x0a, 0x5b, 0x09, 0x64, 0x07, 0x2d, 0x05,
-    0xd8, 0x02, 0xd0, 0x00, 0xcf, 0xfe, 0x70, 0xfc,
-    0x2c, 0xfa, 0xbb, 0xf7, 0xa1, 0xf5, 0x55, 0xf3,
-    0xb9, 0xf0, 0xef, 0xed, 0x2c, 0xeb, 0xbd, 0xe8,
-    0x55, 0xe6, 0xa0, 0xe3, 0xeb, 0xe0, 0x4a, 0xde,
-    0xca, 0xdb, 0x7d, 0xd9, 0x20, 0xd7, 0x5f, 0xd5,
-    0x9a, 0xd3, 0x06, 0xd2, 0x20, 0xd0, 0xe4, 0xcd,
-    0x65, 0xcc, 0x2c, 0xcc, 0xab, 0xcd, 0x80, 0xcf,
-    0x56, 0xd1, 0xb0, 0xd2, 0x16, 0xd4, 0xb3, 0xd5,
-    0x98, 0xd6, 0x4a, 0xd7, 0xea, 0xd7, 0xb3, 0xd9,
-    0xb9, 0xdc, 0x52, 0xe0, 0xec, 0xe3, 0x4b, 0xe7,
-    0x74, 0xea, 0x9c, 0xed, 0x1b, 0xf1, 0xd6, 0xf4,
-    0x93, 0xf9, 0xdd, 0xfe, 0xc9, 0x03, 0x3a, 0x08,
-    0xf7, 0x0b, 0x72, 0x0f, 0x3d, 0x13, 0x8f, 0x16,
-    0xe9, 0x19, 0x65, 0x1d, 0x14, 0x21, 0x1d, 0x25,
-    0xb1, 0x27, 0x80, 0x29, 0x21, 0x2b, 0x20, 0x2c,
-    0x07, 0x2d, 0x80, 0x2d, 0x87, 0x2d, 0xdb, 0x2d,
-    0x01, 0x2e, 0x39, 0x2d, 0x59, 0x2c, 0x94, 0x2b,
-    0x01, 0x2b, 0xf0, 0x2a, 0x49, 0x2a, 0x1e, 0x29,
-    0x48, 0x28, 0x24, 0x27, 0x9b, 0x25, 0x91, 0x23,
-    0x51, 0x21, 0x8b, 0x1f, 0xac, 0x1d, 0x8c, 0x1b,
-    0xdb, 0x18, 0x1c, 0x16, 0x75, 0x13, 0x01, 0x11,
-    0xa7, 0x0e, 0x2f, 0x0c, 0x54, 0x0a, 0x7e, 0x08,
-    0x9b, 0x06, 0x06, 0x04, 0xa8, 0x01, 0x5f, 0xff,
-    0xa0, 0xfd, 0x6b, 0xfb, 0xcb, 0xf8, 0xd5, 0xf6,
-    0x12, 0xf4, 0xbc, 0xf1, 0xe6, 0xee, 0x1b, 0xec,
-    0x48, 0xe9, 0x1c, 0xe6, 0x2a, 0xe3, 0x86, 0xe0,
-    0x1e, 0xde, 0x6e, 0xdb, 0xfe, 0xd8, 0x98, 0xd6,
-    0x2d, 0xd4, 0x82, 0xd2, 0x71, 0xd0, 0xc7, 0xcd,
-    0x9c, 0xcb, 0x56, 0xca, 0xdd, 0xca, 0xcd, 0xcc,
-    0x97, 0xce, 0xdd, 0xcf, 0x68, 0xd1, 0xee, 0xd2,
-    0x46, 0xd4, 0x3a, 0xd5, 0x19, 0xd6, 0x44, 0xd7,
-    0x59, 0xd9, 0x87, 0xdc, 0xd8, 0xdf, 0x4d, 0xe3,
-    0xd8, 0xe6, 0x10, 0xea, 0xa6, 0xed, 0x18, 0xf1,
-    0x63, 0xf5, 0x4d, 0xfa, 0x44, 0xff, 0x51, 0x04,
-    0xc0, 0x07, 0xd3, 0x0b, 0xea, 0x0f, 0x66, 0x14,
-    0xb8, 0x18, 0xc3, 0x1b, 0xa5, 0x1f, 0x28, 0x23,
-    0xd3, 0x26, 0x5e, 0x29, 0x02, 0x2b, 0x6b, 0x2c,
-    0x82, 0x2d, 0x5d, 0x2e, 0x7b, 0x2e, 0x8d, 0x2e,
-    0x06, 0x2f, 0x7b, 0x2e, 0x38, 0x2d, 0x3b, 0x2c,
-    0xdf, 0x2a, 0x1f, 0x2b, 0xe9, 0x2a, 0x48, 0x2a,
-    0x0c, 0x29, 0x15, 0x28, 0xfb, 0x26, 0x80, 0x25,
-    0xc4, 0x23, 0x4a, 0x21, 0x67, 0x1f, 0x39, 0x1d,
-    0x9d, 0x1a, 0xc6, 0x17, 0x41, 0x15, 0x2e, 0x12,
-    0xcd, 0x0f, 0x0e, 0x0d, 0xef, 0x0a, 0x73, 0x09,
-    0x95, 0x07, 0x06, 0x05, 0xae, 0x02, 0x44, 0x00,
-    0xf2, 0xfd, 0xaa, 0xfc, 0x45, 0xfa, 0xd0, 0xf7,
-    0x23, 0xf5, 0xa0, 0xf2, 0x41, 0xf0, 0xa2, 0xed,
-    0xc8, 0xea, 0x7e, 0xe7, 0xe9, 0xe4, 0xff, 0xe1,
-    0x1a, 0xdf, 0x63, 0xdc, 0xa2, 0xd9, 0x58, 0xd7,
-    0x8c, 0xd4, 0xfb, 0xd2, 0x92, 0xd0, 0x4c, 0xce,
-    0xaf, 0xcb, 0xbb, 0xc9, 0x4f, 0xca, 0x93, 0xcb,
-    0xa5, 0xcd, 0x2c, 0xcf, 0x87, 0xd0, 0x4a, 0xd2,
-    0xdd, 0xd3, 0x03, 0xd5, 0xc7, 0xd5, 0xa2, 0xd6,
-    0xf5, 0xd8, 0x29, 0xdc, 0x01, 0xe0, 0xbf, 0xe2,
-    0xdc, 0xe5, 0x83, 0xe9, 0xa6, 0xec, 0x65, 0xf0,
-    0x36, 0xf4, 0x56, 0xf9, 0x07, 0xff, 0x15, 0x04,
-    0x03, 0x08, 0xb8, 0x0b, 0x0a, 0x10, 0x4f, 0x14,
-    0xb4, 0x18, 0x9a, 0x1c, 0x5e, 0x20, 0x34, 0x24,
-    0xc1, 0x27, 0x38, 0x2a, 0x0a, 0x2c, 0xb7, 0x2d,
-    0x97, 0x2f, 0x37, 0x30, 0x99, 0x30, 0x8b, 0x30,
-    0x0e, 0x30, 0x49, 0x2f, 0x8f, 0x2d, 0xcc, 0x2b,
-    0x78, 0x2b, 0x0c, 0x2c, 0xb2, 0x2b, 0x6b, 0x2b,
-    0x4e, 0x29, 0x63, 0x28, 0x85, 0x26, 0xce, 0x24,
-    0x73, 0x22, 0xb8, 0x20, 0x7f, 0x1f, 0x33, 0x1d,
-    0x14, 0x1b, 0x73, 0x17, 0x69, 0x14, 0x89, 0x11,
-    0x6e, 0x0e, 0x3a, 0x0c, 0xb3, 0x0a, 0x20, 0x09,
-    0xd7, 0x07, 0xa1, 0x04, 0x9f, 0x01, 0x27, 0xfe,
-    0xad, 0xfc, 0x8a, 0xfa, 0xd2, 0xf8, 0x16, 0xf7,
-    0x52, 0xf4, 0x2a, 0xf2, 0xcc, 0xee, 0x0b, 0xec,
-    0xcc, 0xe9, 0x30, 0xe7, 0xac, 0xe3, 0x43, 0xe1,
-    0x7b, 0xde, 0x1e, 0xdc, 0xad, 0xd9, 0x72, 0xd6,
-    0x1f, 0xd3, 0x34, 0xd0, 0x13, 0xcd, 0xd2, 0xca,
-    0x58, 0xca, 0xf0, 0xca, 0xf0, 0xcc, 0xff, 0xce,
-    0x45, 0xd0, 0x6e, 0xd1, 0xea, 0xd2, 0x6d, 0xd4,
-    0x69, 0xd5, 0x36, 0xd5, 0xb2, 0xd5, 0xae, 0xd7,
-    0x83, 0xda, 0x5d, 0xde, 0x2f, 0xe1, 0x28, 0xe4,
-    0x7b, 0xe7, 0x36, 0xeb, 0xef, 0xee, 0x7c, 0xf3,
-    0x8c, 0xf8, 0xf0, 0xfc, 0x57, 0x01, 0x6e, 0x04,
-    0x99, 0x07, 0x53, 0x0c, 0x19, 0x11, 0x22, 0x16,
-    0xd9, 0x1a, 0x24, 0x1e, 0xc9, 0x22, 0x36, 0x26,
-    0xf2, 0x29, 0x3b, 0x2c, 0x4f, 0x2d, 0xea, 0x2d,
-    0x31, 0x2e, 0xf4, 0x2e, 0x12, 0x2f, 0x64, 0x2f,
-    0x0c, 0x2e, 0x2f, 0x2d, 0xea, 0x2d, 0xd2, 0x2e,
-    0x22, 0x2f, 0xf1, 0x2d, 0xf4, 0x2b, 0xfa, 0x29,
-    0xf6, 0x28, 0x8d, 0x27, 0xbb, 0x24, 0xfb, 0x22,
-    0x40, 0x20, 0x40, 0x1e, 0xa4, 0x1c, 0xf1, 0x1a,
-    0x6c, 0x18, 0x03, 0x16, 0x5b, 0x12, 0x82, 0x0e,
-    0xd5, 0x0b, 0x08, 0x09, 0x1f, 0x07, 0x63, 0x04,
-    0x9a, 0x01, 0x9a, 0xff, 0xec, 0xfe, 0x83, 0xfd,
-    0xa8, 0xfb, 0x45, 0xf8, 0xdd, 0xf4, 0xd1, 0xf1,
-    0xa6, 0xef, 0x6a, 0xec, 0x15, 0xe9, 0x22, 0xe6,
-    0x38, 0xe2, 0xfd, 0xdf, 0x52, 0xdd, 0xc1, 0xd9,
-    0x9d, 0xd6, 0x95, 0xd3, 0x58, 0xd1, 0x4b, 0xcf,
-    0x8e, 0xcc, 0x6e, 0xc9, 0x38, 0xc4, 0x43, 0xc1,
-    0x02, 0xc1, 0x90, 0xc6, 0x85, 0xcf, 0x62, 0xd6,
-    0xf8, 0xd9, 0xfa, 0xd8, 0x38, 0xd8, 0x58, 0xd7,
-    0xa6, 0xd7, 0x94, 0xd9, 0xe0, 0xdd, 0x10, 0xe5,
-    0x4d, 0xed, 0xe4, 0xf4, 0x70, 0xf9, 0x02, 0xfb,
-    0xd0, 0xfa, 0xab, 0xfb, 0x7a, 0xfd, 0x32, 0x02,
-    0xfc, 0x07, 0x0d, 0x0c, 0x2a, 0x0f, 0xf8, 0x11,
-    0xca, 0x15, 0x50, 0x1b, 0x99, 0x20, 0x86, 0x23,
-    0xb2, 0x23, 0x4b, 0x23, 0xfd, 0x22, 0x04, 0x23,
-    0x45, 0x26, 0xfc, 0x28, 0x35, 0x2b, 0xf6, 0x2c,
-    0x04, 0x2d, 0xcf, 0x2b, 0xc0, 0x28, 0xfb, 0x24,
-    0xc9, 0x21, 0x02, 0x21, 0x8e, 0x22, 0xf3, 0x22,
-    0x9e, 0x23, 0xaf, 0x21, 0x58, 0x1f, 0xcf, 0x1e,
-    0xa3, 0x1d, 0x90, 0x1e, 0xdf, 0x1c, 0x26, 0x1a,
-    0x30, 0x17, 0x68, 0x14, 0x3b, 0x12, 0xcd, 0x10,
-    0x08, 0x10, 0xf6, 0x0e, 0x21, 0x0e, 0x3c, 0x0b,
-    0x9d, 0x07, 0x95, 0x02, 0x73, 0xfe, 0x6d, 0xfb,
-    0x0a, 0xfa, 0x01, 0xfa, 0x53, 0xf9, 0x38, 0xf8,
-    0x02, 0xf4, 0x43, 0xf0, 0x13, 0xec, 0x84, 0xe9,
-    0xd3, 0xe8, 0x1f, 0xe6, 0xb9, 0xe2, 0x98, 0xde,
-    0x6a, 0xda, 0x52, 0xd6, 0x18, 0xd5, 0x4f, 0xd2,
-    0xee, 0xd1, 0x74, 0xd1, 0xf8, 0xcd, 0xf0, 0xca,
-    0xf9, 0xc3, 0x32, 0xbe, 0x54, 0xbd, 0x80, 0xc7,
-    0x48, 0xd5, 0x4d, 0xe2, 0xb3, 0xe4, 0xf6, 0xdc,
-    0x4f, 0xd6, 0x9e, 0xd1, 0x3c, 0xd7, 0xa0, 0xe0,
-    0x48, 0xee, 0x32, 0xfc, 0x8a, 0x03, 0x70, 0x06,
-    0x30, 0x03, 0x9e, 0xfe, 0x32, 0xfd, 0x69, 0xfe,
-    0x44, 0x04, 0x3a, 0x0d, 0x0c, 0x17, 0x3f, 0x1d,
-    0x50, 0x1c, 0xce, 0x19, 0x59, 0x19, 0xc7, 0x1c,
-    0xee, 0x1f, 0xf7, 0x1f, 0x85, 0x1e, 0xc8, 0x1e,
-    0xc4, 0x23, 0x04, 0x28, 0x2f, 0x2b, 0x2f, 0x2c,
-    0x97, 0x2a, 0xad, 0x25, 0x64, 0x20, 0xcb, 0x1c,
-    0xd8, 0x1a, 0x67, 0x1d, 0x50, 0x1f, 0xb6, 0x21,
-    0x6c, 0x23, 0x62, 0x22, 0xfa, 0x1d, 0xab, 0x16,
-    0x8d, 0x10, 0xa7, 0x10, 0xfd, 0x13, 0x90, 0x19,
-    0xf6, 0x1b, 0xc9, 0x19, 0xeb, 0x15, 0xc6, 0x10,
-    0x46, 0x0d, 0xea, 0x09, 0x28, 0x0a, 0x6b, 0x08,
-    0x02, 0x08, 0xdd, 0x06, 0x89, 0x05, 0x35, 0x04,
-    0x24, 0xff, 0x55, 0xfc, 0xca, 0xf8, 0x5b, 0xf7,
-    0xd4, 0xf4, 0xae, 0xf1, 0x74, 0xee, 0xfc, 0xec,
-    0xed, 0xec, 0xd6, 0xea, 0xc3, 0xe7, 0x5b, 0xe3,
-    0x61, 0xde, 0x59, 0xd8, 0xa3, 0xd5, 0x77, 0xd4,
-    0xae, 0xd5, 0x4b, 0xd5, 0x23, 0xd4, 0x5d, 0xce,
-    0x22, 0xc9, 0x60, 0xc4, 0x00, 0xbe, 0x7f, 0xbf,
-    0xe4, 0xca, 0xb2, 0xdc, 0x17, 0xe8, 0xc7, 0xe9,
-    0xfd, 0xdb, 0xdd, 0xd2, 0x2d, 0xd4, 0xf1, 0xdd,
-    0x17, 0xee, 0x7d, 0xfb, 0xe2, 0x06, 0x51, 0x09,
-    0x09, 0x08, 0x78, 0x02, 0x8f, 0xfd, 0xa1, 0x00,
-    0x72, 0x05, 0x19, 0x0e, 0x5f, 0x19, 0xc6, 0x1f,
-    0x6a, 0x21, 0x17, 0x1d, 0x91, 0x16, 0x28, 0x16,
-    0xce, 0x1a, 0xcf, 0x1d, 0xea, 0x1d, 0x58, 0x1e,
-    0x4f, 0x21, 0x68, 0x27, 0x77, 0x2b, 0x8a, 0x27,
-    0x06, 0x23, 0x2a, 0x1d, 0x66, 0x19, 0x6c, 0x19,
-    0xa0, 0x1a, 0x0a, 0x1f, 0x79, 0x21, 0xa8, 0x21,
-    0x48, 0x1e, 0xc0, 0x1a, 0xca, 0x14, 0x55, 0x0e,
-    0x0a, 0x0c, 0x45, 0x0f, 0xaa, 0x17, 0xe2, 0x1d,
-    0x12, 0x1d, 0xe3, 0x15, 0x5a, 0x0f, 0xd5, 0x0a,
-    0x8b, 0x08, 0xeb, 0x09, 0xe8, 0x0a, 0x12, 0x0c,
-    0x7d, 0x0c, 0x1f, 0x09, 0xc0, 0x05, 0x5b, 0x01,
-    0x14, 0xfc, 0x76, 0xf8, 0x33, 0xf7, 0x9e, 0xf7,
-    0x22, 0xf7, 0x6d, 0xf5, 0x11, 0xf1, 0xbf, 0xee,
-    0x66, 0xec, 0xaf, 0xe7, 0x30, 0xe3, 0x19, 0xdf,
-    0xef, 0xdb, 0xbd, 0xd9, 0x9d, 0xd9, 0x46, 0xd9,
-    0xed, 0xd8, 0xf1, 0xd5, 0x56, 0xcf, 0x50, 0xcb,
-    0xa8, 0xc6, 0x0e, 0xc5, 0xf0, 0xc2, 0x14, 0xc3,
-    0x86, 0xd4, 0x22, 0xe2, 0x2d, 0xec, 0x47, 0xe7,
-    0x6c, 0xd5, 0x12, 0xce, 0x89, 0xd7, 0x53, 0xe9,
-    0xc8, 0xf9, 0x70, 0x07, 0xaf, 0x08, 0xd5, 0x07,
-    0x25, 0x03, 0x27, 0xfe, 0x7a, 0xfd, 0xd1, 0x06,
-    0xc6, 0x0e, 0xc8, 0x17, 0x33, 0x20, 0x12, 0x21,
-    0xed, 0x20, 0x48, 0x18, 0xac, 0x12, 0xfa, 0x15,
-    0x1e, 0x1c, 0xfb, 0x1f, 0xb3, 0x20, 0xe3, 0x1f,
-    0x81, 0x23, 0xe9, 0x29, 0x89, 0x29, 0x90, 0x22,
-    0x1e, 0x1c, 0x64, 0x18, 0x20, 0x18, 0xf3, 0x1c,
-    0x9f, 0x21, 0xd1, 0x23, 0x24, 0x24, 0x8b, 0x1d,
-    0xd7, 0x16, 0x89, 0x11, 0x11, 0x10, 0xb2, 0x10,
-    0xf6, 0x13, 0x96, 0x19, 0x32, 0x1c, 0x17, 0x1b,
-    0xfd, 0x12, 0x72, 0x0c, 0x89, 0x09, 0x6b, 0x0b,
-    0x57, 0x0e, 0x46, 0x10, 0x68, 0x0e, 0x1c, 0x0b,
-    0x6e, 0x07, 0x44, 0x02, 0x20, 0x00, 0x5f, 0xfd,
-    0x0f, 0xfb, 0xbf, 0xf9, 0x89, 0xf9, 0x0a, 0xf8,
-    0x97, 0xf6, 0xf7, 0xf2, 0x90, 0xed, 0xd1, 0xe8,
-    0xf8, 0xe4, 0x52, 0xe2, 0xbf, 0xdf, 0xb3, 0xe0,
-    0xef, 0xdd, 0xce, 0xdc, 0x63, 0xd9, 0xce, 0xd4,
-    0xa5, 0xcf, 0xe2, 0xcb, 0xe8, 0xca, 0x55, 0xca,
-    0xcd, 0xcc, 0x19, 0xc8, 0x2f, 0xc4, 0x0d, 0xc4,
-    0xeb, 0xd6, 0x85, 0xe4, 0x07, 0xeb, 0x18, 0xe1,
-    0x3f, 0xce, 0x9e, 0xd5, 0xc6, 0xe4, 0xb6, 0xfa,
-    0xc8, 0x05, 0xf3, 0x08, 0x72, 0x06, 0x7a, 0x02,
-    0x8b, 0x01, 0x2f, 0x00, 0xe2, 0x06, 0xe1, 0x11,
-    0x5a, 0x18, 0x1d, 0x1f, 0x54, 0x21, 0x38, 0x1d,
-    0xe8, 0x18, 0xe4, 0x11, 0x9d, 0x15, 0xfd, 0x1c,
-    0x51, 0x22, 0xc0, 0x22, 0xc3, 0x1d, 0x4e, 0x20,
-    0xc8, 0x25, 0x36, 0x2a, 0x95, 0x23, 0xe8, 0x1b,
-    0xdb, 0x17, 0xf5, 0x17, 0x4b, 0x20, 0xcb, 0x22,
-    0xa2, 0x24, 0x46, 0x21, 0x84, 0x1a, 0xa6, 0x14,
-    0x53, 0x10, 0x74, 0x10, 0x45, 0x11, 0xd6, 0x14,
-    0x7e, 0x18, 0x8a, 0x1a, 0x26, 0x18, 0x3b, 0x11,
-    0x27, 0x0b, 0x7d, 0x0b, 0xcc, 0x0d, 0x2f, 0x11,
-    0x90, 0x12, 0xe4, 0x0d, 0x86, 0x0b, 0x24, 0x07,
-    0xb6, 0x05, 0x43, 0x02, 0x0e, 0x00, 0x29, 0xfd,
-    0x17, 0xfb, 0x01, 0xfc, 0x3a, 0xfa, 0x62, 0xf8,
-    0x31, 0xf2, 0x94, 0xed, 0xc3, 0xe8, 0x03, 0xe6,
-    0xe9, 0xe3, 0xf9, 0xe1, 0x2b, 0xe1, 0x14, 0xe0,
-    0x81, 0xdb, 0x3b, 0xd7, 0xf2, 0xcf, 0x21, 0xcd,
-    0x4c, 0xcc, 0x51, 0xcc, 0x7e, 0xce, 0xe2, 0xca,
-    0x60, 0xc7, 0xd0, 0xbb, 0x61, 0xc2, 0x73, 0xd5,
-    0x13, 0xe6, 0xa9, 0xec, 0x85, 0xdd, 0x82, 0xce,
-    0x38, 0xd1, 0x6a, 0xe7, 0x14, 0xf8, 0xba, 0x05,
-    0x64, 0x08, 0x2d, 0x03, 0x00, 0x01, 0xf7, 0xff,
-    0x48, 0x02, 0x39, 0x07, 0x27, 0x13, 0xf1, 0x18,
-    0x05, 0x20, 0xf0, 0x21, 0x11, 0x1b, 0x8a, 0x15,
-    0x1f, 0x13, 0xf3, 0x17, 0xd1, 0x20, 0xe6, 0x20,
-    0xda, 0x1e, 0x37, 0x1d, 0x83, 0x1f, 0xa2, 0x28,
-    0xe6, 0x26, 0x79, 0x1f, 0x98, 0x17, 0xcf, 0x16,
-    0xf3, 0x1a, 0xc9, 0x22, 0x26, 0x25, 0x27, 0x21,
-    0x76, 0x1d, 0xc9, 0x15, 0xb6, 0x14, 0x60, 0x12,
-    0x3c, 0x12, 0x14, 0x14, 0x1a, 0x15, 0x6c, 0x1a,
-    0x9e, 0x1a, 0x71, 0x14, 0x00, 0x0e, 0xc9, 0x0c,
-    0x5e, 0x0e, 0xda, 0x11, 0x12, 0x13, 0x87, 0x0f,
-    0xb6, 0x0c, 0xf8, 0x0b, 0x06, 0x09, 0x60, 0x06,
-    0xe2, 0x03, 0x6c, 0x00, 0xb1, 0xfe, 0x7d, 0xfe,
-    0x0a, 0xfe, 0x65, 0xfb, 0xdc, 0xf7, 0xd0, 0xf2,
-    0x17, 0xee, 0xe6, 0xeb, 0xdb, 0xe8, 0xba, 0xe5,
-    0x1d, 0xe3, 0x41, 0xe2, 0x90, 0xdf, 0x99, 0xdb,
-    0x59, 0xd5, 0xd9, 0xcf, 0x44, 0xcf, 0x9f, 0xcb,
-    0x20, 0xcf, 0xf6, 0xc9, 0x31, 0xca, 0xe4, 0xc2,
-    0x6b, 0xbd, 0x2a, 0xce, 0x31, 0xdd, 0xdb, 0xea,
-    0x41, 0xe2, 0xcf, 0xd2, 0x54, 0xcb, 0x79, 0xdc,
-    0x76, 0xf1, 0x0b, 0xff, 0x60, 0x08, 0x02, 0x03,
-    0x65, 0xff, 0xff, 0xfb, 0x13, 0xfe, 0x8c, 0x04,
-    0xb6, 0x0d, 0x6a, 0x16, 0x18, 0x1a, 0xdd, 0x1e,
-    0xb9, 0x1a, 0x31, 0x15, 0x39, 0x13, 0xdf, 0x12,
-    0x7d, 0x1b, 0xad, 0x1c, 0xc3, 0x1b, 0x65, 0x1c,
-    0x65, 0x1e, 0xf4, 0x24, 0x85, 0x24, 0x8a, 0x1c,
-    0x50, 0x16, 0x72, 0x15, 0x75, 0x19, 0x7b, 0x20,
-    0x48, 0x21, 0xd4, 0x1e, 0x76, 0x1d, 0x58, 0x17,
-    0x04, 0x13, 0x81, 0x11, 0x2f, 0x10, 0x9d, 0x13,
-    0xff, 0x15, 0xa9, 0x18, 0x70, 0x18, 0x5d, 0x14,
-    0xaa, 0x0f, 0xb1, 0x0c, 0x69, 0x0e, 0x06, 0x11,
-    0x21, 0x13, 0xf4, 0x10, 0x10, 0x0e, 0x11, 0x0d,
-    0x7b, 0x0b, 0x57, 0x09, 0x32, 0x06, 0x5d, 0x02,
-    0x50, 0x01, 0x40, 0x02, 0x68, 0x01, 0xf0, 0xfd,
-    0x6a, 0xfa, 0x5c, 0xf7, 0x4e, 0xf3, 0x49, 0xf0,
-    0x11, 0xed, 0xe1, 0xe9, 0x1c, 0xe8, 0x3b, 0xe5,
-    0xf5, 0xe2, 0x43, 0xdd, 0x58, 0xd9, 0xc6, 0xd3,
-    0xbd, 0xd1, 0xfc, 0xcf, 0xcd, 0xce, 0x27, 0xce,
-    0xea, 0xc7, 0x1d, 0xc8, 0xbf, 0xbd, 0x82, 0xc9,
-    0xd4, 0xdd, 0xb5, 0xe7, 0xe9, 0xe8, 0xec, 0xd4,
-    0xa0, 0xca, 0xa5, 0xd7, 0xb7, 0xee, 0x37, 0xff,
-    0x44, 0x06, 0xab, 0x04, 0xe0, 0xfe, 0x44, 0xfb,
-    0x01, 0xfc, 0x0a, 0x00, 0xa2, 0x0c, 0xff, 0x14,
-    0xff, 0x1b, 0x2f, 0x1c, 0x1c, 0x18, 0xb7, 0x12,
-    0x8a, 0x0f, 0xe3, 0x13, 0xe6, 0x1a, 0xe1, 0x20,
-    0xcb, 0x1a, 0x12, 0x1a, 0xb6, 0x19, 0xe7, 0x1e,
-    0x75, 0x24, 0x4b, 0x1d, 0x76, 0x17, 0x7e, 0x14,
-    0x09, 0x17, 0xa2, 0x1b, 0xa2, 0x1e, 0x31, 0x1d,
-    0x27, 0x1b, 0xf2, 0x16, 0xb4, 0x11, 0x5b, 0x0f,
-    0x77, 0x0f, 0xf5, 0x12, 0x3f, 0x15, 0xbf, 0x17,
-    0xe6, 0x15, 0x2a, 0x12, 0xc1, 0x0c, 0x5b, 0x0b,
-    0x22, 0x0e, 0xec, 0x0f, 0xa4, 0x12, 0xc8, 0x11,
-    0x0d, 0x0d, 0x40, 0x0b, 0x24, 0x09, 0xfe, 0x06,
-    0xe7, 0x07, 0x62, 0x05, 0xa9, 0x03, 0x7e, 0x02,
-    0x44, 0x02, 0x09, 0x00, 0x63, 0xfc, 0x6e, 0xfa,
-    0x2b, 0xf7, 0x89, 0xf3, 0x3d, 0xf1, 0x3e, 0xed,
-    0x7f, 0xeb, 0x72, 0xea, 0xf9, 0xe5, 0x73, 0xe1,
-    0x42, 0xda, 0x7e, 0xd6, 0x36, 0xd4, 0xf2, 0xd3,
-    0x42, 0xd3, 0xb3, 0xd1, 0x3e, 0xcc, 0x75, 0xc6,
-    0x92, 0xc0, 0xca, 0xc4, 0x93, 0xdc, 0x03, 0xe8,
-    0xa8, 0xec, 0xac, 0xdc, 0x87, 0xca, 0xee, 0xd2,
-    0xc5, 0xe5, 0xa9, 0xfb, 0xa7, 0x07, 0xcd, 0x07,
-    0xa6, 0x00, 0xba, 0xfa, 0xc6, 0xfb, 0x2e, 0xfe,
-    0x61, 0x07, 0x18, 0x12, 0x9f, 0x18, 0xd0, 0x20,
-    0x30, 0x1b, 0x57, 0x14, 0xfe, 0x0c, 0x92, 0x0d,
-    0xac, 0x18, 0x05, 0x1e, 0x2a, 0x1d, 0x42, 0x1a,
-    0x6f, 0x17, 0x47, 0x1a, 0x99, 0x1f, 0x03, 0x1c,
-    0x4b, 0x17, 0x90, 0x13, 0xd9, 0x11, 0x05, 0x17,
-    0x41, 0x1c, 0x01, 0x1b, 0xdc, 0x1a, 0x2e, 0x14,
-    0x0c, 0x10, 0xef, 0x0e, 0x56, 0x0d, 0x3a, 0x10,
-    0xdb, 0x11, 0x04, 0x16, 0x93, 0x15, 0xb8, 0x13,
-    0x84, 0x0e, 0x99, 0x0a, 0x82, 0x0c, 0xd2, 0x0d,
-    0x81, 0x11, 0x86, 0x11, 0x65, 0x0f, 0x7e, 0x0c,
-    0x71, 0x0a, 0xbe, 0x08, 0xb7, 0x07, 0x97, 0x06,
-    0xbf, 0x04, 0x43, 0x04, 0xe8, 0x02, 0xae, 0x01,
-    0x54, 0xff, 0x32, 0xfc, 0x15, 0xf8, 0xb0, 0xf3,
-    0xe9, 0xf0, 0xdf, 0xee, 0x16, 0xed, 0x53, 0xea,
-    0xe2, 0xe5, 0xb6, 0xe2, 0x51, 0xde, 0x8f, 0xd9,
-    0xd6, 0xd6, 0x1c, 0xd3, 0x3f, 0xd3, 0x94, 0xd2,
-    0xe0, 0xce, 0xc8, 0xca, 0xee, 0xc2, 0x86, 0xc5,
-    0xbc, 0xda, 0xcb, 0xea, 0x9f, 0xee, 0x25, 0xe2,
-    0xd5, 0xcb, 0xcf, 0xd0, 0x2f, 0xe6, 0xda, 0xfb,
-    0x78, 0x08, 0x98, 0x09, 0xbf, 0x03, 0xa7, 0xfd,
-    0xf1, 0xfd, 0xa4, 0xfc, 0xac, 0x06, 0x0e, 0x12,
-    0xb2, 0x19, 0xbf, 0x1f, 0x72, 0x1a, 0x0b, 0x14,
-    0x48, 0x0f, 0x49, 0x0d, 0xbb, 0x14, 0x37, 0x1a,
-    0x10, 0x18, 0xf9, 0x17, 0xa3, 0x17, 0xd9, 0x1a,
-    0x98, 0x1e, 0x85, 0x17, 0x73, 0x10, 0x32, 0x0f,
-    0x1b, 0x12, 0x4c, 0x18, 0x6e, 0x1b, 0x75, 0x18,
-    0xc7, 0x17, 0xaf, 0x15, 0x07, 0x10, 0xee, 0x0d,
-    0x95, 0x0b, 0xff, 0x0e, 0xd6, 0x13, 0xf1, 0x16,
-    0xde, 0x15, 0x91, 0x11, 0x78, 0x0e, 0x52, 0x0c,
-    0x89, 0x0d, 0x5b, 0x0d, 0x18, 0x10, 0x0b, 0x10,
-    0xb9, 0x0e, 0x6c, 0x0f, 0x1c, 0x0c, 0x0d, 0x09,
-    0x1e, 0x07, 0x79, 0x04, 0x84, 0x04, 0x43, 0x06,
-    0x54, 0x04, 0x0a, 0x02, 0xf5, 0x00, 0xa0, 0xfe,
-    0xd4, 0xf9, 0x77, 0xf3, 0xde, 0xef, 0x15, 0xed,
-    0xf1, 0xed, 0x06, 0xec, 0x7c, 0xe8, 0x3b, 0xe4,
-    0xdc, 0xde, 0x88, 0xd9, 0x5f, 0xd6, 0xb5, 0xd4,
-    0x3c, 0xd3, 0xdf, 0xd3, 0x37, 0xce, 0xcb, 0xcd,
-    0x4f, 0xc5, 0x20, 0xc9, 0x18, 0xde, 0x4a, 0xea,
-    0xcf, 0xed, 0x84, 0xe1, 0xd3, 0xd0, 0xcb, 0xd6,
-    0x24, 0xeb, 0x91, 0xfb, 0xf8, 0x06, 0xe3, 0x0a,
-    0x61, 0x06, 0x0b, 0x00, 0xa8, 0xfe, 0x40, 0xfd,
-    0x41, 0x08, 0xbc, 0x12, 0xef, 0x1a, 0xa1, 0x1f,
-    0xe6, 0x1a, 0x1c, 0x14, 0xe9, 0x0c, 0x59, 0x0d,
-    0x56, 0x14, 0xaf, 0x19, 0xa7, 0x17, 0x46, 0x16,
-    0x87, 0x15, 0x0c, 0x18, 0xc7, 0x1a, 0x0c, 0x13,
-    0xfc, 0x0f, 0xee, 0x0e, 0x0f, 0x10, 0x2f, 0x16,
-    0x09, 0x17, 0x0f, 0x16, 0x7f, 0x14, 0x10, 0x12,
-    0x60, 0x0f, 0x7b, 0x0f, 0x94, 0x0d, 0x14, 0x0e,
-    0xed, 0x0f, 0x33, 0x13, 0x65, 0x14, 0xa5, 0x11,
-    0x51, 0x0e, 0x39, 0x0d, 0x36, 0x0d, 0xb1, 0x0c,
-    0x0d, 0x0f, 0x76, 0x0e, 0xca, 0x0d, 0x0c, 0x0d,
-    0x0f, 0x0a, 0x36, 0x07, 0x6b, 0x07, 0x88, 0x04,
-    0xa2, 0x04, 0x2f, 0x05, 0x50, 0x03, 0x1b, 0x02,
-    0x26, 0x00, 0xe6, 0xfc, 0x12, 0xf9, 0xea, 0xf4,
-    0x8c, 0xf0, 0x7d, 0xef, 0xc6, 0xec, 0xaf, 0xeb,
-    0xd0, 0xe7, 0x49, 0xe4, 0xcc, 0xdf, 0xdc, 0xda,
-    0x00, 0xd9, 0x1b, 0xd6, 0x5c, 0xd5, 0x88, 0xd2,
-    0xe0, 0xcf, 0xc9, 0xca, 0x53, 0xc7, 0xd8, 0xd5,
-    0xfe, 0xe6, 0x3b, 0xef, 0xad, 0xe8, 0x02, 0xd6,
-    0x22, 0xd2, 0x4c, 0xe2, 0x39, 0xf6, 0xf5, 0x01,
-    0xae, 0x08, 0xab, 0x06, 0x2b, 0x03, 0xb3, 0x00,
-    0x66, 0xff, 0x08, 0x04, 0x24, 0x0d, 0x34, 0x14,
-    0x46, 0x1a, 0xba, 0x1c, 0x1c, 0x18, 0x3c, 0x14,
-    0x69, 0x0e, 0x20, 0x11, 0x8c, 0x13, 0x88, 0x12,
-    0x8b, 0x13, 0x78, 0x14, 0x0f, 0x19, 0xb4, 0x1b,
-    0x65, 0x15, 0x19, 0x0f, 0xc2, 0x0b, 0x46, 0x0c,
-    0x71, 0x12, 0x96, 0x15, 0xbb, 0x16, 0x36, 0x16,
-    0xde, 0x13, 0x28, 0x10, 0x98, 0x0d, 0x09, 0x0b,
-    0xa2, 0x0c, 0xc1, 0x10, 0xe0, 0x13, 0xfb, 0x14,
-    0x3a, 0x12, 0x45, 0x0e, 0x0b, 0x0e, 0xfd, 0x0d,
-    0x61, 0x0d, 0xdc, 0x0e, 0x10, 0x0d, 0x4c, 0x0d,
-    0xe9, 0x0c, 0x5e, 0x0b, 0xdf, 0x09, 0x71, 0x08,
-    0x17, 0x05, 0x36, 0x02, 0x3b, 0x02, 0xdc, 0x00,
-    0xda, 0x01, 0xc5, 0x01, 0x3f, 0x00, 0x3f, 0xfb,
-    0xb1, 0xf5, 0x79, 0xf1, 0xa1, 0xed, 0x7d, 0xed,
-    0x2e, 0xec, 0x49, 0xe9, 0x8b, 0xe8, 0xb5, 0xe3,
-    0x43, 0xdd, 0x3a, 0xd9, 0x90, 0xd5, 0xa2, 0xd6,
-    0x72, 0xd5, 0xf5, 0xd2, 0x24, 0xce, 0x97, 0xc9,
-    0x44, 0xce, 0x06, 0xe1, 0x2a, 0xed, 0xd7, 0xed,
-    0xe8, 0xe2, 0x49, 0xd2, 0x38, 0xdc, 0x6e, 0xed,
-    0x5f, 0xfc, 0x8b, 0x07, 0x83, 0x0a, 0x46, 0x08,
-    0x1d, 0x05, 0x58, 0x00, 0x00, 0xfe, 0xd2, 0x07,
-    0x4e, 0x12, 0x45, 0x19, 0x86, 0x1d, 0xe8, 0x1a,
-    0x0c, 0x14, 0x55, 0x11, 0xcf, 0x0e, 0x72, 0x12,
-    0xb8, 0x12, 0x30, 0x10, 0x90, 0x11, 0x4d, 0x13,
-    0xcb, 0x19, 0xa9, 0x18, 0xda, 0x12, 0x2f, 0x0e,
-    0xf4, 0x0b, 0xe4, 0x0b, 0x77, 0x10, 0xe2, 0x12,
-    0x91, 0x15, 0x6b, 0x18, 0xb4, 0x13, 0x5f, 0x10,
-    0x9a, 0x0b, 0x2c, 0x0a, 0xb1, 0x0c, 0xe4, 0x11,
-    0x3b, 0x15, 0x9a, 0x14, 0xf4, 0x12, 0x91, 0x0e,
-    0x59, 0x0e, 0x8c, 0x0d, 0xac, 0x0d, 0x88, 0x0d,
-    0xdc, 0x0c, 0x5d, 0x0c, 0x48, 0x0b, 0x9e, 0x0a,
-    0x57, 0x08, 0xf9, 0x06, 0xd1, 0x03, 0xf6, 0x01,
-    0x8f, 0x00, 0xf6, 0xfe, 0x67, 0xff, 0xd9, 0xfe,
-    0x1d, 0xfd, 0xbf, 0xf9, 0x5b, 0xf4, 0x22, 0xef,
-    0xbe, 0xea, 0xa2, 0xe8, 0x31, 0xe8, 0xc1, 0xe7,
-    0x5f, 0xe5, 0xda, 0xe1, 0xed, 0xdb, 0xa8, 0xd7,
-    0xdc, 0xd3, 0xae, 0xd3, 0x44, 0xd0, 0x0a, 0xd2,
-    0xc5, 0xcc, 0x02, 0xcf, 0x78, 0xe1, 0x80, 0xe7,
-    0xc1, 0xef, 0xac, 0xe2, 0x41, 0xd8, 0x27, 0xdb,
-    0xe6, 0xec, 0xc1, 0xfc, 0xa4, 0x04, 0x50, 0x0b,
-    0x51, 0x06, 0x36, 0x06, 0x3c, 0x03, 0x32, 0x03,
-    0x5f, 0x07, 0x65, 0x12, 0x8f, 0x16, 0x3b, 0x1b,
-    0x95, 0x19, 0x5d, 0x15, 0x14, 0x14, 0x38, 0x12,
-    0x49, 0x14, 0x58, 0x11, 0x26, 0x0e, 0x6b, 0x0c,
-    0x90, 0x11, 0xd4, 0x16, 0x6a, 0x19, 0x27, 0x14,
-    0x30, 0x0e, 0xbd, 0x09, 0xa8, 0x08, 0x70, 0x0c,
-    0xf7, 0x0f, 0xe4, 0x14, 0x28, 0x16, 0xcb, 0x12,
-    0x12, 0x10, 0xb3, 0x0b, 0xa1, 0x0a, 0xbe, 0x0c,
-    0x32, 0x0e, 0x70, 0x14, 0x35, 0x13, 0x35, 0x12,
-    0x2c, 0x11, 0xb3, 0x10, 0x38, 0x10, 0xeb, 0x0d,
-    0x00, 0x0d, 0xc8, 0x09, 0x02, 0x0c, 0xd4, 0x0b,
-    0x5d, 0x0a, 0x57, 0x0b, 0xef, 0x07, 0x66, 0x04,
-    0x76, 0x01, 0xf5, 0xfd, 0x9e, 0xfe, 0x88, 0xfe,
-    0x95, 0x00, 0xef, 0xfd, 0x8b, 0xfa, 0xd9, 0xf4,
-    0xa7, 0xee, 0xba, 0xeb, 0x1c, 0xe9, 0x16, 0xe9,
-    0x9f, 0xe7, 0x51, 0xe6, 0x89, 0xe1, 0x79, 0xdd,
-    0x36, 0xd7, 0x0b, 0xd6, 0x1e, 0xd2, 0xba, 0xd1,
-    0x64, 0xcf, 0x55, 0xcc, 0xf6, 0xd0, 0xf3, 0xdf,
-    0xb5, 0xea, 0x86, 0xec, 0x1e, 0xe7, 0x25, 0xd6,
-    0x31, 0xde, 0xa6, 0xe9, 0xb1, 0xf9, 0x92, 0x07,
-    0xa0, 0x09, 0x91, 0x09, 0x85, 0x06, 0x17, 0x05,
-    0xaa, 0x02, 0x48, 0x08, 0xa6, 0x0d, 0x54, 0x14,
-    0x20, 0x1c, 0xfc, 0x19, 0x09, 0x17, 0x92, 0x14,
-    0x7e, 0x11, 0x55, 0x12, 0xaf, 0x10, 0xa7, 0x0a,
-    0x1a, 0x0c, 0xb3, 0x0e, 0xc8, 0x15, 0x5b, 0x19,
-    0x20, 0x13, 0xfa, 0x0e, 0x91, 0x06, 0x0d, 0x07,
-    0xc3, 0x08, 0xed, 0x0d, 0x0e, 0x12, 0x5e, 0x14,
-    0xf9, 0x12, 0xd5, 0x0e, 0x71, 0x0c, 0xcf, 0x08,
-    0xc4, 0x0b, 0x4e, 0x0d, 0xca, 0x10, 0x43, 0x13,
-    0x16, 0x12, 0x78, 0x11, 0x01, 0x13, 0xfd, 0x0f,
-    0x30, 0x0f, 0x9d, 0x0c, 0x42, 0x09, 0x5f, 0x0a,
-    0xf1, 0x0b, 0x63, 0x0c, 0x69, 0x0b, 0x4c, 0x09,
-    0xb9, 0x02, 0xab, 0x01, 0x19, 0xfe, 0x6b, 0xfd,
-    0x5a, 0xff, 0x43, 0xff, 0xe7, 0xff, 0x2b, 0xfa,
-    0xff, 0xf5, 0xf3, 0xef, 0x0b, 0xed, 0x3f, 0xeb,
-    0xb2, 0xe9, 0x60, 0xe8, 0x2e, 0xe6, 0x6a, 0xe2,
-    0x0a, 0xde, 0xe3, 0xda, 0x81, 0xd6, 0x67, 0xd5,
-    0x68, 0xd2, 0x52, 0xd2, 0x5f, 0xce, 0x1e, 0xcc,
-    0x45, 0xd8, 0xa2, 0xe9, 0xac, 0xf0, 0xac, 0xef,
-    0x56, 0xdf, 0x36, 0xda, 0x50, 0xe8, 0x0e, 0xf6,
-    0x5a, 0x04, 0x3c, 0x0b, 0x14, 0x0d, 0x4f, 0x09,
-    0x12, 0x08, 0x91, 0x05, 0x6e, 0x08, 0x7f, 0x0f,
-    0xf1, 0x14, 0x90, 0x17, 0xa9, 0x1a, 0xb8, 0x16,
-    0x44, 0x14, 0xc5, 0x13, 0xca, 0x12, 0xe9, 0x12,
-    0xc1, 0x0c, 0x8a, 0x09, 0xfa, 0x0a, 0x35, 0x11,
-    0x8e, 0x15, 0x98, 0x14, 0x70, 0x0e, 0x39, 0x0b,
-    0x5f, 0x05, 0x94, 0x06, 0x88, 0x09, 0xb2, 0x0d,
-    0x94, 0x12, 0xf6, 0x10, 0x7b, 0x0f, 0x82, 0x0c,
-    0x2d, 0x0a, 0x2e, 0x09, 0x36, 0x0b, 0x76, 0x0e,
-    0x08, 0x12, 0x8b, 0x10, 0x0a, 0x10, 0x73, 0x10,
-    0xc9, 0x11, 0xa5, 0x10, 0x54, 0x0d, 0xc5, 0x0b,
-    0xb1, 0x09, 0xc1, 0x09, 0x52, 0x0a, 0xf1, 0x09,
-    0x9b, 0x0a, 0xe4, 0x06, 0xa1, 0x02, 0x07, 0xff,
-    0xbb, 0xfc, 0xc8, 0xfd, 0xa9, 0xfd, 0x45, 0xff,
-    0x78, 0xfc, 0x64, 0xf8, 0x6b, 0xf2, 0xc9, 0xee,
-    0xa2, 0xeb, 0x59, 0xeb, 0x76, 0xe8, 0xa6, 0xe6,
-    0xdd, 0xe4, 0x32, 0xe1, 0xd6, 0xde, 0x3e, 0xda,
-    0xaa, 0xd7, 0x03, 0xd3, 0x67, 0xd2, 0xe3, 0xcd,
-    0xbd, 0xce, 0xf5, 0xd8, 0xc6, 0xea, 0xcc, 0xf0,
-    0xa4, 0xf1, 0xef, 0xe3, 0xc0, 0xdd, 0xa4, 0xe9,
-    0xd4, 0xf2, 0x17, 0x03, 0x17, 0x0a, 0x73, 0x10,
-    0x40, 0x0d, 0x83, 0x0c, 0xf0, 0x08, 0x21, 0x0a,
-    0xeb, 0x0f, 0xae, 0x10, 0x24, 0x15, 0x5d, 0x19,
-    0x80, 0x19, 0x2a, 0x18, 0xf0, 0x16, 0x7e, 0x12,
-    0xeb, 0x11, 0x4b, 0x0c, 0x4c, 0x07, 0x48, 0x08,
-    0x45, 0x0d, 0x4e, 0x13, 0x9b, 0x15, 0x27, 0x12,
-    0xc2, 0x0c, 0x6c, 0x06, 0x7a, 0x03, 0x76, 0x05,
-    0xf8, 0x08, 0x31, 0x0f, 0x13, 0x11, 0x47, 0x11,
-    0xed, 0x0d, 0x7c, 0x0a, 0xef, 0x08, 0xdd, 0x08,
-    0xea, 0x0d, 0x6f, 0x0e, 0xdc, 0x0f, 0x31, 0x10,
-    0xf7, 0x10, 0xfb, 0x12, 0x48, 0x11, 0x5f, 0x0e,
-    0xa2, 0x0c, 0x24, 0x0b, 0x16, 0x09, 0x58, 0x09,
-    0x8f, 0x09, 0xaf, 0x0b, 0x3d, 0x0a, 0xea, 0x05,
-    0xc7, 0x00, 0x31, 0xfd, 0x0f, 0xfc, 0xc2, 0xfb,
-    0x4d, 0xfd, 0xb4, 0xfc, 0x4b, 0xfb, 0x8c, 0xf7,
-    0xcf, 0xf1, 0xd7, 0xed, 0x46, 0xea, 0xba, 0xe7,
-    0x36, 0xe7, 0xdb, 0xe5, 0x5f, 0xe4, 0x1e, 0xe1,
-    0xb1, 0xdf, 0x89, 0xda, 0xea, 0xd7, 0x76, 0xd2,
-    0x7d, 0xd0, 0x41, 0xce, 0x32, 0xd4, 0x1b, 0xe8,
-    0xe2, 0xef, 0xe8, 0xf8, 0xb8, 0xec, 0x08, 0xe3,
-    0x55, 0xe6, 0x93, 0xf1, 0xb1, 0xfb, 0xbc, 0x06,
-    0x1f, 0x0e, 0x42, 0x10, 0x71, 0x12, 0x5d, 0x0d,
-    0x08, 0x0d, 0xdc, 0x0c, 0x97, 0x12, 0xbb, 0x0f,
-    0x0a, 0x15, 0x08, 0x17, 0x1b, 0x18, 0xc0, 0x19,
-    0xae, 0x16, 0x70, 0x12, 0x1a, 0x0c, 0x1d, 0x05,
-    0x93, 0x03, 0x2f, 0x08, 0x74, 0x0f, 0xd6, 0x13,
-    0x79, 0x11, 0x29, 0x0f, 0xae, 0x07, 0xda, 0x02,
-    0xf9, 0x01, 0xb6, 0x05, 0xb2, 0x09, 0x18, 0x0f,
-    0x91, 0x0c, 0x09, 0x0f, 0x89, 0x0c, 0xef, 0x0a,
-    0x7c, 0x0a, 0xfc, 0x08, 0x04, 0x0d, 0x6a, 0x0c,
-    0x8e, 0x0d, 0xd9, 0x0e, 0x69, 0x13, 0x12, 0x13,
-    0xe0, 0x11, 0xfe, 0x0c, 0x09, 0x0a, 0x98, 0x07,
-    0x71, 0x07, 0x55, 0x08, 0xa1, 0x0a, 0x40, 0x0b,
-    0x9b, 0x07, 0xab, 0x03, 0x26, 0xff, 0xb1, 0xfc,
-    0xbf, 0xfa, 0x82, 0xfb, 0x2d, 0xfb, 0xe7, 0xfb,
-    0xca, 0xf8, 0x03, 0xf6, 0x88, 0xf1, 0x1c, 0xee,
-    0x00, 0xea, 0xc1, 0xe7, 0x22, 0xe6, 0x18, 0xe4,
-    0x2a, 0xe3, 0x08, 0xe1, 0xfc, 0xde, 0xae, 0xda,
-    0x20, 0xd8, 0x25, 0xd3, 0xaa, 0xd1, 0xc3, 0xcd,
-    0xb4, 0xd7, 0x21, 0xeb, 0x35, 0xf6, 0xa5, 0xfa,
-    0x69, 0xec, 0xff, 0xe2, 0xa0, 0xec, 0x27, 0xf6,
-    0xe0, 0x01, 0xeb, 0x08, 0x22, 0x0e, 0x07, 0x12,
-    0x26, 0x12, 0x33, 0x11, 0x54, 0x0d, 0x5c, 0x12,
-    0x2f, 0x10, 0xcd, 0x10, 0x1e, 0x13, 0xdd, 0x15,
-    0xfe, 0x16, 0x50, 0x17, 0x8d, 0x16, 0xc8, 0x12,
-    0x6e, 0x0e, 0x2a, 0x02, 0xaf, 0x01, 0x6b, 0x03,
-    0x45, 0x0d, 0x15, 0x11, 0x85, 0x0f, 0xef, 0x0d,
-    0x5c, 0x07, 0xc0, 0x03, 0xc3, 0x01, 0xd0, 0x04,
-    0xb3, 0x07, 0xec, 0x0a, 0x55, 0x09, 0xc6, 0x0b,
-    0x62, 0x0c, 0x2b, 0x0d, 0xcf, 0x0b, 0xfe, 0x0b,
-    0x7d, 0x0c, 0x82, 0x0b, 0x24, 0x0c, 0x01, 0x0d,
-    0x32, 0x13, 0x13, 0x13, 0x2e, 0x11, 0xde, 0x0c,
-    0xb3, 0x09, 0xba, 0x06, 0x9c, 0x07, 0x1f, 0x06,
-    0x13, 0x08, 0xdc, 0x08, 0xed, 0x04, 0xc9, 0x02,
-    0x1b, 0xff, 0x64, 0xfe, 0xc5, 0xfb, 0xbb, 0xfa,
-    0xa4, 0xf8, 0x50, 0xf8, 0xd3, 0xf5, 0x86, 0xf5,
-    0xae, 0xf0, 0xf7, 0xee, 0x4e, 0xeb, 0x75, 0xe8,
-    0x59, 0xe5, 0x3a, 0xe4, 0x74, 0xe2, 0x1e, 0xe0,
-    0xc5, 0xde, 0x38, 0xd9, 0x92, 0xd9, 0x4b, 0xd3,
-    0x89, 0xd2, 0x8f, 0xce, 0x7d, 0xdf, 0x5d, 0xed,
-    0x40, 0xf7, 0x22, 0xf7, 0xbd, 0xe8, 0x1a, 0xeb,
-    0x47, 0xf1, 0x50, 0xfa, 0x46, 0x02, 0x94, 0x0a,
-    0x66, 0x0f, 0x37, 0x13, 0x0b, 0x13, 0x67, 0x12,
-    0x1e, 0x13, 0x7a, 0x14, 0x28, 0x0f, 0x37, 0x0e,
-    0xa7, 0x11, 0x64, 0x14, 0x19, 0x17, 0x71, 0x17,
-    0x0d, 0x14, 0xd6, 0x11, 0xea, 0x09, 0x4b, 0x02,
-    0xee, 0x01, 0x0e, 0x04, 0x37, 0x0a, 0x5a, 0x0c,
-    0x3a, 0x0c, 0xea, 0x0b, 0xa3, 0x08, 0x9a, 0x05,
-    0x24, 0x05, 0x49, 0x03, 0xf9, 0x05, 0xca, 0x05,
-    0x6d, 0x07, 0xaa, 0x09, 0x1c, 0x0c, 0x24, 0x0c,
-    0x40, 0x0c, 0x09, 0x0c, 0xfa, 0x09, 0x45, 0x09,
-    0x21, 0x09, 0xa6, 0x0b, 0xba, 0x0f, 0xba, 0x11,
-    0x2c, 0x0f, 0xc8, 0x0e, 0xdf, 0x0a, 0xf9, 0x08,
-    0x57, 0x07, 0x42, 0x06, 0x52, 0x06, 0xa5, 0x05,
-    0x6b, 0x03, 0x41, 0x01, 0x29, 0x02, 0x78, 0x00,
-    0xb4, 0xfd, 0xbd, 0xfb, 0x7d, 0xf8, 0xbd, 0xf7,
-    0x13, 0xf6, 0x84, 0xf4, 0x05, 0xf2, 0x64, 0xef,
-    0xf1, 0xeb, 0xe3, 0xe8, 0xb1, 0xe7, 0xe7, 0xe4,
-    0x7e, 0xe3, 0x6f, 0xdf, 0xc7, 0xdd, 0xbd, 0xda,
-    0xf9, 0xd9, 0xcf, 0xd4, 0xa7, 0xd4, 0x56, 0xcf,
-    0xaa, 0xdb, 0x98, 0xed, 0x31, 0xf6, 0x5d, 0xfc,
-    0x8d, 0xeb, 0xa4, 0xeb, 0x31, 0xf2, 0xab, 0xfc,
-    0x78, 0x03, 0xd2, 0x08, 0x09, 0x0e, 0xce, 0x13,
-    0x6d, 0x16, 0x8e, 0x14, 0x91, 0x15, 0x82, 0x13,
-    0xe8, 0x10, 0x03, 0x0b, 0xc9, 0x0e, 0x31, 0x13,
-    0x49, 0x16, 0x93, 0x18, 0xfb, 0x14, 0xf9, 0x11,
-    0xea, 0x0b, 0xb7, 0x02, 0x82, 0x00, 0x1c, 0x02,
-    0x3f, 0x06, 0x41, 0x09, 0x63, 0x09, 0xb6, 0x09,
-    0x25, 0x0a, 0x9b, 0x07, 0xe8, 0x07, 0xc8, 0x05,
-    0x67, 0x04, 0x44, 0x05, 0x51, 0x02, 0xee, 0x07,
-    0x49, 0x0a, 0xb9, 0x0c, 0xf7, 0x0d, 0x28, 0x0c,
-    0xc0, 0x0b, 0xf1, 0x09, 0xe0, 0x09, 0x3f, 0x0a,
-    0xc8, 0x0c, 0xfc, 0x0d, 0x47, 0x0e, 0xfc, 0x0c,
-    0xf0, 0x0d, 0xf2, 0x0a, 0x0f, 0x09, 0xc9, 0x07,
-    0xd2, 0x04, 0xc6, 0x04, 0xa2, 0x00, 0x31, 0x00,
-    0x0f, 0x00, 0x1f, 0x01, 0xd3, 0xfe, 0xd0, 0xfb,
-    0x73, 0xfa, 0x90, 0xf7, 0xad, 0xf5, 0x6d, 0xf1,
-    0x77, 0xf0, 0x7d, 0xee, 0x46, 0xed, 0xd8, 0xea,
-    0x2f, 0xe9, 0x52, 0xe8, 0x30, 0xe6, 0x6e, 0xe1,
-    0xc3, 0xdc, 0x4f, 0xda, 0x68, 0xd8, 0x0b, 0xd8,
-    0xbf, 0xd4, 0x65, 0xd5, 0xdd, 0xd5, 0x3d, 0xea,
-    0x2a, 0xf4, 0x5f, 0xfb, 0xae, 0xf6, 0x26, 0xe8,
-    0x3f, 0xf1, 0x41, 0xf7, 0x36, 0x05, 0x1a, 0x08,
-    0x15, 0x0d, 0xe7, 0x0f, 0x12, 0x15, 0x23, 0x17,
-    0x40, 0x16, 0x02, 0x15, 0x41, 0x12, 0xbf, 0x0e,
-    0x76, 0x0c, 0xef, 0x11, 0xe2, 0x11, 0xd5, 0x16,
-    0x10, 0x13, 0xa1, 0x12, 0xc1, 0x0e, 0xac, 0x09,
-    0x9d, 0x04, 0x5f, 0x02, 0x4f, 0x03, 0xb2, 0x06,
-    0x77, 0x08, 0xab, 0x07, 0xca, 0x08, 0x5b, 0x06,
-    0x6c, 0x07, 0x06, 0x08, 0xf9, 0x07, 0x75, 0x05,
-    0xd8, 0x04, 0x5e, 0x02, 0xd7, 0x06, 0x7f, 0x07,
-    0x4b, 0x0a, 0x55, 0x0b, 0x77, 0x0c, 0x0d, 0x0e,
-    0x61, 0x0a, 0xd4, 0x0a, 0xd2, 0x09, 0x45, 0x0c,
-    0x0e, 0x0c, 0xc3, 0x0b, 0xe7, 0x0a, 0xf9, 0x0b,
-    0x36, 0x0a, 0x67, 0x0a, 0x68, 0x07, 0x41, 0x06,
-    0x4e, 0x03, 0x4b, 0xfe, 0xe8, 0xfe, 0x50, 0xfd,
-    0x7f, 0xff, 0x81, 0xfd, 0x16, 0xfc, 0x34, 0xfa,
-    0x86, 0xf7, 0xb8, 0xf5, 0x67, 0xf1, 0x1e, 0xf0,
-    0xfe, 0xed, 0x92, 0xec, 0x6a, 0xea, 0x19, 0xe8,
-    0x34, 0xe6, 0x76, 0xe4, 0x33, 0xe2, 0x47, 0xdd,
-    0xa2, 0xdb, 0xa3, 0xd8, 0xcf, 0xd7, 0xb5, 0xd5,
-    0xd7, 0xd3, 0xe2, 0xdc, 0x95, 0xee, 0xb0, 0xf6,
-    0x11, 0xfe, 0xd5, 0xf1, 0x08, 0xef, 0x5f, 0xf8,
-    0xda, 0xfc, 0x5e, 0x09, 0xc9, 0x06, 0x5f, 0x0c,
-    0xe5, 0x0e, 0xe5, 0x16, 0x77, 0x18, 0x05, 0x19,
-    0xf7, 0x16, 0x0f, 0x14, 0xd3, 0x0f, 0x15, 0x0f,
-    0x27, 0x10, 0x0f, 0x10, 0x6c, 0x15, 0x86, 0x10,
-    0x72, 0x11, 0x70, 0x0c, 0x27, 0x09, 0x57, 0x05,
-    0x52, 0x04, 0xb2, 0x03, 0x1b, 0x07, 0x90, 0x05,
-    0xcd, 0x05, 0xc5, 0x04, 0xa6, 0x05, 0x4f, 0x09,
-    0xea, 0x09, 0xd2, 0x08, 0xcc, 0x04, 0xef, 0x02,
-    0x23, 0x01, 0x87, 0x05, 0xca, 0x06, 0xc0, 0x09,
-    0x0d, 0x09, 0x3e, 0x0b, 0x4b, 0x0a, 0x53, 0x0d,
-    0x0a, 0x0d, 0xec, 0x0c, 0xe7, 0x0c, 0x65, 0x0b,
-    0x08, 0x0b, 0x45, 0x0b, 0xcf, 0x0b, 0xe6, 0x0a,
-    0x80, 0x0a, 0x3a, 0x07, 0xa0, 0x06, 0x5e, 0x02,
-    0xdc, 0x00, 0x7b, 0xfe, 0x7f, 0xff, 0xcd, 0xfe,
-    0x20, 0xfe, 0x31, 0xfb, 0xe7, 0xf9, 0x15, 0xf9,
-    0xc4, 0xf6, 0xa3, 0xf4, 0x89, 0xf1, 0x42, 0xef,
-    0xd1, 0xec, 0xdc, 0xea, 0xd4, 0xe9, 0x38, 0xe8,
-    0x6b, 0xe6, 0x89, 0xe3, 0xa5, 0xe0, 0xbb, 0xdd,
-    0x44, 0xdd, 0x58, 0xda, 0x77, 0xd7, 0xdd, 0xd6,
-    0xc5, 0xd3, 0xe9, 0xe6, 0x79, 0xf2, 0x6e, 0xff,
-    0xd2, 0xfb, 0x94, 0xf1, 0x08, 0xf6, 0xe8, 0xfb,
-    0x66, 0x06, 0x52, 0x07, 0x4d, 0x08, 0xe0, 0x0b,
-    0xe9, 0x0f, 0x87, 0x13, 0xc3, 0x18, 0xe0, 0x1a,
-    0x1b, 0x1c, 0x09, 0x14, 0x71, 0x0f, 0xc3, 0x0c,
-    0x74, 0x10, 0x9a, 0x0f, 0x2e, 0x10, 0xc0, 0x0e,
-    0x84, 0x0e, 0x06, 0x0f, 0xd0, 0x09, 0xe2, 0x08,
-    0xcb, 0x05, 0x8f, 0x06, 0x70, 0x05, 0x9a, 0x05,
-    0xc4, 0x02, 0xc7, 0x04, 0x49, 0x04, 0x91, 0x07,
-    0xce, 0x08, 0xa8, 0x0a, 0xdb, 0x08, 0x86, 0x06,
-    0xf0, 0x03, 0x08, 0x03, 0xce, 0x07, 0x55, 0x07,
-    0x3b, 0x09, 0x75, 0x08, 0xff, 0x0a, 0xf5, 0x0c,
-    0x5c, 0x0f, 0x65, 0x0e, 0x2f, 0x0f, 0x18, 0x0d,
-    0xcf, 0x09, 0x84, 0x08, 0x81, 0x07, 0x95, 0x08,
-    0xbd, 0x07, 0xff, 0x07, 0x14, 0x06, 0x6b, 0x05,
-    0x67, 0x02, 0x4e, 0x00, 0x36, 0x00, 0x06, 0xfe,
-    0xd8, 0xfb, 0xc2, 0xf9, 0x9a, 0xf9, 0x97, 0xf8,
-    0xd1, 0xf6, 0x42, 0xf4, 0xbe, 0xf2, 0x15, 0xf2,
-    0x10, 0xef, 0x26, 0xeb, 0xa1, 0xe9, 0x1f, 0xe7,
-    0x6e, 0xe5, 0xd9, 0xe2, 0x45, 0xdf, 0x48, 0xde,
-    0x50, 0xdd, 0x68, 0xdc, 0x38, 0xda, 0x22, 0xd8,
-    0xaa, 0xd7, 0xa9, 0xe3, 0xec, 0xef, 0xb2, 0xfa,
-    0x46, 0xfa, 0x48, 0xf3, 0x6a, 0xf5, 0xfe, 0xfb,
-    0x0f, 0x06, 0x4e, 0x0a, 0x40, 0x0a, 0xe3, 0x09,
-    0x4a, 0x0c, 0x7e, 0x0e, 0x18, 0x14, 0x62, 0x19,
-    0xac, 0x1d, 0x2f, 0x1b, 0xd5, 0x13, 0x5a, 0x0e,
-    0xb2, 0x0e, 0x04, 0x11, 0x9c, 0x11, 0xfa, 0x0c,
-    0xbd, 0x0a, 0xc5, 0x0b, 0x54, 0x0b, 0x66, 0x0b,
-    0x2f, 0x08, 0x57, 0x09, 0xd1, 0x08, 0x1c, 0x08,
-    0x5b, 0x04, 0x36, 0x03, 0x27, 0x04, 0x64, 0x05,
-    0x82, 0x06, 0x7c, 0x07, 0xfc, 0x07, 0x8c, 0x07,
-    0xff, 0x05, 0x41, 0x04, 0xac, 0x05, 0xfe, 0x06,
-    0x5e, 0x08, 0xba, 0x07, 0x16, 0x08, 0xb2, 0x08,
-    0xc3, 0x0a, 0xe2, 0x0c, 0x03, 0x0f, 0x1a, 0x0f,
-    0xae, 0x0d, 0x51, 0x0b, 0x7a, 0x08, 0x66, 0x08,
-    0x82, 0x07, 0x12, 0x06, 0x5c, 0x05, 0xd5, 0x02,
-    0x92, 0x01, 0x73, 0x00, 0x08, 0x00, 0xa0, 0xff,
-    0xef, 0xfe, 0x47, 0xfc, 0x50, 0xf9, 0x24, 0xf7,
-    0xb5, 0xf4, 0x55, 0xf4, 0xbf, 0xf2, 0xfd, 0xf2,
-    0xd1, 0xef, 0x79, 0xee, 0xe5, 0xeb, 0x4e, 0xea,
-    0x00, 0xe8, 0x31, 0xe5, 0xf5, 0xe1, 0x4a, 0xdf,
-    0xdc, 0xdd, 0xcb, 0xdb, 0xa3, 0xdc, 0x39, 0xda,
-    0x9a, 0xd9, 0x2f, 0xd9, 0x58, 0xe5, 0x59, 0xf0,
-    0x48, 0xfb, 0xa8, 0xf9, 0x5b, 0xf3, 0xf3, 0xf6,
-    0xee, 0xfc, 0xb3, 0x06, 0x5f, 0x08, 0xac, 0x08,
-    0xf8, 0x07, 0xb3, 0x0b, 0x92, 0x0d, 0x32, 0x12,
-    0x4d, 0x18, 0x15, 0x1d, 0xdb, 0x1a, 0x50, 0x15,
-    0x38, 0x0e, 0x77, 0x0f, 0xfb, 0x12, 0x15, 0x12,
-    0x01, 0x10, 0xb6, 0x0a, 0x1b, 0x0d, 0xc4, 0x0c,
-    0xdc, 0x0c, 0x44, 0x0a, 0x20, 0x0a, 0x0e, 0x0b,
-    0x38, 0x0a, 0x29, 0x07, 0xde, 0x04, 0x4b, 0x05,
-    0xfb, 0x05, 0x21, 0x05, 0x92, 0x05, 0x8d, 0x06,
-    0x8e, 0x07, 0xde, 0x07, 0x75, 0x03, 0x71, 0x05,
-    0x91, 0x06, 0x3b, 0x09, 0x87, 0x08, 0x8c, 0x06,
-    0x1a, 0x07, 0xe8, 0x08, 0x21, 0x0b, 0x7b, 0x0b,
-    0xf0, 0x0c, 0x64, 0x0c, 0xfd, 0x0b, 0xf1, 0x08,
-    0xaa, 0x06, 0x6b, 0x06, 0x93, 0x06, 0xdf, 0x05,
-    0x81, 0x03, 0x9a, 0x00, 0x2a, 0xff, 0xde, 0xff,
-    0x2c, 0x00, 0xc4, 0xff, 0x0f, 0xfe, 0x60, 0xfb,
-    0x34, 0xf9, 0xeb, 0xf5, 0x23, 0xf4, 0x07, 0xf3,
-    0x8c, 0xf2, 0x94, 0xf0, 0xf5, 0xec, 0xea, 0xea,
-    0xec, 0xea, 0x1d, 0xeb, 0x81, 0xe8, 0xe4, 0xe4,
-    0x5a, 0xe1, 0x79, 0xde, 0x83, 0xdd, 0x80, 0xdb,
-    0x1c, 0xda, 0xae, 0xd9, 0x17, 0xd6, 0x8a, 0xdc,
-    0xba, 0xe5, 0xc0, 0xf1, 0x16, 0xf8, 0x33, 0xf4,
-    0xbe, 0xf4, 0x14, 0xf9, 0x15, 0x01, 0xe7, 0x05,
-    0x0c, 0x06, 0x4f, 0x05, 0x1a, 0x08, 0x84, 0x09,
-    0xa8, 0x0b, 0x26, 0x11, 0x46, 0x18, 0x14, 0x1e,
-    0xdc, 0x1c, 0xa5, 0x14, 0xb2, 0x11, 0x90, 0x13,
-    0x4f, 0x16, 0x45, 0x15, 0x9b, 0x0d, 0xd9, 0x0b,
-    0x8a, 0x0c, 0xd5, 0x0d, 0x3a, 0x0d, 0xe0, 0x0b,
-    0xa9, 0x0d, 0xd5, 0x0f, 0xdd, 0x0c, 0x8b, 0x08,
-    0x54, 0x07, 0x7c, 0x07, 0x68, 0x07, 0x0d, 0x05,
-    0x95, 0x03, 0x69, 0x05, 0x33, 0x08, 0x1e, 0x06,
-    0x43, 0x04, 0x27, 0x04, 0xef, 0x06, 0xe3, 0x08,
-    0x1d, 0x08, 0x99, 0x05, 0xb0, 0x05, 0x9f, 0x07,
-    0xa1, 0x08, 0x30, 0x09, 0xda, 0x08, 0xc2, 0x09,
-    0xcd, 0x08, 0xc8, 0x07, 0x77, 0x05, 0x0f, 0x06,
-    0x54, 0x06, 0xe4, 0x05, 0xe1, 0x02, 0x63, 0x00,
-    0x61, 0x00, 0xc2, 0xff, 0xf4, 0xff, 0x16, 0xfe,
-    0xef, 0xfb, 0xe8, 0xfb, 0xe8, 0xf9, 0x0c, 0xf8,
-    0x36, 0xf6, 0x5f, 0xf3, 0x23, 0xf3, 0xd8, 0xf0,
-    0x24, 0xef, 0x1d, 0xed, 0x50, 0xec, 0xfc, 0xeb,
-    0xb3, 0xe9, 0x9b, 0xe6, 0xe6, 0xe3, 0x63, 0xe1,
-    0x55, 0xe1, 0x7a, 0xde, 0x6e, 0xdc, 0xb2, 0xd9,
-    0x80, 0xd7, 0xee, 0xd9, 0x09, 0xe0, 0xef, 0xea,
-    0x86, 0xf0, 0x8e, 0xf2, 0x95, 0xf1, 0x96, 0xf4,
-    0x0b, 0xfd, 0x16, 0x02, 0x28, 0x04, 0xd8, 0x03,
-    0x23, 0x03, 0xb9, 0x05, 0x4e, 0x06, 0x86, 0x0b,
-    0x1d, 0x11, 0x5d, 0x17, 0x4b, 0x1a, 0xef, 0x16,
-    0x82, 0x17, 0x44, 0x17, 0x5b, 0x19, 0xdc, 0x18,
-    0x65, 0x14, 0x05, 0x13, 0x8b, 0x11, 0xfb, 0x10,
-    0xd7, 0x0f, 0xf7, 0x0d, 0x96, 0x10, 0x71, 0x12,
-    0x30, 0x12, 0xdc, 0x0f, 0xff, 0x0c, 0x4c, 0x0d,
-    0x16, 0x0d, 0x8c, 0x0a, 0x9e, 0x07, 0x17, 0x06,
-    0xf2, 0x05, 0xdb, 0x03, 0x24, 0x03, 0xaa, 0x01,
-    0x19, 0x04, 0xbf, 0x05, 0x75, 0x05, 0xbd, 0x05,
-    0xc1, 0x05, 0x18, 0x06, 0x5a, 0x06, 0x94, 0x06,
-    0x75, 0x06, 0xdb, 0x07, 0xb7, 0x06, 0x92, 0x06,
-    0x47, 0x04, 0x07, 0x04, 0x2c, 0x03, 0x41, 0x03,
-    0x20, 0x03, 0xf4, 0x01, 0xb5, 0x01, 0x3a, 0x01,
-    0xdf, 0x00, 0x25, 0xff, 0xf9, 0xfd, 0x1b, 0xfc,
-    0x76, 0xfb, 0x84, 0xf9, 0xa1, 0xf7, 0xca, 0xf5,
-    0x20, 0xf5, 0x77, 0xf4, 0x81, 0xf2, 0x1a, 0xf1,
-    0x99, 0xef, 0xfb, 0xee, 0x32, 0xee, 0xc3, 0xeb,
-    0x94, 0xe8, 0x68, 0xe6, 0x07, 0xe4, 0x1a, 0xe1,
-    0xa9, 0xde, 0x97, 0xdd, 0xa5, 0xdb, 0x57, 0xdc,
-    0x1b, 0xd9, 0x1b, 0xdc, 0x73, 0xe5, 0x72, 0xec,
-    0xde, 0xf2, 0xdd, 0xef, 0x37, 0xf2, 0x0b, 0xf8,
-    0x63, 0xff, 0xb1, 0x01, 0x86, 0x00, 0x61, 0x02,
-    0xa9, 0x05, 0xef, 0x06, 0x78, 0x07, 0x99, 0x09,
-    0x1b, 0x12, 0xb4, 0x19, 0x60, 0x18, 0x10, 0x16,
-    0x0e, 0x14, 0x84, 0x1a, 0xf3, 0x1c, 0x37, 0x1c,
-    0x43, 0x17, 0x3a, 0x15, 0x31, 0x16, 0x89, 0x13,
-    0x57, 0x11, 0xa8, 0x10, 0x1a, 0x13, 0x1e, 0x15,
-    0x57, 0x12, 0xfa, 0x0d, 0xf2, 0x0d, 0xfb, 0x0e,
-    0xe7, 0x0f, 0x2b, 0x0c, 0x35, 0x09, 0x0b, 0x08,
-    0x28, 0x07, 0xf7, 0x04, 0x15, 0x01, 0x14, 0x00,
-    0xb5, 0x01, 0x16, 0x03, 0x52, 0x02, 0x3b, 0x01,
-    0x57, 0x01, 0xa6, 0x03, 0x37, 0x05, 0x7b, 0x05,
-    0xc0, 0x05, 0x04, 0x06, 0x7c, 0x05, 0x8c, 0x02,
-    0xc4, 0x00, 0xaf, 0x00, 0x8a, 0x02, 0x01, 0x03,
-    0xa7, 0x00, 0xe8, 0xfe, 0x7b, 0xff, 0xc0, 0x00,
-    0xff, 0x00, 0xa6, 0xff, 0x27, 0xfe, 0x2c, 0xfe,
-    0x45, 0xfd, 0x7e, 0xfb, 0xc2, 0xf8, 0x0f, 0xf8,
-    0xba, 0xf7, 0x7f, 0xf7, 0x9f, 0xf5, 0xc2, 0xf2,
-    0xcf, 0xf1, 0x85, 0xf1, 0xb3, 0xf0, 0xa7, 0xee,
-    0xa9, 0xeb, 0x05, 0xe9, 0xbb, 0xe6, 0x95, 0xe2,
-    0x62, 0xe0, 0xc3, 0xde, 0xf1, 0xde, 0xe9, 0xdc,
-    0x8e, 0xd9, 0x12, 0xdb, 0xbc, 0xe0, 0x72, 0xe9,
-    0x59, 0xee, 0xb4, 0xee, 0x07, 0xf1, 0x93, 0xf5,
-    0x2d, 0xfb, 0x36, 0xff, 0xf3, 0xff, 0xe3, 0x01,
-    0x2d, 0x03, 0x4e, 0x04, 0x0e, 0x04, 0xbc, 0x06,
-    0x54, 0x0c, 0xf5, 0x11, 0x6a, 0x15, 0x31, 0x15,
-    0x57, 0x16, 0xa9, 0x19, 0x8e, 0x1d, 0x93, 0x1d,
-    0x47, 0x1d, 0x85, 0x1b, 0xdf, 0x1a, 0x12, 0x1a,
-    0xa6, 0x15, 0x49, 0x14, 0x23, 0x14, 0xf5, 0x14,
-    0x6a, 0x14, 0xcf, 0x11, 0x7b, 0x10, 0x85, 0x10,
-    0x7d, 0x11, 0xdb, 0x0f, 0xb5, 0x0d, 0xdc, 0x0b,
-    0xd4, 0x08, 0xa6, 0x05, 0xf9, 0x01, 0x89, 0xff,
-    0x3f, 0xff, 0x4e, 0xff, 0xa0, 0xfd, 0x2e, 0xfd,
-    0xf4, 0xfd, 0xff, 0xfe, 0xdd, 0x00, 0xa9, 0x01,
-    0x2c, 0x02, 0x67, 0x03, 0x34, 0x02, 0x09, 0x00,
-    0x68, 0xff, 0xf2, 0xfe, 0x0d, 0x00, 0xed, 0xfe,
-    0x5f, 0xfd, 0xc2, 0xfc, 0x80, 0xfd, 0xe9, 0xfe,
-    0xf2, 0xfe, 0x8b, 0xff, 0x33, 0x00, 0x18, 0x01,
-    0x5d, 0x00, 0xfe, 0xfe, 0x20, 0xfd, 0xe3, 0xfc,
-    0xed, 0xfb, 0x06, 0xfa, 0x6e, 0xf8, 0x33, 0xf6,
-    0x4e, 0xf5, 0x8f, 0xf3, 0x4c, 0xf2, 0x4a, 0xf1,
-    0x68, 0xf0, 0x58, 0xee, 0x2d, 0xec, 0x46, 0xe9,
-    0xab, 0xe6, 0x3f, 0xe4, 0xa0, 0xe1, 0x67, 0xe0,
-    0xe3, 0xdd, 0x13, 0xdc, 0x98, 0xda, 0x7f, 0xde,
-    0x83, 0xe4, 0xfd, 0xe9, 0x5d, 0xed, 0x1c, 0xee,
-    0x76, 0xf2, 0x1c, 0xf8, 0x0f, 0xfc, 0x26, 0xff,
-    0xe9, 0xff, 0x6f, 0x01, 0x54, 0x03, 0xf7, 0x02,
-    0xa7, 0x04, 0x21, 0x07, 0xf4, 0x0c, 0xaf, 0x10,
-    0xc7, 0x12, 0x91, 0x14, 0x03, 0x17, 0xf1, 0x1b,
-    0xfc, 0x1e, 0x5e, 0x1f, 0x73, 0x1f, 0x1f, 0x1f,
-    0xb1, 0x1d, 0xb8, 0x1b, 0x1a, 0x18, 0x24, 0x17,
-    0x75, 0x17, 0xf8, 0x16, 0x5d, 0x14, 0xf4, 0x11,
-    0x4e, 0x11, 0x9e, 0x11, 0x53, 0x11, 0x4e, 0x0f,
-    0xe7, 0x0c, 0x5a, 0x0b, 0x35, 0x09, 0x7b, 0x05,
-    0x64, 0x02, 0xf1, 0xff, 0x4e, 0xfe, 0x2d, 0xfd,
-    0x29, 0xfb, 0x40, 0xfa, 0xe8, 0xfa, 0x7c, 0xfb,
-    0x35, 0xfc, 0xf3, 0xfc, 0x86, 0xfe, 0xae, 0xff,
-    0xdc, 0xff, 0x9f, 0xfe, 0x73, 0xfd, 0xc3, 0xfd,
-    0xe1, 0xfd, 0x58, 0xfd, 0x49, 0xfc, 0x9f, 0xfb,
-    0x78, 0xfc, 0x01, 0xfd, 0xef, 0xfd, 0x33, 0xfe,
-    0x38, 0xff, 0xf8, 0x00, 0xba, 0x00, 0x48, 0x00,
-    0x7c, 0xff, 0xea, 0xfe, 0xb1, 0xfe, 0x14, 0xfd,
-    0x53, 0xfa, 0x9d, 0xf8, 0xfb, 0xf6, 0x8c, 0xf5,
-    0x3d, 0xf3, 0x05, 0xf2, 0xcd, 0xf0, 0xac, 0xef,
-    0x5c, 0xee, 0x17, 0xeb, 0xeb, 0xe9, 0xb8, 0xe7,
-    0xd4, 0xe5, 0xff, 0xe3, 0x0c, 0xe1, 0x95, 0xde,
-    0x98, 0xdb, 0x58, 0xdd, 0xa4, 0xe1, 0xcb, 0xe6,
-    0x7c, 0xea, 0x93, 0xea, 0x54, 0xee, 0xba, 0xf4,
-    0xdc, 0xf9, 0xbc, 0xfd, 0x7a, 0xfe, 0x4a, 0x00,
-    0x37, 0x03, 0x96, 0x03, 0x94, 0x03, 0x7a, 0x04,
-    0xce, 0x09, 0x28, 0x0e, 0x20, 0x11, 0x9e, 0x11,
-    0xcc, 0x13, 0x62, 0x19, 0x12, 0x1e, 0x26, 0x20,
-    0x13, 0x20, 0x91, 0x21, 0x39, 0x21, 0xd3, 0x1f,
-    0x22, 0x1b, 0x03, 0x18, 0x9a, 0x18, 0x82, 0x18,
-    0x42, 0x16, 0xd8, 0x12, 0xdb, 0x10, 0x63, 0x11,
-    0x30, 0x11, 0xe3, 0x0f, 0xfe, 0x0d, 0xdc, 0x0c,
-    0x31, 0x0b, 0x28, 0x07, 0xab, 0x03, 0x8a, 0x00,
-    0x71, 0xff, 0xe1, 0xfd, 0x72, 0xfb, 0xee, 0xf8,
-    0xb8, 0xf7, 0xec, 0xf7, 0xc8, 0xf8, 0xc6, 0xf9,
-    0xe4, 0xfa, 0x1e, 0xfc, 0x9e, 0xfc, 0x2d, 0xfc,
-    0x34, 0xfb, 0x56, 0xfb, 0xff, 0xfb, 0x31, 0xfc,
-    0xd4, 0xfa, 0xba, 0xf9, 0xb0, 0xf9, 0x47, 0xfa,
-    0x75, 0xfb, 0x14, 0xfc, 0xb4, 0xfd, 0xdf, 0xff,
-    0x7c, 0x00, 0xd5, 0x00, 0x92, 0x00, 0x43, 0x01,
-    0xda, 0x01, 0x05, 0x01, 0x5b, 0xff, 0x22, 0xfd,
-    0xf7, 0xfb, 0x8e, 0xfa, 0x17, 0xf9, 0x9f, 0xf7,
-    0xa6, 0xf6, 0x9a, 0xf5, 0x49, 0xf4, 0xdc, 0xf1,
-    0xdf, 0xef, 0x90, 0xee, 0x01, 0xed, 0x29, 0xea,
-    0x64, 0xe7, 0xfc, 0xe4, 0x0f, 0xe3, 0x0d, 0xe1,
-    0xb7, 0xdd, 0xe9, 0xde, 0x71, 0xe2, 0xde, 0xe8,
-    0xb8, 0xeb, 0xf0, 0xec, 0xea, 0xef, 0xb4, 0xf4,
-    0xb9, 0xfb, 0xf2, 0xfd, 0x9f, 0xfe, 0x05, 0x00,
-    0xff, 0x01, 0xab, 0x03, 0x56, 0x03, 0x95, 0x02,
-    0x28, 0x07, 0x7c, 0x0b, 0xc1, 0x0f, 0x12, 0x10,
-    0xd8, 0x11, 0x2a, 0x17, 0x6f, 0x1b, 0x4b, 0x1f,
-    0x20, 0x1e, 0x80, 0x1f, 0x62, 0x20, 0xca, 0x1f,
-    0x72, 0x1c, 0xe8, 0x18, 0x8a, 0x17, 0x2e, 0x18,
-    0xcf, 0x16, 0x7e, 0x13, 0x7b, 0x10, 0xc5, 0x0f,
-    0xda, 0x10, 0xe4, 0x0f, 0x9b, 0x0e, 0xda, 0x0b,
-    0x52, 0x0b, 0x48, 0x09, 0xef, 0x05, 0xd5, 0x01,
-    0x97, 0xff, 0x5f, 0xfe, 0x85, 0xfc, 0x68, 0xf9,
-    0x47, 0xf6, 0x5b, 0xf6, 0x41, 0xf7, 0x44, 0xf8,
-    0x25, 0xf8, 0x00, 0xf9, 0x39, 0xfa, 0x33, 0xfb,
-    0xd6, 0xfa, 0xa0, 0xf9, 0xc2, 0xf9, 0x52, 0xfa,
-    0x2d, 0xfa, 0xb3, 0xf8, 0x28, 0xf7, 0x4b, 0xf7,
-    0x0d, 0xf9, 0x23, 0xfb, 0xd3, 0xfb, 0xa5, 0xfc,
-    0x6c, 0xfe, 0x55, 0x00, 0xf7, 0x01, 0x80, 0x02,
-    0xb6, 0x02, 0x7e, 0x03, 0x4e, 0x03, 0xfa, 0x01,
-    0x01, 0x00, 0x74, 0xfe, 0x59, 0xfd, 0x70, 0xfc,
-    0x75, 0xfb, 0x76, 0xf9, 0x91, 0xf8, 0x52, 0xf7,
-    0x48, 0xf6, 0xba, 0xf4, 0x3b, 0xf2, 0x73, 0xf0,
-    0x92, 0xee, 0x9a, 0xec, 0xb2, 0xe9, 0xb3, 0xe6,
-    0xf6, 0xe4, 0x6d, 0xe2, 0x83, 0xe1, 0xa6, 0xe2,
-    0x9d, 0xe6, 0x47, 0xec, 0x3a, 0xee, 0x93, 0xef,
-    0x90, 0xf2, 0xa4, 0xf8, 0x6e, 0xfe, 0x5d, 0x00,
-    0x46, 0x00, 0x4f, 0x01, 0xe6, 0x02, 0xdb, 0x03,
-    0x57, 0x02, 0x1a, 0x03, 0xf0, 0x06, 0x70, 0x0b,
-    0x89, 0x0e, 0xfd, 0x0e, 0x52, 0x11, 0xba, 0x15,
-    0xbf, 0x1a, 0xd8, 0x1c, 0xfb, 0x1d, 0x09, 0x1e,
-    0x30, 0x1f, 0xa1, 0x1d, 0xd1, 0x1a, 0xff, 0x17,
-    0xf1, 0x16, 0xf9, 0x16, 0xab, 0x14, 0xd5, 0x11,
-    0x51, 0x0f, 0x0c, 0x0f, 0x0f, 0x0f, 0xd5, 0x0e,
-    0x3e, 0x0d, 0x69, 0x0c, 0x4d, 0x0a, 0x2d, 0x08,
-    0xd3, 0x04, 0x53, 0x02, 0x14, 0x00, 0x21, 0xfe,
-    0xea, 0xfb, 0xf4, 0xf8, 0xc6, 0xf6, 0x53, 0xf5,
-    0xd5, 0xf5, 0xdf, 0xf6, 0x36, 0xf8, 0xa9, 0xf8,
-    0xaa, 0xf8, 0x72, 0xf8, 0x72, 0xf8, 0x4b, 0xf8,
-    0xc2, 0xf8, 0x2e, 0xf8, 0xc4, 0xf7, 0xd1, 0xf6,
-    0x88, 0xf6, 0xfd, 0xf6, 0x29, 0xf8, 0xaa, 0xf9,
-    0x8b, 0xfb, 0x88, 0xfd, 0x2f, 0xff, 0x62, 0x00,
-    0x8a, 0x01, 0x5e, 0x03, 0x6b, 0x04, 0xfa, 0x04,
-    0xb0, 0x03, 0x02, 0x03, 0x53, 0x02, 0x64, 0x01,
-    0x4c, 0xff, 0x38, 0xfe, 0xe0, 0xfd, 0xab, 0xfd,
-    0x31, 0xfc, 0x12, 0xf9, 0x25, 0xf8, 0x7e, 0xf7,
-    0xcb, 0xf6, 0xfe, 0xf3, 0x12, 0xf1, 0x46, 0xef,
-    0x52, 0xed, 0x23, 0xeb, 0x70, 0xe8, 0xf0, 0xe5,
-    0x9a, 0xe4, 0xb6, 0xe3, 0x62, 0xe5, 0xa2, 0xea,
-    0x56, 0xee, 0x98, 0xf1, 0x3b, 0xf2, 0x9f, 0xf5,
-    0x93, 0xfa, 0x28, 0xfe, 0x40, 0x00, 0x25, 0x00,
-    0x1b, 0x02, 0x28, 0x02, 0x0d, 0x02, 0xc4, 0x01,
-    0x89, 0x03, 0x50, 0x07, 0x43, 0x0b, 0x8a, 0x0d,
-    0xee, 0x0f, 0x06, 0x12, 0x79, 0x15, 0xa4, 0x18,
-    0x77, 0x1b, 0x3a, 0x1d, 0xf8, 0x1c, 0x44, 0x1d,
-    0x3e, 0x1a, 0xa1, 0x18, 0xce, 0x15, 0x4f, 0x14,
-    0xc0, 0x13, 0x1d, 0x12, 0x9b, 0x10, 0xcc, 0x0e,
-    0xea, 0x0d, 0x16, 0x0e, 0xe3, 0x0d, 0xb8, 0x0d,
-    0x37, 0x0c, 0xe3, 0x09, 0xf0, 0x07, 0x59, 0x04,
-    0xf7, 0x01, 0x2c, 0xff, 0xe3, 0xfc, 0x9c, 0xfb,
-    0x51, 0xf9, 0xe8, 0xf6, 0x5a, 0xf5, 0xf2, 0xf4,
-    0x87, 0xf6, 0xa0, 0xf7, 0x1c, 0xf8, 0xe2, 0xf7,
-    0xe5, 0xf7, 0x71, 0xf8, 0x1e, 0xf8, 0xef, 0xf7,
-    0xd7, 0xf7, 0xbb, 0xf7, 0xe3, 0xf7, 0x5f, 0xf7,
-    0x01, 0xf7, 0x9a, 0xf8, 0xaa, 0xfa, 0x74, 0xfd,
-    0x3d, 0xff, 0x99, 0x00, 0x2a, 0x02, 0x35, 0x04,
-    0x99, 0x05, 0xa4, 0x05, 0xd5, 0x05, 0x5f, 0x05,
-    0x43, 0x05, 0x93, 0x03, 0xd3, 0x01, 0xa9, 0x00,
-    0x74, 0x00, 0x70, 0x00, 0x1c, 0xff, 0xf8, 0xfd,
-    0x8a, 0xfc, 0x7d, 0xfb, 0x74, 0xfa, 0x65, 0xf8,
-    0x98, 0xf5, 0x00, 0xf4, 0x50, 0xf1, 0x06, 0xef,
-    0xf7, 0xea, 0xe0, 0xe7, 0x41, 0xe7, 0x69, 0xe6,
-    0x6a, 0xe4, 0xd5, 0xe1, 0xa6, 0xe3, 0x0d, 0xe9,
-    0x9d, 0xee, 0xec, 0xef, 0xf7, 0xf0, 0x93, 0xf3,
-    0x7b, 0xf9, 0xc4, 0xfc, 0x8c, 0xfd, 0x7a, 0xfe,
-    0x03, 0x00, 0x31, 0x02, 0xdc, 0x01, 0xe6, 0x00,
-    0xdf, 0x02, 0x77, 0x07, 0x36, 0x0b, 0x9b, 0x0d,
-    0x15, 0x0e, 0x9d, 0x11, 0x90, 0x15, 0x2f, 0x19,
-    0x25, 0x1a, 0xa8, 0x1a, 0xba, 0x1b, 0xe6, 0x1b,
-    0x28, 0x1a, 0x86, 0x16, 0x13, 0x14, 0x9e, 0x13,
-    0x1d, 0x14, 0x57, 0x12, 0x54, 0x10, 0xd6, 0x0e,
-    0x71, 0x0f, 0xb5, 0x0f, 0xc8, 0x0e, 0xc8, 0x0c,
-    0x14, 0x0c, 0xf2, 0x0a, 0x38, 0x08, 0x36, 0x04,
-    0x70, 0x00, 0xbd, 0xfe, 0x81, 0xfd, 0x7a, 0xfb,
-    0x2a, 0xf8, 0xa6, 0xf6, 0xe8, 0xf5, 0xae, 0xf6,
-    0xd7, 0xf6, 0x06, 0xf7, 0xfd, 0xf7, 0x85, 0xf8,
-    0x94, 0xf8, 0x35, 0xf7, 0x88, 0xf6, 0xe1, 0xf6,
-    0x99, 0xf7, 0xfe, 0xf7, 0x3d, 0xf7, 0x4b, 0xf6,
-    0x7b, 0xf7, 0x58, 0xf9, 0xd5, 0xfb, 0xef, 0xfd,
-    0xd6, 0xff, 0xe2, 0x02, 0xe0, 0x04, 0xc8, 0x05,
-    0xaf, 0x05, 0xa4, 0x06, 0x5e, 0x07, 0x24, 0x07,
-    0xe4, 0x05, 0x87, 0x04, 0x19, 0x04, 0x58, 0x03,
-    0x8c, 0x02, 0xb1, 0x01, 0x6c, 0x01, 0x8d, 0x00,
-    0x22, 0xff, 0x66, 0xfd, 0x76, 0xfb, 0x9f, 0xf9,
-    0xc8, 0xf7, 0x33, 0xf5, 0x48, 0xf2, 0x34, 0xef,
-    0x37, 0xec, 0xfe, 0xe9, 0xbd, 0xe7, 0xa9, 0xe6,
-    0x5a, 0xe5, 0x0d, 0xe4, 0x4f, 0xe2, 0xee, 0xe1,
-    0xf2, 0xe5, 0x89, 0xea, 0xf3, 0xee, 0xeb, 0xf0,
-    0x24, 0xf2, 0xf3, 0xf5, 0x46, 0xf9, 0x22, 0xfc,
-    0xc8, 0xfd, 0x4d, 0xfe, 0xa9, 0x00, 0x6a, 0x01,
-    0xe7, 0x01, 0x21, 0x03, 0xad, 0x04, 0xf1, 0x09,
-    0x22, 0x0d, 0x64, 0x0f, 0x78, 0x11, 0xa8, 0x12,
-    0x3d, 0x16, 0x23, 0x18, 0x1f, 0x19, 0x10, 0x1a,
-    0x35, 0x19, 0x56, 0x18, 0x0e, 0x16, 0x77, 0x13,
-    0xb5, 0x12, 0x12, 0x12, 0x58, 0x12, 0xf0, 0x11,
-    0x80, 0x10, 0xf5, 0x0f, 0x90, 0x0e, 0xcd, 0x0d,
-    0x52, 0x0d, 0x71, 0x0c, 0x48, 0x0b, 0x5c, 0x08,
-    0xd0, 0x04, 0xd0, 0x01, 0x5f, 0xff, 0x63, 0xfd,
-    0x47, 0xfb, 0x04, 0xfa, 0x5f, 0xf9, 0x57, 0xf8,
-    0xf1, 0xf7, 0x2d, 0xf7, 0x04, 0xf8, 0x0c, 0xf9,
-    0x41, 0xf9, 0x5d, 0xf9, 0x21, 0xf8, 0x89, 0xf7,
-    0x1d, 0xf7, 0x02, 0xf7, 0x02, 0xf8, 0xdf, 0xf7,
-    0x95, 0xf8, 0x30, 0xf9, 0x24, 0xfa, 0xd4, 0xfc,
-    0x75, 0xfe, 0xf1, 0x00, 0x3b, 0x03, 0xc4, 0x04,
-    0x29, 0x06, 0x51, 0x06, 0x7e, 0x06, 0x13, 0x07,
-    0x3d, 0x07, 0x28, 0x07, 0x25, 0x06, 0x33, 0x05,
-    0x16, 0x04, 0x4c, 0x03, 0x26, 0x03, 0xaa, 0x02,
-    0xf3, 0x01, 0xc6, 0x00, 0x81, 0xff, 0xb0, 0xfd,
-    0x54, 0xfb, 0x9e, 0xf8, 0xe9, 0xf5, 0x41, 0xf4,
-    0x57, 0xf1, 0x6e, 0xee, 0x71, 0xeb, 0xa3, 0xe8,
-    0x3b, 0xe7, 0xe7, 0xe5, 0x61, 0xe5, 0xed, 0xe4,
-    0xf1, 0xe4, 0xe3, 0xe3, 0x31, 0xe3, 0x09, 0xe4,
-    0xfc, 0xe8, 0xae, 0xee, 0xbb, 0xf2, 0x19, 0xf2,
-    0xf4, 0xf2, 0x21, 0xf7, 0xf2, 0xfb, 0x02, 0xff,
-    0x72, 0xfe, 0xab, 0x00, 0xa5, 0x02, 0x15, 0x05,
-    0xe9, 0x03, 0xe4, 0x04, 0x91, 0x08, 0xc6, 0x0d,
-    0xaa, 0x10, 0xd7, 0x11, 0x1d, 0x12, 0xcc, 0x14,
-    0xa8, 0x17, 0x00, 0x18, 0x29, 0x18, 0x88, 0x16,
-    0xbd, 0x17, 0xce, 0x15, 0x4f, 0x14, 0xe5, 0x10,
-    0x58, 0x11, 0xce, 0x12, 0x14, 0x13, 0xcd, 0x11,
-    0xac, 0x0f, 0x35, 0x0f, 0x1d, 0x0f, 0x51, 0x0e,
-    0x01, 0x0c, 0x9a, 0x0a, 0xc8, 0x08, 0x24, 0x07,
-    0xc1, 0x02, 0x0a, 0x00, 0x5c, 0xfd, 0xb1, 0xfd,
-    0x01, 0xfd, 0xd7, 0xfa, 0x61, 0xf9, 0xc2, 0xf8,
-    0x90, 0xf9, 0x59, 0xfa, 0x25, 0xfa, 0xcb, 0xf9,
-    0x01, 0xfa, 0x7c, 0xf9, 0x5c, 0xf8, 0xc6, 0xf6,
-    0xca, 0xf6, 0xf0, 0xf7, 0x65, 0xf9, 0x30, 0xf9,
-    0x6b, 0xf9, 0xdc, 0xfa, 0xa6, 0xfe, 0x7e, 0x00,
-    0x6e, 0x02, 0x8b, 0x03, 0x4d, 0x05, 0xe6, 0x06,
-    0xb0, 0x06, 0x64, 0x06, 0xd3, 0x06, 0x37, 0x07,
-    0xa2, 0x06, 0xca, 0x05, 0x59, 0x04, 0xa0, 0x04,
-    0x00, 0x04, 0xea, 0x03, 0x25, 0x02, 0xf4, 0x01,
-    0x5a, 0x01, 0xb4, 0x00, 0x06, 0xff, 0x14, 0xfc,
-    0xec, 0xf9, 0x73, 0xf7, 0x37, 0xf5, 0x62, 0xf1,
-    0xf0, 0xee, 0x89, 0xec, 0x4c, 0xeb, 0x34, 0xea,
-    0x90, 0xe8, 0x98, 0xe7, 0x81, 0xe7, 0x77, 0xe7,
-    0x59, 0xe7, 0xed, 0xe5, 0x44, 0xe3, 0xcb, 0xe2,
-    0x5f, 0xe4, 0x90, 0xea, 0x96, 0xef, 0x44, 0xf3,
-    0xce, 0xf4, 0x69, 0xf6, 0x96, 0xfb, 0xe7, 0xfe,
-    0x0d, 0x02, 0x7b, 0x03, 0xdc, 0x04, 0x27, 0x06,
-    0x7b, 0x06, 0x1b, 0x06, 0xcb, 0x08, 0xc7, 0x0b,
-    0xab, 0x0f, 0xf7, 0x11, 0x6d, 0x13, 0x95, 0x15,
-    0xcc, 0x16, 0x02, 0x19, 0x37, 0x19, 0x56, 0x19,
-    0x2b, 0x18, 0xf7, 0x16, 0x8a, 0x14, 0x43, 0x13,
-    0x9f, 0x11, 0xbd, 0x11, 0x88, 0x11, 0x10, 0x10,
-    0xc4, 0x0f, 0x33, 0x0f, 0x6e, 0x0e, 0x26, 0x0d,
-    0x66, 0x0b, 0x7f, 0x0a, 0x37, 0x09, 0xd6, 0x05,
-    0xea, 0x02, 0x7a, 0xff, 0xc7, 0xfd, 0x09, 0xfc,
-    0xfe, 0xfa, 0x5b, 0xfb, 0xcb, 0xfa, 0xd7, 0xfa,
-    0x9c, 0xfa, 0x64, 0xfa, 0x31, 0xfb, 0x59, 0xfb,
-    0x15, 0xfc, 0xf7, 0xfb, 0x8e, 0xfa, 0x2e, 0xf9,
-    0xc7, 0xf8, 0x94, 0xf9, 0x67, 0xfa, 0xf0, 0xfa,
-    0x61, 0xfc, 0x05, 0xfe, 0x91, 0x00, 0x4d, 0x02,
-    0xd7, 0x03, 0x22, 0x06, 0xad, 0x07, 0x1b, 0x09,
-    0x2d, 0x09, 0xa2, 0x08, 0x0d, 0x08, 0xfb, 0x07,
-    0x98, 0x07, 0x3c, 0x07, 0x76, 0x06, 0xf0, 0x05,
-    0x39, 0x05, 0x7d, 0x04, 0x99, 0x03, 0x5c, 0x02,
-    0x87, 0x01, 0x44, 0x00, 0xaf, 0xfe, 0xca, 0xfc,
-    0x1f, 0xfa, 0x6f, 0xf7, 0xed, 0xf4, 0x5a, 0xf2,
-    0xcb, 0xef, 0xa8, 0xed, 0x70, 0xeb, 0xcc, 0xe9,
-    0xed, 0xe7, 0xe9, 0xe6, 0x80, 0xe6, 0xb1, 0xe6,
-    0x26, 0xe6, 0x3e, 0xe5, 0xab, 0xe4, 0x9b, 0xe3,
-    0x39, 0xe2, 0x69, 0xdf, 0x8f, 0xe1, 0xaa, 0xe7,
-    0x4e, 0xf0, 0x39, 0xf5, 0xf1, 0xf5, 0x8e, 0xf7,
-    0x01, 0xfd, 0x0a, 0x02, 0xb9, 0x05, 0x8c, 0x05,
-    0xf2, 0x05, 0xb3, 0x07, 0x73, 0x07, 0x82, 0x09,
-    0xb8, 0x0a, 0xe9, 0x0f, 0x1f, 0x15, 0x65, 0x18,
-    0xc1, 0x19, 0x40, 0x1a, 0x74, 0x1a, 0x2a, 0x1c,
-    0x9a, 0x1a, 0xa9, 0x18, 0x89, 0x16, 0xf4, 0x14,
-    0xd9, 0x13, 0x93, 0x10, 0x8d, 0x0f, 0xb1, 0x0f,
-    0xcc, 0x11, 0x35, 0x12, 0xe0, 0x10, 0xf3, 0x0e,
-    0x3c, 0x0d, 0x80, 0x0a, 0xa4, 0x07, 0x5d, 0x04,
-    0x45, 0x02, 0x75, 0x00, 0xda, 0xfe, 0xec, 0xfc,
-    0x71, 0xfb, 0xff, 0xfb, 0x2d, 0xfc, 0xcf, 0xfc,
-    0x32, 0xfc, 0x2c, 0xfb, 0x3e, 0xfb, 0x70, 0xfa,
-    0xb8, 0xf9, 0xa8, 0xf9, 0x05, 0xfa, 0xb6, 0xfb,
-    0x3f, 0xfc, 0x3b, 0xfc, 0x04, 0xfd, 0x44, 0xfe,
-    0x02, 0x01, 0x5e, 0x02, 0xea, 0x02, 0x2b, 0x04,
-    0xd4, 0x05, 0x2b, 0x08, 0xd6, 0x08, 0xc3, 0x08,
-    0xd7, 0x09, 0x9d, 0x0b, 0x6f, 0x0c, 0xc0, 0x0b,
-    0xd6, 0x09, 0xa6, 0x09, 0x8e, 0x09, 0x99, 0x08,
-    0xf9, 0x06, 0x0b, 0x05, 0x25, 0x04, 0x2a, 0x03,
-    0x17, 0x01, 0xee, 0xfe, 0x9e, 0xfd, 0xca, 0xfc,
-    0xb2, 0xfb, 0x9d, 0xf8, 0x79, 0xf5, 0x30, 0xf3,
-    0xf0, 0xf1, 0x16, 0xf0, 0x71, 0xec, 0x61, 0xe9,
-    0xe4, 0xe6, 0xf2, 0xe4, 0xe9, 0xe2, 0x6c, 0xe0,
-    0x2d, 0xe0, 0x62, 0xe0, 0x2a, 0xe1, 0xa3, 0xe0,
-    0x9c, 0xdf, 0xe7, 0xdf, 0xe3, 0xdf, 0xa8, 0xde,
-    0x4d, 0xdc, 0xda, 0xda, 0xe2, 0xe1, 0x1a, 0xee,
-    0xa9, 0xf7, 0xaf, 0xfc, 0xfd, 0xfc, 0x58, 0x02,
-    0x74, 0x09, 0xd6, 0x0c, 0x10, 0x0c, 0xa4, 0x0b,
-    0x2e, 0x0e, 0xe4, 0x10, 0x85, 0x10, 0xbe, 0x11,
-    0xd3, 0x17, 0xc7, 0x20, 0xd0, 0x26, 0x99, 0x24,
-    0x87, 0x21, 0x39, 0x1f, 0x7c, 0x1e, 0xa7, 0x1b,
-    0x24, 0x16, 0xd3, 0x11, 0x1d, 0x11, 0xa1, 0x10,
-    0x2b, 0x0e, 0x51, 0x0c, 0x3b, 0x0d, 0xc9, 0x0f,
-    0xfc, 0x0e, 0xf9, 0x0a, 0x33, 0x05, 0x72, 0x02,
-    0x53, 0xff, 0xb2, 0xfb, 0x42, 0xf9, 0xed, 0xf8,
-    0xb6, 0xfa, 0x36, 0xfb, 0xcf, 0xfa, 0x27, 0xfa,
-    0x89, 0xfb, 0x69, 0xfd, 0xaf, 0xfc, 0x6a, 0xfa,
-    0xdb, 0xf8, 0x67, 0xf8, 0xc2, 0xf9, 0xe5, 0xf9,
-    0x4e, 0xfb, 0x9c, 0x00, 0x9e, 0x05, 0x79, 0x08,
-    0x37, 0x07, 0x78, 0x06, 0x04, 0x08, 0xf2, 0x08,
-    0x25, 0x09, 0x95, 0x07, 0xcf, 0x08, 0x13, 0x0b,
-    0x86, 0x0c, 0x01, 0x0e, 0xa1, 0x0f, 0x87, 0x11,
-    0x95, 0x12, 0x6e, 0x10, 0xa8, 0x0c, 0x9e, 0x09,
-    0xa3, 0x06, 0x35, 0x05, 0xd7, 0x02, 0x8b, 0x01,
-    0xcf, 0x00, 0x02, 0x01, 0x4c, 0x00, 0x5b, 0xfe,
-    0xe7, 0xfc, 0x25, 0xfb, 0x44, 0xf9, 0x41, 0xf5,
-    0x3d, 0xf1, 0x92, 0xee, 0x4c, 0xee, 0x9a, 0xed,
-    0xb1, 0xed, 0x6a, 0xee, 0x6a, 0xee, 0x81, 0xed,
-    0xc8, 0xe8, 0x56, 0xe5, 0x92, 0xe2, 0x95, 0xe1,
-    0x5c, 0xdf, 0xa9, 0xdc, 0xaa, 0xdb, 0x5f, 0xdc,
-    0xfb, 0xde, 0x29, 0xe0, 0xef, 0xe0, 0x11, 0xe2,
-    0xdd, 0xe4, 0xed, 0xe3, 0xd6, 0xe1, 0x70, 0xe0,
-    0x65, 0xe8, 0x04, 0xf5, 0x5f, 0xff, 0x7b, 0x02,
-    0xc5, 0x03, 0x47, 0x0a, 0x1b, 0x0e, 0x21, 0x10,
-    0x37, 0x0e, 0xca, 0x10, 0xb8, 0x16, 0xdb, 0x17,
-    0x0b, 0x15, 0xcd, 0x16, 0x73, 0x1d, 0xa1, 0x25,
-    0x9f, 0x25, 0x0a, 0x21, 0xe8, 0x1d, 0x0a, 0x1c,
-    0x85, 0x1a, 0x39, 0x15, 0x8b, 0x12, 0xa5, 0x12,
-    0x9a, 0x12, 0xfc, 0x10, 0xb7, 0x0c, 0xc7, 0x09,
-    0xd2, 0x0a, 0x4a, 0x0b, 0xc5, 0x08, 0x75, 0x03,
-    0x9c, 0xff, 0x41, 0xfd, 0x94, 0xfc, 0xe5, 0xfa,
-    0xe9, 0xfa, 0xc0, 0xfd, 0x42, 0xff, 0x19, 0xfd,
-    0x42, 0xfa, 0x7c, 0xf9, 0x23, 0xfb, 0xf6, 0xfc,
-    0x77, 0xfc, 0x62, 0xfb, 0xb3, 0xfb, 0x9c, 0xfd,
-    0xb2, 0xfe, 0xb4, 0x00, 0xd2, 0x01, 0x91, 0x04,
-    0xed, 0x06, 0xa8, 0x06, 0xab, 0x04, 0x9e, 0x04,
-    0x03, 0x07, 0x4a, 0x09, 0x9e, 0x09, 0x4a, 0x09,
-    0x8a, 0x0a, 0x82, 0x0c, 0xe2, 0x0c, 0x34, 0x0b,
-    0x1d, 0x0b, 0x8b, 0x0b, 0x65, 0x0b, 0xe5, 0x08,
-    0xe3, 0x05, 0xce, 0x03, 0xc6, 0x03, 0x2c, 0x03,
-    0x0d, 0x01, 0x8a, 0xff, 0x6e, 0xfe, 0x5b, 0xfd,
-    0x09, 0xfb, 0x21, 0xf8, 0x63, 0xf6, 0x9b, 0xf5,
-    0x13, 0xf4, 0xf9, 0xf1, 0x37, 0xf0, 0x59, 0xef,
-    0xf7, 0xee, 0xf3, 0xee, 0x75, 0xee, 0x28, 0xed,
-    0x49, 0xec, 0x96, 0xeb, 0xec, 0xe9, 0x69, 0xe7,
-    0x62, 0xe4, 0xb3, 0xe4, 0xb5, 0xe5, 0x55, 0xe4,
-    0xb0, 0xe2, 0x26, 0xe1, 0xdc, 0xe1, 0x38, 0xe3,
-    0xe8, 0xe2, 0x9b, 0xe3, 0x70, 0xe4, 0xa7, 0xe4,
-    0x79, 0xe5, 0x5b, 0xe3, 0xb3, 0xe4, 0xbb, 0xea,
-    0x72, 0xf6, 0x38, 0x03, 0xf4, 0x05, 0xa5, 0x06,
-    0xdd, 0x07, 0x73, 0x0a, 0x04, 0x0e, 0x0c, 0x0e,
-    0x1b, 0x11, 0x28, 0x17, 0x14, 0x18, 0x2f, 0x18,
-    0xf1, 0x19, 0xe3, 0x1f, 0x1f, 0x26, 0x2d, 0x26,
-    0x0e, 0x23, 0x16, 0x1d, 0x5d, 0x19, 0x3c, 0x16,
-    0x41, 0x14, 0xc5, 0x15, 0xdf, 0x16, 0xc6, 0x17,
-    0x43, 0x16, 0xbf, 0x10, 0x9b, 0x0b, 0x0a, 0x09,
-    0x61, 0x08, 0xc0, 0x06, 0xf6, 0x02, 0x46, 0x00,
-    0x61, 0xfe, 0x6a, 0xfe, 0x5c, 0xfe, 0x49, 0xfe,
-    0x0f, 0x01, 0x6c, 0x02, 0xb1, 0xff, 0x15, 0xfb,
-    0x9b, 0xf6, 0xd6, 0xf5, 0xb3, 0xf9, 0x1e, 0xfd,
-    0x6b, 0xff, 0x21, 0x01, 0x18, 0x02, 0x89, 0x01,
-    0xbf, 0x00, 0x8e, 0x00, 0x2e, 0x02, 0x25, 0x05,
-    0x3e, 0x05, 0x0f, 0x02, 0x39, 0x01, 0x5b, 0x04,
-    0x7b, 0x09, 0x51, 0x0d, 0xc8, 0x0b, 0x83, 0x0a,
-    0x32, 0x0a, 0x2b, 0x09, 0x4f, 0x06, 0x62, 0x04,
-    0x57, 0x06, 0xe4, 0x08, 0xb8, 0x08, 0xd8, 0x05,
-    0xa7, 0x03, 0xb9, 0x03, 0x13, 0x03, 0x42, 0x00,
-    0x85, 0xfd, 0xfa, 0xfa, 0xdf, 0xf9, 0xe6, 0xf7,
-    0x4d, 0xf6, 0x00, 0xf6, 0xa4, 0xf6, 0xeb, 0xf7,
-    0x70, 0xf6, 0x0c, 0xf3, 0xe7, 0xef, 0xca, 0xee,
-    0xb4, 0xee, 0x0a, 0xee, 0xbc, 0xed, 0x05, 0xef,
-    0x7b, 0xf0, 0x81, 0xf0, 0x7f, 0xee, 0x13, 0xed,
-    0xa8, 0xed, 0x03, 0xed, 0x37, 0xeb, 0x00, 0xe9,
-    0xd8, 0xe7, 0x87, 0xe7, 0x65, 0xe8, 0xad, 0xe8,
-    0xc9, 0xe9, 0x6e, 0xea, 0xf6, 0xe8, 0x9b, 0xe7,
-    0xa9, 0xe6, 0xdd, 0xe5, 0xc5, 0xe4, 0xdf, 0xe7,
-    0xd1, 0xf0, 0x51, 0xfd, 0x8d, 0x05, 0x07, 0x08,
-    0x41, 0x06, 0xd5, 0x06, 0x46, 0x07, 0xd9, 0x06,
-    0xd6, 0x0a, 0xef, 0x10, 0x8a, 0x15, 0xfd, 0x17,
-    0xbb, 0x18, 0xf3, 0x1b, 0xdc, 0x22, 0x47, 0x23,
-    0xaa, 0x20, 0xe0, 0x1c, 0x7c, 0x1a, 0xf0, 0x18,
-    0x5a, 0x18, 0x95, 0x18, 0xda, 0x1a, 0xaa, 0x1d,
-    0x6f, 0x1c, 0x2f, 0x17, 0x30, 0x12, 0x2f, 0x0e,
-    0xf7, 0x0a, 0x8e, 0x09, 0x14, 0x06, 0xa8, 0x05,
-    0xe6, 0x04, 0x03, 0x05, 0x9d, 0x03, 0x8d, 0x02,
-    0xb4, 0x02, 0x74, 0x01, 0x02, 0xff, 0x13, 0xfb,
-    0xf8, 0xf6, 0x73, 0xf7, 0x5d, 0xfa, 0x1b, 0xfc,
-    0xd6, 0xfe, 0xf8, 0xfe, 0x7b, 0xff, 0x9e, 0xfd,
-    0x18, 0xfc, 0x71, 0xfb, 0x27, 0xfd, 0x34, 0xff,
-    0x47, 0xff, 0x22, 0x00, 0xb6, 0x01, 0xc6, 0x02,
-    0x63, 0x04, 0x88, 0x05, 0x18, 0x06, 0x4d, 0x06,
-    0xcb, 0x04, 0xb9, 0x03, 0x26, 0x04, 0x09, 0x06,
-    0x75, 0x07, 0x07, 0x09, 0x86, 0x08, 0xb8, 0x07,
-    0x39, 0x06, 0x31, 0x04, 0x0f, 0x02, 0xaa, 0x00,
-    0x16, 0xff, 0x2b, 0xff, 0x06, 0xfe, 0x32, 0xfd,
-    0xed, 0xfc, 0x92, 0xfb, 0xf8, 0xfa, 0x4b, 0xf8,
-    0x8c, 0xf6, 0x6d, 0xf3, 0x60, 0xf2, 0xca, 0xf1,
-    0xfc, 0xf1, 0x0d, 0xf3, 0x3b, 0xf3, 0x8f, 0xf2,
-    0x8a, 0xf2, 0xe9, 0xf0, 0x11, 0xef, 0xf1, 0xee,
-    0x87, 0xed, 0xaa, 0xee, 0xb2, 0xef, 0x57, 0xf0,
-    0x1b, 0xf0, 0x29, 0xef, 0x49, 0xef, 0x1c, 0xef,
-    0x8f, 0xee, 0xaf, 0xeb, 0x8d, 0xe8, 0x6a, 0xe9,
-    0x73, 0xe9, 0x30, 0xea, 0xb8, 0xea, 0x37, 0xeb,
-    0xe5, 0xea, 0x0c, 0xea, 0x1b, 0xed, 0xfd, 0xf8,
-    0xcf, 0x04, 0x94, 0x09, 0xfe, 0x04, 0x15, 0x00,
-    0x77, 0x03, 0x2f, 0x04, 0x6d, 0x09, 0xbe, 0x0e,
-    0x9a, 0x16, 0x84, 0x1b, 0x78, 0x18, 0x76, 0x15,
-    0x4f, 0x19, 0xd9, 0x1d, 0x3e, 0x1e, 0x41, 0x1c,
-    0xb8, 0x19, 0xf4, 0x19, 0x2a, 0x19, 0x70, 0x1b,
-    0xd3, 0x1c, 0x8e, 0x20, 0x25, 0x1e, 0x50, 0x18,
-    0x70, 0x12, 0x17, 0x0c, 0x30, 0x0a, 0x4c, 0x0b,
-    0x7c, 0x0d, 0x9f, 0x0d, 0x67, 0x0b, 0xb2, 0x08,
-    0x94, 0x06, 0x37, 0x03, 0xbf, 0x00, 0x1e, 0xfe,
-    0x00, 0xfe, 0xc4, 0xfb, 0xf3, 0xf8, 0x9d, 0xf7,
-    0x4e, 0xf9, 0xae, 0xfc, 0xa1, 0xfe, 0x04, 0xfe,
-    0x73, 0xfb, 0x5c, 0xf7, 0xa9, 0xf4, 0x61, 0xf4,
-    0x6f, 0xf6, 0x2a, 0xfb, 0xbd, 0xfd, 0x17, 0xff,
-    0x7e, 0xfe, 0xb1, 0xfd, 0xae, 0xfc, 0x92, 0xfd,
-    0xab, 0xfe, 0x00, 0x00, 0x28, 0x00, 0x49, 0x00,
-    0x86, 0x01, 0xbc, 0x03, 0xf2, 0x05, 0x74, 0x06,
-    0x3c, 0x06, 0xc0, 0x04, 0x63, 0x01, 0xbd, 0xfe,
-    0xb7, 0xfe, 0x04, 0x00, 0x4e, 0x02, 0xcd, 0x02,
-    0x16, 0x02, 0x85, 0x00, 0xa7, 0xfe, 0x16, 0xfc,
-    0x66, 0xfa, 0x92, 0xf9, 0x96, 0xf8, 0x88, 0xf7,
-    0x21, 0xf7, 0x68, 0xf6, 0xa3, 0xf6, 0xfc, 0xf7,
-    0xbb, 0xf7, 0xc2, 0xf6, 0x12, 0xf5, 0xb0, 0xf2,
-    0x6a, 0xf1, 0x38, 0xf2, 0x11, 0xf4, 0xcf, 0xf5,
-    0xc7, 0xf7, 0x32, 0xf7, 0x1c, 0xf5, 0xd0, 0xf2,
-    0x45, 0xf0, 0x2a, 0xef, 0xc1, 0xf0, 0x0d, 0xf2,
-    0x06, 0xf1, 0x28, 0xf2, 0xd9, 0xf0, 0x45, 0xf2,
-    0xd3, 0xf0, 0xa1, 0xee, 0x49, 0xec, 0xaa, 0xea,
-    0x4f, 0xea, 0xe1, 0xe8, 0x56, 0xeb, 0x63, 0xf4,
-    0x92, 0x02, 0x6e, 0x09, 0xec, 0x09, 0xf8, 0x00,
-    0xc5, 0xfe, 0x37, 0xff, 0xb8, 0x00, 0xf3, 0x04,
-    0xc6, 0x0c, 0x34, 0x16, 0x5c, 0x19, 0xc2, 0x18,
-    0xe2, 0x15, 0x62, 0x19, 0xfc, 0x18, 0x3f, 0x17,
-    0xc5, 0x14, 0x21, 0x16, 0x01, 0x1a, 0x5b, 0x1d,
-    0x30, 0x1f, 0xde, 0x1e, 0xbd, 0x1e, 0xbb, 0x1a,
-    0x39, 0x15, 0xa0, 0x0e, 0x0f, 0x0b, 0x22, 0x0c,
-    0x1d, 0x0f, 0xbc, 0x0f, 0xa9, 0x0d, 0x44, 0x0b,
-    0xa9, 0x07, 0x8c, 0x03, 0xca, 0xfd, 0x6d, 0xfa,
-    0x00, 0xfb, 0x28, 0xfb, 0x2f, 0xfc, 0xaf, 0xfa,
-    0x18, 0xfa, 0xea, 0xf8, 0x02, 0xf8, 0x40, 0xf5,
-    0x24, 0xf3, 0xa3, 0xf2, 0x71, 0xf2, 0x4a, 0xf4,
-    0x58, 0xf4, 0x31, 0xf6, 0x51, 0xf7, 0xc9, 0xf8,
-    0x43, 0xf7, 0x6a, 0xf6, 0x1b, 0xf7, 0x02, 0xf9,
-    0xf8, 0xf9, 0x49, 0xfb, 0xef, 0xfc, 0x3a, 0xff,
-    0x9c, 0x02, 0x22, 0x03, 0xac, 0x03, 0xa0, 0x02,
-    0xa1, 0x02, 0x9e, 0x02, 0x87, 0x02, 0xda, 0x02,
-    0x50, 0x03, 0xf0, 0x04, 0xe9, 0x05, 0x1b, 0x04,
-    0x84, 0x03, 0xe7, 0x02, 0x05, 0x02, 0x24, 0x00,
-    0x40, 0xfe, 0x83, 0xfe, 0x00, 0xff, 0xa0, 0xfe,
-    0x1f, 0xfd, 0x5c, 0xfc, 0x44, 0xfc, 0x1b, 0xfb,
-    0x1a, 0xf9, 0x9b, 0xf8, 0xa2, 0xf7, 0xd0, 0xf7,
-    0x4c, 0xf7, 0x43, 0xf7, 0x95, 0xf8, 0xe9, 0xf8,
-    0x64, 0xf8, 0x81, 0xf7, 0xbb, 0xf5, 0xd3, 0xf4,
-    0x70, 0xf4, 0x1a, 0xf4, 0xc6, 0xf4, 0x6f, 0xf5,
-    0x7d, 0xf5, 0xb9, 0xf5, 0x99, 0xf4, 0xa3, 0xf2,
-    0x87, 0xf2, 0xe2, 0xf0, 0xd0, 0xef, 0xbe, 0xed,
-    0x10, 0xed, 0xca, 0xed, 0x6a, 0xef, 0xe9, 0xed,
-    0xe5, 0xef, 0x93, 0xf7, 0x43, 0x01, 0x15, 0x07,
-    0x13, 0x02, 0x59, 0xfc, 0x78, 0xf9, 0x8a, 0xfd,
-    0x80, 0x01, 0xf8, 0x07, 0xec, 0x0f, 0xe5, 0x15,
-    0xc9, 0x14, 0x7f, 0x0f, 0xae, 0x0d, 0x28, 0x10,
-    0x3c, 0x14, 0xc1, 0x13, 0xeb, 0x15, 0xc1, 0x17,
-    0x96, 0x1b, 0xaf, 0x1b, 0x68, 0x1a, 0xf9, 0x19,
-    0x1b, 0x17, 0x28, 0x14, 0x28, 0x10, 0x7f, 0x0e,
-    0xea, 0x0e, 0x65, 0x12, 0x35, 0x14, 0x79, 0x12,
-    0xa2, 0x0b, 0x3f, 0x04, 0x62, 0x00, 0x13, 0xfe,
-    0x16, 0xfd, 0x01, 0xfe, 0x26, 0x00, 0x73, 0xff,
-    0xa7, 0xfb, 0xef, 0xf5, 0x30, 0xf3, 0x72, 0xf3,
-    0x2f, 0xf2, 0xd8, 0xf1, 0xaa, 0xf2, 0xa2, 0xf2,
-    0x90, 0xf2, 0xf2, 0xf2, 0x95, 0xf3, 0x7b, 0xf3,
-    0x0c, 0xf3, 0xb1, 0xf1, 0xd5, 0xf2, 0x5e, 0xf4,
-    0x50, 0xf6, 0xed, 0xf9, 0x84, 0xfc, 0x16, 0xfe,
-    0xd8, 0xfc, 0x52, 0xfc, 0xc1, 0xfd, 0x82, 0x00,
-    0xa7, 0x02, 0xa0, 0x05, 0x34, 0x07, 0x9a, 0x07,
-    0x93, 0x07, 0x2d, 0x06, 0x1f, 0x06, 0x94, 0x06,
-    0xe7, 0x07, 0xb5, 0x08, 0x64, 0x09, 0xb0, 0x08,
-    0xe5, 0x07, 0xdb, 0x06, 0x28, 0x06, 0x42, 0x05,
-    0xfb, 0x03, 0x69, 0x03, 0x8c, 0x02, 0xf9, 0x01,
-    0x5a, 0x00, 0x20, 0xff, 0x22, 0xfe, 0x45, 0xfd,
-    0x78, 0xfc, 0xc0, 0xfa, 0x90, 0xf9, 0x64, 0xfa,
-    0x2e, 0xfa, 0xb0, 0xf9, 0x24, 0xf9, 0x78, 0xf7,
-    0xe1, 0xf6, 0x76, 0xf6, 0x13, 0xf6, 0x8f, 0xf6,
-    0x29, 0xf7, 0x5d, 0xf7, 0x08, 0xf7, 0x85, 0xf5,
-    0x04, 0xf4, 0x6a, 0xf3, 0x1f, 0xf3, 0xac, 0xf2,
-    0xa6, 0xf2, 0x94, 0xf1, 0x26, 0xf1, 0xcd, 0xf0,
-    0x1f, 0xef, 0xeb, 0xed, 0xb6, 0xec, 0x6e, 0xec,
-    0x6e, 0xf2, 0x59, 0xfd, 0xf5, 0x02, 0xb5, 0x03,
-    0xa0, 0xfe, 0xfc, 0xf9, 0x00, 0xfa, 0x7c, 0xfc,
-    0xbf, 0x00, 0xfe, 0x09, 0x0c, 0x12, 0x0d, 0x12,
-    0x97, 0x0e, 0x2c, 0x0a, 0x64, 0x0a, 0x67, 0x0c,
-    0xe3, 0x0e, 0x59, 0x11, 0x2e, 0x17, 0x45, 0x1a,
-    0xf4, 0x18, 0xd3, 0x16, 0x38, 0x15, 0xd6, 0x14,
-    0x84, 0x13, 0x7c, 0x11, 0xc1, 0x10, 0x45, 0x12,
-    0x1d, 0x13, 0x02, 0x13, 0xdb, 0x11, 0x3b, 0x0e,
-    0xcf, 0x08, 0xb9, 0x03, 0x9b, 0x00, 0xc5, 0x00,
-    0x1b, 0x02, 0x73, 0x03, 0xea, 0x01, 0x51, 0xfe,
-    0x41, 0xf8, 0xe6, 0xf3, 0x3b, 0xf2, 0xee, 0xf2,
-    0xec, 0xf4, 0x8c, 0xf6, 0xaf, 0xf6, 0xd0, 0xf4,
-    0x69, 0xf2, 0xc5, 0xf0, 0x4c, 0xf1, 0x65, 0xf1,
-    0x64, 0xf2, 0x94, 0xf3, 0xbd, 0xf5, 0x6e, 0xf7,
-    0xcf, 0xf8, 0x06, 0xfa, 0x0b, 0xfb, 0x96, 0xfb,
-    0x18, 0xfd, 0x8c, 0xfe, 0x37, 0x01, 0xf0, 0x03,
-    0x4e, 0x06, 0xb0, 0x08, 0x52, 0x09, 0xcf, 0x08,
-    0x2e, 0x07, 0xcd, 0x08, 0x4b, 0x09, 0xb6, 0x0a,
-    0xfd, 0x0b, 0x21, 0x0d, 0x8e, 0x0d, 0x04, 0x0d,
-    0x1d, 0x0a, 0x37, 0x08, 0xd5, 0x08, 0x4a, 0x08,
-    0x7e, 0x08, 0x61, 0x07, 0x10, 0x07, 0x9f, 0x05,
-    0xdb, 0x03, 0xb5, 0x00, 0xd9, 0xfe, 0xd1, 0xfe,
-    0xd4, 0xfd, 0xdb, 0xfc, 0x5e, 0xfc, 0xe3, 0xfb,
-    0x1e, 0xfb, 0xe3, 0xf9, 0x90, 0xf7, 0x2e, 0xf7,
-    0xb3, 0xf6, 0x29, 0xf6, 0x60, 0xf6, 0x7b, 0xf7,
-    0x7e, 0xf7, 0xb5, 0xf6, 0xe7, 0xf4, 0xff, 0xf2,
-    0x65, 0xf2, 0x02, 0xf2, 0x9f, 0xf3, 0x4c, 0xf3,
-    0x48, 0xf4, 0xce, 0xf2, 0x13, 0xf2, 0xfc, 0xef,
-    0x4e, 0xef, 0x81, 0xed, 0x76, 0xee, 0x28, 0xf0,
-    0x6c, 0xee, 0x3f, 0xf3, 0x27, 0xfa, 0x33, 0x02,
-    0x8f, 0x02, 0xd9, 0xfe, 0xbb, 0xf6, 0x27, 0xf8,
-    0xac, 0xfb, 0xf8, 0x00, 0xca, 0x09, 0xde, 0x0f,
-    0xa1, 0x10, 0x9b, 0x0a, 0xd5, 0x05, 0x7c, 0x03,
-    0x8d, 0x08, 0xa8, 0x0b, 0xd5, 0x10, 0x64, 0x15,
-    0x48, 0x18, 0x5e, 0x16, 0x91, 0x11, 0xe4, 0x0e,
-    0x12, 0x0f, 0xf7, 0x10, 0xab, 0x11, 0x36, 0x13,
-    0x48, 0x13, 0x07, 0x13, 0x17, 0x11, 0x67, 0x0e,
-    0x2a, 0x0b, 0x2b, 0x08, 0xaf, 0x05, 0x1c, 0x04,
-    0x94, 0x03, 0xac, 0x03, 0x9d, 0x03, 0x22, 0x02,
-    0x55, 0xff, 0x76, 0xfa, 0x9c, 0xf6, 0xa3, 0xf5,
-    0xcb, 0xf5, 0x12, 0xf7, 0xa4, 0xf8, 0xf8, 0xf8,
-    0x36, 0xf7, 0x13, 0xf5, 0x53, 0xf2, 0x46, 0xf2,
-    0x93, 0xf3, 0xad, 0xf4, 0x1a, 0xf6, 0x9f, 0xf7,
-    0x6f, 0xf9, 0xc0, 0xf9, 0x21, 0xfa, 0x77, 0xf9,
-    0x63, 0xfb, 0x8d, 0xfd, 0x8c, 0x00, 0x23, 0x03,
-    0xd1, 0x04, 0x4e, 0x06, 0xc8, 0x06, 0x81, 0x07,
-    0x94, 0x06, 0xc7, 0x07, 0x8c, 0x08, 0x54, 0x0a,
-    0xef, 0x0b, 0x7c, 0x0c, 0x57, 0x0c, 0x7c, 0x0b,
-    0xa7, 0x0a, 0xb4, 0x08, 0xc3, 0x09, 0x6a, 0x0a,
-    0x64, 0x0b, 0xab, 0x0a, 0xed, 0x08, 0x74, 0x07,
-    0x0a, 0x06, 0x8c, 0x04, 0x0f, 0x02, 0xc7, 0x01,
-    0xd4, 0x01, 0x55, 0x02, 0xf8, 0x00, 0x52, 0xff,
-    0xc3, 0xfd, 0x78, 0xfb, 0x0b, 0xfa, 0xe2, 0xf8,
-    0x49, 0xf9, 0x36, 0xfa, 0x2e, 0xfa, 0xcc, 0xf9,
-    0x5c, 0xf9, 0x5e, 0xf8, 0xbc, 0xf5, 0x9a, 0xf4,
-    0xf5, 0xf3, 0x81, 0xf5, 0xd6, 0xf6, 0xc8, 0xf6,
-    0x4e, 0xf6, 0x23, 0xf4, 0xcf, 0xf1, 0x58, 0xef,
-    0x5d, 0xef, 0xed, 0xee, 0x59, 0xf0, 0x42, 0xf0,
-    0x77, 0xf0, 0x39, 0xef, 0x03, 0xec, 0x0d, 0xea,
-    0x28, 0xed, 0xad, 0xf5, 0xb3, 0xfc, 0xb8, 0xfe,
-    0xd5, 0xf9, 0x31, 0xf5, 0x7e, 0xf3, 0x1d, 0xf6,
-    0xac, 0xfb, 0x5a, 0x04, 0xaa, 0x0a, 0x15, 0x0b,
-    0x0d, 0x06, 0xd2, 0x00, 0x41, 0x00, 0xaa, 0x03,
-    0x44, 0x08, 0x1a, 0x0d, 0x65, 0x12, 0x20, 0x14,
-    0xae, 0x11, 0xdf, 0x0c, 0x8a, 0x0a, 0x39, 0x0c,
-    0xcd, 0x0f, 0x78, 0x12, 0xde, 0x13, 0xfe, 0x13,
-    0x86, 0x12, 0x03, 0x10, 0xfc, 0x0c, 0x20, 0x0b,
-    0xc2, 0x09, 0xf3, 0x08, 0x6a, 0x08, 0x86, 0x07,
-    0x4f, 0x07, 0x6c, 0x06, 0xfd, 0x03, 0xa3, 0xff,
-    0x69, 0xfb, 0xa5, 0xf8, 0xe2, 0xf8, 0x41, 0xfa,
-    0x6d, 0xfb, 0xd5, 0xfb, 0x71, 0xfa, 0x06, 0xf7,
-    0x1e, 0xf3, 0x6c, 0xf0, 0xd3, 0xf1, 0xbd, 0xf4,
-    0xd1, 0xf7, 0xf8, 0xf9, 0x36, 0xf9, 0x94, 0xf7,
-    0x48, 0xf6, 0x89, 0xf6, 0xff, 0xf7, 0x0d, 0xfc,
-    0x8f, 0xfe, 0xbc, 0x01, 0x3b, 0x03, 0xb3, 0x02,
-    0x27, 0x02, 0xec, 0x02, 0x03, 0x05, 0x6e, 0x06,
-    0x39, 0x08, 0x6f, 0x09, 0x57, 0x0b, 0x7c, 0x0b,
-    0x9a, 0x0b, 0xe2, 0x0a, 0x49, 0x0a, 0xb0, 0x0a,
-    0xe9, 0x09, 0x32, 0x0a, 0x1e, 0x0c, 0xee, 0x0c,
-    0xb3, 0x0b, 0xa7, 0x09, 0x4a, 0x06, 0x17, 0x04,
-    0x23, 0x04, 0x95, 0x04, 0x10, 0x05, 0xaa, 0x05,
-    0x36, 0x04, 0x4e, 0x01, 0xef, 0xfd, 0x43, 0xfb,
-    0x8c, 0xfa, 0x6c, 0xfb, 0x3e, 0xfd, 0xec, 0xfd,
-    0xc9, 0xfc, 0x5d, 0xfa, 0x1d, 0xf7, 0x35, 0xf5,
-    0x1b, 0xf6, 0xcf, 0xf7, 0xd5, 0xf8, 0xc2, 0xf8,
-    0x5c, 0xf7, 0x49, 0xf5, 0xd4, 0xf3, 0x83, 0xf2,
-    0x55, 0xf2, 0x66, 0xf3, 0x29, 0xf3, 0x6b, 0xf2,
-    0x42, 0xf0, 0x06, 0xef, 0x5e, 0xee, 0x92, 0xed,
-    0x04, 0xec, 0x88, 0xeb, 0x77, 0xeb, 0x1d, 0xeb,
-    0xce, 0xee, 0xb8, 0xf2, 0xab, 0xf8, 0xae, 0xfa,
-    0x94, 0xf8, 0x2e, 0xf3, 0xd3, 0xf1, 0xc5, 0xf3,
-    0x5c, 0xf9, 0x87, 0x02, 0xef, 0x07, 0x02, 0x09,
-    0xe0, 0x04, 0x34, 0x00, 0x6f, 0xfd, 0xc9, 0x00,
-    0x49, 0x06, 0xa5, 0x0d, 0xf7, 0x12, 0x65, 0x14,
-    0x49, 0x10, 0xe2, 0x0b, 0xe8, 0x08, 0xf0, 0x0a,
-    0x3c, 0x0f, 0x14, 0x14, 0x25, 0x17, 0xc6, 0x15,
-    0x50, 0x12, 0x1a, 0x0e, 0xe3, 0x0b, 0xb0, 0x0a,
-    0x4e, 0x0c, 0xf0, 0x0b, 0x7c, 0x0c, 0xda, 0x0a,
-    0x11, 0x08, 0x4a, 0x04, 0x73, 0x02, 0xd6, 0xff,
-    0xeb, 0xfd, 0x8a, 0xfc, 0x1c, 0xfb, 0x1e, 0xfb,
-    0xb5, 0xfa, 0xff, 0xfa, 0x90, 0xf9, 0xf6, 0xf7,
-    0x7e, 0xf4, 0x6f, 0xf3, 0xeb, 0xf3, 0x04, 0xf7,
-    0x81, 0xf9, 0x05, 0xfb, 0x9f, 0xfa, 0xb9, 0xf8,
-    0x8c, 0xf7, 0x98, 0xf7, 0x42, 0xfa, 0x60, 0xfd,
-    0x87, 0x00, 0xf3, 0x02, 0x79, 0x04, 0x92, 0x03,
-    0xc8, 0x02, 0xf7, 0x02, 0x0b, 0x05, 0x85, 0x07,
-    0x75, 0x0a, 0x50, 0x0b, 0x2c, 0x0c, 0xb9, 0x0b,
-    0xb8, 0x0a, 0x3c, 0x0a, 0x12, 0x0a, 0x24, 0x0b,
-    0x63, 0x0b, 0xc3, 0x0b, 0x12, 0x0b, 0x6b, 0x0a,
-    0xe1, 0x08, 0xcd, 0x07, 0xc8, 0x05, 0x92, 0x04,
-    0x14, 0x04, 0x0b, 0x04, 0x6e, 0x02, 0x44, 0x02,
-    0x8e, 0x01, 0x92, 0xff, 0xc8, 0xfd, 0xd6, 0xfb,
-    0xed, 0xfa, 0x1e, 0xfb, 0x9d, 0xfc, 0x7b, 0xfb,
-    0x7b, 0xfb, 0xe8, 0xf9, 0x94, 0xf7, 0x9e, 0xf6,
-    0x7a, 0xf7, 0x5a, 0xf8, 0xc8, 0xf9, 0x93, 0xfa,
-    0xc3, 0xf9, 0x1f, 0xf8, 0x92, 0xf6, 0x87, 0xf5,
-    0xaf, 0xf5, 0x23, 0xf6, 0xad, 0xf6, 0x50, 0xf6,
-    0xf9, 0xf4, 0x2e, 0xf4, 0xf6, 0xf0, 0x99, 0xf0,
-    0x64, 0xef, 0x6f, 0xef, 0xd7, 0xee, 0x29, 0xef,
-    0xee, 0xed, 0x09, 0xed, 0x03, 0xee, 0x9c, 0xf0,
-    0x99, 0xf7, 0x8a, 0xf9, 0x96, 0xf8, 0xed, 0xf4,
-    0xa8, 0xf2, 0x50, 0xf4, 0xfa, 0xf9, 0xef, 0xff,
-    0xca, 0x05, 0x75, 0x07, 0xfb, 0x02, 0x70, 0xfe,
-    0x88, 0xfd, 0xf3, 0xff, 0xf1, 0x05, 0x67, 0x0c,
-    0x92, 0x10, 0x66, 0x12, 0xc4, 0x0e, 0xc0, 0x09,
-    0x00, 0x07, 0x91, 0x09, 0xac, 0x0e, 0x22, 0x14,
-    0x3f, 0x16, 0xfc, 0x14, 0xff, 0x10, 0xa8, 0x0c,
-    0x6b, 0x0b, 0x9a, 0x0b, 0x30, 0x0d, 0x1c, 0x0e,
-    0xc1, 0x0d, 0x5c, 0x0b, 0x90, 0x08, 0x92, 0x05,
-    0x54, 0x03, 0x37, 0x02, 0xc0, 0x00, 0x76, 0xff,
-    0x83, 0xfe, 0x5d, 0xfd, 0x50, 0xfc, 0x78, 0xfb,
-    0xd1, 0xfa, 0x1e, 0xfa, 0xfc, 0xf7, 0xd8, 0xf6,
-    0x63, 0xf7, 0xd0, 0xf8, 0xc0, 0xf9, 0xc9, 0xfa,
-    0xee, 0xfa, 0x7f, 0xfa, 0x63, 0xfa, 0xb1, 0xf9,
-    0x2d, 0xfb, 0x61, 0xfe, 0xda, 0x00, 0x93, 0x02,
-    0x3f, 0x04, 0x56, 0x04, 0x1a, 0x03, 0x30, 0x03,
-    0x31, 0x05, 0xaa, 0x07, 0xea, 0x09, 0xf8, 0x0a,
-    0xd4, 0x0a, 0xe3, 0x0a, 0x76, 0x0a, 0xa9, 0x09,
-    0x8d, 0x0a, 0xdd, 0x0b, 0x23, 0x0c, 0xeb, 0x0b,
-    0xd7, 0x0b, 0x6a, 0x0a, 0x8d, 0x08, 0x08, 0x07,
-    0x58, 0x06, 0xb6, 0x06, 0x4d, 0x06, 0x51, 0x05,
-    0x9f, 0x03, 0x19, 0x02, 0x2d, 0x01, 0x73, 0x00,
-    0xd6, 0xff, 0x21, 0xff, 0xec, 0xfd, 0xc3, 0xfc,
-    0x84, 0xfc, 0x53, 0xfc, 0xea, 0xfb, 0xfc, 0xfa,
-    0xc6, 0xf9, 0xdc, 0xf8, 0x94, 0xf8, 0x1b, 0xf9,
-    0x4e, 0xf9, 0xb1, 0xf9, 0x7e, 0xf9, 0x54, 0xf9,
-    0x11, 0xf8, 0x09, 0xf7, 0x2d, 0xf6, 0xad, 0xf5,
-    0x3a, 0xf6, 0xd7, 0xf6, 0x5e, 0xf6, 0xb6, 0xf4,
-    0xf2, 0xf2, 0xc5, 0xf0, 0x4c, 0xf0, 0x69, 0xf0,
-    0x69, 0xf0, 0x42, 0xef, 0x7e, 0xee, 0x9d, 0xec,
-    0x74, 0xec, 0xf3, 0xed, 0x9f, 0xf0, 0xf8, 0xf4,
-    0x8e, 0xf7, 0xd7, 0xf6, 0x49, 0xf4, 0xff, 0xf2,
-    0xd7, 0xf3, 0x2b, 0xf8, 0xfc, 0xfd, 0x43, 0x03,
-    0xc0, 0x05, 0x9b, 0x03, 0xef, 0xfe, 0x8b, 0xfd,
-    0xde, 0xff, 0x5d, 0x05, 0x62, 0x0b, 0x09, 0x10,
-    0x05, 0x11, 0x18, 0x0e, 0x81, 0x09, 0x58, 0x07,
-    0xd0, 0x09, 0xc2, 0x0e, 0xe5, 0x13, 0x3d, 0x16,
-    0x45, 0x15, 0xf7, 0x10, 0xe4, 0x0c, 0x34, 0x0b,
-    0x01, 0x0d, 0x65, 0x0f, 0x95, 0x10, 0x3d, 0x10,
-    0x2b, 0x0d, 0x09, 0x09, 0xdb, 0x05, 0x1b, 0x04,
-    0xcf, 0x03, 0xfe, 0x03, 0x0a, 0x03, 0x5c, 0x01,
-    0x57, 0xff, 0xab, 0xfc, 0xd9, 0xfa, 0xfe, 0xfa,
-    0xa1, 0xfa, 0x43, 0xfa, 0x72, 0xf9, 0xcf, 0xf8,
-    0xf4, 0xf8, 0x39, 0xf9, 0x01, 0xfa, 0xde, 0xfa,
-    0x20, 0xfb, 0xbe, 0xfa, 0xf6, 0xfa, 0x54, 0xfc,
-    0xd7, 0xfe, 0xea, 0x00, 0xbc, 0x02, 0x00, 0x04,
-    0x21, 0x04, 0x49, 0x03, 0xa8, 0x03, 0xca, 0x05,
-    0xc8, 0x08, 0xe7, 0x0a, 0x7b, 0x0b, 0x33, 0x0b,
-    0x14, 0x0a, 0x40, 0x09, 0x59, 0x09, 0x31, 0x0b,
-    0x4c, 0x0d, 0x2f, 0x0e, 0xd0, 0x0c, 0x1d, 0x0b,
-    0x9c, 0x08, 0x0b, 0x07, 0x53, 0x07, 0xe6, 0x07,
-    0x37, 0x09, 0xa4, 0x08, 0x1e, 0x06, 0x7a, 0x02,
-    0x40, 0x00, 0xdc, 0xff, 0x12, 0x01, 0xf2, 0x01,
-    0xaf, 0x00, 0xd0, 0xfe, 0x4c, 0xfc, 0x7b, 0xfa,
-    0x6c, 0xfa, 0x2a, 0xfb, 0x2a, 0xfc, 0x78, 0xfb,
-    0xea, 0xf9, 0x00, 0xf9, 0x4f, 0xf8, 0x09, 0xf8,
-    0x48, 0xf8, 0x05, 0xf9, 0x5d, 0xf9, 0x67, 0xf9,
-    0x1b, 0xf8, 0x77, 0xf6, 0x0a, 0xf6, 0xd4, 0xf5,
-    0x70, 0xf6, 0xa3, 0xf6, 0x2b, 0xf5, 0x64, 0xf3,
-    0xfa, 0xf1, 0x54, 0xf1, 0xa1, 0xf0, 0x06, 0xf1,
-    0xd9, 0xef, 0xf0, 0xee, 0xb4, 0xec, 0x78, 0xeb,
-    0x1b, 0xec, 0xb1, 0xeb, 0x49, 0xed, 0xf2, 0xef,
-    0x08, 0xf4, 0xb5, 0xf5, 0x57, 0xf5, 0xc2, 0xf1,
-    0x16, 0xf1, 0x86, 0xf3, 0x67, 0xf7, 0x62, 0xfe,
-    0x89, 0x03, 0x5f, 0x03, 0xb6, 0x00, 0x46, 0xfd,
-    0xcd, 0xfc, 0xea, 0x00, 0x0d, 0x06, 0xac, 0x0b,
-    0x89, 0x0f, 0x5d, 0x10, 0xe2, 0x0b, 0x16, 0x09,
-    0x43, 0x07, 0xca, 0x0a, 0xb3, 0x10, 0x46, 0x15,
-    0xb1, 0x17, 0xc5, 0x14, 0xe2, 0x0f, 0x7e, 0x0b,
-    0x9e, 0x0b, 0xdd, 0x0d, 0x6b, 0x11, 0x61, 0x12,
-    0xc8, 0x10, 0xe6, 0x0c, 0xec, 0x07, 0x73, 0x04,
-    0x68, 0x03, 0x5d, 0x04, 0x51, 0x05, 0xd0, 0x04,
-    0x5f, 0x02, 0x63, 0xfe, 0xe1, 0xfa, 0x34, 0xf9,
-    0xde, 0xf9, 0x88, 0xfb, 0x7e, 0xfb, 0x09, 0xfb,
-    0x69, 0xf9, 0x57, 0xf8, 0xfd, 0xf7, 0xa4, 0xf8,
-    0x16, 0xfa, 0x3a, 0xfb, 0x7a, 0xfc, 0x47, 0xfc,
-    0x3a, 0xfd, 0x0c, 0xfe, 0x78, 0xff, 0x76, 0x01,
-    0xe9, 0x02, 0x33, 0x04, 0x16, 0x04, 0x19, 0x05,
-    0x48, 0x06, 0x63, 0x08, 0xfe, 0x09, 0x66, 0x0a,
-    0xae, 0x09, 0xef, 0x08, 0xf8, 0x08, 0x9a, 0x09,
-    0x53, 0x0b, 0x7d, 0x0c, 0x9e, 0x0c, 0xe1, 0x0a,
-    0x07, 0x09, 0x01, 0x07, 0x0f, 0x06, 0x9a, 0x06,
-    0x9f, 0x07, 0x2b, 0x08, 0x52, 0x07, 0x42, 0x04,
-    0xc0, 0x00, 0xc5, 0xfe, 0x44, 0xfe, 0xd2, 0xff,
-    0x7c, 0x01, 0x59, 0x01, 0x23, 0xff, 0xd4, 0xfb,
-    0xff, 0xf8, 0x0b, 0xf9, 0xee, 0xf9, 0xb2, 0xfb,
-    0x0f, 0xfd, 0xad, 0xfb, 0x86, 0xf9, 0x6c, 0xf7,
-    0x51, 0xf6, 0x8e, 0xf6, 0x54, 0xf8, 0x65, 0xf9,
-    0x31, 0xfa, 0xe6, 0xf9, 0x45, 0xf7, 0x87, 0xf5,
-    0x71, 0xf4, 0x51, 0xf4, 0x9f, 0xf5, 0x92, 0xf5,
-    0xa9, 0xf4, 0xb3, 0xf2, 0x73, 0xf0, 0x9b, 0xef,
-    0x7d, 0xef, 0xb4, 0xee, 0xe5, 0xee, 0xa7, 0xed,
-    0x70, 0xeb, 0x50, 0xeb, 0xa9, 0xea, 0xec, 0xeb,
-    0x89, 0xee, 0x51, 0xf1, 0x4a, 0xf3, 0xd8, 0xf3,
-    0x90, 0xf1, 0x4d, 0xf0, 0x88, 0xf2, 0x23, 0xf6,
-    0xa5, 0xfb, 0x99, 0x00, 0x50, 0x02, 0xb2, 0x00,
-    0xd8, 0xfd, 0x3d, 0xfd, 0x57, 0x00, 0x7c, 0x05,
-    0x38, 0x0a, 0xe1, 0x0d, 0x3b, 0x0f, 0x33, 0x0c,
-    0x46, 0x09, 0x76, 0x08, 0x58, 0x0b, 0x5a, 0x10,
-    0xb9, 0x13, 0x81, 0x15, 0xfd, 0x13, 0x56, 0x10,
-    0x5f, 0x0d, 0xb5, 0x0c, 0xb7, 0x0e, 0xf7, 0x10,
-    0xcf, 0x11, 0x03, 0x11, 0xb6, 0x0d, 0x51, 0x09,
-    0x3a, 0x06, 0x59, 0x05, 0xc4, 0x05, 0xc7, 0x05,
-    0x5b, 0x05, 0xb6, 0x02, 0xcc, 0xff, 0xe7, 0xfc,
-    0x1f, 0xfb, 0xc4, 0xfb, 0x82, 0xfc, 0x23, 0xfc,
-    0x76, 0xfb, 0xda, 0xfa, 0x6c, 0xf9, 0x7a, 0xf9,
-    0xe9, 0xf9, 0x02, 0xfb, 0x52, 0xfc, 0x24, 0xfd,
-    0xa4, 0xfc, 0xa1, 0xfd, 0xcd, 0xfe, 0xe7, 0xff,
-    0xcf, 0x01, 0x92, 0x02, 0x45, 0x03, 0xea, 0x03,
-    0x01, 0x05, 0x4f, 0x06, 0xd4, 0x08, 0x99, 0x09,
-    0x70, 0x09, 0x3e, 0x09, 0xbe, 0x08, 0x0b, 0x09,
-    0xb2, 0x09, 0x09, 0x0b, 0x9f, 0x0c, 0xc8, 0x0c,
-    0x9d, 0x0a, 0x3c, 0x08, 0x8d, 0x06, 0x55, 0x06,
-    0x42, 0x07, 0x1a, 0x08, 0xfe, 0x08, 0x91, 0x07,
-    0x97, 0x03, 0x20, 0x00, 0x9e, 0xfe, 0x27, 0xff,
-    0x32, 0x01, 0xec, 0x01, 0x42, 0x01, 0x6c, 0xff,
-    0xe2, 0xfb, 0x84, 0xf9, 0xfb, 0xf9, 0xb3, 0xfb,
-    0x45, 0xfd, 0xb3, 0xfd, 0xb0, 0xfb, 0xa4, 0xf9,
-    0xfe, 0xf7, 0x71, 0xf7, 0x1b, 0xf9, 0xe2, 0xfa,
-    0x4f, 0xfb, 0x81, 0xfa, 0x19, 0xf9, 0x4e, 0xf8,
-    0xd2, 0xf7, 0x21, 0xf8, 0xfd, 0xf7, 0x06, 0xf8,
-    0x51, 0xf7, 0xa3, 0xf5, 0x7e, 0xf4, 0x80, 0xf3,
-    0xb7, 0xf3, 0x9f, 0xf2, 0xc4, 0xf1, 0x1e, 0xf0,
-    0x94, 0xee, 0x12, 0xee, 0x1f, 0xed, 0x66, 0xed,
-    0x30, 0xed, 0xc6, 0xec, 0x9d, 0xeb, 0xd1, 0xeb,
-    0x45, 0xf0, 0x1f, 0xf4, 0xf8, 0xf6, 0xb3, 0xf5,
-    0x76, 0xf2, 0xbd, 0xf2, 0x57, 0xf5, 0xa8, 0xfa,
-    0x2c, 0x01, 0x42, 0x05, 0xc5, 0x04, 0xae, 0x01,
-    0x08, 0xff, 0x52, 0x00, 0xfa, 0x04, 0xef, 0x09,
-    0x0f, 0x0e, 0x3a, 0x11, 0x3b, 0x10, 0xdd, 0x0c,
-    0xee, 0x09, 0x20, 0x0a, 0x88, 0x0e, 0x7c, 0x13,
-    0x17, 0x16, 0xcb, 0x15, 0x3a, 0x13, 0x40, 0x0e,
-    0xb9, 0x0c, 0x99, 0x0d, 0xae, 0x0f, 0x7f, 0x11,
-    0x02, 0x10, 0xd1, 0x0d, 0x9f, 0x0a, 0x5c, 0x07,
-    0xd8, 0x04, 0xd6, 0x04, 0xbc, 0x04, 0x54, 0x04,
-    0xca, 0x02, 0xf0, 0xff, 0xdb, 0xfd, 0x66, 0xfb,
-    0x5e, 0xfb, 0x3a, 0xfc, 0x66, 0xfc, 0x2e, 0xfb,
-    0x99, 0xf9, 0xac, 0xf9, 0x72, 0xfa, 0x70, 0xfb,
-    0xb2, 0xfc, 0x0c, 0xfd, 0x58, 0xfd, 0xeb, 0xfc,
-    0x5e, 0xfd, 0xfe, 0xff, 0xd2, 0x01, 0x3b, 0x03,
-    0xc1, 0x03, 0x60, 0x04, 0x0a, 0x05, 0x3b, 0x05,
-    0x91, 0x06, 0xce, 0x08, 0xb3, 0x0a, 0x55, 0x0b,
-    0x89, 0x0a, 0x57, 0x09, 0xe9, 0x08, 0x8f, 0x09,
-    0x97, 0x0a, 0x6c, 0x0c, 0xc7, 0x0c, 0x4a, 0x0b,
-    0x1a, 0x09, 0xc4, 0x06, 0xe8, 0x05, 0x01, 0x06,
-    0x5f, 0x07, 0x97, 0x07, 0xea, 0x06, 0xa8, 0x04,
-    0xff, 0x00, 0x10, 0xff, 0xe1, 0xfe, 0x19, 0x00,
-    0xab, 0x01, 0x6c, 0x01, 0x28, 0xff, 0xae, 0xfc,
-    0xb7, 0xfa, 0xa0, 0xfa, 0xf2, 0xfb, 0xbc, 0xfc,
-    0xdd, 0xfc, 0x2c, 0xfc, 0x8c, 0xfa, 0xf0, 0xf9,
-    0x5f, 0xf9, 0x9a, 0xf9, 0x53, 0xfa, 0x37, 0xfa,
-    0x67, 0xfa, 0x37, 0xfa, 0x57, 0xf9, 0xe5, 0xf8,
-    0xec, 0xf8, 0xa7, 0xf8, 0x54, 0xf8, 0x14, 0xf7,
-    0xb8, 0xf5, 0x4b, 0xf5, 0x61, 0xf4, 0x7a, 0xf3,
-    0xc0, 0xf3, 0xdb, 0xf1, 0x2b, 0xf0, 0x6c, 0xee,
-    0x72, 0xed, 0x85, 0xed, 0x8a, 0xed, 0xca, 0xec,
-    0xbd, 0xeb, 0x40, 0xec, 0xa1, 0xea, 0x76, 0xee,
-    0x29, 0xf3, 0xc5, 0xf4, 0x3f, 0xf5, 0xb0, 0xf2,
-    0xa2, 0xf2, 0x50, 0xf6, 0x91, 0xfa, 0x4c, 0xff,
-    0x5f, 0x03, 0x8c, 0x03, 0xfa, 0x00, 0x92, 0x00,
-    0x11, 0x03, 0x8f, 0x05, 0x7d, 0x09, 0xb3, 0x0b,
-    0x38, 0x0e, 0x8d, 0x0f, 0x5a, 0x0d, 0x47, 0x0b,
-    0xf3, 0x0b, 0x7a, 0x0e, 0xf9, 0x10, 0x28, 0x14,
-    0xa9, 0x13, 0x4c, 0x11, 0x63, 0x0e, 0x0e, 0x0d,
-    0x7d, 0x0e, 0x67, 0x0f, 0x44, 0x0f, 0xf8, 0x0d,
-    0xe7, 0x0c, 0x14, 0x0b, 0x58, 0x08, 0x73, 0x06,
-    0xed, 0x04, 0x04, 0x04, 0xc3, 0x02, 0xca, 0x01,
-    0xa9, 0x00, 0x54, 0xfe, 0xdb, 0xfc, 0xf9, 0xfb,
-    0xea, 0xfb, 0xbf, 0xfb, 0xfb, 0xfa, 0xff, 0xf9,
-    0x9d, 0xfa, 0xdc, 0xfb, 0x19, 0xfc, 0xbe, 0xfc,
-    0x74, 0xfc, 0x5f, 0xfc, 0xbf, 0xfd, 0x2e, 0xff,
-    0xd9, 0x00, 0x27, 0x02, 0x45, 0x03, 0xf8, 0x03,
-    0x4d, 0x04, 0x2a, 0x05, 0x6d, 0x05, 0x18, 0x07,
-    0xd7, 0x08, 0x06, 0x0a, 0x43, 0x0a, 0xd4, 0x09,
-    0x96, 0x09, 0x16, 0x09, 0xeb, 0x09, 0x89, 0x0a,
-    0xd3, 0x0a, 0x03, 0x0b, 0x52, 0x0a, 0x68, 0x08,
-    0xe2, 0x07, 0xe2, 0x06, 0xb0, 0x05, 0xc1, 0x05,
-    0x8f, 0x05, 0x2b, 0x05, 0xd3, 0x03, 0xb5, 0x01,
-    0x6d, 0xff, 0x84, 0xff, 0xb0, 0xff, 0x4f, 0xff,
-    0xb9, 0xfe, 0xd1, 0xfd, 0xe6, 0xfc, 0xe2, 0xfc,
-    0x54, 0xfd, 0xfc, 0xfc, 0x7f, 0xfc, 0xda, 0xfa,
-    0x18, 0xfa, 0x10, 0xfb, 0x64, 0xfc, 0xc6, 0xfc,
-    0x54, 0xfc, 0xe9, 0xfa, 0xa8, 0xf9, 0xd0, 0xf8,
-    0xf0, 0xf8, 0xe3, 0xf9, 0x26, 0xfb, 0x16, 0xfc,
-    0x04, 0xfb, 0x8b, 0xf9, 0xf1, 0xf6, 0xbb, 0xf4,
-    0xd0, 0xf4, 0xfb, 0xf5, 0xb3, 0xf6, 0xf3, 0xf5,
-    0x6b, 0xf3, 0x8e, 0xf0, 0x28, 0xee, 0x4b, 0xed,
-    0x9e, 0xed, 0x95, 0xed, 0xe3, 0xed, 0x8d, 0xec,
-    0x40, 0xeb, 0x79, 0xea, 0x7e, 0xe9, 0x99, 0xea,
-    0x84, 0xee, 0xfc, 0xf3, 0xab, 0xf5, 0xd3, 0xf4,
-    0x9f, 0xf3, 0xed, 0xf1, 0x38, 0xf5, 0x09, 0xfb,
-    0x66, 0x00, 0x3d, 0x05, 0x6f, 0x05, 0x3e, 0x02,
-    0x50, 0x01, 0x26, 0x03, 0x79, 0x05, 0x8c, 0x09,
-    0x86, 0x0e, 0xd2, 0x10, 0xa8, 0x10, 0x42, 0x0e,
-    0x65, 0x0b, 0x1b, 0x0b, 0xf1, 0x0d, 0x5b, 0x11,
-    0xf3, 0x13, 0xa0, 0x14, 0xe7, 0x10, 0x21, 0x0d,
-    0x8c, 0x0b, 0xcf, 0x0c, 0xed, 0x0d, 0x2c, 0x0e,
-    0xf3, 0x0d, 0x32, 0x0b, 0xe3, 0x08, 0xa8, 0x06,
-    0xc5, 0x04, 0xf5, 0x03, 0x36, 0x03, 0xd3, 0x01,
-    0xc2, 0x00, 0x79, 0xff, 0xaf, 0xfd, 0xb6, 0xfc,
-    0xc7, 0xfc, 0xe0, 0xfc, 0x55, 0xfc, 0x8b, 0xfb,
-    0x52, 0xfb, 0x57, 0xfb, 0x6f, 0xfc, 0xc8, 0xfd,
-    0x5d, 0xfe, 0xea, 0xfe, 0x67, 0xfe, 0xd9, 0xfe,
-    0x37, 0x00, 0xf6, 0x01, 0x91, 0x03, 0xcd, 0x04,
-    0xa6, 0x05, 0x0c, 0x06, 0xfa, 0x05, 0x53, 0x06,
-    0x1d, 0x07, 0x15, 0x09, 0x09, 0x0b, 0xcf, 0x0a,
-    0x78, 0x0a, 0xb1, 0x08, 0xc7, 0x07, 0x81, 0x08,
-    0x42, 0x09, 0x1a, 0x0a, 0x9e, 0x0a, 0xcd, 0x09,
-    0x32, 0x07, 0xf1, 0x04, 0xae, 0x03, 0x45, 0x03,
-    0x37, 0x04, 0xbd, 0x04, 0xde, 0x03, 0x15, 0x02,
-    0xbf, 0xff, 0xf9, 0xfc, 0x7f, 0xfc, 0x72, 0xfe,
-    0x86, 0xfe, 0xe8, 0xfe, 0x7c, 0xfd, 0x98, 0xfb,
-    0x4c, 0xfb, 0x21, 0xfb, 0x1b, 0xfc, 0xbe, 0xfc,
-    0x39, 0xfc, 0xd5, 0xfa, 0x88, 0xfa, 0xb1, 0xfa,
-    0x3f, 0xfb, 0x95, 0xfb, 0x2a, 0xfb, 0x4b, 0xfb,
-    0xb7, 0xfa, 0xf4, 0xf8, 0x36, 0xf9, 0x48, 0xf9,
-    0x1c, 0xfa, 0x6e, 0xfa, 0x9a, 0xf9, 0x5f, 0xf8,
-    0xd0, 0xf5, 0x44, 0xf4, 0x14, 0xf3, 0x65, 0xf4,
-    0x61, 0xf3, 0xe3, 0xf2, 0xc5, 0xf0, 0xff, 0xed,
-    0x3c, 0xed, 0x07, 0xec, 0x14, 0xec, 0x4f, 0xec,
-    0xf0, 0xeb, 0x46, 0xe9, 0x8f, 0xea, 0x60, 0xe9,
-    0x4e, 0xe9, 0xd9, 0xed, 0x32, 0xf1, 0x57, 0xf5,
-    0xd0, 0xf6, 0xe9, 0xf4, 0x0b, 0xf4, 0x98, 0xf6,
-    0x45, 0xfa, 0x62, 0xff, 0xd3, 0x04, 0x28, 0x07,
-    0x09, 0x06, 0x65, 0x05, 0x64, 0x04, 0xd1, 0x05,
-    0x49, 0x09, 0x08, 0x0c, 0xdb, 0x0f, 0x84, 0x11,
-    0xa1, 0x10, 0x4a, 0x0e, 0x60, 0x0c, 0x6e, 0x0b,
-    0x06, 0x0e, 0x9f, 0x10, 0xf5, 0x11, 0x53, 0x12,
-    0x2d, 0x0f, 0x4d, 0x0d, 0x01, 0x0c, 0x17, 0x0b,
-    0xba, 0x0a, 0x4f, 0x0a, 0x7e, 0x0a, 0x55, 0x09,
-    0xa5, 0x08, 0x06, 0x06, 0x80, 0x03, 0xd0, 0x01,
-    0xe9, 0xff, 0x13, 0x00, 0x4b, 0xff, 0x52, 0xff,
-    0x91, 0xfe, 0xdb, 0xfd, 0x72, 0xfd, 0x50, 0xfd,
-    0xc0, 0xfc, 0x51, 0xfc, 0x37, 0xfd, 0x1d, 0xfe,
-    0xcd, 0xff, 0x4f, 0x01, 0x6c, 0x01, 0xf2, 0x01,
-    0x6a, 0x02, 0xd6, 0x01, 0xce, 0x02, 0x3c, 0x04,
-    0x4c, 0x06, 0x3a, 0x07, 0xc9, 0x08, 0xbd, 0x08,
-    0xc6, 0x08, 0x2d, 0x08, 0x61, 0x07, 0x8e, 0x08,
-    0x27, 0x09, 0x13, 0x0a, 0x79, 0x09, 0xdb, 0x09,
-    0xca, 0x09, 0xf2, 0x08, 0x7d, 0x07, 0xa3, 0x06,
-    0xe3, 0x05, 0x85, 0x05, 0xb5, 0x05, 0xc1, 0x05,
-    0x3d, 0x05, 0x6e, 0x03, 0x41, 0x01, 0xf7, 0xff,
-    0xf1, 0xff, 0x1c, 0xff, 0x00, 0xff, 0xb6, 0xfe,
-    0x23, 0xff, 0x17, 0xff, 0x27, 0xfe, 0x06, 0xfd,
-    0x8e, 0xfb, 0x1c, 0xfb, 0xd5, 0xfb, 0x14, 0xfe,
-    0x4c, 0xff, 0x6b, 0xfe, 0x0d, 0xfd, 0x98, 0xfb,
-    0x27, 0xfb, 0xae, 0xfb, 0x0b, 0xfc, 0x0c, 0xfd,
-    0xdc, 0xfd, 0x56, 0xfd, 0x79, 0xfc, 0x5e, 0xfb,
-    0xa8, 0xf9, 0x97, 0xf8, 0xcf, 0xf8, 0xdf, 0xf9,
-    0x51, 0xfa, 0xa2, 0xf9, 0xab, 0xf6, 0x11, 0xf5,
-    0xa8, 0xf3, 0x33, 0xf2, 0xf7, 0xf1, 0xdd, 0xf0,
-    0x0d, 0xf0, 0xd8, 0xee, 0x20, 0xee, 0xab, 0xec,
-    0x3c, 0xec, 0x6e, 0xea, 0x31, 0xea, 0x45, 0xea,
-    0x63, 0xe9, 0x88, 0xea, 0x36, 0xeb, 0x67, 0xf0,
-    0xad, 0xf5, 0x7e, 0xf7, 0xc2, 0xf6, 0x8f, 0xf4,
-    0xa1, 0xf2, 0x7a, 0xf6, 0x51, 0xfe, 0xd3, 0x04,
-    0x2a, 0x0a, 0xa3, 0x09, 0xe5, 0x05, 0xc0, 0x03,
-    0x62, 0x04, 0x2e, 0x05, 0x57, 0x0a, 0x62, 0x10,
-    0x82, 0x13, 0x5b, 0x14, 0xb9, 0x10, 0x72, 0x0b,
-    0xe4, 0x08, 0x33, 0x0b, 0x1f, 0x0e, 0xdd, 0x13,
-    0xac, 0x15, 0x34, 0x13, 0x18, 0x0f, 0xb0, 0x0a,
-    0x14, 0x09, 0x9d, 0x08, 0x80, 0x0a, 0xa4, 0x0b,
-    0x71, 0x0c, 0x11, 0x0b, 0x97, 0x07, 0x8d, 0x03,
-    0x46, 0x00, 0x12, 0x00, 0xc6, 0x00, 0x4e, 0x02,
-    0x5f, 0x02, 0x59, 0x00, 0x05, 0xff, 0x51, 0xfe,
-    0x49, 0xfe, 0x27, 0xfe, 0x97, 0xfe, 0xb0, 0xfe,
-    0x1f, 0x00, 0x7c, 0x02, 0x2e, 0x03, 0xd7, 0x03,
-    0x33, 0x03, 0x05, 0x02, 0x4b, 0x03, 0xb4, 0x04,
-    0xf2, 0x05, 0xf7, 0x07, 0x4e, 0x09, 0x79, 0x09,
-    0x57, 0x09, 0xa0, 0x08, 0x2f, 0x07, 0x0e, 0x08,
-    0x8a, 0x08, 0x10, 0x0a, 0x17, 0x0c, 0x52, 0x0b,
-    0x44, 0x09, 0xd8, 0x06, 0xfe, 0x05, 0xd8, 0x05,
-    0x7e, 0x06, 0x8a, 0x06, 0x68, 0x06, 0xbb, 0x05,
-    0x06, 0x04, 0xa0, 0x02, 0x9c, 0x00, 0x62, 0xff,
-    0xcb, 0xfe, 0x84, 0xff, 0xbf, 0x00, 0x7a, 0x00,
-    0x56, 0xfe, 0x54, 0xfc, 0xb6, 0xfb, 0x15, 0xfc,
-    0x19, 0xfd, 0xcd, 0xfd, 0x5b, 0xfe, 0x37, 0xfe,
-    0x5e, 0xfe, 0x18, 0xfe, 0xcb, 0xfd, 0x33, 0xfd,
-    0xf2, 0xfc, 0xd0, 0xfd, 0x61, 0xff, 0x51, 0x00,
-    0xc9, 0xfe, 0x17, 0xfe, 0x4d, 0xfc, 0x85, 0xfc,
-    0x18, 0xfd, 0x99, 0xfc, 0x7c, 0xfc, 0xfb, 0xfa,
-    0x3d, 0xfa, 0x5b, 0xf9, 0xc2, 0xf8, 0x32, 0xf7,
-    0x29, 0xf6, 0x65, 0xf5, 0xf0, 0xf4, 0x3c, 0xf4,
-    0x29, 0xf3, 0xc9, 0xf0, 0x74, 0xef, 0xcf, 0xed,
-    0x72, 0xed, 0x39, 0xed, 0x17, 0xec, 0x77, 0xec,
-    0xe8, 0xea, 0x01, 0xeb, 0xf8, 0xe9, 0x18, 0xea,
-    0x7e, 0xe9, 0x8b, 0xeb, 0x38, 0xec, 0xaa, 0xf0,
-    0x16, 0xf8, 0xdf, 0xf9, 0x0d, 0xfc, 0xac, 0xf8,
-    0x41, 0xf7, 0x88, 0xfa, 0x13, 0x01, 0xf3, 0x06,
-    0x43, 0x0d, 0xcc, 0x0e, 0x7f, 0x0b, 0x1c, 0x09,
-    0x9e, 0x06, 0x20, 0x08, 0x5d, 0x0c, 0x26, 0x11,
-    0x70, 0x14, 0xc0, 0x15, 0xe3, 0x11, 0xf3, 0x0c,
-    0x20, 0x09, 0x25, 0x09, 0xdb, 0x0b, 0x6b, 0x0f,
-    0x37, 0x11, 0x08, 0x10, 0xd5, 0x0c, 0x0c, 0x08,
-    0x99, 0x06, 0x5e, 0x05, 0x25, 0x06, 0xdc, 0x06,
-    0xec, 0x06, 0x4c, 0x06, 0x8f, 0x04, 0x42, 0x02,
-    0x18, 0x00, 0x36, 0x00, 0x3b, 0xff, 0xe6, 0xff,
-    0xb0, 0x00, 0xc3, 0x00, 0x07, 0x01, 0x66, 0x01,
-    0x45, 0x01, 0x95, 0x01, 0x4a, 0x01, 0x13, 0x01,
-    0x71, 0x02, 0x50, 0x04, 0xae, 0x05, 0x7d, 0x06,
-    0x06, 0x07, 0x55, 0x06, 0xcb, 0x06, 0x25, 0x06,
-    0xa7, 0x07, 0x6b, 0x08, 0x9a, 0x09, 0x06, 0x0a,
-    0xfb, 0x09, 0xd4, 0x09, 0xd5, 0x08, 0x7f, 0x08,
-    0x73, 0x07, 0xb3, 0x08, 0x7c, 0x08, 0x41, 0x09,
-    0xc7, 0x07, 0x65, 0x06, 0xb4, 0x04, 0xa8, 0x03,
-    0x9a, 0x03, 0x41, 0x02, 0xd1, 0x02, 0xba, 0x01,
-    0x2a, 0x01, 0x8b, 0xff, 0x51, 0xfe, 0xbb, 0xfd,
-    0xb1, 0xfd, 0xcb, 0xfd, 0x36, 0xfd, 0x63, 0xfd,
-    0x86, 0xfc, 0x04, 0xfc, 0x4b, 0xfb, 0x3e, 0xfc,
-    0x04, 0xfd, 0x3b, 0xfd, 0x4d, 0xfd, 0x94, 0xfc,
-    0xf8, 0xfc, 0x09, 0xfd, 0x7e, 0xfd, 0x09, 0xfe,
-    0x71, 0xfe, 0x1f, 0xfe, 0x7a, 0xfd, 0xee, 0xfc,
-    0x8f, 0xfc, 0xac, 0xfb, 0x55, 0xfb, 0xaa, 0xfb,
-    0x92, 0xfb, 0x09, 0xfb, 0x3d, 0xf9, 0xa4, 0xf7,
-    0xa2, 0xf6, 0x31, 0xf6, 0xf8, 0xf5, 0xa0, 0xf5,
-    0x0e, 0xf5, 0x68, 0xf3, 0x68, 0xf1, 0xca, 0xf0,
-    0x5d, 0xef, 0xd6, 0xee, 0xf0, 0xed, 0xd3, 0xec,
-    0x02, 0xec, 0x33, 0xeb, 0x81, 0xea, 0x2c, 0xea,
-    0x85, 0xea, 0xaa, 0xe8, 0x10, 0xe9, 0xbe, 0xe8,
-    0xb3, 0xe9, 0x59, 0xe9, 0x06, 0xea, 0x30, 0xed,
-    0x9f, 0xf2, 0x9b, 0xf9, 0x6e, 0xfb, 0xc9, 0xfb,
-    0x4d, 0xf9, 0x4e, 0xf9, 0x4f, 0xfd, 0x61, 0x04,
-    0x2f, 0x0b, 0x52, 0x0f, 0x94, 0x0f, 0xbd, 0x0c,
-    0xeb, 0x09, 0xb7, 0x07, 0xec, 0x08, 0x30, 0x0d,
-    0x8e, 0x11, 0xfb, 0x13, 0xe8, 0x12, 0x58, 0x0e,
-    0xb0, 0x09, 0xbc, 0x05, 0xe2, 0x05, 0x2b, 0x09,
-    0xf6, 0x0b, 0x39, 0x0c, 0xce, 0x09, 0xf5, 0x05,
-    0xb7, 0x02, 0xae, 0x01, 0x85, 0x00, 0x44, 0x02,
-    0x14, 0x03, 0x1e, 0x03, 0xdc, 0x02, 0xfd, 0x00,
-    0x2d, 0xff, 0x8d, 0xfd, 0xc1, 0xfd, 0xa2, 0xfe,
-    0x0d, 0x00, 0x38, 0x00, 0x9c, 0x00, 0xad, 0x00,
-    0xc5, 0x01, 0xfe, 0x01, 0x2e, 0x02, 0xfe, 0x02,
-    0x45, 0x03, 0x22, 0x04, 0xdf, 0x05, 0xb1, 0x07,
-    0xe8, 0x07, 0x58, 0x08, 0x7f, 0x07, 0x31, 0x07,
-    0x75, 0x07, 0xa0, 0x06, 0xb4, 0x06, 0x6b, 0x08,
-    0x23, 0x09, 0x18, 0x09, 0x81, 0x09, 0xc1, 0x07,
-    0xbd, 0x06, 0xa7, 0x05, 0xde, 0x04, 0x98, 0x06,
-    0x3b, 0x07, 0xcf, 0x06, 0x4d, 0x06, 0x30, 0x05,
-    0x41, 0x04, 0x1e, 0x03, 0xb6, 0x01, 0x77, 0x01,
-    0x5b, 0x01, 0x50, 0x01, 0xbb, 0x01, 0xaa, 0x01,
-    0x0a, 0x00, 0x2d, 0xff, 0x99, 0xfd, 0x77, 0xfd,
-    0xa3, 0xfd, 0x21, 0xfd, 0xa5, 0xfd, 0x76, 0xfe,
-    0x71, 0xfe, 0x04, 0xfe, 0x87, 0xfd, 0x72, 0xfc,
-    0x33, 0xfd, 0xa8, 0xfd, 0xa6, 0xfe, 0x99, 0xff,
-    0x21, 0xff, 0x34, 0xfe, 0x81, 0xfd, 0x88, 0xfc,
-    0x53, 0xfc, 0x01, 0xfc, 0x28, 0xfc, 0x2d, 0xfc,
-    0x99, 0xfb, 0x84, 0xfa, 0xfa, 0xf8, 0xe7, 0xf7,
-    0xaa, 0xf6, 0x11, 0xf6, 0x9d, 0xf6, 0x85, 0xf6,
-    0xab, 0xf5, 0x23, 0xf4, 0x3c, 0xf2, 0x03, 0xf2,
-    0x0d, 0xf2, 0xbe, 0xf1, 0x5f, 0xf1, 0x85, 0xf0,
-    0xcf, 0xee, 0x4a, 0xee, 0x76, 0xed, 0x34, 0xed,
-    0xb9, 0xec, 0xc1, 0xec, 0x0f, 0xec, 0x0b, 0xec,
-    0x9a, 0xeb, 0xcf, 0xea, 0xf7, 0xeb, 0xa3, 0xec,
-    0xb1, 0xec, 0x1d, 0xee, 0x69, 0xf1, 0x75, 0xf5,
-    0xa2, 0xfd, 0x45, 0x01, 0x3a, 0x02, 0x7f, 0x00,
-    0xce, 0xfe, 0x6a, 0x01, 0xda, 0x08, 0x55, 0x0f,
-    0xb5, 0x13, 0xc9, 0x15, 0x09, 0x12, 0x76, 0x0e,
-    0x29, 0x0a, 0xc9, 0x09, 0x39, 0x0c, 0xcd, 0x10,
-    0xfa, 0x13, 0x09, 0x14, 0x1f, 0x10, 0xb7, 0x09,
-    0x91, 0x04, 0x42, 0x03, 0xc9, 0x05, 0xd9, 0x08,
-    0xf3, 0x0a, 0x32, 0x0a, 0x2d, 0x07, 0xa6, 0x03,
-    0x95, 0x01, 0x92, 0x00, 0x4f, 0x01, 0xc2, 0x02,
-    0xed, 0x03, 0xff, 0x03, 0x48, 0x03, 0xd4, 0x01,
-    0x82, 0x00, 0xf3, 0x00, 0xe3, 0x00, 0xc0, 0x01,
-    0x71, 0x02, 0xc7, 0x02, 0x5f, 0x03, 0x44, 0x04,
-    0xb8, 0x05, 0x97, 0x06, 0x5e, 0x07, 0xec, 0x06,
-    0xdd, 0x06, 0xe3, 0x07, 0x72, 0x09, 0x65, 0x0a,
-    0x9c, 0x0b, 0xc5, 0x0b, 0x15, 0x0b, 0x7f, 0x09,
-    0x41, 0x08, 0x3f, 0x08, 0x32, 0x09, 0xe5, 0x09,
-    0x8b, 0x0a, 0xeb, 0x0a, 0xfb, 0x09, 0x17, 0x08,
-    0x28, 0x06, 0xa9, 0x05, 0x57, 0x05, 0xf7, 0x05,
-    0xd2, 0x05, 0xf7, 0x06, 0x0b, 0x06, 0xde, 0x04,
-    0x91, 0x03, 0xe3, 0x01, 0x4f, 0x01, 0x09, 0x01,
-    0xeb, 0x01, 0xa8, 0x02, 0x18, 0x03, 0x98, 0x01,
-    0xeb, 0x00, 0x5f, 0xff, 0xa3, 0xfe, 0xeb, 0xfe,
-    0x0a, 0xff, 0xb2, 0xff, 0x64, 0xff, 0xb4, 0xff,
-    0xf1, 0xff, 0xdd, 0xff, 0x31, 0xff, 0x78, 0xfe,
-    0x1a, 0xfe, 0x64, 0xfe, 0x55, 0xff, 0x51, 0x00,
-    0x2e, 0x00, 0x53, 0xff, 0x96, 0xfe, 0x77, 0xfd,
-    0x22, 0xfd, 0xcb, 0xfb, 0x58, 0xfb, 0x68, 0xfb,
-    0x60, 0xfb, 0x7d, 0xfb, 0x71, 0xfa, 0xfa, 0xf8,
-    0x0b, 0xf7, 0x53, 0xf5, 0x68, 0xf4, 0x20, 0xf4,
-    0x68, 0xf4, 0xda, 0xf4, 0x6d, 0xf4, 0xdb, 0xf2,
-    0x4d, 0xf1, 0xad, 0xef, 0xe8, 0xee, 0x4a, 0xee,
-    0x34, 0xee, 0xb3, 0xee, 0x10, 0xee, 0x67, 0xed,
-    0x3c, 0xec, 0xbc, 0xeb, 0x0d, 0xeb, 0x1c, 0xec,
-    0x9a, 0xeb, 0x40, 0xed, 0x93, 0xed, 0x94, 0xec,
-    0xa5, 0xed, 0x9e, 0xf0, 0xb4, 0xf7, 0xf7, 0x00,
-    0xd4, 0x06, 0xbb, 0x03, 0xea, 0x00, 0xce, 0xfd,
-    0x57, 0x01, 0x69, 0x09, 0x8b, 0x10, 0xf8, 0x15,
-    0x01, 0x18, 0xee, 0x14, 0xc0, 0x0e, 0x95, 0x0a,
-    0xf7, 0x07, 0xfc, 0x09, 0xaa, 0x0f, 0xa3, 0x14,
-    0x28, 0x15, 0xe2, 0x11, 0x01, 0x0a, 0xab, 0x03,
-    0xfc, 0x01, 0x1f, 0x03, 0x22, 0x07, 0x80, 0x09,
-    0xaf, 0x08, 0x1e, 0x06, 0x8e, 0x03, 0x37, 0x01,
-    0xf1, 0xff, 0x06, 0x00, 0x89, 0x00, 0x2f, 0x02,
-    0x7c, 0x02, 0x77, 0x02, 0xa6, 0x01, 0xf2, 0x00,
-    0xb2, 0x00, 0x5c, 0x01, 0x9b, 0x01, 0x47, 0x01,
-    0xc4, 0x01, 0x00, 0x02, 0x74, 0x04, 0xd3, 0x06,
-    0x7f, 0x08, 0xc6, 0x08, 0x8d, 0x07, 0x45, 0x06,
-    0xf0, 0x06, 0x82, 0x08, 0x3a, 0x0a, 0x02, 0x0c,
-    0x82, 0x0c, 0x69, 0x0c, 0x3f, 0x0a, 0x80, 0x08,
-    0x4e, 0x07, 0x5b, 0x07, 0xb6, 0x08, 0x42, 0x0a,
-    0x54, 0x0b, 0xac, 0x0a, 0xd4, 0x08, 0xc2, 0x05,
-    0xbe, 0x04, 0x8f, 0x04, 0x56, 0x05, 0x9a, 0x06,
-    0xb8, 0x06, 0x56, 0x06, 0xed, 0x05, 0xaf, 0x04,
-    0x53, 0x03, 0xb2, 0x02, 0x11, 0x02, 0xf5, 0x01,
-    0xf7, 0x01, 0x1c, 0x02, 0xa9, 0x02, 0xae, 0x02,
-    0xff, 0x01, 0xc5, 0x00, 0x47, 0xff, 0x21, 0xfe,
-    0x60, 0xfd, 0xae, 0xfe, 0x2e, 0x00, 0x1a, 0x01,
-    0x32, 0x01, 0xe9, 0xff, 0x50, 0xfe, 0x40, 0xfd,
-    0xf2, 0xfc, 0x79, 0xfe, 0x0a, 0x00, 0xb8, 0x00,
-    0x5a, 0x00, 0x17, 0xff, 0xe0, 0xfc, 0xec, 0xfa,
-    0x0e, 0xfa, 0xf1, 0xf9, 0xd4, 0xfa, 0xbf, 0xfa,
-    0x6a, 0xfa, 0x3e, 0xf9, 0x8e, 0xf7, 0x94, 0xf5,
-    0x3a, 0xf4, 0xd7, 0xf3, 0x9a, 0xf3, 0x70, 0xf3,
-    0x13, 0xf3, 0x8e, 0xf2, 0x1e, 0xf2, 0x3f, 0xf1,
-    0xc7, 0xef, 0xb7, 0xee, 0x0c, 0xee, 0xd8, 0xec,
-    0x7d, 0xec, 0x71, 0xeb, 0x52, 0xec, 0x58, 0xec,
-    0xf5, 0xeb, 0xb1, 0xeb, 0xfb, 0xe9, 0xb3, 0xea,
-    0x8e, 0xea, 0x75, 0xea, 0xcc, 0xea, 0x62, 0xec,
-    0x46, 0xf0, 0x1c, 0xfb, 0x03, 0x03, 0x5c, 0x06,
-    0x38, 0x05, 0x5c, 0xfe, 0x3e, 0xfe, 0x44, 0x02,
-    0x7f, 0x08, 0xbc, 0x10, 0x42, 0x16, 0xdc, 0x16,
-    0x0f, 0x15, 0x8b, 0x0f, 0x13, 0x09, 0xb0, 0x06,
-    0xd2, 0x07, 0xc6, 0x0b, 0x80, 0x11, 0xfe, 0x12,
-    0x59, 0x0f, 0x1a, 0x0a, 0xef, 0x03, 0x6e, 0x01,
-    0x49, 0x02, 0x13, 0x03, 0x1e, 0x03, 0x39, 0x03,
-    0x25, 0x02, 0x71, 0x02, 0x91, 0x02, 0xc1, 0x00,
-    0xc0, 0xff, 0xe8, 0xfd, 0x24, 0xfd, 0x00, 0xfd,
-    0xcb, 0xfd, 0x45, 0xff, 0x1e, 0x02, 0x26, 0x04,
-    0xc5, 0x03, 0xdd, 0x02, 0xb7, 0x00, 0x80, 0xff,
-    0xa1, 0x00, 0xd6, 0x03, 0x52, 0x07, 0xe9, 0x0a,
-    0x07, 0x0b, 0xc5, 0x09, 0x44, 0x09, 0xf2, 0x07,
-    0x1c, 0x08, 0xf9, 0x08, 0xe1, 0x09, 0x50, 0x0a,
-    0xff, 0x0a, 0x33, 0x0a, 0x51, 0x09, 0x64, 0x08,
-    0xcb, 0x06, 0x06, 0x06, 0x29, 0x06, 0x85, 0x06,
-    0xb9, 0x06, 0x61, 0x07, 0x69, 0x06, 0x96, 0x05,
-    0x09, 0x05, 0xcc, 0x03, 0x6d, 0x03, 0x85, 0x03,
-    0xfb, 0x03, 0x9c, 0x04, 0x59, 0x04, 0x83, 0x03,
-    0x93, 0x02, 0xa6, 0x02, 0x5b, 0x02, 0xc3, 0x02,
-    0x3b, 0x02, 0x22, 0x02, 0x1d, 0x02, 0xe9, 0x01,
-    0x86, 0x02, 0x79, 0x01, 0x5f, 0x01, 0x55, 0x00,
-    0xc0, 0xff, 0xea, 0xff, 0x13, 0x00, 0x62, 0x00,
-    0x3f, 0x00, 0x29, 0x00, 0x34, 0x00, 0xf3, 0xff,
-    0x15, 0xff, 0x35, 0xfe, 0xef, 0xfd, 0xcf, 0xfd,
-    0x08, 0xfe, 0xc1, 0xfd, 0x0f, 0xfd, 0xf8, 0xfb,
-    0x7d, 0xfa, 0x50, 0xf9, 0xb6, 0xf8, 0x2e, 0xf8,
-    0x70, 0xf7, 0x0f, 0xf7, 0x1c, 0xf6, 0x20, 0xf5,
-    0x1f, 0xf4, 0x54, 0xf3, 0xc9, 0xf1, 0x74, 0xf1,
-    0x92, 0xf0, 0x30, 0xf0, 0x3f, 0xf0, 0x8b, 0xef,
-    0xb7, 0xee, 0x3d, 0xee, 0xbe, 0xec, 0xa3, 0xeb,
-    0xb0, 0xeb, 0x02, 0xeb, 0x49, 0xeb, 0x6a, 0xeb,
-    0x5a, 0xeb, 0x36, 0xeb, 0xdd, 0xeb, 0xca, 0xea,
-    0x3c, 0xed, 0x58, 0xec, 0xa4, 0xed, 0x47, 0xee,
-    0x44, 0xf0, 0x03, 0xf9, 0xf4, 0x00, 0x4a, 0x09,
-    0x21, 0x0a, 0x8a, 0x06, 0x88, 0x01, 0x3d, 0x03,
-    0x9d, 0x06, 0x00, 0x0e, 0x97, 0x14, 0xba, 0x16,
-    0xd7, 0x17, 0x90, 0x13, 0x76, 0x0e, 0xc8, 0x09,
-    0x55, 0x08, 0xe5, 0x08, 0xea, 0x0b, 0x6c, 0x0e,
-    0xd9, 0x0d, 0x15, 0x0b, 0x4f, 0x07, 0xa2, 0x03,
-    0xce, 0x02, 0x5f, 0x02, 0x0f, 0x01, 0xb3, 0xff,
-    0xed, 0xfe, 0x74, 0xff, 0xfc, 0x00, 0x5c, 0x02,
-    0xcf, 0x01, 0x03, 0x01, 0xd9, 0xfe, 0x8d, 0xfd,
-    0xc3, 0xfc, 0x65, 0xfe, 0x6e, 0x00, 0x41, 0x03,
-    0xdb, 0x05, 0x1c, 0x06, 0xd6, 0x05, 0xe0, 0x03,
-    0x2f, 0x03, 0x92, 0x03, 0x2c, 0x06, 0x07, 0x09,
-    0x94, 0x0b, 0x19, 0x0c, 0x67, 0x0b, 0x8b, 0x0a,
-    0xad, 0x09, 0x51, 0x09, 0xbe, 0x08, 0x6b, 0x08,
-    0x54, 0x08, 0xb9, 0x07, 0x76, 0x07, 0x73, 0x07,
-    0x84, 0x07, 0x1e, 0x07, 0xca, 0x05, 0xc4, 0x04,
-    0xb7, 0x03, 0xaf, 0x03, 0xa0, 0x03, 0x73, 0x04,
-    0xbc, 0x04, 0x3b, 0x05, 0x4a, 0x04, 0x8c, 0x03,
-    0x1a, 0x03, 0x7f, 0x02, 0xda, 0x02, 0x8a, 0x02,
-    0xba, 0x02, 0xa3, 0x02, 0xfb, 0x02, 0x7b, 0x02,
-    0x6b, 0x02, 0x14, 0x02, 0xd3, 0x01, 0x5a, 0x01,
-    0x5b, 0x00, 0xdf, 0xff, 0x9e, 0xff, 0x45, 0x00,
-    0x52, 0x00, 0x6a, 0x00, 0x35, 0x00, 0x92, 0xff,
-    0xf4, 0xfe, 0xb8, 0xfe, 0x15, 0xff, 0x57, 0xff,
-    0x85, 0xff, 0xff, 0xfe, 0x88, 0xfe, 0x53, 0xfe,
-    0x89, 0xfd, 0x34, 0xfd, 0xc8, 0xfc, 0x74, 0xfc,
-    0xb3, 0xfb, 0xe0, 0xfa, 0xe7, 0xf9, 0x6e, 0xf9,
-    0x04, 0xf9, 0x04, 0xf8, 0x48, 0xf7, 0xf4, 0xf5,
-    0x7b, 0xf5, 0x60, 0xf4, 0xdd, 0xf3, 0x11, 0xf3,
-    0x09, 0xf2, 0x63, 0xf1, 0x4e, 0xf0, 0xa6, 0xef,
-    0xff, 0xee, 0x08, 0xee, 0xa2, 0xec, 0x1a, 0xec,
-    0x40, 0xeb, 0xe3, 0xea, 0x75, 0xeb, 0xc5, 0xea,
-    0x07, 0xeb, 0xd6, 0xea, 0xb2, 0xea, 0xe8, 0xea,
-    0xab, 0xeb, 0x1f, 0xec, 0x99, 0xec, 0x5c, 0xee,
-    0xf4, 0xee, 0x00, 0xf6, 0x6c, 0xff, 0x40, 0x09,
-    0x14, 0x0d, 0x0d, 0x0a, 0xd0, 0x04, 0x20, 0x03,
-    0x48, 0x08, 0xda, 0x0c, 0x10, 0x14, 0xe4, 0x16,
-    0x9c, 0x17, 0x96, 0x16, 0x64, 0x12, 0x91, 0x0d,
-    0x54, 0x09, 0x57, 0x08, 0x65, 0x08, 0x52, 0x0b,
-    0x20, 0x0c, 0x73, 0x0a, 0x0c, 0x09, 0x8c, 0x05,
-    0xc6, 0x03, 0x8e, 0x01, 0x92, 0xfe, 0xbe, 0xfb,
-    0xb9, 0xfa, 0xfa, 0xfc, 0x8c, 0xff, 0xf7, 0x02,
-    0xe6, 0x02, 0xbe, 0x01, 0x4f, 0x00, 0xd9, 0xfd,
-    0x58, 0xfd, 0x8a, 0xfd, 0x0f, 0x00, 0x74, 0x03,
-    0x6f, 0x07, 0x0d, 0x09, 0xae, 0x08, 0x96, 0x07,
-    0x97, 0x05, 0xa4, 0x06, 0xd6, 0x07, 0x3b, 0x0a,
-    0x7c, 0x0b, 0x1b, 0x0c, 0x83, 0x0c, 0x2e, 0x0d,
-    0xda, 0x0d, 0x27, 0x0c, 0xac, 0x0a, 0x1e, 0x08,
-    0x7e, 0x06, 0xde, 0x05, 0x26, 0x06, 0x5d, 0x07,
-    0x45, 0x08, 0xe9, 0x07, 0x4d, 0x06, 0xa1, 0x04,
-    0x1c, 0x03, 0x0a, 0x02, 0x4a, 0x02, 0x18, 0x03,
-    0x54, 0x04, 0x8d, 0x05, 0x64, 0x05, 0x1e, 0x05,
-    0xec, 0x03, 0x58, 0x03, 0xad, 0x02, 0x3c, 0x02,
-    0x8f, 0x02, 0xb1, 0x02, 0x96, 0x03, 0x7d, 0x03,
-    0xe1, 0x03, 0xc1, 0x03, 0x6c, 0x03, 0xae, 0x02,
-    0x14, 0x01, 0x95, 0x00, 0x9c, 0xff, 0xb1, 0xff,
-    0x67, 0x00, 0x3d, 0x01, 0x84, 0x01, 0xab, 0x00,
-    0x6d, 0xff, 0x6a, 0xfe, 0x8e, 0xfe, 0x8b, 0xfe,
-    0xbd, 0xfe, 0xd1, 0xfe, 0x5b, 0xfe, 0x43, 0xfe,
-    0x36, 0xfe, 0x6a, 0xfd, 0x26, 0xfd, 0xbd, 0xfc,
-    0x48, 0xfc, 0xc8, 0xfb, 0x9a, 0xfa, 0x94, 0xf9,
-    0x3d, 0xf9, 0x26, 0xf9, 0xa2, 0xf8, 0x9f, 0xf8,
-    0x71, 0xf7, 0xbd, 0xf5, 0x74, 0xf4, 0x36, 0xf3,
-    0xdd, 0xf2, 0xec, 0xf2, 0x7b, 0xf2, 0xa9, 0xf1,
-    0x26, 0xf1, 0xc3, 0xef, 0x60, 0xee, 0x0c, 0xee,
-    0x5c, 0xed, 0x44, 0xed, 0xb3, 0xed, 0x17, 0xec,
-    0xb2, 0xeb, 0x88, 0xeb, 0x78, 0xeb, 0xaf, 0xec,
-    0xe1, 0xec, 0x09, 0xed, 0x74, 0xed, 0x5f, 0xee,
-    0xb3, 0xed, 0x00, 0xf0, 0xc4, 0xf3, 0xc7, 0xfc,
-    0xa3, 0x07, 0x31, 0x0d, 0x4b, 0x0d, 0x00, 0x08,
-    0x2a, 0x05, 0x42, 0x06, 0xb6, 0x0b, 0x9f, 0x10,
-    0x0f, 0x15, 0x38, 0x17, 0xb9, 0x16, 0x85, 0x14,
-    0x42, 0x10, 0xf0, 0x0b, 0x8b, 0x08, 0x22, 0x07,
-    0x9d, 0x07, 0xcb, 0x08, 0x83, 0x09, 0x79, 0x08,
-    0x38, 0x07, 0xd0, 0x05, 0x8a, 0x03, 0xf7, 0x00,
-    0x57, 0xfd, 0x3b, 0xfb, 0x16, 0xfb, 0x51, 0xfe,
-    0x58, 0x01, 0xf3, 0x03, 0x38, 0x04, 0xd5, 0x02,
-    0x59, 0x01, 0xad, 0xff, 0x37, 0xff, 0xe0, 0xff,
-    0xba, 0x02, 0xc2, 0x05, 0xa8, 0x08, 0x41, 0x0a,
-    0xc3, 0x09, 0x1a, 0x09, 0xb5, 0x08, 0x18, 0x09,
-    0x3f, 0x0a, 0xa7, 0x0a, 0x9e, 0x0a, 0xd2, 0x0a,
-    0xb3, 0x0b, 0xed, 0x0c, 0x28, 0x0d, 0xc2, 0x0b,
-    0x84, 0x09, 0xc2, 0x06, 0x9e, 0x04, 0xb0, 0x03,
-    0x00, 0x04, 0x45, 0x05, 0xf4, 0x06, 0xb4, 0x06,
-    0xf4, 0x05, 0x4b, 0x04, 0x33, 0x02, 0x75, 0x01,
-    0xa3, 0x01, 0xd1, 0x02, 0x37, 0x04, 0xd9, 0x04,
-    0xb5, 0x04, 0x32, 0x05, 0x15, 0x05, 0xdd, 0x04,
-    0x0d, 0x04, 0x51, 0x03, 0x08, 0x03, 0xcd, 0x02,
-    0xb2, 0x02, 0xac, 0x02, 0x3a, 0x03, 0x78, 0x03,
-    0x86, 0x03, 0x1b, 0x02, 0x5c, 0x00, 0xfe, 0xfe,
-    0xae, 0xfd, 0x84, 0xfe, 0x35, 0xff, 0x44, 0x00,
-    0x36, 0x00, 0x4b, 0xff, 0x49, 0xfe, 0xb6, 0xfd,
-    0xea, 0xfd, 0x6e, 0xfd, 0xef, 0xfd, 0xc6, 0xfd,
-    0x1d, 0xfe, 0xde, 0xfd, 0x81, 0xfd, 0x65, 0xfd,
-    0x7b, 0xfd, 0x78, 0xfd, 0x2c, 0xfc, 0xe7, 0xfa,
-    0xb8, 0xf9, 0x5b, 0xf9, 0x8c, 0xf9, 0xc2, 0xf9,
-    0x1e, 0xf9, 0x56, 0xf8, 0x9f, 0xf6, 0xd3, 0xf4,
-    0x56, 0xf3, 0xa2, 0xf2, 0x3e, 0xf2, 0x4e, 0xf2,
-    0x2b, 0xf2, 0xf9, 0xf0, 0x62, 0xf0, 0xae, 0xee,
-    0xe4, 0xed, 0x48, 0xed, 0x62, 0xed, 0xfe, 0xec,
-    0xff, 0xec, 0xdd, 0xec, 0x37, 0xec, 0xa5, 0xec,
-    0xf8, 0xec, 0x35, 0xed, 0x94, 0xee, 0xf5, 0xee,
-    0xa6, 0xee, 0x2c, 0xef, 0x01, 0xee, 0xe1, 0xef,
-    0x13, 0xf6, 0x29, 0x01, 0x2b, 0x0b, 0x91, 0x11,
-    0x58, 0x0e, 0x73, 0x08, 0x5a, 0x06, 0x15, 0x06,
-    0x47, 0x0c, 0xc6, 0x10, 0xae, 0x14, 0x42, 0x16,
-    0x4c, 0x15, 0xfd, 0x11, 0x93, 0x0d, 0xee, 0x09,
-    0x17, 0x06, 0x72, 0x05, 0x03, 0x05, 0x91, 0x05,
-    0x93, 0x05, 0x60, 0x04, 0x88, 0x04, 0x27, 0x04,
-    0x3d, 0x04, 0xa4, 0x01, 0xac, 0xfd, 0xbb, 0xfa,
-    0xd3, 0xf9, 0xc0, 0xfc, 0xd7, 0x00, 0x95, 0x04,
-    0xeb, 0x05, 0x30, 0x05, 0x0e, 0x03, 0x36, 0x01,
-    0xa7, 0x00, 0x61, 0x01, 0xcf, 0x03, 0x96, 0x06,
-    0x22, 0x09, 0x80, 0x0a, 0x9c, 0x0a, 0x52, 0x0a,
-    0x19, 0x0a, 0xf8, 0x0a, 0xf4, 0x0a, 0x9b, 0x0a,
-    0x4e, 0x09, 0x65, 0x08, 0x6f, 0x09, 0x8d, 0x0a,
-    0x6d, 0x0b, 0xce, 0x0a, 0xd2, 0x08, 0xd2, 0x05,
-    0x28, 0x03, 0x3a, 0x01, 0x01, 0x01, 0xac, 0x02,
-    0xee, 0x03, 0xd8, 0x04, 0xc2, 0x04, 0xca, 0x03,
-    0x60, 0x03, 0x53, 0x02, 0x9b, 0x02, 0xc5, 0x02,
-    0x55, 0x03, 0xe7, 0x03, 0xcb, 0x03, 0x7b, 0x04,
-    0x05, 0x05, 0x5b, 0x05, 0xc6, 0x04, 0x68, 0x04,
-    0xd8, 0x02, 0xda, 0x01, 0xd9, 0x00, 0x1a, 0x00,
-    0x3d, 0x01, 0x61, 0x02, 0x09, 0x03, 0x5c, 0x02,
-    0xb3, 0x00, 0xaf, 0xfe, 0x5b, 0xfd, 0xea, 0xfc,
-    0x0f, 0xfd, 0x2a, 0xfe, 0xc2, 0xfe, 0xbb, 0xfe,
-    0x4f, 0xfe, 0x0d, 0xfe, 0x37, 0xfe, 0x35, 0xfe,
-    0xed, 0xfd, 0x3e, 0xfd, 0xca, 0xfc, 0x41, 0xfc,
-    0x56, 0xfc, 0xb9, 0xfc, 0xa8, 0xfd, 0x42, 0xfe,
-    0xa0, 0xfd, 0x77, 0xfc, 0xda, 0xfa, 0xc6, 0xf9,
-    0xf7, 0xf8, 0xc1, 0xf8, 0xe7, 0xf8, 0xa7, 0xf8,
-    0xfa, 0xf7, 0x09, 0xf6, 0xa2, 0xf4, 0x10, 0xf3,
-    0xc6, 0xf2, 0xad, 0xf1, 0x06, 0xf1, 0x50, 0xf0,
-    0x28, 0xef, 0x0f, 0xef, 0x46, 0xee, 0x25, 0xee,
-    0x94, 0xed, 0x33, 0xed, 0x7a, 0xec, 0x9e, 0xec,
-    0xef, 0xeb, 0xb4, 0xec, 0x48, 0xec, 0xae, 0xed,
-    0xa7, 0xed, 0x2d, 0xef, 0x03, 0xef, 0x32, 0xef,
-    0x89, 0xef, 0xe5, 0xf0, 0xd2, 0xf9, 0x9a, 0x01,
-    0x20, 0x0c, 0x6e, 0x0d, 0xa3, 0x0c, 0x00, 0x09,
-    0x94, 0x08, 0x71, 0x0a, 0x3c, 0x0c, 0xab, 0x10,
-    0xb5, 0x11, 0x96, 0x14, 0xa1, 0x13, 0xa6, 0x11,
-    0xa9, 0x0d, 0xed, 0x09, 0xc9, 0x06, 0xb5, 0x04,
-    0x8b, 0x04, 0xaa, 0x03, 0xcc, 0x03, 0x26, 0x04,
-    0x30, 0x04, 0x67, 0x04, 0xd3, 0x02, 0x84, 0xff,
-    0xa0, 0xfc, 0x90, 0xfa, 0x58, 0xfb, 0x74, 0xfd,
-    0xa4, 0x00, 0x2a, 0x03, 0x11, 0x05, 0x6f, 0x05,
-    0x8c, 0x04, 0x8c, 0x03, 0x29, 0x02, 0x15, 0x03,
-    0x64, 0x04, 0x32, 0x07, 0x2a, 0x09, 0xae, 0x0a,
-    0xfb, 0x0a, 0xbb, 0x0b, 0xfd, 0x0b, 0x0d, 0x0c,
-    0x63, 0x0b, 0x93, 0x09, 0x4b, 0x08, 0xc3, 0x07,
-    0x99, 0x08, 0xfb, 0x08, 0x99, 0x09, 0x79, 0x08,
-    0x74, 0x07, 0x3b, 0x05, 0xe5, 0x02, 0x40, 0x01,
-    0x45, 0x00, 0xf7, 0x00, 0x8b, 0x01, 0xa7, 0x02,
-    0x41, 0x03, 0x44, 0x03, 0xb9, 0x03, 0x5c, 0x03,
-    0xb1, 0x03, 0xf7, 0x02, 0xf7, 0x02, 0xe3, 0x02,
-    0x83, 0x03, 0xbb, 0x04, 0x63, 0x05, 0x74, 0x06,
-    0xf1, 0x05, 0xb4, 0x05, 0x2f, 0x04, 0x05, 0x03,
-    0xd2, 0x01, 0x95, 0x00, 0x2d, 0x01, 0xb1, 0x01,
-    0xcc, 0x01, 0x0a, 0x02, 0xfe, 0x00, 0xb4, 0xff,
-    0x26, 0xff, 0xcf, 0xfd, 0x19, 0xfd, 0x40, 0xfd,
-    0x78, 0xfc, 0x76, 0xfc, 0x76, 0xfd, 0xf3, 0xfd,
-    0xd6, 0xfe, 0xf5, 0xfe, 0xdf, 0xfd, 0x39, 0xfd,
-    0x6f, 0xfc, 0x01, 0xfc, 0xbe, 0xfb, 0x77, 0xfc,
-    0x23, 0xfd, 0x0d, 0xfe, 0x0a, 0xfe, 0x01, 0xfd,
-    0x2d, 0xfc, 0xce, 0xfa, 0x7d, 0xfa, 0x8f, 0xf9,
-    0x76, 0xf9, 0xa7, 0xf8, 0x25, 0xf8, 0x2c, 0xf7,
-    0x4f, 0xf6, 0x5a, 0xf5, 0x08, 0xf4, 0x35, 0xf3,
-    0x78, 0xf1, 0xec, 0xf0, 0x17, 0xef, 0x8a, 0xee,
-    0xb1, 0xee, 0x84, 0xee, 0x82, 0xee, 0xed, 0xee,
-    0xa0, 0xed, 0x24, 0xed, 0x05, 0xed, 0xcd, 0xeb,
-    0xc8, 0xec, 0x4a, 0xed, 0x3c, 0xed, 0x50, 0xed,
-    0x1d, 0xef, 0xe5, 0xee, 0xae, 0xf1, 0xec, 0xf2,
-    0x68, 0xf4, 0x2f, 0xfb, 0xdd, 0x02, 0x1a, 0x0b,
-    0x92, 0x0e, 0xfe, 0x0d, 0x35, 0x0b, 0xf6, 0x0b,
-    0x1b, 0x0c, 0xb0, 0x0d, 0x17, 0x0f, 0x3c, 0x10,
-    0xec, 0x12, 0x4b, 0x12, 0xf6, 0x10, 0x46, 0x0d,
-    0x1c, 0x0a, 0x6f, 0x07, 0x8a, 0x05, 0xe5, 0x03,
-    0x8d, 0x02, 0x05, 0x02, 0x6e, 0x01, 0x95, 0x02,
-    0x54, 0x03, 0xb9, 0x02, 0x4e, 0x01, 0x88, 0xfd,
-    0x1e, 0xfc, 0xec, 0xfb, 0x3c, 0xfd, 0xa0, 0xff,
-    0xfd, 0x01, 0xe2, 0x04, 0x4f, 0x06, 0x57, 0x07,
-    0x16, 0x06, 0x2c, 0x06, 0x30, 0x06, 0xa7, 0x06,
-    0x1f, 0x08, 0xc6, 0x08, 0x3b, 0x0a, 0x68, 0x0b,
-    0xe2, 0x0c, 0x98, 0x0d, 0x11, 0x0e, 0xea, 0x0c,
-    0x89, 0x0a, 0xe0, 0x08, 0xac, 0x06, 0xb9, 0x06,
-    0x34, 0x07, 0x85, 0x07, 0x72, 0x07, 0xa5, 0x06,
-    0x29, 0x05, 0x6e, 0x03, 0xce, 0x01, 0x62, 0x00,
-    0x24, 0x00, 0x61, 0x00, 0x37, 0x01, 0x04, 0x02,
-    0x3d, 0x03, 0xad, 0x04, 0x53, 0x05, 0xf7, 0x05,
-    0xd0, 0x05, 0xcf, 0x04, 0xae, 0x04, 0x52, 0x04,
-    0xb8, 0x04, 0xd2, 0x05, 0x12, 0x07, 0x3d, 0x07,
-    0x86, 0x07, 0x00, 0x06, 0x0b, 0x04, 0xad, 0x02,
-    0x23, 0x01, 0x7b, 0x00, 0xbf, 0x00, 0xe0, 0x00,
-    0x65, 0x00, 0x6d, 0x00, 0xd4, 0xfe, 0x69, 0xfe,
-    0xfd, 0xfd, 0xfe, 0xfc, 0x6b, 0xfc, 0x2f, 0xfb,
-    0x7b, 0xfa, 0x10, 0xfb, 0xb5, 0xfb, 0xee, 0xfc,
-    0xb4, 0xfd, 0x2d, 0xfe, 0x2a, 0xfe, 0xa0, 0xfd,
-    0x76, 0xfc, 0xe1, 0xfb, 0x0c, 0xfc, 0x84, 0xfc,
-    0xce, 0xfd, 0xd7, 0xfd, 0xb6, 0xfd, 0xc2, 0xfc,
-    0x19, 0xfc, 0xbd, 0xfb, 0xde, 0xfa, 0xd7, 0xf9,
-    0x06, 0xf9, 0xfb, 0xf7, 0x14, 0xf7, 0x40, 0xf6,
-    0x6f, 0xf5, 0x15, 0xf5, 0xb2, 0xf4, 0x68, 0xf3,
-    0x5b, 0xf2, 0xb9, 0xf1, 0x08, 0xf0, 0x5d, 0xef,
-    0x60, 0xef, 0x5f, 0xef, 0x89, 0xef, 0xb5, 0xef,
-    0xc3, 0xee, 0x98, 0xee, 0xef, 0xed, 0xf5, 0xec,
-    0xb6, 0xed, 0x4d, 0xee, 0xef, 0xee, 0xb1, 0xf0,
-    0x61, 0xf1, 0xac, 0xf1, 0xd3, 0xf3, 0xce, 0xf4,
-    0x8b, 0xfd, 0xd9, 0x06, 0xb2, 0x0c, 0x57, 0x10,
-    0x64, 0x0d, 0x12, 0x0b, 0x48, 0x0c, 0xf7, 0x0c,
-    0xe3, 0x0c, 0xcf, 0x0f, 0x55, 0x0f, 0xd3, 0x10,
-    0xff, 0x10, 0xd3, 0x0d, 0x14, 0x0c, 0x8d, 0x09,
-    0x7b, 0x06, 0x6f, 0x04, 0xdc, 0x02, 0x78, 0x00,
-    0x42, 0x00, 0xb1, 0x00, 0xf1, 0x01, 0x27, 0x04,
-    0xe7, 0x02, 0xed, 0x00, 0x39, 0xff, 0x94, 0xfd,
-    0x89, 0xfd, 0x6f, 0xfe, 0xc0, 0xff, 0x5a, 0x02,
-    0x9d, 0x05, 0x06, 0x07, 0x40, 0x08, 0xa8, 0x07,
-    0xb3, 0x07, 0x11, 0x08, 0x70, 0x08, 0x94, 0x08,
-    0x60, 0x09, 0xb2, 0x09, 0xd0, 0x0a, 0xfb, 0x0b,
-    0xf4, 0x0c, 0xf6, 0x0d, 0x35, 0x0c, 0x7f, 0x09,
-    0x13, 0x07, 0x12, 0x06, 0x5b, 0x05, 0xb7, 0x05,
-    0x4f, 0x05, 0x6c, 0x05, 0x1e, 0x05, 0x24, 0x04,
-    0xf4, 0x02, 0x5b, 0x01, 0x8a, 0x00, 0x98, 0xff,
-    0xbf, 0xff, 0x29, 0x00, 0x7f, 0x01, 0x30, 0x03,
-    0xea, 0x04, 0x08, 0x06, 0x65, 0x06, 0x4a, 0x06,
-    0x5a, 0x05, 0x2f, 0x05, 0xdd, 0x04, 0x3a, 0x06,
-    0xb8, 0x06, 0xe2, 0x06, 0x3b, 0x07, 0x2e, 0x07,
-    0x61, 0x06, 0x32, 0x05, 0x4b, 0x03, 0x64, 0x01,
-    0xca, 0x00, 0xa8, 0xff, 0x19, 0xff, 0xe2, 0xfe,
-    0xab, 0xfe, 0x07, 0xfe, 0x17, 0xfe, 0x3c, 0xfd,
-    0x0c, 0xfc, 0x65, 0xfb, 0x30, 0xfa, 0xb6, 0xf9,
-    0x75, 0xfa, 0x62, 0xfb, 0x1f, 0xfc, 0x1e, 0xfd,
-    0x47, 0xfd, 0xca, 0xfd, 0x3f, 0xfe, 0x5d, 0xfd,
-    0xf8, 0xfc, 0xca, 0xfc, 0x06, 0xfd, 0x05, 0xfd,
-    0x24, 0xfd, 0xb7, 0xfc, 0x09, 0xfd, 0x75, 0xfc,
-    0x9a, 0xfb, 0x93, 0xfa, 0x62, 0xf9, 0xff, 0xf7,
-    0xf4, 0xf6, 0xce, 0xf5, 0xb0, 0xf4, 0xaf, 0xf4,
-    0xff, 0xf3, 0xa6, 0xf3, 0xe1, 0xf2, 0x43, 0xf2,
-    0xba, 0xf0, 0x95, 0xf0, 0x7e, 0xef, 0x1b, 0xef,
-    0xca, 0xee, 0x4f, 0xee, 0xdb, 0xed, 0xf3, 0xed,
-    0x18, 0xed, 0x71, 0xec, 0x91, 0xeb, 0x42, 0xec,
-    0xf7, 0xed, 0xb9, 0xee, 0xc4, 0xef, 0x1a, 0xf0,
-    0x98, 0xef, 0x6b, 0xf3, 0xeb, 0xfb, 0x15, 0x03,
-    0x84, 0x0e, 0xf3, 0x0e, 0x5c, 0x0e, 0xe1, 0x0d,
-    0xd3, 0x0b, 0xdb, 0x0b, 0xef, 0x0b, 0x14, 0x0d,
-    0x98, 0x0d, 0x8e, 0x11, 0x9c, 0x0f, 0xd7, 0x0e,
-    0xf5, 0x0c, 0x49, 0x09, 0x2b, 0x07, 0x24, 0x04,
-    0xb0, 0x00, 0x93, 0xfe, 0x09, 0xfe, 0x91, 0xfe,
-    0x68, 0x01, 0xc7, 0x03, 0xfd, 0x03, 0x66, 0x02,
-    0xbd, 0xff, 0xb0, 0xfc, 0xa6, 0xfc, 0x54, 0xfc,
-    0x2d, 0xfe, 0x26, 0x01, 0x63, 0x04, 0xf3, 0x06,
-    0xf7, 0x07, 0xdd, 0x08, 0xd3, 0x08, 0xde, 0x09,
-    0x9d, 0x08, 0xea, 0x08, 0xa5, 0x07, 0x6b, 0x08,
-    0x23, 0x0a, 0x3f, 0x0c, 0x16, 0x0f, 0x7c, 0x0f,
-    0x52, 0x0e, 0x16, 0x0b, 0x9f, 0x08, 0xb0, 0x05,
-    0xba, 0x04, 0x06, 0x04, 0xb4, 0x03, 0x08, 0x04,
-    0x4f, 0x04, 0x80, 0x03, 0xec, 0x02, 0x1c, 0x02,
-    0x56, 0x01, 0x38, 0x00, 0x1d, 0xff, 0x22, 0xff,
-    0xf5, 0xff, 0x0e, 0x02, 0xb5, 0x03, 0xe2, 0x05,
-    0xfd, 0x06, 0x04, 0x07, 0x53, 0x06, 0xd2, 0x05,
-    0xc2, 0x05, 0xf6, 0x05, 0x62, 0x06, 0xb2, 0x06,
-    0x33, 0x07, 0x45, 0x07, 0xf2, 0x06, 0x2c, 0x06,
-    0xce, 0x04, 0x1f, 0x03, 0x14, 0x02, 0x70, 0x00,
-    0x14, 0xff, 0xf1, 0xfd, 0xd0, 0xfd, 0x4c, 0xfe,
-    0xe3, 0xfd, 0xa1, 0xfd, 0xc5, 0xfc, 0x8d, 0xfb,
-    0x97, 0xfa, 0x38, 0xfa, 0xfc, 0xf9, 0xdb, 0xfa,
-    0xea, 0xfa, 0x65, 0xfb, 0x49, 0xfd, 0xee, 0xfd,
-    0x43, 0xfe, 0xf7, 0xfd, 0x56, 0xfd, 0x7b, 0xfd,
-    0xa0, 0xfd, 0x9f, 0xfd, 0x38, 0xfd, 0x28, 0xfd,
-    0x09, 0xfd, 0x18, 0xfd, 0xac, 0xfc, 0x75, 0xfb,
-    0x5e, 0xfa, 0xe2, 0xf8, 0x4e, 0xf7, 0xf9, 0xf5,
-    0x1d, 0xf5, 0x8b, 0xf3, 0xa2, 0xf3, 0x7f, 0xf2,
-    0x67, 0xf2, 0x17, 0xf2, 0xb5, 0xf0, 0x18, 0xf0,
-    0x09, 0xf0, 0xe3, 0xee, 0xb7, 0xee, 0x04, 0xee,
-    0x64, 0xed, 0x01, 0xee, 0xdb, 0xed, 0x27, 0xee,
-    0x48, 0xed, 0x97, 0xed, 0x39, 0xec, 0x0b, 0xef,
-    0xd3, 0xee, 0x96, 0xf1, 0xaf, 0xf1, 0x8d, 0xf2,
-    0x02, 0xf6, 0x75, 0xfb, 0xf3, 0x05, 0x86, 0x0c,
-    0xba, 0x10, 0x64, 0x0e, 0x82, 0x0d, 0xc5, 0x0a,
-    0x78, 0x0b, 0x93, 0x0b, 0x39, 0x0c, 0x62, 0x0e,
-    0x91, 0x0e, 0xa1, 0x0e, 0xef, 0x0c, 0xbd, 0x0a,
-    0x10, 0x08, 0x1b, 0x06, 0xe5, 0x03, 0x41, 0x01,
-    0xda, 0xfe, 0x00, 0xfe, 0x3c, 0xfe, 0xe4, 0x00,
-    0x75, 0x03, 0xb2, 0x04, 0xb5, 0x03, 0x27, 0x01,
-    0xc6, 0xfe, 0xc4, 0xfd, 0x24, 0xfe, 0xcc, 0xfe,
-    0x3f, 0x01, 0x46, 0x03, 0xb8, 0x05, 0x34, 0x07,
-    0x74, 0x08, 0xb0, 0x09, 0x3f, 0x0a, 0xb8, 0x0a,
-    0x83, 0x09, 0x11, 0x09, 0xeb, 0x07, 0x86, 0x08,
-    0x74, 0x0a, 0x8e, 0x0c, 0x64, 0x0e, 0x85, 0x0e,
-    0xa9, 0x0c, 0x9e, 0x09, 0x0c, 0x07, 0xe2, 0x04,
-    0xa7, 0x03, 0x57, 0x03, 0xfa, 0x02, 0xce, 0x02,
-    0x52, 0x02, 0x11, 0x02, 0x14, 0x02, 0x64, 0x02,
-    0xda, 0x01, 0x18, 0x01, 0x83, 0x00, 0xfd, 0xff,
-    0xe5, 0x00, 0xaa, 0x02, 0x23, 0x05, 0x4c, 0x07,
-    0x6c, 0x08, 0xb4, 0x07, 0xa3, 0x07, 0x6a, 0x06,
-    0x06, 0x06, 0xc9, 0x06, 0xa4, 0x06, 0xa2, 0x06,
-    0x8b, 0x06, 0x01, 0x06, 0x70, 0x05, 0xda, 0x04,
-    0xc2, 0x03, 0xa3, 0x02, 0x5b, 0x01, 0x7f, 0xff,
-    0x18, 0xfe, 0x4c, 0xfd, 0xde, 0xfc, 0x19, 0xfd,
-    0x7b, 0xfd, 0xca, 0xfd, 0x19, 0xfd, 0x0e, 0xfc,
-    0x9f, 0xfb, 0xbe, 0xfb, 0x96, 0xfb, 0xe9, 0xfb,
-    0x49, 0xfc, 0x2c, 0xfd, 0xaa, 0xfe, 0x34, 0xff,
-    0x4a, 0xff, 0x7d, 0xff, 0x66, 0xff, 0x1e, 0xff,
-    0x54, 0xfe, 0x78, 0xfd, 0x08, 0xfd, 0x63, 0xfd,
-    0x02, 0xfd, 0x98, 0xfc, 0xe0, 0xfb, 0x0b, 0xfb,
-    0xf7, 0xf9, 0x5f, 0xf8, 0xc9, 0xf6, 0xa0, 0xf4,
-    0x61, 0xf3, 0x58, 0xf2, 0xb0, 0xf1, 0x65, 0xf1,
-    0x73, 0xf0, 0xed, 0xef, 0x27, 0xf0, 0x64, 0xef,
-    0xa0, 0xee, 0xf4, 0xed, 0xd7, 0xec, 0x62, 0xec,
-    0x3f, 0xec, 0x40, 0xec, 0x0b, 0xec, 0x3c, 0xec,
-    0x81, 0xec, 0x12, 0xed, 0x39, 0xef, 0xaf, 0xef,
-    0xf5, 0xf0, 0x03, 0xf1, 0x1e, 0xf2, 0x74, 0xf5,
-    0xfb, 0xfe, 0xe3, 0x07, 0xa8, 0x0d, 0xe4, 0x0f,
-    0x31, 0x0b, 0x27, 0x0c, 0xfe, 0x0a, 0xb8, 0x0b,
-    0xf7, 0x0b, 0xd0, 0x0b, 0x9f, 0x0c, 0x87, 0x0d,
-    0xc4, 0x0d, 0x49, 0x0b, 0x1e, 0x0a, 0xc3, 0x07,
-    0xd5, 0x05, 0x01, 0x03, 0x83, 0xff, 0xa7, 0xfc,
-    0x75, 0xfc, 0x95, 0xfe, 0xf6, 0x01, 0x6b, 0x04,
-    0x67, 0x04, 0xdf, 0x01, 0x2a, 0x00, 0xb1, 0xfe,
-    0xb8, 0xfe, 0x76, 0xff, 0x77, 0x00, 0x40, 0x02,
-    0xfb, 0x03, 0x38, 0x06, 0xcf, 0x07, 0x73, 0x0a,
-    0x33, 0x0b, 0x44, 0x0c, 0xa8, 0x0b, 0x57, 0x09,
-    0x23, 0x08, 0x50, 0x07, 0x58, 0x09, 0xcc, 0x0b,
-    0x55, 0x0e, 0x00, 0x0f, 0x42, 0x0d, 0x28, 0x0b,
-    0x24, 0x08, 0xc4, 0x06, 0x00, 0x05, 0x5b, 0x03,
-    0x5d, 0x02, 0x85, 0x01, 0x67, 0x01, 0x05, 0x01,
-    0xa3, 0x01, 0x65, 0x02, 0x36, 0x03, 0x80, 0x02,
-    0x66, 0x01, 0x45, 0x00, 0xf2, 0xff, 0x81, 0x01,
-    0x32, 0x04, 0x90, 0x06, 0x90, 0x08, 0x01, 0x09,
-    0x51, 0x08, 0x5a, 0x08, 0xe7, 0x07, 0x5d, 0x08,
-    0xf6, 0x07, 0xa9, 0x07, 0x5c, 0x07, 0x01, 0x07,
-    0x34, 0x07, 0xf1, 0x05, 0x3f, 0x05, 0x97, 0x04,
-    0xd1, 0x02, 0x26, 0x01, 0xc4, 0xfe, 0x1e, 0xfd,
-    0x68, 0xfc, 0xb0, 0xfc, 0x17, 0xfd, 0xb2, 0xfd,
-    0x80, 0xfd, 0xac, 0xfc, 0x74, 0xfc, 0x23, 0xfc,
-    0x8b, 0xfc, 0x63, 0xfc, 0xc5, 0xfc, 0x15, 0xfd,
-    0x11, 0xfe, 0x28, 0xff, 0x76, 0xff, 0x05, 0x00,
-    0x01, 0x00, 0x5a, 0x00, 0x27, 0x00, 0x17, 0xff,
-    0x41, 0xfe, 0xa6, 0xfd, 0xf7, 0xfd, 0x5b, 0xfe,
-    0x80, 0xfe, 0x76, 0xfd, 0xea, 0xfb, 0x89, 0xfa,
-    0xbb, 0xf8, 0xb4, 0xf7, 0xfc, 0xf5, 0x64, 0xf4,
-    0x77, 0xf3, 0x60, 0xf2, 0x60, 0xf1, 0x30, 0xf1,
-    0x0f, 0xf1, 0x80, 0xf0, 0xb1, 0xef, 0x73, 0xee,
-    0x78, 0xed, 0x54, 0xec, 0x00, 0xec, 0x28, 0xec,
-    0x4a, 0xed, 0x32, 0xee, 0xaa, 0xee, 0xcf, 0xee,
-    0xf4, 0xee, 0xa0, 0xef, 0xb4, 0xef, 0x5b, 0xf0,
-    0xb4, 0xf0, 0xce, 0xf0, 0x20, 0xf4, 0x93, 0xfc,
-    0x7c, 0x05, 0x8d, 0x0d, 0xc6, 0x0e, 0x28, 0x0b,
-    0x61, 0x09, 0x8f, 0x08, 0x56, 0x09, 0x3a, 0x09,
-    0xe1, 0x09, 0xc1, 0x09, 0xcd, 0x0b, 0x3f, 0x0c,
-    0xad, 0x0a, 0xf2, 0x09, 0x76, 0x07, 0x69, 0x05,
-    0x5f, 0x02, 0xd5, 0xfe, 0x84, 0xfb, 0x0a, 0xfb,
-    0x4f, 0xfd, 0x30, 0x01, 0xe6, 0x04, 0xef, 0x05,
-    0x5c, 0x04, 0x6c, 0x02, 0x1c, 0x00, 0x4c, 0xff,
-    0x80, 0xff, 0xd2, 0xff, 0x3d, 0x01, 0x02, 0x03,
-    0x13, 0x06, 0x2c, 0x08, 0x5c, 0x0a, 0xd9, 0x0b,
-    0x42, 0x0c, 0xa9, 0x0b, 0xf4, 0x08, 0x7b, 0x06,
-    0x91, 0x05, 0x13, 0x07, 0x67, 0x0a, 0xbe, 0x0d,
-    0xba, 0x0f, 0xc5, 0x0e, 0x5d, 0x0c, 0xf9, 0x09,
-    0xaf, 0x07, 0x04, 0x06, 0xb4, 0x03, 0xe2, 0x01,
-    0x51, 0x01, 0x70, 0x01, 0x19, 0x02, 0xe3, 0x02,
-    0x3f, 0x04, 0xbf, 0x04, 0x58, 0x04, 0x31, 0x02,
-    0xb3, 0xff, 0x21, 0xff, 0xf8, 0xff, 0xfc, 0x02,
-    0x7c, 0x06, 0x15, 0x09, 0xcd, 0x09, 0x47, 0x09,
-    0x83, 0x08, 0x02, 0x08, 0x30, 0x08, 0x5d, 0x07,
-    0x93, 0x06, 0x49, 0x06, 0xde, 0x05, 0x3b, 0x06,
-    0x3c, 0x06, 0x35, 0x06, 0xf3, 0x05, 0x4b, 0x04,
-    0xf8, 0x01, 0x89, 0xfe, 0x03, 0xfc, 0x60, 0xfb,
-    0x28, 0xfc, 0xbe, 0xfd, 0x33, 0xfe, 0x2c, 0xfe,
-    0x59, 0xfd, 0x1e, 0xfd, 0xa5, 0xfc, 0x89, 0xfc,
-    0xd9, 0xfc, 0xef, 0xfb, 0x55, 0xfc, 0x42, 0xfc,
-    0x4d, 0xfd, 0xf9, 0xfe, 0xc5, 0xff, 0xe8, 0x00,
-    0x1d, 0x01, 0x28, 0x00, 0xa6, 0xfe, 0xb4, 0xfd,
-    0x59, 0xfd, 0x04, 0xfe, 0xd4, 0xfe, 0x84, 0xfe,
-    0x52, 0xfe, 0x31, 0xfd, 0xbf, 0xfb, 0xc2, 0xfa,
-    0xfe, 0xf8, 0x54, 0xf7, 0x0c, 0xf5, 0x17, 0xf3,
-    0xeb, 0xf1, 0x10, 0xf1, 0x3a, 0xf1, 0x77, 0xf1,
-    0x94, 0xf1, 0x51, 0xf1, 0xbe, 0xef, 0x18, 0xee,
-    0x74, 0xec, 0xa5, 0xeb, 0xe1, 0xeb, 0x67, 0xec,
-    0xce, 0xed, 0xa6, 0xed, 0xf6, 0xed, 0x73, 0xee,
-    0x26, 0xef, 0x1e, 0xf0, 0x60, 0xf0, 0xf4, 0xef,
-    0xaa, 0xee, 0x74, 0xf0, 0x15, 0xf3, 0x83, 0xfc,
-    0x91, 0x06, 0xcf, 0x0b, 0xbc, 0x0d, 0x67, 0x09,
-    0x95, 0x07, 0x5a, 0x07, 0xd0, 0x07, 0x6f, 0x08,
-    0xa0, 0x08, 0xbc, 0x09, 0x9f, 0x0a, 0x41, 0x0b,
-    0x06, 0x0b, 0xf2, 0x09, 0x96, 0x08, 0xd8, 0x05,
-    0x4e, 0x02, 0xee, 0xfd, 0x08, 0xfb, 0xfa, 0xfa,
-    0x06, 0xfe, 0xc0, 0x02, 0xdd, 0x05, 0xd8, 0x06,
-    0xf6, 0x04, 0x27, 0x03, 0x27, 0x01, 0xa0, 0x00,
-    0x5e, 0x00, 0x29, 0x00, 0xd0, 0x00, 0x38, 0x02,
-    0x1c, 0x05, 0x8e, 0x07, 0x67, 0x0a, 0xf5, 0x0b,
-    0xd8, 0x0c, 0xf1, 0x0b, 0x1d, 0x09, 0x57, 0x06,
-    0xeb, 0x04, 0x01, 0x07, 0x2f, 0x0a, 0x0f, 0x0e,
-    0xcb, 0x0f, 0xd2, 0x0e, 0x91, 0x0d, 0x04, 0x0c,
-    0xb2, 0x0a, 0xd9, 0x08, 0x9f, 0x05, 0x71, 0x02,
-    0x0c, 0x01, 0x22, 0x01, 0x21, 0x02, 0xf8, 0x03,
-    0x67, 0x05, 0xef, 0x05, 0x2b, 0x05, 0x78, 0x02,
-    0x47, 0x00, 0xf5, 0xfe, 0xfa, 0xff, 0x2e, 0x02,
-    0x86, 0x04, 0x6b, 0x06, 0x2e, 0x07, 0xe5, 0x07,
-    0xca, 0x08, 0x6a, 0x09, 0xf2, 0x08, 0xdf, 0x07,
-    0xcb, 0x05, 0xc5, 0x04, 0x22, 0x04, 0x92, 0x04,
-    0x72, 0x05, 0x3d, 0x06, 0xc9, 0x06, 0x8d, 0x05,
-    0xba, 0x03, 0xa9, 0x00, 0x59, 0xfe, 0x32, 0xfd,
-    0xea, 0xfc, 0x5e, 0xfd, 0xa1, 0xfd, 0x7e, 0xfd,
-    0xdd, 0xfd, 0xd9, 0xfd, 0x35, 0xfe, 0x03, 0xfe,
-    0x13, 0xfd, 0x11, 0xfc, 0x06, 0xfb, 0x05, 0xfb,
-    0x1d, 0xfb, 0xa7, 0xfc, 0xe1, 0xfd, 0x7c, 0xff,
-    0x32, 0x00, 0x6c, 0xff, 0x95, 0xfe, 0xfa, 0xfd,
-    0xe6, 0xfd, 0xdc, 0xfd, 0xa3, 0xfd, 0xe0, 0xfc,
-    0xaf, 0xfc, 0x88, 0xfc, 0x57, 0xfc, 0xe6, 0xfb,
-    0xc8, 0xfa, 0xfe, 0xf8, 0xe6, 0xf6, 0xb7, 0xf4,
-    0xde, 0xf2, 0xa1, 0xf1, 0x63, 0xf1, 0x74, 0xf1,
-    0xb2, 0xf1, 0x32, 0xf1, 0x0c, 0xf0, 0xee, 0xee,
-    0x9b, 0xed, 0xe3, 0xec, 0x12, 0xec, 0x3f, 0xec,
-    0xd3, 0xeb, 0x6f, 0xec, 0x4e, 0xec, 0x13, 0xed,
-    0xa6, 0xed, 0xac, 0xee, 0x5e, 0xef, 0xc9, 0xee,
-    0x35, 0xef, 0x0f, 0xef, 0x37, 0xf6, 0xfc, 0xfd,
-    0xa5, 0x06, 0x8e, 0x09, 0x34, 0x07, 0xd4, 0x05,
-    0x89, 0x05, 0x32, 0x07, 0xe6, 0x06, 0xf4, 0x05,
-    0x4a, 0x06, 0x60, 0x08, 0xff, 0x09, 0x98, 0x0a,
-    0x16, 0x09, 0xc3, 0x08, 0x48, 0x07, 0x3f, 0x05,
-    0x4e, 0x01, 0x0c, 0xfe, 0xa1, 0xfc, 0xf3, 0xfd,
-    0xd1, 0x01, 0xf2, 0x04, 0xfc, 0x06, 0xb2, 0x06,
-    0x37, 0x05, 0xa1, 0x03, 0xe6, 0x02, 0x7a, 0x01,
-    0xa1, 0x00, 0x58, 0x00, 0x19, 0x01, 0x73, 0x03,
-    0xea, 0x05, 0x4e, 0x08, 0x05, 0x0a, 0x2c, 0x0b,
-    0xd3, 0x0a, 0x15, 0x09, 0xb8, 0x06, 0x2e, 0x05,
-    0xc5, 0x05, 0x2b, 0x08, 0x17, 0x0b, 0xcb, 0x0c,
-    0xd2, 0x0d, 0xc1, 0x0d, 0xed, 0x0d, 0x0e, 0x0d,
-    0x31, 0x0b, 0x14, 0x08, 0x10, 0x05, 0x3a, 0x03,
-    0xd1, 0x02, 0xf2, 0x02, 0xd7, 0x03, 0x03, 0x05,
-    0xf0, 0x05, 0x81, 0x06, 0xea, 0x04, 0x27, 0x03,
-    0x8e, 0x01, 0xbe, 0x01, 0x04, 0x02, 0x2c, 0x03,
-    0xd0, 0x03, 0x30, 0x05, 0x04, 0x07, 0x8a, 0x08,
-    0x96, 0x09, 0xe6, 0x08, 0x3b, 0x08, 0x2c, 0x06,
-    0xaf, 0x05, 0x24, 0x05, 0xf0, 0x04, 0xff, 0x04,
-    0xfc, 0x04, 0x8c, 0x05, 0xa1, 0x05, 0xfb, 0x04,
-    0x24, 0x03, 0x4f, 0x01, 0xeb, 0xff, 0x19, 0xff,
-    0x36, 0xfe, 0xf1, 0xfd, 0x8a, 0xfd, 0x3c, 0xfe,
-    0xeb, 0xfe, 0x5d, 0xff, 0xe9, 0xfe, 0xce, 0xfd,
-    0xcb, 0xfc, 0xfa, 0xfb, 0xb1, 0xfb, 0xe8, 0xfa,
-    0xd8, 0xfa, 0x5e, 0xfb, 0x06, 0xfd, 0x2e, 0xfe,
-    0x66, 0xfe, 0xce, 0xfd, 0x88, 0xfd, 0x86, 0xfd,
-    0x88, 0xfd, 0x06, 0xfd, 0x25, 0xfc, 0x02, 0xfc,
-    0x1b, 0xfc, 0x5c, 0xfc, 0x5f, 0xfc, 0xce, 0xfb,
-    0xcd, 0xfa, 0x4a, 0xf9, 0xe9, 0xf7, 0x17, 0xf6,
-    0x98, 0xf4, 0x3a, 0xf3, 0x45, 0xf2, 0x72, 0xf2,
-    0x68, 0xf2, 0xe2, 0xf1, 0xa3, 0xf0, 0x12, 0xf0,
-    0x7a, 0xef, 0x53, 0xef, 0x6c, 0xee, 0x73, 0xed,
-    0x32, 0xed, 0xe1, 0xed, 0x78, 0xed, 0xdc, 0xed,
-    0x28, 0xed, 0xc7, 0xed, 0x24, 0xef, 0xe5, 0xef,
-    0x5b, 0xf0, 0x7f, 0xef, 0x2e, 0xf1, 0x67, 0xf6,
-    0x62, 0xff, 0xe2, 0x05, 0xaf, 0x07, 0x5b, 0x04,
-    0x3d, 0x03, 0xcf, 0x03, 0x69, 0x06, 0xc9, 0x05,
-    0x11, 0x04, 0x75, 0x04, 0x82, 0x06, 0x10, 0x09,
-    0x77, 0x08, 0xbe, 0x07, 0x28, 0x07, 0x6a, 0x08,
-    0xdb, 0x06, 0xe3, 0x02, 0x82, 0xfe, 0x67, 0xfd,
-    0x59, 0x00, 0xe5, 0x04, 0x86, 0x07, 0xef, 0x07,
-    0xa0, 0x07, 0xe8, 0x06, 0x5d, 0x06, 0x53, 0x05,
-    0xf8, 0x03, 0x55, 0x03, 0xd4, 0x02, 0x19, 0x03,
-    0xc3, 0x03, 0x40, 0x05, 0x40, 0x07, 0x3c, 0x09,
-    0xb5, 0x0a, 0xf0, 0x0a, 0x4f, 0x09, 0xe1, 0x06,
-    0x5b, 0x05, 0xb7, 0x05, 0xeb, 0x07, 0xea, 0x09,
-    0xf4, 0x0a, 0xf8, 0x0a, 0x28, 0x0b, 0xc8, 0x0b,
-    0x53, 0x0c, 0xc7, 0x0b, 0xb5, 0x09, 0xd1, 0x06,
-    0x0c, 0x05, 0xc5, 0x03, 0xad, 0x03, 0xa9, 0x03,
-    0x04, 0x05, 0xc9, 0x06, 0xd4, 0x07, 0x07, 0x07,
-    0xed, 0x04, 0xd8, 0x03, 0x00, 0x04, 0x06, 0x05,
-    0x47, 0x05, 0x62, 0x05, 0x69, 0x05, 0x57, 0x06,
-    0xa9, 0x07, 0xd0, 0x08, 0xd2, 0x08, 0x2f, 0x08,
-    0x17, 0x07, 0xf9, 0x05, 0x2a, 0x05, 0xe4, 0x03,
-    0x12, 0x03, 0x90, 0x03, 0x5f, 0x04, 0xe4, 0x04,
-    0x05, 0x04, 0x61, 0x02, 0x50, 0x01, 0xbb, 0x00,
-    0xe0, 0x00, 0x41, 0x00, 0xab, 0xff, 0x03, 0xff,
-    0x73, 0xfe, 0xfb, 0xfe, 0x72, 0xff, 0xe0, 0xff,
-    0xdb, 0xff, 0x2a, 0xff, 0x76, 0xfe, 0x64, 0xfd,
-    0x69, 0xfc, 0xb2, 0xfb, 0xd2, 0xfb, 0xb8, 0xfc,
-    0x52, 0xfd, 0x4a, 0xfd, 0xd9, 0xfc, 0xce, 0xfc,
-    0x42, 0xfd, 0xa5, 0xfd, 0x27, 0xfd, 0x60, 0xfc,
-    0x76, 0xfb, 0x3b, 0xfb, 0xc8, 0xfa, 0x7f, 0xfa,
-    0x4e, 0xfa, 0x17, 0xfa, 0x96, 0xf9, 0xc0, 0xf8,
-    0x61, 0xf7, 0xf8, 0xf5, 0xe7, 0xf4, 0xbf, 0xf3,
-    0x70, 0xf3, 0xed, 0xf2, 0xa5, 0xf2, 0xa1, 0xf1,
-    0xab, 0xf1, 0x52, 0xf1, 0x61, 0xf1, 0x05, 0xf1,
-    0x2b, 0xf0, 0xc4, 0xef, 0x98, 0xef, 0xd5, 0xee,
-    0xa9, 0xee, 0x44, 0xee, 0xa3, 0xee, 0xdf, 0xef,
-    0x32, 0xf0, 0x73, 0xf1, 0xb1, 0xf0, 0x98, 0xf2,
-    0xe8, 0xf5, 0x45, 0xfc, 0x94, 0x01, 0xd1, 0x02,
-    0x1d, 0x01, 0x2b, 0xff, 0x3d, 0x00, 0x3f, 0x02,
-    0xd5, 0x02, 0x09, 0x02, 0xe7, 0x01, 0x72, 0x03,
-    0x9b, 0x05, 0x51, 0x05, 0x20, 0x05, 0x29, 0x05,
-    0xc7, 0x06, 0xb7, 0x06, 0x4b, 0x04, 0x23, 0x01,
-    0x47, 0x00, 0x14, 0x02, 0xb4, 0x04, 0x37, 0x06,
-    0xdc, 0x06, 0x8f, 0x07, 0xd1, 0x07, 0xcb, 0x07,
-    0x85, 0x06, 0x02, 0x06, 0xa0, 0x05, 0x67, 0x05,
-    0xd5, 0x04, 0x11, 0x04, 0xf2, 0x03, 0xb7, 0x04,
-    0x37, 0x06, 0x22, 0x08, 0x87, 0x09, 0x80, 0x09,
-    0x56, 0x08, 0x13, 0x07, 0xf4, 0x06, 0xad, 0x07,
-    0x90, 0x08, 0xb6, 0x08, 0x8f, 0x08, 0xaf, 0x08,
-    0x49, 0x09, 0x2f, 0x0a, 0xc2, 0x0a, 0x65, 0x0a,
-    0x6e, 0x09, 0xe9, 0x07, 0x74, 0x06, 0x17, 0x05,
-    0x7f, 0x04, 0x25, 0x05, 0x68, 0x06, 0xac, 0x07,
-    0xbc, 0x07, 0x94, 0x07, 0xac, 0x07, 0x19, 0x08,
-    0xf2, 0x07, 0x36, 0x07, 0xfe, 0x05, 0x55, 0x05,
-    0xe6, 0x04, 0xd0, 0x04, 0x08, 0x05, 0x71, 0x05,
-    0xed, 0x05, 0x13, 0x06, 0xed, 0x05, 0xee, 0x04,
-    0xb3, 0x03, 0x39, 0x02, 0x8b, 0x01, 0x6c, 0x01,
-    0x76, 0x01, 0xe6, 0x00, 0x75, 0x00, 0x4f, 0x00,
-    0xe8, 0x00, 0xc0, 0x01, 0xdf, 0x01, 0x6a, 0x01,
-    0x87, 0x00, 0xdb, 0xff, 0x9a, 0xff, 0x86, 0xff,
-    0x26, 0xff, 0xe0, 0xfe, 0xfe, 0xfe, 0x7e, 0xff,
-    0xc0, 0xff, 0x7d, 0xff, 0xd0, 0xfe, 0xba, 0xfe,
-    0xf2, 0xfe, 0xb3, 0xfe, 0xd9, 0xfd, 0x8f, 0xfc,
-    0x14, 0xfc, 0x7b, 0xfc, 0xd6, 0xfc, 0xe8, 0xfc,
-    0x83, 0xfc, 0x69, 0xfc, 0x83, 0xfc, 0x31, 0xfc,
-    0x97, 0xfb, 0x8f, 0xfa, 0x28, 0xfa, 0xba, 0xf9,
-    0x41, 0xf9, 0xad, 0xf8, 0xd9, 0xf7, 0xdd, 0xf7,
-    0xbd, 0xf7, 0xed, 0xf7, 0x84, 0xf7, 0xf8, 0xf6,
-    0x4f, 0xf6, 0xd9, 0xf5, 0x37, 0xf5, 0x66, 0xf4,
-    0x89, 0xf3, 0xc5, 0xf2, 0xba, 0xf2, 0x2c, 0xf2,
-    0x2d, 0xf2, 0x8f, 0xf1, 0xab, 0xf1, 0x7b, 0xf1,
-    0x37, 0xf1, 0xd8, 0xf0, 0x7c, 0xf0, 0x1e, 0xf0,
-    0x35, 0xf0, 0x74, 0xf1, 0x36, 0xf4, 0xf9, 0xf7,
-    0xce, 0xf9, 0x62, 0xfa, 0x55, 0xf9, 0x9b, 0xf9,
-    0xc3, 0xf9, 0x6d, 0xf9, 0x4d, 0xf8, 0xbf, 0xf7,
-    0x46, 0xf9, 0x29, 0xfb, 0x7f, 0xfc, 0xec, 0xfc,
-    0xce, 0xfd, 0x82, 0xff, 0xe6, 0x00, 0x8a, 0x00,
-    0xca, 0xff, 0x7b, 0xff, 0xbf, 0x00, 0x75, 0x02,
-    0xea, 0x03, 0x41, 0x05, 0xf7, 0x06, 0x8a, 0x08,
-    0x84, 0x09, 0xa6, 0x09, 0x36, 0x09, 0xff, 0x08,
-    0x90, 0x08, 0xf7, 0x07, 0x06, 0x07, 0x0d, 0x06,
-    0x6b, 0x05, 0x7e, 0x05, 0x60, 0x06, 0x6e, 0x07,
-    0x4a, 0x08, 0x79, 0x08, 0x4d, 0x08, 0x77, 0x08,
-    0x82, 0x08, 0x9e, 0x08, 0x20, 0x08, 0xb4, 0x07,
-    0x76, 0x07, 0xdf, 0x07, 0x2f, 0x08, 0x83, 0x08,
-    0xba, 0x08, 0xd5, 0x08, 0x15, 0x09, 0xa3, 0x08,
-    0x2d, 0x08, 0x9a, 0x07, 0x94, 0x07, 0x9c, 0x07,
-    0xcb, 0x07, 0xfb, 0x07, 0x8b, 0x08, 0x64, 0x09,
-    0x28, 0x0a, 0x85, 0x0a, 0xb3, 0x0a, 0x89, 0x0a,
-    0x59, 0x0a, 0xc1, 0x09, 0xdd, 0x08, 0x04, 0x08,
-    0x0a, 0x07, 0xb8, 0x06, 0x47, 0x06, 0x3a, 0x06,
-    0xd8, 0x05, 0x4c, 0x05, 0xdd, 0x04, 0x55, 0x04,
-    0x00, 0x04, 0x73, 0x03, 0xde, 0x02, 0x4e, 0x02,
-    0xcb, 0x01, 0x97, 0x01, 0x7b, 0x01, 0xb6, 0x01,
-    0xd0, 0x01, 0xd5, 0x01, 0xd1, 0x01, 0xa3, 0x01,
-    0x89, 0x01, 0xfa, 0x00, 0x5a, 0x00, 0x8d, 0xff,
-    0x32, 0xff, 0xdd, 0xfe, 0x97, 0xfe, 0x72, 0xfe,
-    0x4e, 0xfe, 0xe3, 0xfe, 0x16, 0xff, 0x26, 0xff,
-    0xda, 0xfe, 0x62, 0xfe, 0xf9, 0xfd, 0x4d, 0xfd,
-    0x98, 0xfc, 0xf4, 0xfb, 0xbb, 0xfb, 0x71, 0xfb,
-    0x38, 0xfb, 0xee, 0xfa, 0x6d, 0xfa, 0x0d, 0xfa,
-    0x5f, 0xf9, 0x9f, 0xf8, 0xe5, 0xf7, 0x01, 0xf7,
-    0x3d, 0xf6, 0x9a, 0xf5, 0x3c, 0xf5, 0x18, 0xf5,
-    0x11, 0xf5, 0x0c, 0xf5, 0xf1, 0xf4, 0xe3, 0xf4,
-    0x75, 0xf4, 0xe6, 0xf3, 0x37, 0xf3, 0x8a, 0xf2,
-    0xe8, 0xf1, 0x45, 0xf1, 0x8e, 0xf0, 0x24, 0xf0,
-    0xfd, 0xef, 0xc3, 0xef, 0xcc, 0xef, 0x6d, 0xef,
-    0x7d, 0xef, 0x84, 0xef, 0x6a, 0xef, 0x40, 0xef,
-    0x92, 0xef, 0xfc, 0xf0, 0x5e, 0xf3, 0x64, 0xf5,
-    0x3a, 0xf6, 0x6c, 0xf6, 0x9a, 0xf6, 0x2a, 0xf7,
-    0x25, 0xf7, 0xe3, 0xf6, 0x04, 0xf7, 0x3d, 0xf8,
-    0x05, 0xfa, 0x20, 0xfb, 0xe9, 0xfb, 0x29, 0xfd,
-    0x03, 0xff, 0x0d, 0x01, 0xde, 0x01, 0x5a, 0x02,
-    0xfb, 0x02, 0x4d, 0x04, 0xe3, 0x05, 0x3d, 0x07,
-    0xe3, 0x08, 0xc4, 0x0a, 0xa7, 0x0c, 0xd3, 0x0d,
-    0x2f, 0x0e, 0xfb, 0x0d, 0xea, 0x0d, 0x98, 0x0d,
-    0x59, 0x0d, 0xa1, 0x0c, 0xc6, 0x0b, 0xf3, 0x0a,
-    0x5f, 0x0a, 0x68, 0x0a, 0xbf, 0x0a, 0x2d, 0x0b,
-    0x42, 0x0b, 0x28, 0x0b, 0xfd, 0x0a, 0xbe, 0x0a,
-    0x79, 0x0a, 0xf4, 0x09, 0x68, 0x09, 0xfb, 0x08,
-    0x65, 0x08, 0x18, 0x08, 0xb9, 0x07, 0xbd, 0x07,
-    0x05, 0x08, 0x5e, 0x08, 0x8a, 0x08, 0x36, 0x08,
-    0xc1, 0x07, 0xa6, 0x07, 0xeb, 0x07, 0x45, 0x08,
-    0x67, 0x08, 0xcd, 0x08, 0x79, 0x09, 0x53, 0x0a,
-    0x09, 0x0b, 0x49, 0x0b, 0x9f, 0x0b, 0xc2, 0x0b,
-    0x6a, 0x0b, 0xa7, 0x0a, 0x9c, 0x09, 0x95, 0x08,
-    0xff, 0x07, 0x77, 0x07, 0x29, 0x07, 0xce, 0x06,
-    0x63, 0x06, 0xc5, 0x05, 0x1e, 0x05, 0x87, 0x04,
-    0xed, 0x03, 0x80, 0x03, 0xec, 0x02, 0x73, 0x02,
-    0xbb, 0x01, 0x2a, 0x01, 0xc7, 0x00, 0xb3, 0x00,
-    0xd2, 0x00, 0x7a, 0x00, 0xfc, 0xff, 0x41, 0xff,
-    0xbb, 0xfe, 0x32, 0xfe, 0xa8, 0xfd, 0x37, 0xfd,
-    0xd7, 0xfc, 0xba, 0xfc, 0x8d, 0xfc, 0x6a, 0xfc,
-    0x6d, 0xfc, 0xa9, 0xfc, 0xf1, 0xfc, 0x1a, 0xfd,
-    0xdd, 0xfc, 0x6f, 0xfc, 0x18, 0xfc, 0xd3, 0xfb,
-    0x9f, 0xfb, 0x40, 0xfb, 0xd1, 0xfa, 0x5e, 0xfa,
-    0xed, 0xf9, 0x87, 0xf9, 0x13, 0xf9, 0xa2, 0xf8,
-    0x37, 0xf8, 0xcf, 0xf7, 0x55, 0xf7, 0x03, 0xf7,
-    0x71, 0xf6, 0xff, 0xf5, 0xb7, 0xf5, 0x6b, 0xf5,
-    0x4f, 0xf5, 0xf0, 0xf4, 0x81, 0xf4, 0xfe, 0xf3,
-    0x9b, 0xf3, 0x03, 0xf3, 0x60, 0xf2, 0xbb, 0xf1,
-    0xf9, 0xf0, 0x9e, 0xf0, 0x57, 0xf0, 0x15, 0xf0,
-    0xae, 0xef, 0x66, 0xef, 0x56, 0xef, 0x78, 0xef,
-    0x73, 0xef, 0x63, 0xef, 0x5a, 0xf0, 0x39, 0xf2,
-    0x60, 0xf4, 0x8e, 0xf5, 0xaf, 0xf5, 0x83, 0xf5,
-    0x90, 0xf5, 0x99, 0xf5, 0xb4, 0xf5, 0x09, 0xf6,
-    0x0c, 0xf7, 0xb9, 0xf8, 0xfd, 0xf9, 0x04, 0xfb,
-    0x07, 0xfc, 0x6a, 0xfd, 0x1d, 0xff, 0x7a, 0x00,
-    0x60, 0x01, 0x30, 0x02, 0x5a, 0x03, 0xd5, 0x04,
-    0x89, 0x06, 0x82, 0x08, 0x41, 0x0a, 0xfb, 0x0b,
-    0x4d, 0x0d, 0x06, 0x0e, 0x65, 0x0e, 0x4c, 0x0e,
-    0x2a, 0x0e, 0x17, 0x0e, 0xdd, 0x0d, 0x53, 0x0d,
-    0x85, 0x0c, 0xc4, 0x0b, 0x64, 0x0b, 0x84, 0x0b,
-    0xd5, 0x0b, 0x01, 0x0c, 0x04, 0x0c, 0xc1, 0x0b,
-    0x83, 0x0b, 0x2e, 0x0b, 0xaf, 0x0a, 0x1e, 0x0a,
-    0x85, 0x09, 0xf7, 0x08, 0x81, 0x08, 0x10, 0x08,
-    0xca, 0x07, 0xbc, 0x07, 0xd8, 0x07, 0x0f, 0x08,
-    0xf8, 0x07, 0xce, 0x07, 0xa0, 0x07, 0xad, 0x07,
-    0xe1, 0x07, 0x17, 0x08, 0x6c, 0x08, 0xf2, 0x08,
-    0xad, 0x09, 0x67, 0x0a, 0xc9, 0x0a, 0x07, 0x0b,
-    0x27, 0x0b, 0x0c, 0x0b, 0xbd, 0x0a, 0x0d, 0x0a,
-    0x53, 0x09, 0xb7, 0x08, 0x15, 0x08, 0x6b, 0x07,
-    0xd2, 0x06, 0x59, 0x06, 0xe5, 0x05, 0x57, 0x05,
-    0xe8, 0x04, 0x83, 0x04, 0x34, 0x04, 0xc2, 0x03,
-    0x0c, 0x03, 0x68, 0x02, 0xd4, 0x01, 0x59, 0x01,
-    0xfe, 0x00, 0xa2, 0x00, 0x45, 0x00, 0x0a, 0x00,
-    0xae, 0xff, 0x44, 0xff, 0xbf, 0xfe, 0x3e, 0xfe,
-    0xd8, 0xfd, 0x66, 0xfd, 0xf7, 0xfc, 0x8b, 0xfc,
-    0x4f, 0xfc, 0x47, 0xfc, 0x62, 0xfc, 0x82, 0xfc,
-    0x7c, 0xfc, 0x55, 0xfc, 0x37, 0xfc, 0x02, 0xfc,
-    0xc5, 0xfb, 0x49, 0xfb, 0xd9, 0xfa, 0x63, 0xfa,
-    0xf1, 0xf9, 0x8d, 0xf9, 0x1d, 0xf9, 0xb6, 0xf8,
-    0x25, 0xf8, 0xc0, 0xf7, 0x42, 0xf7, 0xf5, 0xf6,
-    0x7b, 0xf6, 0x0d, 0xf6, 0xda, 0xf5, 0x86, 0xf5,
-    0x43, 0xf5, 0xe0, 0xf4, 0x98, 0xf4, 0x34, 0xf4,
-    0xc1, 0xf3, 0x3d, 0xf3, 0xb0, 0xf2, 0x36, 0xf2,
-    0xae, 0xf1, 0x26, 0xf1, 0xae, 0xf0, 0x55, 0xf0,
-    0xfc, 0xef, 0x97, 0xef, 0x3a, 0xef, 0xe6, 0xee,
-    0xc4, 0xee, 0xaf, 0xee, 0xc6, 0xee, 0x8a, 0xef,
-    0x2a, 0xf1, 0x21, 0xf3, 0x62, 0xf4, 0xd2, 0xf4,
-    0xb7, 0xf4, 0xad, 0xf4, 0xa0, 0xf4, 0x66, 0xf4,
-    0x75, 0xf4, 0x45, 0xf5, 0xc0, 0xf6, 0x2e, 0xf8,
-    0x2d, 0xf9, 0x35, 0xfa, 0xab, 0xfb, 0x4f, 0xfd,
-    0xa8, 0xfe, 0x5f, 0xff, 0x4c, 0x00, 0x9c, 0x01,
-    0x5c, 0x03, 0x10, 0x05, 0xc4, 0x06, 0x96, 0x08,
-    0x4f, 0x0a, 0xf0, 0x0b, 0xe0, 0x0c, 0x44, 0x0d,
-    0x4e, 0x0d, 0x55, 0x0d, 0x6c, 0x0d, 0x67, 0x0d,
-    0xf8, 0x0c, 0x47, 0x0c, 0xa8, 0x0b, 0x59, 0x0b,
-    0x86, 0x0b, 0xe1, 0x0b, 0x47, 0x0c, 0x82, 0x0c,
-    0x9e, 0x0c, 0x9f, 0x0c, 0x4a, 0x0c, 0xc4, 0x0b,
-    0x13, 0x0b, 0x85, 0x0a, 0xfd, 0x09, 0x6b, 0x09,
-    0xe6, 0x08, 0x7d, 0x08, 0x70, 0x08, 0x9f, 0x08,
-    0xcc, 0x08, 0xc3, 0x08, 0x8c, 0x08, 0x5c, 0x08,
-    0x77, 0x08, 0x90, 0x08, 0xb6, 0x08, 0xef, 0x08,
-    0x61, 0x09, 0x07, 0x0a, 0x9c, 0x0a, 0x09, 0x0b,
-    0x3a, 0x0b, 0x5d, 0x0b, 0x4f, 0x0b, 0xfd, 0x0a,
-    0x5d, 0x0a, 0x7e, 0x09, 0xbc, 0x08, 0x24, 0x08,
-    0x7d, 0x07, 0xd4, 0x06, 0x3c, 0x06, 0xc4, 0x05,
-    0x53, 0x05, 0xec, 0x04, 0x91, 0x04, 0x44, 0x04,
-    0xec, 0x03, 0x78, 0x03, 0xe5, 0x02, 0x45, 0x02,
-    0xaa, 0x01, 0x21, 0x01, 0xd3, 0x00, 0x6f, 0x00,
-    0x03, 0x00, 0x7f, 0xff, 0x12, 0xff, 0xaf, 0xfe,
-    0x2c, 0xfe, 0xbf, 0xfd, 0x3b, 0xfd, 0xd0, 0xfc,
-    0x6f, 0xfc, 0x31, 0xfc, 0x23, 0xfc, 0x2d, 0xfc,
-    0x4a, 0xfc, 0x5b, 0xfc, 0x69, 0xfc, 0x56, 0xfc,
-    0x22, 0xfc, 0xc7, 0xfb, 0x5e, 0xfb, 0xe1, 0xfa,
-    0x7b, 0xfa, 0x0d, 0xfa, 0x95, 0xf9, 0x26, 0xf9,
-    0xad, 0xf8, 0x5e, 0xf8, 0x00, 0xf8, 0xa7, 0xf7,
-    0x37, 0xf7, 0xbc, 0xf6, 0x4b, 0xf6, 0xdf, 0xf5,
-    0x82, 0xf5, 0x2f, 0xf5, 0x0a, 0xf5, 0xee, 0xf4,
-    0xbf, 0xf4, 0x7c, 0xf4, 0x1d, 0xf4, 0xad, 0xf3,
-    0x23, 0xf3, 0x8d, 0xf2, 0xe7, 0xf1, 0x48, 0xf1,
-    0x87, 0xf0, 0xcc, 0xef, 0x43, 0xef, 0xf1, 0xee,
-    0xc5, 0xee, 0x8c, 0xee, 0x8d, 0xee, 0x7f, 0xee,
-    0x76, 0xee, 0x50, 0xee, 0x6b, 0xee, 0x56, 0xef,
-    0x05, 0xf1, 0xda, 0xf2, 0xea, 0xf3, 0x74, 0xf4,
-    0xac, 0xf4, 0xeb, 0xf4, 0xf9, 0xf4, 0xb8, 0xf4,
-    0xe3, 0xf4, 0xec, 0xf5, 0x7e, 0xf7, 0xd1, 0xf8,
-    0xc8, 0xf9, 0xe5, 0xfa, 0xb1, 0xfc, 0xbd, 0xfe,
-    0x60, 0x00, 0x6e, 0x01, 0x52, 0x02, 0x94, 0x03,
-    0x0b, 0x05, 0x9d, 0x06, 0x35, 0x08, 0x10, 0x0a,
-    0xf0, 0x0b, 0x65, 0x0d, 0x30, 0x0e, 0x4c, 0x0e,
-    0x46, 0x0e, 0x32, 0x0e, 0x2b, 0x0e, 0x14, 0x0e,
-    0xaa, 0x0d, 0x02, 0x0d, 0x87, 0x0c, 0x6d, 0x0c,
-    0xbf, 0x0c, 0x2d, 0x0d, 0x63, 0x0d, 0x95, 0x0d,
-    0x98, 0x0d, 0x77, 0x0d, 0x0d, 0x0d, 0x70, 0x0c,
-    0xcb, 0x0b, 0x29, 0x0b, 0xb0, 0x0a, 0x00, 0x0a,
-    0x67, 0x09, 0xf5, 0x08, 0xe6, 0x08, 0x2e, 0x09,
-    0x59, 0x09, 0x5a, 0x09, 0x46, 0x09, 0x4c, 0x09,
-    0x78, 0x09, 0xba, 0x09, 0xe9, 0x09, 0x30, 0x0a,
-    0x80, 0x0a, 0x01, 0x0b, 0x7e, 0x0b, 0xd3, 0x0b,
-    0x08, 0x0c, 0x1d, 0x0c, 0x0a, 0x0c, 0x8e, 0x0b,
-    0xcc, 0x0a, 0xee, 0x09, 0x26, 0x09, 0x96, 0x08,
-    0x04, 0x08, 0x80, 0x07, 0x0e, 0x07, 0x8f, 0x06,
-    0x23, 0x06, 0xbd, 0x05, 0x58, 0x05, 0xf2, 0x04,
-    0x76, 0x04, 0xcc, 0x03, 0x0f, 0x03, 0x4d, 0x02,
-    0xc1, 0x01, 0x33, 0x01, 0xb8, 0x00, 0x28, 0x00,
-    0xa2, 0xff, 0x2f, 0xff, 0xa9, 0xfe, 0x30, 0xfe,
-    0xb6, 0xfd, 0x64, 0xfd, 0x13, 0xfd, 0xc2, 0xfc,
-    0x53, 0xfc, 0x04, 0xfc, 0xe7, 0xfb, 0x0b, 0xfc,
-    0x27, 0xfc, 0x21, 0xfc, 0x03, 0xfc, 0xde, 0xfb,
-    0xaa, 0xfb, 0x32, 0xfb, 0xb3, 0xfa, 0x3e, 0xfa,
-    0xdc, 0xf9, 0x8a, 0xf9, 0x00, 0xf9, 0x61, 0xf8,
-    0xe2, 0xf7, 0x77, 0xf7, 0x30, 0xf7, 0xd6, 0xf6,
-    0x67, 0xf6, 0xf0, 0xf5, 0x98, 0xf5, 0x54, 0xf5,
-    0x1b, 0xf5, 0xdd, 0xf4, 0xa2, 0xf4, 0x5e, 0xf4,
-    0x1e, 0xf4, 0xc3, 0xf3, 0x37, 0xf3, 0x98, 0xf2,
-    0x0e, 0xf2, 0xb7, 0xf1, 0x3b, 0xf1, 0x9d, 0xf0,
-    0xe8, 0xef, 0x80, 0xef, 0x52, 0xef, 0x28, 0xef,
-    0xd9, 0xee, 0xb1, 0xee, 0xa4, 0xee, 0x97, 0xee,
-    0xb6, 0xee, 0x35, 0xef, 0x96, 0xf0, 0x6a, 0xf2,
-    0xe6, 0xf3, 0x88, 0xf4, 0x9f, 0xf4, 0xa1, 0xf4,
-    0x9f, 0xf4, 0x99, 0xf4, 0xac, 0xf4, 0x6e, 0xf5,
-    0xed, 0xf6, 0x56, 0xf8, 0x70, 0xf9, 0x69, 0xfa,
-    0xcb, 0xfb, 0x91, 0xfd, 0x2c, 0xff, 0x49, 0x00,
-    0x35, 0x01, 0x5c, 0x02, 0xd7, 0x03, 0x7b, 0x05,
-    0x31, 0x07, 0x19, 0x09, 0xf7, 0x0a, 0x8f, 0x0c,
-    0x86, 0x0d, 0xfe, 0x0d, 0x47, 0x0e, 0x7c, 0x0e,
-    0x93, 0x0e, 0x92, 0x0e, 0x69, 0x0e, 0xff, 0x0d,
-    0x7f, 0x0d, 0x35, 0x0d, 0x4f, 0x0d, 0xa7, 0x0d,
-    0xfe, 0x0d, 0x25, 0x0e, 0x40, 0x0e, 0x41, 0x0e,
-    0x14, 0x0e, 0xb4, 0x0d, 0x1a, 0x0d, 0x82, 0x0c,
-    0xe4, 0x0b, 0x4b, 0x0b, 0xb9, 0x0a, 0x3a, 0x0a,
-    0x21, 0x0a, 0x49, 0x0a, 0x72, 0x0a, 0x7f, 0x0a,
-    0x64, 0x0a, 0x5d, 0x0a, 0x7f, 0x0a, 0xb4, 0x0a,
-    0xeb, 0x0a, 0x15, 0x0b, 0x5e, 0x0b, 0xc8, 0x0b,
-    0x49, 0x0c, 0xab, 0x0c, 0xed, 0x0c, 0x20, 0x0d,
-    0x11, 0x0d, 0xc6, 0x0c, 0x2d, 0x0c, 0x7f, 0x0b,
-    0xd9, 0x0a, 0x26, 0x0a, 0x6f, 0x09, 0xbe, 0x08,
-    0x14, 0x08, 0x62, 0x07, 0xd0, 0x06, 0x4f, 0x06,
-    0xfd, 0x05, 0xbd, 0x05, 0x66, 0x05, 0xdb, 0x04,
-    0x12, 0x04, 0x61, 0x03, 0xbd, 0x02, 0x23, 0x02,
-    0x78, 0x01, 0xd7, 0x00, 0x5b, 0x00, 0xfc, 0xff,
-    0x8f, 0xff, 0xfe, 0xfe, 0x82, 0xfe, 0x07, 0xfe,
-    0x8f, 0xfd, 0x0c, 0xfd, 0x7a, 0xfc, 0x02, 0xfc,
-    0xd1, 0xfb, 0xcc, 0xfb, 0xba, 0xfb, 0xa1, 0xfb,
-    0x75, 0xfb, 0x61, 0xfb, 0x2f, 0xfb, 0xdd, 0xfa,
-    0x63, 0xfa, 0xd5, 0xf9, 0x50, 0xf9, 0xb0, 0xf8,
-    0x1f, 0xf8, 0x7a, 0xf7, 0xe9, 0xf6, 0x62, 0xf6,
-    0xf9, 0xf5, 0x93, 0xf5, 0x27, 0xf5, 0xc7, 0xf4,
-    0x67, 0xf4, 0x17, 0xf4, 0xc5, 0xf3, 0x8a, 0xf3,
-    0x50, 0xf3, 0x13, 0xf3, 0xd5, 0xf2, 0x95, 0xf2,
-    0x50, 0xf2, 0xfb, 0xf1, 0x99, 0xf1, 0x2c, 0xf1,
-    0xc3, 0xf0, 0x41, 0xf0, 0xbe, 0xef, 0x3d, 0xef,
-    0xe4, 0xee, 0xc7, 0xee, 0xa3, 0xee, 0x7c, 0xee,
-    0x4a, 0xee, 0x3e, 0xee, 0x31, 0xee, 0x42, 0xee,
-    0xbb, 0xee, 0x27, 0xf0, 0x27, 0xf2, 0xab, 0xf3,
-    0x56, 0xf4, 0x50, 0xf4, 0x6a, 0xf4, 0x87, 0xf4,
-    0x89, 0xf4, 0x80, 0xf4, 0x05, 0xf5, 0x45, 0xf6,
-    0xae, 0xf7, 0xda, 0xf8, 0xe3, 0xf9, 0x73, 0xfb,
-    0x62, 0xfd, 0x10, 0xff, 0x1e, 0x00, 0xf4, 0x00,
-    0x26, 0x02, 0xb3, 0x03, 0x49, 0x05, 0xd8, 0x06,
-    0xa4, 0x08, 0x8d, 0x0a, 0x3d, 0x0c, 0x7c, 0x0d,
-    0x20, 0x0e, 0x4a, 0x0e, 0x4d, 0x0e, 0x59, 0x0e,
-    0x42, 0x0e, 0xfa, 0x0d, 0x41, 0x0d, 0x8f, 0x0c,
-    0x64, 0x0c, 0xb9, 0x0c, 0x4c, 0x0d, 0xb9, 0x0d,
-    0xee, 0x0d, 0x13, 0x0e, 0x45, 0x0e, 0x18, 0x0e,
-    0x94, 0x0d, 0xe3, 0x0c, 0x62, 0x0c, 0x02, 0x0c,
-    0x6f, 0x0b, 0xc4, 0x0a, 0x44, 0x0a, 0x2f, 0x0a,
-    0x5f, 0x0a, 0x96, 0x0a, 0x94, 0x0a, 0x5b, 0x0a,
-    0x28, 0x0a, 0x24, 0x0a, 0x4e, 0x0a, 0x83, 0x0a,
-    0xa7, 0x0a, 0xfd, 0x0a, 0x7b, 0x0b, 0xff, 0x0b,
-    0x66, 0x0c, 0xa0, 0x0c, 0xbf, 0x0c, 0xab, 0x0c,
-    0x5c, 0x0c, 0xbc, 0x0b, 0xd5, 0x0a, 0xe8, 0x09,
-    0x26, 0x09, 0x96, 0x08, 0xf9, 0x07, 0x55, 0x07,
-    0xb8, 0x06, 0x3b, 0x06, 0xed, 0x05, 0xa0, 0x05,
-    0x4d, 0x05, 0xe8, 0x04, 0x52, 0x04, 0x84, 0x03,
-    0xc0, 0x02, 0xfd, 0x01, 0x6c, 0x01, 0x17, 0x01,
-    0xae, 0x00, 0x3a, 0x00, 0xbe, 0xff, 0x3f, 0xff,
-    0xbe, 0xfe, 0x37, 0xfe, 0xab, 0xfd, 0x35, 0xfd,
-    0xbc, 0xfc, 0x26, 0xfc, 0xa0, 0xfb, 0x65, 0xfb,
-    0x63, 0xfb, 0x72, 0xfb, 0x66, 0xfb, 0x40, 0xfb,
-    0x26, 0xfb, 0xee, 0xfa, 0x8e, 0xfa, 0xfa, 0xf9,
-    0x5a, 0xf9, 0xe6, 0xf8, 0x76, 0xf8, 0xee, 0xf7,
-    0x4d, 0xf7, 0xbc, 0xf6, 0x5d, 0xf6, 0x0e, 0xf6,
-    0xa6, 0xf5, 0x34, 0xf5, 0xb3, 0xf4, 0x2f, 0xf4,
-    0xb2, 0xf3, 0x49, 0xf3, 0xff, 0xf2, 0xc6, 0xf2,
-    0x90, 0xf2, 0x4e, 0xf2, 0x1c, 0xf2, 0xc7, 0xf1,
-    0x52, 0xf1, 0xd1, 0xf0, 0x45, 0xf0, 0xdc, 0xef,
-    0x71, 0xef, 0xde, 0xee, 0x4f, 0xee, 0x09, 0xee,
-    0xfc, 0xed, 0x09, 0xee, 0xf2, 0xed, 0xd9, 0xed,
-    0xf8, 0xed, 0x0d, 0xee, 0x0e, 0xee, 0x27, 0xee,
-    0xf9, 0xee, 0x84, 0xf0, 0x31, 0xf2, 0x5a, 0xf3,
-    0xcd, 0xf3, 0x0a, 0xf4, 0x3e, 0xf4, 0x5a, 0xf4,
-    0x4a, 0xf4, 0x93, 0xf4, 0x95, 0xf5, 0x23, 0xf7,
-    0x99, 0xf8, 0xad, 0xf9, 0xda, 0xfa, 0x62, 0xfc,
-    0x22, 0xfe, 0x91, 0xff, 0x9e, 0x00, 0x9d, 0x01,
-    0xe3, 0x02, 0x5c, 0x04, 0xef, 0x05, 0xa4, 0x07,
-    0x65, 0x09, 0x2b, 0x0b, 0x85, 0x0c, 0x4f, 0x0d,
-    0xa9, 0x0d, 0xcd, 0x0d, 0xf6, 0x0d, 0x12, 0x0e,
-    0x0e, 0x0e, 0xe4, 0x0d, 0x84, 0x0d, 0x04, 0x0d,
-    0xc8, 0x0c, 0xdc, 0x0c, 0x44, 0x0d, 0xaf, 0x0d,
-    0xcc, 0x0d, 0xd2, 0x0d, 0xc1, 0x0d, 0x8f, 0x0d,
-    0x3b, 0x0d, 0xb9, 0x0c, 0x12, 0x0c, 0x87, 0x0b,
-    0x0d, 0x0b, 0x97, 0x0a, 0x43, 0x0a, 0x27, 0x0a,
-    0x5c, 0x0a, 0x9f, 0x0a, 0xa3, 0x0a, 0x71, 0x0a,
-    0x54, 0x0a, 0x5b, 0x0a, 0x7c, 0x0a, 0x9e, 0x0a,
-    0xc6, 0x0a, 0x1b, 0x0b, 0x78, 0x0b, 0xe2, 0x0b,
-    0x42, 0x0c, 0x83, 0x0c, 0x9d, 0x0c, 0x7f, 0x0c,
-    0x1d, 0x0c, 0x82, 0x0b, 0xd4, 0x0a, 0x1e, 0x0a,
-    0x71, 0x09, 0xc9, 0x08, 0x35, 0x08, 0xa1, 0x07,
-    0x08, 0x07, 0x79, 0x06, 0x14, 0x06, 0xdf, 0x05,
-    0x94, 0x05, 0x1d, 0x05, 0x78, 0x04, 0xca, 0x03,
-    0x23, 0x03, 0x7c, 0x02, 0xf5, 0x01, 0x73, 0x01,
-    0xf2, 0x00, 0x80, 0x00, 0x14, 0x00, 0x9c, 0xff,
-    0x1d, 0xff, 0x96, 0xfe, 0x1a, 0xfe, 0xac, 0xfd,
-    0x1e, 0xfd, 0x8c, 0xfc, 0x0f, 0xfc, 0xc5, 0xfb,
-    0xb9, 0xfb, 0xc5, 0xfb, 0xc9, 0xfb, 0x97, 0xfb,
-    0x4d, 0xfb, 0xef, 0xfa, 0x85, 0xfa, 0x12, 0xfa,
-    0x92, 0xf9, 0x0e, 0xf9, 0x70, 0xf8, 0xd7, 0xf7,
-    0x42, 0xf7, 0xb4, 0xf6, 0x30, 0xf6, 0xb6, 0xf5,
-    0x5c, 0xf5, 0x09, 0xf5, 0xa1, 0xf4, 0x26, 0xf4,
-    0xbc, 0xf3, 0x79, 0xf3, 0x4f, 0xf3, 0x0c, 0xf3,
-    0xb8, 0xf2, 0x63, 0xf2, 0x0d, 0xf2, 0xc7, 0xf1,
-    0x6e, 0xf1, 0x0c, 0xf1, 0xb5, 0xf0, 0x56, 0xf0,
-    0xea, 0xef, 0x77, 0xef, 0x12, 0xef, 0xc7, 0xee,
-    0x88, 0xee, 0x56, 0xee, 0x42, 0xee, 0x3b, 0xee,
-    0x35, 0xee, 0x58, 0xee, 0x02, 0xef, 0x63, 0xf0,
-    0xfb, 0xf1, 0x1b, 0xf3, 0x87, 0xf3, 0xae, 0xf3,
-    0xde, 0xf3, 0x0d, 0xf4, 0x21, 0xf4, 0x51, 0xf4,
-    0x36, 0xf5, 0xb3, 0xf6, 0x0a, 0xf8, 0xee, 0xf8,
-    0xb4, 0xf9, 0x09, 0xfb, 0xdc, 0xfc, 0x7e, 0xfe,
-    0xa0, 0xff, 0x93, 0x00, 0xce, 0x01, 0x53, 0x03,
-    0xea, 0x04, 0x66, 0x06, 0xff, 0x07, 0xc8, 0x09,
-    0x89, 0x0b, 0xda, 0x0c, 0x6c, 0x0d, 0x97, 0x0d,
-    0xca, 0x0d, 0x29, 0x0e, 0x6e, 0x0e, 0x37, 0x0e,
-    0x8e, 0x0d, 0xf4, 0x0c, 0xf6, 0x0c, 0x68, 0x0d,
-    0xfe, 0x0d, 0x52, 0x0e, 0x84, 0x0e, 0xd0, 0x0e,
-    0xeb, 0x0e, 0xad, 0x0e, 0x24, 0x0e, 0x9a, 0x0d,
-    0x3d, 0x0d, 0xea, 0x0c, 0x72, 0x0c, 0xea, 0x0b,
-    0x80, 0x0b, 0x67, 0x0b, 0x9a, 0x0b, 0xbe, 0x0b,
-    0x9c, 0x0b, 0x4f, 0x0b, 0x35, 0x0b, 0x4e, 0x0b,
-    0x82, 0x0b, 0xb0, 0x0b, 0xd9, 0x0b, 0x2c, 0x0c,
-    0x98, 0x0c, 0x05, 0x0d, 0x54, 0x0d, 0x87, 0x0d,
-    0x99, 0x0d, 0x93, 0x0d, 0x42, 0x0d, 0x92, 0x0c,
-    0xbc, 0x0b, 0xf2, 0x0a, 0x5b, 0x0a, 0xd4, 0x09,
-    0x4b, 0x09, 0xb3, 0x08, 0x14, 0x08, 0x99, 0x07,
-    0x50, 0x07, 0x0f, 0x07, 0xb5, 0x06, 0x3e, 0x06,
-    0x9d, 0x05, 0xe4, 0x04, 0x14, 0x04, 0x46, 0x03,
-    0xbb, 0x02, 0x57, 0x02, 0xdf, 0x01, 0x64, 0x01,
-    0xc3, 0x00, 0x28, 0x00, 0xb2, 0xff, 0x3d, 0xff,
-    0xde, 0xfe, 0x5d, 0xfe, 0xd2, 0xfd, 0x59, 0xfd,
-    0x04, 0xfd, 0xd5, 0xfc, 0xc6, 0xfc, 0xc9, 0xfc,
-    0xbd, 0xfc, 0xb7, 0xfc, 0x7b, 0xfc, 0x1b, 0xfc,
-    0x9a, 0xfb, 0x13, 0xfb, 0xa8, 0xfa, 0x30, 0xfa,
-    0x98, 0xf9, 0xef, 0xf8, 0x5f, 0xf8, 0xe2, 0xf7,
-    0x7c, 0xf7, 0x14, 0xf7, 0xba, 0xf6, 0x5d, 0xf6,
-    0xee, 0xf5, 0x7f, 0xf5, 0x03, 0xf5, 0x97, 0xf4,
-    0x48, 0xf4, 0x0e, 0xf4, 0xda, 0xf3, 0xa7, 0xf3,
-    0x57, 0xf3, 0xf4, 0xf2, 0x84, 0xf2, 0x11, 0xf2,
-    0xb3, 0xf1, 0x3b, 0xf1, 0x9e, 0xf0, 0xec, 0xef,
-    0x7e, 0xef, 0x3c, 0xef, 0x00, 0xef, 0xb7, 0xee,
-    0x66, 0xee, 0x59, 0xee, 0x4d, 0xee, 0x2d, 0xee,
-    0x1c, 0xee, 0x85, 0xee, 0xc6, 0xef, 0x72, 0xf1,
-    0xbe, 0xf2, 0x61, 0xf3, 0xa6, 0xf3, 0xd2, 0xf3,
-    0xd5, 0xf3, 0x88, 0xf3, 0x6b, 0xf3, 0x14, 0xf4,
-    0x74, 0xf5, 0xd9, 0xf6, 0xe6, 0xf7, 0xee, 0xf8,
-    0x49, 0xfa, 0xf6, 0xfb, 0x65, 0xfd, 0x59, 0xfe,
-    0x17, 0xff, 0x17, 0x00, 0x70, 0x01, 0xfc, 0x02,
-    0xa1, 0x04, 0x72, 0x06, 0x68, 0x08, 0x24, 0x0a,
-    0x79, 0x0b, 0x26, 0x0c, 0x7e, 0x0c, 0xaa, 0x0c,
-    0xd8, 0x0c, 0x20, 0x0d, 0x0d, 0x0d, 0xb0, 0x0c,
-    0x48, 0x0c, 0x53, 0x0c, 0xc8, 0x0c, 0x50, 0x0d,
-    0xb6, 0x0d, 0xec, 0x0d, 0x28, 0x0e, 0x4a, 0x0e,
-    0x27, 0x0e, 0xc1, 0x0d, 0x38, 0x0d, 0xbe, 0x0c,
-    0x79, 0x0c, 0x1e, 0x0c, 0xa7, 0x0b, 0x5c, 0x0b,
-    0x4e, 0x0b, 0x90, 0x0b, 0xbd, 0x0b, 0xa5, 0x0b,
-    0x6c, 0x0b, 0x3d, 0x0b, 0x31, 0x0b, 0x44, 0x0b,
-    0x61, 0x0b, 0x80, 0x0b, 0xcf, 0x0b, 0x4a, 0x0c,
-    0xcb, 0x0c, 0x27, 0x0d, 0x5d, 0x0d, 0x6c, 0x0d,
-    0x51, 0x0d, 0xf1, 0x0c, 0x40, 0x0c, 0x81, 0x0b,
-    0xca, 0x0a, 0x3c, 0x0a, 0xc7, 0x09, 0x4c, 0x09,
-    0xd4, 0x08, 0x43, 0x08, 0xc8, 0x07, 0x53, 0x07,
-    0xd3, 0x06, 0x5e, 0x06, 0xe0, 0x05, 0x4a, 0x05,
-    0x9f, 0x04, 0xf1, 0x03, 0x50, 0x03, 0xce, 0x02,
-    0x61, 0x02, 0xf0, 0x01, 0x86, 0x01, 0xff, 0x00,
-    0x52, 0x00, 0xba, 0xff, 0x3b, 0xff, 0xc7, 0xfe,
-    0x4a, 0xfe, 0xa4, 0xfd, 0xfa, 0xfc, 0x8e, 0xfc,
-    0x58, 0xfc, 0x4f, 0xfc, 0x52, 0xfc, 0x32, 0xfc,
-    0x1d, 0xfc, 0xeb, 0xfb, 0x86, 0xfb, 0x09, 0xfb,
-    0x7f, 0xfa, 0x1a, 0xfa, 0xb9, 0xf9, 0x3f, 0xf9,
-    0xb0, 0xf8, 0x23, 0xf8, 0x98, 0xf7, 0x1f, 0xf7,
-    0xb9, 0xf6, 0x49, 0xf6, 0xd7, 0xf5, 0x40, 0xf5,
-    0xaa, 0xf4, 0x20, 0xf4, 0xa7, 0xf3, 0x4d, 0xf3,
-    0x0b, 0xf3, 0xd2, 0xf2, 0xa2, 0xf2, 0x79, 0xf2,
-    0x2e, 0xf2, 0xe3, 0xf1, 0x93, 0xf1, 0x42, 0xf1,
-    0xe9, 0xf0, 0x67, 0xf0, 0xd4, 0xef, 0x3e, 0xef,
-    0xcc, 0xee, 0x76, 0xee, 0x57, 0xee, 0x29, 0xee,
-    0xe9, 0xed, 0xc9, 0xed, 0xc5, 0xed, 0xd1, 0xed,
-    0xc0, 0xed, 0x05, 0xee, 0xf0, 0xee, 0x63, 0xf0,
-    0xb9, 0xf1, 0x7e, 0xf2, 0xdd, 0xf2, 0x1c, 0xf3,
-    0x6c, 0xf3, 0x88, 0xf3, 0x9f, 0xf3, 0x08, 0xf4,
-    0xfb, 0xf4, 0x34, 0xf6, 0x36, 0xf7, 0x17, 0xf8,
-    0x3c, 0xf9, 0xdf, 0xfa, 0x7a, 0xfc, 0xc7, 0xfd,
-    0xc1, 0xfe, 0xb8, 0xff, 0x01, 0x01, 0x80, 0x02,
-    0x21, 0x04, 0xbf, 0x05, 0x63, 0x07, 0x10, 0x09,
-    0x97, 0x0a, 0x92, 0x0b, 0xf8, 0x0b, 0x1a, 0x0c,
-    0x4c, 0x0c, 0x8d, 0x0c, 0x8f, 0x0c, 0x40, 0x0c,
-    0xc0, 0x0b, 0x83, 0x0b, 0xb7, 0x0b, 0x37, 0x0c,
-    0xc2, 0x0c, 0x2c, 0x0d, 0x83, 0x0d, 0xb6, 0x0d,
-    0xb5, 0x0d, 0x75, 0x0d, 0x1d, 0x0d, 0xca, 0x0c,
-    0x7d, 0x0c, 0x27, 0x0c, 0xc4, 0x0b, 0x5c, 0x0b,
-    0x24, 0x0b, 0x3f, 0x0b, 0x7e, 0x0b, 0xa7, 0x0b,
-    0x83, 0x0b, 0x3d, 0x0b, 0x1c, 0x0b, 0x30, 0x0b,
-    0x59, 0x0b, 0x7e, 0x0b, 0xaa, 0x0b, 0xf3, 0x0b,
-    0x5d, 0x0c, 0xbd, 0x0c, 0xfe, 0x0c, 0x1c, 0x0d,
-    0x25, 0x0d, 0xfb, 0x0c, 0x7a, 0x0c, 0xa9, 0x0b,
-    0xae, 0x0a, 0xd1, 0x09, 0x25, 0x09, 0xa9, 0x08,
-    0x31, 0x08, 0xbf, 0x07, 0x47, 0x07, 0xce, 0x06,
-    0x68, 0x06, 0xfc, 0x05, 0x89, 0x05, 0xfe, 0x04,
-    0x52, 0x04, 0x97, 0x03, 0xf6, 0x02, 0x70, 0x02,
-    0x09, 0x02, 0xaf, 0x01, 0x3a, 0x01, 0xc9, 0x00,
-    0x50, 0x00, 0xc1, 0xff, 0x1b, 0xff, 0x7a, 0xfe,
-    0xf7, 0xfd, 0x82, 0xfd, 0xff, 0xfc, 0x87, 0xfc,
-    0x48, 0xfc, 0x30, 0xfc, 0x2d, 0xfc, 0x13, 0xfc,
-    0xf2, 0xfb, 0xcf, 0xfb, 0x94, 0xfb, 0x28, 0xfb,
-    0x86, 0xfa, 0xd6, 0xf9, 0x46, 0xf9, 0xd9, 0xf8,
-    0x54, 0xf8, 0xbf, 0xf7, 0x37, 0xf7, 0xc8, 0xf6,
-    0x6b, 0xf6, 0x16, 0xf6, 0xa7, 0xf5, 0x22, 0xf5,
-    0x8f, 0xf4, 0xff, 0xf3, 0xa8, 0xf3, 0x61, 0xf3,
-    0x22, 0xf3, 0xfc, 0xf2, 0xd1, 0xf2, 0x96, 0xf2,
-    0x37, 0xf2, 0xca, 0xf1, 0x5e, 0xf1, 0x01, 0xf1,
-    0x9f, 0xf0, 0x2b, 0xf0, 0x97, 0xef, 0x11, 0xef,
-    0xca, 0xee, 0xae, 0xee, 0x92, 0xee, 0x6b, 0xee,
-    0x64, 0xee, 0x53, 0xee, 0x35, 0xee, 0x37, 0xee,
-    0xd2, 0xee, 0x22, 0xf0, 0x84, 0xf1, 0x9b, 0xf2,
-    0x23, 0xf3, 0x53, 0xf3, 0x64, 0xf3, 0x40, 0xf3,
-    0x0e, 0xf3, 0x3c, 0xf3, 0x10, 0xf4, 0x52, 0xf5,
-    0x8a, 0xf6, 0x7f, 0xf7, 0xad, 0xf8, 0x30, 0xfa,
-    0xb4, 0xfb, 0xea, 0xfc, 0xe7, 0xfd, 0xfd, 0xfe,
-    0x23, 0x00, 0x72, 0x01, 0xd2, 0x02, 0x74, 0x04,
-    0x5a, 0x06, 0x31, 0x08, 0xc2, 0x09, 0xbf, 0x0a,
-    0x47, 0x0b, 0x9f, 0x0b, 0xea, 0x0b, 0x33, 0x0c,
-    0x69, 0x0c, 0x74, 0x0c, 0x52, 0x0c, 0x22, 0x0c,
-    0x25, 0x0c, 0x84, 0x0c, 0xfe, 0x0c, 0x83, 0x0d,
-    0xfc, 0x0d, 0x4d, 0x0e, 0x60, 0x0e, 0x17, 0x0e,
-    0xb7, 0x0d, 0x5c, 0x0d, 0x11, 0x0d, 0xb1, 0x0c,
-    0x2b, 0x0c, 0xba, 0x0b, 0x7d, 0x0b, 0x96, 0x0b,
-    0xd4, 0x0b, 0xea, 0x0b, 0xed, 0x0b, 0xdd, 0x0b,
-    0xc1, 0x0b, 0xa5, 0x0b, 0x90, 0x0b, 0xa9, 0x0b,
-    0xfb, 0x0b, 0x68, 0x0c, 0xd1, 0x0c, 0x23, 0x0d,
-    0x67, 0x0d, 0xa1, 0x0d, 0xb5, 0x0d, 0x92, 0x0d,
-    0x17, 0x0d, 0x6c, 0x0c, 0xce, 0x0b, 0x3b, 0x0b,
-    0xc4, 0x0a, 0x40, 0x0a, 0xc9, 0x09, 0x56, 0x09,
-    0xd8, 0x08, 0x58, 0x08, 0xcc, 0x07, 0x69, 0x07,
-    0x18, 0x07, 0xae, 0x06, 0x11, 0x06, 0x4e, 0x05,
-    0x8f, 0x04, 0xf5, 0x03, 0x7f, 0x03, 0x06, 0x03,
-    0x86, 0x02, 0xff, 0x01, 0x8e, 0x01, 0x0e, 0x01,
-    0x75, 0x00, 0xd3, 0xff, 0x53, 0xff, 0xfb, 0xfe,
-    0x85, 0xfe, 0x05, 0xfe, 0x87, 0xfd, 0x33, 0xfd,
-    0x13, 0xfd, 0xfb, 0xfc, 0xe6, 0xfc, 0xc7, 0xfc,
-    0x91, 0xfc, 0x2e, 0xfc, 0x9f, 0xfb, 0xfd, 0xfa,
-    0x82, 0xfa, 0x35, 0xfa, 0xcf, 0xf9, 0x48, 0xf9,
-    0xb9, 0xf8, 0x35, 0xf8, 0xb9, 0xf7, 0x4b, 0xf7,
-    0xdf, 0xf6, 0x77, 0xf6, 0xfc, 0xf5, 0x66, 0xf5,
-    0xe7, 0xf4, 0x73, 0xf4, 0x21, 0xf4, 0xf5, 0xf3,
-    0xd4, 0xf3, 0xb4, 0xf3, 0x83, 0xf3, 0x50, 0xf3,
-    0x09, 0xf3, 0xa8, 0xf2, 0x41, 0xf2, 0xef, 0xf1,
-    0x8c, 0xf1, 0x0a, 0xf1, 0x97, 0xf0, 0x3e, 0xf0,
-    0x01, 0xf0, 0xd9, 0xef, 0xb0, 0xef, 0x90, 0xef,
-    0x78, 0xef, 0x3e, 0xef, 0x03, 0xef, 0xf9, 0xee,
-    0x7b, 0xef, 0xc2, 0xf0, 0x39, 0xf2, 0x3e, 0xf3,
-    0xb2, 0xf3, 0xd6, 0xf3, 0xf6, 0xf3, 0x01, 0xf4,
-    0xf1, 0xf3, 0x2a, 0xf4, 0xe4, 0xf4, 0xf0, 0xf5,
-    0x07, 0xf7, 0x0b, 0xf8, 0x0e, 0xf9, 0x5d, 0xfa,
-    0xe9, 0xfb, 0x3a, 0xfd, 0x2d, 0xfe, 0xf7, 0xfe,
-    0xee, 0xff, 0x3d, 0x01, 0xb4, 0x02, 0x4b, 0x04,
-    0x0f, 0x06, 0xd3, 0x07, 0x74, 0x09, 0x9a, 0x0a,
-    0x32, 0x0b, 0x84, 0x0b, 0xc7, 0x0b, 0x2a, 0x0c,
-    0x7b, 0x0c, 0x62, 0x0c, 0x01, 0x0c, 0xc5, 0x0b,
-    0xde, 0x0b, 0x4c, 0x0c, 0xe1, 0x0c, 0x79, 0x0d,
-    0xfb, 0x0d, 0x69, 0x0e, 0x88, 0x0e, 0x3d, 0x0e,
-    0xc8, 0x0d, 0x56, 0x0d, 0x1f, 0x0d, 0xe7, 0x0c,
-    0x91, 0x0c, 0x3a, 0x0c, 0xfc, 0x0b, 0x02, 0x0c,
-    0x3c, 0x0c, 0x6c, 0x0c, 0x69, 0x0c, 0x2c, 0x0c,
-    0xe6, 0x0b, 0xd4, 0x0b, 0xe6, 0x0b, 0x12, 0x0c,
-    0x5d, 0x0c, 0xca, 0x0c, 0x4b, 0x0d, 0x9f, 0x0d,
-    0xc9, 0x0d, 0xea, 0x0d, 0x0d, 0x0e, 0x0f, 0x0e,
-    0xbc, 0x0d, 0x14, 0x0d, 0x33, 0x0c, 0x67, 0x0b,
-    0xce, 0x0a, 0x4d, 0x0a, 0xfd, 0x09, 0xb2, 0x09,
-    0x54, 0x09, 0xed, 0x08, 0x78, 0x08, 0xfa, 0x07,
-    0x8c, 0x07, 0x28, 0x07, 0xa5, 0x06, 0xf7, 0x05,
-    0x26, 0x05, 0x57, 0x04, 0xb3, 0x03, 0x60, 0x03,
-    0x1a, 0x03, 0xb3, 0x02, 0x2e, 0x02, 0x7e, 0x01,
-    0xcd, 0x00, 0x18, 0x00, 0x69, 0xff, 0xda, 0xfe,
-    0x74, 0xfe, 0x12, 0xfe, 0x9b, 0xfd, 0x3d, 0xfd,
-    0x09, 0xfd, 0xf5, 0xfc, 0xe7, 0xfc, 0xba, 0xfc,
-    0x61, 0xfc, 0xe7, 0xfb, 0x4c, 0xfb, 0xb0, 0xfa,
-    0x1f, 0xfa, 0x90, 0xf9, 0x14, 0xf9, 0x95, 0xf8,
-    0x08, 0xf8, 0x80, 0xf7, 0xff, 0xf6, 0x8c, 0xf6,
-    0x19, 0xf6, 0x9f, 0xf5, 0x21, 0xf5, 0x89, 0xf4,
-    0xed, 0xf3, 0x5f, 0xf3, 0x01, 0xf3, 0xc3, 0xf2,
-    0x9e, 0xf2, 0x8b, 0xf2, 0x6e, 0xf2, 0x43, 0xf2,
-    0xef, 0xf1, 0x90, 0xf1, 0x27, 0xf1, 0xc1, 0xf0,
-    0x62, 0xf0, 0x06, 0xf0, 0x8d, 0xef, 0x1f, 0xef,
-    0xed, 0xee, 0xda, 0xee, 0xe6, 0xee, 0xdc, 0xee,
-    0xcd, 0xee, 0xc5, 0xee, 0xa9, 0xee, 0x8b, 0xee,
-    0x9b, 0xee, 0x22, 0xef, 0x3c, 0xf0, 0xb4, 0xf1,
-    0xee, 0xf2, 0xa5, 0xf3, 0xf1, 0xf3, 0x15, 0xf4,
-    0x2a, 0xf4, 0x25, 0xf4, 0x65, 0xf4, 0x3b, 0xf5,
-    0x72, 0xf6, 0x9b, 0xf7, 0xa1, 0xf8, 0xa0, 0xf9,
-    0xe1, 0xfa, 0x66, 0xfc, 0xb1, 0xfd, 0xc2, 0xfe,
-    0xbc, 0xff, 0xc1, 0x00, 0x05, 0x02, 0x5e, 0x03,
-    0xba, 0x04, 0x42, 0x06, 0xf6, 0x07, 0x84, 0x09,
-    0xb4, 0x0a, 0x62, 0x0b, 0xb3, 0x0b, 0xe3, 0x0b,
-    0x18, 0x0c, 0x5f, 0x0c, 0x60, 0x0c, 0x0d, 0x0c,
-    0xaf, 0x0b, 0xa0, 0x0b, 0xee, 0x0b, 0x7e, 0x0c,
-    0xfe, 0x0c, 0x55, 0x0d, 0xa8, 0x0d, 0xd4, 0x0d,
-    0xc9, 0x0d, 0x78, 0x0d, 0x01, 0x0d, 0xa7, 0x0c,
-    0x6f, 0x0c, 0x18, 0x0c, 0xad, 0x0b, 0x62, 0x0b,
-    0x6b, 0x0b, 0xc0, 0x0b, 0xfc, 0x0b, 0x05, 0x0c,
-    0xe1, 0x0b, 0xab, 0x0b, 0x90, 0x0b, 0x9c, 0x0b,
-    0xa4, 0x0b, 0xbe, 0x0b, 0x04, 0x0c, 0x5e, 0x0c,
-    0xba, 0x0c, 0xf3, 0x0c, 0x17, 0x0d, 0x26, 0x0d,
-    0x12, 0x0d, 0xbc, 0x0c, 0x23, 0x0c, 0x4e, 0x0b,
-    0x77, 0x0a, 0xc3, 0x09, 0x1d, 0x09, 0x94, 0x08,
-    0x0b, 0x08, 0x7f, 0x07, 0x00, 0x07, 0x8e, 0x06,
-    0x19, 0x06, 0xb9, 0x05, 0x5e, 0x05, 0xd7, 0x04,
-    0x32, 0x04, 0x7a, 0x03, 0xbf, 0x02, 0x15, 0x02,
-    0x9a, 0x01, 0x31, 0x01, 0xcc, 0x00, 0x63, 0x00,
-    0xd3, 0xff, 0x1b, 0xff, 0x6d, 0xfe, 0xdd, 0xfd,
-    0x53, 0xfd, 0xdc, 0xfc, 0x69, 0xfc, 0xf0, 0xfb,
-    0x9c, 0xfb, 0x72, 0xfb, 0x58, 0xfb, 0x4d, 0xfb,
-    0x2e, 0xfb, 0xe7, 0xfa, 0x7e, 0xfa, 0xf8, 0xf9,
-    0x67, 0xf9, 0xec, 0xf8, 0x80, 0xf8, 0x01, 0xf8,
-    0x66, 0xf7, 0xcf, 0xf6, 0x48, 0xf6, 0xd6, 0xf5,
-    0x70, 0xf5, 0x05, 0xf5, 0x9b, 0xf4, 0x29, 0xf4,
-    0xbe, 0xf3, 0x58, 0xf3, 0xf7, 0xf2, 0xb0, 0xf2,
-    0x86, 0xf2, 0x68, 0xf2, 0x45, 0xf2, 0x1c, 0xf2,
-    0xda, 0xf1, 0x82, 0xf1, 0x19, 0xf1, 0xc3, 0xf0,
-    0x6b, 0xf0, 0xff, 0xef, 0x81, 0xef, 0x11, 0xef,
-    0xd8, 0xee, 0xb7, 0xee, 0xa5, 0xee, 0x8c, 0xee,
-    0x92, 0xee, 0xa0, 0xee, 0xa6, 0xee, 0xa9, 0xee,
-    0xe9, 0xee, 0xcc, 0xef, 0x36, 0xf1, 0x81, 0xf2,
-    0x39, 0xf3, 0xa4, 0xf3, 0xee, 0xf3, 0x2b, 0xf4,
-    0x2f, 0xf4, 0x3d, 0xf4, 0xc4, 0xf4, 0xc6, 0xf5,
-    0x02, 0xf7, 0x15, 0xf8, 0x16, 0xf9, 0x47, 0xfa,
-    0xd1, 0xfb, 0x70, 0xfd, 0xcd, 0xfe, 0xba, 0xff,
-    0x7f, 0x00, 0x7e, 0x01, 0xaf, 0x02, 0x0d, 0x04,
-    0xa1, 0x05, 0x42, 0x07, 0xc8, 0x08, 0x40, 0x0a,
-    0x4b, 0x0b, 0xbc, 0x0b, 0xdf, 0x0b, 0xf0, 0x0b,
-    0x2b, 0x0c, 0x5b, 0x0c, 0x27, 0x0c, 0xd2, 0x0b,
-    0xda, 0x0b, 0x5a, 0x0c, 0x05, 0x0d, 0x8a, 0x0d,
-    0xd8, 0x0d, 0x07, 0x0e, 0x33, 0x0e, 0x3f, 0x0e,
-    0xf0, 0x0d, 0x68, 0x0d, 0x07, 0x0d, 0xc9, 0x0c,
-    0x7d, 0x0c, 0x25, 0x0c, 0xe0, 0x0b, 0xc1, 0x0b,
-    0xe1, 0x0b, 0x1d, 0x0c, 0x36, 0x0c, 0x30, 0x0c,
-    0x00, 0x0c, 0xdf, 0x0b, 0xea, 0x0b, 0x06, 0x0c,
-    0x2e, 0x0c, 0x6a, 0x0c, 0xba, 0x0c, 0x13, 0x0d,
-    0x61, 0x0d, 0x90, 0x0d, 0x9e, 0x0d, 0x68, 0x0d,
-    0x0c, 0x0d, 0x8b, 0x0c, 0xda, 0x0b, 0x0e, 0x0b,
-    0x69, 0x0a, 0xfc, 0x09, 0xa1, 0x09, 0x50, 0x09,
-    0xe9, 0x08, 0x79, 0x08, 0xfe, 0x07, 0x86, 0x07,
-    0x12, 0x07, 0x92, 0x06, 0xee, 0x05, 0x33, 0x05,
-    0x76, 0x04, 0xc3, 0x03, 0x3a, 0x03, 0xc0, 0x02,
-    0x53, 0x02, 0xce, 0x01, 0x39, 0x01, 0x95, 0x00,
-    0xee, 0xff, 0x3c, 0xff, 0x88, 0xfe, 0x08, 0xfe,
-    0x98, 0xfd, 0x18, 0xfd, 0x9c, 0xfc, 0x41, 0xfc,
-    0x02, 0xfc, 0xd8, 0xfb, 0x9c, 0xfb, 0x4b, 0xfb,
-    0xf5, 0xfa, 0x8a, 0xfa, 0x07, 0xfa, 0x6c, 0xf9,
-    0xe1, 0xf8, 0x6b, 0xf8, 0x01, 0xf8, 0x88, 0xf7,
-    0xfc, 0xf6, 0x84, 0xf6, 0x2b, 0xf6, 0xd4, 0xf5,
-    0x67, 0xf5, 0xf2, 0xf4, 0x87, 0xf4, 0x15, 0xf4,
-    0x9d, 0xf3, 0x37, 0xf3, 0xf8, 0xf2, 0xdd, 0xf2,
-    0xc2, 0xf2, 0x98, 0xf2, 0x6d, 0xf2, 0x38, 0xf2,
-    0x02, 0xf2, 0xbe, 0xf1, 0x50, 0xf1, 0xfa, 0xf0,
-    0xc1, 0xf0, 0x7b, 0xf0, 0x2a, 0xf0, 0xe0, 0xef,
-    0xc8, 0xef, 0xd5, 0xef, 0xd5, 0xef, 0xb4, 0xef,
-    0xac, 0xef, 0xbb, 0xef, 0xbb, 0xef, 0xc2, 0xef,
-    0x27, 0xf0, 0x24, 0xf1, 0x81, 0xf2, 0xcf, 0xf3,
-    0x9a, 0xf4, 0xf1, 0xf4, 0x15, 0xf5, 0x45, 0xf5,
-    0x59, 0xf5, 0x82, 0xf5, 0x26, 0xf6, 0x3d, 0xf7,
-    0x7e, 0xf8, 0x81, 0xf9, 0x65, 0xfa, 0x8f, 0xfb,
-    0x04, 0xfd, 0x58, 0xfe, 0x66, 0xff, 0x47, 0x00,
-    0x42, 0x01, 0x73, 0x02, 0xcc, 0x03, 0x46, 0x05,
-    0xbf, 0x06, 0x55, 0x08, 0xdd, 0x09, 0x0d, 0x0b,
-    0xcd, 0x0b, 0x40, 0x0c, 0x78, 0x0c, 0x9f, 0x0c,
-    0xce, 0x0c, 0xd7, 0x0c, 0xbc, 0x0c, 0x88, 0x0c,
-    0x65, 0x0c, 0xa2, 0x0c, 0x28, 0x0d, 0x97, 0x0d,
-    0xf3, 0x0d, 0x3c, 0x0e, 0x5c, 0x0e, 0x4d, 0x0e,
-    0xec, 0x0d, 0x6f, 0x0d, 0x05, 0x0d, 0xca, 0x0c,
-    0x9c, 0x0c, 0x54, 0x0c, 0x0e, 0x0c, 0x08, 0x0c,
-    0x31, 0x0c, 0x52, 0x0c, 0x44, 0x0c, 0x0f, 0x0c,
-    0xf3, 0x0b, 0xf2, 0x0b, 0xfa, 0x0b, 0x1a, 0x0c,
-    0x63, 0x0c, 0xbe, 0x0c, 0x23, 0x0d, 0x80, 0x0d,
-    0xb7, 0x0d, 0xd8, 0x0d, 0xf0, 0x0d, 0xdf, 0x0d,
-    0x86, 0x0d, 0xdb, 0x0c, 0x27, 0x0c, 0x92, 0x0b,
-    0x05, 0x0b, 0x8e, 0x0a, 0x19, 0x0a, 0x9a, 0x09,
-    0x27, 0x09, 0xb9, 0x08, 0x41, 0x08, 0xd8, 0x07,
-    0x66, 0x07, 0xf0, 0x06, 0x7c, 0x06, 0xdf, 0x05,
-    0x0d, 0x05, 0x43, 0x04, 0xb7, 0x03, 0x3e, 0x03,
-    0xcd, 0x02, 0x46, 0x02, 0xa4, 0x01, 0xf5, 0x00,
-    0x41, 0x00, 0x95, 0xff, 0xea, 0xfe, 0x56, 0xfe,
-    0xd7, 0xfd, 0x59, 0xfd, 0xca, 0xfc, 0x4e, 0xfc,
-    0xf9, 0xfb, 0xd0, 0xfb, 0xb4, 0xfb, 0x79, 0xfb,
-    0x19, 0xfb, 0x9e, 0xfa, 0x17, 0xfa, 0x6d, 0xf9,
-    0xda, 0xf8, 0x5c, 0xf8, 0xe0, 0xf7, 0x78, 0xf7,
-    0x08, 0xf7, 0x7f, 0xf6, 0xf9, 0xf5, 0x80, 0xf5,
-    0x19, 0xf5, 0xbc, 0xf4, 0x51, 0xf4, 0xde, 0xf3,
-    0x57, 0xf3, 0xe1, 0xf2, 0x94, 0xf2, 0x68, 0xf2,
-    0x5b, 0xf2, 0x5a, 0xf2, 0x4f, 0xf2, 0x3e, 0xf2,
-    0x06, 0xf2, 0x9c, 0xf1, 0x33, 0xf1, 0xd4, 0xf0,
-    0x7e, 0xf0, 0x1f, 0xf0, 0xb4, 0xef, 0x44, 0xef,
-    0x10, 0xef, 0x11, 0xef, 0x2f, 0xef, 0x58, 0xef,
-    0x6d, 0xef, 0x82, 0xef, 0x8e, 0xef, 0x76, 0xef,
-    0x7d, 0xef, 0x0d, 0xf0, 0x2f, 0xf1, 0x89, 0xf2,
-    0x9c, 0xf3, 0x51, 0xf4, 0xd6, 0xf4, 0x40, 0xf5,
-    0x85, 0xf5, 0xa4, 0xf5, 0xe7, 0xf5, 0x9d, 0xf6,
-    0xb3, 0xf7, 0xbd, 0xf8, 0x95, 0xf9, 0x97, 0xfa,
-    0x03, 0xfc, 0xbf, 0xfd, 0x58, 0xff, 0x76, 0x00,
-    0x5d, 0x01, 0x61, 0x02, 0x77, 0x03, 0xb1, 0x04,
-    0x14, 0x06, 0x9a, 0x07, 0x2b, 0x09, 0x9c, 0x0a,
-    0xa9, 0x0b, 0x31, 0x0c, 0x6d, 0x0c, 0xac, 0x0c,
-    0xfa, 0x0c, 0x2e, 0x0d, 0x22, 0x0d, 0xda, 0x0c,
-    0xb2, 0x0c, 0xcb, 0x0c, 0x18, 0x0d, 0x64, 0x0d,
-    0xab, 0x0d, 0xf2, 0x0d, 0x41, 0x0e, 0x73, 0x0e,
-    0x45, 0x0e, 0xe1, 0x0d, 0x83, 0x0d, 0x44, 0x0d,
-    0xff, 0x0c, 0x95, 0x0c, 0x19, 0x0c, 0xcf, 0x0b,
-    0xc3, 0x0b, 0xe7, 0x0b, 0x06, 0x0c, 0xf1, 0x0b,
-    0xd5, 0x0b, 0xd1, 0x0b, 0xda, 0x0b, 0xdf, 0x0b,
-    0xde, 0x0b, 0xf5, 0x0b, 0x2e, 0x0c, 0x7a, 0x0c,
-    0xba, 0x0c, 0xe3, 0x0c, 0xfc, 0x0c, 0x09, 0x0d,
-    0xf2, 0x0c, 0x90, 0x0c, 0xdf, 0x0b, 0x11, 0x0b,
-    0x5c, 0x0a, 0xc3, 0x09, 0x2b, 0x09, 0x9d, 0x08,
-    0x21, 0x08, 0xa6, 0x07, 0x28, 0x07, 0x9d, 0x06,
-    0x0e, 0x06, 0x9d, 0x05, 0x30, 0x05, 0xb1, 0x04,
-    0x25, 0x04, 0x6b, 0x03, 0xae, 0x02, 0x05, 0x02,
-    0x72, 0x01, 0xf7, 0x00, 0x7e, 0x00, 0xf1, 0xff,
-    0x4d, 0xff, 0x9f, 0xfe, 0xf8, 0xfd, 0x62, 0xfd,
-    0xcc, 0xfc, 0x4b, 0xfc, 0xcf, 0xfb, 0x67, 0xfb,
-    0x0d, 0xfb, 0xbe, 0xfa, 0x72, 0xfa, 0x3c, 0xfa,
-    0x16, 0xfa, 0xce, 0xf9, 0x6f, 0xf9, 0xf8, 0xf8,
-    0x76, 0xf8, 0xf5, 0xf7, 0x7d, 0xf7, 0xf7, 0xf6,
-    0x6a, 0xf6, 0xd3, 0xf5, 0x4b, 0xf5, 0xd9, 0xf4,
-    0x75, 0xf4, 0x17, 0xf4, 0xb0, 0xf3, 0x5b, 0xf3,
-    0xf5, 0xf2, 0x8e, 0xf2, 0x3c, 0xf2, 0xfb, 0xf1,
-    0xcb, 0xf1, 0xa4, 0xf1, 0x87, 0xf1, 0x66, 0xf1,
-    0x41, 0xf1, 0x04, 0xf1, 0xc6, 0xf0, 0x7e, 0xf0,
-    0x3b, 0xf0, 0xfb, 0xef, 0xaa, 0xef, 0x66, 0xef,
-    0x3a, 0xef, 0x2d, 0xef, 0x15, 0xef, 0x0a, 0xef,
-    0x13, 0xef, 0x3c, 0xef, 0x5d, 0xef, 0x81, 0xef,
-    0x05, 0xf0, 0x03, 0xf1, 0x56, 0xf2, 0x80, 0xf3,
-    0x34, 0xf4, 0x8d, 0xf4, 0xda, 0xf4, 0x26, 0xf5,
-    0x62, 0xf5, 0x85, 0xf5, 0xfd, 0xf5, 0x1d, 0xf7,
-    0x60, 0xf8, 0x7a, 0xf9, 0x69, 0xfa, 0x70, 0xfb,
-    0xcd, 0xfc, 0x26, 0xfe, 0x49, 0xff, 0x43, 0x00,
-    0x44, 0x01, 0x6d, 0x02, 0xeb, 0x03, 0x7f, 0x05,
-    0x01, 0x07, 0x7e, 0x08, 0xee, 0x09, 0x2d, 0x0b,
-    0xeb, 0x0b, 0x44, 0x0c, 0x64, 0x0c, 0x83, 0x0c,
-    0xa3, 0x0c, 0xa2, 0x0c, 0x5e, 0x0c, 0x0e, 0x0c,
-    0x13, 0x0c, 0x69, 0x0c, 0xeb, 0x0c, 0x49, 0x0d,
-    0x93, 0x0d, 0xea, 0x0d, 0x1c, 0x0e, 0x07, 0x0e,
-    0xa6, 0x0d, 0x40, 0x0d, 0xf8, 0x0c, 0xd3, 0x0c,
-    0x9f, 0x0c, 0x44, 0x0c, 0xd8, 0x0b, 0xac, 0x0b,
-    0xc7, 0x0b, 0xdf, 0x0b, 0xca, 0x0b, 0x7b, 0x0b,
-    0x49, 0x0b, 0x39, 0x0b, 0x49, 0x0b, 0x62, 0x0b,
-    0x83, 0x0b, 0xca, 0x0b, 0x33, 0x0c, 0x9d, 0x0c,
-    0xd4, 0x0c, 0xd2, 0x0c, 0xc0, 0x0c, 0xb2, 0x0c,
-    0x6b, 0x0c, 0xe8, 0x0b, 0x3c, 0x0b, 0x8d, 0x0a,
-    0xf2, 0x09, 0x67, 0x09, 0xeb, 0x08, 0x7b, 0x08,
-    0x0d, 0x08, 0x9a, 0x07, 0x26, 0x07, 0xb4, 0x06,
-    0x46, 0x06, 0xdf, 0x05, 0x63, 0x05, 0xc3, 0x04,
-    0x0e, 0x04, 0x66, 0x03, 0xdd, 0x02, 0x76, 0x02,
-    0x05, 0x02, 0x81, 0x01, 0xe1, 0x00, 0x28, 0x00,
-    0x6e, 0xff, 0xb9, 0xfe, 0x09, 0xfe, 0x70, 0xfd,
-    0x11, 0xfd, 0xc4, 0xfc, 0x6c, 0xfc, 0x05, 0xfc,
-    0xae, 0xfb, 0x79, 0xfb, 0x5b, 0xfb, 0x30, 0xfb,
-    0xe2, 0xfa, 0x70, 0xfa, 0xeb, 0xf9, 0x60, 0xf9,
-    0xd4, 0xf8, 0x59, 0xf8, 0xd4, 0xf7, 0x5f, 0xf7,
-    0x05, 0xf7, 0x8c, 0xf6, 0x12, 0xf6, 0xa3, 0xf5,
-    0x2e, 0xf5, 0xce, 0xf4, 0x63, 0xf4, 0xf0, 0xf3,
-    0x80, 0xf3, 0x07, 0xf3, 0xb4, 0xf2, 0x9e, 0xf2,
-    0x8c, 0xf2, 0x80, 0xf2, 0x6c, 0xf2, 0x46, 0xf2,
-    0x23, 0xf2, 0xde, 0xf1, 0x8a, 0xf1, 0x34, 0xf1,
-    0xd7, 0xf0, 0x88, 0xf0, 0x47, 0xf0, 0xfb, 0xef,
-    0xcf, 0xef, 0xdd, 0xef, 0x15, 0xf0, 0x4b, 0xf0,
-    0x47, 0xf0, 0x2e, 0xf0, 0x4c, 0xf0, 0x76, 0xf0,
-    0xa0, 0xf0, 0xf5, 0xf0, 0xb5, 0xf1, 0xf8, 0xf2,
-    0x56, 0xf4, 0x53, 0xf5, 0xe1, 0xf5, 0x41, 0xf6,
-    0xa0, 0xf6, 0xfa, 0xf6, 0x2d, 0xf7, 0x86, 0xf7,
-    0x4c, 0xf8, 0x6a, 0xf9, 0x98, 0xfa, 0x9f, 0xfb,
-    0x9f, 0xfc, 0xd8, 0xfd, 0x4c, 0xff, 0x99, 0x00,
-    0x8d, 0x01, 0x62, 0x02, 0x56, 0x03, 0x9f, 0x04,
-    0xf4, 0x05, 0x42, 0x07, 0xb0, 0x08, 0x2e, 0x0a,
-    0x86, 0x0b, 0x75, 0x0c, 0xd9, 0x0c, 0xf7, 0x0c,
-    0x28, 0x0d, 0x47, 0x0d, 0x6e, 0x0d, 0x4d, 0x0d,
-    0xf2, 0x0c, 0xc0, 0x0c, 0xd9, 0x0c, 0x33, 0x0d,
-    0x9c, 0x0d, 0xf3, 0x0d, 0x34, 0x0e, 0x65, 0x0e,
-    0x57, 0x0e, 0x11, 0x0e, 0xa5, 0x0d, 0x37, 0x0d,
-    0xf8, 0x0c, 0xb6, 0x0c, 0x6e, 0x0c, 0x24, 0x0c,
-    0xf6, 0x0b, 0x01, 0x0c, 0x26, 0x0c, 0x27, 0x0c,
-    0xf4, 0x0b, 0xb8, 0x0b, 0x82, 0x0b, 0x87, 0x0b,
-    0x8b, 0x0b, 0xa5, 0x0b, 0xe3, 0x0b, 0x2e, 0x0c,
-    0x87, 0x0c, 0xcc, 0x0c, 0xe8, 0x0c, 0xe6, 0x0c,
-    0xdc, 0x0c, 0x97, 0x0c, 0x20, 0x0c, 0x79, 0x0b,
-    0xc2, 0x0a, 0x24, 0x0a, 0xa0, 0x09, 0x28, 0x09,
-    0xc0, 0x08, 0x6e, 0x08, 0x00, 0x08, 0x7a, 0x07,
-    0xed, 0x06, 0x6e, 0x06, 0x15, 0x06, 0xa9, 0x05,
-    0x25, 0x05, 0x72, 0x04, 0xa4, 0x03, 0xea, 0x02,
-    0x5e, 0x02, 0xf1, 0x01, 0x89, 0x01, 0x0a, 0x01,
-    0x65, 0x00, 0xab, 0xff, 0xe3, 0xfe, 0x3a, 0xfe,
-    0xad, 0xfd, 0x31, 0xfd, 0xb5, 0xfc, 0x37, 0xfc,
-    0xc3, 0xfb, 0x73, 0xfb, 0x3d, 0xfb, 0x0f, 0xfb,
-    0xde, 0xfa, 0x95, 0xfa, 0x2f, 0xfa, 0xb5, 0xf9,
-    0x20, 0xf9, 0x7c, 0xf8, 0xeb, 0xf7, 0x6b, 0xf7,
-    0x03, 0xf7, 0x9f, 0xf6, 0x30, 0xf6, 0xbe, 0xf5,
-    0x4b, 0xf5, 0xe1, 0xf4, 0x80, 0xf4, 0x16, 0xf4,
-    0xa9, 0xf3, 0x3e, 0xf3, 0xd2, 0xf2, 0x77, 0xf2,
-    0x44, 0xf2, 0x2f, 0xf2, 0x36, 0xf2, 0x43, 0xf2,
-    0x3f, 0xf2, 0x21, 0xf2, 0xf2, 0xf1, 0xa7, 0xf1,
-    0x59, 0xf1, 0x14, 0xf1, 0xc9, 0xf0, 0x93, 0xf0,
-    0x4a, 0xf0, 0x06, 0xf0, 0xf3, 0xef, 0x11, 0xf0,
-    0x42, 0xf0, 0x6d, 0xf0, 0x80, 0xf0, 0xa1, 0xf0,
-    0xcd, 0xf0, 0xe7, 0xf0, 0x24, 0xf1, 0xc5, 0xf1,
-    0xe7, 0xf2, 0x39, 0xf4, 0x55, 0xf5, 0x19, 0xf6,
-    0x91, 0xf6, 0xe0, 0xf6, 0x1d, 0xf7, 0x58, 0xf7,
-    0xbe, 0xf7, 0x8a, 0xf8, 0x99, 0xf9, 0x9d, 0xfa,
-    0x89, 0xfb, 0x7c, 0xfc, 0xb9, 0xfd, 0x30, 0xff,
-    0x81, 0x00, 0x92, 0x01, 0x91, 0x02, 0x8a, 0x03,
-    0xa7, 0x04, 0xdf, 0x05, 0x2b, 0x07, 0x94, 0x08,
-    0xec, 0x09, 0x23, 0x0b, 0x26, 0x0c, 0xc0, 0x0c,
-    0x06, 0x0d, 0x3d, 0x0d, 0x74, 0x0d, 0x9c, 0x0d,
-    0x83, 0x0d, 0x40, 0x0d, 0x0e, 0x0d, 0x10, 0x0d,
-    0x39, 0x0d, 0x6b, 0x0d, 0x95, 0x0d, 0xcc, 0x0d,
-    0x13, 0x0e, 0x23, 0x0e, 0xf5, 0x0d, 0x97, 0x0d,
-    0x3b, 0x0d, 0x04, 0x0d, 0xca, 0x0c, 0x6e, 0x0c,
-    0x10, 0x0c, 0xcd, 0x0b, 0xb2, 0x0b, 0xc0, 0x0b,
-    0xc4, 0x0b, 0xb8, 0x0b, 0xa8, 0x0b, 0x8f, 0x0b,
-    0x7a, 0x0b, 0x52, 0x0b, 0x48, 0x0b, 0x61, 0x0b,
-    0x93, 0x0b, 0xc3, 0x0b, 0xf1, 0x0b, 0x19, 0x0c,
-    0x2c, 0x0c, 0x2d, 0x0c, 0x08, 0x0c, 0xb8, 0x0b,
-    0x30, 0x0b, 0x9d, 0x0a, 0xf4, 0x09, 0x4c, 0x09,
-    0xa2, 0x08, 0x18, 0x08, 0xb6, 0x07, 0x41, 0x07,
-    0xc9, 0x06, 0x37, 0x06, 0xa2, 0x05, 0x2c, 0x05,
-    0xb3, 0x04, 0x2a, 0x04, 0x8e, 0x03, 0xd9, 0x02,
-    0x2a, 0x02, 0xa4, 0x01, 0x16, 0x01, 0x89, 0x00,
-    0x06, 0x00, 0x7a, 0xff, 0xe0, 0xfe, 0x2c, 0xfe,
-    0x78, 0xfd, 0xd5, 0xfc, 0x4c, 0xfc, 0xc8, 0xfb,
-    0x58, 0xfb, 0xdf, 0xfa, 0x7b, 0xfa, 0x36, 0xfa,
-    0xf8, 0xf9, 0xcd, 0xf9, 0x8a, 0xf9, 0x34, 0xf9,
-    0xce, 0xf8, 0x4f, 0xf8, 0xd7, 0xf7, 0x5e, 0xf7,
-    0xe0, 0xf6, 0x71, 0xf6, 0xf5, 0xf5, 0x75, 0xf5,
-    0x13, 0xf5, 0xab, 0xf4, 0x3d, 0xf4, 0xdf, 0xf3,
-    0x7a, 0xf3, 0x20, 0xf3, 0xcd, 0xf2, 0x76, 0xf2,
-    0x2d, 0xf2, 0xfc, 0xf1, 0xd0, 0xf1, 0xb3, 0xf1,
-    0xb0, 0xf1, 0xa7, 0xf1, 0x90, 0xf1, 0x66, 0xf1,
-    0x2c, 0xf1, 0x04, 0xf1, 0xdc, 0xf0, 0xa4, 0xf0,
-    0x5b, 0xf0, 0x15, 0xf0, 0x03, 0xf0, 0x18, 0xf0,
-    0x2a, 0xf0, 0x3e, 0xf0, 0x64, 0xf0, 0x9a, 0xf0,
-    0xce, 0xf0, 0xe7, 0xf0, 0x4c, 0xf1, 0x2c, 0xf2,
-    0x61, 0xf3, 0xa6, 0xf4, 0x71, 0xf5, 0xce, 0xf5,
-    0x18, 0xf6, 0x6a, 0xf6, 0xa2, 0xf6, 0xf7, 0xf6,
-    0x86, 0xf7, 0x7d, 0xf8, 0xb0, 0xf9, 0x92, 0xfa,
-    0x5f, 0xfb, 0x67, 0xfc, 0x9f, 0xfd, 0xea, 0xfe,
-    0x09, 0x00, 0xf4, 0x00, 0xf7, 0x01, 0x13, 0x03,
-    0x4c, 0x04, 0xa3, 0x05, 0xef, 0x06, 0x69, 0x08,
-    0xd1, 0x09, 0xe6, 0x0a, 0xa0, 0x0b, 0xfb, 0x0b,
-    0x38, 0x0c, 0x71, 0x0c, 0x9a, 0x0c, 0x9e, 0x0c,
-    0x74, 0x0c, 0x20, 0x0c, 0x13, 0x0c, 0x4e, 0x0c,
-    0x9d, 0x0c, 0xf9, 0x0c, 0x4b, 0x0d, 0x92, 0x0d,
-    0xb9, 0x0d, 0x9f, 0x0d, 0x51, 0x0d, 0x0f, 0x0d,
-    0xcf, 0x0c, 0xa0, 0x0c, 0x70, 0x0c, 0x27, 0x0c,
-    0xea, 0x0b, 0xd1, 0x0b, 0xda, 0x0b, 0xd2, 0x0b,
-    0xb7, 0x0b, 0x99, 0x0b, 0x7a, 0x0b, 0x57, 0x0b,
-    0x40, 0x0b, 0x4a, 0x0b, 0x64, 0x0b, 0x97, 0x0b,
-    0xd7, 0x0b, 0x1e, 0x0c, 0x46, 0x0c, 0x4d, 0x0c,
-    0x41, 0x0c, 0x1b, 0x0c, 0xc6, 0x0b, 0x3e, 0x0b,
-    0xa9, 0x0a, 0x04, 0x0a, 0x69, 0x09, 0xdb, 0x08,
-    0x67, 0x08, 0xff, 0x07, 0x9b, 0x07, 0x2c, 0x07,
-    0xb2, 0x06, 0x3c, 0x06, 0xc2, 0x05, 0x59, 0x05,
-    0xc7, 0x04, 0x16, 0x04, 0x63, 0x03, 0xcf, 0x02,
-    0x55, 0x02, 0xd1, 0x01, 0x47, 0x01, 0xba, 0x00,
-    0x32, 0x00, 0x9c, 0xff, 0xfa, 0xfe, 0x38, 0xfe,
-    0x7a, 0xfd, 0xe3, 0xfc, 0x67, 0xfc, 0x00, 0xfc,
-    0x85, 0xfb, 0x21, 0xfb, 0xe1, 0xfa, 0xb9, 0xfa,
-    0x8b, 0xfa, 0x53, 0xfa, 0xff, 0xf9, 0x92, 0xf9,
-    0x1b, 0xf9, 0x98, 0xf8, 0x23, 0xf8, 0xa0, 0xf7,
-    0x2c, 0xf7, 0xc9, 0xf6, 0x64, 0xf6, 0xf0, 0xf5,
-    0x79, 0xf5, 0x15, 0xf5, 0xb3, 0xf4, 0x5b, 0xf4,
-    0xf4, 0xf3, 0x8b, 0xf3, 0x30, 0xf3, 0xdc, 0xf2,
-    0xa4, 0xf2, 0x88, 0xf2, 0x7a, 0xf2, 0x76, 0xf2,
-    0x76, 0xf2, 0x6b, 0xf2, 0x50, 0xf2, 0x29, 0xf2,
-    0xfa, 0xf1, 0xb8, 0xf1, 0x74, 0xf1, 0x44, 0xf1,
-    0x12, 0xf1, 0xf3, 0xf0, 0xdf, 0xf0, 0xf2, 0xf0,
-    0x23, 0xf1, 0x54, 0xf1, 0x85, 0xf1, 0xb8, 0xf1,
-    0xf1, 0xf1, 0x1e, 0xf2, 0x50, 0xf2, 0xb7, 0xf2,
-    0x6f, 0xf3, 0x86, 0xf4, 0xb3, 0xf5, 0x9f, 0xf6,
-    0x3e, 0xf7, 0xac, 0xf7, 0x0a, 0xf8, 0x58, 0xf8,
-    0xab, 0xf8, 0x31, 0xf9, 0x17, 0xfa, 0x26, 0xfb,
-    0x0b, 0xfc, 0xc9, 0xfc, 0x97, 0xfd, 0x9f, 0xfe,
-    0xe6, 0xff, 0x30, 0x01, 0x28, 0x02, 0x00, 0x03,
-    0xf3, 0x03, 0x10, 0x05, 0x30, 0x06, 0x3a, 0x07,
-    0x4f, 0x08, 0x8b, 0x09, 0xcb, 0x0a, 0xad, 0x0b,
-    0x2c, 0x0c, 0x69, 0x0c, 0x91, 0x0c, 0xbe, 0x0c,
-    0xdb, 0x0c, 0xc9, 0x0c, 0x95, 0x0c, 0x7b, 0x0c,
-    0x88, 0x0c, 0xc4, 0x0c, 0xfa, 0x0c, 0x34, 0x0d,
-    0x7a, 0x0d, 0xad, 0x0d, 0xc1, 0x0d, 0x9a, 0x0d,
-    0x53, 0x0d, 0x07, 0x0d, 0xcb, 0x0c, 0x97, 0x0c,
-    0x5e, 0x0c, 0x1e, 0x0c, 0xf9, 0x0b, 0xea, 0x0b,
-    0xe1, 0x0b, 0xe0, 0x0b, 0xc5, 0x0b, 0x9f, 0x0b,
-    0x73, 0x0b, 0x5b, 0x0b, 0x57, 0x0b, 0x67, 0x0b,
-    0x7d, 0x0b, 0x97, 0x0b, 0xc8, 0x0b, 0xe4, 0x0b,
-    0xee, 0x0b, 0xe5, 0x0b, 0xcb, 0x0b, 0x91, 0x0b,
-    0x1f, 0x0b, 0x8e, 0x0a, 0xec, 0x09, 0x4b, 0x09,
-    0xb7, 0x08, 0x30, 0x08, 0xa8, 0x07, 0x33, 0x07,
-    0xbd, 0x06, 0x51, 0x06, 0xe4, 0x05, 0x73, 0x05,
-    0x07, 0x05, 0x84, 0x04, 0xfe, 0x03, 0x60, 0x03,
-    0xc7, 0x02, 0x3a, 0x02, 0xb4, 0x01, 0x30, 0x01,
-    0xa9, 0x00, 0x20, 0x00, 0x8a, 0xff, 0xf1, 0xfe,
-    0x50, 0xfe, 0xaf, 0xfd, 0x0d, 0xfd, 0x7c, 0xfc,
-    0xfc, 0xfb, 0x85, 0xfb, 0x17, 0xfb, 0xbf, 0xfa,
-    0x85, 0xfa, 0x55, 0xfa, 0x28, 0xfa, 0xe0, 0xf9,
-    0x8a, 0xf9, 0x1e, 0xf9, 0xa6, 0xf8, 0x29, 0xf8,
-    0xa5, 0xf7, 0x2d, 0xf7, 0xb3, 0xf6, 0x43, 0xf6,
-    0xd0, 0xf5, 0x63, 0xf5, 0x09, 0xf5, 0xc0, 0xf4,
-    0x77, 0xf4, 0x23, 0xf4, 0xd0, 0xf3, 0x72, 0xf3,
-    0x1a, 0xf3, 0xcf, 0xf2, 0xaa, 0xf2, 0xa1, 0xf2,
-    0xa4, 0xf2, 0xad, 0xf2, 0xbd, 0xf2, 0xb8, 0xf2,
-    0xa1, 0xf2, 0x7d, 0xf2, 0x4b, 0xf2, 0x32, 0xf2,
-    0x09, 0xf2, 0xd9, 0xf1, 0xae, 0xf1, 0x8a, 0xf1,
-    0x91, 0xf1, 0xc6, 0xf1, 0x06, 0xf2, 0x3b, 0xf2,
-    0x74, 0xf2, 0xb1, 0xf2, 0xe9, 0xf2, 0x0f, 0xf3,
-    0x4d, 0xf3, 0xe3, 0xf3, 0xdc, 0xf4, 0xfb, 0xf5,
-    0xfc, 0xf6, 0xb4, 0xf7, 0x32, 0xf8, 0x9d, 0xf8,
-    0xed, 0xf8, 0x41, 0xf9, 0xb8, 0xf9, 0x6f, 0xfa,
-    0x69, 0xfb, 0x58, 0xfc, 0x12, 0xfd, 0xcd, 0xfd,
-    0xbb, 0xfe, 0xd6, 0xff, 0xfb, 0x00, 0xee, 0x01,
-    0xc4, 0x02, 0xb2, 0x03, 0xb2, 0x04, 0xc0, 0x05,
-    0xd7, 0x06, 0xeb, 0x07, 0x19, 0x09, 0x52, 0x0a,
-    0x34, 0x0b, 0xc0, 0x0b, 0x17, 0x0c, 0x5b, 0x0c,
-    0xac, 0x0c, 0xe8, 0x0c, 0xf1, 0x0c, 0xd7, 0x0c,
-    0xa7, 0x0c, 0x89, 0x0c, 0x9d, 0x0c, 0xb3, 0x0c,
-    0xd9, 0x0c, 0x09, 0x0d, 0x38, 0x0d, 0x62, 0x0d,
-    0x48, 0x0d, 0x12, 0x0d, 0xe3, 0x0c, 0xb8, 0x0c,
-    0x91, 0x0c, 0x66, 0x0c, 0x26, 0x0c, 0xe6, 0x0b,
-    0xc1, 0x0b, 0xac, 0x0b, 0xa2, 0x0b, 0x90, 0x0b,
-    0x70, 0x0b, 0x56, 0x0b, 0x42, 0x0b, 0x17, 0x0b,
-    0x05, 0x0b, 0xfd, 0x0a, 0xf3, 0x0a, 0x05, 0x0b,
-    0x09, 0x0b, 0x0c, 0x0b, 0x08, 0x0b, 0xef, 0x0a,
-    0xc2, 0x0a, 0x77, 0x0a, 0x0e, 0x0a, 0x81, 0x09,
-    0xec, 0x08, 0x47, 0x08, 0xa4, 0x07, 0x1d, 0x07,
-    0xa1, 0x06, 0x1a, 0x06, 0x92, 0x05, 0x0c, 0x05,
-    0xa0, 0x04, 0x33, 0x04, 0xb8, 0x03, 0x3b, 0x03,
-    0x91, 0x02, 0xee, 0x01, 0x59, 0x01, 0xce, 0x00,
-    0x52, 0x00, 0xbf, 0xff, 0x2c, 0xff, 0xa2, 0xfe,
-    0x11, 0xfe, 0x7b, 0xfd, 0xe4, 0xfc, 0x41, 0xfc,
-    0x9f, 0xfb, 0x08, 0xfb, 0x86, 0xfa, 0x21, 0xfa,
-    0xc7, 0xf9, 0x78, 0xf9, 0x3e, 0xf9, 0x0a, 0xf9,
-    0xc9, 0xf8, 0x8a, 0xf8, 0x3c, 0xf8, 0xd6, 0xf7,
-    0x6c, 0xf7, 0x01, 0xf7, 0xa4, 0xf6, 0x4b, 0xf6,
-    0xe9, 0xf5, 0x8a, 0xf5, 0x2a, 0xf5, 0xcc, 0xf4,
-    0x7d, 0xf4, 0x33, 0xf4, 0xf1, 0xf3, 0xa8, 0xf3,
-    0x61, 0xf3, 0x2e, 0xf3, 0xff, 0xf2, 0xdd, 0xf2,
-    0xcd, 0xf2, 0xca, 0xf2, 0xcf, 0xf2, 0xd1, 0xf2,
-    0xd4, 0xf2, 0xd3, 0xf2, 0xbe, 0xf2, 0xac, 0xf2,
-    0xa6, 0xf2, 0x99, 0xf2, 0x74, 0xf2, 0x4e, 0xf2,
-    0x4c, 0xf2, 0x5a, 0xf2, 0x85, 0xf2, 0xb4, 0xf2,
-    0xdf, 0xf2, 0x23, 0xf3, 0x54, 0xf3, 0x80, 0xf3,
-    0xc5, 0xf3, 0x45, 0xf4, 0x2b, 0xf5, 0x3d, 0xf6,
-    0x13, 0xf7, 0x97, 0xf7, 0x06, 0xf8, 0x8f, 0xf8,
-    0xfa, 0xf8, 0x47, 0xf9, 0xaf, 0xf9, 0x54, 0xfa,
-    0x27, 0xfb, 0xe9, 0xfb, 0x9c, 0xfc, 0x56, 0xfd,
-    0x3c, 0xfe, 0x42, 0xff, 0x43, 0x00, 0x36, 0x01,
-    0x17, 0x02, 0x18, 0x03, 0x35, 0x04, 0x36, 0x05,
-    0x2f, 0x06, 0x36, 0x07, 0x41, 0x08, 0x4a, 0x09,
-    0x23, 0x0a, 0xcc, 0x0a, 0x4d, 0x0b, 0x98, 0x0b,
-    0xde, 0x0b, 0x07, 0x0c, 0xfa, 0x0b, 0xc6, 0x0b,
-    0x9b, 0x0b, 0xaa, 0x0b, 0xdd, 0x0b, 0x1e, 0x0c,
-    0x66, 0x0c, 0xa3, 0x0c, 0xc5, 0x0c, 0xd7, 0x0c,
-    0xc7, 0x0c, 0x93, 0x0c, 0x6b, 0x0c, 0x50, 0x0c,
-    0x37, 0x0c, 0x08, 0x0c, 0xc9, 0x0b, 0xa9, 0x0b,
-    0xb0, 0x0b, 0xa1, 0x0b, 0x85, 0x0b, 0x71, 0x0b,
-    0x4a, 0x0b, 0x1e, 0x0b, 0xec, 0x0a, 0xc3, 0x0a,
-    0xb3, 0x0a, 0xae, 0x0a, 0xb6, 0x0a, 0xca, 0x0a,
-    0xc7, 0x0a, 0xc1, 0x0a, 0xc9, 0x0a, 0xb7, 0x0a,
-    0x85, 0x0a, 0x20, 0x0a, 0xa0, 0x09, 0x12, 0x09,
-    0x78, 0x08, 0xec, 0x07, 0x72, 0x07, 0x03, 0x07,
-    0x8e, 0x06, 0x2c, 0x06, 0xbc, 0x05, 0x37, 0x05,
-    0xb0, 0x04, 0x2c, 0x04, 0xb2, 0x03, 0x2c, 0x03,
-    0x94, 0x02, 0x02, 0x02, 0x6e, 0x01, 0xcf, 0x00,
-    0x4f, 0x00, 0xd8, 0xff, 0x6b, 0xff, 0xed, 0xfe,
-    0x49, 0xfe, 0x9e, 0xfd, 0xe9, 0xfc, 0x41, 0xfc,
-    0xba, 0xfb, 0x42, 0xfb, 0xca, 0xfa, 0x64, 0xfa,
-    0x03, 0xfa, 0xa6, 0xf9, 0x5c, 0xf9, 0x16, 0xf9,
-    0xd3, 0xf8, 0x8b, 0xf8, 0x30, 0xf8, 0xcd, 0xf7,
-    0x64, 0xf7, 0xe6, 0xf6, 0x7f, 0xf6, 0x23, 0xf6,
-    0xcb, 0xf5, 0x7d, 0xf5, 0x2f, 0xf5, 0xf7, 0xf4,
-    0xb3, 0xf4, 0x63, 0xf4, 0x13, 0xf4, 0xcc, 0xf3,
-    0x8b, 0xf3, 0x52, 0xf3, 0x2e, 0xf3, 0x11, 0xf3,
-    0x06, 0xf3, 0xf6, 0xf2, 0xfb, 0xf2, 0x06, 0xf3,
-    0x11, 0xf3, 0x1d, 0xf3, 0x18, 0xf3, 0x15, 0xf3,
-    0x10, 0xf3, 0x18, 0xf3, 0x16, 0xf3, 0x17, 0xf3,
-    0x22, 0xf3, 0x32, 0xf3, 0x5b, 0xf3, 0x91, 0xf3,
-    0xce, 0xf3, 0x05, 0xf4, 0x48, 0xf4, 0x89, 0xf4,
-    0xdf, 0xf4, 0x46, 0xf5, 0xc1, 0xf5, 0x82, 0xf6,
-    0x77, 0xf7, 0x73, 0xf8, 0x3d, 0xf9, 0xd9, 0xf9,
-    0x4f, 0xfa, 0xb5, 0xfa, 0x20, 0xfb, 0x8d, 0xfb,
-    0x29, 0xfc, 0xeb, 0xfc, 0xc2, 0xfd, 0x87, 0xfe,
-    0x2b, 0xff, 0xda, 0xff, 0xa1, 0x00, 0x7c, 0x01,
-    0x5e, 0x02, 0x41, 0x03, 0x1f, 0x04, 0xfe, 0x04,
-    0xd2, 0x05, 0xaa, 0x06, 0x97, 0x07, 0x96, 0x08,
-    0x7f, 0x09, 0x41, 0x0a, 0xe3, 0x0a, 0x58, 0x0b,
-    0xb4, 0x0b, 0xeb, 0x0b, 0x06, 0x0c, 0x16, 0x0c,
-    0x08, 0x0c, 0xf1, 0x0b, 0xdd, 0x0b, 0xe0, 0x0b,
-    0x01, 0x0c, 0x33, 0x0c, 0x64, 0x0c, 0x93, 0x0c,
-    0xb0, 0x0c, 0xaf, 0x0c, 0xa6, 0x0c, 0x7e, 0x0c,
-    0x4e, 0x0c, 0x24, 0x0c, 0xfd, 0x0b, 0xd1, 0x0b,
-    0xa4, 0x0b, 0x82, 0x0b, 0x67, 0x0b, 0x57, 0x0b,
-    0x36, 0x0b, 0x17, 0x0b, 0xea, 0x0a, 0xb6, 0x0a,
-    0x8e, 0x0a, 0x6b, 0x0a, 0x53, 0x0a, 0x4c, 0x0a,
-    0x51, 0x0a, 0x55, 0x0a, 0x5c, 0x0a, 0x52, 0x0a,
-    0x41, 0x0a, 0x24, 0x0a, 0xda, 0x09, 0x70, 0x09,
-    0xf2, 0x08, 0x65, 0x08, 0xca, 0x07, 0x37, 0x07,
-    0xa3, 0x06, 0x1a, 0x06, 0xac, 0x05, 0x3d, 0x05,
-    0xca, 0x04, 0x50, 0x04, 0xdb, 0x03, 0x70, 0x03,
-    0xf2, 0x02, 0x4e, 0x02, 0xa7, 0x01, 0x0f, 0x01,
-    0x8e, 0x00, 0x10, 0x00, 0x86, 0xff, 0x07, 0xff,
-    0x89, 0xfe, 0x14, 0xfe, 0x81, 0xfd, 0xd9, 0xfc,
-    0x38, 0xfc, 0xb2, 0xfb, 0x40, 0xfb, 0xb5, 0xfa,
-    0x2e, 0xfa, 0xb7, 0xf9, 0x6d, 0xf9, 0x32, 0xf9,
-    0xfb, 0xf8, 0xc6, 0xf8, 0x81, 0xf8, 0x34, 0xf8,
-    0xd9, 0xf7, 0x80, 0xf7, 0x1d, 0xf7, 0xc5, 0xf6,
-    0x62, 0xf6, 0x0c, 0xf6, 0xbb, 0xf5, 0x6d, 0xf5,
-    0x35, 0xf5, 0xfb, 0xf4, 0xd1, 0xf4, 0xa1, 0xf4,
-    0x7a, 0xf4, 0x52, 0xf4, 0x17, 0xf4, 0xe2, 0xf3,
-    0xc1, 0xf3, 0xc2, 0xf3, 0xc9, 0xf3, 0xd5, 0xf3,
-    0xdc, 0xf3, 0xf2, 0xf3, 0x12, 0xf4, 0x1e, 0xf4,
-    0x1f, 0xf4, 0x1a, 0xf4, 0x21, 0xf4, 0x37, 0xf4,
-    0x50, 0xf4, 0x55, 0xf4, 0x58, 0xf4, 0x76, 0xf4,
-    0xb3, 0xf4, 0xfd, 0xf4, 0x45, 0xf5, 0x9b, 0xf5,
-    0x01, 0xf6, 0x4e, 0xf6, 0x8e, 0xf6, 0xe9, 0xf6,
-    0x85, 0xf7, 0x61, 0xf8, 0x45, 0xf9, 0x00, 0xfa,
-    0x86, 0xfa, 0xf6, 0xfa, 0x6c, 0xfb, 0xe4, 0xfb,
-    0x4f, 0xfc, 0xc1, 0xfc, 0x6d, 0xfd, 0x3d, 0xfe,
-    0xfb, 0xfe, 0x8c, 0xff, 0x18, 0x00, 0xc0, 0x00,
-    0x87, 0x01, 0x5d, 0x02, 0x23, 0x03, 0xd3, 0x03,
-    0x7d, 0x04, 0x43, 0x05, 0x0f, 0x06, 0xe2, 0x06,
-    0xb7, 0x07, 0x92, 0x08, 0x59, 0x09, 0xe9, 0x09,
-    0x5e, 0x0a, 0xc4, 0x0a, 0x18, 0x0b, 0x54, 0x0b,
-    0x78, 0x0b, 0x80, 0x0b, 0x6a, 0x0b, 0x46, 0x0b,
-    0x38, 0x0b, 0x51, 0x0b, 0x71, 0x0b, 0xa3, 0x0b,
-    0xda, 0x0b, 0xf7, 0x0b, 0xf4, 0x0b, 0xee, 0x0b,
-    0xe6, 0x0b, 0xd7, 0x0b, 0xbf, 0x0b, 0x96, 0x0b,
-    0x7a, 0x0b, 0x55, 0x0b, 0x32, 0x0b, 0x15, 0x0b,
-    0xf2, 0x0a, 0xd9, 0x0a, 0xc2, 0x0a, 0xa4, 0x0a,
-    0x6f, 0x0a, 0x3d, 0x0a, 0x11, 0x0a, 0xf7, 0x09,
-    0xde, 0x09, 0xb3, 0x09, 0x97, 0x09, 0x78, 0x09,
-    0x5b, 0x09, 0x41, 0x09, 0x21, 0x09, 0xe1, 0x08,
-    0x82, 0x08, 0x17, 0x08, 0x9b, 0x07, 0x1a, 0x07,
-    0x86, 0x06, 0xf2, 0x05, 0x60, 0x05, 0xd6, 0x04,
-    0x5f, 0x04, 0xe7, 0x03, 0x6c, 0x03, 0xf5, 0x02,
-    0x87, 0x02, 0x12, 0x02, 0x87, 0x01, 0xed, 0x00,
-    0x5a, 0x00, 0xda, 0xff, 0x48, 0xff, 0xb9, 0xfe,
-    0x3d, 0xfe, 0xc7, 0xfd, 0x42, 0xfd, 0xa6, 0xfc,
-    0x11, 0xfc, 0x81, 0xfb, 0x01, 0xfb, 0x8a, 0xfa,
-    0x0e, 0xfa, 0x8e, 0xf9, 0x17, 0xf9, 0xc3, 0xf8,
-    0x89, 0xf8, 0x52, 0xf8, 0x10, 0xf8, 0xda, 0xf7,
-    0xaf, 0xf7, 0x7a, 0xf7, 0x36, 0xf7, 0xf1, 0xf6,
-    0xae, 0xf6, 0x65, 0xf6, 0x20, 0xf6, 0xec, 0xf5,
-    0xb5, 0xf5, 0x71, 0xf5, 0x44, 0xf5, 0x2b, 0xf5,
-    0x14, 0xf5, 0xf0, 0xf4, 0xcf, 0xf4, 0xb8, 0xf4,
-    0xa9, 0xf4, 0x9c, 0xf4, 0x8b, 0xf4, 0x88, 0xf4,
-    0x83, 0xf4, 0x92, 0xf4, 0xab, 0xf4, 0xbb, 0xf4,
-    0xbd, 0xf4, 0xba, 0xf4, 0xc8, 0xf4, 0xd1, 0xf4,
-    0xda, 0xf4, 0xdf, 0xf4, 0x01, 0xf5, 0x2d, 0xf5,
-    0x68, 0xf5, 0xb1, 0xf5, 0xe5, 0xf5, 0x1b, 0xf6,
-    0x4c, 0xf6, 0x8c, 0xf6, 0xd0, 0xf6, 0x4a, 0xf7,
-    0x00, 0xf8, 0xc9, 0xf8, 0x7b, 0xf9, 0xff, 0xf9,
-    0x87, 0xfa, 0xfb, 0xfa, 0x5b, 0xfb, 0xa1, 0xfb,
-    0xfc, 0xfb, 0x87, 0xfc, 0x33, 0xfd, 0xe8, 0xfd,
-    0x76, 0xfe, 0xfe, 0xfe, 0xa1, 0xff, 0x80, 0x00,
-    0x48, 0x01, 0xe3, 0x01, 0x77, 0x02, 0x25, 0x03,
-    0xe2, 0x03, 0x82, 0x04, 0x25, 0x05, 0xd7, 0x05,
-    0x98, 0x06, 0x53, 0x07, 0x0c, 0x08, 0x9d, 0x08,
-    0xfb, 0x08, 0x44, 0x09, 0x85, 0x09, 0xc2, 0x09,
-    0xc4, 0x09, 0xac, 0x09, 0x9f, 0x09, 0xaf, 0x09,
-    0xc3, 0x09, 0xea, 0x09, 0x26, 0x0a, 0x56, 0x0a,
-    0x85, 0x0a, 0x9d, 0x0a, 0xb6, 0x0a, 0xb1, 0x0a,
-    0x95, 0x0a, 0x82, 0x0a, 0x70, 0x0a, 0x56, 0x0a,
-    0x39, 0x0a, 0x36, 0x0a, 0x35, 0x0a, 0x32, 0x0a,
-    0x1f, 0x0a, 0x06, 0x0a, 0xe9, 0x09, 0xb5, 0x09,
-    0x8f, 0x09, 0x74, 0x09, 0x4d, 0x09, 0x20, 0x09,
-    0x11, 0x09, 0x17, 0x09, 0x1c, 0x09, 0x16, 0x09,
-    0x06, 0x09, 0xf7, 0x08, 0xc4, 0x08, 0x66, 0x08,
-    0xf3, 0x07, 0x80, 0x07, 0x1f, 0x07, 0xcc, 0x06,
-    0x62, 0x06, 0xed, 0x05, 0x7c, 0x05, 0x18, 0x05,
-    0xb7, 0x04, 0x56, 0x04, 0xf0, 0x03, 0x8e, 0x03,
-    0x24, 0x03, 0x94, 0x02, 0x05, 0x02, 0x7c, 0x01,
-    0x02, 0x01, 0x8f, 0x00, 0x18, 0x00, 0xa2, 0xff,
-    0x24, 0xff, 0xaf, 0xfe, 0x32, 0xfe, 0xab, 0xfd,
-    0x16, 0xfd, 0x86, 0xfc, 0xff, 0xfb, 0x72, 0xfb,
-    0xfb, 0xfa, 0x94, 0xfa, 0x39, 0xfa, 0xdc, 0xf9,
-    0x8f, 0xf9, 0x55, 0xf9, 0x22, 0xf9, 0xdb, 0xf8,
-    0x8b, 0xf8, 0x4b, 0xf8, 0x0c, 0xf8, 0xc2, 0xf7,
-    0x79, 0xf7, 0x39, 0xf7, 0xfa, 0xf6, 0xbd, 0xf6,
-    0x82, 0xf6, 0x4a, 0xf6, 0x1f, 0xf6, 0xf6, 0xf5,
-    0xd0, 0xf5, 0xa6, 0xf5, 0x7a, 0xf5, 0x56, 0xf5,
-    0x46, 0xf5, 0x37, 0xf5, 0x24, 0xf5, 0x16, 0xf5,
-    0x17, 0xf5, 0x29, 0xf5, 0x3f, 0xf5, 0x53, 0xf5,
-    0x66, 0xf5, 0x7b, 0xf5, 0x8d, 0xf5, 0x9b, 0xf5,
-    0xa9, 0xf5, 0xbf, 0xf5, 0xe5, 0xf5, 0x25, 0xf6,
-    0x68, 0xf6, 0xac, 0xf6, 0xe8, 0xf6, 0x2c, 0xf7,
-    0x80, 0xf7, 0xd8, 0xf7, 0x2b, 0xf8, 0x7b, 0xf8,
-    0xc9, 0xf8, 0x0c, 0xf9, 0x69, 0xf9, 0xee, 0xf9,
-    0x9d, 0xfa, 0x45, 0xfb, 0xd6, 0xfb, 0x56, 0xfc,
-    0xcb, 0xfc, 0x3a, 0xfd, 0x9a, 0xfd, 0x07, 0xfe,
-    0x86, 0xfe, 0x14, 0xff, 0x96, 0xff, 0x0d, 0x00,
-    0x93, 0x00, 0x2c, 0x01, 0xcc, 0x01, 0x5c, 0x02,
-    0xec, 0x02, 0x81, 0x03, 0x1c, 0x04, 0xa0, 0x04,
-    0x01, 0x05, 0x66, 0x05, 0xea, 0x05, 0x80, 0x06,
-    0x11, 0x07, 0x94, 0x07, 0xff, 0x07, 0x61, 0x08,
-    0xb9, 0x08, 0xf4, 0x08, 0x0a, 0x09, 0x0d, 0x09,
-    0x12, 0x09, 0x1f, 0x09, 0x23, 0x09, 0x25, 0x09,
-    0x35, 0x09, 0x59, 0x09, 0x8f, 0x09, 0xc0, 0x09,
-    0xd9, 0x09, 0xd8, 0x09, 0xd8, 0x09, 0xcd, 0x09,
-    0xbe, 0x09, 0xa2, 0x09, 0x82, 0x09, 0x7a, 0x09,
-    0x78, 0x09, 0x78, 0x09, 0x75, 0x09, 0x70, 0x09,
-    0x59, 0x09, 0x39, 0x09, 0x1d, 0x09, 0xf0, 0x08,
-    0xca, 0x08, 0x9c, 0x08, 0x7f, 0x08, 0x61, 0x08,
-    0x3e, 0x08, 0x2d, 0x08, 0x1c, 0x08, 0x0e, 0x08,
-    0xf0, 0x07, 0xcb, 0x07, 0x7d, 0x07, 0x1e, 0x07,
-    0xba, 0x06, 0x53, 0x06, 0xfd, 0x05, 0x99, 0x05,
-    0x33, 0x05, 0xc4, 0x04, 0x63, 0x04, 0xff, 0x03,
-    0x9e, 0x03, 0x3b, 0x03, 0xcc, 0x02, 0x63, 0x02,
-    0xeb, 0x01, 0x6f, 0x01, 0xe3, 0x00, 0x69, 0x00,
-    0xf9, 0xff, 0x9a, 0xff, 0x38, 0xff, 0xc6, 0xfe,
-    0x5e, 0xfe, 0xea, 0xfd, 0x82, 0xfd, 0x01, 0xfd,
-    0x82, 0xfc, 0x07, 0xfc, 0x9a, 0xfb, 0x39, 0xfb,
-    0xda, 0xfa, 0x88, 0xfa, 0x36, 0xfa, 0x02, 0xfa,
-    0xcd, 0xf9, 0x9d, 0xf9, 0x5f, 0xf9, 0x1b, 0xf9,
-    0xe3, 0xf8, 0xb4, 0xf8, 0x88, 0xf8, 0x52, 0xf8,
-    0x1e, 0xf8, 0xe5, 0xf7, 0xbc, 0xf7, 0xa0, 0xf7,
-    0x8c, 0xf7, 0x7a, 0xf7, 0x5e, 0xf7, 0x49, 0xf7,
-    0x32, 0xf7, 0x20, 0xf7, 0x07, 0xf7, 0xfa, 0xf6,
-    0xf4, 0xf6, 0xf6, 0xf6, 0x01, 0xf7, 0x05, 0xf7,
-    0x12, 0xf7, 0x24, 0xf7, 0x49, 0xf7, 0x6e, 0xf7,
-    0x8b, 0xf7, 0xa5, 0xf7, 0xbc, 0xf7, 0xdc, 0xf7,
-    0xf9, 0xf7, 0x20, 0xf8, 0x4c, 0xf8, 0x76, 0xf8,
-    0x9e, 0xf8, 0xcf, 0xf8, 0x1a, 0xf9, 0x62, 0xf9,
-    0xb2, 0xf9, 0x04, 0xfa, 0x5a, 0xfa, 0xb7, 0xfa,
-    0x0b, 0xfb, 0x61, 0xfb, 0xb8, 0xfb, 0x23, 0xfc,
-    0x88, 0xfc, 0xec, 0xfc, 0x48, 0xfd, 0xae, 0xfd,
-    0x1d, 0xfe, 0x7e, 0xfe, 0xe3, 0xfe, 0x4c, 0xff,
-    0xaa, 0xff, 0x04, 0x00, 0x52, 0x00, 0xad, 0x00,
-    0x20, 0x01, 0x98, 0x01, 0x09, 0x02, 0x73, 0x02,
-    0xe2, 0x02, 0x43, 0x03, 0xa4, 0x03, 0x07, 0x04,
-    0x6d, 0x04, 0xdc, 0x04, 0x4a, 0x05, 0xab, 0x05,
-    0xef, 0x05, 0x3c, 0x06, 0x88, 0x06, 0xcf, 0x06,
-    0x0e, 0x07, 0x3b, 0x07, 0x69, 0x07, 0x8f, 0x07,
-    0xb1, 0x07, 0xc5, 0x07, 0xdf, 0x07, 0x01, 0x08,
-    0x15, 0x08, 0x24, 0x08, 0x27, 0x08, 0x35, 0x08,
-    0x4c, 0x08, 0x5d, 0x08, 0x6a, 0x08, 0x67, 0x08,
-    0x64, 0x08, 0x60, 0x08, 0x57, 0x08, 0x4b, 0x08,
-    0x32, 0x08, 0x24, 0x08, 0x0b, 0x08, 0xf9, 0x07,
-    0xdd, 0x07, 0xb5, 0x07, 0x96, 0x07, 0x78, 0x07,
-    0x5e, 0x07, 0x37, 0x07, 0x0e, 0x07, 0xe4, 0x06,
-    0xba, 0x06, 0x92, 0x06, 0x65, 0x06, 0x28, 0x06,
-    0xdf, 0x05, 0xa0, 0x05, 0x64, 0x05, 0x26, 0x05,
-    0xdc, 0x04, 0x91, 0x04, 0x43, 0x04, 0xf5, 0x03,
-    0xa1, 0x03, 0x3a, 0x03, 0xd8, 0x02, 0x74, 0x02,
-    0x17, 0x02, 0xc0, 0x01, 0x68, 0x01, 0x08, 0x01,
-    0xa6, 0x00, 0x49, 0x00, 0xf2, 0xff, 0x9a, 0xff,
-    0x31, 0xff, 0xbd, 0xfe, 0x55, 0xfe, 0xf2, 0xfd,
-    0x90, 0xfd, 0x36, 0xfd, 0xdf, 0xfc, 0x8e, 0xfc,
-    0x42, 0xfc, 0xf8, 0xfb, 0xa9, 0xfb, 0x58, 0xfb,
-    0x1a, 0xfb, 0xe3, 0xfa, 0xa7, 0xfa, 0x69, 0xfa,
-    0x2a, 0xfa, 0xf7, 0xf9, 0xc2, 0xf9, 0x95, 0xf9,
-    0x6f, 0xf9, 0x47, 0xf9, 0x2f, 0xf9, 0x15, 0xf9,
-    0xfc, 0xf8, 0xe2, 0xf8, 0xc9, 0xf8, 0xbd, 0xf8,
-    0xb5, 0xf8, 0xb7, 0xf8, 0xb2, 0xf8, 0xaf, 0xf8,
-    0xad, 0xf8, 0xad, 0xf8, 0xb2, 0xf8, 0xb5, 0xf8,
-    0xbe, 0xf8, 0xcc, 0xf8, 0xdb, 0xf8, 0xe9, 0xf8,
-    0xf2, 0xf8, 0xf9, 0xf8, 0x06, 0xf9, 0x1b, 0xf9,
-    0x34, 0xf9, 0x53, 0xf9, 0x70, 0xf9, 0x96, 0xf9,
-    0xc6, 0xf9, 0xf1, 0xf9, 0x23, 0xfa, 0x4a, 0xfa,
-    0x79, 0xfa, 0xab, 0xfa, 0xdc, 0xfa, 0x11, 0xfb,
-    0x4a, 0xfb, 0x90, 0xfb, 0xe5, 0xfb, 0x3d, 0xfc,
-    0x83, 0xfc, 0xc8, 0xfc, 0x06, 0xfd, 0x44, 0xfd,
-    0x7d, 0xfd, 0xb9, 0xfd, 0xef, 0xfd, 0x31, 0xfe,
-    0x92, 0xfe, 0xec, 0xfe, 0x3f, 0xff, 0x7f, 0xff,
-    0xc9, 0xff, 0x18, 0x00, 0x67, 0x00, 0xb0, 0x00,
-    0xea, 0x00, 0x21, 0x01, 0x68, 0x01, 0xc8, 0x01,
-    0x23, 0x02, 0x75, 0x02, 0xbd, 0x02, 0xff, 0x02,
-    0x3f, 0x03, 0x87, 0x03, 0xc3, 0x03, 0xfa, 0x03,
-    0x27, 0x04, 0x4f, 0x04, 0x7a, 0x04, 0xaf, 0x04,
-    0xdf, 0x04, 0xfd, 0x04, 0x28, 0x05, 0x47, 0x05,
-    0x6c, 0x05, 0x85, 0x05, 0x9f, 0x05, 0xbd, 0x05,
-    0xd9, 0x05, 0xf2, 0x05, 0x03, 0x06, 0x1a, 0x06,
-    0x2a, 0x06, 0x3e, 0x06, 0x52, 0x06, 0x5c, 0x06,
-    0x5f, 0x06, 0x61, 0x06, 0x59, 0x06, 0x51, 0x06,
-    0x41, 0x06, 0x2b, 0x06, 0x1f, 0x06, 0x17, 0x06,
-    0x0d, 0x06, 0xfe, 0x05, 0xef, 0x05, 0xd5, 0x05,
-    0xb6, 0x05, 0x99, 0x05, 0x79, 0x05, 0x50, 0x05,
-    0x2b, 0x05, 0x08, 0x05, 0xe3, 0x04, 0xbb, 0x04,
-    0x8a, 0x04, 0x57, 0x04, 0x1f, 0x04, 0xe8, 0x03,
-    0xb0, 0x03, 0x6e, 0x03, 0x25, 0x03, 0xe0, 0x02,
-    0x97, 0x02, 0x55, 0x02, 0x15, 0x02, 0xcf, 0x01,
-    0x8d, 0x01, 0x4c, 0x01, 0x12, 0x01, 0xd3, 0x00,
-    0x90, 0x00, 0x46, 0x00, 0x00, 0x00, 0xb8, 0xff,
-    0x62, 0xff, 0x18, 0xff, 0xce, 0xfe, 0x86, 0xfe,
-    0x41, 0xfe, 0x00, 0xfe, 0xba, 0xfd, 0x7f, 0xfd,
-    0x4e, 0xfd, 0x1b, 0xfd, 0xe4, 0xfc, 0xa5, 0xfc,
-    0x60, 0xfc, 0x27, 0xfc, 0x00, 0xfc, 0xdb, 0xfb,
-    0xa5, 0xfb, 0x7c, 0xfb, 0x56, 0xfb, 0x43, 0xfb,
-    0x27, 0xfb, 0xff, 0xfa, 0xdd, 0xfa, 0xbe, 0xfa,
-    0xa4, 0xfa, 0x84, 0xfa, 0x64, 0xfa, 0x43, 0xfa,
-    0x32, 0xfa, 0x2b, 0xfa, 0x24, 0xfa, 0x1f, 0xfa,
-    0x20, 0xfa, 0x1d, 0xfa, 0x1d, 0xfa, 0x1d, 0xfa,
-    0x1e, 0xfa, 0x23, 0xfa, 0x27, 0xfa, 0x2a, 0xfa,
-    0x39, 0xfa, 0x4f, 0xfa, 0x63, 0xfa, 0x79, 0xfa,
-    0x8f, 0xfa, 0xb8, 0xfa, 0xd5, 0xfa, 0xef, 0xfa,
-    0x0a, 0xfb, 0x23, 0xfb, 0x4c, 0xfb, 0x69, 0xfb,
-    0x85, 0xfb, 0xad, 0xfb, 0xe8, 0xfb, 0x23, 0xfc,
-    0x5f, 0xfc, 0x9e, 0xfc, 0xd5, 0xfc, 0x12, 0xfd,
-    0x49, 0xfd, 0x7e, 0xfd, 0xb2, 0xfd, 0xe5, 0xfd,
-    0x1d, 0xfe, 0x58, 0xfe, 0x9a, 0xfe, 0xdc, 0xfe,
-    0x1d, 0xff, 0x5c, 0xff, 0x9a, 0xff, 0xd4, 0xff,
-    0x08, 0x00, 0x3d, 0x00, 0x74, 0x00, 0xa3, 0x00,
-    0xd2, 0x00, 0xfb, 0x00, 0x26, 0x01, 0x5a, 0x01,
-    0x94, 0x01, 0xcd, 0x01, 0x02, 0x02, 0x3b, 0x02,
-    0x6f, 0x02, 0x9a, 0x02, 0xb7, 0x02, 0xcc, 0x02,
-    0xdd, 0x02, 0xf8, 0x02, 0x20, 0x03, 0x4e, 0x03,
-    0x7b, 0x03, 0xa6, 0x03, 0xd4, 0x03, 0xf8, 0x03,
-    0x18, 0x04, 0x33, 0x04, 0x43, 0x04, 0x57, 0x04,
-    0x68, 0x04, 0x82, 0x04, 0x9e, 0x04, 0xbe, 0x04,
-    0xdc, 0x04, 0xed, 0x04, 0xfe, 0x04, 0x0e, 0x05,
-    0x1b, 0x05, 0x22, 0x05, 0x24, 0x05, 0x22, 0x05,
-    0x1b, 0x05, 0x12, 0x05, 0x0c, 0x05, 0x06, 0x05,
-    0x03, 0x05, 0x03, 0x05, 0x00, 0x05, 0xf3, 0x04,
-    0xdd, 0x04, 0xc0, 0x04, 0xa7, 0x04, 0x90, 0x04,
-    0x77, 0x04, 0x53, 0x04, 0x2d, 0x04, 0x09, 0x04,
-    0xea, 0x03, 0xc5, 0x03, 0x9a, 0x03, 0x73, 0x03,
-    0x48, 0x03, 0x19, 0x03, 0xe9, 0x02, 0xb3, 0x02,
-    0x7b, 0x02, 0x49, 0x02, 0x1a, 0x02, 0xe5, 0x01,
-    0xaa, 0x01, 0x71, 0x01, 0x3b, 0x01, 0x08, 0x01,
-    0xce, 0x00, 0x9c, 0x00, 0x6a, 0x00, 0x3a, 0x00,
-    0x0d, 0x00, 0xda, 0xff, 0xa8, 0xff, 0x6e, 0xff,
-    0x40, 0xff, 0x15, 0xff, 0xeb, 0xfe, 0xca, 0xfe,
-    0x9e, 0xfe, 0x7a, 0xfe, 0x4e, 0xfe, 0x2a, 0xfe,
-    0x06, 0xfe, 0xda, 0xfd, 0xbb, 0xfd, 0x90, 0xfd,
-    0x6a, 0xfd, 0x46, 0xfd, 0x23, 0xfd, 0x09, 0xfd,
-    0xf0, 0xfc, 0xd3, 0xfc, 0xb3, 0xfc, 0x95, 0xfc,
-    0x7d, 0xfc, 0x68, 0xfc, 0x4f, 0xfc, 0x38, 0xfc,
-    0x2a, 0xfc, 0x1e, 0xfc, 0x0f, 0xfc, 0x04, 0xfc,
-    0xf9, 0xfb, 0xed, 0xfb, 0xeb, 0xfb, 0xee, 0xfb,
-    0xf1, 0xfb, 0xf2, 0xfb, 0xf0, 0xfb, 0xf5, 0xfb,
-    0xfd, 0xfb, 0x05, 0xfc, 0x0e, 0xfc, 0x15, 0xfc,
-    0x2e, 0xfc, 0x3b, 0xfc, 0x4a, 0xfc, 0x50, 0xfc,
-    0x58, 0xfc, 0x6f, 0xfc, 0x89, 0xfc, 0xab, 0xfc,
-    0xc0, 0xfc, 0xd9, 0xfc, 0xf4, 0xfc, 0x19, 0xfd,
-    0x3d, 0xfd, 0x59, 0xfd, 0x7c, 0xfd, 0x9f, 0xfd,
-    0xc1, 0xfd, 0xdc, 0xfd, 0xf8, 0xfd, 0x1c, 0xfe,
-    0x50, 0xfe, 0x83, 0xfe, 0xaf, 0xfe, 0xda, 0xfe,
-    0x02, 0xff, 0x25, 0xff, 0x48, 0xff, 0x6b, 0xff,
-    0x96, 0xff, 0xbd, 0xff, 0xe3, 0xff, 0x0c, 0x00,
-    0x38, 0x00, 0x66, 0x00, 0x95, 0x00, 0xc9, 0x00,
-    0xfd, 0x00, 0x24, 0x01, 0x43, 0x01, 0x62, 0x01,
-    0x82, 0x01, 0xa9, 0x01, 0xcd, 0x01, 0xee, 0x01,
-    0x10, 0x02, 0x34, 0x02, 0x58, 0x02, 0x7e, 0x02,
-    0xa1, 0x02, 0xc5, 0x02, 0xea, 0x02, 0x01, 0x03,
-    0x1a, 0x03, 0x3a, 0x03, 0x56, 0x03, 0x70, 0x03,
-    0x8d, 0x03, 0xa7, 0x03, 0xc0, 0x03, 0xd0, 0x03,
-    0xd7, 0x03, 0xd9, 0x03, 0xe1, 0x03, 0xec, 0x03,
-    0xe8, 0x03, 0xe4, 0x03, 0xd7, 0x03, 0xd6, 0x03,
-    0xd2, 0x03, 0xd6, 0x03, 0xd5, 0x03, 0xcd, 0x03,
-    0xc8, 0x03, 0xb7, 0x03, 0xaa, 0x03, 0x90, 0x03,
-    0x84, 0x03, 0x77, 0x03, 0x6b, 0x03, 0x59, 0x03,
-    0x41, 0x03, 0x24, 0x03, 0x0a, 0x03, 0xf5, 0x02,
-    0xd7, 0x02, 0xb7, 0x02, 0x95, 0x02, 0x7a, 0x02,
-    0x57, 0x02, 0x33, 0x02, 0x0c, 0x02, 0xeb, 0x01,
-    0xcf, 0x01, 0xb7, 0x01, 0x97, 0x01, 0x72, 0x01,
-    0x4e, 0x01, 0x25, 0x01, 0xfe, 0x00, 0xdd, 0x00,
-    0xb7, 0x00, 0x90, 0x00, 0x6d, 0x00, 0x41, 0x00,
-    0x18, 0x00, 0xf4, 0xff, 0xd5, 0xff, 0xb4, 0xff,
-    0x8f, 0xff, 0x69, 0xff, 0x3d, 0xff, 0x17, 0xff,
-    0xf4, 0xfe, 0xce, 0xfe, 0xa9, 0xfe, 0x89, 0xfe,
-    0x68, 0xfe, 0x3f, 0xfe, 0x17, 0xfe, 0xf9, 0xfd,
-    0xdf, 0xfd, 0xc9, 0xfd, 0xaf, 0xfd, 0x95, 0xfd,
-    0x7b, 0xfd, 0x62, 0xfd, 0x50, 0xfd, 0x3b, 0xfd,
-    0x2e, 0xfd, 0x24, 0xfd, 0x15, 0xfd, 0x04, 0xfd,
-    0xf5, 0xfc, 0xe7, 0xfc, 0xdf, 0xfc, 0xd7, 0xfc,
-    0xd0, 0xfc, 0xca, 0xfc, 0xc9, 0xfc, 0xc3, 0xfc,
-    0xbd, 0xfc, 0xc0, 0xfc, 0xbd, 0xfc, 0xbe, 0xfc,
-    0xb9, 0xfc, 0xb9, 0xfc, 0xbf, 0xfc, 0xc9, 0xfc,
-    0xd1, 0xfc, 0xd9, 0xfc, 0xdf, 0xfc, 0xea, 0xfc,
-    0xfe, 0xfc, 0x0a, 0xfd, 0x1a, 0xfd, 0x21, 0xfd,
-    0x31, 0xfd, 0x46, 0xfd, 0x5c, 0xfd, 0x75, 0xfd,
-    0x86, 0xfd, 0xa0, 0xfd, 0xc0, 0xfd, 0xdd, 0xfd,
-    0xf5, 0xfd, 0x05, 0xfe, 0x1f, 0xfe, 0x3c, 0xfe,
-    0x57, 0xfe, 0x73, 0xfe, 0x8f, 0xfe, 0xb2, 0xfe,
-    0xd9, 0xfe, 0xfb, 0xfe, 0x1b, 0xff, 0x44, 0xff,
-    0x70, 0xff, 0x99, 0xff, 0xb9, 0xff, 0xd6, 0xff,
-    0xf2, 0xff, 0x17, 0x00, 0x3c, 0x00, 0x5a, 0x00,
-    0x78, 0x00, 0x8e, 0x00, 0xa6, 0x00, 0xc7, 0x00,
-    0xe8, 0x00, 0x08, 0x01, 0x20, 0x01, 0x35, 0x01,
-    0x50, 0x01, 0x6a, 0x01, 0x84, 0x01, 0x9c, 0x01,
-    0xb6, 0x01, 0xd1, 0x01, 0xed, 0x01, 0x01, 0x02,
-    0x17, 0x02, 0x2f, 0x02, 0x48, 0x02, 0x5d, 0x02,
-    0x6c, 0x02, 0x77, 0x02, 0x7f, 0x02, 0x85, 0x02,
-    0x8a, 0x02, 0x95, 0x02, 0x9a, 0x02, 0x9f, 0x02,
-    0xa2, 0x02, 0xa5, 0x02, 0xab, 0x02, 0xaf, 0x02,
-    0xac, 0x02, 0xa5, 0x02, 0xa2, 0x02, 0x9b, 0x02,
-    0x93, 0x02, 0x8c, 0x02, 0x85, 0x02, 0x7d, 0x02,
-    0x7f, 0x02, 0x7b, 0x02, 0x6c, 0x02, 0x60, 0x02,
-    0x4d, 0x02, 0x3b, 0x02, 0x2d, 0x02, 0x12, 0x02,
-    0xf6, 0x01, 0xe6, 0x01, 0xd3, 0x01, 0xbb, 0x01,
-    0xa4, 0x01, 0x90, 0x01, 0x85, 0x01, 0x74, 0x01,
-    0x5f, 0x01, 0x45, 0x01, 0x22, 0x01, 0x01, 0x01,
-    0xe0, 0x00, 0xc0, 0x00, 0xaa, 0x00, 0x8f, 0x00,
-    0x76, 0x00, 0x60, 0x00, 0x49, 0x00, 0x32, 0x00,
-    0x13, 0x00, 0xfc, 0xff, 0xe3, 0xff, 0xc6, 0xff,
-    0xa6, 0xff, 0x7f, 0xff, 0x64, 0xff, 0x4b, 0xff,
-    0x34, 0xff, 0x24, 0xff, 0x0d, 0xff, 0xf0, 0xfe,
-    0xd2, 0xfe, 0xc0, 0xfe, 0xaa, 0xfe, 0x90, 0xfe,
-    0x71, 0xfe, 0x52, 0xfe, 0x40, 0xfe, 0x2b, 0xfe,
-    0x19, 0xfe, 0x07, 0xfe, 0xfb, 0xfd, 0xf0, 0xfd,
-    0xe9, 0xfd, 0xdb, 0xfd, 0xcc, 0xfd, 0xbf, 0xfd,
-    0xb4, 0xfd, 0xa9, 0xfd, 0x9f, 0xfd, 0x9b, 0xfd,
-    0x91, 0xfd, 0x8f, 0xfd, 0x8e, 0xfd, 0x8d, 0xfd,
-    0x8e, 0xfd, 0x8f, 0xfd, 0x8d, 0xfd, 0x8a, 0xfd,
-    0x86, 0xfd, 0x80, 0xfd, 0x80, 0xfd, 0x81, 0xfd,
-    0x8b, 0xfd, 0x90, 0xfd, 0x96, 0xfd, 0xa3, 0xfd,
-    0xb1, 0xfd, 0xc4, 0xfd, 0xd1, 0xfd, 0xdf, 0xfd,
-    0xef, 0xfd, 0x00, 0xfe, 0x0c, 0xfe, 0x17, 0xfe,
-    0x29, 0xfe, 0x3c, 0xfe, 0x55, 0xfe, 0x6b, 0xfe,
-    0x82, 0xfe, 0x96, 0xfe, 0xa9, 0xfe, 0xbd, 0xfe,
-    0xd1, 0xfe, 0xe7, 0xfe, 0xfb, 0xfe, 0x0a, 0xff,
-    0x19, 0xff, 0x37, 0xff, 0x56, 0xff, 0x73, 0xff,
-    0x94, 0xff, 0xae, 0xff, 0xca, 0xff, 0xe0, 0xff,
-    0xf9, 0xff, 0x11, 0x00, 0x27, 0x00, 0x41, 0x00,
-    0x5b, 0x00, 0x77, 0x00, 0x8f, 0x00, 0xa4, 0x00,
-    0xbd, 0x00, 0xd7, 0x00, 0xf1, 0x00, 0x06, 0x01,
-    0x14, 0x01, 0x25, 0x01, 0x37, 0x01, 0x43, 0x01,
-    0x4f, 0x01, 0x61, 0x01, 0x76, 0x01, 0x8c, 0x01,
-    0xa3, 0x01, 0xb4, 0x01, 0xc3, 0x01, 0xd5, 0x01,
-    0xe0, 0x01, 0xeb, 0x01, 0xee, 0x01, 0xf4, 0x01,
-    0xfa, 0x01, 0xfd, 0x01, 0x04, 0x02, 0x0a, 0x02,
-    0x0f, 0x02, 0x16, 0x02, 0x15, 0x02, 0x14, 0x02,
-    0x12, 0x02, 0x0b, 0x02, 0x0a, 0x02, 0x04, 0x02,
-    0x01, 0x02, 0xfe, 0x01, 0xf6, 0x01, 0xf1, 0x01,
-    0xf0, 0x01, 0xeb, 0x01, 0xe7, 0x01, 0xe1, 0x01,
-    0xd6, 0x01, 0xc6, 0x01, 0xb8, 0x01, 0xb0, 0x01,
-    0x9b, 0x01, 0x8e, 0x01, 0x7f, 0x01, 0x71, 0x01,
-    0x5f, 0x01, 0x50, 0x01, 0x3f, 0x01, 0x2d, 0x01,
-    0x1b, 0x01, 0x08, 0x01, 0xfa, 0x00, 0xe9, 0x00,
-    0xd2, 0x00, 0xbe, 0x00, 0xac, 0x00, 0x99, 0x00,
-    0x8c, 0x00, 0x7b, 0x00, 0x65, 0x00, 0x4e, 0x00,
-    0x3d, 0x00, 0x28, 0x00, 0x13, 0x00, 0x01, 0x00,
-    0xee, 0xff, 0xd9, 0xff, 0xc1, 0xff, 0xad, 0xff,
-    0x98, 0xff, 0x87, 0xff, 0x74, 0xff, 0x5f, 0xff,
-    0x48, 0xff, 0x35, 0xff, 0x23, 0xff, 0x12, 0xff,
-    0x02, 0xff, 0xf2, 0xfe, 0xe6, 0xfe, 0xdb, 0xfe,
-    0xcd, 0xfe, 0xc2, 0xfe, 0xb5, 0xfe, 0xaa, 0xfe,
-    0xa4, 0xfe, 0x9c, 0xfe, 0x92, 0xfe, 0x89, 0xfe,
-    0x7e, 0xfe, 0x74, 0xfe, 0x71, 0xfe, 0x6c, 0xfe,
-    0x64, 0xfe, 0x63, 0xfe, 0x5e, 0xfe, 0x5e, 0xfe,
-    0x5e, 0xfe, 0x5f, 0xfe, 0x60, 0xfe, 0x5b, 0xfe,
-    0x5c, 0xfe, 0x5e, 0xfe, 0x61, 0xfe, 0x65, 0xfe,
-    0x6a, 0xfe, 0x73, 0xfe, 0x73, 0xfe, 0x7b, 0xfe,
-    0x85, 0xfe, 0x8e, 0xfe, 0x9a, 0xfe, 0xa4, 0xfe,
-    0xae, 0xfe, 0xb8, 0xfe, 0xc8, 0xfe, 0xd3, 0xfe,
-    0xd8, 0xfe, 0xe6, 0xfe, 0xfb, 0xfe, 0x0c, 0xff,
-    0x1c, 0xff, 0x2e, 0xff, 0x3c, 0xff, 0x49, 0xff,
-    0x56, 0xff, 0x68, 0xff, 0x78, 0xff, 0x8b, 0xff,
-    0x9e, 0xff, 0xb2, 0xff, 0xc1, 0xff, 0xd5, 0xff,
-    0xe9, 0xff, 0xfb, 0xff, 0x12, 0x00, 0x20, 0x00,
-    0x2f, 0x00, 0x3c, 0x00, 0x50, 0x00, 0x62, 0x00,
-    0x6f, 0x00, 0x82, 0x00, 0x97, 0x00, 0xaf, 0x00,
-    0xc1, 0x00, 0xd1, 0x00, 0xe0, 0x00, 0xe9, 0x00,
-    0xf4, 0x00, 0xff, 0x00, 0x0c, 0x01, 0x19, 0x01,
-    0x28, 0x01, 0x35, 0x01, 0x43, 0x01, 0x53, 0x01,
-    0x62, 0x01, 0x6e, 0x01, 0x74, 0x01, 0x7c, 0x01,
-    0x80, 0x01, 0x82, 0x01, 0x83, 0x01, 0x88, 0x01,
-    0x90, 0x01, 0x96, 0x01, 0x9a, 0x01, 0x9b, 0x01,
-    0x98, 0x01, 0x99, 0x01, 0x9a, 0x01, 0x97, 0x01,
-    0x95, 0x01, 0x93, 0x01, 0x91, 0x01, 0x8b, 0x01,
-    0x85, 0x01, 0x86, 0x01, 0x83, 0x01, 0x81, 0x01,
-    0x7a, 0x01, 0x73, 0x01, 0x6b, 0x01, 0x60, 0x01,
-    0x54, 0x01, 0x49, 0x01, 0x3e, 0x01, 0x33, 0x01,
-    0x2b, 0x01, 0x1d, 0x01, 0x15, 0x01, 0x08, 0x01,
-    0xfb, 0x00, 0xee, 0x00, 0xe1, 0x00, 0xcd, 0x00,
-    0xba, 0x00, 0xab, 0x00, 0x99, 0x00, 0x8c, 0x00,
-    0x7e, 0x00, 0x72, 0x00, 0x64, 0x00, 0x54, 0x00,
-    0x47, 0x00, 0x37, 0x00, 0x23, 0x00, 0x12, 0x00,
-    0x00, 0x00, 0xf3, 0xff, 0xe2, 0xff, 0xd4, 0xff,
-    0xc4, 0xff, 0xb8, 0xff, 0xae, 0xff, 0x9e, 0xff,
-    0x8d, 0xff, 0x7d, 0xff, 0x70, 0xff, 0x5e, 0xff,
-    0x4d, 0xff, 0x3c, 0xff, 0x35, 0xff, 0x2c, 0xff,
-    0x24, 0xff, 0x18, 0xff, 0x0c, 0xff, 0x04, 0xff,
-    0xfc, 0xfe, 0xf1, 0xfe, 0xe7, 0xfe, 0xe0, 0xfe,
-    0xd3, 0xfe, 0xcc, 0xfe, 0xc7, 0xfe, 0xc4, 0xfe,
-    0xbe, 0xfe, 0xbb, 0xfe, 0xb7, 0xfe, 0xb6, 0xfe,
-    0xb5, 0xfe, 0xb0, 0xfe, 0xab, 0xfe, 0xaa, 0xfe,
-    0xae, 0xfe, 0xad, 0xfe, 0xae, 0xfe, 0xb5, 0xfe,
-    0xb9, 0xfe, 0xba, 0xfe, 0xc6, 0xfe, 0xcb, 0xfe,
-    0xcf, 0xfe, 0xd6, 0xfe, 0xd8, 0xfe, 0xdf, 0xfe,
-    0xe1, 0xfe, 0xe6, 0xfe, 0xed, 0xfe, 0xf5, 0xfe,
-    0xff, 0xfe, 0x05, 0xff, 0x11, 0xff, 0x1a, 0xff,
-    0x23, 0xff, 0x2e, 0xff, 0x39, 0xff, 0x43, 0xff,
-    0x4a, 0xff, 0x58, 0xff, 0x65, 0xff, 0x73, 0xff,
-    0x82, 0xff, 0x94, 0xff, 0xa0, 0xff, 0xac, 0xff,
-    0xbb, 0xff, 0xc5, 0xff, 0xd1, 0xff, 0xdf, 0xff,
-    0xee, 0xff, 0xf9, 0xff, 0x0a, 0x00, 0x17, 0x00,
-    0x25, 0x00, 0x32, 0x00, 0x3a, 0x00, 0x4a, 0x00,
-    0x53, 0x00, 0x5d, 0x00, 0x69, 0x00, 0x77, 0x00,
-    0x85, 0x00, 0x92, 0x00, 0xa1, 0x00, 0xaa, 0x00,
-    0xb7, 0x00, 0xc3, 0x00, 0xcb, 0x00, 0xd0, 0x00,
-    0xd8, 0x00, 0xde, 0x00, 0xe3, 0x00, 0xe8, 0x00,
-    0xeb, 0x00, 0xf1, 0x00, 0xf7, 0x00, 0xfe, 0x00,
-    0xff, 0x00, 0x04, 0x01, 0x05, 0x01, 0x03, 0x01,
-    0x03, 0x01, 0x03, 0x01, 0x04, 0x01, 0x06, 0x01,
-    0x09, 0x01, 0x0c, 0x01, 0x0e, 0x01, 0x10, 0x01,
-    0x0f, 0x01, 0x0c, 0x01, 0x08, 0x01, 0x04, 0x01,
-    0xfe, 0x00, 0xf6, 0x00, 0xf1, 0x00, 0xef, 0x00,
-    0xeb, 0x00, 0xe2, 0x00, 0xdd, 0x00, 0xd6, 0x00,
-    0xcd, 0x00, 0xc5, 0x00, 0xbc, 0x00, 0xb0, 0x00,
-    0xa8, 0x00, 0xa2, 0x00, 0x9a, 0x00, 0x8f, 0x00,
-    0x86, 0x00, 0x7f, 0x00, 0x76, 0x00, 0x6c, 0x00,
-    0x61, 0x00, 0x54, 0x00, 0x46, 0x00, 0x3b, 0x00,
-    0x30, 0x00, 0x26, 0x00, 0x1b, 0x00, 0x0d, 0x00,
-    0x02, 0x00, 0xf6, 0xff, 0xed, 0xff, 0xde, 0xff,
-    0xd5, 0xff, 0xc7, 0xff, 0xbc, 0xff, 0xb4, 0xff,
-    0xa9, 0xff, 0xa1, 0xff, 0x93, 0xff, 0x89, 0xff,
-    0x80, 0xff, 0x78, 0xff, 0x6f, 0xff, 0x62, 0xff,
-    0x54, 0xff, 0x4b, 0xff, 0x46, 0xff, 0x3e, 0xff,
-    0x37, 0xff, 0x30, 0xff, 0x2a, 0xff, 0x21, 0xff,
-    0x1b, 0xff, 0x16, 0xff, 0x10, 0xff, 0x0c, 0xff,
-    0x07, 0xff, 0x07, 0xff, 0x03, 0xff, 0xfb, 0xfe,
-    0xfa, 0xfe, 0xf7, 0xfe, 0xf5, 0xfe, 0xf6, 0xfe,
-    0xf4, 0xfe, 0xf3, 0xfe, 0xf0, 0xfe, 0xf4, 0xfe,
-    0xf4, 0xfe, 0xf8, 0xfe, 0xf9, 0xfe, 0xf8, 0xfe,
-    0xfc, 0xfe, 0xfb, 0xfe, 0xfe, 0xfe, 0x00, 0xff,
-    0x05, 0xff, 0x09, 0xff, 0x10, 0xff, 0x19, 0xff,
-    0x20, 0xff, 0x27, 0xff, 0x2c, 0xff, 0x32, 0xff,
-    0x39, 0xff, 0x40, 0xff, 0x46, 0xff, 0x4d, 0xff,
-    0x54, 0xff, 0x5d, 0xff, 0x67, 0xff, 0x74, 0xff,
-    0x7d, 0xff, 0x87, 0xff, 0x91, 0xff, 0x9a, 0xff,
-    0xa1, 0xff, 0xad, 0xff, 0xb5, 0xff, 0xbf, 0xff,
-    0xca, 0xff, 0xd6, 0xff, 0xdf, 0xff, 0xeb, 0xff,
-    0xfa, 0xff, 0x04, 0x00, 0x11, 0x00, 0x19, 0x00,
-    0x22, 0x00, 0x2b, 0x00, 0x32, 0x00, 0x38, 0x00,
-    0x42, 0x00, 0x49, 0x00, 0x53, 0x00, 0x5b, 0x00,
-    0x63, 0x00, 0x6f, 0x00, 0x75, 0x00, 0x7b, 0x00,
-    0x80, 0x00, 0x88, 0x00, 0x8f, 0x00, 0x95, 0x00,
-    0x9e, 0x00, 0xa5, 0x00, 0xab, 0x00, 0xaf, 0x00,
-    0xb3, 0x00, 0xb8, 0x00, 0xbe, 0x00, 0xbf, 0x00,
-    0xbe, 0x00, 0xc0, 0x00, 0xc4, 0x00, 0xc7, 0x00,
-    0xca, 0x00, 0xcb, 0x00, 0xcb, 0x00, 0xc9, 0x00,
-    0xc6, 0x00, 0xc5, 0x00, 0xc0, 0x00, 0xbc, 0x00,
-    0xb9, 0x00, 0xb6, 0x00, 0xb7, 0x00, 0xb7, 0x00,
-    0xb4, 0x00, 0xb5, 0x00, 0xb4, 0x00, 0xae, 0x00,
-    0xaa, 0x00, 0x9f, 0x00, 0x9a, 0x00, 0x94, 0x00,
-    0x93, 0x00, 0x8a, 0x00, 0x83, 0x00, 0x7e, 0x00,
-    0x7a, 0x00, 0x70, 0x00, 0x66, 0x00, 0x5e, 0x00,
-    0x56, 0x00, 0x4d, 0x00, 0x43, 0x00, 0x3b, 0x00,
-    0x33, 0x00, 0x2c, 0x00, 0x28, 0x00, 0x25, 0x00,
-    0x1b, 0x00, 0x16, 0x00, 0x0d, 0x00, 0x05, 0x00,
-    0xfe, 0xff, 0xf3, 0xff, 0xeb, 0xff, 0xe4, 0xff,
-    0xdc, 0xff, 0xd6, 0xff, 0xd3, 0xff, 0xc9, 0xff,
-    0xc0, 0xff, 0xb9, 0xff, 0xae, 0xff, 0xa8, 0xff,
-    0x9d, 0xff, 0x94, 0xff, 0x8e, 0xff, 0x87, 0xff,
-    0x82, 0xff, 0x7c, 0xff, 0x7a, 0xff, 0x75, 0xff,
-    0x70, 0xff, 0x6a, 0xff, 0x66, 0xff, 0x61, 0xff,
-    0x62, 0xff, 0x5e, 0xff, 0x5d, 0xff, 0x5e, 0xff,
-    0x5f, 0xff, 0x61, 0xff, 0x5f, 0xff, 0x60, 0xff,
-    0x5a, 0xff, 0x56, 0xff, 0x55, 0xff, 0x53, 0xff,
-    0x52, 0xff, 0x4f, 0xff, 0x51, 0xff, 0x51, 0xff,
-    0x56, 0xff, 0x56, 0xff, 0x55, 0xff, 0x59, 0xff,
-    0x5a, 0xff, 0x5d, 0xff, 0x62, 0xff, 0x68, 0xff,
-    0x6c, 0xff, 0x76, 0xff, 0x79, 0xff, 0x7f, 0xff,
-    0x85, 0xff, 0x8c, 0xff, 0x92, 0xff, 0x9a, 0xff,
-    0x9f, 0xff, 0x9f, 0xff, 0xa3, 0xff, 0xac, 0xff,
-    0xb6, 0xff, 0xba, 0xff, 0xc3, 0xff, 0xc9, 0xff,
-    0xcf, 0xff, 0xd7, 0xff, 0xdf, 0xff, 0xe3, 0xff,
-    0xee, 0xff, 0xf5, 0xff, 0xff, 0xff, 0x07, 0x00,
-    0x0c, 0x00, 0x12, 0x00, 0x1b, 0x00, 0x23, 0x00,
-    0x2b, 0x00, 0x32, 0x00, 0x39, 0x00, 0x3e, 0x00,
-    0x44, 0x00, 0x49, 0x00, 0x4f, 0x00, 0x58, 0x00,
-    0x65, 0x00, 0x68, 0x00, 0x6a, 0x00, 0x6e, 0x00,
-    0x73, 0x00, 0x79, 0x00, 0x79, 0x00, 0x7d, 0x00,
-    0x83, 0x00, 0x89, 0x00, 0x8a, 0x00, 0x94, 0x00,
-    0x92, 0x00, 0x9c, 0x00, 0x95, 0x00, 0xa5, 0x00,
-    0x95, 0x00, 0xb4, 0x00, 0x63, 0x00
-};
@@ -4,57 +4,174 @@
 
 #include "fail.h"
 #include "constants.h"
-#include "pcm_decoder.h"
+#include "token_decoder.h"
+#include "block_pipeline.h"
+#include "soft_limiter.h"
 #include "audio_player.h"
 
 #include "pico/audio_pwm.h"
+#include "pico/time.h"
 
-#include <limits>
-
-typedef audio_player::sample_data sample_data;
-typedef pcm_decoder decoder;
+#include <algorithm>
+#include <cstring>
+#include <optional>
 
 namespace {
-    constexpr size_t OVERLAP_SAMPLES = constants::OVERLAP_MS * AUDIO_SAMPLE_RATE / 1000;
+    constexpr uint32_t FADE_SAMPLES = constants::PREEMPT_FADE_MS * AUDIO_SAMPLE_RATE / 1000;
+    static_assert(FADE_SAMPLES > 0 && FADE_SAMPLES <= AUDIO_BUFFER_SAMPLE_LENGTH, "Fade must fit in one buffer");
 
-    audio_buffer_t *safely_take_audio_buffer(audio_buffer_pool_t *producer_pool) {
-        audio_buffer_t *buffer = take_audio_buffer(producer_pool, true);
-        if (!buffer) {
-            fail(FAIL_NO_BUFFER);
+    // Decoded audio for compressed tokens, see decode_cache.h
+    constexpr size_t DECODE_CACHE_SAMPLES = constants::DECODE_CACHE_BYTES / sizeof(int16_t);
+    int16_t decode_cache_arena[DECODE_CACHE_SAMPLES ? DECODE_CACHE_SAMPLES : 1];
+
+    // Buffers are filled a block at a time, see block_pipeline.h
+    typedef block_pipeline<AUDIO_BUFFER_SAMPLE_LENGTH> pipeline;
+    int16_t voice_scratch[pipeline::LENGTH];
+    int32_t wide_scratch[pipeline::LENGTH];
+
+    constexpr int32_t UNITY_GAIN = pipeline::UNITY;
+    soft_limiter<pipeline::LENGTH> limiter;
+
+    // Ducking ramps down in DUCK_MS and back up again, a cut fades out in FADE_SAMPLES
+    constexpr int32_t DUCK_GAIN = constants::DUCK_PERCENT * UNITY_GAIN / 100;
+    constexpr int32_t DUCK_SAMPLES = constants::DUCK_MS * AUDIO_SAMPLE_RATE / 1000;
+    static_assert(DUCK_SAMPLES > 0 && DUCK_GAIN <= UNITY_GAIN, "Bad ducking configuration");
+    constexpr int32_t DUCK_STEP = (UNITY_GAIN - DUCK_GAIN + DUCK_SAMPLES - 1) / DUCK_SAMPLES;
+    constexpr int32_t FADE_STEP = (UNITY_GAIN + FADE_SAMPLES - 1) / FADE_SAMPLES;
+
+    /**
+     * An utterance being played.
+     *
+     * Entries of the plan are started as the stream reaches them and dropped
+     * once they have played for their length, and whatever is sounding in
+     * between is mixed.  The stream's gain ramps towards its target as it
+     * plays, for ducking and for fading out when cut.
+     */
+    struct stream {
+        static constexpr size_t VOICES = 2;           // Plans never overlap more than two entries
+
+        const utterance_plan *plan = nullptr;         // nullptr when idle
+        uint8_t priority = 0;
+        size_t next_entry = 0;                        // First entry not yet started
+        uint32_t position = 0;                        // Samples into the plan
+        std::optional<token_decoder> voices[VOICES];
+        const utterance_plan::entry *entries[VOICES] = {};
+        int32_t gain_q16 = UNITY_GAIN;
+        int32_t target_q16 = UNITY_GAIN;
+        int32_t step_q16 = DUCK_STEP;
+        bool fresh = false;                           // Starts at its target gain, without a ramp
+
+        bool active() const { return plan != nullptr; }
+
+        void start(const utterance_plan &utterance, uint8_t level) {
+            stop();
+            plan = &utterance;
+            priority = level;
+            fresh = true;
         }
-        return buffer;
-    }
 
-    int16_t mix(int16_t a, int16_t b) {
-        int32_t raw_result = static_cast<int32_t>(a) + static_cast<int32_t>(b);
-        if (raw_result > std::numeric_limits<int16_t>::max()) {
-            return std::numeric_limits<int16_t>::max();
-        } else if (raw_result < std::numeric_limits<int16_t>::min()) {
-            return std::numeric_limits<int16_t>::min();
+        void stop() {
+            for (size_t v = 0; v < VOICES; ++v) {
+                voices[v].reset();
+                entries[v] = nullptr;
+            }
+            next_entry = 0;
+            position = 0;
+            plan = nullptr;
+        }
+
+        // Start and stop voices as due, returns false once the plan is over
+        bool advance(decode_cache &cache) {
+            for (size_t v = 0; v < VOICES; ++v) {
+                if (voices[v] && entries[v]->start + entries[v]->length <= position) {
+                    voices[v].reset();
+                    entries[v] = nullptr;
+                }
+            }
+            while (next_entry < plan->size() && (*plan)[next_entry].start <= position) {
+                const auto &entry = (*plan)[next_entry++];
+                size_t v = 0;
+                while (v < VOICES && voices[v]) {
+                    ++v;
+                }
+                if (v == VOICES) {
+                    fail(FAIL_PLAN_OVERLAP);
+                }
+                voices[v].emplace(entry.asset->sample_rate, cache, *entry.asset);
+                entries[v] = &entry;
+            }
+            if (next_entry == plan->size() && !voices[0] && !voices[1]) {
+                stop();
+                return false;
+            }
+            return true;
         }
-        return static_cast<int16_t>(raw_result);
-    }
 
-    template <typename SampleProcessor>
-    void process_audio_data(audio_buffer_pool_t *producer_pool, uint32_t size, SampleProcessor source) {
-        uint32_t count = 0;
-        while (count < size) {
-            audio_buffer_t *buffer = safely_take_audio_buffer(producer_pool);
-            int16_t *samples = reinterpret_cast<int16_t *>(buffer->buffer->bytes);
-            uint32_t to_add = std::min(buffer->max_sample_count, size - count);
+        // Samples until a voice starts or stops, once advance() has returned true
+        uint32_t run() const {
+            uint32_t until = next_entry < plan->size() ? (*plan)[next_entry].start : UINT32_MAX;
+            for (size_t v = 0; v < VOICES; ++v) {
+                if (voices[v]) {
+                    until = std::min(until, entries[v]->start + entries[v]->length);
+                }
+            }
+            return until - position;
+        }
 
-            for (uint32_t n = 0; n < to_add; ++n) {
-                samples[n] = source();
+        // The voice sounding on its own at unity gain, if there is one
+        token_decoder *alone() {
+            token_decoder *found = nullptr;
+            for (size_t v = 0; v < VOICES; ++v) {
+                if (voices[v]) {
+                    if (found || entries[v]->gain_q16 != UNITY_GAIN) {
+                        return nullptr;
+                    }
+                    found = &*voices[v];
+                }
             }
+            return found;
+        }
 
-            buffer->sample_count = to_add;
-            count += to_add;
-            give_audio_buffer(producer_pool, buffer);
+        // Add up to count samples onto the bus, returns how many before the plan ended
+        uint32_t render(int32_t *bus, uint32_t count, decode_cache &cache) {
+            uint32_t done = 0;
+            while (done < count && advance(cache)) {
+                const uint32_t n = std::min(count - done, run());
+                int32_t ramp_q16 = gain_q16;
+                for (size_t v = 0; v < VOICES; ++v) {
+                    if (voices[v]) {
+                        pipeline::decode(*voices[v], voice_scratch, n);
+                        if (entries[v]->gain_q16 != UNITY_GAIN) {
+                            pipeline::gain(voice_scratch, n, entries[v]->gain_q16);
+                        }
+                        ramp_q16 = gain_q16;
+                        pipeline::accumulate(voice_scratch, bus + done, n, ramp_q16, target_q16, step_q16);
+                    }
+                }
+                gain_q16 = ramp_q16;
+                position += n;
+                done += n;
+            }
+            return done;
         }
+    };
+
+    // The counting is always the first stream, overlays use the rest
+    stream streams[constants::MAX_STREAMS];
+    stream &counting = streams[0];
+
+    audio_buffer_t *safely_take_audio_buffer(audio_buffer_pool_t *producer_pool) {
+        audio_buffer_t *buffer = take_audio_buffer(producer_pool, true);
+        if (!buffer) {
+            fail(FAIL_NO_BUFFER);
+        }
+        return buffer;
     }
 } // namespace
 
-audio_player::audio_player() {
+audio_player::audio_player() : cache(decode_cache_arena, DECODE_CACHE_SAMPLES) {
+    set_volume(constants::VOLUME_PERCENT);
+
     const audio_format_t target_format = {
         .sample_freq = AUDIO_SAMPLE_RATE,
         .format = AUDIO_BUFFER_FORMAT,
@@ -83,50 +200,234 @@ audio_player::audio_player() {
     audio_pwm_set_enabled(true);
 }
 
+void audio_player::preempt(const utterance_plan &urgent) {
+    pending.store(&urgent);
+}
+
+bool audio_player::start_cut() {
+    const utterance_plan *next = pending.exchange(nullptr);
+    if (next) {
+        urgent = next;
+        cutting = true;
+        stats.preemptions += 1;
+    }
+    return next != nullptr;
+}
+
+void audio_player::set_volume(uint32_t percent) {
+    gain_q16 = static_cast<int32_t>(std::min<uint32_t>(percent, constants::MAX_VOLUME_PERCENT) * UNITY_GAIN / 100);
+}
+
+void audio_player::set_output_enabled(bool enabled) {
+    audio_pwm_set_enabled(enabled);
+}
+
+audio_buffer_t *audio_player::take_buffer() {
+    audio_buffer_t *buffer = dry ? dry : safely_take_audio_buffer(producer_pool);
+    // Once it is back with us, the consumer is done with any borrowed samples
+    for (auto &l : lent) {
+        if (l.buffer == buffer) {
+            buffer->buffer->bytes = l.bytes;
+            if (l.cached) {
+                cache.release(l.key);
+            }
+            l.buffer = nullptr;
+        }
+    }
+    return buffer;
+}
+
+bool audio_player::lend(audio_buffer_t *buffer, const int16_t *samples) {
+    for (auto &l : lent) {
+        if (!l.buffer) {
+            l.buffer = buffer;
+            l.bytes = buffer->buffer->bytes;
+            // The stream lets go of cache entries as soon as it moves on, and
+            // these samples may not have been played by then
+            l.cached = cache.retain(samples, l.key);
+            // The consumer only ever reads from producer buffers
+            buffer->buffer->bytes = const_cast<uint8_t *>(reinterpret_cast<const uint8_t *>(samples));
+            return true;
+        }
+    }
+    return false;
+}
+
+void audio_player::give_buffer(audio_buffer_t *buffer, uint32_t count, uint32_t start_us, size_t streams_mixed) {
+    const uint32_t busy_us = time_us_32() - start_us;
+    buffer->sample_count = count;
+    stats.samples += count;
+    stats.busy_us += busy_us;
+    stats.max_busy_us = std::max(stats.max_busy_us, busy_us);
+    if (streams_mixed) {
+        auto &mixed = stats.mixed[streams_mixed - 1];
+        mixed.buffers += 1;
+        mixed.samples += count;
+        mixed.busy_us += busy_us;
+    }
+    if (buffer != dry) {
+        if (!stats.first_buffer_us) {
+            stats.first_buffer_us = time_us_32();
+        }
+        give_audio_buffer(producer_pool, buffer);
+    }
+}
+
+void audio_player::finish_buffer(int16_t *samples, uint32_t count) {
+    if (gain_q16 <= UNITY_GAIN && limiter.idle()) {
+        // A single voice at or below unity can't go out of range
+        if (gain_q16 != UNITY_GAIN) {
+            pipeline::gain(samples, count, gain_q16);
+        }
+    } else {
+        pipeline::scale(samples, wide_scratch, count, gain_q16);
+        limiter.process(wide_scratch, samples, count);
+    }
+}
+
+bool audio_player::play_buffer() {
+    size_t active = 0;
+    stream *sole = nullptr;
+    uint8_t top = 0;
+    for (auto &s : streams) {
+        if (s.active() && s.advance(cache)) {
+            active += 1;
+            sole = &s;
+            top = std::max(top, s.priority);
+        }
+    }
+    if (!active) {
+        return false;
+    }
+
+    audio_buffer_t *buffer = take_buffer();
+    const uint32_t start_us = time_us_32();
+    const bool fading = counting.active() && start_cut();
+    for (auto &s : streams) {
+        s.target_q16 = s.priority < top ? DUCK_GAIN : UNITY_GAIN;
+        s.step_q16 = DUCK_STEP;
+        if (s.fresh) {
+            s.gain_q16 = s.target_q16;
+            s.fresh = false;
+        }
+    }
+    if (fading) {
+        counting.target_q16 = 0;
+        counting.step_q16 = FADE_STEP;
+    }
+    uint32_t to_add = std::min(buffer->max_sample_count, uint32_t(pipeline::LENGTH));
+    if (fading) {
+        to_add = std::min(to_add, FADE_SAMPLES);
+    } else if (active == 1) {
+        // On its own, a stream's buffers end where it changes, as if it were a single voice
+        to_add = std::min(to_add, sole->run());
+    }
+
+    int16_t *samples = reinterpret_cast<int16_t *>(buffer->buffer->bytes);
+    size_t streams_mixed = 0;
+    token_decoder *voice = active == 1 && !fading && sole->gain_q16 == UNITY_GAIN && sole->target_q16 == UNITY_GAIN
+        ? sole->alone() : nullptr;
+    if (voice) {
+        // Hand over the sample data itself where nothing needs doing to it,
+        // otherwise decode into the buffer
+        const bool as_recorded = gain_q16 == UNITY_GAIN && limiter.idle();
+        const int16_t *direct = as_recorded ? voice->direct(to_add) : nullptr;
+        if (direct && lend(buffer, direct)) {
+            stats.direct_buffers += 1;
+        } else {
+            if (direct) {
+                memcpy(samples, direct, to_add * sizeof(samples[0]));
+            } else {
+                pipeline::decode(*voice, samples, to_add);
+            }
+            finish_buffer(samples, to_add);
+            stats.copied_buffers += 1;
+        }
+        sole->position += to_add;
+    } else {
+        // Everything else is mixed once on the wide bus
+        memset(wide_scratch, 0, to_add * sizeof(wide_scratch[0]));
+        uint32_t produced = 0;
+        for (auto &s : streams) {
+            if (s.active()) {
+                produced = std::max(produced, s.render(wide_scratch, to_add, cache));
+            }
+        }
+        to_add = produced;
+        streams_mixed = active;
+        if (gain_q16 != UNITY_GAIN) {
+            pipeline::scale(wide_scratch, to_add, gain_q16);
+        }
+        limiter.process(wide_scratch, samples, to_add);
+        stats.copied_buffers += 1;
+    }
+    give_buffer(buffer, to_add, start_us, streams_mixed);
+
+    if (fading) {
+        // What's left of the cut utterance is dropped
+        counting.start(*urgent, PRIORITY_NORMAL);
+    }
+    return true;
+}
+
 audio_player::~audio_player() {
     audio_pwm_set_enabled(false);
     // FIXME: Not going to bother with other cleanup for now
 }
 
-void audio_player::play_samples(std::list<sample_data> &other_samples) {
-    while (!other_samples.empty()) {
-        const auto first_sample = other_samples.front();
-        other_samples.pop_front();
-        decoder sample(first_sample.data, first_sample.size, first_sample.block_size);
-        play_samples(sample, first_sample.join_next, other_samples);
-    }
-}
-
-template <typename Decoder>
-void audio_player::play_samples(Decoder &sample, bool join_next, std::list<sample_data> &other_samples) {
-    if (join_next) {
-        // For most adjacent samples, we overlap them to a degree.
-        // In this case, we play the part that does not overlap first...
-        if (sample.size() > OVERLAP_SAMPLES) {
-            // Play the first part before the overlap
-            const auto to_play = sample.size() - OVERLAP_SAMPLES;
-            process_audio_data(producer_pool, to_play, [&sample]() { return sample.next(); });
-        }
-        // ...and then we get the next sample...
-        sample_data next_sample_data = other_samples.empty() ? sample_data{ nullptr, 0, 0 } : other_samples.front();
-        if (!other_samples.empty()) {
-            other_samples.pop_front();
-        }
-        decoder next_sample(next_sample_data.data, next_sample_data.size, next_sample_data.block_size);
-        // ...and play the overlapping parts from current and next sample...
-        if (!next_sample.empty()) {
-            const auto overlapping_len = std::min(sample.size(), next_sample.size());
-            process_audio_data(producer_pool, overlapping_len, [&sample, &next_sample]() {
-                return mix(sample.next(), next_sample.next());
-            });
-            if (!next_sample.empty()) {
-                // ...and finally, we play the rest of the next sample,
-                // giving it a chance to overlap with following samples.
-                play_samples(next_sample, next_sample_data.join_next, other_samples);
-            }
+bool audio_player::play(const utterance_plan &plan) {
+    cutting = false;
+    counting.start(plan, PRIORITY_NORMAL);
+    // A preemption that arrived while we were idle just replaces the utterance
+    if (start_cut()) {
+        counting.start(*urgent, PRIORITY_NORMAL);
+    }
+    while (counting.active() && play_buffer()) {
+    }
+    return !cutting;
+}
+
+bool audio_player::overlay(const utterance_plan &plan, uint8_t priority) {
+    for (auto &s : streams) {
+        if (&s != &counting && !s.active()) {
+            s.start(plan, priority);
+            stats.overlays += 1;
+            return true;
         }
-        // In the unusual case where we have no next sample, or the next sample was shorter than
-        // the overlap we wanted, we just fall through to play the remainder of the current sample.
     }
-    process_audio_data(producer_pool, sample.size(), [&sample]() { return sample.next(); });
+    return false;
+}
+
+bool audio_player::playing(const utterance_plan &plan) const {
+    for (const auto &s : streams) {
+        if (s.plan == &plan) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void audio_player::drain() {
+    while (play_buffer()) {
+    }
+}
+
+uint32_t audio_player::measure(const utterance_plan *plans, size_t count) {
+    const playback_stats before = stats;
+    stats.max_busy_us = 0;
+    dry = take_buffer();
+    counting.start(plans[0], PRIORITY_NORMAL);
+    for (size_t i = 1; i < count; ++i) {
+        overlay(plans[i], static_cast<uint8_t>(PRIORITY_NORMAL + i));
+    }
+    while (play_buffer()) {
+    }
+    const uint32_t worst_us = stats.max_busy_us;
+
+    // Put back anything lent from the buffer, and return it to the pool unplayed
+    audio_buffer_t *buffer = take_buffer();
+    dry = nullptr;
+    queue_free_audio_buffer(producer_pool, buffer);
+    stats = before;
+    return worst_us;
 }
@@ -5,39 +5,197 @@
 #ifndef AUDIO_PLAYER_H
 #define AUDIO_PLAYER_H
 
+#include "audio.h"
+#include "constants.h"
+#include "decode_cache.h"
+#include "utterance_plan.h"
+
 #include "pico/audio.h"
 
-#include <list>
+#include <atomic>
 #include <cstdint>
-#include <functional>
 
 class audio_player {
 public:
-    struct sample_data {
-        sample_data(const uint8_t *data, size_t size, size_t block_size, bool join_next = false)
-            : data(data), size(size), block_size(block_size), join_next(join_next) { }
-        const uint8_t *data;
-        const size_t size;
-        const size_t block_size;
-        const bool join_next;
-
-        sample_data join(bool join_next) const {
-            return sample_data(data, size, block_size, join_next);
-        }
+    /**
+     * Buffers mixed on the wide bus, and the time spent filling them.
+     */
+    struct mix_stats {
+        uint32_t buffers;
+        uint64_t samples;
+        uint64_t busy_us;
+    };
+
+    /**
+     * Buffers handed to the audio pipeline pointing straight at the sample
+     * data, and buffers that had samples decoded or mixed into them, along
+     * with the time spent filling them.  Mixed buffers are also counted by
+     * the number of streams in them, less one.
+     */
+    struct playback_stats {
+        uint32_t direct_buffers;
+        uint32_t copied_buffers;
+        uint64_t samples;
+        uint64_t busy_us;
+        uint32_t max_busy_us;           // Longest time spent filling one buffer
+        uint32_t first_buffer_us;       // time_us_32() as the first buffer went to the output
+        uint32_t preemptions;
+        uint32_t overlays;
+        mix_stats mixed[constants::MAX_STREAMS];
     };
 
+    /**
+     * Stream priorities.  Counting plays at PRIORITY_NORMAL, and anything
+     * overlaid at a higher priority ducks it.
+     */
+    static constexpr uint8_t PRIORITY_NORMAL = 0;
+    static constexpr uint8_t PRIORITY_STATUS = 1;
+    static constexpr uint8_t PRIORITY_ALERT = 2;
+
 public:
     audio_player();
     ~audio_player();
 
-    void play_samples(std::list<sample_data> &samples_to_play);
+    /**
+     * Play an utterance
+     *
+     * Returns once the whole of plan.duration() has been played.  If preempt()
+     * is called meanwhile, the rest of the plan is dropped and the urgent
+     * utterance is played instead.  Any overlays are mixed in meanwhile, and
+     * carry on from where they got to next time.
+     *
+     * @param plan Utterance to play
+     * @return true if the utterance was played to the end, false if it was cut
+     *         short for another
+     */
+    bool play(const utterance_plan &plan);
+
+    /**
+     * Start an utterance over whatever else is playing
+     *
+     * The utterance gets a stream of its own and is mixed in with the others
+     * while play() or drain() are playing.  While it sounds, streams with a
+     * lower priority are ducked to constants::DUCK_PERCENT, ramping over
+     * constants::DUCK_MS.  The plan must stay valid, and unchanged, for as
+     * long as playing() says it is being played.
+     *
+     * @param plan Utterance to play
+     * @param priority Priority of the new stream, more than PRIORITY_NORMAL
+     *                 to duck the counting
+     * @return false if all constants::MAX_STREAMS streams are busy
+     */
+    bool overlay(const utterance_plan &plan, uint8_t priority);
+
+    /**
+     * Play until every overlaid utterance has finished
+     */
+    void drain();
+
+    /**
+     * Check whether an utterance is still being played
+     *
+     * @param plan Utterance given to play() or overlay()
+     * @return true until its last sample has been mixed
+     */
+    bool playing(const utterance_plan &plan) const;
+
+    /**
+     * Time filling buffers for utterances, without playing them
+     *
+     * The first utterance is filled as play() would, with the others overlaid
+     * at increasing priorities, as fast as the buffers can be filled.  Nothing
+     * reaches the output, and the playback stats are left as they were.  Only
+     * call while nothing is playing.
+     *
+     * @param plans Utterances to mix, at most constants::MAX_STREAMS
+     * @param count Number of utterances
+     * @return Longest time spent filling one buffer, in microseconds
+     */
+    uint32_t measure(const utterance_plan *plans, size_t count);
+
+    /**
+     * Cut the current utterance short for an urgent one
+     *
+     * Only the utterance from play() is cut, overlays carry on.  The current
+     * utterance fades out over PREEMPT_FADE_MS in the next buffer filled, and
+     * play() then plays `urgent` in its place.  If nothing is playing,
+     * `urgent` replaces the next utterance.  Safe to call from an interrupt
+     * handler or the other core.  The plan must stay valid until it has been
+     * played.
+     *
+     * Worst-case latency, from this call to the first sample of `urgent`
+     * reaching the output, is everything already queued for output plus the
+     * fade: AUDIO_BUFFER_COUNT * AUDIO_BUFFER_SAMPLE_LENGTH samples, plus
+     * PREEMPT_FADE_MS.  About 142ms with the default configuration.  The
+     * current utterance starts fading within the first part.
+     *
+     * @param urgent Utterance to play instead
+     */
+    void preempt(const utterance_plan &urgent);
+
+    /**
+     * Set the master volume
+     *
+     * Takes effect from the next audio buffer.
+     *
+     * @param percent Volume in percent of the recorded level, at most
+     *                constants::MAX_VOLUME_PERCENT
+     */
+    void set_volume(uint32_t percent);
+
+    /**
+     * Turn the PWM output on or off
+     *
+     * Only call between utterances, once the output has drained.  With the
+     * output off, clk_sys can be lowered without the PWM carrier coming down
+     * into the audible range.
+     *
+     * @param enabled true to turn the output on
+     */
+    void set_output_enabled(bool enabled);
+
+    /**
+     * Hit rates etc for the decoded audio cache.
+     */
+    const decode_cache::stats &cache_stats() const { return cache.get_stats(); }
+
+    /**
+     * How many buffers were played without copying.
+     */
+    const playback_stats &get_playback_stats() const { return stats; }
 
 private:
     audio_buffer_pool_t *producer_pool = nullptr;
+    decode_cache cache;
+    playback_stats stats = {};
+    int32_t gain_q16;
+
+    // Preemption of the PRIORITY_NORMAL stream
+    std::atomic<const utterance_plan *> pending{ nullptr };
+    const utterance_plan *urgent = nullptr;
+    bool cutting = false;
+
+    // Buffers lent out pointing at sample data, and their own storage to put
+    // back.  Decoded audio lent from the cache is kept locked until then.
+    struct lent_buffer {
+        audio_buffer_t *buffer;
+        uint8_t *bytes;
+        bool cached;
+        uint8_t key;
+    };
+    lent_buffer lent[AUDIO_BUFFER_COUNT] = {};
+
+    // Buffer filled over and over by measure(), instead of being played
+    audio_buffer_t *dry = nullptr;
 
 private:
-    template <typename Decoder>
-    void play_samples(Decoder &sample, bool join_next, std::list<sample_data> &other_samples);
+    audio_buffer_t *take_buffer();
+    bool lend(audio_buffer_t *buffer, const int16_t *samples);
+
+    void give_buffer(audio_buffer_t *buffer, uint32_t count, uint32_t start_us, size_t streams_mixed);
+    void finish_buffer(int16_t *samples, uint32_t count);
+    bool start_cut();
+    bool play_buffer();
 };
 
 #endif // AUDIO_PLAYER_H
@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Battery Voltage Readings
+ */
+
+#include "battery_monitor.h"
+#include "constants.h"
+
+#include "hardware/adc.h"
+#include "hardware/irq.h"
+
+namespace {
+    constexpr uint32_t DISCARD_SAMPLES = 3;         // The first few read low
+    constexpr uint32_t SAMPLES = 16;
+    constexpr uint32_t FIFO_THRESHOLD = 4;
+    // VSYS is divided by 3 on the way to the ADC, with a 3.3V reference
+    constexpr uint32_t VSYS_DIVIDER = 3;
+    constexpr uint32_t ADC_REFERENCE_MV = 3300;
+    constexpr uint32_t ADC_RANGE = 1 << 12;
+
+    volatile bool busy = false;
+    volatile bool done = false;
+    volatile uint32_t result = 0;
+    uint32_t to_discard = 0;
+    uint32_t taken = 0;
+    uint32_t sum = 0;
+
+    void on_adc_fifo() {
+        while (!adc_fifo_is_empty()) {
+            const uint16_t sample = adc_fifo_get();
+            if (to_discard) {
+                to_discard -= 1;
+                continue;
+            }
+            sum += sample;
+            if (++taken == SAMPLES) {
+                adc_run(false);
+                adc_fifo_drain();
+                result = sum;
+                done = true;
+                busy = false;
+                return;
+            }
+        }
+    }
+}
+
+namespace battery_monitor {
+    void init() {
+        adc_init();
+        adc_gpio_init(constants::PICO_VSYS_PIN);
+        adc_select_input(constants::PICO_VSYS_PIN - constants::PICO_FIRST_ADC_PIN);
+        adc_fifo_setup(true, false, FIFO_THRESHOLD, false, false);
+        irq_set_exclusive_handler(ADC_IRQ_FIFO, on_adc_fifo);
+        adc_irq_set_enabled(true);
+        irq_set_enabled(ADC_IRQ_FIFO, true);
+    }
+
+    void start() {
+        if (busy) {
+            return;
+        }
+        to_discard = DISCARD_SAMPLES;
+        taken = 0;
+        sum = 0;
+        busy = true;
+        adc_run(true);
+    }
+
+    bool ready() {
+        return done;
+    }
+
+    uint32_t millivolts() {
+        done = false;
+        return result * VSYS_DIVIDER * ADC_REFERENCE_MV / (ADC_RANGE * SAMPLES);
+    }
+}
@@ -0,0 +1,43 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Battery Voltage Readings
+ */
+
+#ifndef BATTERY_MONITOR_H
+#define BATTERY_MONITOR_H
+
+#include <cstdint>
+
+/**
+ * Reads the battery voltage on VSYS in the background.
+ *
+ * start() sets the ADC converting back to back.  The FIFO interrupt
+ * collects the samples and stops the ADC once it has enough, so nothing
+ * waits on the ADC.  A reading takes well under a millisecond.
+ */
+namespace battery_monitor {
+    /**
+     * Set up the ADC and its interrupt.
+     */
+    void init();
+
+    /**
+     * Start taking a reading, unless one is already being taken.
+     */
+    void start();
+
+    /**
+     * Check whether a reading has finished since the last millivolts().
+     */
+    bool ready();
+
+    /**
+     * Take the last reading.
+     *
+     * @return VSYS in millivolts
+     */
+    uint32_t millivolts();
+}
+
+#endif // BATTERY_MONITOR_H
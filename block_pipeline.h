@@ -0,0 +1,166 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Block Audio Pipeline
+ */
+
+#ifndef BLOCK_PIPELINE_H
+#define BLOCK_PIPELINE_H
+
+#include "dsp_kernels.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Stages for producing audio a whole buffer at a time.
+ *
+ * Each stage works on a span of up to BLOCK samples: decode the sources into
+ * spans, add them onto a wide mix bus, apply the master gain, bring anything
+ * out of range back with a soft_limiter, then hand the result over as an
+ * output buffer.  BLOCK is the audio buffer length, and full buffers are
+ * processed with loops of that constant length so that the compiler can
+ * unroll them.  Only the last, short, buffer of a run takes the variable
+ * length path.
+ *
+ * Decoding gives bit for bit what calling next() on each decoder would give,
+ * including silence past the end of a decoder.
+ */
+template <size_t BLOCK>
+struct block_pipeline {
+    static constexpr size_t LENGTH = BLOCK;
+    static constexpr int32_t UNITY = 1 << 16;   // Unity gain in Q16
+
+    /**
+     * Decode the next count samples from a decoder
+     *
+     * Pads with silence if the decoder runs out.
+     *
+     * @param source Decoder to read from
+     * @param out Where to write the samples
+     * @param count Number of samples to write, at most BLOCK
+     */
+    template <typename Decoder>
+    static void decode(Decoder &source, int16_t *out, size_t count) {
+        const size_t n = source.read(out, count);
+        for (size_t i = n; i < count; ++i) {
+            out[i] = 0;
+        }
+    }
+
+    /**
+     * Scale a span by the master gain, saturating at full scale
+     *
+     * @param inout Samples to scale in place
+     * @param count Number of samples, at most BLOCK
+     * @param gain_q16 Gain, 65536 is unity
+     */
+    static void gain(int16_t *inout, size_t count, int32_t gain_q16) {
+        if (count == BLOCK) {
+            dsp_kernels::gain(inout, BLOCK, gain_q16);
+        } else {
+            dsp_kernels::gain(inout, count, gain_q16);
+        }
+    }
+
+    /**
+     * Scale a span by the master gain into wide samples for the limiter
+     *
+     * @param in Samples to scale
+     * @param out Where to write the scaled samples
+     * @param count Number of samples, at most BLOCK
+     * @param gain_q16 Gain, 65536 is unity
+     */
+    static void scale(const int16_t *in, int32_t *out, size_t count, int32_t gain_q16) {
+        if (count == BLOCK) {
+            scale_samples(in, out, BLOCK, gain_q16);
+        } else {
+            scale_samples(in, out, count, gain_q16);
+        }
+    }
+
+    /**
+     * Scale wide samples in place by the master gain
+     *
+     * @param inout Samples to scale in place
+     * @param count Number of samples, at most BLOCK
+     * @param gain_q16 Gain, 65536 is unity
+     */
+    static void scale(int32_t *inout, size_t count, int32_t gain_q16) {
+        if (count == BLOCK) {
+            scale_wide(inout, BLOCK, gain_q16);
+        } else {
+            scale_wide(inout, count, gain_q16);
+        }
+    }
+
+    /**
+     * Add a span into a wide mix bus, with a gain ramping towards a target
+     *
+     * The gain moves by step_q16 per sample until it reaches target_q16, and
+     * is left where it got to for the next span.  Nothing is clipped, that is
+     * left to the limiter once everything has been mixed.
+     *
+     * @param in Samples to add
+     * @param bus Wide samples to add them to
+     * @param count Number of samples, at most BLOCK
+     * @param gain_q16 Gain at the first sample, 65536 is unity, updated
+     * @param target_q16 Gain to ramp towards
+     * @param step_q16 Largest change in gain per sample, more than zero
+     */
+    static void accumulate(const int16_t *in, int32_t *bus, size_t count, int32_t &gain_q16, int32_t target_q16, int32_t step_q16) {
+        if (gain_q16 != target_q16) {
+            for (size_t i = 0; i < count; ++i) {
+                if (gain_q16 < target_q16) {
+                    gain_q16 = gain_q16 + step_q16 < target_q16 ? gain_q16 + step_q16 : target_q16;
+                } else {
+                    gain_q16 = gain_q16 - step_q16 > target_q16 ? gain_q16 - step_q16 : target_q16;
+                }
+                bus[i] += apply(in[i], gain_q16);
+            }
+        } else if (gain_q16 == UNITY) {
+            if (count == BLOCK) {
+                add_samples(in, bus, BLOCK);
+            } else {
+                add_samples(in, bus, count);
+            }
+        } else {
+            if (count == BLOCK) {
+                add_scaled(in, bus, BLOCK, gain_q16);
+            } else {
+                add_scaled(in, bus, count, gain_q16);
+            }
+        }
+    }
+
+private:
+    static inline __attribute__((always_inline)) int32_t apply(int32_t sample, int32_t gain_q16) {
+        return static_cast<int32_t>((static_cast<int64_t>(sample) * gain_q16) >> 16);
+    }
+
+    static inline __attribute__((always_inline)) void scale_samples(const int16_t *in, int32_t *out, size_t count, int32_t gain_q16) {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = apply(in[i], gain_q16);
+        }
+    }
+
+    static inline __attribute__((always_inline)) void scale_wide(int32_t *inout, size_t count, int32_t gain_q16) {
+        for (size_t i = 0; i < count; ++i) {
+            inout[i] = apply(inout[i], gain_q16);
+        }
+    }
+
+    static inline __attribute__((always_inline)) void add_samples(const int16_t *in, int32_t *bus, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            bus[i] += in[i];
+        }
+    }
+
+    static inline __attribute__((always_inline)) void add_scaled(const int16_t *in, int32_t *bus, size_t count, int32_t gain_q16) {
+        for (size_t i = 0; i < count; ++i) {
+            bus[i] += apply(in[i], gain_q16);
+        }
+    }
+};
+
+#endif // BLOCK_PIPELINE_H
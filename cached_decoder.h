@@ -0,0 +1,167 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Decoder With Decoded Audio Cache
+ */
+
+#ifndef CACHED_DECODER_H
+#define CACHED_DECODER_H
+
+#include "audio.h"
+#include "decode_cache.h"
+#include "voice_decoder.h"
+
+#include <cstring>
+
+/**
+ * Decodes a token through a decode_cache.
+ *
+ * On a hit the samples are copied straight out of the cache.  On a miss the
+ * token is decoded as usual, and the samples are also written to the cache
+ * for next time.  Uncompressed PCM is not worth caching, so it is always
+ * decoded directly, as is anything the cache has no room for.
+ */
+class cached_decoder {
+public:
+    /**
+     * Constructor
+     *
+     * @param cache Cache to use
+     * @param asset Token to decode
+     */
+    cached_decoder(decode_cache &cache, const audio::sample_data &asset)
+        : cache(cache), key(asset.token), source(asset.data, asset.size, asset.samples_per_block, asset.codec) {
+        if (!asset.data || asset.codec == voice::CODEC_PCM16) {
+            return;
+        }
+        size_t count;
+        if ((cached = cache.find(key, count)) != nullptr) {
+            mode = HIT;
+            remaining = count;
+        } else if ((fill = cache.reserve(key, source.size())) != nullptr) {
+            mode = FILL;
+            fill_remaining = source.size();
+        } else {
+            cache.note_uncached();
+        }
+    }
+
+    ~cached_decoder() {
+        if (mode == HIT) {
+            cache.release(key);
+        } else if (mode == FILL) {
+            finish_fill();
+        }
+    }
+
+    cached_decoder(const cached_decoder &) = delete;
+    cached_decoder &operator=(const cached_decoder &) = delete;
+
+    /**
+     * Decode and return a single sample
+     *
+     * @return Next 16-bit PCM sample, or 0 if no more data available
+     */
+    int16_t next() {
+        int16_t sample = 0;
+        read(&sample, 1);
+        return sample;
+    }
+
+    /**
+     * Decode a block of samples
+     *
+     * @param out Where to write the samples
+     * @param count Maximum number of samples to write
+     * @return Number of samples written
+     */
+    size_t read(int16_t *out, size_t count) {
+        if (mode == HIT) {
+            if (count > remaining) {
+                count = remaining;
+            }
+            memcpy(out, cached, count * sizeof(out[0]));
+            cached += count;
+            remaining -= count;
+            return count;
+        }
+        const size_t n = source.read(out, count);
+        if (mode == FILL) {
+            const size_t keep = n < fill_remaining ? n : fill_remaining;
+            memcpy(fill, out, keep * sizeof(out[0]));
+            fill += keep;
+            fill_remaining -= keep;
+            filled += keep;
+            if (source.empty()) {
+                finish_fill();
+            }
+        }
+        return n;
+    }
+
+    /**
+     * Borrow a block of samples in place
+     *
+     * Possible for cache hits, and for uncompressed PCM.  Cached samples only
+     * stay put while this decoder holds the entry locked.  To keep them past
+     * that, lock the entry again with decode_cache::retain().
+     *
+     * @param count Number of samples wanted
+     * @return Pointer to the next count samples, or nullptr if they cannot be
+     *         borrowed, in which case nothing is consumed
+     */
+    const int16_t *direct(size_t count) {
+        if (mode == HIT) {
+            if (count > remaining) {
+                return nullptr;
+            }
+            const int16_t *samples = cached;
+            cached += count;
+            remaining -= count;
+            return samples;
+        }
+        return mode == DIRECT ? source.direct(count) : nullptr;
+    }
+
+    /**
+     * Check if there is more data to decode
+     *
+     * @return true if more data is available, false if decoding is complete
+     */
+    bool empty() const { return mode == HIT ? remaining == 0 : source.empty(); }
+
+    /**
+     * Get the number of samples remaining to be decoded
+     *
+     * @return Number of 16-bit PCM samples that will be produced from remaining data
+     */
+    size_t size() const { return mode == HIT ? remaining : source.size(); }
+
+private:
+    enum mode_t { DIRECT, HIT, FILL };
+
+    decode_cache &cache;
+    const uint8_t key;
+    voice_decoder source;
+    mode_t mode = DIRECT;
+
+    // Cache hit
+    const int16_t *cached = nullptr;
+    size_t remaining = 0;
+
+    // Cache miss, filling the cache as we go
+    int16_t *fill = nullptr;
+    size_t fill_remaining = 0;
+    size_t filled = 0;
+
+    void finish_fill() {
+        if (source.empty()) {
+            cache.commit(key, filled);
+        } else {
+            cache.abandon(key);
+        }
+        mode = DIRECT;
+    }
+};
+
+#endif // CACHED_DECODER_H
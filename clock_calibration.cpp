@@ -0,0 +1,81 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * System Clock Selection
+ */
+
+#include "clock_calibration.h"
+#include "constants.h"
+#include "telemetry.h"
+#include "audio_player.h"
+#include "utterance_plan.h"
+#include "number_to_speech.h"
+
+#include "hardware/clocks.h"
+#include "hardware/pio.h"
+#include "pico/audio_pwm.h"
+#include "pico/stdlib.h"
+
+#include <algorithm>
+
+namespace {
+    // Long numbers, with their joins falling in different places
+    constexpr uint32_t NUMBERS[] = { 3777777777u, 2777777777u, 1777777777u };
+    static_assert(constants::MAX_STREAMS <= sizeof(NUMBERS) / sizeof(NUMBERS[0]), "Need a number for each stream");
+
+    // Time to play one buffer, and so to fill the next
+    constexpr uint32_t BUFFER_US = static_cast<uint32_t>(
+        static_cast<uint64_t>(AUDIO_BUFFER_SAMPLE_LENGTH) * 1000000 / AUDIO_SAMPLE_RATE);
+
+    static_assert(constants::MAX_CLOCK_KHZ % constants::PWM_CLOCK_KHZ == 0, "PWM is divided down by whole numbers");
+
+    uint32_t chosen_khz = constants::PWM_CLOCK_KHZ;
+
+    void set_clock(uint32_t khz) {
+        if (khz == constants::PWM_CLOCK_KHZ) {
+            set_sys_clock_48mhz();
+        } else {
+            set_sys_clock_khz(khz, true);
+        }
+    }
+}
+
+namespace clock_calibration {
+    void calibrate(audio_player &player) {
+        static utterance_plan plans[constants::MAX_STREAMS];
+        for (size_t i = 0; i < constants::MAX_STREAMS; ++i) {
+            plans[i].compile(number_to_speech(NUMBERS[i]));
+        }
+        player.set_volume(constants::MAX_VOLUME_PERCENT);
+        const uint32_t worst_us = player.measure(plans, constants::MAX_STREAMS);
+        player.set_volume(constants::VOLUME_PERCENT);
+
+        telemetry::clock_budget budget = {};
+        const uint64_t measured_khz = clock_get_hz(clk_sys) / 1000;
+        budget.worst_cycles = static_cast<uint32_t>(worst_us * measured_khz / 1000);
+        budget.budget_cycles = budget.worst_cycles * (100 + constants::CLOCK_MARGIN_PERCENT) / 100;
+        budget.needed_khz = static_cast<uint32_t>(
+            (static_cast<uint64_t>(budget.budget_cycles) * 1000 + BUFFER_US - 1) / BUFFER_US);
+        // If even the fastest clock is short, run as fast as it will go
+        const uint32_t steps = (budget.needed_khz + constants::PWM_CLOCK_KHZ - 1) / constants::PWM_CLOCK_KHZ;
+        chosen_khz = std::min<uint32_t>(std::max<uint32_t>(steps, 1) * constants::PWM_CLOCK_KHZ,
+                                        constants::MAX_CLOCK_KHZ);
+        budget.clock_khz = chosen_khz;
+        budget.deadline_cycles = static_cast<uint32_t>(static_cast<uint64_t>(BUFFER_US) * chosen_khz / 1000);
+        telemetry::set_clock_budget(budget);
+
+        if (chosen_khz != measured_khz) {
+            // Both the carrier and the sample rate scale with clk_sys, so the
+            // state machine is slowed back down to the rate it was set up for
+            player.set_output_enabled(false);
+            set_clock(chosen_khz);
+            pio_sm_set_clkdiv_int_frac(pio_get_instance(PICO_AUDIO_PWM_PIO), default_mono_channel_config.core.pio_sm,
+                                       chosen_khz / constants::PWM_CLOCK_KHZ, 0);
+            player.set_output_enabled(true);
+        }
+    }
+
+    void restore_clock() {
+        set_clock(chosen_khz);
+    }
+}
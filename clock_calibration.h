@@ -0,0 +1,41 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * System Clock Selection
+ */
+
+#ifndef CLOCK_CALIBRATION_H
+#define CLOCK_CALIBRATION_H
+
+class audio_player;
+
+/**
+ * Picks clk_sys from what filling the audio buffers actually costs.
+ *
+ * Each buffer has to be filled in the time the one before it takes to play.
+ * calibrate() fills buffers for the heaviest case the player has, with every
+ * stream mixed, cross-fades and the limiter going, and takes the longest any
+ * one buffer took.  With constants::CLOCK_MARGIN_PERCENT added, that gives
+ * the clock needed.  The PWM output can only keep AUDIO_SAMPLE_RATE at
+ * multiples of constants::PWM_CLOCK_KHZ, so the lowest of those that is fast
+ * enough is chosen, and the output's divider set to match.
+ */
+namespace clock_calibration {
+    /**
+     * Measure, move clk_sys to the chosen clock and record the result with
+     * telemetry::set_clock_budget().  Call at boot, before anything has been
+     * played.  Leaves the volume at constants::VOLUME_PERCENT.
+     *
+     * @param player Player to measure, with its output set up for
+     *               constants::PWM_CLOCK_KHZ
+     */
+    void calibrate(audio_player &player);
+
+    /**
+     * Put clk_sys back to the clock calibrate() chose, after it has been
+     * lowered with the output off.
+     */
+    void restore_clock();
+}
+
+#endif // CLOCK_CALIBRATION_H
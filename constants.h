@@ -9,10 +9,72 @@
 
 #include <cstddef>
 
+#ifndef NUMBERBOX_FAST_BOOT
+#define NUMBERBOX_FAST_BOOT 0
+#endif
+
+#ifndef NUMBERBOX_DECODE_CACHE_BYTES
+#define NUMBERBOX_DECODE_CACHE_BYTES 0
+#endif
+
 namespace constants {
     // Audio configuration
     constexpr size_t SILENCE_MS = 300;
     constexpr size_t OVERLAP_MS = 200;
+    // Speaking speed in percent.  Anything over 100 uses WSOLA time compression
+    // to say numbers faster without raising the pitch.  Maximum 200.
+    constexpr size_t SPEED_PERCENT = 100;
+    // Output volume in percent of the recorded level, and the most that
+    // audio_player::set_volume() will allow.  Lower volumes draw less current
+    // in the amplifier.  Over 100 is louder, with the peaks softly limited.
+    constexpr size_t VOLUME_PERCENT = 100;
+    constexpr size_t MAX_VOLUME_PERCENT = 200;
+    // Fade out time for an utterance cut short by audio_player::preempt()
+    constexpr size_t PREEMPT_FADE_MS = 3;
+    // Streams that audio_player can mix at once: the counting plus overlays
+    // such as battery or diagnostic announcements.  While an overlay plays,
+    // lower priority streams are ducked to DUCK_PERCENT over DUCK_MS.
+    constexpr size_t MAX_STREAMS = 3;
+    constexpr size_t DUCK_PERCENT = 30;
+    constexpr size_t DUCK_MS = 50;
+    // Flash sectors at the end of flash reserved for the counter log, and how
+    // many numbers are counted between writes to it.  Losing power repeats at
+    // most COUNTER_SAVE_INTERVAL numbers.
+    constexpr size_t COUNTER_LOG_SECTORS = 8;
+    constexpr size_t COUNTER_SAVE_INTERVAL = 16;
+    // Battery voltages, read from VSYS in the silence, below which
+    // power_governor turns the volume down, then also lengthens the silence
+    // and warns, and then stops counting until the battery is charged.  It
+    // only moves back up once the voltage is BATTERY_HYSTERESIS_MV over.
+    constexpr size_t BATTERY_SAVING_MV = 3700;
+    constexpr size_t BATTERY_LOW_MV = 3600;
+    constexpr size_t BATTERY_CRITICAL_MV = 3450;
+    constexpr size_t BATTERY_HYSTERESIS_MV = 60;
+    // clk_sys is chosen at boot as the lowest multiple of PWM_CLOCK_KHZ, up to
+    // MAX_CLOCK_KHZ, at which the heaviest buffer measured is filled in time
+    // with CLOCK_MARGIN_PERCENT to spare.  The PWM output gives
+    // AUDIO_SAMPLE_RATE at PWM_CLOCK_KHZ, and is divided down to match.
+    constexpr size_t PWM_CLOCK_KHZ = 48000;
+    constexpr size_t MAX_CLOCK_KHZ = 144000;
+    constexpr size_t CLOCK_MARGIN_PERCENT = 50;
+    // Start speaking sooner after a reset.  The confidence flash runs from a
+    // timer alongside setup, and pinning tokens in SRAM, choosing the clock
+    // and the first battery reading wait until the first number has been
+    // said.  Set with the NUMBERBOX_FAST_BOOT CMake option.
+    constexpr bool FAST_BOOT = NUMBERBOX_FAST_BOOT;
+    // Least headroom left on core 0's stack before numbers_pwm stops with
+    // FAIL_STACK_LOW, rather than overrun it.
+    constexpr size_t STACK_HEADROOM_BYTES = 256;
+    // Utterances said before any heap allocation stops numbers_pwm with
+    // FAIL_STEADY_STATE_ALLOCATION, see alloc_profiler.h.  Zero allows them.
+    constexpr size_t STEADY_STATE_UTTERANCES = 8;
+    // SRAM set aside at boot for the most frequently spoken tokens, which are
+    // then played without going through the XIP cache.  Zero disables.
+    constexpr size_t VOICE_SRAM_BYTES = 64 * 1024;
+    // SRAM for decoded audio of compressed tokens, so that the same tokens are
+    // not decoded again for every number.  Unused for 16 bit PCM voices, so
+    // none by default.  Set with the NUMBERBOX_DECODE_CACHE_BYTES CMake option.
+    constexpr size_t DECODE_CACHE_BYTES = NUMBERBOX_DECODE_CACHE_BYTES;
 
     // GPIO pins
     constexpr size_t USER_LED_PIN = 25;
@@ -0,0 +1,183 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Flash Log for the Counter
+ */
+
+#include "counter_store.h"
+
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+
+#include <cstring>
+
+namespace {
+    constexpr uint32_t MAGIC = 0x4c43424e;      // "NBCL"
+    constexpr size_t WORD_BYTES = sizeof(uint32_t);
+    constexpr size_t RECORD_BYTES = 2 * WORD_BYTES;
+    constexpr size_t SLOTS = FLASH_SECTOR_SIZE / RECORD_BYTES;
+    constexpr size_t HEADER_SLOTS = 2;          // Magic, sequence, ~sequence, spare
+    constexpr size_t SLOTS_PER_PAGE = FLASH_PAGE_SIZE / RECORD_BYTES;
+    constexpr uint32_t BLANK = 0xffffffff;
+
+    static_assert(HEADER_SLOTS < SLOTS_PER_PAGE, "Header and first record are programmed together");
+
+    void put_word(uint8_t *page, size_t slot, size_t word, uint32_t value) {
+        memcpy(page + (slot % SLOTS_PER_PAGE) * RECORD_BYTES + word * WORD_BYTES, &value, sizeof(value));
+    }
+}
+
+counter_store::counter_store(const uint8_t *flash, uint32_t offset, size_t sectors)
+    : flash(flash), offset(offset), sectors(sectors) {
+}
+
+bool counter_store::load(uint32_t &value) {
+    have_current = false;
+    next_erased = false;
+    // Search the sectors newest first, as a torn first record in the newest
+    // one leaves the latest value in the one before
+    uint32_t older_than = BLANK;
+    while (true) {
+        bool found = false;
+        size_t newest = 0;
+        uint32_t newest_sequence = 0;
+        for (size_t sector = 0; sector < sectors; ++sector) {
+            uint32_t sequence;
+            if (header_valid(sector, sequence) && sequence < older_than && (!found || sequence > newest_sequence)) {
+                found = true;
+                newest = sector;
+                newest_sequence = sequence;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+
+        const size_t end = first_blank_slot(newest);
+        if (!have_current) {
+            have_current = true;
+            current = newest;
+            sequence = newest_sequence;
+            slot = end;
+        }
+        for (size_t i = end; i-- > HEADER_SLOTS;) {
+            if (record_valid(newest, i, value)) {
+                return true;
+            }
+        }
+        older_than = newest_sequence;
+    }
+}
+
+void counter_store::save(uint32_t value) {
+    pending = true;
+    pending_value = value;
+}
+
+bool counter_store::flush() {
+    const size_t next = have_current ? (current + 1) % sectors : 0;
+    if (!pending) {
+        // Get the next sector ready while the current one still has room
+        if (have_current && !next_erased && slot >= (SLOTS + HEADER_SLOTS) / 2) {
+            next_erased = true;
+            if (!sector_blank(next)) {
+                erase(next);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint8_t page[FLASH_PAGE_SIZE];
+    memset(page, 0xff, sizeof(page));
+    if (have_current && slot < SLOTS) {
+        put_word(page, slot, 0, pending_value);
+        put_word(page, slot, 1, ~pending_value);
+        program(current, slot / SLOTS_PER_PAGE, page);
+        slot += 1;
+    } else {
+        if (!next_erased && !sector_blank(next)) {
+            erase(next);
+            next_erased = true;
+            return true;
+        }
+        // Header and first record in one program, so the old sector keeps the
+        // latest value until both are there
+        const uint32_t next_sequence = have_current ? sequence + 1 : 1;
+        put_word(page, 0, 0, MAGIC);
+        put_word(page, 0, 1, next_sequence);
+        put_word(page, 1, 0, ~next_sequence);
+        put_word(page, HEADER_SLOTS, 0, pending_value);
+        put_word(page, HEADER_SLOTS, 1, ~pending_value);
+        program(next, 0, page);
+        have_current = true;
+        current = next;
+        sequence = next_sequence;
+        slot = HEADER_SLOTS + 1;
+        next_erased = false;
+    }
+    pending = false;
+    counts.records += 1;
+    return true;
+}
+
+uint32_t counter_store::sector_offset(size_t sector) const {
+    return offset + static_cast<uint32_t>(sector * FLASH_SECTOR_SIZE);
+}
+
+uint32_t counter_store::read_word(size_t sector, size_t slot, size_t word) const {
+    uint32_t value;
+    memcpy(&value, flash + sector_offset(sector) + slot * RECORD_BYTES + word * WORD_BYTES, sizeof(value));
+    return value;
+}
+
+bool counter_store::header_valid(size_t sector, uint32_t &sequence) const {
+    sequence = read_word(sector, 0, 1);
+    return read_word(sector, 0, 0) == MAGIC && read_word(sector, 1, 0) == ~sequence;
+}
+
+bool counter_store::record_valid(size_t sector, size_t slot, uint32_t &value) const {
+    value = read_word(sector, slot, 0);
+    return read_word(sector, slot, 1) == ~value;
+}
+
+bool counter_store::slot_blank(size_t sector, size_t slot) const {
+    return read_word(sector, slot, 0) == BLANK && read_word(sector, slot, 1) == BLANK;
+}
+
+bool counter_store::sector_blank(size_t sector) const {
+    for (size_t i = 0; i < SLOTS; ++i) {
+        if (!slot_blank(sector, i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t counter_store::first_blank_slot(size_t sector) const {
+    // Records are written in order, so the written slots come first
+    size_t lo = HEADER_SLOTS;
+    size_t hi = SLOTS;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (slot_blank(sector, mid)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+void counter_store::erase(size_t sector) {
+    const uint32_t interrupts = save_and_disable_interrupts();
+    flash_range_erase(sector_offset(sector), FLASH_SECTOR_SIZE);
+    restore_interrupts(interrupts);
+    counts.erases += 1;
+}
+
+void counter_store::program(size_t sector, size_t page, const uint8_t *data) {
+    const uint32_t interrupts = save_and_disable_interrupts();
+    flash_range_program(sector_offset(sector) + static_cast<uint32_t>(page * FLASH_PAGE_SIZE), data, FLASH_PAGE_SIZE);
+    restore_interrupts(interrupts);
+}
@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Flash Log for the Counter
+ */
+
+#ifndef COUNTER_STORE_H
+#define COUNTER_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Keeps the counter in flash so that it survives losing power.
+ *
+ * Values are appended as 8 byte records to a log in a ring of reserved
+ * sectors, each starting with a header holding a sequence number.  A record
+ * holds the value and its complement.  A torn program can only clear bits
+ * that should have been cleared, so it can never leave a record, or header,
+ * that checks out.  When a sector fills, the log moves on to the next one in
+ * the ring, so every sector is erased once per lap.  The sector after the
+ * current one is erased in advance, once the current one is half full, and
+ * the sector being left keeps the latest value until the first record lands
+ * in the new one.
+ *
+ * The latest value is found at boot by reading the headers and searching the
+ * newest sector for its last record, a dozen or so reads.
+ *
+ * save() only notes the value.  flush() then does at most one erase or page
+ * program.  The caller should only call flush() when nothing is being read
+ * from flash.  Erasing or programming stops XIP reads, and the voice data
+ * may be played straight from flash.
+ */
+class counter_store {
+public:
+    struct stats {
+        uint32_t records;       // Records programmed
+        uint32_t erases;        // Sectors erased
+    };
+
+    /**
+     * Constructor
+     *
+     * @param flash Where flash offset 0 can be read
+     * @param offset Flash offset of the first reserved sector
+     * @param sectors Number of sectors reserved, at least 2
+     */
+    counter_store(const uint8_t *flash, uint32_t offset, size_t sectors);
+
+    /**
+     * Find the latest value in the log, and where to write the next one
+     *
+     * @param value Set to the latest value
+     * @return false if the log holds no value
+     */
+    bool load(uint32_t &value);
+
+    /**
+     * Queue a value for the next flush(), replacing any not yet written.
+     */
+    void save(uint32_t value);
+
+    /**
+     * Do the next flash operation, if there is one
+     *
+     * Programs the queued value, or erases the sector the log moves on to
+     * next.  Interrupts are disabled while the flash is busy.
+     *
+     * @return true if the flash was erased or programmed
+     */
+    bool flush();
+
+    /**
+     * Check whether the last value saved is in flash.
+     */
+    bool saved() const { return !pending; }
+
+    const stats &get_stats() const { return counts; }
+
+private:
+    const uint8_t *flash;
+    const uint32_t offset;
+    const size_t sectors;
+
+    // Where the log is up to.  No current sector until the first write.
+    bool have_current = false;
+    size_t current = 0;
+    uint32_t sequence = 0;
+    size_t slot = 0;
+    bool next_erased = false;
+
+    bool pending = false;
+    uint32_t pending_value = 0;
+    stats counts = {};
+
+    uint32_t sector_offset(size_t sector) const;
+    uint32_t read_word(size_t sector, size_t slot, size_t word) const;
+    bool header_valid(size_t sector, uint32_t &sequence) const;
+    bool record_valid(size_t sector, size_t slot, uint32_t &value) const;
+    bool slot_blank(size_t sector, size_t slot) const;
+    bool sector_blank(size_t sector) const;
+    size_t first_blank_slot(size_t sector) const;
+
+    void erase(size_t sector);
+    void program(size_t sector, size_t page, const uint8_t *data);
+};
+
+#endif // COUNTER_STORE_H
@@ -0,0 +1,173 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Decoded Audio Cache
+ */
+
+#include "decode_cache.h"
+
+#include <cstring>
+
+const int16_t *decode_cache::find(uint8_t key, size_t &count) {
+    count_use(key);
+    entry *e = lookup(key);
+    if (!e || !e->complete) {
+        return nullptr;
+    }
+    e->locks += 1;
+    e->last_used = ++clock;
+    counters.hits += 1;
+    count = e->length;
+    return arena + e->offset;
+}
+
+int16_t *decode_cache::reserve(uint8_t key, size_t count) {
+    if (count == 0 || count > arena_samples || entry_count == MAX_ENTRIES || lookup(key)) {
+        return nullptr;
+    }
+    size_t offset;
+    while (!first_fit(count, offset)) {
+        if (free_samples() >= count) {
+            // Enough space, just in the wrong places
+            compact();
+            if (first_fit(count, offset)) {
+                break;
+            }
+        }
+        if (!evict_one(frequency[key])) {
+            return nullptr;
+        }
+    }
+
+    // Keep entries in arena order, which makes first fit and compaction simple
+    size_t index = 0;
+    while (index < entry_count && entries[index].offset < offset) {
+        ++index;
+    }
+    memmove(entries + index + 1, entries + index, (entry_count - index) * sizeof(entries[0]));
+    entries[index] = entry{ offset, count, ++clock, key, false, 1 };
+    entry_count += 1;
+    counters.misses += 1;
+    return arena + offset;
+}
+
+bool decode_cache::retain(const int16_t *samples, uint8_t &key) {
+    if (samples < arena || samples >= arena + arena_samples) {
+        return false;
+    }
+    const size_t offset = samples - arena;
+    for (size_t i = 0; i < entry_count; ++i) {
+        entry &e = entries[i];
+        if (e.complete && e.locks > 0 && offset >= e.offset && offset < e.offset + e.length) {
+            e.locks += 1;
+            key = e.key;
+            return true;
+        }
+    }
+    return false;
+}
+
+void decode_cache::release(uint8_t key) {
+    entry *e = lookup(key);
+    if (e && e->complete && e->locks > 0) {
+        e->locks -= 1;
+    }
+}
+
+void decode_cache::commit(uint8_t key, size_t filled) {
+    entry *e = lookup(key);
+    if (e && !e->complete) {
+        // Any unused space is free for the next reservation
+        e->length = filled < e->length ? filled : e->length;
+        e->complete = true;
+        e->locks = 0;
+        if (e->length == 0) {
+            remove(e - entries);
+        }
+    }
+}
+
+void decode_cache::abandon(uint8_t key) {
+    entry *e = lookup(key);
+    if (e && !e->complete) {
+        remove(e - entries);
+    }
+}
+
+decode_cache::entry *decode_cache::lookup(uint8_t key) {
+    for (size_t i = 0; i < entry_count; ++i) {
+        if (entries[i].key == key) {
+            return &entries[i];
+        }
+    }
+    return nullptr;
+}
+
+bool decode_cache::first_fit(size_t count, size_t &offset) const {
+    size_t start = 0;
+    for (size_t i = 0; i <= entry_count; ++i) {
+        const size_t end = i < entry_count ? entries[i].offset : arena_samples;
+        if (end - start >= count) {
+            offset = start;
+            return true;
+        }
+        if (i < entry_count) {
+            start = entries[i].offset + entries[i].length;
+        }
+    }
+    return false;
+}
+
+size_t decode_cache::free_samples() const {
+    size_t used = 0;
+    for (size_t i = 0; i < entry_count; ++i) {
+        used += entries[i].length;
+    }
+    return arena_samples - used;
+}
+
+void decode_cache::count_use(uint8_t key) {
+    frequency[key] += 1;
+    if (frequency[key] >= FREQUENCY_LIMIT) {
+        // Age everything, so that the counts follow changes in what is spoken
+        for (auto &f : frequency) {
+            f /= 2;
+        }
+    }
+}
+
+bool decode_cache::evict_one(uint16_t candidate_frequency) {
+    size_t victim = entry_count;
+    for (size_t i = 0; i < entry_count; ++i) {
+        if (entries[i].locks == 0 && (victim == entry_count || entries[i].last_used < entries[victim].last_used)) {
+            victim = i;
+        }
+    }
+    if (victim == entry_count || frequency[entries[victim].key] >= candidate_frequency) {
+        // Nothing we can evict, or it is wanted at least as often as the new token
+        return false;
+    }
+    remove(victim);
+    counters.evictions += 1;
+    return true;
+}
+
+void decode_cache::compact() {
+    // Slide unlocked entries down to close the gaps.  Locked entries are in
+    // use by the player, so they stay where they are.
+    size_t cursor = 0;
+    for (size_t i = 0; i < entry_count; ++i) {
+        entry &e = entries[i];
+        if (e.locks == 0 && e.offset > cursor) {
+            memmove(arena + cursor, arena + e.offset, e.length * sizeof(arena[0]));
+            e.offset = cursor;
+        }
+        cursor = e.offset + e.length;
+    }
+    counters.compactions += 1;
+}
+
+void decode_cache::remove(size_t index) {
+    memmove(entries + index, entries + index + 1, (entry_count - index - 1) * sizeof(entries[0]));
+    entry_count -= 1;
+}
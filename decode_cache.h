@@ -0,0 +1,141 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Decoded Audio Cache
+ */
+
+#ifndef DECODE_CACHE_H
+#define DECODE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * LRU cache of decoded PCM, keyed by token.
+ *
+ * Compressed tokens are decoded into the cache the first time they are
+ * played, and played straight from it after that.  All of the samples live
+ * in one arena supplied by the owner.  Space is first-fit; when nothing fits
+ * the least recently used token is evicted and the arena compacted.
+ *
+ * Plain LRU thrashes when the tokens of one number don't all fit, as each
+ * number evicts exactly what the next one needs.  So a token is only let in
+ * if it has been asked for more often than the tokens it would evict, which
+ * keeps words like "thousand", "hundred" and "and" resident.
+ *
+ * Entries that are being filled or read are locked and are never evicted or
+ * moved, so the player can hold on to the pointers it is given.  Samples lent
+ * to the audio output outlive the decoder that found them, so they are kept
+ * locked with retain() until the buffer comes back.  Only entries that were
+ * completely filled are ever found, and they can be read by more than one
+ * decoder at once.
+ */
+class decode_cache {
+public:
+    static constexpr size_t MAX_ENTRIES = 40;    // More than the number of tokens
+    static constexpr size_t MAX_KEYS = 256;
+    static constexpr uint16_t FREQUENCY_LIMIT = 1024;   // Counts are halved on reaching this
+
+    struct stats {
+        uint32_t hits;
+        uint32_t misses;            // Decoded into the cache
+        uint32_t uncached;          // Decoded without caching, no room or not admitted
+        uint32_t evictions;
+        uint32_t compactions;
+    };
+
+    /**
+     * Constructor
+     *
+     * @param arena Storage for the decoded samples
+     * @param arena_samples Size of arena in samples
+     */
+    decode_cache(int16_t *arena, size_t arena_samples) : arena(arena), arena_samples(arena_samples) { }
+
+    decode_cache(const decode_cache &) = delete;
+    decode_cache &operator=(const decode_cache &) = delete;
+
+    /**
+     * Look up a token, locking it if found.
+     *
+     * @param key Token to find
+     * @param count Set to the number of samples on a hit
+     * @return Decoded samples, or nullptr on a miss
+     */
+    const int16_t *find(uint8_t key, size_t &count);
+
+    /**
+     * Make room for a token that is about to be decoded, locking it.
+     *
+     * @param key Token to add
+     * @param count Number of samples that will be written
+     * @return Where to write the samples, or nullptr if there is no room
+     */
+    int16_t *reserve(uint8_t key, size_t count);
+
+    /**
+     * Lock the entry holding samples from find() once more, so that they stay
+     * put after the reader is done with them.  Unlock with release().
+     *
+     * @param samples Samples somewhere in the arena, or anywhere else
+     * @param key Set to the token of the entry locked
+     * @return true if an entry was locked, false if the samples are not cached
+     */
+    bool retain(const int16_t *samples, uint8_t &key);
+
+    /**
+     * Unlock an entry from find() or retain().
+     */
+    void release(uint8_t key);
+
+    /**
+     * Finish filling an entry from reserve(), making it available to find().
+     *
+     * @param key The token
+     * @param filled Number of samples written, at most the number reserved
+     */
+    void commit(uint8_t key, size_t filled);
+
+    /**
+     * Drop an entry from reserve() that was not completely filled, for
+     * example because playback stopped early.
+     */
+    void abandon(uint8_t key);
+
+    /**
+     * Count a token that was decoded without being cached.
+     */
+    void note_uncached() { counters.uncached += 1; }
+
+    const stats &get_stats() const { return counters; }
+
+    void reset_stats() { counters = stats{ }; }
+
+private:
+    struct entry {
+        size_t offset;              // Start in arena, in samples
+        size_t length;              // Samples reserved
+        uint32_t last_used;         // Value of clock when last found or added
+        uint8_t key;
+        bool complete;              // All samples written
+        uint8_t locks;              // Readers, or the one writer while incomplete
+    };
+
+    int16_t *const arena;
+    const size_t arena_samples;
+    entry entries[MAX_ENTRIES];
+    size_t entry_count = 0;
+    uint32_t clock = 0;
+    stats counters = { };
+    uint16_t frequency[MAX_KEYS] = { };
+
+    entry *lookup(uint8_t key);
+    size_t free_samples() const;
+    bool first_fit(size_t count, size_t &offset) const;
+    void count_use(uint8_t key);
+    bool evict_one(uint16_t candidate_frequency);
+    void compact();
+    void remove(size_t index);
+};
+
+#endif // DECODE_CACHE_H
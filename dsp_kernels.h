@@ -0,0 +1,223 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Sample Processing Kernels
+ */
+
+#ifndef DSP_KERNELS_H
+#define DSP_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+// Set with the NUMBERBOX_PACKED_DSP CMake option
+#ifndef NUMBERBOX_PACKED_DSP
+#define NUMBERBOX_PACKED_DSP 0
+#endif
+
+// The intrinsics are only used with the option on, so that a default build
+// never parses them.  The packed ones need SIMD32, and __ssat needs SAT, as
+// well as DSP.
+#if NUMBERBOX_PACKED_DSP && defined(__ARM_FEATURE_DSP) && defined(__ARM_FEATURE_SIMD32) && defined(__ARM_FEATURE_SAT)
+#include <arm_acle.h>
+#define DSP_KERNELS_ACLE 1
+#else
+#define DSP_KERNELS_ACLE 0
+#endif
+
+/**
+ * Cross-fade and gain over spans of 16 bit samples.
+ *
+ * Each kernel comes in two versions.  The scalar one works a sample at a time
+ * and is the reference.  The packed one works on pairs of samples held in one
+ * 32 bit word, using the Armv8-M DSP extension instructions (PKHBT, PKHTB,
+ * SMUAD, SMULWB, SMULWT, SSAT) when the NUMBERBOX_PACKED_DSP option is on and
+ * the target has them.  Otherwise the packed kernels use exact C++
+ * equivalents of those instructions, so that the host can check them against
+ * the scalar ones, which is what the check_dsp_kernels tool does.  The
+ * unqualified kernels are the packed ones only where the instructions are
+ * used, and with the option on numbers_bench checks them against the scalar
+ * ones on the target and reports the cost of both.
+ */
+namespace dsp_kernels {
+    // Two samples, the first in the low half
+    typedef int32_t sample_pair;
+
+    /**
+     * The DSP instructions used by the packed kernels.
+     */
+    namespace ops {
+        inline int16_t saturate16(int32_t value) {
+            if (value > std::numeric_limits<int16_t>::max()) {
+                return std::numeric_limits<int16_t>::max();
+            } else if (value < std::numeric_limits<int16_t>::min()) {
+                return std::numeric_limits<int16_t>::min();
+            }
+            return static_cast<int16_t>(value);
+        }
+
+        inline int16_t low(sample_pair p) { return static_cast<int16_t>(p & 0xffff); }
+        inline int16_t high(sample_pair p) { return static_cast<int16_t>(static_cast<uint32_t>(p) >> 16); }
+
+        inline sample_pair pack(int16_t lo, int16_t hi) {
+            return static_cast<sample_pair>((static_cast<uint32_t>(static_cast<uint16_t>(hi)) << 16) | static_cast<uint16_t>(lo));
+        }
+
+#if DSP_KERNELS_ACLE
+        // ACLE has no intrinsics for these
+        inline sample_pair pkhbt(sample_pair a, sample_pair b) {
+            sample_pair result;
+            __asm__("pkhbt %0, %1, %2, lsl #16" : "=r"(result) : "r"(a), "r"(b));
+            return result;
+        }
+
+        inline sample_pair pkhtb(sample_pair a, sample_pair b) {
+            sample_pair result;
+            __asm__("pkhtb %0, %1, %2, asr #16" : "=r"(result) : "r"(a), "r"(b));
+            return result;
+        }
+
+        inline sample_pair sadd16(sample_pair a, sample_pair b) { return __sadd16(a, b); }
+        inline int32_t smuad(sample_pair a, sample_pair b) { return __smuad(a, b); }
+        inline int32_t smulwb(int32_t a, sample_pair b) { return __smulwb(a, b); }
+        inline int32_t smulwt(int32_t a, sample_pair b) { return __smulwt(a, b); }
+        inline int32_t ssat16(int32_t value) { return __ssat(value, 16); }
+#else
+        // Low half of a, and low half of b in the high half
+        inline sample_pair pkhbt(sample_pair a, sample_pair b) {
+            return static_cast<sample_pair>((static_cast<uint32_t>(a) & 0xffff) | (static_cast<uint32_t>(b) << 16));
+        }
+
+        // High half of a, and high half of b in the low half
+        inline sample_pair pkhtb(sample_pair a, sample_pair b) {
+            return static_cast<sample_pair>((static_cast<uint32_t>(a) & 0xffff0000) | (static_cast<uint32_t>(b) >> 16));
+        }
+
+        inline sample_pair sadd16(sample_pair a, sample_pair b) {
+            return pack(static_cast<int16_t>(low(a) + low(b)), static_cast<int16_t>(high(a) + high(b)));
+        }
+
+        // Only ever used with products that cannot overflow
+        inline int32_t smuad(sample_pair a, sample_pair b) {
+            return static_cast<int32_t>(low(a)) * low(b) + static_cast<int32_t>(high(a)) * high(b);
+        }
+
+        // Top 32 bits of the 48 bit product with the low or high half
+        inline int32_t smulwb(int32_t a, sample_pair b) {
+            return static_cast<int32_t>((static_cast<int64_t>(a) * low(b)) >> 16);
+        }
+
+        inline int32_t smulwt(int32_t a, sample_pair b) {
+            return static_cast<int32_t>((static_cast<int64_t>(a) * high(b)) >> 16);
+        }
+
+        inline int32_t ssat16(int32_t value) { return saturate16(value); }
+#endif
+
+        inline sample_pair load(const int16_t *p) {
+            sample_pair pair;
+            memcpy(&pair, p, sizeof(pair));
+            return pair;
+        }
+
+        inline void store(int16_t *p, sample_pair pair) {
+            memcpy(p, &pair, sizeof(pair));
+        }
+    }
+
+    namespace scalar {
+        /**
+         * Linear cross-fade between two spans
+         *
+         * Sample i is (from[i] * (length - i) + to[i] * i) >> shift, where
+         * length is 1 << shift.
+         *
+         * @param out Where to write the samples
+         * @param from Samples faded out
+         * @param to Samples faded in
+         * @param shift Log2 of the fade length, at most 14
+         */
+        inline void crossfade(int16_t *out, const int16_t *from, const int16_t *to, unsigned shift) {
+            const int32_t length = 1 << shift;
+            for (int32_t i = 0; i < length; ++i) {
+                const int32_t mixed = from[i] * (length - i) + to[i] * i;
+                out[i] = static_cast<int16_t>(mixed >> shift);
+            }
+        }
+
+        /**
+         * Scale a span, saturating at full scale
+         *
+         * @param inout Samples to scale in place
+         * @param count Number of samples
+         * @param gain_q16 Gain, 65536 is unity
+         */
+        inline void gain(int16_t *inout, size_t count, int32_t gain_q16) {
+            for (size_t i = 0; i < count; ++i) {
+                inout[i] = ops::saturate16(static_cast<int32_t>((static_cast<int64_t>(gain_q16) * inout[i]) >> 16));
+            }
+        }
+    }
+
+    namespace packed {
+        /**
+         * Linear cross-fade between two spans
+         *
+         * The from and to samples of each pair are brought together with PKHBT
+         * and PKHTB, each output sample is a single SMUAD of those with its two
+         * weights, and the two results are packed with PKHBT and stored as one
+         * word.  The weights for the next pair are stepped with SADD16.
+         *
+         * @see scalar::crossfade
+         */
+        inline void crossfade(int16_t *out, const int16_t *from, const int16_t *to, unsigned shift) {
+            const int32_t length = 1 << shift;
+            // Weights (length - i, i) and (length - i - 1, i + 1)
+            sample_pair weights0 = ops::pack(static_cast<int16_t>(length), 0);
+            sample_pair weights1 = ops::pack(static_cast<int16_t>(length - 1), 1);
+            const sample_pair step = ops::pack(-2, 2);
+            for (int32_t i = 0; i < length; i += 2) {
+                const sample_pair f = ops::load(from + i);
+                const sample_pair t = ops::load(to + i);
+                // (from[i], to[i]) and (from[i + 1], to[i + 1])
+                const sample_pair first = ops::pkhbt(f, t);
+                const sample_pair second = ops::pkhtb(t, f);
+                ops::store(out + i, ops::pkhbt(ops::smuad(first, weights0) >> shift, ops::smuad(second, weights1) >> shift));
+                weights0 = ops::sadd16(weights0, step);
+                weights1 = ops::sadd16(weights1, step);
+            }
+        }
+
+        /**
+         * Scale a span, saturating at full scale
+         *
+         * Each pair is scaled with an SMULWB and an SMULWT, which multiply the
+         * gain by the low and high samples where they sit in the word, then
+         * saturated with SSAT and packed again.
+         *
+         * @see scalar::gain
+         */
+        inline void gain(int16_t *inout, size_t count, int32_t gain_q16) {
+            size_t i = 0;
+            for (; i + 2 <= count; i += 2) {
+                const sample_pair p = ops::load(inout + i);
+                const int32_t lo = ops::ssat16(ops::smulwb(gain_q16, p));
+                const int32_t hi = ops::ssat16(ops::smulwt(gain_q16, p));
+                ops::store(inout + i, ops::pack(static_cast<int16_t>(lo), static_cast<int16_t>(hi)));
+            }
+            scalar::gain(inout + i, count - i, gain_q16);
+        }
+    }
+
+#if DSP_KERNELS_ACLE
+    using packed::crossfade;
+    using packed::gain;
+#else
+    using scalar::crossfade;
+    using scalar::gain;
+#endif
+}
+
+#endif // DSP_KERNELS_H
@@ -0,0 +1,164 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Energy Model
+ */
+
+#ifndef ENERGY_MODEL_H
+#define ENERGY_MODEL_H
+
+#include <cstdint>
+
+/**
+ * Turns what the firmware did, as counted by the instrumentation, into energy
+ * drawn from the battery.  Shared with the host tools, so that predictions
+ * made there use the same model as the firmware's own reports.
+ *
+ * Current on the 3.3V rail is modelled as a floor while the core sleeps in
+ * WFI between numbers, a slightly higher floor while it is awake, both
+ * scaling with clk_sys as the clocks keep running in WFI, a charge for
+ * each cycle the core spends working, the amplifier driving the speaker while
+ * samples play, and the flash read current for each XIP cache miss.  The
+ * floors include the amplifier's quiescent current.  The rail is fed from the
+ * battery through the buck converter, so the battery side allows for its
+ * efficiency.
+ */
+namespace energy_model {
+    constexpr uint32_t XIP_LINE_BYTES = 8;      // Read from flash on each XIP cache miss
+
+    struct calibration {
+        double sleep_ma;                // Rail current with the core in WFI
+        double awake_ma;                // Rail current with the core awake but waiting
+        double floor_clock_mhz;         // clk_sys the two floors above are for
+        double floor_ma_per_mhz;        // Change in both floors with clk_sys
+        double core_ma_per_mhz;         // Extra rail current while the core is working
+        double pwm_ma;                  // Extra rail current while samples are playing
+        double flash_read_ma;           // Flash current during a read
+        double flash_sck_per_miss;      // Quad read of one line, with SCK at clk_sys / 2
+        double rail_v;
+        double converter_efficiency;
+        double battery_v;               // Nominal, over the discharge
+        double battery_mah;
+        double battery_usable;          // Share of the capacity above the cutoff
+        // CPU cost of speaking, for predictions on the host where it cannot
+        // be counted.  numbers_bench reports the measured cycles per sample.
+        double cycles_per_sample;
+        double cycles_per_token;
+        double cycles_per_utterance;
+    };
+
+    /**
+     * Datasheet typical figures, with the floors set so that counting comes
+     * out at the ~10mA the unit was seen to draw.  Replace with readings from
+     * a meter on the battery: numbers_bench lights the user LED during its
+     * first phase, and reports the counters for each phase so that the model
+     * can be checked against the meter.
+     */
+    constexpr calibration CALIBRATION = {
+        6.0,            // sleep_ma
+        6.3,            // awake_ma
+        48.0,           // floor_clock_mhz
+        0.04,           // floor_ma_per_mhz
+        0.10,           // core_ma_per_mhz
+        2.5,            // pwm_ma
+        15.0,           // flash_read_ma
+        28.0,           // flash_sck_per_miss
+        3.3,            // rail_v
+        0.85,           // converter_efficiency
+        3.7,            // battery_v
+        2000.0,         // battery_mah
+        0.9,            // battery_usable
+        40.0,           // cycles_per_sample
+        2000.0,         // cycles_per_token
+        20000.0,        // cycles_per_utterance
+    };
+
+    /**
+     * Counters for a stretch of running, such as one utterance and the silence
+     * after it.
+     */
+    struct activity {
+        uint64_t elapsed_us;
+        uint64_t sleep_us;              // Of elapsed_us, with the core in WFI
+        uint64_t active_cycles;         // Core cycles spent working
+        uint64_t pwm_on_us;             // Samples playing
+        uint64_t xip_misses;
+        uint32_t clock_hz;              // clk_sys
+        uint32_t utterances;
+
+        activity &operator+=(const activity &other) {
+            elapsed_us += other.elapsed_us;
+            sleep_us += other.sleep_us;
+            active_cycles += other.active_cycles;
+            pwm_on_us += other.pwm_on_us;
+            xip_misses += other.xip_misses;
+            utterances += other.utterances;
+            return *this;
+        }
+    };
+
+    /**
+     * Charge drawn from the 3.3V rail
+     *
+     * @return Charge in mA seconds
+     */
+    inline double rail_charge_mas(const activity &a, const calibration &cal = CALIBRATION) {
+        const double sleep_s = a.sleep_us / 1e6;
+        const double awake_s = a.elapsed_us > a.sleep_us ? (a.elapsed_us - a.sleep_us) / 1e6 : 0.0;
+        const double flash_s = a.clock_hz ? a.xip_misses * cal.flash_sck_per_miss / (a.clock_hz / 2.0) : 0.0;
+        const double clocking_ma = a.clock_hz ? cal.floor_ma_per_mhz * (a.clock_hz / 1e6 - cal.floor_clock_mhz) : 0.0;
+        return (cal.sleep_ma + clocking_ma) * sleep_s
+             + (cal.awake_ma + clocking_ma) * awake_s
+             + cal.core_ma_per_mhz * a.active_cycles / 1e6
+             + cal.pwm_ma * a.pwm_on_us / 1e6
+             + cal.flash_read_ma * flash_s;
+    }
+
+    /**
+     * Energy drawn from the battery
+     *
+     * @return Energy in mJ
+     */
+    inline double energy_mj(const activity &a, const calibration &cal = CALIBRATION) {
+        return rail_charge_mas(a, cal) * cal.rail_v / cal.converter_efficiency;
+    }
+
+    /**
+     * Energy drawn from the battery for each utterance
+     *
+     * @return Energy in mJ, or zero if nothing was said
+     */
+    inline double energy_per_utterance_mj(const activity &a, const calibration &cal = CALIBRATION) {
+        return a.utterances ? energy_mj(a, cal) / a.utterances : 0.0;
+    }
+
+    /**
+     * Mean battery current
+     *
+     * @return Current in mA at the nominal battery voltage
+     */
+    inline double battery_ma(const activity &a, const calibration &cal = CALIBRATION) {
+        return a.elapsed_us ? energy_mj(a, cal) / cal.battery_v / (a.elapsed_us / 1e6) : 0.0;
+    }
+
+    /**
+     * Energy a full charge provides
+     *
+     * @return Energy in mJ
+     */
+    inline double battery_mj(const calibration &cal = CALIBRATION) {
+        return cal.battery_mah * cal.battery_usable * cal.battery_v * 3600.0;
+    }
+
+    /**
+     * How long a full charge lasts running as in `a`
+     *
+     * @return Runtime in hours, or zero if `a` drew nothing
+     */
+    inline double runtime_hours(const activity &a, const calibration &cal = CALIBRATION) {
+        const double mj = energy_mj(a, cal);
+        return mj > 0.0 ? battery_mj(cal) / mj * (a.elapsed_us / 3.6e9) : 0.0;
+    }
+}
+
+#endif // ENERGY_MODEL_H
@@ -26,6 +26,15 @@ namespace {
         led(LED_OFF_LEVEL);
         sleep_ms(BLINK_OFF_MS);
     }
+
+    // Ends the confidence flash for a fast boot
+    volatile alarm_id_t confidence_alarm = 0;
+
+    int64_t confidence_off(alarm_id_t id, void *user_data) {
+        led(LED_OFF_LEVEL);
+        confidence_alarm = 0;
+        return 0;
+    }
 }
 
 void fail_init() {
@@ -33,12 +42,24 @@ void fail_init() {
     gpio_init(constants::USER_LED_PIN);
     gpio_set_dir(constants::USER_LED_PIN, GPIO_OUT);
 
-    // Confidence flash
-    led_cycle();
+    // Confidence flash, from a timer while setup carries on for a fast boot
+    if (constants::FAST_BOOT) {
+        led(LED_ON_LEVEL);
+        confidence_alarm = add_alarm_in_ms(BLINK_ON_MS, confidence_off, nullptr, true);
+    } else {
+        led_cycle();
+    }
 }
 
 void fail(fail_t failure) {
-    // Fatal error: blink pattern indefinitely
+    // Fatal error: blink pattern indefinitely, kept apart from any
+    // confidence flash still going
+    if (confidence_alarm > 0) {
+        cancel_alarm(confidence_alarm);
+        confidence_alarm = 0;
+        led(LED_OFF_LEVEL);
+        sleep_ms(BLINK_OFF_MS);
+    }
     while (true) {
         for (int i = 0; i < failure; ++i) {
             led_cycle();
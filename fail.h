@@ -5,7 +5,13 @@ enum fail_t {
     // The value 1 is reserved for a startup confidence flash.
     FAIL_NO_BUFFER = 2,
     FAIL_NO_PRODUCER_POOL,
-    FAIL_BAD_OUTPUT_FORMAT
+    FAIL_BAD_OUTPUT_FORMAT,
+    FAIL_BAD_VOICE_DATA,
+    FAIL_PLAN_TOO_LONG,
+    FAIL_NO_COUNTER_LOG,
+    FAIL_STACK_LOW,
+    FAIL_STEADY_STATE_ALLOCATION,
+    FAIL_PLAN_OVERLAP
 };
 
 void fail_init();
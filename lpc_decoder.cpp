@@ -0,0 +1,157 @@
+#include "lpc_decoder.h"
+
+namespace {
+    constexpr int32_t CACHE_BITS = 32;
+    constexpr int32_t MAX_READ_BITS = 16;
+
+    int16_t saturate(int32_t value) {
+        // Can only happen with corrupt data, but keep the output sane
+        if (value > INT16_MAX) return INT16_MAX;
+        if (value < INT16_MIN) return INT16_MIN;
+        return static_cast<int16_t>(value);
+    }
+}
+
+lpc_decoder::lpc_decoder(const uint8_t *lpc_data, size_t data_length, size_t block_size)
+    : data(lpc_data), data_end(lpc_data + data_length), cache(0), cache_bits(0),
+      samples_remaining(block_size), frame_remaining(0), order(0), rice_k(0), history{} {
+    if (!lpc_data || data_length == 0) {
+        samples_remaining = 0;
+    }
+}
+
+void lpc_decoder::refill() {
+    while (cache_bits <= CACHE_BITS - 8 && data < data_end) {
+        cache |= static_cast<uint32_t>(*data++) << (CACHE_BITS - 8 - cache_bits);
+        cache_bits += 8;
+    }
+}
+
+uint32_t lpc_decoder::read_bits(int32_t count) {
+    // Split longer reads so that the cache always has enough bits
+    if (count > MAX_READ_BITS) {
+        const int32_t low_bits = MAX_READ_BITS;
+        const uint32_t high = read_bits(count - low_bits);
+        return high << low_bits | read_bits(low_bits);
+    }
+    if (count == 0) {
+        return 0;
+    }
+    if (cache_bits < count) {
+        refill();
+    }
+    const uint32_t value = cache >> (CACHE_BITS - count);
+    cache <<= count;
+    cache_bits -= count;
+    return value;
+}
+
+uint32_t lpc_decoder::read_unary() {
+    uint32_t zeros = 0;
+    while (true) {
+        if (cache == 0) {
+            // All of the buffered bits are zero
+            zeros += cache_bits;
+            cache_bits = 0;
+            if (data >= data_end) {
+                return zeros;
+            }
+            refill();
+            continue;
+        }
+        const int32_t leading = __builtin_clz(cache);
+        // Shifting by the full width is undefined, so handle the final bit specially
+        cache = leading + 1 < CACHE_BITS ? cache << (leading + 1) : 0;
+        cache_bits -= leading + 1;
+        return zeros + leading;
+    }
+}
+
+void lpc_decoder::read_frame_header() {
+    const uint32_t header = read_bits(8);
+    order = header >> 5;
+    rice_k = header & 0x1F;
+    if (order > MAX_ORDER) {
+        order = MAX_ORDER;
+    }
+    frame_remaining = samples_remaining < FRAME_SIZE ? samples_remaining : FRAME_SIZE;
+}
+
+int32_t lpc_decoder::read_residual() {
+    const uint32_t quotient = read_unary();
+    const uint32_t folded = quotient << rice_k | read_bits(rice_k);
+    return static_cast<int32_t>(folded >> 1) ^ -static_cast<int32_t>(folded & 1);
+}
+
+int16_t lpc_decoder::next() {
+    int16_t sample = 0;
+    read(&sample, 1);
+    return sample;
+}
+
+size_t lpc_decoder::read(int16_t *out, size_t count) {
+    if (count > samples_remaining) {
+        count = samples_remaining;
+    }
+
+    size_t n = 0;
+    while (n < count) {
+        if (frame_remaining == 0) {
+            read_frame_header();
+        }
+        size_t run = count - n;
+        if (run > frame_remaining) {
+            run = frame_remaining;
+        }
+        frame_remaining -= run;
+
+        switch (rice_k == VERBATIM ? VERBATIM : order) {
+        case 0:  decode_run<0>(out + n, run); break;
+        case 1:  decode_run<1>(out + n, run); break;
+        case 2:  decode_run<2>(out + n, run); break;
+        case 3:  decode_run<3>(out + n, run); break;
+        case 4:  decode_run<4>(out + n, run); break;
+        default: decode_run<VERBATIM>(out + n, run); break;
+        }
+        n += run;
+    }
+
+    samples_remaining -= count;
+    return count;
+}
+
+template <int ORDER>
+void lpc_decoder::decode_run(int16_t *out, size_t run) {
+    // Keep the history in locals for the inner loop
+    int32_t s1 = history[0];
+    int32_t s2 = history[1];
+    int32_t s3 = history[2];
+    int32_t s4 = history[3];
+
+    for (size_t n = 0; n < run; ++n) {
+        int32_t sample;
+        if (ORDER == VERBATIM) {
+            sample = static_cast<int16_t>(read_bits(16));
+        } else {
+            int32_t prediction;
+            switch (ORDER) {
+            case 0:  prediction = 0; break;
+            case 1:  prediction = s1; break;
+            case 2:  prediction = 2 * s1 - s2; break;
+            case 3:  prediction = 3 * (s1 - s2) + s3; break;
+            default: prediction = 4 * (s1 + s3) - 6 * s2 - s4; break;
+            }
+            sample = saturate(prediction + read_residual());
+        }
+        out[n] = static_cast<int16_t>(sample);
+        s4 = s3;
+        s3 = s2;
+        s2 = s1;
+        s1 = sample;
+    }
+
+    history[0] = s1;
+    history[1] = s2;
+    history[2] = s3;
+    history[3] = s4;
+}
@@ -0,0 +1,98 @@
+#ifndef LPC_DECODER_H
+#define LPC_DECODER_H
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Lossless LPC + Rice decoder
+ *
+ * Decodes assets that have been compressed losslessly, reproducing the
+ * original 16-bit PCM bit for bit.  The format is along the lines of FLAC's
+ * fixed predictors:
+ *
+ * - The data is an MSB first bit stream of frames of FRAME_SIZE samples.  The
+ *   final frame holds whatever samples are left.
+ * - Each frame starts with an 8 bit header.  The top 3 bits are the fixed
+ *   predictor order (0 to 4) and the bottom 5 bits are the Rice parameter k.
+ *   If k is VERBATIM the frame holds plain 16 bit samples.
+ * - Otherwise each sample is the prediction plus a residual.  Residuals are
+ *   zig-zag mapped to unsigned, and stored as the quotient in unary (q zero
+ *   bits then a one bit) followed by the low k bits.
+ * - Prediction history carries over between frames, starting from silence.
+ */
+class lpc_decoder {
+public:
+    static constexpr size_t FRAME_SIZE = 256;
+    static constexpr uint8_t VERBATIM = 31;
+    static constexpr uint8_t MAX_ORDER = 4;
+
+    /**
+     * Constructor
+     *
+     * @param lpc_data Pointer to encoded data to decode
+     * @param data_length Total length of data in bytes
+     * @param block_size Total number of samples in the data.
+     */
+    lpc_decoder(const uint8_t *lpc_data, size_t data_length, size_t block_size);
+
+    /**
+     * Decode and return a single sample
+     *
+     * Convenient method for sample-by-sample processing.
+     *
+     * @return Next 16-bit PCM sample, or 0 if no more data available
+     */
+    int16_t next();
+
+    /**
+     * Decode a block of samples
+     *
+     * Much cheaper per sample than next() as the frame parameters are only
+     * looked at once per run of samples.
+     *
+     * @param out Where to write the samples
+     * @param count Maximum number of samples to write
+     * @return Number of samples written
+     */
+    size_t read(int16_t *out, size_t count);
+
+    /**
+     * Check if there is more data to decode
+     *
+     * @return true if more data is available, false if decoding is complete
+     */
+    bool empty() const { return samples_remaining == 0; }
+
+    /**
+     * Get the number of samples remaining to be decoded
+     *
+     * @return Number of 16-bit PCM samples that will be produced from remaining data
+     */
+    size_t size() const { return samples_remaining; }
+
+private:
+    // Input data
+    const uint8_t *data;             // Next byte to load into the bit cache
+    const uint8_t *data_end;         // End of the data
+    uint32_t cache;                  // Unread bits, left justified
+    int32_t cache_bits;              // Number of valid bits in cache
+
+    // Decoder state
+    size_t samples_remaining;        // Samples left in the whole stream
+    size_t frame_remaining;          // Samples left in the current frame
+    uint8_t order;                   // Predictor order for the current frame
+    uint8_t rice_k;                  // Rice parameter for the current frame
+    int32_t history[MAX_ORDER];      // Previous samples, most recent first
+
+    void refill();
+    uint32_t read_bits(int32_t count);
+    uint32_t read_unary();
+    void read_frame_header();
+    int32_t read_residual();
+
+    template <int ORDER>
+    void decode_run(int16_t *out, size_t run);
+};
+
+#endif // LPC_DECODER_H
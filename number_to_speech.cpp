@@ -40,7 +40,7 @@ namespace {
         return error;
     }
 
-    void hundreds_to_tokens(std::vector<number_token>& tokens, uint32_t number, bool add_and) {
+    void hundreds_to_tokens(number_tokens& tokens, uint32_t number, bool add_and) {
         if (number == 0) {
             return; // Return early for zero
         }
@@ -73,8 +73,8 @@ namespace {
     }
 }
 
-std::vector<number_token> number_to_speech(uint32_t number) {
-    std::vector<number_token> tokens;
+number_tokens number_to_speech(uint32_t number) {
+    number_tokens tokens;
 
     // Handle zero as special case
     if (number == 0) {
@@ -7,7 +7,7 @@
 #ifndef NUMBER_TO_SPEECH_H
 #define NUMBER_TO_SPEECH_H
 
-#include <vector>
+#include <cstddef>
 #include <cstdint>
 
 enum number_token {
@@ -48,10 +48,33 @@ enum number_token {
 };
 
 /**
- * Converts an integer to a vector of British English speech tokens.
+ * The tokens for one number.  Held in place rather than on the heap, so that
+ * saying a number never allocates.
+ */
+class number_tokens {
+public:
+    // "four billion", then three groups like "three hundred and seventy seven
+    // million", the last without its scale word
+    static constexpr size_t CAPACITY = 2 + 6 + 6 + 5;
+
+    void push_back(number_token token) { tokens[count++] = token; }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    number_token operator[](size_t index) const { return tokens[index]; }
+    const number_token *begin() const { return tokens; }
+    const number_token *end() const { return tokens + count; }
+
+private:
+    number_token tokens[CAPACITY];
+    size_t count = 0;
+};
+
+/**
+ * Converts an integer to British English speech tokens.
  *
  * @param number The integer to convert (supports all unsigned 32 bit numbers)
- * @return A vector of tokens representing the number in British English
+ * @return The tokens representing the number in British English
  *
  * Examples:
  * - 0 -> {zero}
@@ -61,6 +84,6 @@ enum number_token {
  * - 101 -> {one, hundred, join_and, one}
  * - 1234 -> {one, thousand, two, hundred, join_and, thirty, four}
  */
-std::vector<number_token> number_to_speech(uint32_t number);
+number_tokens number_to_speech(uint32_t number);
 
 #endif // NUMBER_TO_SPEECH_H
@@ -1,5 +1,7 @@
-# This script
+# This script generates the spoken tokens with gtts, and decodes them to WAV
+# files for tools/voice_build, which does all of the remaining processing.
 import os
+import subprocess
 from gtts import gTTS
 
 
@@ -12,12 +14,14 @@ number_words = [
 ]
 
 # Generate files
-# Create a directory to store the files
+# Create directories to store the files
 output_dir = "number_mp3_files"
+wav_dir = "number_wav_files"
 os.makedirs(output_dir, exist_ok=True)
+os.makedirs(wav_dir, exist_ok=True)
 
 # Generate MP3 files for each word
-for word in words:
+for word in number_words:
     # Generate speech using gTTS
     tts = gTTS(text=word, lang='en', tld='com.au')
 
@@ -25,4 +29,7 @@ for word in words:
     filename = f"{output_dir}/{word}.mp3"
     tts.save(filename)
 
-    print(f"Generated MP3 file for '{word}'")
+    # Decode only, resampling and trimming is done by voice_build
+    subprocess.run(["sox", filename, f"{wav_dir}/{word}.wav"], check=True)
+
+    print(f"Generated MP3 and WAV files for '{word}'")
@@ -0,0 +1,425 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Benchmark firmware.
+ *
+ * Boots as numbers_pwm does and reports the time taken by each boot stage,
+ * and the clock chosen and the buffer cost it was chosen for.  Then reports
+ * over USB serial, in rounds:
+ *
+ * - Pinned and flash phases.  The same spread of numbers is spoken with the
+ *   hot tokens pinned in SRAM, with the user LED lit so that a meter on the
+ *   supply can be read against each phase, and then from flash.  Each reports
+ *   the XIP cache counters, an estimate of the flash read current, the share
+ *   of buffers played in place, the cycles spent filling buffers, and the
+ *   decoded audio cache hit rate when the voice is compressed.
+ * - Mixing.  Speaks with one and then two overlays going, and reports the
+ *   cost of buffers by the number of streams mixed into them.
+ * - Energy.  Counts as numbers_pwm does, silences and all, and reports the
+ *   energy per number, mean battery current and runtime from a full charge
+ *   that the energy model gives for the counters.
+ * - Stack and heap.  The stack high water marks for both cores, the stack
+ *   used by each stage of saying a number, and any heap allocations made so
+ *   far, by the address they were made from.
+ * - DSP kernels, with NUMBERBOX_PACKED_DSP on.  Checks the packed kernels
+ *   against the scalar ones, and reports the cost of both.
+ */
+
+#include "fail.h"
+#include "audio.h"
+#include "constants.h"
+#include "telemetry.h"
+#include "alloc_profiler.h"
+#include "clock_calibration.h"
+#include "dsp_kernels.h"
+#include "energy_model.h"
+#include "audio_player.h"
+#include "utterance_plan.h"
+#include "number_to_speech.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+
+#include "pico.h"
+#include "pico/stdlib.h"
+
+namespace {
+    constexpr uint32_t BENCH_NUMBERS = 40;          // Numbers spoken per phase
+    constexpr uint32_t BENCH_RANGE = 100000;        // Matches the voice_build -f default
+    constexpr uint32_t BENCH_STRIDE = 7919;         // Prime, spreads the numbers over the range
+    constexpr uint32_t USB_SETTLE_MS = 3000;
+    constexpr uint32_t OVERLAY_NUMBER = 777;        // Spoken over the counting when mixing
+    constexpr uint32_t BOOT_NUMBER = 1;             // Spoken first, as after a factory reset
+    constexpr uint32_t LONG_NUMBER = 3777777777u;   // Most tokens, for the stack stages
+    // Audio still queued for output when play() returns, as in numbers_pwm
+    constexpr uint32_t QUEUED_MS = (AUDIO_BUFFER_COUNT * AUDIO_BUFFER_SAMPLE_LENGTH * 1000 + AUDIO_SAMPLE_RATE - 1)
+                                 / AUDIO_SAMPLE_RATE + 1;
+
+    // Rough flash model for the estimate.  Each miss is an 8 byte quad read of
+    // about 28 SCK cycles (command, address, mode, dummy and data) with SCK at
+    // clk_sys / 2, as in the energy model.  Read and standby currents are
+    // typical datasheet values for the W25Q series parts on these boards.
+    constexpr double FLASH_SCK_PER_MISS = energy_model::CALIBRATION.flash_sck_per_miss;
+    constexpr double FLASH_READ_MA = energy_model::CALIBRATION.flash_read_ma;
+    constexpr double FLASH_STANDBY_MA = 0.015;
+
+    // Time spent working out what to say, as the player only counts the time
+    // spent filling buffers
+    uint64_t planning_us = 0;
+
+    void speak(audio_player &player, uint32_t number) {
+        static utterance_plan plan;
+        const uint64_t start_us = time_us_64();
+        plan.compile(number_to_speech(number));
+        planning_us += time_us_64() - start_us;
+        player.play(plan);
+    }
+
+    // Times from main() to each boot stage reached, in the order they were
+    // reached, and from the one before
+    void report_boot() {
+        static const char *const STAGE_NAMES[telemetry::BOOT_STAGE_COUNT] = {
+            "main", "led", "voice", "counter", "player", "services", "first plan", "first buffer"
+        };
+        const uint32_t main_us = telemetry::boot_time_us(telemetry::BOOT_MAIN);
+        uint32_t last_us = main_us;
+        printf("boot%s:", constants::FAST_BOOT ? " (fast)" : "");
+        while (true) {
+            int next = -1;
+            uint32_t next_us = 0;
+            for (int stage = telemetry::BOOT_LED; stage < telemetry::BOOT_STAGE_COUNT; ++stage) {
+                const uint32_t us = telemetry::boot_time_us(static_cast<telemetry::boot_stage>(stage));
+                if (us > last_us && (next < 0 || us < next_us)) {
+                    next = stage;
+                    next_us = us;
+                }
+            }
+            if (next < 0) {
+                break;
+            }
+            printf(" %s %.1fms (+%.1f)", STAGE_NAMES[next], (next_us - main_us) / 1000.0, (next_us - last_us) / 1000.0);
+            last_us = next_us;
+        }
+        printf("\n");
+    }
+
+    // Stack used by a stage, below the caller
+    template <typename Stage>
+    uint32_t stack_for(Stage &&stage) {
+        const uintptr_t mark = telemetry::mark_stack();
+        stage();
+        return telemetry::stack_used_since(mark);
+    }
+
+    // Report the stack high water marks so far, then the stack used by each
+    // stage of saying a number on its own
+    void run_stack(audio_player &player) {
+        for (unsigned core = 0; core < 2; ++core) {
+            const auto usage = telemetry::read_stack_usage(core);
+            if (usage.size) {
+                printf("stack  core %u %lu of %lu bytes used\n", core, static_cast<unsigned long>(usage.used),
+                       static_cast<unsigned long>(usage.size));
+            } else {
+                printf("stack  core %u has no stack of its own\n", core);
+            }
+        }
+
+        static utterance_plan plans[constants::MAX_STREAMS];
+        const uint32_t voice = stack_for([] { audio::init(); });
+        const uint32_t plan = stack_for([] { plans[0].compile(number_to_speech(LONG_NUMBER)); });
+        const uint32_t play = stack_for([&player] { player.play(plans[0]); });
+        const uint32_t limiter = stack_for([&player] {
+            player.set_volume(constants::MAX_VOLUME_PERCENT);
+            player.play(plans[0]);
+            player.set_volume(constants::VOLUME_PERCENT);
+        });
+        for (size_t i = 1; i < constants::MAX_STREAMS; ++i) {
+            plans[i].compile(number_to_speech(OVERLAY_NUMBER + i));
+        }
+        const uint32_t mixing = stack_for([&player] {
+            for (size_t i = 1; i < constants::MAX_STREAMS; ++i) {
+                player.overlay(plans[i], audio_player::PRIORITY_STATUS);
+            }
+            player.play(plans[0]);
+            player.drain();
+        });
+        const uint32_t measure = stack_for([&player] { player.measure(plans, constants::MAX_STREAMS); });
+        printf("stack  voice init %lu | plan %lu | play %lu | limiter %lu | mixing %lu | measure %lu bytes\n",
+               static_cast<unsigned long>(voice), static_cast<unsigned long>(plan), static_cast<unsigned long>(play),
+               static_cast<unsigned long>(limiter), static_cast<unsigned long>(mixing),
+               static_cast<unsigned long>(measure));
+    }
+
+    // Report heap allocations since boot.  Look up the addresses with
+    // arm-none-eabi-addr2line -f -C -e numbers_bench.elf
+    void run_heap() {
+        const auto &totals = alloc_profiler::get_totals();
+        size_t count;
+        const alloc_profiler::site *sites = alloc_profiler::get_sites(count);
+        printf("heap   %lu allocations, %llu bytes, %lu frees\n", static_cast<unsigned long>(totals.allocations),
+               static_cast<unsigned long long>(totals.bytes), static_cast<unsigned long>(totals.frees));
+        for (size_t i = 0; i < count; ++i) {
+            printf("heap   0x%08lx %lu allocations, %llu bytes\n", static_cast<unsigned long>(sites[i].address),
+                   static_cast<unsigned long>(sites[i].allocations), static_cast<unsigned long long>(sites[i].bytes));
+        }
+        if (totals.untracked) {
+            printf("heap   %lu from other sites\n", static_cast<unsigned long>(totals.untracked));
+        }
+    }
+
+    void run_phase(audio_player &player, const char *name, size_t sram_budget) {
+        audio::init(sram_budget);
+        gpio_put(constants::USER_LED_PIN, sram_budget > 0);
+
+        const auto cache_before = player.cache_stats();
+        const auto playback_before = player.get_playback_stats();
+        telemetry::reset_xip_counters();
+        const uint64_t start_us = time_us_64();
+        for (uint32_t i = 0; i < BENCH_NUMBERS; ++i) {
+            speak(player, 1 + (i * BENCH_STRIDE) % BENCH_RANGE);
+        }
+        const double seconds = (time_us_64() - start_us) / 1e6;
+        const auto xip = telemetry::read_xip_counters();
+        const auto &cache = player.cache_stats();
+        const uint32_t cache_hits = cache.hits - cache_before.hits;
+        const uint32_t cache_lookups = cache_hits + cache.misses - cache_before.misses + cache.uncached - cache_before.uncached;
+        const auto &playback = player.get_playback_stats();
+        const uint32_t direct_buffers = playback.direct_buffers - playback_before.direct_buffers;
+        const uint32_t all_buffers = direct_buffers + playback.copied_buffers - playback_before.copied_buffers;
+        const uint64_t samples = playback.samples - playback_before.samples;
+        const double fill_cycles = (playback.busy_us - playback_before.busy_us) * (clock_get_hz(clk_sys) / 1e6);
+
+        const double sck_hz = clock_get_hz(clk_sys) / 2.0;
+        const double busy = xip.misses() * FLASH_SCK_PER_MISS / sck_hz / seconds;
+        const double flash_ma = FLASH_STANDBY_MA + busy * (FLASH_READ_MA - FLASH_STANDBY_MA);
+        printf("%-6s pinned %2u tokens %6u bytes | %5.1fs | XIP acc %9lu hit %9lu miss %8lu (%5.1f%% hit) "
+               "%7.0f miss/s | flash busy %5.2f%% ~%.2fmA\n",
+               name, static_cast<unsigned>(audio::pinned_tokens()), static_cast<unsigned>(audio::pinned_bytes()),
+               seconds, static_cast<unsigned long>(xip.accesses), static_cast<unsigned long>(xip.hits),
+               static_cast<unsigned long>(xip.misses()),
+               xip.accesses ? 100.0 * xip.hits / xip.accesses : 100.0,
+               xip.misses() / seconds, busy * 100.0, flash_ma);
+        printf("       %lu of %lu buffers played in place (%5.1f%%), filling buffers %.1f cycles/sample\n",
+               static_cast<unsigned long>(direct_buffers), static_cast<unsigned long>(all_buffers),
+               all_buffers ? 100.0 * direct_buffers / all_buffers : 0.0, samples ? fill_cycles / samples : 0.0);
+        if (cache_lookups) {
+            printf("       decode cache %lu of %lu tokens hit (%5.1f%%), %lu evictions\n",
+                   static_cast<unsigned long>(cache_hits), static_cast<unsigned long>(cache_lookups),
+                   100.0 * cache_hits / cache_lookups, static_cast<unsigned long>(cache.evictions - cache_before.evictions));
+        }
+    }
+
+    // Speak over the counting with more and more overlays, and report the
+    // cost of buffers by the number of streams mixed in them
+    void run_mixing(audio_player &player) {
+        const auto before = player.get_playback_stats();
+        static utterance_plan overlays[constants::MAX_STREAMS];
+        for (size_t streams = 2; streams <= constants::MAX_STREAMS; ++streams) {
+            for (uint32_t i = 0; i < BENCH_NUMBERS; ++i) {
+                for (size_t o = 0; o + 1 < streams; ++o) {
+                    if (!player.playing(overlays[o])) {
+                        overlays[o].compile(number_to_speech(OVERLAY_NUMBER + o));
+                        player.overlay(overlays[o], audio_player::PRIORITY_STATUS);
+                    }
+                }
+                speak(player, 1 + (i * BENCH_STRIDE) % BENCH_RANGE);
+            }
+            player.drain();
+        }
+
+        const auto &after = player.get_playback_stats();
+        const double cycles_per_us = clock_get_hz(clk_sys) / 1e6;
+        for (size_t i = 0; i < constants::MAX_STREAMS; ++i) {
+            const uint32_t buffers = after.mixed[i].buffers - before.mixed[i].buffers;
+            const uint64_t samples = after.mixed[i].samples - before.mixed[i].samples;
+            const uint64_t busy_us = after.mixed[i].busy_us - before.mixed[i].busy_us;
+            printf("mixing %u stream%s %6lu buffers, %.1f cycles/sample\n", static_cast<unsigned>(i + 1), i ? "s" : " ",
+                   static_cast<unsigned long>(buffers), samples ? busy_us * cycles_per_us / samples : 0.0);
+        }
+    }
+
+#if NUMBERBOX_PACKED_DSP
+    constexpr uint32_t KERNEL_REPEATS = 100;        // Runs of each DSP kernel timed
+    constexpr unsigned KERNEL_SHIFT = 10;           // Log2 of the samples per run
+    constexpr size_t KERNEL_SPAN = size_t(1) << KERNEL_SHIFT;
+    constexpr uint32_t KERNEL_ROUNDS = 50;          // Random spans checked per kernel and setting
+    constexpr unsigned KERNEL_FADE_SHIFTS[] = { 1, 4, 7, KERNEL_SHIFT };
+    constexpr int32_t KERNEL_GAINS_Q16[] = { 0, 1, 46341, 65535, 65536, 65537, 1 << 20, -65536 };
+
+    int16_t kernel_from[KERNEL_SPAN], kernel_to[KERNEL_SPAN];
+    int16_t kernel_expected[KERNEL_SPAN], kernel_actual[KERNEL_SPAN];
+    uint32_t kernel_seed = 0x5eed;
+
+    // Xorshift random samples, a quarter of them at full scale to reach the
+    // saturation
+    void random_span(int16_t *span, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            kernel_seed ^= kernel_seed << 13;
+            kernel_seed ^= kernel_seed >> 17;
+            kernel_seed ^= kernel_seed << 5;
+            switch (kernel_seed & 7) {
+            case 0: span[i] = INT16_MAX; break;
+            case 1: span[i] = INT16_MIN; break;
+            default: span[i] = static_cast<int16_t>(kernel_seed >> 16); break;
+            }
+        }
+    }
+
+    // Number of random spans where the packed kernels, with the instructions
+    // the target really has, differ from the scalar ones
+    uint32_t check_kernels(uint32_t &checked) {
+        uint32_t mismatches = 0;
+        checked = 0;
+        for (uint32_t round = 0; round < KERNEL_ROUNDS; ++round) {
+            for (const unsigned shift : KERNEL_FADE_SHIFTS) {
+                const size_t count = size_t(1) << shift;
+                random_span(kernel_from, count);
+                random_span(kernel_to, count);
+                dsp_kernels::scalar::crossfade(kernel_expected, kernel_from, kernel_to, shift);
+                dsp_kernels::packed::crossfade(kernel_actual, kernel_from, kernel_to, shift);
+                mismatches += memcmp(kernel_expected, kernel_actual, count * sizeof(int16_t)) != 0;
+                checked += 1;
+            }
+            for (const int32_t gain : KERNEL_GAINS_Q16) {
+                // Every short length first, for the odd tails
+                const size_t count = round < 16 ? round : kernel_seed % (KERNEL_SPAN + 1);
+                random_span(kernel_expected, count);
+                memcpy(kernel_actual, kernel_expected, count * sizeof(int16_t));
+                dsp_kernels::scalar::gain(kernel_expected, count, gain);
+                dsp_kernels::packed::gain(kernel_actual, count, gain);
+                mismatches += memcmp(kernel_expected, kernel_actual, count * sizeof(int16_t)) != 0;
+                checked += 1;
+            }
+        }
+        return mismatches;
+    }
+
+    // Cycles per sample for a DSP kernel run over KERNEL_SPAN samples
+    template <typename Kernel>
+    double kernel_cycles(Kernel kernel) {
+        const uint64_t start_us = time_us_64();
+        for (uint32_t i = 0; i < KERNEL_REPEATS; ++i) {
+            kernel();
+            // Keep the output, which nothing reads
+            __compiler_memory_barrier();
+        }
+        const uint64_t busy_us = time_us_64() - start_us;
+        return busy_us * (clock_get_hz(clk_sys) / 1e6) / (KERNEL_REPEATS * KERNEL_SPAN);
+    }
+
+    // Check the packed DSP kernels against the scalar ones on the target, and
+    // report the cost of both, so that the NUMBERBOX_PACKED_DSP option can be
+    // kept or dropped from measurements
+    void run_kernels() {
+        uint32_t checked;
+        const uint32_t mismatches = check_kernels(checked);
+        random_span(kernel_from, KERNEL_SPAN);
+        random_span(kernel_to, KERNEL_SPAN);
+        const double scalar_fade = kernel_cycles([] {
+            dsp_kernels::scalar::crossfade(kernel_actual, kernel_from, kernel_to, KERNEL_SHIFT);
+        });
+        const double packed_fade = kernel_cycles([] {
+            dsp_kernels::packed::crossfade(kernel_actual, kernel_from, kernel_to, KERNEL_SHIFT);
+        });
+        const double scalar_gain = kernel_cycles([] { dsp_kernels::scalar::gain(kernel_actual, KERNEL_SPAN, 46341); });
+        const double packed_gain = kernel_cycles([] { dsp_kernels::packed::gain(kernel_actual, KERNEL_SPAN, 46341); });
+        printf("dsp    %s | %lu spans checked, %lu mismatched | crossfade scalar %.1f packed %.1f | "
+               "gain scalar %.1f packed %.1f cycles/sample\n",
+               DSP_KERNELS_ACLE ? "DSP instructions" : "no DSP instructions", static_cast<unsigned long>(checked),
+               static_cast<unsigned long>(mismatches), scalar_fade, packed_fade, scalar_gain, packed_gain);
+    }
+#endif
+
+    // Count as numbers_pwm does, and report what the energy model makes of it
+    void run_energy(audio_player &player) {
+        const auto before = player.get_playback_stats();
+        const uint64_t slept_before = telemetry::slept_us();
+        const uint64_t planning_before = planning_us;
+        telemetry::reset_xip_counters();
+        const uint64_t start_us = time_us_64();
+        for (uint32_t i = 0; i < BENCH_NUMBERS; ++i) {
+            speak(player, 1 + (i * BENCH_STRIDE) % BENCH_RANGE);
+            telemetry::sleep_in_wfi(constants::SILENCE_MS);
+        }
+        const auto &after = player.get_playback_stats();
+        const uint32_t clock_hz = clock_get_hz(clk_sys);
+        const uint64_t busy_us = after.busy_us - before.busy_us + planning_us - planning_before;
+        const uint64_t samples = after.samples - before.samples;
+
+        energy_model::activity activity = {};
+        activity.elapsed_us = time_us_64() - start_us;
+        activity.sleep_us = telemetry::slept_us() - slept_before;
+        activity.active_cycles = busy_us * (clock_hz / 1000000);
+        activity.pwm_on_us = samples * 1000000 / AUDIO_SAMPLE_RATE;
+        activity.xip_misses = telemetry::read_xip_counters().misses();
+        activity.clock_hz = clock_hz;
+        activity.utterances = BENCH_NUMBERS;
+
+        const double seconds = activity.elapsed_us / 1e6;
+        printf("energy %5.1fs | asleep %4.1f%% core busy %4.1f%% playing %4.1f%% | %lu XIP misses | "
+               "%.1fmJ per number, %.2fmA, %.1f days from %.0fmAh\n",
+               seconds, 100.0 * activity.sleep_us / activity.elapsed_us, 100.0 * busy_us / activity.elapsed_us,
+               100.0 * activity.pwm_on_us / activity.elapsed_us, static_cast<unsigned long>(activity.xip_misses),
+               energy_model::energy_per_utterance_mj(activity), energy_model::battery_ma(activity),
+               energy_model::runtime_hours(activity) / 24.0, energy_model::CALIBRATION.battery_mah);
+    }
+}
+
+int main() {
+    const bool stack_painted = telemetry::paint_stacks();
+    set_sys_clock_48mhz();
+    stdio_init_all();
+    sleep_ms(USB_SETTLE_MS);
+
+    // Boot as numbers_pwm does from here, less loading the counter, timing
+    // each stage up to the first buffer of the first number
+    telemetry::mark_boot(telemetry::BOOT_MAIN);
+    fail_init();
+    if (!stack_painted) {
+        fail(FAIL_STACK_LOW);
+    }
+    telemetry::mark_boot(telemetry::BOOT_LED);
+    audio::init();
+    telemetry::mark_boot(telemetry::BOOT_VOICE);
+    static audio_player player;
+    telemetry::mark_boot(telemetry::BOOT_PLAYER);
+    if (!constants::FAST_BOOT) {
+        clock_calibration::calibrate(player);
+        telemetry::mark_boot(telemetry::BOOT_SERVICES);
+    }
+    static utterance_plan first;
+    first.compile(number_to_speech(BOOT_NUMBER));
+    telemetry::mark_boot(telemetry::BOOT_FIRST_PLAN);
+    player.play(first);
+    telemetry::mark_boot(telemetry::BOOT_FIRST_BUFFER, player.get_playback_stats().first_buffer_us);
+    if (constants::FAST_BOOT) {
+        sleep_ms(QUEUED_MS);
+        clock_calibration::calibrate(player);
+        telemetry::mark_boot(telemetry::BOOT_SERVICES);
+    }
+
+    report_boot();
+    const auto &budget = telemetry::get_clock_budget();
+    printf("numbers_bench: %lu numbers per phase, SRAM budget %u bytes\n",
+           static_cast<unsigned long>(BENCH_NUMBERS), static_cast<unsigned>(constants::VOICE_SRAM_BYTES));
+    printf("clock %lukHz: worst buffer %lu cycles, %lu with margin, needs %lukHz, deadline %lu cycles\n",
+           static_cast<unsigned long>(budget.clock_khz), static_cast<unsigned long>(budget.worst_cycles),
+           static_cast<unsigned long>(budget.budget_cycles), static_cast<unsigned long>(budget.needed_khz),
+           static_cast<unsigned long>(budget.deadline_cycles));
+    while (true) {
+        run_phase(player, "pinned", constants::VOICE_SRAM_BYTES);
+        run_phase(player, "flash", 0);
+        run_mixing(player);
+        run_energy(player);
+        run_stack(player);
+        run_heap();
+#if NUMBERBOX_PACKED_DSP
+        run_kernels();
+#endif
+    }
+
+    return 0;
+}
@@ -1,86 +1,162 @@
 #include "fail.h"
 #include "audio.h"
 #include "constants.h"
+#include "telemetry.h"
+#include "alloc_profiler.h"
+#include "counter_store.h"
+#include "clock_calibration.h"
+#include "power_governor.h"
+#include "battery_monitor.h"
 #include "audio_player.h"
+#include "utterance_plan.h"
 #include "number_to_speech.h"
 
-#include <list>
-
 #include "hardware/clocks.h"
+#include "hardware/flash.h"
+#include "hardware/regs/addressmap.h"
 
 #include "pico.h"
 #include "pico/stdlib.h"
 
-namespace {
-    // // Power monitoring
-    // constexpr uint PICO_POWER_SAMPLE_COUNT = 3;
-    // constexpr float VOLTAGE_CONVERSION_FACTOR = 3.0f / (1 << 12);
-
-    // float power_voltage() {
-    //     // setup adc
-    //     adc_gpio_init(PICO_VSYS_PIN);
-    //     adc_select_input(PICO_VSYS_PIN - PICO_FIRST_ADC_PIN);
-
-    //     adc_fifo_setup(true, false, 0, false, false);
-    //     adc_run(true);
-
-    //     // We seem to read low values initially - this seems to fix it
-    //     int ignore_count = PICO_POWER_SAMPLE_COUNT;
-    //     while (!adc_fifo_is_empty() || ignore_count-- > 0) {
-    //         (void)adc_fifo_get_blocking();
-    //     }
-
-    //     // read vsys
-    //     uint32_t vsys = 0;
-    //     for(int i = 0; i < PICO_POWER_SAMPLE_COUNT; i++) {
-    //         uint16_t val = adc_fifo_get_blocking();
-    //         vsys += val;
-    //     }
-
-    //     adc_run(false);
-    //     adc_fifo_drain();
-
-    //     vsys /= PICO_POWER_SAMPLE_COUNT;
-    //     // Generate voltage
-    //     return vsys * 3 * VOLTAGE_CONVERSION_FACTOR;
-    // }
+#include <algorithm>
+
+// End of the image in flash, from the linker script
+extern "C" char __flash_binary_end;
 
+namespace {
     inline void silence_delay(uint32_t silence_ms) {
         if (silence_ms) {
             // Here we put the buck controller into PSM to reduce power consumption.
             // gpio_put(constants::WAVESHARE_MP28164_MODE_PIN, 0);
-            absolute_time_t until = make_timeout_time_ms(silence_ms);
-            while (get_absolute_time() <= until) {
-                __wfi();
-            }
+            telemetry::sleep_in_wfi(silence_ms);
             // gpio_put(constants::WAVESHARE_MP28164_MODE_PIN, 1);
         }
     }
+
+    // Audio still queued for output when play() returns.  It may be lent
+    // straight from the voice data in flash, so flash can only be written
+    // once it has played.
+    constexpr uint32_t QUEUED_MS = (AUDIO_BUFFER_COUNT * AUDIO_BUFFER_SAMPLE_LENGTH * 1000 + AUDIO_SAMPLE_RATE - 1)
+                                 / AUDIO_SAMPLE_RATE + 1;
+    static_assert(QUEUED_MS < constants::SILENCE_MS, "Counter log is written in the silence");
 }
 
 namespace counter {
+    // The counter lives in RAM that survives a reset, and is logged to the end
+    // of flash so that it also survives losing power
     constexpr uint32_t COUNTER_MAGIC_VALUE = 0xDEADBEEF;
     uint32_t __uninitialized_ram(counter_magic);
     uint32_t __uninitialized_ram(counter_value);
 
+    constexpr uint32_t LOG_OFFSET = PICO_FLASH_SIZE_BYTES - constants::COUNTER_LOG_SECTORS * FLASH_SECTOR_SIZE;
+    static_assert(constants::COUNTER_LOG_SECTORS >= 2, "The log needs a sector to move on to");
+    counter_store store(reinterpret_cast<const uint8_t *>(XIP_NOCACHE_NOALLOC_BASE), LOG_OFFSET,
+                        constants::COUNTER_LOG_SECTORS);
+
     inline void counter_init() {
+        if (reinterpret_cast<uintptr_t>(&__flash_binary_end) - XIP_BASE > LOG_OFFSET) {
+            fail(FAIL_NO_COUNTER_LOG);
+        }
+        uint32_t logged;
+        const bool have_logged = store.load(logged);
         if (counter_magic != COUNTER_MAGIC_VALUE) {
-            counter_value = 1;
+            counter_value = have_logged ? logged : 1;
             counter_magic = COUNTER_MAGIC_VALUE;
         }
     }
 
+    // Numbers between writes to the log, set by the power governor
+    uint32_t save_interval = constants::COUNTER_SAVE_INTERVAL;
+
     inline uint32_t get_and_increment_counter() {
-        return counter_value++;
+        const uint32_t value = counter_value++;
+        if (counter_value % save_interval == 0) {
+            store.save(counter_value);
+        }
+        return value;
+    }
+
+    /**
+     * Write to the log, if there is anything to do.  Only call when nothing
+     * is being played from flash.
+     */
+    inline void counter_flush() {
+        store.flush();
+    }
+}
+
+namespace {
+    // Sleep between numbers.  Once what was queued has played, the battery is
+    // read and the counter log written, as neither can disturb the output,
+    // and the stack is checked.
+    void silence(uint32_t silence_ms) {
+        silence_delay(QUEUED_MS);
+        const uint64_t start_us = time_us_64();
+        battery_monitor::start();
+        counter::counter_flush();
+        if (telemetry::read_stack_usage(0).headroom() < constants::STACK_HEADROOM_BYTES) {
+            fail(FAIL_STACK_LOW);
+        }
+        const uint32_t spent_ms = static_cast<uint32_t>((time_us_64() - start_us) / 1000);
+        const uint32_t rest_ms = silence_ms - QUEUED_MS;
+        silence_delay(rest_ms - std::min(spent_ms, rest_ms));
+    }
+
+    // Turn the output off, once everything has played, and slow the clock
+    void stop_output(audio_player &player, uint32_t clock_khz) {
+        player.drain();
+        silence_delay(QUEUED_MS);
+        player.set_output_enabled(false);
+        if (clock_khz) {
+            set_sys_clock_khz(clock_khz, false);
+        }
+    }
+
+    void start_output(audio_player &player) {
+        clock_calibration::restore_clock();
+        player.set_output_enabled(true);
+    }
+
+    void apply(audio_player &player, const power_governor::settings &settings) {
+        player.set_volume(settings.volume_percent);
+        counter::save_interval = settings.save_interval;
+    }
+
+    // Setup that can wait until the first number has been said, for a fast
+    // boot.  Nothing may be playing.
+    void start_services(audio_player &player, power_governor &governor) {
+        if (constants::FAST_BOOT) {
+            audio::init();
+        }
+        clock_calibration::calibrate(player);
+
+        // Start from a reading, in case the battery is already low
+        battery_monitor::init();
+        battery_monitor::start();
+        while (!battery_monitor::ready()) {
+            tight_loop_contents();
+        }
+        governor.update(battery_monitor::millivolts());
+        apply(player, governor.get_settings());
+        telemetry::mark_boot(telemetry::BOOT_SERVICES);
     }
 }
 
 int main() {
+    const bool stack_painted = telemetry::paint_stacks();
+    telemetry::mark_boot(telemetry::BOOT_MAIN);
     set_sys_clock_48mhz();
     fail_init();
+    if (!stack_painted) {
+        fail(FAIL_STACK_LOW);
+    }
+    telemetry::mark_boot(telemetry::BOOT_LED);
+    // Tokens are pinned in SRAM later for a fast boot
+    audio::init(constants::FAST_BOOT ? 0 : constants::VOICE_SRAM_BYTES);
+    telemetry::mark_boot(telemetry::BOOT_VOICE);
     counter::counter_init();
+    telemetry::mark_boot(telemetry::BOOT_COUNTER);
     // stdio_init_all();
-    // adc_init();
 
     // For Waveshare RP2350 Plus, we use GPIO 23 to set fixed PWM on for MP28164.
     // This prevents PSM mode and reduces voice frequency output ripple.
@@ -89,25 +165,68 @@ int main() {
     // gpio_put(constants::WAVESHARE_MP28164_MODE_PIN, 0);
     // For now, we are just going to let the pulldown do it's job
 
-    audio_player player;
+    // Too big for core 0's stack, along with everything else main() calls
+    static audio_player player;
+    telemetry::mark_boot(telemetry::BOOT_PLAYER);
+    power_governor governor;
+    if (!constants::FAST_BOOT) {
+        start_services(player, governor);
+    }
 
-    std::list<audio_player::sample_data> samples_to_play;
+    static utterance_plan plan;
+    static utterance_plan warning;
+    bool output_on = true;
+    bool booting = true;
     while (true) {
-        const auto tokens = number_to_speech(counter::get_and_increment_counter());
-        if (!tokens.empty()) {
-            samples_to_play.clear();
-            const auto last_token = tokens.size() - 1;
-            for (size_t i = 0; i <= last_token; ++i) {
-                bool join = i != last_token && tokens[i + 1] != join_and;
-                const auto &sample = audio::get_sample_data(tokens[i]);
-                if (sample.data) {
-                    samples_to_play.emplace_back(sample.data, sample.size, sample.samples_per_block, join);
+        const auto &settings = governor.get_settings();
+        const bool critical = settings.state == power_governor::LEVEL_CRITICAL;
+        if (governor.take_warning() && output_on && !player.playing(warning)) {
+            // Say the battery voltage in millivolts, over the counting or on
+            // its own before counting stops
+            warning.compile(number_to_speech(governor.filtered_mv()));
+            if (critical) {
+                player.play(warning);
+            } else {
+                player.overlay(warning, audio_player::PRIORITY_ALERT);
+            }
+        }
+        if (critical == output_on) {
+            output_on = !critical;
+            if (critical) {
+                stop_output(player, settings.clock_khz);
+            } else {
+                start_output(player);
+            }
+        }
+
+        if (!critical) {
+            const auto tokens = number_to_speech(counter::get_and_increment_counter());
+            if (!tokens.empty()) {
+                plan.compile(tokens);
+                if (booting) {
+                    telemetry::mark_boot(telemetry::BOOT_FIRST_PLAN);
                 }
+                player.play(plan);
+                alloc_profiler::utterance_said();
+            }
+        }
+        if (booting) {
+            booting = false;
+            telemetry::mark_boot(telemetry::BOOT_FIRST_BUFFER, player.get_playback_stats().first_buffer_us);
+            if (constants::FAST_BOOT) {
+                silence_delay(QUEUED_MS);
+                start_services(player, governor);
             }
-            player.play_samples(samples_to_play);
         }
-        // Low-power sleep for silence interval
-        silence_delay(constants::SILENCE_MS);
+        if (player.playing(warning)) {
+            // play() returns once the number is over, so finish the warning
+            // rather than leave it cut up by the silences
+            player.drain();
+        }
+        silence(settings.silence_ms);
+        if (battery_monitor::ready() && governor.update(battery_monitor::millivolts())) {
+            apply(player, governor.get_settings());
+        }
     }
 
     return 0;
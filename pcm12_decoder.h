@@ -0,0 +1,123 @@
+#ifndef PCM12_DECODER_H
+#define PCM12_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Packed 12-bit PCM "decoder".
+ *
+ * The PWM output only resolves about 11 bits at our clock and sample rate, so
+ * storing 16 bits per sample wastes a quarter of the flash and XIP bandwidth.
+ * Samples are stored as pairs of signed 12-bit values in three bytes:
+ *
+ *   byte 0: s0 bits 0-7
+ *   byte 1: s0 bits 8-11 (low nibble), s1 bits 0-3 (high nibble)
+ *   byte 2: s1 bits 4-11
+ *
+ * Samples are returned left justified in 16 bits.
+ */
+class pcm12_decoder {
+public:
+    /**
+     * Constructor
+     *
+     * @param pcm_data Pointer to packed 12 bit data to decode
+     * @param data_length Total length of data in bytes
+     * @param block_size Number of samples in the data.  If zero, assumes
+     *          every three bytes holds two samples.
+     */
+    pcm12_decoder(const uint8_t *pcm_data, size_t data_length, size_t block_size)
+        : data(pcm_data), samples_remaining(data_length / 3 * 2) {
+        if (block_size > 0 && block_size < samples_remaining) {
+            samples_remaining = block_size;
+        }
+    }
+
+    /**
+     * Decode and return a single sample
+     *
+     * Convenient method for sample-by-sample processing.
+     *
+     * @return Next 16-bit PCM sample, or 0 if no more data available
+     */
+    int16_t next() {
+        if (empty()) {
+            return 0;
+        }
+        samples_remaining -= 1;
+        if (have_odd) {
+            have_odd = false;
+            return odd_sample;
+        }
+        int16_t even_sample;
+        unpack(data, even_sample, odd_sample);
+        data += 3;
+        have_odd = true;
+        return even_sample;
+    }
+
+    /**
+     * Decode a block of samples
+     *
+     * Unpacks whole pairs directly, which is much cheaper than calling next()
+     * for every sample.
+     *
+     * @param out Where to write the samples
+     * @param count Maximum number of samples to write
+     * @return Number of samples written
+     */
+    size_t read(int16_t *out, size_t count) {
+        if (count > samples_remaining) {
+            count = samples_remaining;
+        }
+        size_t n = 0;
+        if (have_odd && n < count) {
+            have_odd = false;
+            out[n++] = odd_sample;
+        }
+        const uint8_t *p = data;
+        for (; n + 2 <= count; n += 2) {
+            unpack(p, out[n], out[n + 1]);
+            p += 3;
+        }
+        if (n < count) {
+            unpack(p, out[n++], odd_sample);
+            p += 3;
+            have_odd = true;
+        }
+        data = p;
+        samples_remaining -= count;
+        return count;
+    }
+
+    /**
+     * Check if there is more data to decode
+     *
+     * @return true if more data is available, false if decoding is complete
+     */
+    bool empty() const { return samples_remaining == 0; }
+
+    /**
+     * Get the number of samples remaining to be decoded
+     *
+     * @return Number of 16-bit PCM samples that will be produced from remaining data
+     */
+    size_t size() const { return samples_remaining; }
+
+private:
+    // Input data
+    const uint8_t *data;             // Pointer to next packed pair
+    size_t samples_remaining;        // Remaining samples to decode
+
+    // Second sample of a pair, when next() has only used the first
+    int16_t odd_sample = 0;
+    bool have_odd = false;
+
+    static void unpack(const uint8_t *p, int16_t &first, int16_t &second) {
+        first = static_cast<int16_t>((p[0] | p[1] << 8) << 4);
+        second = static_cast<int16_t>((p[1] >> 4 | p[2] << 4) << 4);
+    }
+};
+
+#endif // PCM12_DECODER_H
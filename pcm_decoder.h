@@ -3,6 +3,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 
 class pcm_decoder {
 public:
@@ -37,6 +38,45 @@ public:
         return sample;
     }
 
+    /**
+     * Decode a block of samples
+     *
+     * Both the data and the target are little endian, so this is just a copy.
+     *
+     * @param out Where to write the samples
+     * @param count Maximum number of samples to write
+     * @return Number of samples written
+     */
+    size_t read(int16_t *out, size_t count) {
+        if (count > size()) {
+            count = size();
+        }
+        memcpy(out, data, count * sizeof(out[0]));
+        data += count * sizeof(out[0]);
+        bytes_remaining -= count * sizeof(out[0]);
+        return count;
+    }
+
+    /**
+     * Borrow a block of samples in place
+     *
+     * The data is already native 16 bit samples, so as long as it is suitably
+     * aligned the caller can use it where it is, without copying.
+     *
+     * @param count Number of samples wanted
+     * @return Pointer to the next count samples, or nullptr if they cannot be
+     *         borrowed, in which case nothing is consumed
+     */
+    const int16_t *direct(size_t count) {
+        if (count > size() || reinterpret_cast<uintptr_t>(data) % alignof(int16_t) != 0) {
+            return nullptr;
+        }
+        const int16_t *samples = reinterpret_cast<const int16_t *>(data);
+        data += count * sizeof(samples[0]);
+        bytes_remaining -= count * sizeof(samples[0]);
+        return samples;
+    }
+
     /**
      * Check if there is more data to decode
      *
@@ -0,0 +1,64 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Battery Power Policy
+ */
+
+#include "power_governor.h"
+#include "constants.h"
+
+namespace {
+    constexpr uint32_t CRITICAL_POLL_MS = 10000;
+    constexpr uint32_t CRITICAL_CLOCK_KHZ = 24000;  // From pll_sys, 12MHz * 84 / 6 / 7
+
+    // Voltage below which each level is left for the next one down
+    constexpr uint32_t LEAVE_BELOW_MV[power_governor::LEVEL_COUNT - 1] = {
+        constants::BATTERY_SAVING_MV,
+        constants::BATTERY_LOW_MV,
+        constants::BATTERY_CRITICAL_MV,
+    };
+
+    const power_governor::settings LEVEL_SETTINGS[power_governor::LEVEL_COUNT] = {
+        { power_governor::LEVEL_NORMAL, constants::VOLUME_PERCENT, constants::SILENCE_MS,
+          constants::COUNTER_SAVE_INTERVAL, 0 },
+        { power_governor::LEVEL_SAVING, constants::VOLUME_PERCENT * 3 / 4, constants::SILENCE_MS,
+          constants::COUNTER_SAVE_INTERVAL, 0 },
+        { power_governor::LEVEL_LOW, constants::VOLUME_PERCENT / 2, constants::SILENCE_MS * 2, 1, 0 },
+        { power_governor::LEVEL_CRITICAL, 0, CRITICAL_POLL_MS, 1, CRITICAL_CLOCK_KHZ },
+    };
+}
+
+power_governor::power_governor() = default;
+
+bool power_governor::update(uint32_t millivolts) {
+    // Exponential moving average, seeded with the first reading
+    average = average ? average - (average >> FILTER_SHIFT) + millivolts : millivolts << FILTER_SHIFT;
+    filtered = average >> FILTER_SHIFT;
+
+    const level before = state;
+    while (state + 1 < LEVEL_COUNT && filtered < LEAVE_BELOW_MV[state]) {
+        state = static_cast<level>(state + 1);
+    }
+    while (state > LEVEL_NORMAL && filtered >= LEAVE_BELOW_MV[state - 1] + constants::BATTERY_HYSTERESIS_MV) {
+        state = static_cast<level>(state - 1);
+    }
+
+    if (state > before && state >= LEVEL_LOW) {
+        warning = true;
+        since_warning = 0;
+    } else if (state == LEVEL_LOW && ++since_warning >= WARNING_INTERVAL) {
+        warning = true;
+        since_warning = 0;
+    }
+    return state != before;
+}
+
+const power_governor::settings &power_governor::get_settings() const {
+    return LEVEL_SETTINGS[state];
+}
+
+bool power_governor::take_warning() {
+    const bool due = warning;
+    warning = false;
+    return due;
+}
@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Battery Power Policy
+ */
+
+#ifndef POWER_GOVERNOR_H
+#define POWER_GOVERNOR_H
+
+#include <cstdint>
+
+/**
+ * Decides how the box should run from the battery voltage.
+ *
+ * Readings are smoothed, then mapped to a level by the BATTERY_*_MV
+ * thresholds in constants.h.  Moving back up a level takes
+ * BATTERY_HYSTERESIS_MV more, so that noise, or the voltage recovering a
+ * little once the load drops, cannot make it chatter between levels.  Each
+ * level has its own settings, and a warning is asked for on the way down to
+ * LEVEL_LOW and LEVEL_CRITICAL, and now and then while low.
+ *
+ * Has no hardware dependencies, so that the policy can be run on the host.
+ */
+class power_governor {
+public:
+    enum level : uint8_t {
+        LEVEL_NORMAL,
+        LEVEL_SAVING,       // Quieter
+        LEVEL_LOW,          // Quieter still, slower, and warns
+        LEVEL_CRITICAL,     // Stops counting, with the output off
+        LEVEL_COUNT
+    };
+
+    struct settings {
+        level state;
+        uint32_t volume_percent;
+        uint32_t silence_ms;        // Between numbers, or between readings when critical
+        uint32_t save_interval;     // Numbers between counter log writes
+        uint32_t clock_khz;         // clk_sys with the output off, 0 for the audio clock
+    };
+
+    static constexpr uint32_t FILTER_SHIFT = 2;             // Each reading counts for 1/4
+    static constexpr uint32_t WARNING_INTERVAL = 200;       // Readings between warnings while low
+
+    power_governor();
+
+    /**
+     * Take a battery reading
+     *
+     * @param millivolts Battery voltage
+     * @return true if the level changed
+     */
+    bool update(uint32_t millivolts);
+
+    /**
+     * Settings for the current level
+     */
+    const settings &get_settings() const;
+
+    level get_level() const { return state; }
+
+    /**
+     * Smoothed battery voltage, or zero before the first reading
+     */
+    uint32_t filtered_mv() const { return filtered; }
+
+    /**
+     * Check for a warning to give, once for each one asked for
+     *
+     * @return true if the battery level should be announced
+     */
+    bool take_warning();
+
+private:
+    level state = LEVEL_NORMAL;
+    uint32_t average = 0;           // Scaled up by FILTER_SHIFT
+    uint32_t filtered = 0;
+    uint32_t since_warning = 0;
+    bool warning = false;
+};
+
+#endif // POWER_GOVERNOR_H
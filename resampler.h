@@ -0,0 +1,212 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Polyphase Sample Rate Conversion
+ */
+
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+/**
+ * Fixed-point polyphase resampler.
+ *
+ * Wraps another decoder and converts its output from the asset sample rate to
+ * AUDIO_SAMPLE_RATE, so that assets can be stored at lower rates such as
+ * 11025Hz or 16kHz.  Uses a TAPS long windowed-sinc filter with PHASES
+ * sub-sample positions, stepping through the input with an exact rational
+ * accumulator so that there is no drift over long samples.  The filter is
+ * designed for up-sampling; assets already at the output rate are passed
+ * straight through.
+ *
+ * Presents the same next() / empty() / size() interface as the decoders, plus
+ * a read() for producing whole blocks at a time.  The wrapped decoder needs a
+ * read() and a direct() too, which are used directly when no conversion is
+ * needed.
+ */
+template <typename Decoder>
+class resampler {
+public:
+    static constexpr size_t TAPS = 16;          // Filter length in input samples
+    static constexpr size_t PHASES = 64;        // Sub-sample filter positions
+    static constexpr int COEFFICIENT_BITS = 15; // Coefficients are Q15
+
+    /**
+     * Constructor
+     *
+     * @param sample_rate Sample rate of the encoded data.
+     *          Zero or AUDIO_SAMPLE_RATE means no conversion is required.
+     * @param args Remaining arguments are forwarded to the wrapped decoder
+     */
+    template <typename... Args>
+    explicit resampler(uint32_t sample_rate, Args&&... args)
+        : source(std::forward<Args>(args)...),
+          input_rate(sample_rate == 0 ? AUDIO_SAMPLE_RATE : sample_rate),
+          bypass(input_rate == AUDIO_SAMPLE_RATE) {
+        remaining = output_length(source.size(), input_rate);
+        if (!bypass) {
+            init_coefficients();
+            // Prime the history so that the first output lines up with the first input
+            for (size_t i = 0; i <= TAPS / 2; ++i) {
+                push(source.next());
+            }
+        }
+    }
+
+    /**
+     * Return the next output sample
+     *
+     * @return Next 16-bit PCM sample, or 0 if no more data available
+     */
+    int16_t next() {
+        int16_t sample = 0;
+        read(&sample, 1);
+        return sample;
+    }
+
+    /**
+     * Borrow a block of output samples in place
+     *
+     * Only possible when no conversion is needed, and the source can do it.
+     *
+     * @param count Number of samples wanted
+     * @return Pointer to the next count samples, or nullptr if they cannot be
+     *         borrowed, in which case nothing is consumed
+     */
+    const int16_t *direct(size_t count) {
+        if (!bypass || count > remaining) {
+            return nullptr;
+        }
+        const int16_t *samples = source.direct(count);
+        if (samples) {
+            remaining -= count;
+        }
+        return samples;
+    }
+
+    /**
+     * Produce a block of output samples
+     *
+     * @param out Where to write the samples
+     * @param count Maximum number of samples to write
+     * @return Number of samples written
+     */
+    size_t read(int16_t *out, size_t count) {
+        if (count > remaining) {
+            count = remaining;
+        }
+        remaining -= count;
+        if (bypass) {
+            return source.read(out, count);
+        }
+
+        for (size_t n = 0; n < count; ++n) {
+            const int16_t *taps = coefficients[phase * PHASES / AUDIO_SAMPLE_RATE];
+            const int16_t *window = history + history_pos;
+            int32_t sum = 1 << (COEFFICIENT_BITS - 1);
+            for (size_t k = 0; k < TAPS; ++k) {
+                sum += static_cast<int32_t>(window[k]) * taps[k];
+            }
+            out[n] = saturate(sum >> COEFFICIENT_BITS);
+
+            phase += input_rate;
+            while (phase >= AUDIO_SAMPLE_RATE) {
+                phase -= AUDIO_SAMPLE_RATE;
+                push(source.next());
+            }
+        }
+        return count;
+    }
+
+    /**
+     * Check if there is more data to produce
+     *
+     * @return true if more data is available, false if conversion is complete
+     */
+    bool empty() const { return remaining == 0; }
+
+    /**
+     * Get the number of samples remaining
+     *
+     * @return Number of output rate samples still to be produced
+     */
+    size_t size() const { return remaining; }
+
+    /**
+     * Number of output samples produced for a given number of input samples
+     */
+    static constexpr size_t output_length(size_t input_length, uint32_t sample_rate) {
+        return sample_rate == 0 || sample_rate == AUDIO_SAMPLE_RATE
+            ? input_length
+            : static_cast<size_t>(static_cast<uint64_t>(input_length) * AUDIO_SAMPLE_RATE / sample_rate);
+    }
+
+private:
+    Decoder source;
+    const uint32_t input_rate;
+    const bool bypass;
+    size_t remaining;
+
+    // History is stored twice so that the filter window is always contiguous
+    int16_t history[2 * TAPS] = { };
+    size_t history_pos = 0;
+    uint32_t phase = 0;              // Output position between inputs, in 1/AUDIO_SAMPLE_RATE units
+
+    static inline int16_t coefficients[PHASES][TAPS];
+    static inline bool coefficients_ready = false;
+
+    void push(int16_t sample) {
+        history[history_pos] = sample;
+        history[history_pos + TAPS] = sample;
+        history_pos = (history_pos + 1) % TAPS;
+    }
+
+    static int16_t saturate(int32_t value) {
+        if (value > std::numeric_limits<int16_t>::max()) {
+            return std::numeric_limits<int16_t>::max();
+        } else if (value < std::numeric_limits<int16_t>::min()) {
+            return std::numeric_limits<int16_t>::min();
+        }
+        return static_cast<int16_t>(value);
+    }
+
+    // Blackman windowed sinc, cut off a little below the input Nyquist frequency.
+    // Each phase is normalised to unity gain so that there is no DC ripple.
+    // Only done once, and the floating point is fine at startup.
+    static void init_coefficients() {
+        if (coefficients_ready) {
+            return;
+        }
+        constexpr double CUTOFF = 0.9;
+        constexpr double PI = 3.14159265358979323846;
+        for (size_t p = 0; p < PHASES; ++p) {
+            const double fraction = static_cast<double>(p) / PHASES;
+            double taps[TAPS];
+            double total = 0.0;
+            for (size_t k = 0; k < TAPS; ++k) {
+                // Distance from the output position, centre of the window is between TAPS/2-1 and TAPS/2
+                const double x = static_cast<double>(k) - (TAPS / 2 - 1) - fraction;
+                const double sinc = x == 0.0 ? 1.0 : std::sin(PI * CUTOFF * x) / (PI * CUTOFF * x);
+                const double w = (x + TAPS / 2) / TAPS;
+                const double window = 0.42 - 0.5 * std::cos(2 * PI * w) + 0.08 * std::cos(4 * PI * w);
+                taps[k] = sinc * window;
+                total += taps[k];
+            }
+            int32_t sum = 0;
+            for (size_t k = 0; k < TAPS; ++k) {
+                coefficients[p][k] = static_cast<int16_t>(std::lround(taps[k] / total * (1 << COEFFICIENT_BITS)));
+                sum += coefficients[p][k];
+            }
+            // Put any rounding error in the largest tap
+            coefficients[p][TAPS / 2 - (fraction < 0.5 ? 1 : 0)] += static_cast<int16_t>((1 << COEFFICIENT_BITS) - sum);
+        }
+        coefficients_ready = true;
+    }
+};
+
+#endif // RESAMPLER_H
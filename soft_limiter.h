@@ -0,0 +1,94 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Look-Ahead Soft Limiter
+ */
+
+#ifndef SOFT_LIMITER_H
+#define SOFT_LIMITER_H
+
+#include "dsp_kernels.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Brings wide samples back into 16 bit range without clipping.
+ *
+ * Instead of clipping the peaks, the gain is ramped down ahead of them, held
+ * for as long as they last, and then released again slowly, so that joins and
+ * loud passages just get a little quieter for a moment.  Each block is
+ * processed as a whole, so the look-ahead needs no delay line: a backwards
+ * pass over the block finds the lowest gain each sample can have while still
+ * ramping down to every later peak at ATTACK_STEP per sample, and a forwards
+ * pass applies it with the release limit.  Peaks in the first few samples of
+ * a block can only be seen from that block, so the ramp down to them may be
+ * shorter, but they are never clipped.
+ *
+ * All arithmetic is integer only, with gains in Q15.  Gain reduction only
+ * happens when samples are beyond full scale, so a block that is in range
+ * with the limiter released passes through unchanged.
+ *
+ * @tparam BLOCK Maximum block length
+ */
+template <size_t BLOCK>
+class soft_limiter {
+public:
+    static constexpr int GAIN_BITS = 15;
+    static constexpr int32_t UNITY = 1 << GAIN_BITS;
+    static constexpr int32_t CEILING = 32767;
+    static constexpr int32_t LOOKAHEAD = 32;                // Attack time in samples, about 1.5ms
+    static constexpr int32_t ATTACK_STEP = UNITY / LOOKAHEAD;
+    static constexpr int32_t RELEASE_STEP = UNITY / 1024;   // Full release in about 50ms
+
+    /**
+     * Check whether the limiter has fully released
+     *
+     * @return true if no gain reduction is being applied or carried over
+     */
+    bool idle() const { return gain == UNITY; }
+
+    /**
+     * Limit a block of samples
+     *
+     * @param in Samples to limit, any 32 bit value
+     * @param out Where to write the limited samples
+     * @param count Number of samples, at most BLOCK
+     */
+    void process(const int32_t *in, int16_t *out, size_t count) {
+        // Backwards: the lowest gain each sample needs for itself and later peaks
+        int32_t limit = UNITY;
+        bool reducing = !idle();
+        for (size_t i = count; i-- > 0; ) {
+            limit = limit + ATTACK_STEP < UNITY ? limit + ATTACK_STEP : UNITY;
+            const int32_t magnitude = in[i] < 0 ? -in[i] : in[i];
+            if (magnitude > CEILING) {
+                const int32_t needed = static_cast<int32_t>((static_cast<int64_t>(CEILING) << GAIN_BITS) / magnitude);
+                if (needed < limit) {
+                    limit = needed;
+                }
+                reducing = true;
+            }
+            limits[i] = static_cast<uint16_t>(limit);
+        }
+        if (!reducing) {
+            for (size_t i = 0; i < count; ++i) {
+                out[i] = static_cast<int16_t>(in[i]);
+            }
+            return;
+        }
+
+        // Forwards: follow the limits down immediately, and back up slowly
+        for (size_t i = 0; i < count; ++i) {
+            gain = gain + RELEASE_STEP < limits[i] ? gain + RELEASE_STEP : limits[i];
+            const int32_t scaled = static_cast<int32_t>((static_cast<int64_t>(in[i]) * gain) >> GAIN_BITS);
+            out[i] = static_cast<int16_t>(dsp_kernels::ops::ssat16(scaled));
+        }
+    }
+
+private:
+    int32_t gain = UNITY;
+    uint16_t limits[BLOCK];
+};
+
+#endif // SOFT_LIMITER_H
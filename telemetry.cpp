@@ -0,0 +1,127 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Runtime Measurements
+ */
+
+#include "telemetry.h"
+
+#include "hardware/structs/xip_ctrl.h"
+#include "hardware/sync.h"
+#include "pico/time.h"
+
+// Stack limits, from the linker script
+extern "C" uint32_t __StackBottom, __StackTop, __StackOneBottom, __StackOneTop;
+
+namespace {
+    constexpr uint32_t STACK_PAINT = 0x57ac57ac;
+
+    uint64_t slept_total_us = 0;
+    telemetry::clock_budget budget = {};
+    uint32_t boot_us[telemetry::BOOT_STAGE_COUNT] = {};
+
+    // Left unpainted below the painting function's frame pointer, as its own
+    // locals may be there
+    constexpr uintptr_t PAINT_MARGIN = 128;
+
+    // Written a word at a time, as memset() would need stack of its own
+    void paint(uint32_t *from, uint32_t *to) {
+        for (volatile uint32_t *word = from; word < to; ++word) {
+            *word = STACK_PAINT;
+        }
+    }
+
+    // Paint core 0's stack up to a little below the caller's frame.  Inlined,
+    // so that nothing has a frame below that while it paints.  Returns false
+    // if the frame is already below the end of the stack.
+    __attribute__((always_inline)) inline bool paint_below_frame() {
+        const uintptr_t frame = reinterpret_cast<uintptr_t>(__builtin_frame_address(0));
+        if (frame < reinterpret_cast<uintptr_t>(&__StackBottom) + PAINT_MARGIN) {
+            return false;
+        }
+        uint32_t *to = reinterpret_cast<uint32_t *>(frame - PAINT_MARGIN);
+        for (volatile uint32_t *word = &__StackBottom; word < to; ++word) {
+            *word = STACK_PAINT;
+        }
+        return true;
+    }
+
+    const uint32_t *deepest_used(const uint32_t *bottom, const uint32_t *top) {
+        while (bottom < top && *bottom == STACK_PAINT) {
+            ++bottom;
+        }
+        return bottom;
+    }
+}
+
+namespace telemetry {
+    void reset_xip_counters() {
+        // Any write clears the counter
+        xip_ctrl_hw->ctr_hit = 0;
+        xip_ctrl_hw->ctr_acc = 0;
+    }
+
+    xip_counters read_xip_counters() {
+        // Read hits first so that they can never exceed accesses
+        const uint32_t hits = xip_ctrl_hw->ctr_hit;
+        const uint32_t accesses = xip_ctrl_hw->ctr_acc;
+        return xip_counters{ hits, accesses };
+    }
+
+    void mark_boot(boot_stage stage, uint32_t us) {
+        boot_us[stage] = us;
+    }
+
+    void mark_boot(boot_stage stage) {
+        mark_boot(stage, time_us_32());
+    }
+
+    uint32_t boot_time_us(boot_stage stage) {
+        return boot_us[stage];
+    }
+
+    void set_clock_budget(const clock_budget &chosen) {
+        budget = chosen;
+    }
+
+    const clock_budget &get_clock_budget() {
+        return budget;
+    }
+
+    bool paint_stacks() {
+        paint(&__StackOneBottom, &__StackOneTop);
+        return paint_below_frame();
+    }
+
+    stack_usage read_stack_usage(unsigned core) {
+        const uint32_t *bottom = core ? &__StackOneBottom : &__StackBottom;
+        const uint32_t *top = core ? &__StackOneTop : &__StackTop;
+        const auto bytes = [](const uint32_t *from, const uint32_t *to) {
+            return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(to) - reinterpret_cast<uintptr_t>(from));
+        };
+        return stack_usage{ bytes(bottom, top), bytes(deepest_used(bottom, top), top) };
+    }
+
+    uintptr_t mark_stack() {
+        paint_below_frame();
+        return reinterpret_cast<uintptr_t>(__builtin_frame_address(0));
+    }
+
+    uint32_t stack_used_since(uintptr_t mark) {
+        const uintptr_t deepest = reinterpret_cast<uintptr_t>(deepest_used(&__StackBottom, &__StackTop));
+        return deepest < mark ? static_cast<uint32_t>(mark - deepest) : 0;
+    }
+
+    void sleep_in_wfi(uint32_t ms) {
+        const absolute_time_t from = get_absolute_time();
+        const absolute_time_t until = delayed_by_ms(from, ms);
+        while (get_absolute_time() <= until) {
+            __wfi();
+        }
+        slept_total_us += absolute_time_diff_us(from, get_absolute_time());
+    }
+
+    uint64_t slept_us() {
+        return slept_total_us;
+    }
+}
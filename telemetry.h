@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Runtime Measurements
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <cstdint>
+
+/**
+ * Counters and measurements that are only of interest for benchmarking and
+ * tuning.  Cheap enough to leave in the normal firmware.
+ */
+namespace telemetry {
+    /**
+     * XIP cache counters.  On the controller only the voice data in flash goes
+     * through the cache, as the code is copied to RAM.
+     */
+    struct xip_counters {
+        uint32_t hits;
+        uint32_t accesses;
+
+        uint32_t misses() const { return accesses - hits; }
+    };
+
+    /**
+     * Zero the XIP cache hit and access counters.
+     */
+    void reset_xip_counters();
+
+    /**
+     * Read the XIP cache counters since the last reset.
+     */
+    xip_counters read_xip_counters();
+
+    /**
+     * Points in the boot sequence, in the order numbers_pwm reaches them.
+     */
+    enum boot_stage {
+        BOOT_MAIN,                  // main() entered
+        BOOT_LED,                   // fail_init() returned
+        BOOT_VOICE,                 // Voice index loaded
+        BOOT_COUNTER,               // Counter loaded
+        BOOT_PLAYER,                // Output set up
+        BOOT_SERVICES,              // Tokens pinned, clock chosen, battery read
+        BOOT_FIRST_PLAN,            // First number tokenised and compiled
+        BOOT_FIRST_BUFFER,          // First buffer handed to the output
+        BOOT_STAGE_COUNT
+    };
+
+    /**
+     * Note the time a boot stage was reached.
+     *
+     * @param stage Stage reached
+     * @param us Time it was reached, from time_us_32()
+     */
+    void mark_boot(boot_stage stage, uint32_t us);
+    void mark_boot(boot_stage stage);
+
+    /**
+     * When a boot stage was reached, in microseconds from the runtime
+     * starting the timer.  The boot ROM, and the copy_to_ram copy of the
+     * image, come before that and are not included.
+     *
+     * @return Time of the stage, or zero if it has not been reached
+     */
+    uint32_t boot_time_us(boot_stage stage);
+
+    /**
+     * The buffer deadline, and the clock chosen at boot to meet it.
+     */
+    struct clock_budget {
+        uint32_t worst_cycles;      // Filling the heaviest buffer measured
+        uint32_t budget_cycles;     // worst_cycles with the margin added
+        uint32_t deadline_cycles;   // One buffer's playing time at clock_khz
+        uint32_t needed_khz;        // clk_sys that budget_cycles needs
+        uint32_t clock_khz;         // clk_sys chosen
+    };
+
+    /**
+     * Record the clock chosen at boot.
+     */
+    void set_clock_budget(const clock_budget &budget);
+
+    /**
+     * The clock chosen at boot, all zero if none has been recorded.
+     */
+    const clock_budget &get_clock_budget();
+
+    /**
+     * How much of a core's stack has been used.
+     */
+    struct stack_usage {
+        uint32_t size;              // Bytes set aside, zero if the core has no stack of its own
+        uint32_t used;              // Deepest the stack has been since it was painted
+
+        uint32_t headroom() const { return size - used; }
+    };
+
+    /**
+     * Fill the unused stacks with a pattern, so that how deep they go can be
+     * seen later.  Call first thing in main(), before core 1 is launched.
+     *
+     * @return false if main() already runs below the end of core 0's stack,
+     *         so nothing could be painted
+     */
+    bool paint_stacks();
+
+    /**
+     * Stack high water mark since paint_stacks(), from the deepest word that
+     * no longer holds the pattern.
+     *
+     * @param core Core whose stack to check
+     */
+    stack_usage read_stack_usage(unsigned core);
+
+    /**
+     * Paint core 0's stack below the caller again, to measure how much more
+     * of it something uses.  The high water mark then only covers use since.
+     *
+     * @return Mark to pass to stack_used_since()
+     */
+    uintptr_t mark_stack();
+
+    /**
+     * Stack used below a mark, by the caller's callees and any interrupts
+     * since mark_stack().  The 128 bytes or so just below the mark are not
+     * painted, so anything less reads as that much, and the rest is exact.
+     *
+     * @param mark From mark_stack()
+     * @return Bytes used below the mark
+     */
+    uint32_t stack_used_since(uintptr_t mark);
+
+    /**
+     * Sleep with the core in WFI, counting the time towards slept_us().
+     *
+     * @param ms Time to sleep for
+     */
+    void sleep_in_wfi(uint32_t ms);
+
+    /**
+     * Total time spent in sleep_in_wfi() since boot.
+     */
+    uint64_t slept_us();
+}
+
+#endif // TELEMETRY_H
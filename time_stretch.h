@@ -0,0 +1,277 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * WSOLA Time-Scale Modification
+ */
+
+#ifndef TIME_STRETCH_H
+#define TIME_STRETCH_H
+
+#include "constants.h"
+#include "dsp_kernels.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+/**
+ * Waveform Similarity Overlap-Add (WSOLA) time compression.
+ *
+ * Wraps another decoder and speeds up its output by SPEED_Q8 / 256 without
+ * changing the pitch.  Output is produced in frames of HOP samples, each one a
+ * linear cross-fade from the natural continuation of the previous segment to
+ * the input segment near the nominal (sped up) position that best matches it.
+ * All arithmetic is integer only.
+ *
+ * Presents the same next() / read() / empty() / size() / direct() interface as
+ * the decoders, so it can be dropped in wherever a decoder is used.
+ *
+ * The input history is too big to keep in every voice slot the player has,
+ * so it comes from a small static pool.  A workspace is only held while
+ * samples remain to be produced, and the player never has more than two
+ * voices sounding at once in each of its streams.
+ */
+template <typename Decoder, uint32_t SPEED_Q8>
+class time_stretch {
+public:
+    static constexpr uint32_t SPEED_ONE = 256;   // Unity speed in Q8
+    static constexpr size_t HOP = 128;           // Output frame / cross-fade length
+    static constexpr size_t HOP_SHIFT = 7;       // log2(HOP)
+    static constexpr size_t TOLERANCE = 64;      // Search window either side of nominal position
+    static constexpr size_t BUFFER_SIZE = 512;   // Input history, must cover the search span
+    static constexpr size_t POOL_SIZE = 2 * constants::MAX_STREAMS;  // Concurrently sounding voices
+
+    static_assert(SPEED_Q8 >= SPEED_ONE && SPEED_Q8 <= 2 * SPEED_ONE, "Speed must be between 1.0 and 2.0");
+    static_assert((1u << HOP_SHIFT) == HOP, "HOP_SHIFT must match HOP");
+    static_assert(2 * TOLERANCE + HOP + HOP * SPEED_Q8 / SPEED_ONE < BUFFER_SIZE, "Input buffer too small");
+
+    /**
+     * Constructor
+     *
+     * Arguments are forwarded to the wrapped decoder.
+     */
+    template <typename... Args>
+    explicit time_stretch(Args&&... args) : source(std::forward<Args>(args)...) {
+        remaining = output_length(source.size());
+    }
+
+    ~time_stretch() {
+        release();
+    }
+
+    time_stretch(const time_stretch &) = delete;
+    time_stretch &operator=(const time_stretch &) = delete;
+
+    /**
+     * Return the next time-compressed sample
+     *
+     * @return Next 16-bit PCM sample, or 0 if no more data available
+     */
+    int16_t next() {
+        if (remaining == 0) {
+            return 0;
+        }
+        if (frame_pos == HOP && !next_frame()) {
+            // No workspace available, nothing sensible to play
+            remaining = 0;
+            return 0;
+        }
+        remaining -= 1;
+        const int16_t sample = work->frame[frame_pos++];
+        if (remaining == 0) {
+            release();
+        }
+        return sample;
+    }
+
+    /**
+     * Produce a block of time-compressed samples
+     *
+     * @param out Where to write the samples
+     * @param count Maximum number of samples to write
+     * @return Number of samples written
+     */
+    size_t read(int16_t *out, size_t count) {
+        size_t done = 0;
+        while (done < count && remaining > 0) {
+            if (frame_pos == HOP && !next_frame()) {
+                // No workspace available, nothing sensible to play
+                remaining = 0;
+                break;
+            }
+            const size_t n = std::min({ count - done, HOP - frame_pos, remaining });
+            memcpy(out + done, work->frame + frame_pos, n * sizeof(out[0]));
+            frame_pos += n;
+            done += n;
+            remaining -= n;
+            if (remaining == 0) {
+                release();
+            }
+        }
+        return done;
+    }
+
+    /**
+     * Borrow a block of samples in place
+     *
+     * Every output sample is synthesised, so there is never anything to borrow.
+     *
+     * @param count Number of samples wanted
+     * @return Always nullptr
+     */
+    const int16_t *direct(size_t count) { return nullptr; }
+
+    /**
+     * Check if there is more data to produce
+     *
+     * @return true if more data is available, false if playback is complete
+     */
+    bool empty() const { return remaining == 0; }
+
+    /**
+     * Get the number of samples remaining
+     *
+     * @return Number of time-compressed samples still to be produced
+     */
+    size_t size() const { return remaining; }
+
+    /**
+     * Number of output samples produced for a given number of input samples
+     */
+    static constexpr size_t output_length(size_t input_length) {
+        return static_cast<size_t>(static_cast<uint64_t>(input_length) * SPEED_ONE / SPEED_Q8);
+    }
+
+private:
+    struct workspace {
+        int16_t input[BUFFER_SIZE];  // Input history, input[0] is absolute input sample input_base
+        int16_t frame[HOP];          // Current output frame
+    };
+
+    static inline workspace pool[POOL_SIZE];
+    static inline bool pool_in_use[POOL_SIZE];
+
+    Decoder source;
+    workspace *work = nullptr;
+
+    size_t input_base = 0;           // Absolute position of work->input[0]
+    size_t input_fill = 0;           // Valid samples in work->input
+    size_t frame_pos = HOP;          // Next sample in frame, HOP when a new frame is needed
+    size_t frame_index = 0;          // Number of frames produced so far
+    size_t previous_pos = 0;         // Absolute input position of the previous frame's segment
+    size_t remaining;                // Output samples still to be produced
+
+    bool acquire() {
+        for (size_t i = 0; i < POOL_SIZE; ++i) {
+            if (!pool_in_use[i]) {
+                pool_in_use[i] = true;
+                work = &pool[i];
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void release() {
+        if (work) {
+            pool_in_use[work - pool] = false;
+            work = nullptr;
+        }
+    }
+
+    static size_t nominal_position(size_t index) {
+        return static_cast<size_t>(static_cast<uint64_t>(index) * HOP * SPEED_Q8 / SPEED_ONE);
+    }
+
+    // Make sure everything up to (but not including) absolute sample "end" is buffered.
+    // Past the end of the source we pad with silence.
+    void fill_to(size_t end) {
+        while (input_base + input_fill < end) {
+            work->input[input_fill++] = source.next();
+        }
+    }
+
+    // Drop buffered samples before absolute position "start"
+    void discard_before(size_t start) {
+        if (start > input_base) {
+            const size_t drop = start - input_base;
+            input_fill -= drop;
+            memmove(work->input, work->input + drop, input_fill * sizeof(work->input[0]));
+            input_base = start;
+        }
+    }
+
+    const int16_t *at(size_t position) const {
+        return work->input + (position - input_base);
+    }
+
+    // Cross-correlation between the natural continuation and a candidate segment.
+    // Every second sample is plenty to find the best alignment.
+    static int64_t correlation(const int16_t *a, const int16_t *b) {
+        int64_t sum = 0;
+        for (size_t i = 0; i < HOP; i += 2) {
+            sum += static_cast<int32_t>(a[i]) * b[i];
+        }
+        return sum;
+    }
+
+    bool next_frame() {
+        if (!work && !acquire()) {
+            return false;
+        }
+        int16_t *frame = work->frame;
+        frame_pos = 0;
+        if (frame_index == 0) {
+            // First frame is played as is
+            fill_to(HOP);
+            memcpy(frame, at(0), HOP * sizeof(frame[0]));
+            previous_pos = 0;
+        } else {
+            const size_t nominal = nominal_position(frame_index);
+            const size_t low = nominal > TOLERANCE ? nominal - TOLERANCE : 0;
+            const size_t high = nominal + TOLERANCE;
+            fill_to(high + HOP);
+            fill_to(previous_pos + 2 * HOP);
+
+            // Coarse search on even offsets, then refine either side
+            const int16_t *continuation = at(previous_pos + HOP);
+            size_t best = low;
+            int64_t best_corr = correlation(continuation, at(low));
+            for (size_t pos = low + 2; pos <= high; pos += 2) {
+                const int64_t corr = correlation(continuation, at(pos));
+                if (corr > best_corr) {
+                    best_corr = corr;
+                    best = pos;
+                }
+            }
+            const size_t coarse = best;
+            if (coarse > low) {
+                const int64_t corr = correlation(continuation, at(coarse - 1));
+                if (corr > best_corr) {
+                    best_corr = corr;
+                    best = coarse - 1;
+                }
+            }
+            if (coarse < high) {
+                const int64_t corr = correlation(continuation, at(coarse + 1));
+                if (corr > best_corr) {
+                    best = coarse + 1;
+                }
+            }
+
+            // Cross-fade from the continuation into the best matching segment
+            dsp_kernels::crossfade(frame, continuation, at(best), HOP_SHIFT);
+            previous_pos = best;
+        }
+
+        frame_index += 1;
+        const size_t next_nominal = nominal_position(frame_index);
+        const size_t next_low = next_nominal > TOLERANCE ? next_nominal - TOLERANCE : 0;
+        discard_before(std::min(previous_pos + HOP, next_low));
+        return true;
+    }
+};
+
+#endif // TIME_STRETCH_H
@@ -0,0 +1,48 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Token Decoder Chain
+ */
+
+#ifndef TOKEN_DECODER_H
+#define TOKEN_DECODER_H
+
+#include "audio.h"
+#include "constants.h"
+#include "resampler.h"
+#include "time_stretch.h"
+#include "cached_decoder.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * The decoders a token is played through: decoded, or taken from the decoded
+ * audio cache, converted to the output rate, and time compressed if the
+ * speaking speed is over 100%.
+ */
+namespace token_decoder_chain {
+    constexpr uint32_t SPEED_Q8 = constants::SPEED_PERCENT * 256 / 100;
+    typedef resampler<cached_decoder> source_decoder;
+    typedef time_stretch<source_decoder, SPEED_Q8> stretched_decoder;
+    typedef std::conditional<SPEED_Q8 == 256, source_decoder, stretched_decoder>::type decoder;
+}
+
+typedef token_decoder_chain::decoder token_decoder;
+
+/**
+ * Number of output samples a token plays for
+ *
+ * Exactly what size() of a fresh token_decoder for the token gives.
+ *
+ * @param asset Token to measure
+ * @return Samples at AUDIO_SAMPLE_RATE
+ */
+inline size_t token_length(const audio::sample_data &asset) {
+    const size_t resampled = token_decoder_chain::source_decoder::output_length(asset.sample_count, asset.sample_rate);
+    // Time compression at unity speed is a no-op, so this holds either way
+    return token_decoder_chain::stretched_decoder::output_length(resampled);
+}
+
+#endif // TOKEN_DECODER_H
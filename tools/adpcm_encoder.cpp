@@ -0,0 +1,156 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Trellis IMA ADPCM encoder
+ */
+
+#include "adpcm_encoder.h"
+
+#include <algorithm>
+#include <limits>
+#include <unordered_set>
+
+namespace {
+    // These must match adpcm_decoder.cpp exactly
+    const int16_t step_table[89] = {
+        7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+        19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+        50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+        130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+        337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+        876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+        2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+        5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+        15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+    };
+
+    const int8_t index_table[16] = {
+        -1, -1, -1, -1, 2, 4, 6, 8,
+        -1, -1, -1, -1, 2, 4, 6, 8
+    };
+
+    struct state {
+        int32_t predictor;
+        int32_t step_index;
+    };
+
+    // Same arithmetic as adpcm_decoder::decode_single_sample
+    state decode(state s, uint8_t nibble) {
+        const int32_t step = step_table[s.step_index];
+        int32_t diff = step >> 3;
+        if (nibble & 4) diff += step;
+        if (nibble & 2) diff += step >> 1;
+        if (nibble & 1) diff += step >> 2;
+        s.predictor += (nibble & 8) ? -diff : diff;
+        s.predictor = std::clamp<int32_t>(s.predictor, std::numeric_limits<int16_t>::min(), std::numeric_limits<int16_t>::max());
+        s.step_index = std::clamp<int32_t>(s.step_index + index_table[nibble], 0, 88);
+        return s;
+    }
+
+    struct node {
+        uint64_t error;
+        state s;
+        uint32_t parent;             // Index of the node this extends at the previous sample
+        uint8_t nibble;              // Nibble that got here from the parent
+    };
+
+    // Encode the nibbles for one block, starting from the header state.
+    // Returns the state at the end of the best path.
+    state encode_block(const int16_t *samples, size_t count, state start, size_t width, std::vector<uint8_t> &nibbles) {
+        std::vector<std::vector<node>> steps(count + 1);
+        steps[0].push_back({ 0, start, 0, 0 });
+
+        std::vector<node> candidates;
+        std::unordered_set<uint32_t> seen;
+        for (size_t i = 0; i < count; ++i) {
+            const auto &previous = steps[i];
+            candidates.clear();
+            for (uint32_t p = 0; p < previous.size(); ++p) {
+                for (uint8_t nibble = 0; nibble < 16; ++nibble) {
+                    const state s = decode(previous[p].s, nibble);
+                    const int64_t e = static_cast<int64_t>(samples[i]) - s.predictor;
+                    candidates.push_back({ previous[p].error + static_cast<uint64_t>(e * e), s, p, nibble });
+                }
+            }
+            // Only the best few are wanted, so avoid sorting everything unless
+            // there turn out to be lots of duplicate states
+            // Ties are broken on the path so that the result never depends on the sort
+            const auto by_error = [](const node &a, const node &b) {
+                if (a.error != b.error) return a.error < b.error;
+                if (a.parent != b.parent) return a.parent < b.parent;
+                return a.nibble < b.nibble;
+            };
+            size_t sorted = std::min(candidates.size(), 2 * width);
+            std::partial_sort(candidates.begin(), candidates.begin() + sorted, candidates.end(), by_error);
+
+            // Keep the best few, dropping any that reach a state we already have
+            seen.clear();
+            auto &current = steps[i + 1];
+            for (size_t c = 0; c < candidates.size(); ++c) {
+                if (c == sorted) {
+                    std::sort(candidates.begin() + sorted, candidates.end(), by_error);
+                    sorted = candidates.size();
+                }
+                const node &candidate = candidates[c];
+                const uint32_t key = static_cast<uint32_t>(candidate.s.predictor & 0xFFFF) << 8 | candidate.s.step_index;
+                if (seen.insert(key).second) {
+                    current.push_back(candidate);
+                    if (current.size() == width) {
+                        break;
+                    }
+                }
+            }
+        }
+
+        // Trace the best path back
+        nibbles.resize(count);
+        uint32_t index = 0;
+        const state end = steps[count][0].s;
+        for (size_t i = count; i > 0; --i) {
+            const node &n = steps[i][index];
+            nibbles[i - 1] = n.nibble;
+            index = n.parent;
+        }
+        return end;
+    }
+}
+
+std::vector<uint8_t> adpcm_encode(const std::vector<int16_t> &samples, size_t samples_per_block, size_t trellis_width,
+                                  std::vector<int16_t> *reconstructed) {
+    std::vector<uint8_t> out;
+    std::vector<uint8_t> nibbles;
+    int32_t step_index = 0;
+
+    for (size_t start = 0; start < samples.size(); start += samples_per_block) {
+        const size_t count = std::min(samples_per_block, samples.size() - start);
+
+        // Header is the first sample exactly, and the step index carried on from the last block
+        const int16_t first = samples[start];
+        out.push_back(static_cast<uint8_t>(first & 0xFF));
+        out.push_back(static_cast<uint8_t>((first >> 8) & 0xFF));
+        out.push_back(static_cast<uint8_t>(step_index));
+        out.push_back(0);
+
+        // Nibbles come in pairs, so pad a short final block by repeating the last sample
+        std::vector<int16_t> block(samples.begin() + start + 1, samples.begin() + start + count);
+        if (!block.empty() && block.size() % 2) {
+            block.push_back(block.back());
+        }
+
+        const state end = encode_block(block.data(), block.size(), { first, step_index }, trellis_width, nibbles);
+        step_index = end.step_index;
+        for (size_t i = 0; i < nibbles.size(); i += 2) {
+            out.push_back(static_cast<uint8_t>(nibbles[i] | nibbles[i + 1] << 4));
+        }
+
+        if (reconstructed) {
+            state s = { first, static_cast<int32_t>(out[out.size() - nibbles.size() / 2 - 2]) };
+            reconstructed->push_back(first);
+            for (const uint8_t nibble : nibbles) {
+                s = decode(s, nibble);
+                reconstructed->push_back(static_cast<int16_t>(s.predictor));
+            }
+        }
+    }
+    return out;
+}
@@ -0,0 +1,44 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Trellis IMA ADPCM encoder, the host side of adpcm_decoder
+ */
+
+#ifndef ADPCM_ENCODER_H
+#define ADPCM_ENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Encode 16-bit PCM samples as block based IMA ADPCM.
+ *
+ * Rather than picking the closest nibble for each sample in turn, keeps the
+ * trellis_width best partial encodings (by total squared error) at each
+ * sample and extends each of them with every possible nibble.  The best
+ * complete path through each block is what gets written.  A width of one is
+ * the usual greedy encoder.
+ *
+ * The output is standard mono IMA ADPCM blocks, as found in the data chunk of
+ * a WAV file, and decodes exactly with adpcm_decoder.
+ *
+ * @param samples The samples to encode
+ * @param samples_per_block Samples in each block, including the header sample.
+ *          Must be odd.
+ * @param trellis_width Number of candidate paths kept at each sample
+ * @param reconstructed If not null, receives the samples the encoder expects
+ *          the decoder to produce, including any padding sample.
+ * @return The encoded blocks
+ */
+std::vector<uint8_t> adpcm_encode(const std::vector<int16_t> &samples, size_t samples_per_block, size_t trellis_width,
+                                  std::vector<int16_t> *reconstructed = nullptr);
+
+/**
+ * Bytes in each block for the given block size
+ */
+constexpr size_t adpcm_block_align(size_t samples_per_block) {
+    return 4 + (samples_per_block - 1) / 2;
+}
+
+#endif // ADPCM_ENCODER_H
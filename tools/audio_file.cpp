@@ -0,0 +1,127 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Audio file input for the host tools
+ */
+
+#include "audio_file.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+    constexpr uint16_t FORMAT_PCM = 1;
+    constexpr uint16_t FORMAT_FLOAT = 3;
+    constexpr uint16_t FORMAT_EXTENSIBLE = 0xFFFE;
+
+    bool read_file(const std::string &path, std::vector<uint8_t> &bytes) {
+        FILE *f = fopen(path.c_str(), "rb");
+        if (!f) {
+            return false;
+        }
+        uint8_t chunk[65536];
+        size_t got;
+        while ((got = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+            bytes.insert(bytes.end(), chunk, chunk + got);
+        }
+        fclose(f);
+        return true;
+    }
+
+    uint32_t get16(const uint8_t *p) {
+        return p[0] | p[1] << 8;
+    }
+
+    uint32_t get32(const uint8_t *p) {
+        return get16(p) | get16(p + 2) << 16;
+    }
+
+    // One sample in 16 bit full scale units
+    double get_sample(const uint8_t *p, uint16_t format, uint16_t bits) {
+        if (format == FORMAT_FLOAT) {
+            const uint32_t raw = get32(p);
+            float value;
+            memcpy(&value, &raw, sizeof(value));
+            return value * 32768.0;
+        }
+        switch (bits) {
+        case 8:
+            return (static_cast<int>(p[0]) - 128) * 256.0;
+        case 16:
+            return static_cast<int16_t>(get16(p));
+        case 24:
+            return static_cast<int32_t>((p[0] << 8 | p[1] << 16 | p[2] << 24)) / 65536.0;
+        default:
+            return static_cast<int32_t>(get32(p)) / 65536.0;
+        }
+    }
+
+    bool parse_wav(const std::vector<uint8_t> &bytes, audio_clip &clip, std::string &error) {
+        if (bytes.size() < 12 || memcmp(bytes.data(), "RIFF", 4) || memcmp(bytes.data() + 8, "WAVE", 4)) {
+            error = "not a RIFF WAVE file";
+            return false;
+        }
+        uint16_t format = 0;
+        uint16_t channels = 0;
+        uint16_t bits = 0;
+        size_t pos = 12;
+        while (pos + 8 <= bytes.size()) {
+            const uint8_t *chunk = bytes.data() + pos;
+            const size_t size = get32(chunk + 4);
+            const uint8_t *body = chunk + 8;
+            if (size > bytes.size() - pos - 8) {
+                error = "truncated chunk";
+                return false;
+            }
+            if (!memcmp(chunk, "fmt ", 4) && size >= 16) {
+                format = get16(body);
+                channels = get16(body + 2);
+                clip.sample_rate = get32(body + 4);
+                bits = get16(body + 14);
+                if (format == FORMAT_EXTENSIBLE && size >= 26) {
+                    // The real format is the first two bytes of the sub-format GUID
+                    format = get16(body + 24);
+                }
+            } else if (!memcmp(chunk, "data", 4)) {
+                const bool integer = format == FORMAT_PCM && (bits == 8 || bits == 16 || bits == 24 || bits == 32);
+                const bool floating = format == FORMAT_FLOAT && bits == 32;
+                if (channels == 0 || clip.sample_rate == 0 || !(integer || floating)) {
+                    error = "unsupported WAV format " + std::to_string(format) + " with " + std::to_string(bits) + " bits";
+                    return false;
+                }
+                const size_t frame = channels * (bits / 8);
+                const size_t frames = size / frame;
+                clip.samples.resize(frames);
+                for (size_t i = 0; i < frames; ++i) {
+                    double sum = 0.0;
+                    for (uint16_t c = 0; c < channels; ++c) {
+                        sum += get_sample(body + i * frame + c * (bits / 8), format, bits);
+                    }
+                    clip.samples[i] = sum / channels;
+                }
+                return true;
+            }
+            pos += 8 + size + (size & 1);
+        }
+        error = "no data chunk";
+        return false;
+    }
+}
+
+bool read_audio_file(const std::string &path, uint32_t raw_rate, audio_clip &clip, std::string &error) {
+    std::vector<uint8_t> bytes;
+    if (!read_file(path, bytes)) {
+        error = "can't read file";
+        return false;
+    }
+    const bool raw = path.size() >= 4 && path.compare(path.size() - 4, 4, ".raw") == 0;
+    if (!raw) {
+        return parse_wav(bytes, clip, error);
+    }
+    clip.sample_rate = raw_rate;
+    clip.samples.resize(bytes.size() / 2);
+    for (size_t i = 0; i < clip.samples.size(); ++i) {
+        clip.samples[i] = static_cast<int16_t>(get16(bytes.data() + 2 * i));
+    }
+    return true;
+}
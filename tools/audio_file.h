@@ -0,0 +1,34 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Audio file input for the host tools
+ */
+
+#ifndef AUDIO_FILE_H
+#define AUDIO_FILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct audio_clip {
+    uint32_t sample_rate = 0;
+    std::vector<double> samples;     // Mono, scaled to 16 bit full scale
+};
+
+/**
+ * Read a WAV file, or a headerless .raw file of signed little endian 16 bit
+ * samples at raw_rate.
+ *
+ * WAV files may be 8, 16, 24 or 32 bit integer or 32 bit float PCM, and
+ * multiple channels are mixed down to mono.
+ *
+ * @param path File to read
+ * @param raw_rate Sample rate to assume for .raw files
+ * @param clip Where to put the audio
+ * @param error Set to a description of the problem on failure
+ * @return true on success
+ */
+bool read_audio_file(const std::string &path, uint32_t raw_rate, audio_clip &clip, std::string &error);
+
+#endif // AUDIO_FILE_H
@@ -0,0 +1,195 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Battery life predictor.
+ *
+ * Runs the firmware energy model over a range of numbers, counted as
+ * numbers_pwm counts them, and reports the energy per number and the mean
+ * battery current for each power of ten in the range, then how long a full
+ * charge lasts and how far it gets the count.  As the model and the utterance
+ * plans are the firmware's own, a change to the voice, the pinned tokens or the
+ * timing constants can be compared by predicted battery life by building this
+ * before and after.
+ *
+ * The counters the firmware measures are predicted from each number's
+ * utterance_plan: samples play for its duration, the core sleeps for
+ * SILENCE_MS after it, and the XIP cache misses once for each line of token
+ * data played from flash.  Core cycles come from the cost per sample, token
+ * and utterance in the calibration, which should be set from what
+ * numbers_bench reports, with -k to try another cost per sample.  The tokens
+ * that fit in VOICE_SRAM_BYTES are pinned as they are at boot.
+ *
+ * Large ranges are sampled, evenly, at most -n numbers for each power of ten.
+ *
+ * Usage: battery_life [-n samples] [-k cycles_per_sample] [-m battery_mah] first last
+ */
+
+#include "fail.h"
+#include "audio.h"
+#include "constants.h"
+#include "energy_model.h"
+#include "token_decoder.h"
+#include "utterance_plan.h"
+#include "number_to_speech.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+    constexpr uint32_t DEFAULT_SAMPLES = 10000;
+    constexpr uint32_t CLOCK_HZ = 48000000;         // numbers_pwm runs clk_sys at 48MHz
+
+    energy_model::calibration calibration = energy_model::CALIBRATION;
+
+    uint64_t samples_to_us(uint64_t samples) {
+        return samples * 1000000 / AUDIO_SAMPLE_RATE;
+    }
+
+    // Counters for saying one number, and the silence after it
+    energy_model::activity number_activity(uint32_t number) {
+        static utterance_plan plan;
+        plan.compile(number_to_speech(number));
+
+        energy_model::activity activity = {};
+        uint64_t flash_bytes = 0;
+        for (const auto &entry : plan) {
+            if (audio::in_flash(*entry.asset)) {
+                const size_t length = token_length(*entry.asset);
+                flash_bytes += length ? static_cast<uint64_t>(entry.asset->size) * entry.length / length : 0;
+            }
+        }
+        activity.sleep_us = constants::SILENCE_MS * 1000;
+        activity.pwm_on_us = samples_to_us(plan.duration());
+        activity.elapsed_us = activity.pwm_on_us + activity.sleep_us;
+        activity.active_cycles = static_cast<uint64_t>(calibration.cycles_per_sample * plan.duration()
+                                                       + calibration.cycles_per_token * plan.size()
+                                                       + calibration.cycles_per_utterance);
+        activity.xip_misses = (flash_bytes + energy_model::XIP_LINE_BYTES - 1) / energy_model::XIP_LINE_BYTES;
+        activity.clock_hz = CLOCK_HZ;
+        activity.utterances = 1;
+        return activity;
+    }
+
+    // Counters for counting from lo to hi, from at most max_samples numbers
+    energy_model::activity range_activity(uint64_t lo, uint64_t hi, uint32_t max_samples) {
+        const uint64_t numbers = hi - lo + 1;
+        const uint64_t stride = (numbers + max_samples - 1) / max_samples;
+        energy_model::activity sampled = {};
+        sampled.clock_hz = CLOCK_HZ;
+        for (uint64_t n = lo; n <= hi; n += stride) {
+            sampled += number_activity(static_cast<uint32_t>(n));
+        }
+        if (sampled.utterances == numbers) {
+            return sampled;
+        }
+
+        // Scale up to the whole range
+        const double scale = static_cast<double>(numbers) / sampled.utterances;
+        energy_model::activity activity = {};
+        activity.elapsed_us = static_cast<uint64_t>(sampled.elapsed_us * scale);
+        activity.sleep_us = static_cast<uint64_t>(sampled.sleep_us * scale);
+        activity.active_cycles = static_cast<uint64_t>(sampled.active_cycles * scale);
+        activity.pwm_on_us = static_cast<uint64_t>(sampled.pwm_on_us * scale);
+        activity.xip_misses = static_cast<uint64_t>(sampled.xip_misses * scale);
+        activity.clock_hz = CLOCK_HZ;
+        activity.utterances = static_cast<uint32_t>(numbers);
+        return activity;
+    }
+
+    const char *format_days(double hours) {
+        static char text[32];
+        if (hours < 24.0) {
+            snprintf(text, sizeof(text), "%.1f hours", hours);
+        } else {
+            snprintf(text, sizeof(text), "%.1f days", hours / 24.0);
+        }
+        return text;
+    }
+}
+
+void fail_init() { }
+
+void fail(fail_t failure) {
+    fprintf(stderr, "fail(%d)\n", static_cast<int>(failure));
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t max_samples = DEFAULT_SAMPLES;
+    int arg = 1;
+    while (argc > arg + 1 && argv[arg][0] == '-') {
+        if (!strcmp(argv[arg], "-n")) {
+            max_samples = std::max<uint32_t>(strtoul(argv[arg + 1], nullptr, 0), 1);
+        } else if (!strcmp(argv[arg], "-k")) {
+            calibration.cycles_per_sample = strtod(argv[arg + 1], nullptr);
+        } else if (!strcmp(argv[arg], "-m")) {
+            calibration.battery_mah = strtod(argv[arg + 1], nullptr);
+        } else {
+            break;
+        }
+        arg += 2;
+    }
+    if (argc != arg + 2) {
+        fprintf(stderr, "Usage: %s [-n samples] [-k cycles_per_sample] [-m battery_mah] first last\n", argv[0]);
+        return 1;
+    }
+    const unsigned long long first = strtoull(argv[arg], nullptr, 0);
+    const unsigned long long last = strtoull(argv[arg + 1], nullptr, 0);
+    if (first > last || last > UINT32_MAX) {
+        fprintf(stderr, "Need 0 <= first <= last <= %u\n", UINT32_MAX);
+        return 1;
+    }
+
+    audio::init();
+
+    // Walk the powers of ten, noting where a full charge from `first` runs out
+    const double charge_mj = energy_model::battery_mj(calibration);
+    energy_model::activity total = {};
+    total.clock_hz = CLOCK_HZ;
+    double used_mj = 0.0;
+    double flat_hours = 0.0;
+    uint64_t flat_at = 0;
+    printf("%10s %10s %12s %10s %10s %12s\n", "from", "to", "numbers", "mJ/number", "mA", "charge");
+    for (uint64_t decade = 1; decade <= UINT32_MAX; decade *= 10) {
+        const uint64_t lo = std::max<uint64_t>(first, decade == 1 ? 0 : decade);
+        const uint64_t hi = std::min<uint64_t>(last, std::min<uint64_t>(decade * 10 - 1, UINT32_MAX));
+        if (lo > hi) {
+            continue;
+        }
+        const uint64_t numbers = hi - lo + 1;
+        const auto activity = range_activity(lo, hi, max_samples);
+        const double mj = energy_model::energy_mj(activity, calibration);
+        printf("%10llu %10llu %12llu %10.1f %10.2f %12s\n", static_cast<unsigned long long>(lo),
+               static_cast<unsigned long long>(hi), static_cast<unsigned long long>(numbers),
+               energy_model::energy_per_utterance_mj(activity, calibration),
+               energy_model::battery_ma(activity, calibration),
+               format_days(energy_model::runtime_hours(activity, calibration)));
+        if (!flat_at && used_mj + mj >= charge_mj) {
+            const double share = (charge_mj - used_mj) / mj;
+            flat_at = lo + static_cast<uint64_t>(share * numbers);
+            flat_hours = (total.elapsed_us + share * activity.elapsed_us) / 3.6e9;
+        }
+        used_mj += mj;
+        total += activity;
+    }
+
+    printf("\n%llu numbers from %llu to %llu, %.1fJ over %s, %.2fmA mean\n",
+           last - first + 1, first, last, used_mj / 1000.0, format_days(total.elapsed_us / 3.6e9),
+           energy_model::battery_ma(total, calibration));
+    energy_model::activity speaking = total;
+    speaking.elapsed_us -= speaking.sleep_us;
+    speaking.sleep_us = 0;
+    printf("%.1fmJ per number, %.1fmJ of it while speaking\n", energy_model::energy_per_utterance_mj(total, calibration),
+           energy_model::energy_per_utterance_mj(speaking, calibration));
+    if (flat_at) {
+        printf("A full %.0fmAh charge from %llu lasts %s, counting to about %llu\n", calibration.battery_mah, first,
+               format_days(flat_hours), static_cast<unsigned long long>(flat_at));
+    } else {
+        printf("The range takes %.1f%% of a full %.0fmAh charge, which would last %s at this pace\n",
+               100.0 * used_mj / charge_mj, calibration.battery_mah,
+               format_days(energy_model::runtime_hours(total, calibration)));
+    }
+    return 0;
+}
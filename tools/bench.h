@@ -0,0 +1,97 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Helpers shared by the host benchmarks
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace bench {
+    // Cycles per sample available on the target at 48MHz
+    constexpr double TARGET_CLOCK_HZ = 48000000.0;
+    constexpr double TARGET_CYCLES_PER_SAMPLE = TARGET_CLOCK_HZ / AUDIO_SAMPLE_RATE;
+
+    struct token_audio {
+        std::string name;
+        std::vector<uint8_t> bytes;  // Signed LE 16 bit PCM
+    };
+
+    /**
+     * Load all of the .raw token files from a directory, sorted by name.
+     */
+    inline std::vector<token_audio> load_raw_tokens(const std::string &dir) {
+        std::vector<token_audio> tokens;
+        for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+            if (entry.path().extension() != ".raw") {
+                continue;
+            }
+            token_audio token;
+            token.name = entry.path().stem().string();
+            FILE *f = fopen(entry.path().string().c_str(), "rb");
+            if (!f) {
+                continue;
+            }
+            uint8_t chunk[4096];
+            size_t got;
+            while ((got = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+                token.bytes.insert(token.bytes.end(), chunk, chunk + got);
+            }
+            fclose(f);
+            tokens.push_back(std::move(token));
+        }
+        std::sort(tokens.begin(), tokens.end(), [](const token_audio &a, const token_audio &b) {
+            return a.name < b.name;
+        });
+        return tokens;
+    }
+
+    /**
+     * Raw data directory from the command line, or the repo default.
+     */
+    inline std::string raw_dir(int argc, char *argv[]) {
+        return argc > 1 ? argv[1] : NUMBERBOX_RAW_DIR;
+    }
+
+    /**
+     * Host cycle counter where there is one, nanoseconds otherwise.
+     */
+    inline uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    inline const char *cycles_unit() {
+#if defined(__x86_64__) || defined(__i386__)
+        return "cycles";
+#else
+        return "ns";
+#endif
+    }
+
+    /**
+     * Keep the optimiser from discarding a computed value.
+     */
+    template <typename T>
+    inline void keep(const T &value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+}
+
+#endif // BENCH_H
@@ -0,0 +1,80 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Decoded audio cache benchmark.
+ *
+ * Encodes the vocabulary as IMA ADPCM, then decodes the tokens for a run of
+ * consecutive numbers through the firmware decoder chain, the way the player
+ * would while counting, with a range of cache sizes.  Reports the cache hit
+ * rate and the decode cost per output sample for each.
+ *
+ * Usage: bench_decode_cache [raw_dir]
+ */
+
+#include "bench.h"
+#include "dsp_util.h"
+#include "adpcm_encoder.h"
+#include "voice_blob_writer.h"
+
+#include "resampler.h"
+#include "cached_decoder.h"
+#include "number_to_speech.h"
+
+#include <cstdio>
+
+namespace {
+    constexpr size_t ADPCM_SAMPLES_PER_BLOCK = 505;
+    constexpr size_t ADPCM_TRELLIS_WIDTH = 4;       // Quality doesn't matter here
+    constexpr uint32_t FIRST_NUMBER = 1000;
+    constexpr uint32_t NUMBER_COUNT = 500;
+    constexpr size_t CACHE_KB[] = { 0, 32, 64, 96, 128, 256 };
+
+    typedef resampler<cached_decoder> decoder;
+}
+
+int main(int argc, char *argv[]) {
+    const auto tokens = bench::load_raw_tokens(bench::raw_dir(argc, argv));
+    std::vector<std::vector<uint8_t>> encoded(TOKEN_COUNT);
+    std::vector<audio::sample_data> assets(TOKEN_COUNT);
+    size_t found = 0;
+    for (const auto &token : tokens) {
+        for (size_t t = 0; t < TOKEN_COUNT; ++t) {
+            if (token.name != TOKEN_NAMES[t]) {
+                continue;
+            }
+            const auto samples = dsp_util::to_samples(token.bytes);
+            encoded[t] = adpcm_encode(samples, ADPCM_SAMPLES_PER_BLOCK, ADPCM_TRELLIS_WIDTH);
+            assets[t] = audio::sample_data{ encoded[t].data(), encoded[t].size(), ADPCM_SAMPLES_PER_BLOCK,
+                                            AUDIO_SAMPLE_RATE, voice::CODEC_ADPCM, samples.size(), static_cast<uint8_t>(t) };
+            found += 1;
+        }
+    }
+    if (found != TOKEN_COUNT) {
+        fprintf(stderr, "Expected %zu .raw token files, found %zu\n", TOKEN_COUNT, found);
+        return 1;
+    }
+
+    printf("Numbers %u to %u, IMA ADPCM voice\n\n", FIRST_NUMBER, FIRST_NUMBER + NUMBER_COUNT - 1);
+    printf("%8s %10s %8s %10s %12s\n", "cache", "hit rate", "evicted", "compacted", "cost/sample");
+    std::vector<int16_t> out;
+    for (const size_t kb : CACHE_KB) {
+        std::vector<int16_t> arena(kb * 1024 / sizeof(int16_t) + 1);
+        decode_cache cache(arena.data(), kb * 1024 / sizeof(int16_t));
+        size_t samples = 0;
+        const uint64_t start = bench::cycles();
+        for (uint32_t n = FIRST_NUMBER; n < FIRST_NUMBER + NUMBER_COUNT; ++n) {
+            for (const number_token token : number_to_speech(n)) {
+                decoder d(AUDIO_SAMPLE_RATE, cache, assets[token]);
+                out.resize(d.size());
+                samples += dsp_util::decode_all(d, out.data());
+                bench::keep(out.back());
+            }
+        }
+        const uint64_t elapsed = bench::cycles() - start;
+        const auto &stats = cache.get_stats();
+        const uint32_t lookups = stats.hits + stats.misses + stats.uncached;
+        printf("%6zukB %9.1f%% %8u %10u %8.1f %s\n", kb, 100.0 * stats.hits / lookups, stats.evictions,
+               stats.compactions, static_cast<double>(elapsed) / samples, bench::cycles_unit());
+    }
+    return 0;
+}
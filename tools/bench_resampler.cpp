@@ -0,0 +1,111 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Host benchmark for the polyphase sample rate converter.
+ *
+ * Each token is band limited and stored at a lower rate, then converted back
+ * up to the output rate by the firmware resampler.  Quality is reported as SNR
+ * against a long floating point reference filter (the resampler's own error)
+ * and against the original (which also includes the lost bandwidth).  Cost per
+ * output sample is compared with the direct PCM path.
+ *
+ * Usage: bench_resampler [raw_dir]
+ */
+
+#include "bench.h"
+#include "dsp_util.h"
+#include "resampler.h"
+#include "pcm_decoder.h"
+
+#include <cmath>
+#include <cstdio>
+
+namespace {
+    constexpr int REPEATS = 5;
+    constexpr uint32_t STORAGE_RATES[] = { 11025, 16000 };
+
+    template <typename Decoder>
+    uint64_t time_decode(const std::vector<std::vector<uint8_t>> &assets, uint32_t rate, std::vector<std::vector<int16_t>> *outputs) {
+        uint64_t best = ~uint64_t(0);
+        for (int repeat = 0; repeat < REPEATS; ++repeat) {
+            int32_t checksum = 0;
+            const uint64_t start = bench::cycles();
+            for (size_t t = 0; t < assets.size(); ++t) {
+                Decoder decoder(rate, assets[t].data(), assets[t].size(), 0);
+                auto &out = (*outputs)[t];
+                out.resize(decoder.size());
+                for (size_t i = 0; i < out.size(); ++i) {
+                    out[i] = decoder.next();
+                }
+                checksum += out.empty() ? 0 : out.back();
+            }
+            best = std::min(best, bench::cycles() - start);
+            bench::keep(checksum);
+        }
+        return best;
+    }
+
+    // The direct path doesn't take a rate, adapt it so it can be timed the same way
+    struct direct_decoder : pcm_decoder {
+        direct_decoder(uint32_t, const uint8_t *data, size_t length, size_t block_size)
+            : pcm_decoder(data, length, block_size) { }
+    };
+}
+
+int main(int argc, char *argv[]) {
+    const auto tokens = bench::load_raw_tokens(bench::raw_dir(argc, argv));
+    if (tokens.empty()) {
+        fprintf(stderr, "No .raw files found\n");
+        return 1;
+    }
+
+    std::vector<std::vector<uint8_t>> originals;
+    size_t original_bytes = 0;
+    for (const auto &token : tokens) {
+        originals.push_back(token.bytes);
+        original_bytes += token.bytes.size();
+    }
+
+    std::vector<std::vector<int16_t>> outputs(tokens.size());
+    const uint64_t direct_cycles = time_decode<direct_decoder>(originals, AUDIO_SAMPLE_RATE, &outputs);
+    size_t output_samples = 0;
+    for (const auto &out : outputs) {
+        output_samples += out.size();
+    }
+
+    printf("%zu tokens, target budget %.0f cycles per sample at %.0fMHz\n\n",
+           tokens.size(), bench::TARGET_CYCLES_PER_SAMPLE, bench::TARGET_CLOCK_HZ / 1e6);
+    printf("%-8s %10s %12s %14s %14s\n", "stored", "flash", "cost/sample", "SNR vs ideal", "SNR vs source");
+    printf("%-8u %10zu %9.1f %s %14s %14s\n", AUDIO_SAMPLE_RATE, original_bytes,
+           static_cast<double>(direct_cycles) / output_samples, bench::cycles_unit(), "-", "-");
+
+    for (const uint32_t rate : STORAGE_RATES) {
+        std::vector<std::vector<uint8_t>> stored;
+        std::vector<std::vector<double>> ideal;
+        std::vector<std::vector<double>> sources;
+        size_t stored_bytes = 0;
+        for (const auto &original : originals) {
+            const auto samples = dsp_util::to_samples(original);
+            std::vector<double> source(samples.begin(), samples.end());
+            const auto quantised = dsp_util::quantise(dsp_util::reference_resample(source, AUDIO_SAMPLE_RATE, rate));
+            stored.push_back(dsp_util::to_bytes(quantised));
+            stored_bytes += stored.back().size();
+            ideal.push_back(dsp_util::reference_resample(std::vector<double>(quantised.begin(), quantised.end()), rate, AUDIO_SAMPLE_RATE));
+            sources.push_back(std::move(source));
+        }
+
+        const uint64_t cycles = time_decode<resampler<pcm_decoder>>(stored, rate, &outputs);
+        size_t samples = 0;
+        double ideal_snr = 0.0;
+        double source_snr = 0.0;
+        for (size_t t = 0; t < outputs.size(); ++t) {
+            samples += outputs[t].size();
+            ideal_snr += dsp_util::snr_db(ideal[t], outputs[t]);
+            source_snr += dsp_util::snr_db(sources[t], outputs[t]);
+        }
+        printf("%-8u %10zu %9.1f %s %11.1f dB %11.1f dB\n", rate, stored_bytes,
+               static_cast<double>(cycles) / samples, bench::cycles_unit(),
+               ideal_snr / outputs.size(), source_snr / outputs.size());
+    }
+    return 0;
+}
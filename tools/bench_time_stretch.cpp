@@ -0,0 +1,76 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Host benchmark for the WSOLA time compression stage.
+ *
+ * Runs every token through the stage at a few speeds and reports the cost per
+ * output sample, alongside the direct PCM path for reference.
+ *
+ * Usage: bench_time_stretch [raw_dir]
+ */
+
+#include "bench.h"
+#include "pcm_decoder.h"
+#include "time_stretch.h"
+
+#include <cstdio>
+
+namespace {
+    constexpr int REPEATS = 5;
+
+    struct result {
+        size_t input_samples = 0;
+        size_t output_samples = 0;
+        uint64_t cycles = ~uint64_t(0);
+    };
+
+    template <typename Decoder>
+    result run(const std::vector<bench::token_audio> &tokens) {
+        result r;
+        for (int repeat = 0; repeat < REPEATS; ++repeat) {
+            size_t input_samples = 0;
+            size_t output_samples = 0;
+            int32_t checksum = 0;
+            const uint64_t start = bench::cycles();
+            for (const auto &token : tokens) {
+                Decoder decoder(token.bytes.data(), token.bytes.size(), 0);
+                input_samples += token.bytes.size() / 2;
+                while (!decoder.empty()) {
+                    checksum += decoder.next();
+                    output_samples += 1;
+                }
+            }
+            const uint64_t elapsed = bench::cycles() - start;
+            bench::keep(checksum);
+            r.input_samples = input_samples;
+            r.output_samples = output_samples;
+            r.cycles = std::min(r.cycles, elapsed);
+        }
+        return r;
+    }
+
+    void report(const char *name, const result &r) {
+        const double per_sample = static_cast<double>(r.cycles) / r.output_samples;
+        const double seconds = static_cast<double>(r.output_samples) / AUDIO_SAMPLE_RATE;
+        printf("%-10s %10zu %10zu %8.2fs %10.1f %s\n", name, r.input_samples, r.output_samples,
+               seconds, per_sample, bench::cycles_unit());
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const auto tokens = bench::load_raw_tokens(bench::raw_dir(argc, argv));
+    if (tokens.empty()) {
+        fprintf(stderr, "No .raw files found\n");
+        return 1;
+    }
+
+    printf("%zu tokens, target budget %.0f cycles per sample at %.0fMHz\n\n",
+           tokens.size(), bench::TARGET_CYCLES_PER_SAMPLE, bench::TARGET_CLOCK_HZ / 1e6);
+    printf("%-10s %10s %10s %9s %10s per output sample\n", "speed", "in", "out", "duration", "cost");
+    report("direct", run<pcm_decoder>(tokens));
+    report("1.0x", run<time_stretch<pcm_decoder, 256>>(tokens));
+    report("1.2x", run<time_stretch<pcm_decoder, 307>>(tokens));
+    report("1.4x", run<time_stretch<pcm_decoder, 358>>(tokens));
+    report("1.6x", run<time_stretch<pcm_decoder, 410>>(tokens));
+    return 0;
+}
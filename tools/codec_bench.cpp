@@ -0,0 +1,198 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Codec trade-off benchmark.
+ *
+ * Encodes every token with each supported asset format, decodes it again with
+ * the firmware decoder classes, and reports flash bytes, decode cost per sample
+ * and quality (SNR and segmental SNR against the source) for every token and
+ * format.  Decoders with a block read() are timed using it.
+ *
+ * Usage: codec_bench [-o table.csv] [raw_dir]
+ */
+
+#include "bench.h"
+#include "dsp_util.h"
+#include "lpc_encoder.h"
+#include "adpcm_encoder.h"
+#include "pcm12_encoder.h"
+
+#include "resampler.h"
+#include "lpc_decoder.h"
+#include "pcm_decoder.h"
+#include "adpcm_decoder.h"
+#include "pcm12_decoder.h"
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+
+namespace {
+    constexpr int REPEATS = 20;
+    constexpr size_t ADPCM_SAMPLES_PER_BLOCK = 505;
+    constexpr size_t ADPCM_TRELLIS_WIDTH = 32;
+    constexpr uint32_t LOW_RATE = 11025;
+
+    struct asset {
+        std::vector<uint8_t> data;
+        size_t block_size;
+        uint32_t sample_rate;
+    };
+
+    struct codec {
+        const char *name;
+        std::function<asset(const std::vector<int16_t> &)> encode;
+        std::function<size_t(const asset &, int16_t *)> decode;
+    };
+
+    template <typename Decoder>
+    size_t decode_with(const asset &a, int16_t *out) {
+        Decoder decoder(a.data.data(), a.data.size(), a.block_size);
+        return dsp_util::decode_all(decoder, out);
+    }
+
+    template <typename Decoder>
+    size_t decode_resampled(const asset &a, int16_t *out) {
+        Decoder decoder(a.sample_rate, a.data.data(), a.data.size(), a.block_size);
+        return dsp_util::decode_all(decoder, out);
+    }
+
+    const codec codecs[] = {
+        {
+            "pcm16",
+            [](const std::vector<int16_t> &s) { return asset{ dsp_util::to_bytes(s), s.size(), AUDIO_SAMPLE_RATE }; },
+            decode_with<pcm_decoder>
+        },
+        {
+            "pcm12",
+            [](const std::vector<int16_t> &s) { return asset{ pcm12_encode(s), s.size(), AUDIO_SAMPLE_RATE }; },
+            decode_with<pcm12_decoder>
+        },
+        {
+            "lpc",
+            [](const std::vector<int16_t> &s) { return asset{ lpc_encode(s), s.size(), AUDIO_SAMPLE_RATE }; },
+            decode_with<lpc_decoder>
+        },
+        {
+            "adpcm",
+            [](const std::vector<int16_t> &s) {
+                return asset{ adpcm_encode(s, ADPCM_SAMPLES_PER_BLOCK, 1), ADPCM_SAMPLES_PER_BLOCK, AUDIO_SAMPLE_RATE };
+            },
+            decode_with<adpcm_decoder>
+        },
+        {
+            "adpcm-tr",
+            [](const std::vector<int16_t> &s) {
+                return asset{ adpcm_encode(s, ADPCM_SAMPLES_PER_BLOCK, ADPCM_TRELLIS_WIDTH), ADPCM_SAMPLES_PER_BLOCK, AUDIO_SAMPLE_RATE };
+            },
+            decode_with<adpcm_decoder>
+        },
+        {
+            "pcm16@11k",
+            [](const std::vector<int16_t> &s) {
+                const std::vector<double> source(s.begin(), s.end());
+                const auto low = dsp_util::quantise(dsp_util::reference_resample(source, AUDIO_SAMPLE_RATE, LOW_RATE));
+                return asset{ dsp_util::to_bytes(low), low.size(), LOW_RATE };
+            },
+            decode_resampled<resampler<pcm_decoder>>
+        },
+    };
+    constexpr size_t codec_count = sizeof(codecs) / sizeof(codecs[0]);
+
+    struct measurement {
+        size_t bytes = 0;
+        size_t samples = 0;
+        uint64_t cycles = 0;
+        double snr = 0.0;
+        double segmental_snr = 0.0;
+    };
+
+    // Lossless formats have no noise at all
+    std::string db(double value) {
+        char text[16];
+        snprintf(text, sizeof(text), value >= 999.0 ? "inf" : "%.1f", value);
+        return text;
+    }
+
+    measurement measure(const codec &c, const std::vector<int16_t> &source) {
+        const asset encoded = c.encode(source);
+        // Some formats pad or round the length, so leave some room
+        std::vector<int16_t> decoded(source.size() + ADPCM_SAMPLES_PER_BLOCK);
+
+        measurement m;
+        m.bytes = encoded.data.size();
+        m.cycles = ~uint64_t(0);
+        for (int repeat = 0; repeat < REPEATS; ++repeat) {
+            const uint64_t start = bench::cycles();
+            m.samples = c.decode(encoded, decoded.data());
+            m.cycles = std::min(m.cycles, bench::cycles() - start);
+            bench::keep(decoded[0]);
+        }
+        decoded.resize(m.samples);
+        m.snr = dsp_util::snr_db(source, decoded);
+        m.segmental_snr = dsp_util::segmental_snr_db(source, decoded);
+        return m;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *csv_path = nullptr;
+    int arg = 1;
+    if (argc > 2 && !strcmp(argv[1], "-o")) {
+        csv_path = argv[2];
+        arg = 3;
+    }
+    const auto tokens = bench::load_raw_tokens(argc > arg ? argv[arg] : NUMBERBOX_RAW_DIR);
+    if (tokens.empty()) {
+        fprintf(stderr, "No .raw files found\n");
+        return 1;
+    }
+
+    FILE *csv = nullptr;
+    if (csv_path) {
+        csv = fopen(csv_path, "w");
+        if (!csv) {
+            perror(csv_path);
+            return 1;
+        }
+        fprintf(csv, "token,codec,bytes,samples,%s_per_sample,snr_db,segmental_snr_db\n", bench::cycles_unit());
+    }
+
+    measurement totals[codec_count];
+    printf("%-10s %-10s %8s %7s %11s %8s %8s\n", "token", "codec", "bytes", "ratio", "cost/sample", "SNR", "segSNR");
+    for (const auto &token : tokens) {
+        const auto source = dsp_util::to_samples(token.bytes);
+        for (size_t c = 0; c < codec_count; ++c) {
+            const measurement m = measure(codecs[c], source);
+            const double per_sample = static_cast<double>(m.cycles) / m.samples;
+            printf("%-10s %-10s %8zu %6.1f%% %11.1f %7s %8.1f\n", token.name.c_str(), codecs[c].name, m.bytes,
+                   100.0 * m.bytes / token.bytes.size(), per_sample, db(m.snr).c_str(), m.segmental_snr);
+            if (csv) {
+                fprintf(csv, "%s,%s,%zu,%zu,%.2f,%.2f,%.2f\n", token.name.c_str(), codecs[c].name, m.bytes, m.samples,
+                        per_sample, m.snr, m.segmental_snr);
+            }
+            totals[c].bytes += m.bytes;
+            totals[c].samples += m.samples;
+            totals[c].cycles += m.cycles;
+            totals[c].snr += m.snr;
+            totals[c].segmental_snr += m.segmental_snr;
+        }
+    }
+    if (csv) {
+        fclose(csv);
+    }
+
+    size_t source_bytes = 0;
+    for (const auto &token : tokens) {
+        source_bytes += token.bytes.size();
+    }
+    printf("\nAll %zu tokens, %s per sample on this host, mean SNR over tokens\n", tokens.size(), bench::cycles_unit());
+    printf("%-10s %8s %7s %11s %8s %8s\n", "codec", "bytes", "ratio", "cost/sample", "SNR", "segSNR");
+    for (size_t c = 0; c < codec_count; ++c) {
+        const auto &t = totals[c];
+        printf("%-10s %8zu %6.1f%% %11.1f %7s %8.1f\n", codecs[c].name, t.bytes, 100.0 * t.bytes / source_bytes,
+               static_cast<double>(t.cycles) / t.samples, db(t.snr / tokens.size()).c_str(), t.segmental_snr / tokens.size());
+    }
+    return 0;
+}
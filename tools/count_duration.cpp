@@ -0,0 +1,359 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Spoken duration calculator.
+ *
+ * Works out exactly how long the box spends speaking a range of numbers, using
+ * the token lengths in the linked voice blob and utterance_plan's overlap
+ * rules, and how long counting through the range takes with SILENCE_MS after
+ * each number.  Any range of 32 bit numbers takes a few dozen steps, so
+ * milestones such as the count reaching 3,000,000 can be predicted without
+ * planning billions of numbers.  Also reports the count rate for each power of
+ * ten in the range, which drops as the numbers get longer.
+ *
+ * number_to_speech works in groups of three digits, each followed by its scale
+ * word, so the sum over a range is a digit DP over the groups.  Where a token
+ * starts depends on the token before it, and on how much of that one was
+ * already overlapped, so the time each group adds depends on what came before.
+ * A scale word at least twice the overlap always ends the same way, whatever
+ * came before it, so the only thing carried from one group to the next is
+ * which scale word, if any, was spoken last.  That is checked for the voice.
+ * The time each group adds after each scale word comes from planning the
+ * scale word followed by the group's tokens from number_to_speech.
+ *
+ * numbers_pwm starts the silence when the last buffer of a number has been
+ * handed over, so on the box up to AUDIO_BUFFER_COUNT buffers of each number
+ * play out during it, and the real pace is a little quicker.
+ *
+ * With -c, also plays every number in the range through the firmware
+ * audio_player, against a stand-in for the audio output that counts the
+ * samples handed to it, and checks the speaking time against what was played
+ * and against the sum of the planned durations.  Playing takes a while, so
+ * keep the range small.
+ *
+ * Usage: count_duration [-c] first last
+ */
+
+#include "fail.h"
+#include "audio.h"
+#include "constants.h"
+#include "audio_player.h"
+#include "token_decoder.h"
+#include "utterance_plan.h"
+#include "number_to_speech.h"
+
+#include "pico/audio_pwm.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+    constexpr uint32_t OVERLAP_SAMPLES = constants::OVERLAP_MS * AUDIO_SAMPLE_RATE / 1000;
+    constexpr size_t TOKENS = zero + 1;
+    constexpr size_t GROUPS = 4;                    // Units, thousands, millions, billions
+    constexpr uint32_t GROUP = 1000;
+    constexpr uint32_t GROUP_SCALE[GROUPS] = { 1, 1000, 1000000, 1000000000 };
+    constexpr uint32_t TOP_GROUP_LIMIT = 5;         // 32 bit numbers have at most 4 billion
+
+    // Output samples for each token
+    uint64_t token_samples[TOKENS];
+
+    // The time each group value adds with its scale word, by the scale word
+    // spoken before it, 0 for none, and running totals over values below v.
+    // Group 0 has no scale word, and after one may start with "and".
+    struct group_table {
+        uint64_t cost[GROUP];
+        uint64_t below[GROUP + 1];
+    };
+    group_table scaled[GROUPS][GROUPS];
+    group_table units[GROUPS];
+    constexpr number_token scale_word[GROUPS] = { error, thousand, million, billion };
+
+    // Time tokens add to an utterance, spoken after a scale word or on their own
+    uint64_t spoken(size_t before, const number_tokens &tokens, size_t from = 0) {
+        static utterance_plan plan;
+        number_tokens sequence;
+        if (before) {
+            sequence.push_back(scale_word[before]);
+        }
+        for (size_t i = from; i < tokens.size(); ++i) {
+            sequence.push_back(tokens[i]);
+        }
+        plan.compile(sequence);
+        return plan.duration() - (before ? token_samples[scale_word[before]] : 0);
+    }
+
+    void fill_totals(group_table &table, uint32_t limit) {
+        table.below[0] = 0;
+        for (uint32_t v = 0; v < GROUP; ++v) {
+            table.below[v + 1] = table.below[v] + (v < limit ? table.cost[v] : 0);
+        }
+    }
+
+    bool build_tables() {
+        for (size_t t = 0; t < TOKENS; ++t) {
+            const auto &asset = audio::get_sample_data(static_cast<number_token>(t));
+            if (!asset.data) {
+                fprintf(stderr, "No audio for token %zu, planned numbers would skip it\n", t);
+                return false;
+            }
+            token_samples[t] = token_length(asset);
+        }
+        // Groups only add up if each scale word ends the same whatever came before
+        for (size_t p = 1; p < GROUPS; ++p) {
+            if (token_samples[scale_word[p]] < 2 * OVERLAP_SAMPLES) {
+                fprintf(stderr, "Scale word %d is shorter than twice the overlap\n", scale_word[p]);
+                return false;
+            }
+        }
+
+        for (size_t k = 1; k < GROUPS; ++k) {
+            const uint32_t limit = k + 1 == GROUPS ? TOP_GROUP_LIMIT : GROUP;
+            for (size_t p = 0; p < GROUPS; ++p) {
+                scaled[k][p].cost[0] = 0;
+                for (uint32_t v = 1; v < limit; ++v) {
+                    scaled[k][p].cost[v] = spoken(p, number_to_speech(v * GROUP_SCALE[k]));
+                }
+                fill_totals(scaled[k][p], limit);
+            }
+        }
+
+        for (size_t p = 0; p < GROUPS; ++p) {
+            units[p].cost[0] = 0;
+            for (uint32_t v = 1; v < GROUP; ++v) {
+                // After a scale word as after "one thousand", without them
+                units[p].cost[v] = p ? spoken(p, number_to_speech(GROUP + v), 2) : spoken(0, number_to_speech(v));
+            }
+            fill_totals(units[p], GROUP);
+        }
+        return true;
+    }
+
+    // Numbers so far with a given scale word last, and their speaking time.
+    // Unsigned arithmetic wraps, which is harmless as the totals are positive.
+    struct partial {
+        uint64_t count;
+        uint64_t samples;
+    };
+    typedef partial state[GROUPS];                 // By the group of the last scale word, 0 for none
+
+    // Groups 1 to 3 taking each value in [lo, hi)
+    void add_group(const state &in, state &out, size_t k, uint32_t lo, uint32_t hi) {
+        if (lo >= hi) {
+            return;
+        }
+        const uint32_t first_nonzero = std::max<uint32_t>(lo, 1);
+        const uint64_t nonzero = hi - first_nonzero;
+        for (size_t p = 0; p < GROUPS; ++p) {
+            const partial &from = in[p];
+            if (lo == 0) {
+                out[p].count += from.count;
+                out[p].samples += from.samples;
+            }
+            if (nonzero) {
+                const uint64_t costs = scaled[k][p].below[hi] - scaled[k][p].below[first_nonzero];
+                out[k].count += from.count * nonzero;
+                out[k].samples += from.samples * nonzero + from.count * costs;
+            }
+        }
+    }
+
+    // Group 0 taking each value in [lo, hi), ending the numbers
+    partial finish(const state &in, uint32_t lo, uint32_t hi) {
+        partial total = { 0, 0 };
+        if (lo >= hi) {
+            return total;
+        }
+        const uint32_t first_nonzero = std::max<uint32_t>(lo, 1);
+        const uint64_t nonzero = hi - first_nonzero;
+        for (size_t p = 0; p < GROUPS; ++p) {
+            const partial &from = in[p];
+            if (lo == 0) {
+                total.count += from.count;
+                total.samples += from.samples;
+            }
+            if (nonzero) {
+                total.count += from.count * nonzero;
+                total.samples += from.samples * nonzero + from.count * (units[p].below[hi] - units[p].below[first_nonzero]);
+            }
+        }
+        return total;
+    }
+
+    // Speaking time of every number from 1 to x, with 0 counted as silent
+    partial up_to(uint64_t x) {
+        uint32_t digits[GROUPS];
+        for (size_t k = 0; k < GROUPS; ++k) {
+            digits[k] = static_cast<uint32_t>(x / GROUP_SCALE[k] % GROUP);
+        }
+        digits[GROUPS - 1] = static_cast<uint32_t>(x / GROUP_SCALE[GROUPS - 1]);
+
+        // Numbers below x in an earlier group, and the numbers with every group so far equal to x
+        state below = {};
+        state exact = {};
+        exact[0] = { 1, 0 };
+        for (size_t k = GROUPS; k-- > 1; ) {
+            state next_below = {};
+            state next_exact = {};
+            add_group(below, next_below, k, 0, k + 1 == GROUPS ? TOP_GROUP_LIMIT : GROUP);
+            add_group(exact, next_below, k, 0, digits[k]);
+            add_group(exact, next_exact, k, digits[k], digits[k] + 1);
+            memcpy(below, next_below, sizeof(below));
+            memcpy(exact, next_exact, sizeof(exact));
+        }
+        const partial a = finish(below, 0, GROUP);
+        const partial b = finish(exact, 0, digits[0] + 1);
+        return { a.count + b.count, a.samples + b.samples };
+    }
+
+    // Speaking time of every number in [first, last]
+    uint64_t range_samples(uint32_t first, uint32_t last) {
+        uint64_t samples = up_to(last).samples;
+        if (first == 0) {
+            samples += token_samples[zero];
+        } else {
+            samples -= up_to(first - 1).samples;
+        }
+        return samples;
+    }
+
+    // Samples handed to the stand-in audio output
+    uint64_t played_samples = 0;
+
+    struct check_result {
+        uint64_t planned;
+        uint64_t played;
+    };
+
+    // Plan and play every number in [first, last], as numbers_pwm would
+    check_result play_range(uint32_t first, uint32_t last) {
+        static audio_player player;
+        static utterance_plan plan;
+        check_result result = { 0, 0 };
+        played_samples = 0;
+        for (uint64_t n = first; n <= last; ++n) {
+            plan.compile(number_to_speech(static_cast<uint32_t>(n)));
+            result.planned += plan.duration();
+            player.play(plan);
+        }
+        result.played = played_samples;
+        return result;
+    }
+
+    const char *format_time(double seconds) {
+        static char text[64];
+        const uint64_t whole = static_cast<uint64_t>(seconds);
+        snprintf(text, sizeof(text), "%llud %02u:%02u:%02u", static_cast<unsigned long long>(whole / 86400),
+                 static_cast<unsigned>(whole / 3600 % 24), static_cast<unsigned>(whole / 60 % 60),
+                 static_cast<unsigned>(whole % 60));
+        return text;
+    }
+
+    double counting_seconds(uint64_t samples, uint64_t numbers) {
+        return static_cast<double>(samples) / AUDIO_SAMPLE_RATE + numbers * (constants::SILENCE_MS / 1000.0);
+    }
+}
+
+// Stand-ins for the pico-extras audio output, just counting what is played
+struct audio_buffer_pool {
+    audio_buffer_t buffers[AUDIO_BUFFER_COUNT];
+    mem_buffer_t memory[AUDIO_BUFFER_COUNT];
+    int16_t storage[AUDIO_BUFFER_COUNT][AUDIO_BUFFER_SAMPLE_LENGTH];
+    size_t next;
+};
+
+audio_pwm_channel_config_t default_mono_channel_config = {};
+
+audio_buffer_pool_t *audio_new_producer_pool(audio_buffer_format_t *format, int buffer_count, int buffer_sample_count) {
+    static audio_buffer_pool pool;
+    for (size_t i = 0; i < AUDIO_BUFFER_COUNT; ++i) {
+        pool.memory[i] = mem_buffer_t{ sizeof(pool.storage[i]), reinterpret_cast<uint8_t *>(pool.storage[i]), 0 };
+        pool.buffers[i] = audio_buffer_t{ &pool.memory[i], format, 0, AUDIO_BUFFER_SAMPLE_LENGTH, 0, nullptr };
+    }
+    return &pool;
+}
+
+audio_buffer_t *take_audio_buffer(audio_buffer_pool_t *pool, bool block) {
+    audio_buffer_t *buffer = &pool->buffers[pool->next];
+    pool->next = (pool->next + 1) % AUDIO_BUFFER_COUNT;
+    return buffer;
+}
+
+void give_audio_buffer(audio_buffer_pool_t *pool, audio_buffer_t *buffer) {
+    played_samples += buffer->sample_count;
+}
+
+void queue_free_audio_buffer(audio_buffer_pool_t *pool, audio_buffer_t *buffer) { }
+
+const audio_format_t *audio_pwm_setup(const audio_format_t *intended_audio_format, int32_t max_latency_ms,
+                                      const audio_pwm_channel_config_t *channel_config0, ...) {
+    return intended_audio_format;
+}
+
+void audio_pwm_set_correction_mode(enum audio_correction_mode mode) { }
+bool audio_pwm_default_connect(audio_buffer_pool_t *producer_pool, bool dedicate_core_1) { return true; }
+void audio_pwm_set_enabled(bool enabled) { }
+
+void fail_init() { }
+
+void fail(fail_t failure) {
+    fprintf(stderr, "fail(%d)\n", static_cast<int>(failure));
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    bool check = false;
+    int arg = 1;
+    if (argc > arg && !strcmp(argv[arg], "-c")) {
+        check = true;
+        arg += 1;
+    }
+    if (argc != arg + 2) {
+        fprintf(stderr, "Usage: %s [-c] first last\n", argv[0]);
+        return 1;
+    }
+    const unsigned long long first = strtoull(argv[arg], nullptr, 0);
+    const unsigned long long last = strtoull(argv[arg + 1], nullptr, 0);
+    if (first > last || last > UINT32_MAX) {
+        fprintf(stderr, "Need 0 <= first <= last <= %u\n", UINT32_MAX);
+        return 1;
+    }
+
+    audio::init();
+    if (!build_tables()) {
+        return 1;
+    }
+
+    printf("%10s %10s %12s %10s %12s\n", "from", "to", "numbers", "s/number", "numbers/h");
+    for (uint64_t decade = 1; decade <= UINT32_MAX; decade *= 10) {
+        const uint64_t lo = std::max<uint64_t>(first, decade == 1 ? 0 : decade);
+        const uint64_t hi = std::min<uint64_t>(last, std::min<uint64_t>(decade * 10 - 1, UINT32_MAX));
+        if (lo <= hi) {
+            const uint64_t numbers = hi - lo + 1;
+            const double seconds = counting_seconds(range_samples(lo, hi), numbers);
+            printf("%10llu %10llu %12llu %10.3f %12.0f\n", static_cast<unsigned long long>(lo),
+                   static_cast<unsigned long long>(hi), static_cast<unsigned long long>(numbers),
+                   seconds / numbers, numbers * 3600.0 / seconds);
+        }
+    }
+
+    const uint64_t numbers = last - first + 1;
+    const uint64_t samples = range_samples(first, last);
+    printf("\n%llu numbers from %llu to %llu\n", static_cast<unsigned long long>(numbers), first, last);
+    printf("Speaking %llu samples, %s\n", static_cast<unsigned long long>(samples),
+           format_time(static_cast<double>(samples) / AUDIO_SAMPLE_RATE));
+    printf("Counting with %ums silences %s\n", static_cast<unsigned>(constants::SILENCE_MS),
+           format_time(counting_seconds(samples, numbers)));
+
+    if (check) {
+        const check_result result = play_range(static_cast<uint32_t>(first), static_cast<uint32_t>(last));
+        printf("Planned %llu samples, %s\n", static_cast<unsigned long long>(result.planned),
+               result.planned == samples ? "match" : "MISMATCH");
+        printf("Played %llu samples, %s\n", static_cast<unsigned long long>(result.played),
+               result.played == samples ? "match" : "MISMATCH");
+        return result.planned == samples && result.played == samples ? 0 : 1;
+    }
+    return 0;
+}
@@ -0,0 +1,148 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Signal helpers shared by the host tools
+ */
+
+#ifndef DSP_UTIL_H
+#define DSP_UTIL_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dsp_util {
+    inline std::vector<int16_t> to_samples(const std::vector<uint8_t> &bytes) {
+        std::vector<int16_t> samples(bytes.size() / 2);
+        for (size_t i = 0; i < samples.size(); ++i) {
+            samples[i] = static_cast<int16_t>(bytes[2 * i] | bytes[2 * i + 1] << 8);
+        }
+        return samples;
+    }
+
+    inline std::vector<uint8_t> to_bytes(const std::vector<int16_t> &samples) {
+        std::vector<uint8_t> bytes(samples.size() * 2);
+        for (size_t i = 0; i < samples.size(); ++i) {
+            bytes[2 * i] = samples[i] & 0xFF;
+            bytes[2 * i + 1] = (samples[i] >> 8) & 0xFF;
+        }
+        return bytes;
+    }
+
+    /**
+     * Signal to noise ratio in dB of test against reference, over their common length.
+     */
+    template <typename Reference>
+    double snr_db(const std::vector<Reference> &reference, const std::vector<int16_t> &test) {
+        double signal = 0.0;
+        double noise = 0.0;
+        const size_t n = std::min(reference.size(), test.size());
+        for (size_t i = 0; i < n; ++i) {
+            const double r = reference[i];
+            const double e = r - test[i];
+            signal += r * r;
+            noise += e * e;
+        }
+        return noise == 0.0 ? 999.0 : 10.0 * std::log10(signal / noise);
+    }
+
+    /**
+     * Segmental SNR in dB, the mean of the SNR of short frames.  Each frame is
+     * limited to [-10, 35] dB as usual, and near silent frames are skipped so
+     * that they don't dominate the result.
+     */
+    template <typename Reference>
+    double segmental_snr_db(const std::vector<Reference> &reference, const std::vector<int16_t> &test, size_t frame = 256) {
+        constexpr double SILENCE_POWER = 100.0 * 100.0;
+        double total = 0.0;
+        size_t frames = 0;
+        const size_t n = std::min(reference.size(), test.size());
+        for (size_t start = 0; start + frame <= n; start += frame) {
+            double signal = 0.0;
+            double noise = 0.0;
+            for (size_t i = start; i < start + frame; ++i) {
+                const double r = reference[i];
+                const double e = r - test[i];
+                signal += r * r;
+                noise += e * e;
+            }
+            if (signal / frame < SILENCE_POWER) {
+                continue;
+            }
+            const double snr = noise == 0.0 ? 35.0 : 10.0 * std::log10(signal / noise);
+            total += std::clamp(snr, -10.0, 35.0);
+            frames += 1;
+        }
+        return frames == 0 ? 0.0 : total / frames;
+    }
+
+    /**
+     * Slow but accurate floating point windowed sinc sample rate conversion,
+     * used for making reference signals and lower rate assets.
+     */
+    inline std::vector<double> reference_resample(const std::vector<double> &in, uint32_t in_rate, uint32_t out_rate) {
+        constexpr int HALF_TAPS = 64;
+        const double PI = std::acos(-1.0);
+        const double cutoff = 0.9 * std::min(1.0, static_cast<double>(out_rate) / in_rate);
+        const size_t out_len = static_cast<size_t>(static_cast<uint64_t>(in.size()) * out_rate / in_rate);
+        const double scale = std::max(1.0, static_cast<double>(in_rate) / out_rate);
+        std::vector<double> out(out_len);
+        for (size_t n = 0; n < out_len; ++n) {
+            const double t = static_cast<double>(n) * in_rate / out_rate;
+            const long centre = static_cast<long>(std::floor(t));
+            const long reach = static_cast<long>(HALF_TAPS * scale);
+            double sum = 0.0;
+            for (long k = centre - reach + 1; k <= centre + reach; ++k) {
+                if (k < 0 || k >= static_cast<long>(in.size())) {
+                    continue;
+                }
+                const double x = (t - k) * cutoff;
+                const double sinc = x == 0.0 ? 1.0 : std::sin(PI * x) / (PI * x);
+                const double w = 0.5 + (t - k) / (2.0 * reach);
+                const double window = 0.42 - 0.5 * std::cos(2 * PI * w) + 0.08 * std::cos(4 * PI * w);
+                sum += in[k] * cutoff * sinc * window;
+            }
+            out[n] = sum;
+        }
+        return out;
+    }
+
+    inline std::vector<int16_t> quantise(const std::vector<double> &in) {
+        std::vector<int16_t> out(in.size());
+        for (size_t i = 0; i < in.size(); ++i) {
+            out[i] = static_cast<int16_t>(std::lround(std::clamp(in[i], -32768.0, 32767.0)));
+        }
+        return out;
+    }
+
+    // Decoders with a block read() are used that way, otherwise a sample at a time
+    template <typename Decoder, typename = void>
+    struct has_read : std::false_type { };
+
+    template <typename Decoder>
+    struct has_read<Decoder, std::void_t<decltype(std::declval<Decoder &>().read(nullptr, 0))>> : std::true_type { };
+
+    /**
+     * Decode everything from a decoder into out, which must be big enough.
+     *
+     * @return Number of samples decoded
+     */
+    template <typename Decoder>
+    size_t decode_all(Decoder &decoder, int16_t *out) {
+        if constexpr (has_read<Decoder>::value) {
+            return decoder.read(out, decoder.size());
+        } else {
+            size_t n = 0;
+            while (!decoder.empty()) {
+                out[n++] = decoder.next();
+            }
+            return n;
+        }
+    }
+}
+
+#endif // DSP_UTIL_H
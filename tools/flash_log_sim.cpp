@@ -0,0 +1,315 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Counter log simulator.
+ *
+ * Runs the firmware counter_store against an emulated NOR flash, counting as
+ * numbers_pwm does, with a value saved every COUNTER_SAVE_INTERVAL numbers and
+ * flush() called in the silence after each one.  The flash can only clear bits
+ * when programming, only in whole pages, and only set them again by erasing a
+ * whole sector, and any attempt to do otherwise is reported.
+ *
+ * The wear run counts through -n numbers and reports how many times each
+ * sector was erased, and how long the most worn one lasts at the rated
+ * endurance.
+ *
+ * The crash runs each start from a different state of the reserved sectors,
+ * count for a while and lose power part way through a random erase or program.
+ * A torn program clears a random subset of the bits it should have cleared,
+ * or gets part way through the page in order, and a torn erase sets a random
+ * subset of the bits it should have set.  The
+ * value found after the next boot must be the last one fully written, or the
+ * one being written when power was lost, and the log must carry on correctly
+ * from there.
+ *
+ * Usage: flash_log_sim [-n numbers] [-c crashes]
+ */
+
+#include "bench.h"
+
+#include "fail.h"
+#include "constants.h"
+#include "counter_store.h"
+
+#include "hardware/flash.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+    constexpr uint64_t DEFAULT_NUMBERS = 20000000;
+    constexpr uint32_t DEFAULT_CRASHES = 2000;
+    constexpr uint32_t ENDURANCE_CYCLES = 100000;   // W25Q series erase/program cycles per sector
+    constexpr double NUMBERS_PER_DAY = 12500.0;     // About 7s a number, as count_duration gives for 7 digits
+    constexpr uint32_t MAX_NUMBERS_BEFORE_CRASH = 40000;
+    constexpr uint32_t NUMBERS_AFTER_CRASH = 10000;
+    constexpr uint32_t NUMBERS_PER_SECTOR = FLASH_SECTOR_SIZE / 8 * constants::COUNTER_SAVE_INTERVAL;
+    constexpr size_t SECTORS = constants::COUNTER_LOG_SECTORS;
+    constexpr uint32_t LOG_OFFSET = 0;
+
+    struct power_lost { };
+
+    // Emulated flash, just the reserved sectors
+    std::vector<uint8_t> flash(SECTORS * FLASH_SECTOR_SIZE, 0xff);
+    std::vector<uint64_t> erase_counts(SECTORS);
+    uint64_t violations = 0;
+    // Kinds of flash operation, counted separately so that power can be lost
+    // in the rarer ones often enough
+    enum operation { PROGRAM, ERASE, FIRST_PROGRAM, OPERATIONS };
+    uint64_t operations[OPERATIONS] = {};
+    uint64_t crash_at[OPERATIONS] = { UINT64_MAX, UINT64_MAX, UINT64_MAX };
+    bool torn_erase = false;
+    bool torn_all = false;                          // Operation done, power lost before it returned
+    size_t torn_at = 0;                             // Bytes done in order before this one, or all at random
+    constexpr size_t TORN_AT_RANDOM = SIZE_MAX;
+    std::mt19937 rng(0x5eed);
+
+    bool random_bit() {
+        return rng() & 1;
+    }
+
+    // Whether a bit of byte i of a torn operation got there
+    bool torn_bit_done(size_t i) {
+        if (torn_all || torn_at == TORN_AT_RANDOM) {
+            return torn_all || random_bit();
+        }
+        return i < torn_at || (i == torn_at && random_bit());
+    }
+
+    bool crashing(operation kind) {
+        if (operations[kind]++ != crash_at[kind]) {
+            return false;
+        }
+        torn_erase = kind == ERASE;
+        torn_all = rng() % 4 == 0;
+        torn_at = torn_erase || rng() % 2 ? TORN_AT_RANDOM : rng() % FLASH_PAGE_SIZE;
+        return true;
+    }
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+    if (flash_offs % FLASH_SECTOR_SIZE || count % FLASH_SECTOR_SIZE || flash_offs - LOG_OFFSET + count > flash.size()) {
+        violations += 1;
+        return;
+    }
+    uint8_t *data = flash.data() + (flash_offs - LOG_OFFSET);
+    const bool torn = crashing(ERASE);
+    for (size_t i = 0; i < count; ++i) {
+        if (!torn) {
+            data[i] = 0xff;
+        } else {
+            for (int bit = 0; bit < 8; ++bit) {
+                if (torn_bit_done(i)) {
+                    data[i] |= 1 << bit;
+                }
+            }
+        }
+    }
+    for (size_t sector = 0; sector < count / FLASH_SECTOR_SIZE; ++sector) {
+        erase_counts[(flash_offs - LOG_OFFSET) / FLASH_SECTOR_SIZE + sector] += 1;
+    }
+    if (torn) {
+        throw power_lost();
+    }
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count) {
+    if (flash_offs % FLASH_PAGE_SIZE || count % FLASH_PAGE_SIZE || flash_offs - LOG_OFFSET + count > flash.size()) {
+        violations += 1;
+        return;
+    }
+    uint8_t *to = flash.data() + (flash_offs - LOG_OFFSET);
+    const bool torn = crashing(PROGRAM) | (flash_offs % FLASH_SECTOR_SIZE == 0 && crashing(FIRST_PROGRAM));
+    for (size_t i = 0; i < count; ++i) {
+        // Programming can only clear bits, and should only be done once
+        // between erases
+        if (data[i] != 0xff && to[i] != 0xff) {
+            violations += 1;
+        }
+        const uint8_t cleared = to[i] & ~data[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            if ((cleared & (1 << bit)) && (!torn || torn_bit_done(i))) {
+                to[i] &= ~(1 << bit);
+            }
+        }
+    }
+    if (torn) {
+        throw power_lost();
+    }
+}
+
+void fail_init() { }
+
+void fail(fail_t failure) {
+    fprintf(stderr, "fail(%d)\n", static_cast<int>(failure));
+    exit(1);
+}
+
+namespace {
+    // The counter as numbers_pwm keeps it, with the last value known to be in
+    // flash and the one being written
+    struct counting {
+        counter_store store{ flash.data(), LOG_OFFSET, SECTORS };
+        uint32_t value = 1;
+        uint32_t durable = 0;
+        uint32_t in_flight = 0;
+        bool have_durable = false;
+
+        void boot() {
+            uint32_t logged = 0;
+            have_durable = store.load(logged);
+            durable = in_flight = logged;
+            value = have_durable ? logged : 1;
+        }
+
+        void count(uint64_t numbers) {
+            for (uint64_t i = 0; i < numbers; ++i) {
+                value += 1;
+                if (value % constants::COUNTER_SAVE_INTERVAL == 0) {
+                    store.save(value);
+                    in_flight = value;
+                }
+                store.flush();
+                if (store.saved() && in_flight != durable) {
+                    durable = in_flight;
+                    have_durable = true;
+                }
+            }
+        }
+    };
+
+    // A starting state for the reserved sectors
+    void prepare_flash(uint32_t trial) {
+        switch (trial % 3) {
+        case 0:
+            // Fresh from the factory
+            std::fill(flash.begin(), flash.end(), 0xff);
+            break;
+        case 1:
+            // Whatever was there before
+            for (auto &byte : flash) {
+                byte = static_cast<uint8_t>(rng());
+            }
+            break;
+        default:
+            // Carry on from the last trial
+            break;
+        }
+    }
+
+    bool run_wear(uint64_t numbers) {
+        std::fill(flash.begin(), flash.end(), 0xff);
+        std::fill(erase_counts.begin(), erase_counts.end(), 0);
+        counting counter;
+        counter.boot();
+        counter.count(numbers);
+
+        const auto worn = std::minmax_element(erase_counts.begin(), erase_counts.end());
+        const auto &stats = counter.store.get_stats();
+        printf("Counted %llu numbers: %u records, %u erases, %llu to %llu erases per sector\n",
+               static_cast<unsigned long long>(numbers), stats.records, stats.erases,
+               static_cast<unsigned long long>(*worn.first), static_cast<unsigned long long>(*worn.second));
+        if (*worn.second) {
+            const double days = numbers / NUMBERS_PER_DAY * ENDURANCE_CYCLES / *worn.second;
+            printf("At %.0f numbers a day the most worn sector reaches %u erases after %.0f years\n",
+                   NUMBERS_PER_DAY, ENDURANCE_CYCLES, days / 365.25);
+        }
+
+        counting reboot;
+        const uint64_t start = bench::cycles();
+        reboot.boot();
+        const uint64_t elapsed = bench::cycles() - start;
+        printf("Boot finds %u (last saved %u) in %llu %s\n", reboot.durable, counter.durable,
+               static_cast<unsigned long long>(elapsed), bench::cycles_unit());
+        return *worn.second - *worn.first <= 1 && reboot.have_durable && reboot.durable == counter.durable;
+    }
+
+    bool run_crashes(uint32_t crashes) {
+        std::uniform_int_distribution<uint32_t> numbers_before(1, MAX_NUMBERS_BEFORE_CRASH);
+        uint32_t torn_erases = 0;
+        uint32_t torn_programs = 0;
+        uint32_t landed = 0;
+        uint32_t failures = 0;
+        for (uint32_t trial = 0; trial < crashes; ++trial) {
+            prepare_flash(trial);
+            counting before;
+            before.boot();
+
+            // Lose power part way through some erase or program, aiming for
+            // each kind in turn as there are far fewer erases, or programs
+            // that start a sector
+            const uint32_t numbers = numbers_before(rng);
+            const auto kind = static_cast<operation>(trial % OPERATIONS);
+            const uint32_t expected = kind == PROGRAM ? numbers / constants::COUNTER_SAVE_INTERVAL
+                                                      : numbers / NUMBERS_PER_SECTOR;
+            crash_at[kind] = operations[kind] + rng() % (expected + 1);
+            try {
+                before.count(numbers);
+                crash_at[kind] = UINT64_MAX;
+                continue;
+            } catch (const power_lost &) {
+                crash_at[kind] = UINT64_MAX;
+            }
+            torn_erases += torn_erase;
+            torn_programs += !torn_erase;
+
+            // The value written last, or the one being written
+            counting after;
+            after.boot();
+            bool ok = after.have_durable || !before.have_durable;
+            if (after.have_durable) {
+                ok = ok && (after.durable == before.durable || after.durable == before.in_flight);
+                landed += after.durable != before.durable;
+            }
+
+            // And the log carries on from there
+            after.count(NUMBERS_AFTER_CRASH);
+            counting again;
+            again.boot();
+            ok = ok && again.have_durable && again.durable == after.durable;
+            if (!ok) {
+                failures += 1;
+                printf("Trial %u: saved %u, writing %u, found %u%s, then %u for %u\n", trial, before.durable,
+                       before.in_flight, after.durable, after.have_durable ? "" : " (none)", again.durable,
+                       after.durable);
+            }
+        }
+        printf("%u power losses, %u in an erase and %u in a program, %u with the value being written found\n",
+               torn_erases + torn_programs, torn_erases, torn_programs, landed);
+        printf("%u failed to recover\n", failures);
+        return failures == 0;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t numbers = DEFAULT_NUMBERS;
+    uint32_t crashes = DEFAULT_CRASHES;
+    int arg = 1;
+    while (argc > arg + 1 && argv[arg][0] == '-') {
+        if (!strcmp(argv[arg], "-n")) {
+            numbers = strtoull(argv[arg + 1], nullptr, 0);
+        } else if (!strcmp(argv[arg], "-c")) {
+            crashes = strtoul(argv[arg + 1], nullptr, 0);
+        } else {
+            break;
+        }
+        arg += 2;
+    }
+    if (argc != arg) {
+        fprintf(stderr, "Usage: %s [-n numbers] [-c crashes]\n", argv[0]);
+        return 1;
+    }
+
+    const bool wear_ok = run_wear(numbers);
+    const bool crashes_ok = run_crashes(crashes);
+    printf("%llu flash operations out of spec\n", static_cast<unsigned long long>(violations));
+    if (!wear_ok || !crashes_ok || violations) {
+        printf("COUNTER LOG CHECK FAILED\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,256 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Battery power policy simulator.
+ *
+ * Runs power_governor, as numbers_pwm runs it, against a simulated LiPo
+ * discharged by the firmware energy model, then charged back up.  The cell
+ * follows an open circuit voltage curve with internal resistance, and each
+ * reading has noise and the ADC's quantisation added, so the policy sees
+ * something like what the firmware would.  Each number costs what
+ * battery_life says it does, with the governor's volume, silence and clock.
+ *
+ * Checks that the levels only step down, once each, on the way down and only
+ * step up, once each, on charging, that counting stops before the battery
+ * reaches its cutoff, and that warnings are given.  Then compares how far
+ * the charge went with the governor against counting with fixed settings.
+ *
+ * Exits with 1 if a check fails.
+ *
+ * Usage: governor_sim [-m battery_mah] [-r noise_mv] [-s seed]
+ */
+
+#include "fail.h"
+#include "audio.h"
+#include "constants.h"
+#include "energy_model.h"
+#include "token_decoder.h"
+#include "power_governor.h"
+#include "utterance_plan.h"
+#include "number_to_speech.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+namespace {
+    constexpr uint32_t AUDIO_CLOCK_HZ = 48000000;
+    constexpr double CHARGE_MA = 500.0;
+    constexpr double INTERNAL_OHMS = 0.15;
+    constexpr double ADC_LSB_MV = 3.0 * 3300.0 / 4096.0;  // As battery_monitor scales it
+    constexpr uint32_t ADC_SAMPLES = 16;
+
+    // Open circuit voltage of a LiPo cell against state of charge, in 5% steps
+    constexpr double OCV_MV[] = {
+        3300, 3500, 3580, 3630, 3670, 3700, 3720, 3740, 3760, 3780, 3800,
+        3820, 3840, 3870, 3900, 3940, 3980, 4030, 4080, 4140, 4200,
+    };
+    constexpr size_t OCV_STEPS = sizeof(OCV_MV) / sizeof(OCV_MV[0]) - 1;
+
+    energy_model::calibration calibration = energy_model::CALIBRATION;
+    double noise_mv = 15.0;
+    std::mt19937 rng(1);
+
+    double ocv_mv(double charge) {
+        const double at = std::clamp(charge, 0.0, 1.0) * OCV_STEPS;
+        const size_t i = std::min<size_t>(static_cast<size_t>(at), OCV_STEPS - 1);
+        return OCV_MV[i] + (OCV_MV[i + 1] - OCV_MV[i]) * (at - i);
+    }
+
+    // What battery_monitor would read, with the cell giving battery_ma
+    uint32_t read_mv(double charge, double battery_ma) {
+        std::uniform_real_distribution<double> noise(-noise_mv, noise_mv);
+        const double mv = ocv_mv(charge) - battery_ma * INTERNAL_OHMS;
+        double sum = 0.0;
+        for (uint32_t i = 0; i < ADC_SAMPLES; ++i) {
+            sum += std::floor((mv + noise(rng)) / ADC_LSB_MV);
+        }
+        return static_cast<uint32_t>(sum * ADC_LSB_MV / ADC_SAMPLES);
+    }
+
+    uint64_t samples_to_us(uint64_t samples) {
+        return samples * 1000000 / AUDIO_SAMPLE_RATE;
+    }
+
+    // Counters for one pass of the numbers_pwm loop, as battery_life works
+    // them out, with the settings for the level
+    energy_model::activity pass_activity(const utterance_plan *plan, const power_governor::settings &settings) {
+        energy_model::activity activity = {};
+        activity.sleep_us = static_cast<uint64_t>(settings.silence_ms) * 1000;
+        activity.clock_hz = settings.clock_khz ? settings.clock_khz * 1000 : AUDIO_CLOCK_HZ;
+        if (plan) {
+            uint64_t flash_bytes = 0;
+            for (const auto &entry : *plan) {
+                if (audio::in_flash(*entry.asset)) {
+                    const size_t length = token_length(*entry.asset);
+                    flash_bytes += length ? static_cast<uint64_t>(entry.asset->size) * entry.length / length : 0;
+                }
+            }
+            activity.pwm_on_us = samples_to_us(plan->duration());
+            activity.active_cycles = static_cast<uint64_t>(calibration.cycles_per_sample * plan->duration()
+                                                           + calibration.cycles_per_token * plan->size()
+                                                           + calibration.cycles_per_utterance);
+            activity.xip_misses = (flash_bytes + energy_model::XIP_LINE_BYTES - 1) / energy_model::XIP_LINE_BYTES;
+            activity.utterances = 1;
+        }
+        activity.elapsed_us = activity.pwm_on_us + activity.sleep_us;
+        return activity;
+    }
+
+    // Energy for one pass, with the amplifier's share scaled by the volume
+    double pass_mj(const energy_model::activity &activity, uint32_t volume_percent) {
+        energy_model::calibration cal = calibration;
+        const double gain = static_cast<double>(volume_percent) / constants::VOLUME_PERCENT;
+        cal.pwm_ma *= gain * gain;
+        return energy_model::energy_mj(activity, cal);
+    }
+
+    struct run_result {
+        uint64_t numbers = 0;
+        double counting_hours = 0.0;        // Until counting stopped
+        double hours = 0.0;                 // Until the cutoff, or fully charged
+        uint32_t steps_down = 0;
+        uint32_t steps_up = 0;
+        uint32_t warnings = 0;
+        bool stopped = false;               // Counting stopped before the cutoff
+        double level_charge[power_governor::LEVEL_COUNT] = {};
+    };
+
+    /**
+     * Run until the cell reaches its cutoff or, charging, is full
+     *
+     * @param governor Policy to run, or nullptr for fixed NORMAL settings
+     * @param charge State of charge, updated
+     * @param charging Charge at CHARGE_MA, instead of discharging
+     */
+    run_result run(power_governor *governor, double &charge, bool charging) {
+        static const power_governor fixed;
+        static utterance_plan plan;
+        static utterance_plan warning;
+        const double capacity_mj = calibration.battery_mah * calibration.battery_v * 3600.0;
+
+        run_result result;
+        uint32_t counter = 1;
+        double battery_ma = 0.0;
+        double elapsed_us = 0.0;
+        power_governor::level level = governor ? governor->get_level() : power_governor::LEVEL_NORMAL;
+        while (charging ? charge < 1.0 : charge > 0.0) {
+            const auto &settings = governor ? governor->get_settings() : fixed.get_settings();
+            const bool critical = settings.state == power_governor::LEVEL_CRITICAL;
+            const utterance_plan *spoken = nullptr;
+            if (!critical) {
+                plan.compile(number_to_speech(counter++));
+                spoken = &plan;
+                result.numbers += 1;
+            }
+            if (governor && governor->take_warning()) {
+                warning.compile(number_to_speech(governor->filtered_mv()));
+                if (!spoken || warning.duration() > spoken->duration()) {
+                    spoken = &warning;
+                }
+                result.warnings += 1;
+            }
+
+            const auto activity = pass_activity(spoken, settings);
+            const double mj = pass_mj(activity, settings.volume_percent);
+            const double seconds = activity.elapsed_us / 1e6;
+            battery_ma = mj / ocv_mv(charge) * 1000.0 / seconds;
+            const double net_ma = charging ? battery_ma - CHARGE_MA : battery_ma;
+            charge -= net_ma * seconds * ocv_mv(charge) / 1000.0 / capacity_mj;
+            elapsed_us += activity.elapsed_us;
+            if (!critical) {
+                result.counting_hours = elapsed_us / 3.6e9;
+            } else if (!charging) {
+                result.stopped = true;
+            }
+
+            if (governor && governor->update(read_mv(charge, net_ma))) {
+                const auto now = governor->get_level();
+                if (now > level) {
+                    result.steps_down += now - level;
+                } else {
+                    result.steps_up += level - now;
+                }
+                result.level_charge[now] = charge;
+                level = now;
+            }
+        }
+        result.hours = elapsed_us / 3.6e9;
+        return result;
+    }
+
+    const char *LEVEL_NAMES[power_governor::LEVEL_COUNT] = { "normal", "saving", "low", "critical" };
+}
+
+void fail_init() { }
+
+void fail(fail_t failure) {
+    fprintf(stderr, "fail(%d)\n", static_cast<int>(failure));
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    int arg = 1;
+    while (argc > arg + 1 && argv[arg][0] == '-') {
+        if (!strcmp(argv[arg], "-m")) {
+            calibration.battery_mah = strtod(argv[arg + 1], nullptr);
+        } else if (!strcmp(argv[arg], "-r")) {
+            noise_mv = strtod(argv[arg + 1], nullptr);
+        } else if (!strcmp(argv[arg], "-s")) {
+            rng.seed(strtoul(argv[arg + 1], nullptr, 0));
+        } else {
+            break;
+        }
+        arg += 2;
+    }
+    if (argc != arg || calibration.battery_mah <= 0.0) {
+        fprintf(stderr, "Usage: %s [-m battery_mah] [-r noise_mv] [-s seed]\n", argv[0]);
+        return 1;
+    }
+
+    audio::init();
+
+    double charge = 1.0;
+    const auto fixed = run(nullptr, charge, false);
+    printf("Fixed settings: %llu numbers, flat after %.1f hours\n",
+           static_cast<unsigned long long>(fixed.numbers), fixed.hours);
+
+    power_governor governor;
+    charge = 1.0;
+    const auto down = run(&governor, charge, false);
+    printf("Governor:       %llu numbers over %.1f hours, counting stopped, flat after %.1f hours\n",
+           static_cast<unsigned long long>(down.numbers), down.counting_hours, down.hours);
+    for (int level = power_governor::LEVEL_SAVING; level < power_governor::LEVEL_COUNT; ++level) {
+        printf("  %-8s at %4.1f%% charge\n", LEVEL_NAMES[level], 100.0 * down.level_charge[level]);
+    }
+    printf("  %u warnings\n", down.warnings);
+
+    charge = 0.0;
+    const auto up = run(&governor, charge, true);
+    printf("Charging:       back to %s after %.1f hours\n", LEVEL_NAMES[governor.get_level()], up.hours);
+
+    bool ok = true;
+    const uint32_t steps = power_governor::LEVEL_COUNT - 1;
+    if (down.steps_down != steps || down.steps_up != 0) {
+        printf("FAIL: %u steps down and %u up while discharging, expected %u and 0\n",
+               down.steps_down, down.steps_up, steps);
+        ok = false;
+    }
+    if (!down.stopped) {
+        printf("FAIL: still counting at the cutoff\n");
+        ok = false;
+    }
+    if (down.warnings < 2) {
+        printf("FAIL: %u warnings, expected one each for low and critical at least\n", down.warnings);
+        ok = false;
+    }
+    if (up.steps_up != steps || up.steps_down != 0 || governor.get_level() != power_governor::LEVEL_NORMAL) {
+        printf("FAIL: %u steps up and %u down while charging, expected %u and 0\n",
+               up.steps_up, up.steps_down, steps);
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Losslessly compress raw PCM asset files for lpc_decoder.
+ *
+ * Each output is decoded again with the firmware decoder and checked against
+ * the input bit for bit before it is written.
+ *
+ * Usage: lpc_encode input.raw output.lpc
+ */
+
+#include "lpc_encoder.h"
+#include "lpc_decoder.h"
+
+#include <cstdio>
+#include <vector>
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s input.raw output.lpc\n", argv[0]);
+        return 2;
+    }
+
+    FILE *in = fopen(argv[1], "rb");
+    if (!in) {
+        perror(argv[1]);
+        return 1;
+    }
+    std::vector<int16_t> samples;
+    uint8_t pair[2];
+    while (fread(pair, 1, 2, in) == 2) {
+        samples.push_back(static_cast<int16_t>(pair[0] | pair[1] << 8));
+    }
+    fclose(in);
+
+    const auto encoded = lpc_encode(samples);
+
+    lpc_decoder decoder(encoded.data(), encoded.size(), samples.size());
+    std::vector<int16_t> decoded(samples.size());
+    decoder.read(decoded.data(), decoded.size());
+    if (decoded != samples || !decoder.empty()) {
+        fprintf(stderr, "%s: round trip mismatch\n", argv[1]);
+        return 1;
+    }
+
+    FILE *out = fopen(argv[2], "wb");
+    if (!out || fwrite(encoded.data(), 1, encoded.size(), out) != encoded.size()) {
+        perror(argv[2]);
+        return 1;
+    }
+    fclose(out);
+
+    printf("%s: %zu samples, %zu -> %zu bytes (%.1f%%)\n", argv[1], samples.size(),
+           samples.size() * 2, encoded.size(), 100.0 * encoded.size() / (samples.size() * 2));
+    return 0;
+}
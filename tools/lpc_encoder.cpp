@@ -0,0 +1,133 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Lossless LPC + Rice encoder
+ */
+
+#include "lpc_encoder.h"
+#include "lpc_decoder.h"
+
+#include <algorithm>
+
+namespace {
+    constexpr uint32_t MAX_RICE_K = 24;
+
+    class bit_writer {
+    public:
+        void write(uint32_t value, int bits) {
+            for (int i = bits - 1; i >= 0; --i) {
+                write_bit((value >> i) & 1);
+            }
+        }
+
+        void write_unary(uint32_t zeros) {
+            for (uint32_t i = 0; i < zeros; ++i) {
+                write_bit(0);
+            }
+            write_bit(1);
+        }
+
+        std::vector<uint8_t> finish() {
+            while (used != 0) {
+                write_bit(0);
+            }
+            return bytes;
+        }
+
+    private:
+        std::vector<uint8_t> bytes;
+        uint8_t current = 0;
+        int used = 0;
+
+        void write_bit(uint32_t bit) {
+            current = static_cast<uint8_t>(current << 1 | bit);
+            if (++used == 8) {
+                bytes.push_back(current);
+                current = 0;
+                used = 0;
+            }
+        }
+    };
+
+    int32_t predict(int order, const int32_t *history) {
+        const int32_t s1 = history[0], s2 = history[1], s3 = history[2], s4 = history[3];
+        switch (order) {
+        case 0:  return 0;
+        case 1:  return s1;
+        case 2:  return 2 * s1 - s2;
+        case 3:  return 3 * (s1 - s2) + s3;
+        default: return 4 * (s1 + s3) - 6 * s2 - s4;
+        }
+    }
+
+    uint32_t fold(int32_t residual) {
+        return static_cast<uint32_t>(residual << 1) ^ static_cast<uint32_t>(residual >> 31);
+    }
+
+    uint64_t rice_bits(const std::vector<uint32_t> &folded, uint32_t k) {
+        uint64_t bits = 0;
+        for (const uint32_t u : folded) {
+            bits += (u >> k) + 1 + k;
+        }
+        return bits;
+    }
+}
+
+std::vector<uint8_t> lpc_encode(const std::vector<int16_t> &samples) {
+    bit_writer out;
+    int32_t history[lpc_decoder::MAX_ORDER] = { };
+
+    for (size_t start = 0; start < samples.size(); start += lpc_decoder::FRAME_SIZE) {
+        const size_t length = std::min(lpc_decoder::FRAME_SIZE, samples.size() - start);
+
+        uint64_t best_bits = 16 * length;
+        int best_order = -1;
+        uint32_t best_k = lpc_decoder::VERBATIM;
+        std::vector<uint32_t> best_folded;
+
+        for (int order = 0; order <= lpc_decoder::MAX_ORDER; ++order) {
+            std::vector<uint32_t> folded(length);
+            int32_t h[lpc_decoder::MAX_ORDER];
+            std::copy(history, history + lpc_decoder::MAX_ORDER, h);
+            for (size_t i = 0; i < length; ++i) {
+                const int32_t sample = samples[start + i];
+                folded[i] = fold(sample - predict(order, h));
+                h[3] = h[2];
+                h[2] = h[1];
+                h[1] = h[0];
+                h[0] = sample;
+            }
+            for (uint32_t k = 0; k <= MAX_RICE_K; ++k) {
+                const uint64_t bits = rice_bits(folded, k);
+                if (bits < best_bits) {
+                    best_bits = bits;
+                    best_order = order;
+                    best_k = k;
+                    best_folded = folded;
+                }
+            }
+        }
+
+        if (best_order < 0) {
+            out.write(lpc_decoder::VERBATIM, 8);
+            for (size_t i = 0; i < length; ++i) {
+                out.write(static_cast<uint16_t>(samples[start + i]), 16);
+            }
+        } else {
+            out.write(static_cast<uint32_t>(best_order) << 5 | best_k, 8);
+            for (const uint32_t u : best_folded) {
+                out.write_unary(u >> best_k);
+                out.write(u & ((1u << best_k) - 1), best_k);
+            }
+        }
+
+        for (size_t i = 0; i < length; ++i) {
+            history[3] = history[2];
+            history[2] = history[1];
+            history[1] = history[0];
+            history[0] = samples[start + i];
+        }
+    }
+
+    return out.finish();
+}
@@ -0,0 +1,25 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Lossless LPC + Rice encoder, the host side of lpc_decoder
+ */
+
+#ifndef LPC_ENCODER_H
+#define LPC_ENCODER_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Losslessly encode 16-bit PCM samples in the format read by lpc_decoder.
+ *
+ * For each frame every fixed predictor order and Rice parameter is tried, and
+ * the smallest encoding is used, falling back to verbatim samples if nothing
+ * beats them.
+ *
+ * @param samples The samples to encode
+ * @return The encoded bit stream, padded with zeros to a whole byte
+ */
+std::vector<uint8_t> lpc_encode(const std::vector<int16_t> &samples);
+
+#endif // LPC_ENCODER_H
@@ -0,0 +1,46 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Simple work sharing over cores for the host tools
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+    inline unsigned default_threads() {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    /**
+     * Call work(i) for every i in [0, count), spread over up to threads threads.
+     *
+     * Items are handed out one at a time, so the order they run in is not
+     * defined.  Anything that must be reproducible should only depend on i.
+     */
+    template <typename Work>
+    void for_each_index(size_t count, unsigned threads, Work work) {
+        std::atomic<size_t> next{ 0 };
+        std::vector<std::thread> workers;
+        const unsigned n = static_cast<unsigned>(std::min<size_t>(std::max(1u, threads), count));
+        for (unsigned t = 0; t < n; ++t) {
+            workers.emplace_back([&]() {
+                size_t index;
+                while ((index = next++) < count) {
+                    work(index);
+                }
+            });
+        }
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+}
+
+#endif // PARALLEL_H
@@ -0,0 +1,57 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Packed 12-bit PCM encoder
+ */
+
+#include "pcm12_encoder.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    constexpr int32_t STEP = 16;     // One 12 bit LSB in 16 bit units
+
+    // Small fixed seed generator so that the output is reproducible
+    class dither_source {
+    public:
+        double next() {
+            state = state * 1664525u + 1013904223u;
+            return static_cast<double>(state >> 8) / (1u << 24);
+        }
+
+    private:
+        uint32_t state = 1;
+    };
+}
+
+std::vector<uint8_t> pcm12_encode(const std::vector<int16_t> &samples) {
+    std::vector<int32_t> quantised;
+    quantised.reserve(samples.size() + 1);
+
+    dither_source rng;
+    double e1 = 0.0;
+    double e2 = 0.0;
+    for (const int16_t sample : samples) {
+        const double wanted = sample - 2.0 * e1 + e2;
+        const double dither = (rng.next() - rng.next()) * STEP;
+        const int32_t q = std::clamp(static_cast<int32_t>(std::floor((wanted + dither) / STEP + 0.5)), -2048, 2047);
+        e2 = e1;
+        e1 = q * static_cast<double>(STEP) - wanted;
+        quantised.push_back(q);
+    }
+    if (quantised.size() % 2) {
+        quantised.push_back(0);
+    }
+
+    std::vector<uint8_t> packed;
+    packed.reserve(quantised.size() / 2 * 3);
+    for (size_t i = 0; i < quantised.size(); i += 2) {
+        const uint32_t first = quantised[i] & 0xFFF;
+        const uint32_t second = quantised[i + 1] & 0xFFF;
+        packed.push_back(first & 0xFF);
+        packed.push_back(static_cast<uint8_t>(first >> 8 | (second & 0x0F) << 4));
+        packed.push_back(static_cast<uint8_t>(second >> 4));
+    }
+    return packed;
+}
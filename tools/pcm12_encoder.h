@@ -0,0 +1,24 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Packed 12-bit PCM encoder, the host side of pcm12_decoder
+ */
+
+#ifndef PCM12_ENCODER_H
+#define PCM12_ENCODER_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Requantise 16-bit PCM to 12 bits and pack two samples into three bytes.
+ *
+ * Uses TPDF dither and second order error feedback noise shaping.  The dither
+ * sequence is fixed, so the output is reproducible.
+ *
+ * @param samples The samples to encode
+ * @return The packed samples, with a zero sample added if the count is odd
+ */
+std::vector<uint8_t> pcm12_encode(const std::vector<int16_t> &samples);
+
+#endif // PCM12_ENCODER_H
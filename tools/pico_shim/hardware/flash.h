@@ -0,0 +1,21 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Host stand-in for the Pico SDK flash programming API, just enough for
+ * flash_log_sim to run the firmware counter_store.  See flash_log_sim.cpp for
+ * the implementation.
+ */
+
+#ifndef PICO_SHIM_FLASH_H
+#define PICO_SHIM_FLASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+
+#endif // PICO_SHIM_FLASH_H
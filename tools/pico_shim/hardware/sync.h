@@ -0,0 +1,18 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Host stand-in for the Pico SDK interrupt masking.
+ */
+
+#ifndef PICO_SHIM_SYNC_H
+#define PICO_SHIM_SYNC_H
+
+#include <cstdint>
+
+inline uint32_t save_and_disable_interrupts() {
+    return 0;
+}
+
+inline void restore_interrupts(uint32_t status) { }
+
+#endif // PICO_SHIM_SYNC_H
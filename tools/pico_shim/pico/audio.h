@@ -0,0 +1,50 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Host stand-in for the pico-extras audio buffer API, just enough for
+ * player_sim and count_duration to run the firmware audio_player.  See
+ * player_sim.cpp and count_duration.cpp for the implementations.
+ */
+
+#ifndef PICO_SHIM_AUDIO_H
+#define PICO_SHIM_AUDIO_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define AUDIO_BUFFER_FORMAT_PCM_S16 1
+
+typedef struct mem_buffer {
+    size_t size;
+    uint8_t *bytes;
+    uint8_t flags;
+} mem_buffer_t;
+
+typedef struct audio_format {
+    uint32_t sample_freq;
+    uint16_t format;
+    uint16_t channel_count;
+} audio_format_t;
+
+typedef struct audio_buffer_format {
+    const audio_format_t *format;
+    uint16_t sample_stride;
+} audio_buffer_format_t;
+
+typedef struct audio_buffer {
+    mem_buffer_t *buffer;
+    const audio_buffer_format_t *format;
+    uint32_t sample_count;
+    uint32_t max_sample_count;
+    uint32_t user_data;
+    struct audio_buffer *next;
+} audio_buffer_t;
+
+typedef struct audio_buffer_pool audio_buffer_pool_t;
+
+audio_buffer_pool_t *audio_new_producer_pool(audio_buffer_format_t *format, int buffer_count, int buffer_sample_count);
+audio_buffer_t *take_audio_buffer(audio_buffer_pool_t *pool, bool block);
+void give_audio_buffer(audio_buffer_pool_t *pool, audio_buffer_t *buffer);
+void queue_free_audio_buffer(audio_buffer_pool_t *pool, audio_buffer_t *buffer);
+
+#endif // PICO_SHIM_AUDIO_H
@@ -0,0 +1,32 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Host stand-in for the pico-extras PWM audio output.
+ */
+
+#ifndef PICO_SHIM_AUDIO_PWM_H
+#define PICO_SHIM_AUDIO_PWM_H
+
+#include "pico/audio.h"
+
+typedef struct audio_pwm_channel_config {
+    struct {
+        unsigned int base_pin;
+    } core;
+} audio_pwm_channel_config_t;
+
+extern audio_pwm_channel_config_t default_mono_channel_config;
+
+enum audio_correction_mode {
+    none,
+    fixed_dither,
+    dither,
+};
+
+const audio_format_t *audio_pwm_setup(const audio_format_t *intended_audio_format, int32_t max_latency_ms,
+                                      const audio_pwm_channel_config_t *channel_config0, ...);
+void audio_pwm_set_correction_mode(enum audio_correction_mode mode);
+bool audio_pwm_default_connect(audio_buffer_pool_t *producer_pool, bool dedicate_core_1);
+void audio_pwm_set_enabled(bool enabled);
+
+#endif // PICO_SHIM_AUDIO_PWM_H
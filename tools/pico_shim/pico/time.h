@@ -0,0 +1,22 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Host stand-in for the Pico SDK microsecond timer.
+ */
+
+#ifndef PICO_SHIM_TIME_H
+#define PICO_SHIM_TIME_H
+
+#include <chrono>
+#include <cstdint>
+
+inline uint64_t time_us_64() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline uint32_t time_us_32() {
+    return static_cast<uint32_t>(time_us_64());
+}
+
+#endif // PICO_SHIM_TIME_H
@@ -0,0 +1,349 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Player simulator.
+ *
+ * Runs the firmware audio_player against a host stand-in for the pico-extras
+ * producer pool, speaking a run of numbers with the linked voice blob exactly
+ * as numbers_pwm would, and writes everything that reaches the output to a
+ * raw file.  Comparing that file before and after a change to the player
+ * shows whether the change alters the sound at all.  Also reports how many
+ * buffers were played in place, the host cost per sample, the longest time
+ * spent filling a buffer and the output peaks, with -v to try other volumes,
+ * and checks that each utterance played on its own lasts exactly as long as
+ * its utterance_plan said it would.  Each buffer is checked to still hold what
+ * it was given when the pool gets it back, as sample data lent to the output
+ * must not change until it has played.
+ *
+ * With -p, preempts the counting that many times at random moments with an
+ * urgent utterance, and reports the latency from each preempt() call to the
+ * urgent utterance being heard.  Playback time is modelled by the output
+ * consuming samples at a steady rate, with the player waiting for a buffer to
+ * finish playing whenever none are free.
+ *
+ * With -s, keeps that many overlay streams speaking over the counting at a
+ * higher priority, so that the counting is ducked, which shows the cost of
+ * each stream mixed.
+ *
+ * Reports the heap allocations made, by the offset in player_sim of the code
+ * that made them, for addr2line.  With -a, stops with
+ * FAIL_STEADY_STATE_ALLOCATION at the first allocation once that many numbers
+ * have been said, as numbers_pwm does.
+ *
+ * Usage: player_sim [-o out.raw] [-v volume_percent] [-p preemptions] [-s overlays] [-a utterances] [first [count]]
+ */
+
+#include "bench.h"
+
+#include "fail.h"
+#include "audio.h"
+#include "constants.h"
+#include "alloc_profiler.h"
+#include "audio_player.h"
+#include "utterance_plan.h"
+#include "number_to_speech.h"
+
+#include "pico/audio_pwm.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+// Start of the image, from the linker script
+extern "C" const char __executable_start;
+
+namespace {
+    constexpr uint32_t DEFAULT_FIRST = 1;
+    constexpr uint32_t DEFAULT_COUNT = 200;
+    constexpr uint32_t URGENT_NUMBER = 999;
+    constexpr uint32_t OVERLAY_NUMBER = 777;
+    constexpr uint32_t MIN_PREEMPT_GAP = AUDIO_SAMPLE_RATE / 4;     // Samples between preemptions
+    constexpr uint32_t MAX_PREEMPT_GAP = AUDIO_SAMPLE_RATE * 3;
+    constexpr uint32_t FADE_SAMPLES = constants::PREEMPT_FADE_MS * AUDIO_SAMPLE_RATE / 1000;
+
+    std::vector<int16_t> output;
+
+    // Playback clock in samples.  Output sample i is heard at time i.
+    uint64_t now = 0;
+
+    // Preemption trials
+    audio_player *player = nullptr;
+    std::mt19937 rng(0x5eed);
+    utterance_plan urgent[2];     // Alternate, as the last one may still be playing
+    uint32_t trials_left = 0;
+    uint64_t preempt_at = std::numeric_limits<uint64_t>::max();
+    uint64_t preempted_at = 0;
+    uint32_t preemptions_seen = 0;
+    bool fade_seen = false;
+    std::vector<uint64_t> latencies;
+
+    // Overlays, restarted as each one finishes
+    utterance_plan overlays[constants::MAX_STREAMS];
+
+    void schedule_preemption() {
+        preempt_at = std::numeric_limits<uint64_t>::max();
+        if (trials_left) {
+            preempt_at = now + std::uniform_int_distribution<uint32_t>(MIN_PREEMPT_GAP, MAX_PREEMPT_GAP)(rng);
+        }
+    }
+
+    // Called as the clock moves on, as an interrupt handler would be
+    void clock_moved(uint64_t from) {
+        if (preempt_at <= now) {
+            preempted_at = std::max(preempt_at, from);
+            utterance_plan &plan = urgent[trials_left % 2];
+            plan.compile(number_to_speech(URGENT_NUMBER));
+            fade_seen = false;
+            player->preempt(plan);
+            trials_left -= 1;
+            preempt_at = std::numeric_limits<uint64_t>::max();
+        }
+    }
+
+    // After a preemption is noticed the next buffer holds the fade, and the
+    // one after that starts the urgent utterance
+    void buffer_given(size_t start) {
+        if (!player || player->get_playback_stats().preemptions == preemptions_seen) {
+            return;
+        }
+        if (!fade_seen) {
+            fade_seen = true;
+        } else {
+            latencies.push_back(start - preempted_at);
+            preemptions_seen = player->get_playback_stats().preemptions;
+            schedule_preemption();
+        }
+    }
+}
+
+// Producer pool.  Buffers are handed out in rotation, each once it has
+// finished playing, and given buffers are consumed straight away, like the
+// blocking give of the PWM connection.
+struct audio_buffer_pool {
+    std::vector<audio_buffer_t> buffers;
+    std::vector<mem_buffer_t> memory;
+    std::vector<std::vector<int16_t>> storage;
+    std::vector<uint64_t> played_by;
+    std::vector<std::vector<int16_t>> given;    // What each buffer held when it was given
+    size_t next = 0;
+};
+
+namespace {
+    // Buffers whose samples changed between being given and being played out,
+    // as lent sample data overwritten while still queued would
+    uint32_t changed_buffers = 0;
+}
+
+audio_pwm_channel_config_t default_mono_channel_config = {};
+
+audio_buffer_pool_t *audio_new_producer_pool(audio_buffer_format_t *format, int buffer_count, int buffer_sample_count) {
+    static audio_buffer_pool pool;
+    pool.buffers.resize(buffer_count);
+    pool.memory.resize(buffer_count);
+    pool.storage.resize(buffer_count);
+    pool.played_by.resize(buffer_count);
+    pool.given.resize(buffer_count);
+    for (int i = 0; i < buffer_count; ++i) {
+        pool.storage[i].resize(buffer_sample_count);
+        pool.given[i].reserve(buffer_sample_count);
+        pool.memory[i] = mem_buffer_t{ buffer_sample_count * sizeof(int16_t),
+                                       reinterpret_cast<uint8_t *>(pool.storage[i].data()), 0 };
+        pool.buffers[i] = audio_buffer_t{ &pool.memory[i], format, 0, static_cast<uint32_t>(buffer_sample_count), 0, nullptr };
+    }
+    return &pool;
+}
+
+audio_buffer_t *take_audio_buffer(audio_buffer_pool_t *pool, bool block) {
+    const size_t index = pool->next;
+    pool->next = (pool->next + 1) % pool->buffers.size();
+    if (pool->played_by[index] > now) {
+        const uint64_t from = now;
+        now = pool->played_by[index];
+        clock_moved(from);
+    }
+    // The output has been reading the buffer all this time
+    const audio_buffer_t &buffer = pool->buffers[index];
+    const auto &given = pool->given[index];
+    changed_buffers += !std::equal(given.begin(), given.end(), reinterpret_cast<const int16_t *>(buffer.buffer->bytes));
+    return &pool->buffers[index];
+}
+
+void give_audio_buffer(audio_buffer_pool_t *pool, audio_buffer_t *buffer) {
+    buffer_given(output.size());
+    const int16_t *samples = reinterpret_cast<const int16_t *>(buffer->buffer->bytes);
+    output.insert(output.end(), samples, samples + buffer->sample_count);
+    pool->given[buffer - pool->buffers.data()].assign(samples, samples + buffer->sample_count);
+    pool->played_by[buffer - pool->buffers.data()] = output.size();
+}
+
+// Buffers are handed out in rotation anyway
+void queue_free_audio_buffer(audio_buffer_pool_t *pool, audio_buffer_t *buffer) { }
+
+const audio_format_t *audio_pwm_setup(const audio_format_t *intended_audio_format, int32_t max_latency_ms,
+                                      const audio_pwm_channel_config_t *channel_config0, ...) {
+    return intended_audio_format;
+}
+
+void audio_pwm_set_correction_mode(enum audio_correction_mode mode) { }
+bool audio_pwm_default_connect(audio_buffer_pool_t *producer_pool, bool dedicate_core_1) { return true; }
+void audio_pwm_set_enabled(bool enabled) { }
+
+void fail_init() { }
+
+void fail(fail_t failure) {
+    fprintf(stderr, "fail(%d)\n", static_cast<int>(failure));
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    const char *out_path = nullptr;
+    uint32_t volume = constants::VOLUME_PERCENT;
+    uint32_t overlay_count = 0;
+    uint32_t steady_after = 0;
+    int arg = 1;
+    while (argc > arg + 1 && argv[arg][0] == '-') {
+        if (!strcmp(argv[arg], "-o")) {
+            out_path = argv[arg + 1];
+        } else if (!strcmp(argv[arg], "-v")) {
+            volume = strtoul(argv[arg + 1], nullptr, 0);
+        } else if (!strcmp(argv[arg], "-p")) {
+            trials_left = strtoul(argv[arg + 1], nullptr, 0);
+        } else if (!strcmp(argv[arg], "-s")) {
+            overlay_count = std::min<uint32_t>(strtoul(argv[arg + 1], nullptr, 0), constants::MAX_STREAMS - 1);
+        } else if (!strcmp(argv[arg], "-a")) {
+            steady_after = strtoul(argv[arg + 1], nullptr, 0);
+        } else {
+            fprintf(stderr, "Usage: %s [-o out.raw] [-v volume_percent] [-p preemptions] [-s overlays] [-a utterances] [first [count]]\n", argv[0]);
+            return 1;
+        }
+        arg += 2;
+    }
+    const uint32_t first = argc > arg ? strtoul(argv[arg], nullptr, 0) : DEFAULT_FIRST;
+    const uint32_t count = argc > arg + 1 ? strtoul(argv[arg + 1], nullptr, 0) : DEFAULT_COUNT;
+
+    audio::init();
+    audio_player audio_out;
+    audio_out.set_volume(volume);
+    player = &audio_out;
+    schedule_preemption();
+
+    // Make room for all the output up front, so that only the player's own
+    // allocations are counted.  Preemptions, overlays still going at the
+    // end, and a buffer for each utterance, are allowed for on top.
+    utterance_plan plan;
+    size_t reserve = 0;
+    for (uint32_t n = first; n < first + count; ++n) {
+        plan.compile(number_to_speech(n));
+        reserve += plan.duration() + AUDIO_BUFFER_SAMPLE_LENGTH;
+    }
+    plan.compile(number_to_speech(URGENT_NUMBER));
+    reserve += (plan.duration() + AUDIO_BUFFER_SAMPLE_LENGTH) * trials_left;
+    for (uint32_t i = 0; i < overlay_count; ++i) {
+        plan.compile(number_to_speech(OVERLAY_NUMBER + i));
+        reserve += plan.duration() + AUDIO_BUFFER_SAMPLE_LENGTH;
+    }
+    output.reserve(reserve + AUDIO_BUFFER_COUNT * AUDIO_BUFFER_SAMPLE_LENGTH);
+    latencies.reserve(trials_left);
+    alloc_profiler::set_steady_after(steady_after);
+
+    uint32_t planned = 0;
+    uint32_t mistimed = 0;
+    const uint64_t start = bench::cycles();
+    for (uint32_t n = first; n < first + count; ++n) {
+        for (uint32_t i = 0; i < overlay_count; ++i) {
+            if (!audio_out.playing(overlays[i])) {
+                overlays[i].compile(number_to_speech(OVERLAY_NUMBER + i));
+                audio_out.overlay(overlays[i], audio_player::PRIORITY_STATUS + i);
+            }
+        }
+        plan.compile(number_to_speech(n));
+        const size_t played_from = output.size();
+        if (audio_out.play(plan) && !overlay_count) {
+            planned += 1;
+            mistimed += output.size() - played_from != plan.duration();
+        }
+        alloc_profiler::utterance_said();
+    }
+    audio_out.drain();
+    const uint64_t elapsed = bench::cycles() - start;
+
+    const auto &stats = audio_out.get_playback_stats();
+    const uint32_t buffers = stats.direct_buffers + stats.copied_buffers;
+    printf("Numbers %u to %u: %zu samples, %.1fs of audio\n", first, first + count - 1, output.size(),
+           static_cast<double>(output.size()) / AUDIO_SAMPLE_RATE);
+    printf("%u of %u buffers played in place (%.1f%%)\n", stats.direct_buffers, buffers,
+           buffers ? 100.0 * stats.direct_buffers / buffers : 0.0);
+    printf("%.2f %s per sample, worst buffer %uus", static_cast<double>(elapsed) / output.size(), bench::cycles_unit(),
+           stats.max_busy_us);
+    printf(overlay_count ? ", %u overlays started\n" : "\n", stats.overlays);
+    const auto peak = std::minmax_element(output.begin(), output.end());
+    const size_t full_scale = std::count_if(output.begin(), output.end(), [](int16_t s) {
+        return s == std::numeric_limits<int16_t>::max() || s == std::numeric_limits<int16_t>::min();
+    });
+    printf("Peaks %d / %d, %zu samples at full scale\n", *peak.first, *peak.second, full_scale);
+    if (planned) {
+        printf("%u of %u utterances played for exactly their planned duration\n", planned - mistimed, planned);
+    }
+    for (size_t i = 0; i < constants::MAX_STREAMS; ++i) {
+        const auto &mixed = stats.mixed[i];
+        if (mixed.buffers) {
+            printf("%zu %s mixed: %u buffers, %.1fns per sample\n", i + 1, i ? "streams" : "stream ", mixed.buffers,
+                   1000.0 * mixed.busy_us / mixed.samples);
+        }
+    }
+
+    const auto &heap = alloc_profiler::get_totals();
+    size_t site_count;
+    const alloc_profiler::site *sites = alloc_profiler::get_sites(site_count);
+    printf("%u heap allocations, %llu bytes, %u frees\n", heap.allocations,
+           static_cast<unsigned long long>(heap.bytes), heap.frees);
+    for (size_t i = 0; i < site_count; ++i) {
+        printf("  +0x%llx: %u allocations, %llu bytes\n",
+               static_cast<unsigned long long>(sites[i].address - reinterpret_cast<uintptr_t>(&__executable_start)),
+               sites[i].allocations, static_cast<unsigned long long>(sites[i].bytes));
+    }
+    if (heap.untracked) {
+        printf("  %u from other sites\n", heap.untracked);
+    }
+
+    if (!latencies.empty()) {
+        const uint64_t bound = AUDIO_BUFFER_COUNT * AUDIO_BUFFER_SAMPLE_LENGTH + FADE_SAMPLES;
+        const uint64_t worst = *std::max_element(latencies.begin(), latencies.end());
+        uint64_t total = 0;
+        for (const uint64_t l : latencies) {
+            total += l;
+        }
+        const auto ms = [](double samples) { return 1000.0 * samples / AUDIO_SAMPLE_RATE; };
+        printf("%zu preemptions, latency mean %.1fms worst %.1fms (%llu samples), bound %.1fms (%llu samples)\n",
+               latencies.size(), ms(static_cast<double>(total) / latencies.size()), ms(worst),
+               static_cast<unsigned long long>(worst), ms(bound), static_cast<unsigned long long>(bound));
+        if (worst > bound) {
+            printf("LATENCY BOUND EXCEEDED\n");
+            return 1;
+        }
+    }
+
+    if (mistimed) {
+        printf("PLANNED DURATION MISMATCH\n");
+        return 1;
+    }
+
+    if (changed_buffers) {
+        printf("%u BUFFERS CHANGED BEFORE THEY PLAYED\n", changed_buffers);
+        return 1;
+    }
+
+    if (out_path) {
+        FILE *f = fopen(out_path, "wb");
+        if (!f || fwrite(output.data(), sizeof(output[0]), output.size(), f) != output.size()) {
+            perror(out_path);
+            return 1;
+        }
+        fclose(f);
+    }
+    return 0;
+}
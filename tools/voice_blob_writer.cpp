@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Voice blob output for the host tools
+ */
+
+#include "voice_blob_writer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+
+const char *const TOKEN_NAMES[TOKEN_COUNT] = {
+    "and", "billion", "eight", "eighteen", "eighty", "eleven", "fifteen", "fifty",
+    "five", "forty", "four", "fourteen", "hundred", "million", "nine", "nineteen",
+    "ninety", "one", "seven", "seventeen", "seventy", "six", "sixteen", "sixty",
+    "ten", "thirteen", "thirty", "thousand", "three", "twelve", "twenty", "two",
+    "zero"
+};
+
+namespace {
+    size_t align(size_t offset) {
+        return (offset + voice::DATA_ALIGN - 1) / voice::DATA_ALIGN * voice::DATA_ALIGN;
+    }
+
+    template <typename T>
+    void put(std::vector<uint8_t> &blob, size_t offset, const T &value) {
+        // Host tools only run little endian, as does the target
+        memcpy(blob.data() + offset, &value, sizeof(value));
+    }
+}
+
+std::vector<uint8_t> build_voice_blob(const std::vector<voice_asset> &assets, const std::vector<size_t> &layout) {
+    std::vector<size_t> order = layout;
+    if (order.empty()) {
+        order.resize(assets.size());
+        std::iota(order.begin(), order.end(), 0);
+    }
+
+    const size_t index_end = sizeof(voice::header) + assets.size() * sizeof(voice::entry);
+    size_t total = align(index_end);
+    for (const auto &asset : assets) {
+        total += align(asset.data.size());
+    }
+
+    std::vector<uint8_t> blob(total, 0);
+    put(blob, 0, voice::header{ voice::MAGIC, voice::VERSION, static_cast<uint16_t>(assets.size()) });
+    size_t offset = align(index_end);
+    for (const size_t i : order) {
+        const auto &asset = assets[i];
+        const voice::entry entry{
+            static_cast<uint32_t>(offset), static_cast<uint32_t>(asset.data.size()), asset.sample_count,
+            asset.samples_per_block, static_cast<uint16_t>(asset.sample_rate), asset.codec, 0
+        };
+        put(blob, sizeof(voice::header) + i * sizeof(voice::entry), entry);
+        memcpy(blob.data() + offset, asset.data.data(), asset.data.size());
+        offset += align(asset.data.size());
+    }
+    return blob;
+}
+
+std::vector<uint64_t> token_frequencies(uint32_t numbers) {
+    std::vector<uint64_t> counts(TOKEN_COUNT, 0);
+    for (uint32_t n = 1; n <= numbers && n != 0; ++n) {
+        for (const number_token token : number_to_speech(n)) {
+            if (token >= 0 && static_cast<size_t>(token) < TOKEN_COUNT) {
+                counts[token] += 1;
+            }
+        }
+    }
+    return counts;
+}
+
+std::vector<size_t> frequency_order(const std::vector<uint64_t> &frequencies) {
+    std::vector<size_t> order(frequencies.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&frequencies](size_t a, size_t b) {
+        return frequencies[a] > frequencies[b];
+    });
+    return order;
+}
+
+bool write_file(const std::string &path, const std::vector<uint8_t> &bytes) {
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+    const bool ok = fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    return fclose(f) == 0 && ok;
+}
@@ -0,0 +1,63 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Voice blob output for the host tools
+ */
+
+#ifndef VOICE_BLOB_WRITER_H
+#define VOICE_BLOB_WRITER_H
+
+#include "number_to_speech.h"
+#include "voice_format.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr size_t TOKEN_COUNT = zero + 1;
+
+// File names of the tokens, in number_token order
+extern const char *const TOKEN_NAMES[TOKEN_COUNT];
+
+/**
+ * Encoded audio for one token.
+ */
+struct voice_asset {
+    std::vector<uint8_t> data;
+    uint32_t sample_count = 0;
+    uint32_t samples_per_block = 0;
+    uint32_t sample_rate = 0;
+    uint8_t codec = voice::CODEC_PCM16;
+};
+
+/**
+ * Lay out the blob described in voice_format.h.
+ *
+ * @param assets One asset per token, in number_token order
+ * @param layout Order to place the token data in, hottest first.  If empty,
+ *          the data is in number_token order.
+ * @return The blob, ready to be written to audio/voice.bin
+ */
+std::vector<uint8_t> build_voice_blob(const std::vector<voice_asset> &assets, const std::vector<size_t> &layout = {});
+
+/**
+ * Count how often each token is spoken when counting from 1 to numbers.
+ *
+ * @return Occurrences, indexed by number_token
+ */
+std::vector<uint64_t> token_frequencies(uint32_t numbers);
+
+/**
+ * Token indices sorted by decreasing frequency, ties in number_token order.
+ */
+std::vector<size_t> frequency_order(const std::vector<uint64_t> &frequencies);
+
+/**
+ * Write bytes to a file.
+ *
+ * @return true on success
+ */
+bool write_file(const std::string &path, const std::vector<uint8_t> &bytes);
+
+#endif // VOICE_BLOB_WRITER_H
@@ -0,0 +1,371 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Voice asset builder.
+ *
+ * Reads a WAV (or raw 16 bit PCM) file for every token, then resamples to the
+ * storage rate, trims leading and trailing silence, normalises, quantises and
+ * encodes them with one of the firmware codecs, spreading the tokens over all
+ * available cores.  Every encoded token is decoded again with the firmware
+ * voice_decoder and checked before the blob is written.
+ *
+ * All processing for a token depends only on that token's input and the
+ * options, so the output is identical from run to run whatever the number of
+ * threads.
+ *
+ * The token data is laid out in order of how often each token is spoken when
+ * counting from 1 to the -f limit, and aligned to XIP cache lines, so that the
+ * firmware can keep the hottest tokens in SRAM.
+ *
+ * Usage: voice_build [-o voice.bin] [-r rate] [-c codec] [-n dBFS|off] [-t on|off] [-i raw_rate]
+ *                    [-b samples_per_block] [-w trellis_width] [-f numbers] [-k raw_dir] [-j threads] input_dir
+ */
+
+#include "adpcm_encoder.h"
+#include "audio_file.h"
+#include "dsp_util.h"
+#include "lpc_encoder.h"
+#include "parallel.h"
+#include "pcm12_encoder.h"
+#include "voice_blob_writer.h"
+#include "voice_decoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+    // Same as the old sox "silence 1 0.1 0.2%" trimming: speech starts where the
+    // level has stayed above 0.2% of full scale for 100ms.
+    constexpr double TRIM_THRESHOLD = 0.002 * 32768.0;
+    constexpr double TRIM_WINDOW_S = 0.02;       // RMS level window
+    constexpr double TRIM_HOLD_S = 0.1;
+
+    // Sounds too much like "million" if the attack is modified
+    const std::set<std::string> NO_SILENCE_TRIM = { "billion" };
+
+    struct codec_name {
+        const char *name;
+        uint8_t codec;
+    };
+
+    const codec_name CODECS[] = {
+        { "pcm16", voice::CODEC_PCM16 },
+        { "pcm12", voice::CODEC_PCM12 },
+        { "adpcm", voice::CODEC_ADPCM },
+        { "lpc", voice::CODEC_LPC }
+    };
+
+    struct options {
+        std::string output = NUMBERBOX_VOICE_BLOB;
+        uint32_t rate = AUDIO_SAMPLE_RATE;
+        uint32_t raw_rate = AUDIO_SAMPLE_RATE;
+        uint8_t codec = voice::CODEC_PCM16;
+        bool normalise = true;
+        bool trim = true;
+        double peak_dbfs = -1.0;
+        size_t samples_per_block = 505;
+        size_t trellis_width = 32;
+        uint32_t frequency_numbers = 100000;   // 0 keeps number_token order
+        unsigned threads = parallel::default_threads();
+        std::string raw_dir;
+        std::string input_dir;
+    };
+
+    struct token_work {
+        audio_clip clip;             // Resampled and trimmed, before gain
+        bool modified = false;       // Needs dither when quantised
+        voice_asset asset;
+        std::string error;
+    };
+
+    std::mutex output_mutex;
+
+    void usage(const char *name) {
+        fprintf(stderr, "Usage: %s [-o voice.bin] [-r rate] [-c pcm16|pcm12|adpcm|lpc] [-n dBFS|off] [-t on|off] [-i raw_rate]\n"
+                        "       %*s [-b samples_per_block] [-w trellis_width] [-f numbers] [-k raw_dir] [-j threads] input_dir\n",
+                name, static_cast<int>(strlen(name)), "");
+        exit(2);
+    }
+
+    long positive(const char *name, const char *value) {
+        const long result = strtol(value, nullptr, 10);
+        if (result <= 0) {
+            usage(name);
+        }
+        return result;
+    }
+
+    options parse(int argc, char *argv[]) {
+        options opt;
+        int i = 1;
+        for (; i < argc && argv[i][0] == '-'; i += 2) {
+            if (i + 1 >= argc) {
+                usage(argv[0]);
+            }
+            const char *value = argv[i + 1];
+            if (!strcmp(argv[i], "-o")) {
+                opt.output = value;
+            } else if (!strcmp(argv[i], "-r")) {
+                opt.rate = static_cast<uint32_t>(positive(argv[0], value));
+            } else if (!strcmp(argv[i], "-i")) {
+                opt.raw_rate = static_cast<uint32_t>(positive(argv[0], value));
+            } else if (!strcmp(argv[i], "-c")) {
+                const auto found = std::find_if(std::begin(CODECS), std::end(CODECS), [value](const codec_name &c) {
+                    return !strcmp(c.name, value);
+                });
+                if (found == std::end(CODECS)) {
+                    usage(argv[0]);
+                }
+                opt.codec = found->codec;
+            } else if (!strcmp(argv[i], "-n")) {
+                opt.normalise = strcmp(value, "off") != 0;
+                opt.peak_dbfs = opt.normalise ? std::min(0.0, atof(value)) : 0.0;
+            } else if (!strcmp(argv[i], "-t")) {
+                opt.trim = strcmp(value, "off") != 0;
+            } else if (!strcmp(argv[i], "-f")) {
+                opt.frequency_numbers = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+            } else if (!strcmp(argv[i], "-b")) {
+                opt.samples_per_block = static_cast<size_t>(positive(argv[0], value)) | 1;
+            } else if (!strcmp(argv[i], "-w")) {
+                opt.trellis_width = static_cast<size_t>(positive(argv[0], value));
+            } else if (!strcmp(argv[i], "-k")) {
+                opt.raw_dir = value;
+            } else if (!strcmp(argv[i], "-j")) {
+                opt.threads = static_cast<unsigned>(positive(argv[0], value));
+            } else {
+                usage(argv[0]);
+            }
+        }
+        if (argc - i != 1 || opt.rate > UINT16_MAX) {
+            usage(argv[0]);
+        }
+        opt.input_dir = argv[i];
+        return opt;
+    }
+
+    std::string find_input(const std::string &dir, const char *token) {
+        for (const char *extension : { ".wav", ".raw" }) {
+            const auto path = std::filesystem::path(dir) / (std::string(token) + extension);
+            if (std::filesystem::exists(path)) {
+                return path.string();
+            }
+        }
+        return std::string();
+    }
+
+    // Index of the first sample of speech, see TRIM_THRESHOLD
+    size_t speech_start(const std::vector<double> &samples, uint32_t rate) {
+        const size_t window = std::max<size_t>(1, static_cast<size_t>(TRIM_WINDOW_S * rate));
+        const size_t hold = static_cast<size_t>(TRIM_HOLD_S * rate);
+        const double threshold = TRIM_THRESHOLD * TRIM_THRESHOLD * window;
+        double energy = 0.0;
+        size_t run_start = 0;
+        bool in_run = false;
+        for (size_t i = 0; i < samples.size(); ++i) {
+            energy += samples[i] * samples[i];
+            if (i >= window) {
+                energy -= samples[i - window] * samples[i - window];
+            }
+            if (energy > threshold) {
+                if (!in_run) {
+                    in_run = true;
+                    run_start = i + 1 > window ? i + 1 - window : 0;
+                }
+                if (i - run_start >= hold) {
+                    // The window reaches back before the speech, so start at its first loud sample
+                    while (std::fabs(samples[run_start]) <= TRIM_THRESHOLD) {
+                        run_start += 1;
+                    }
+                    return run_start;
+                }
+            } else {
+                in_run = false;
+            }
+        }
+        return 0;
+    }
+
+    void trim_silence(std::vector<double> &samples, uint32_t rate) {
+        const size_t start = speech_start(samples, rate);
+        std::vector<double> reversed(samples.rbegin(), samples.rend() - start);
+        const size_t end_trim = speech_start(reversed, rate);
+        samples.assign(samples.begin() + start, samples.end() - end_trim);
+    }
+
+    // TPDF dither from a generator seeded by the token, so the result doesn't
+    // depend on which thread gets there first
+    std::vector<int16_t> quantise(const std::vector<double> &samples, double gain, bool dither, uint32_t seed) {
+        std::vector<int16_t> out(samples.size());
+        uint32_t state = seed * 2654435761u + 1;
+        const auto uniform = [&state]() {
+            state = state * 1664525u + 1013904223u;
+            return static_cast<double>(state >> 8) / (1u << 24);
+        };
+        for (size_t i = 0; i < samples.size(); ++i) {
+            const double noise = dither ? uniform() - uniform() : 0.0;
+            out[i] = static_cast<int16_t>(std::lround(std::clamp(samples[i] * gain + noise, -32768.0, 32767.0)));
+        }
+        return out;
+    }
+
+    bool prepare(const options &opt, size_t token, token_work &work) {
+        const std::string input = find_input(opt.input_dir, TOKEN_NAMES[token]);
+        if (input.empty()) {
+            work.error = "no .wav or .raw input";
+            return false;
+        }
+        if (!read_audio_file(input, opt.raw_rate, work.clip, work.error)) {
+            work.error = input + ": " + work.error;
+            return false;
+        }
+        if (work.clip.sample_rate != opt.rate) {
+            work.clip.samples = dsp_util::reference_resample(work.clip.samples, work.clip.sample_rate, opt.rate);
+            work.clip.sample_rate = opt.rate;
+            work.modified = true;
+        }
+        if (opt.trim && !NO_SILENCE_TRIM.count(TOKEN_NAMES[token])) {
+            trim_silence(work.clip.samples, opt.rate);
+        }
+        for (const double sample : work.clip.samples) {
+            if (sample != std::floor(sample)) {
+                work.modified = true;
+                break;
+            }
+        }
+        return true;
+    }
+
+    std::vector<uint8_t> encode(const options &opt, const std::vector<int16_t> &samples, std::vector<int16_t> &expected) {
+        switch (opt.codec) {
+        case voice::CODEC_PCM12:
+            return pcm12_encode(samples);
+        case voice::CODEC_ADPCM:
+            expected.clear();
+            return adpcm_encode(samples, opt.samples_per_block, opt.trellis_width, &expected);
+        case voice::CODEC_LPC:
+            return lpc_encode(samples);
+        default:
+            return dsp_util::to_bytes(samples);
+        }
+    }
+
+    bool finish(const options &opt, size_t token, double gain, token_work &work) {
+        const bool dither = work.modified || gain != 1.0;
+        const auto samples = quantise(work.clip.samples, gain, dither, static_cast<uint32_t>(token));
+        work.clip.samples.clear();
+
+        std::vector<int16_t> expected = samples;
+        auto &asset = work.asset;
+        asset.data = encode(opt, samples, expected);
+        asset.sample_rate = opt.rate;
+        asset.codec = opt.codec;
+        asset.samples_per_block = opt.codec == voice::CODEC_ADPCM
+            ? static_cast<uint32_t>(opt.samples_per_block) : static_cast<uint32_t>(samples.size());
+
+        // Check the firmware decoder gets back what we expect
+        voice_decoder decoder(asset.data.data(), asset.data.size(), asset.samples_per_block, asset.codec);
+        std::vector<int16_t> decoded(decoder.size());
+        decoded.resize(decoder.read(decoded.data(), decoded.size()));
+        asset.sample_count = static_cast<uint32_t>(decoded.size());
+        const bool exact = opt.codec == voice::CODEC_PCM12
+            ? decoded.size() == samples.size()
+            : decoded.size() >= samples.size() && expected.size() >= samples.size()
+                && std::equal(decoded.begin(), decoded.begin() + samples.size(), expected.begin());
+        if (!exact) {
+            work.error = "decoder output differs from encoder";
+            return false;
+        }
+        if (!opt.raw_dir.empty()) {
+            const auto path = std::filesystem::path(opt.raw_dir) / (std::string(TOKEN_NAMES[token]) + ".raw");
+            if (!write_file(path.string(), dsp_util::to_bytes(samples))) {
+                work.error = "can't write " + path.string();
+                return false;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(output_mutex);
+        printf("%-10s %8zu samples %8zu bytes %6.1f dB\n", TOKEN_NAMES[token], samples.size(), asset.data.size(),
+               dsp_util::snr_db(samples, decoded));
+        return true;
+    }
+
+    bool report_errors(const std::vector<token_work> &work) {
+        bool ok = true;
+        for (size_t token = 0; token < work.size(); ++token) {
+            if (!work[token].error.empty()) {
+                fprintf(stderr, "%s: %s\n", TOKEN_NAMES[token], work[token].error.c_str());
+                ok = false;
+            }
+        }
+        return ok;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const options opt = parse(argc, argv);
+    const auto start = std::chrono::steady_clock::now();
+    if (!opt.raw_dir.empty()) {
+        std::filesystem::create_directories(opt.raw_dir);
+    }
+
+    std::vector<token_work> work(TOKEN_COUNT);
+    parallel::for_each_index(TOKEN_COUNT, opt.threads, [&](size_t token) {
+        prepare(opt, token, work[token]);
+    });
+    if (!report_errors(work)) {
+        return 1;
+    }
+
+    // One gain for the whole vocabulary keeps the relative level of the words
+    double gain = 1.0;
+    if (opt.normalise) {
+        double peak = 0.0;
+        for (const auto &w : work) {
+            for (const double sample : w.clip.samples) {
+                peak = std::max(peak, std::fabs(sample));
+            }
+        }
+        if (peak > 0.0) {
+            gain = 32767.0 * std::pow(10.0, opt.peak_dbfs / 20.0) / peak;
+        }
+    }
+
+    parallel::for_each_index(TOKEN_COUNT, opt.threads, [&](size_t token) {
+        finish(opt, token, gain, work[token]);
+    });
+    if (!report_errors(work)) {
+        return 1;
+    }
+
+    std::vector<voice_asset> assets;
+    for (auto &w : work) {
+        assets.push_back(std::move(w.asset));
+    }
+    std::vector<size_t> layout;
+    if (opt.frequency_numbers > 0) {
+        const auto frequencies = token_frequencies(opt.frequency_numbers);
+        layout = frequency_order(frequencies);
+        printf("Layout by frequency counting to %u:", opt.frequency_numbers);
+        for (const size_t token : layout) {
+            printf(" %s", TOKEN_NAMES[token]);
+        }
+        printf("\n");
+    }
+    const auto blob = build_voice_blob(assets, layout);
+    if (!write_file(opt.output, blob)) {
+        fprintf(stderr, "%s: can't write\n", opt.output.c_str());
+        return 1;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Wrote %s: %zu tokens, %zu bytes, gain %.3f, %.2fs\n", opt.output.c_str(), assets.size(), blob.size(), gain, seconds);
+    return 0;
+}
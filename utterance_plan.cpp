@@ -0,0 +1,72 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ */
+
+#include "fail.h"
+#include "constants.h"
+#include "token_decoder.h"
+#include "utterance_plan.h"
+
+#include <algorithm>
+
+namespace {
+    constexpr uint32_t OVERLAP_SAMPLES = constants::OVERLAP_MS * AUDIO_SAMPLE_RATE / 1000;
+
+    struct token_part {
+        const audio::sample_data *asset;
+        uint32_t length;
+        bool join_next;
+    };
+}
+
+void utterance_plan::compile(const number_tokens &tokens, int32_t gain_q16) {
+    clear();
+
+    // Tokens we have audio for, each joined to the next unless that is "and"
+    token_part parts[MAX_ENTRIES];
+    size_t part_count = 0;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        const auto &asset = audio::get_sample_data(tokens[i]);
+        if (asset.data) {
+            if (part_count == MAX_ENTRIES) {
+                fail(FAIL_PLAN_TOO_LONG);
+            }
+            const bool join_next = i + 1 != tokens.size() && tokens[i + 1] != join_and;
+            parts[part_count++] = { &asset, static_cast<uint32_t>(token_length(asset)), join_next };
+        }
+    }
+
+    uint32_t start = 0;
+    uint32_t overlapped = 0;        // Samples at the start of this token under the one before
+    for (size_t i = 0; i < part_count; ++i) {
+        const token_part &part = parts[i];
+        add(*part.asset, start, part.length, gain_q16);
+        const uint32_t end = start + part.length;
+        if (part.join_next && i + 1 < part_count) {
+            // The next token starts where this one has the overlap left, or
+            // as soon as the one before has finished if it is left with less...
+            const uint32_t solo_end = part.length > OVERLAP_SAMPLES ? part.length - OVERLAP_SAMPLES : 0;
+            const uint32_t next_start = start + std::max(overlapped, solo_end);
+            const token_part &next = parts[i + 1];
+            if (next.length > end - next_start) {
+                // ...and carries on after this one, to overlap in turn
+                overlapped = end - next_start;
+                start = next_start;
+                continue;
+            }
+            // ...but is over before this one is, so the token after it just
+            // follows this one
+            add(*next.asset, next_start, next.length, gain_q16);
+            i += 1;
+        }
+        start = end;
+        overlapped = 0;
+    }
+}
+
+void utterance_plan::add(const audio::sample_data &asset, uint32_t start, uint32_t length, int32_t gain_q16) {
+    if (length) {
+        entries[count++] = { &asset, start, length, gain_q16 };
+        total = std::max(total, start + length);
+    }
+}
@@ -0,0 +1,101 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Utterance Plan Compiler
+ */
+
+#ifndef UTTERANCE_PLAN_H
+#define UTTERANCE_PLAN_H
+
+#include "audio.h"
+#include "number_to_speech.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * A sample accurate timeline for an utterance.
+ *
+ * Compiling a token sequence works out where each token starts and how long
+ * it plays for, in output samples, before anything is played.  Tokens are
+ * joined to the one after them, overlapping by OVERLAP_MS, except before
+ * "and".  A token that is left with less than the overlap once the one before
+ * it has finished overlaps the next token with what it has left.  A token
+ * joined to one shorter than the overlap plays on past it, and the token after
+ * that then starts once it has finished.  At most two entries ever sound at
+ * once, and the total duration is known up front.
+ *
+ * audio_player starts each entry as it comes due, and has no need to know
+ * about tokens or joins.
+ */
+class utterance_plan {
+public:
+    static constexpr size_t MAX_ENTRIES = 32;      // 32 bit numbers take at most 19 tokens
+    static constexpr int32_t UNITY_GAIN = 1 << 16;
+
+    struct entry {
+        const audio::sample_data *asset;
+        uint32_t start;         // Output samples from the start of the utterance
+        uint32_t length;        // Output samples played
+        int32_t gain_q16;       // 65536 is unity
+    };
+
+    utterance_plan() = default;
+
+    /**
+     * Constructor
+     *
+     * @see compile
+     */
+    explicit utterance_plan(const number_tokens &tokens, int32_t gain_q16 = UNITY_GAIN) {
+        compile(tokens, gain_q16);
+    }
+
+    /**
+     * Lay out a token sequence, replacing anything already planned
+     *
+     * Tokens the voice has no data for are left out.  Fails with
+     * FAIL_PLAN_TOO_LONG if there are more than MAX_ENTRIES tokens.
+     *
+     * @param tokens Tokens to speak, as from number_to_speech()
+     * @param gain_q16 Gain for every entry, 65536 is unity
+     */
+    void compile(const number_tokens &tokens, int32_t gain_q16 = UNITY_GAIN);
+
+    /**
+     * Remove all entries.
+     */
+    void clear() { count = 0; total = 0; }
+
+    /**
+     * Entries, in order of start
+     */
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const entry &operator[](size_t index) const { return entries[index]; }
+    const entry *begin() const { return entries; }
+    const entry *end() const { return entries + count; }
+
+    /**
+     * Total duration, to the end of the last entry to finish
+     *
+     * @return Duration in output samples
+     */
+    uint32_t duration() const { return total; }
+
+    /**
+     * Total duration in milliseconds, rounded up
+     */
+    uint32_t duration_ms() const {
+        return static_cast<uint32_t>((static_cast<uint64_t>(total) * 1000 + AUDIO_SAMPLE_RATE - 1) / AUDIO_SAMPLE_RATE);
+    }
+
+private:
+    entry entries[MAX_ENTRIES];
+    size_t count = 0;
+    uint32_t total = 0;
+
+    void add(const audio::sample_data &asset, uint32_t start, uint32_t length, int32_t gain_q16);
+};
+
+#endif // UTTERANCE_PLAN_H
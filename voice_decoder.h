@@ -0,0 +1,153 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Runtime Codec Dispatch
+ */
+
+#ifndef VOICE_DECODER_H
+#define VOICE_DECODER_H
+
+#include "voice_format.h"
+#include "adpcm_decoder.h"
+#include "lpc_decoder.h"
+#include "pcm_decoder.h"
+#include "pcm12_decoder.h"
+
+#include <new>
+
+/**
+ * Decoder for any of the codecs that can appear in the voice blob.
+ *
+ * Each index entry says how its token is encoded, so the decoder is picked at
+ * runtime rather than when the firmware is built.  The actual decoder lives in
+ * a union, so this is no bigger than the largest of them and involves no
+ * allocation.  Unknown codecs decode as silence of zero length.
+ */
+class voice_decoder {
+public:
+    /**
+     * Constructor
+     *
+     * @param data Pointer to encoded data
+     * @param data_length Total length of data in bytes
+     * @param block_size Samples per block, passed to the codec's decoder
+     * @param codec One of the voice::codec values
+     */
+    voice_decoder(const uint8_t *data, size_t data_length, size_t block_size, uint8_t codec) : codec(codec) {
+        switch (codec) {
+        case voice::CODEC_PCM12:
+            new (&pcm12) pcm12_decoder(data, data_length, block_size);
+            break;
+        case voice::CODEC_ADPCM:
+            new (&adpcm) adpcm_decoder(data, data_length, block_size);
+            break;
+        case voice::CODEC_LPC:
+            new (&lpc) lpc_decoder(data, data_length, block_size);
+            break;
+        case voice::CODEC_PCM16:
+            new (&pcm) pcm_decoder(data, data_length, block_size);
+            break;
+        default:
+            this->codec = voice::CODEC_PCM16;
+            new (&pcm) pcm_decoder(data, 0, 0);
+            break;
+        }
+    }
+
+    voice_decoder(const voice_decoder &) = delete;
+    voice_decoder &operator=(const voice_decoder &) = delete;
+
+    /**
+     * Decode and return a single sample
+     *
+     * @return Next 16-bit PCM sample, or 0 if no more data available
+     */
+    int16_t next() {
+        switch (codec) {
+        case voice::CODEC_PCM12: return pcm12.next();
+        case voice::CODEC_ADPCM: return adpcm.next();
+        case voice::CODEC_LPC: return lpc.next();
+        default: return pcm.next();
+        }
+    }
+
+    /**
+     * Decode a block of samples
+     *
+     * Uses the codec's own block decode where it has one, so that the switch
+     * is only paid once per block.
+     *
+     * @param out Where to write the samples
+     * @param count Maximum number of samples to write
+     * @return Number of samples written
+     */
+    size_t read(int16_t *out, size_t count) {
+        switch (codec) {
+        case voice::CODEC_PCM12: return pcm12.read(out, count);
+        case voice::CODEC_LPC: return lpc.read(out, count);
+        case voice::CODEC_ADPCM: return read_samples(adpcm, out, count);
+        default: return pcm.read(out, count);
+        }
+    }
+
+    /**
+     * Borrow a block of samples in place
+     *
+     * Only uncompressed PCM can be borrowed, everything else has to be decoded.
+     *
+     * @param count Number of samples wanted
+     * @return Pointer to the next count samples, or nullptr if they cannot be
+     *         borrowed, in which case nothing is consumed
+     */
+    const int16_t *direct(size_t count) {
+        return codec == voice::CODEC_PCM16 ? pcm.direct(count) : nullptr;
+    }
+
+    /**
+     * Check if there is more data to decode
+     *
+     * @return true if more data is available, false if decoding is complete
+     */
+    bool empty() const {
+        switch (codec) {
+        case voice::CODEC_PCM12: return pcm12.empty();
+        case voice::CODEC_ADPCM: return adpcm.empty();
+        case voice::CODEC_LPC: return lpc.empty();
+        default: return pcm.empty();
+        }
+    }
+
+    /**
+     * Get the number of samples remaining to be decoded
+     *
+     * @return Number of 16-bit PCM samples that will be produced from remaining data
+     */
+    size_t size() const {
+        switch (codec) {
+        case voice::CODEC_PCM12: return pcm12.size();
+        case voice::CODEC_ADPCM: return adpcm.size();
+        case voice::CODEC_LPC: return lpc.size();
+        default: return pcm.size();
+        }
+    }
+
+private:
+    uint8_t codec;
+    union {
+        pcm_decoder pcm;
+        pcm12_decoder pcm12;
+        adpcm_decoder adpcm;
+        lpc_decoder lpc;
+    };
+
+    template <typename Decoder>
+    static size_t read_samples(Decoder &decoder, int16_t *out, size_t count) {
+        size_t n = 0;
+        while (n < count && !decoder.empty()) {
+            out[n++] = decoder.next();
+        }
+        return n;
+    }
+};
+
+#endif // VOICE_DECODER_H
@@ -0,0 +1,61 @@
+/**
+ * Copyright (c) 2025 Martin Sandiford.
+ *
+ * Packed Voice Blob Format
+ */
+
+#ifndef VOICE_FORMAT_H
+#define VOICE_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * All of the token audio lives in one binary blob, generated by the scripts in
+ * number_wavs and linked into flash.  The blob starts with a header, followed
+ * by an index with one entry per number_token (in enum order), followed by
+ * the encoded audio for each token.  Everything is little endian, and offsets
+ * are from the start of the blob.
+ *
+ * The token data is laid out most frequently spoken first, so the hottest
+ * tokens are a contiguous run at the start of the data that the firmware can
+ * copy into SRAM in one go.  Sorting the index by offset gives that order.
+ *
+ * Shared by the firmware and the host tools, so keep it plain.
+ */
+namespace voice {
+    constexpr uint32_t MAGIC = 0x43494f56;   // "VOIC"
+    constexpr uint16_t VERSION = 1;
+
+    // Token data starts on an XIP cache line, so that no line holds the end of
+    // one token and the start of another
+    constexpr size_t DATA_ALIGN = 8;
+
+    enum codec : uint8_t {
+        CODEC_PCM16 = 0,                    // pcm_decoder
+        CODEC_PCM12 = 1,                    // pcm12_decoder
+        CODEC_ADPCM = 2,                    // adpcm_decoder
+        CODEC_LPC = 3                       // lpc_decoder
+    };
+
+    struct header {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t entry_count;
+    };
+
+    struct entry {
+        uint32_t offset;                    // Start of the encoded data
+        uint32_t size;                      // Encoded size in bytes
+        uint32_t sample_count;              // Decoded samples, at sample_rate
+        uint32_t samples_per_block;         // Passed to the decoder as block_size
+        uint16_t sample_rate;
+        uint8_t codec;
+        uint8_t flags;                      // Reserved, zero
+    };
+
+    static_assert(sizeof(header) == 8, "Header must match the generated blob");
+    static_assert(sizeof(entry) == 20, "Index entries must match the generated blob");
+}
+
+#endif // VOICE_FORMAT_H